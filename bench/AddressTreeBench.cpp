@@ -0,0 +1,214 @@
+/*
+ *
+ * (C) 2019 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+
+
+
+#include "ntop_includes.h"
+#include "AddressTreeBench.h"
+
+/* ******************************************* */
+
+static inline u_int32_t nextRand(u_int32_t *seed) {
+  /* xorshift32 */
+  u_int32_t x = *seed;
+
+  x ^= x << 13, x ^= x >> 17, x ^= x << 5;
+  return(*seed = x);
+}
+
+/* ******************************************* */
+
+AddressTreeBench::AddressTreeBench(int argc, char *argv[], u_int32_t _num_iterations)
+  : Benchmark("lpm", _num_iterations) {
+  int c;
+
+  num_prefixes = 10000, num_lookups = 10000000, ipv6_pctg = 20, seed = 0x5eed1234;
+  tree = NULL, keys = NULL, compile_usec = 0, num_mismatches = 0;
+
+  /* argv[0] is the benchmark name */
+  optind = 0;
+  while((c = getopt(argc, argv, "P:L:6:")) != -1) {
+    switch(c) {
+    case 'P': num_prefixes = atoi(optarg); break;
+    case 'L': num_lookups = atoi(optarg);  break;
+    case '6': ipv6_pctg = atoi(optarg);    break;
+    default:
+      num_lookups = 0; /* setup() will fail */
+      break;
+    }
+  }
+}
+
+/* ******************************************* */
+
+AddressTreeBench::~AddressTreeBench() {
+  if(tree) delete tree;
+  if(keys) free(keys);
+}
+
+/* ******************************************* */
+
+bool AddressTreeBench::setup() {
+  std::vector<AddressTreeBenchKey> prefixes;
+  std::vector<u_int8_t> prefix_bits;
+
+  if((num_prefixes == 0) || (num_lookups == 0) || (ipv6_pctg > 100)) {
+    ntop->getTrace()->traceEvent(TRACE_ERROR, "[%s] Invalid options", name);
+    return(false);
+  }
+
+  if(((tree = new(std::nothrow) AddressTree()) == NULL)
+     || ((keys = (AddressTreeBenchKey*)calloc(num_lookups, sizeof(AddressTreeBenchKey))) == NULL))
+    return(false);
+
+  /*
+    Prefix lengths are spread as in routing/local network tables:
+    IPv4 /8../32 with most of them between /16 and /24, IPv6 /16../64.
+  */
+  for(u_int32_t i = 0; i < num_prefixes; i++) {
+    AddressTreeBenchKey k;
+    bool ipv6 = (nextRand(&seed) % 100) < ipv6_pctg;
+    u_int8_t bits = ipv6 ? (16 + nextRand(&seed) % 49) : (8 + nextRand(&seed) % 25);
+    char addr[64], rule[80];
+
+    if(!ipv6 && (nextRand(&seed) % 2))
+      bits = 16 + nextRand(&seed) % 9;
+
+    memset(&k, 0, sizeof(k));
+    k.ipv6 = ipv6;
+
+    for(u_int j = 0; j < (ipv6 ? 16 : 4); j++)
+      k.addr[j] = (j < (u_int)((bits + 7) / 8)) ? (nextRand(&seed) & 0xFF) : 0;
+
+    inet_ntop(ipv6 ? AF_INET6 : AF_INET, k.addr, addr, sizeof(addr));
+    snprintf(rule, sizeof(rule), "%s/%u", addr, bits);
+    tree->addAddress(rule);
+
+    prefixes.push_back(k), prefix_bits.push_back(bits);
+  }
+
+  /* Half of the lookups fall into a prefix, the others are random addresses */
+  for(u_int32_t i = 0; i < num_lookups; i++) {
+    AddressTreeBenchKey *k = &keys[i];
+
+    if(nextRand(&seed) % 2) {
+      u_int32_t p = nextRand(&seed) % num_prefixes;
+      u_int8_t bits = prefix_bits[p];
+
+      *k = prefixes[p];
+
+      for(u_int j = bits / 8; j < (u_int)(k->ipv6 ? 16 : 4); j++) {
+	u_int8_t host_mask = (j == (u_int)(bits / 8)) ? (0xFF >> (bits % 8)) : 0xFF;
+
+	k->addr[j] = (k->addr[j] & ~host_mask) | (nextRand(&seed) & host_mask);
+      }
+    } else {
+      k->ipv6 = (nextRand(&seed) % 100) < ipv6_pctg;
+
+      for(u_int j = 0; j < (u_int)(k->ipv6 ? 16 : 4); j++)
+	k->addr[j] = nextRand(&seed) & 0xFF;
+    }
+  }
+
+  printf("[%s] %u prefixes [%u %% IPv6][%u lookups]\n", name, num_prefixes, ipv6_pctg, num_lookups);
+
+  return(true);
+}
+
+/* ******************************************* */
+
+/* Returns a checksum of the results so that the lookups can't be optimized out */
+u_int64_t AddressTreeBench::lookupAll(bool compiled, float *usec) {
+  struct timeval begin, end;
+  u_int64_t sum = 0;
+
+  gettimeofday(&begin, NULL);
+
+  for(u_int32_t i = 0; i < num_lookups; i++) {
+    AddressTreeBenchKey *k = &keys[i];
+    int family = k->ipv6 ? AF_INET6 : AF_INET;
+    u_int8_t bits = 0;
+    int16_t v = compiled ? tree->findAddress(family, k->addr, &bits)
+      : tree->findAddressPatricia(family, k->addr, &bits);
+
+    sum = (sum * 31) + (u_int16_t)v + bits;
+  }
+
+  gettimeofday(&end, NULL);
+  *usec = elapsedUsec(&begin, &end);
+
+  return(sum);
+}
+
+/* ******************************************* */
+
+bool AddressTreeBench::runIteration(u_int32_t iteration) {
+  struct timeval begin, end;
+  float patricia_usec, compiled_usec;
+  u_int64_t patricia_sum, compiled_sum;
+  char buf[2][32];
+
+  gettimeofday(&begin, NULL);
+  if(!tree->compile()) return(false);
+  gettimeofday(&end, NULL);
+  compile_usec = elapsedUsec(&begin, &end);
+
+  patricia_sum = lookupAll(false, &patricia_usec);
+  compiled_sum = lookupAll(true, &compiled_usec);
+
+  if(iteration == 0) {
+    /* Compare every single result once */
+    for(u_int32_t i = 0; i < num_lookups; i++) {
+      int family = keys[i].ipv6 ? AF_INET6 : AF_INET;
+      u_int8_t b1 = 0, b2 = 0;
+
+      if((tree->findAddressPatricia(family, keys[i].addr, &b1) != tree->findAddress(family, keys[i].addr, &b2))
+	 || (b1 != b2))
+	num_mismatches++;
+    }
+  } else if(patricia_sum != compiled_sum)
+    num_mismatches++;
+
+  patricia_lps.add(rate(num_lookups, patricia_usec));
+  compiled_lps.add(rate(num_lookups, compiled_usec));
+
+  printf("[%s] Iteration %u: patricia %slookups/s, compiled %slookups/s [compiled in %.1f ms]\n",
+	 name, iteration + 1,
+	 formatRate(rate(num_lookups, patricia_usec), buf[0], sizeof(buf[0])),
+	 formatRate(rate(num_lookups, compiled_usec), buf[1], sizeof(buf[1])),
+	 compile_usec / 1000.);
+
+  return(true);
+}
+
+/* ******************************************* */
+
+void AddressTreeBench::report() {
+  printRate("Patricia lookups", "lookups/s", &patricia_lps);
+  printRate("Compiled lookups", "lookups/s", &compiled_lps);
+
+  if(patricia_lps.getAvg() > 0)
+    printf("  %-24s %12.2fx\n", "Speedup", compiled_lps.getAvg() / patricia_lps.getAvg());
+
+  printf("  %-24s %12.1f ms\n", "Compilation time", compile_usec / 1000.);
+  printf("  %-24s %12s\n", "Result mismatches", num_mismatches ? "FAILED" : "none");
+}
@@ -0,0 +1,62 @@
+/*
+ *
+ * (C) 2019 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+
+
+
+#ifndef _ADDRESS_TREE_BENCH_H_
+#define _ADDRESS_TREE_BENCH_H_
+
+#include "Benchmark.h"
+
+/* An address to be looked up, either IPv4 (network byte order) or IPv6 */
+typedef struct {
+  u_int8_t addr[16];
+  u_int8_t ipv6;
+} AddressTreeBenchKey;
+
+/*
+  Longest prefix match microbenchmark: random prefixes are loaded into
+  an AddressTree and the same set of addresses is looked up with the
+  patricia trees and with the compiled LPM tables, checking that both
+  return the same result.
+*/
+class AddressTreeBench : public Benchmark {
+ private:
+  u_int32_t num_prefixes, num_lookups, ipv6_pctg, seed;
+  AddressTree *tree;
+  AddressTreeBenchKey *keys;
+  BenchmarkRate patricia_lps, compiled_lps;
+  float compile_usec;
+  u_int64_t num_mismatches;
+
+  void randomPrefix(char *buf, u_int buf_len, bool ipv6);
+  u_int64_t lookupAll(bool compiled, float *usec);
+  bool setup();
+  bool runIteration(u_int32_t iteration);
+  void report();
+
+ public:
+  AddressTreeBench(int argc, char *argv[], u_int32_t _num_iterations);
+  ~AddressTreeBench();
+};
+
+#endif /* _ADDRESS_TREE_BENCH_H_ */
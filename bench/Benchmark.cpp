@@ -0,0 +1,100 @@
+/*
+ *
+ * (C) 2019 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+
+#include "Benchmark.h"
+
+/* ******************************************* */
+
+Benchmark::Benchmark(const char *_name, u_int32_t _num_iterations) {
+  name = _name, num_iterations = _num_iterations ? _num_iterations : 1;
+}
+
+/* ******************************************* */
+
+int Benchmark::run() {
+  if(!setup()) {
+    ntop->getTrace()->traceEvent(TRACE_ERROR, "[%s] Benchmark setup failed", name);
+    return(-1);
+  }
+
+  for(u_int32_t i = 0; i < num_iterations; i++) {
+    if(ntop->getGlobals()->isShutdownRequested())
+      break;
+
+    if(!runIteration(i)) {
+      ntop->getTrace()->traceEvent(TRACE_ERROR, "[%s] Iteration %u failed", name, i + 1);
+      return(-1);
+    }
+  }
+
+  printf("\n[%s] Summary over %u iteration(s)\n", name, num_iterations);
+  report();
+
+  return(0);
+}
+
+/* ******************************************* */
+
+char* Benchmark::formatRate(float r, char *buf, u_int buf_len) {
+  if(r >= 1000000)
+    snprintf(buf, buf_len, "%.2f M", r / 1000000.);
+  else if(r >= 1000)
+    snprintf(buf, buf_len, "%.2f K", r / 1000.);
+  else
+    snprintf(buf, buf_len, "%.2f ", r);
+
+  return(buf);
+}
+
+/* ******************************************* */
+
+void Benchmark::printRate(const char *label, const char *unit, const BenchmarkRate *r) {
+  char min_buf[32], avg_buf[32], max_buf[32];
+
+  printf("  %-24s %12s%s [min %12s%s / max %12s%s]\n", label,
+	 formatRate(r->getAvg(), avg_buf, sizeof(avg_buf)), unit,
+	 formatRate(r->getMin(), min_buf, sizeof(min_buf)), unit,
+	 formatRate(r->getMax(), max_buf, sizeof(max_buf)), unit);
+}
+
+/* ******************************************* */
+
+u_int64_t Benchmark::residentMemory() {
+#ifdef __linux__
+  unsigned long vm_pages, rss_pages;
+  FILE *fd;
+  int rc;
+
+  if((fd = fopen("/proc/self/statm", "r")) == NULL)
+    return(0);
+
+  rc = fscanf(fd, "%lu %lu", &vm_pages, &rss_pages);
+  fclose(fd);
+
+  if(rc != 2)
+    return(0);
+
+  return((u_int64_t)rss_pages * sysconf(_SC_PAGESIZE));
+#else
+  return(0);
+#endif
+}
@@ -0,0 +1,81 @@
+/*
+ *
+ * (C) 2019 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+
+#ifndef _BENCHMARK_H_
+#define _BENCHMARK_H_
+
+#include "ntop_includes.h"
+
+/* Min/avg/max of a rate measured over multiple iterations */
+class BenchmarkRate {
+ private:
+  float min_rate, max_rate, tot_rate;
+  u_int32_t num_samples;
+
+ public:
+  BenchmarkRate() { min_rate = max_rate = tot_rate = 0, num_samples = 0; };
+
+  inline void add(float r) {
+    if((num_samples == 0) || (r < min_rate)) min_rate = r;
+    if((num_samples == 0) || (r > max_rate)) max_rate = r;
+    tot_rate += r, num_samples++;
+  };
+  inline float getMin() const { return(min_rate); };
+  inline float getMax() const { return(max_rate); };
+  inline float getAvg() const { return(num_samples ? tot_rate / num_samples : 0); };
+};
+
+/*
+  Base class of the ntopng-bench benchmarks: a benchmark is
+  run num_iterations times and the per-iteration results are
+  summarized (min/avg/max) at the end so that numbers are stable
+  enough to compare builds and tuning options.
+*/
+class Benchmark {
+ protected:
+  const char *name;
+  u_int32_t num_iterations;
+
+  static inline float elapsedUsec(const struct timeval *begin, const struct timeval *end) {
+    return((float)((end->tv_sec - begin->tv_sec) * 1000000 + (end->tv_usec - begin->tv_usec)));
+  };
+  static inline float rate(u_int64_t num, float usec) { return((usec > 0) ? (num * 1000000.) / usec : 0); };
+  static char* formatRate(float r, char *buf, u_int buf_len);
+  static void printRate(const char *label, const char *unit, const BenchmarkRate *r);
+  /* Resident set size of the process in bytes (0 if unavailable) */
+  static u_int64_t residentMemory();
+
+  /* Called once before the first iteration */
+  virtual bool setup()                          { return(true); };
+  /* Return false to abort the benchmark */
+  virtual bool runIteration(u_int32_t iteration) = 0;
+  /* Called once after the last iteration */
+  virtual void report()                         { ; };
+
+ public:
+  Benchmark(const char *_name, u_int32_t _num_iterations);
+  virtual ~Benchmark() { };
+
+  int run();
+};
+
+#endif /* _BENCHMARK_H_ */
@@ -0,0 +1,388 @@
+/*
+ *
+ * (C) 2019 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+
+
+#include "ntop_includes.h"
+#include "FlowGeneratorBench.h"
+
+#ifndef HAVE_NEDGE
+
+/* Protocols that can be used in the flow mix */
+static const struct {
+  const char *name;
+  u_int16_t ndpi_proto;
+  u_int8_t l4_proto;
+  u_int16_t port; /* 0 = random */
+  u_int32_t bytes_per_pkt;
+} flow_protos[] = {
+  { "http",    NDPI_PROTOCOL_HTTP, IPPROTO_TCP, 80,  900  },
+  { "ssl",     NDPI_PROTOCOL_SSL,  IPPROTO_TCP, 443, 1100 },
+  { "dns",     NDPI_PROTOCOL_DNS,  IPPROTO_UDP, 53,  90   },
+  { "ssh",     NDPI_PROTOCOL_SSH,  IPPROTO_TCP, 22,  300  },
+  { "quic",    NDPI_PROTOCOL_QUIC, IPPROTO_UDP, 443, 1200 },
+  { "unknown", NDPI_PROTOCOL_UNKNOWN, IPPROTO_UDP, 0, 500  },
+  { NULL, 0, 0, 0, 0 }
+};
+
+static const char *flow_server_names[] = {
+  "www.ntop.org", "www.example.com", "api.example.net", "cdn.example.org",
+  "mail.example.com", "update.example.net", "static.example.org", "login.example.com"
+};
+
+#define NUM_SERVER_NAMES (sizeof(flow_server_names) / sizeof(flow_server_names[0]))
+
+/* ******************************************* */
+
+static inline u_int32_t nextRand(u_int32_t *seed) {
+  /* xorshift32: cheap enough not to show up in the numbers */
+  u_int32_t x = *seed;
+
+  x ^= x << 13, x ^= x >> 17, x ^= x << 5;
+  return(*seed = x);
+}
+
+/* ******************************************* */
+
+FlowGeneratorBench::FlowGeneratorBench(int argc, char *argv[], u_int32_t _num_iterations)
+  : Benchmark("flows", _num_iterations) {
+  int c;
+
+  num_threads = 1, num_hosts = 10000, num_active_flows = 20000;
+  churn_pctg = 10, ipv6_pctg = 10, records_per_sec = 5000;
+  duration = 10, warmup = 3;
+  proto_mix = strdup("http:30,ssl:40,dns:20,unknown:10");
+  threads = NULL, running = false, max_rss = 0;
+  memset(proto_dist, 0, sizeof(proto_dist));
+
+  /* argv[0] is the benchmark name */
+  optind = 0;
+  while((c = getopt(argc, argv, "t:H:F:c:6:p:r:d:w:")) != -1) {
+    switch(c) {
+    case 't': num_threads = atoi(optarg);      break;
+    case 'H': num_hosts = atoi(optarg);        break;
+    case 'F': num_active_flows = atoi(optarg); break;
+    case 'c': churn_pctg = atoi(optarg);       break;
+    case '6': ipv6_pctg = atoi(optarg);        break;
+    case 'r': records_per_sec = atoi(optarg);  break;
+    case 'd': duration = atoi(optarg);         break;
+    case 'w': warmup = atoi(optarg);           break;
+    case 'p':
+      free(proto_mix);
+      proto_mix = strdup(optarg);
+      break;
+    default:
+      num_threads = 0; /* setup() will fail */
+      break;
+    }
+  }
+}
+
+/* ******************************************* */
+
+FlowGeneratorBench::~FlowGeneratorBench() {
+  if(threads) free(threads);
+  if(proto_mix) free(proto_mix);
+}
+
+/* ******************************************* */
+
+/* Parses <proto>:<weight>[,<proto>:<weight>...] into proto_dist */
+bool FlowGeneratorBench::parseProtoMix() {
+  char *mix = strdup(proto_mix), *item, *tmp;
+  u_int32_t weights[sizeof(flow_protos) / sizeof(flow_protos[0])], tot_weight = 0, slot = 0;
+  u_int num_protos;
+
+  if(mix == NULL) return(false);
+
+  memset(weights, 0, sizeof(weights));
+
+  for(item = strtok_r(mix, ",", &tmp); item != NULL; item = strtok_r(NULL, ",", &tmp)) {
+    char *weight = strchr(item, ':');
+    u_int i;
+
+    if(weight) *weight++ = '\0';
+
+    for(i = 0; flow_protos[i].name && strcmp(flow_protos[i].name, item); i++)
+      ;
+
+    if(flow_protos[i].name == NULL) {
+      ntop->getTrace()->traceEvent(TRACE_ERROR, "[%s] Unknown protocol '%s' in mix", name, item);
+      free(mix);
+      return(false);
+    }
+
+    weights[i] += weight ? atoi(weight) : 1;
+    tot_weight += weight ? atoi(weight) : 1;
+  }
+
+  free(mix);
+
+  if(tot_weight == 0) {
+    ntop->getTrace()->traceEvent(TRACE_ERROR, "[%s] Empty protocol mix", name);
+    return(false);
+  }
+
+  for(num_protos = 0; flow_protos[num_protos].name; num_protos++) {
+    u_int32_t n = (weights[num_protos] * 100) / tot_weight;
+
+    for(u_int32_t j = 0; (j < n) && (slot < sizeof(proto_dist)); j++)
+      proto_dist[slot++] = num_protos;
+  }
+
+  /* Rounding leftovers go to the last protocol of the mix */
+  while(slot < sizeof(proto_dist)) {
+    proto_dist[slot] = slot ? proto_dist[slot - 1] : 0;
+    slot++;
+  }
+
+  return(true);
+}
+
+/* ******************************************* */
+
+bool FlowGeneratorBench::setup() {
+  if((num_threads == 0) || (num_hosts < 2) || (num_active_flows == 0) || (records_per_sec == 0)
+     || (churn_pctg > 100) || (ipv6_pctg > 100) || (duration <= warmup)) {
+    ntop->getTrace()->traceEvent(TRACE_ERROR, "[%s] Invalid options (note: duration must be > warmup)", name);
+    return(false);
+  }
+
+  if(!parseProtoMix())
+    return(false);
+
+  if((threads = (FlowGenThread*)calloc(num_threads, sizeof(FlowGenThread))) == NULL)
+    return(false);
+
+  printf("[%s] %u thread(s) [%u hosts][%u active flows][%u %% churn][%u %% IPv6][%s][%u records/sec][%u sec, %u sec warmup]\n",
+	 name, num_threads, num_hosts, num_active_flows, churn_pctg, ipv6_pctg,
+	 proto_mix, records_per_sec, duration, warmup);
+
+  return(true);
+}
+
+/* ******************************************* */
+
+static void setHostAddress(IpAddress *ip, u_int32_t idx, bool ipv6) {
+  if(ipv6) {
+    struct ndpi_in6_addr a;
+
+    /* fd00::<idx> */
+    memset(&a, 0, sizeof(a));
+    a.u6_addr.u6_addr8[0] = 0xfd;
+    a.u6_addr.u6_addr32[3] = htonl(idx);
+    ip->set(&a);
+  } else
+    ip->set(htonl(0x0A000000 /* 10.0.0.0/8 */ + idx));
+}
+
+/* ******************************************* */
+
+void FlowGeneratorBench::generateFlows(FlowGenThread *t) {
+  u_int32_t num_slots = max_val(num_active_flows / num_threads, 1);
+  FlowGenSlot *slots;
+  json_object *additional_fields;
+  time_t begin = time(NULL);
+  u_int32_t vtime = (u_int32_t)begin, vtime_records = 0;
+  ZMQ_Flow zflow;
+
+  if((slots = (FlowGenSlot*)calloc(num_slots, sizeof(FlowGenSlot))) == NULL) {
+    ntop->getTrace()->traceEvent(TRACE_ERROR, "[%s] Not enough memory", name);
+    return;
+  }
+
+  /* Shared by all the records: processFlow only serializes it */
+  additional_fields = json_object_new_object();
+
+  while(running) {
+    u_int32_t r = nextRand(&t->seed);
+    FlowGenSlot *s = &slots[r % num_slots];
+    u_int32_t pkts, proto_idx;
+
+    if((s->first_switched == 0) || ((nextRand(&t->seed) % 100) < churn_pctg)) {
+      /* A new flow replaces this one: the old flow will go idle */
+      s->src_idx = nextRand(&t->seed) % num_hosts;
+      s->dst_idx = nextRand(&t->seed) % num_hosts;
+      if(s->dst_idx == s->src_idx) s->dst_idx = (s->dst_idx + 1) % num_hosts;
+      s->src_port = 1024 + (nextRand(&t->seed) % 64000);
+      s->proto_idx = proto_dist[nextRand(&t->seed) % 100];
+      s->ipv6 = ((nextRand(&t->seed) % 100) < ipv6_pctg) ? 1 : 0;
+      s->first_switched = vtime;
+      t->num_new_flows++;
+    }
+
+    proto_idx = s->proto_idx, pkts = 1 + (r >> 28);
+
+    memset(&zflow, 0, sizeof(zflow));
+    setHostAddress(&zflow.core.src_ip, s->src_idx, s->ipv6 ? true : false);
+    setHostAddress(&zflow.core.dst_ip, s->dst_idx, s->ipv6 ? true : false);
+    zflow.core.src_port = htons(s->src_port);
+    zflow.core.dst_port = htons(flow_protos[proto_idx].port ? flow_protos[proto_idx].port
+				: (1024 + (s->dst_idx % 64000)));
+    zflow.core.l4_proto = flow_protos[proto_idx].l4_proto;
+    zflow.core.l7_proto.app_protocol = flow_protos[proto_idx].ndpi_proto;
+    zflow.core.pkt_sampling_rate = 1;
+    zflow.core.in_pkts = pkts, zflow.core.out_pkts = pkts;
+    zflow.core.in_bytes = pkts * 80, zflow.core.out_bytes = pkts * flow_protos[proto_idx].bytes_per_pkt;
+    zflow.core.first_switched = s->first_switched, zflow.core.last_switched = vtime;
+    if(zflow.core.l4_proto == IPPROTO_TCP) zflow.core.tcp_flags = TH_ACK | TH_PUSH;
+    zflow.core.source_id = 1;
+    zflow.additional_fields = additional_fields;
+
+    switch(flow_protos[proto_idx].ndpi_proto) {
+    case NDPI_PROTOCOL_HTTP:
+      zflow.http_site = (char*)flow_server_names[s->dst_idx % NUM_SERVER_NAMES];
+      break;
+    case NDPI_PROTOCOL_SSL:
+      zflow.ssl_server_name = (char*)flow_server_names[s->dst_idx % NUM_SERVER_NAMES];
+      break;
+    case NDPI_PROTOCOL_DNS:
+      zflow.dns_query = (char*)flow_server_names[s->src_port % NUM_SERVER_NAMES];
+      break;
+    }
+
+    t->iface->processFlow(&zflow);
+    t->num_records++;
+
+    if(++vtime_records == records_per_sec) {
+      /*
+	Advance the virtual clock. processFlow shifts flow timestamps
+	by the drift between the wall clock and the first record
+	(begin), hence the interface time must include it too.
+      */
+      vtime++, vtime_records = 0;
+      t->iface->purgeIdle(vtime + (time(NULL) - begin));
+    }
+  }
+
+  json_object_put(additional_fields);
+  free(slots);
+}
+
+/* ******************************************* */
+
+static void* flowGeneratorLoop(void *ptr) {
+  FlowGenThread *t = (FlowGenThread*)ptr;
+
+  t->bench->generateFlows(t);
+  return(NULL);
+}
+
+/* ******************************************* */
+
+void FlowGeneratorBench::countRecords(u_int64_t *num_records, u_int64_t *num_new_flows) {
+  *num_records = *num_new_flows = 0;
+
+  for(u_int32_t i = 0; i < num_threads; i++)
+    *num_records += threads[i].num_records, *num_new_flows += threads[i].num_new_flows;
+}
+
+/* ******************************************* */
+
+bool FlowGeneratorBench::runIteration(u_int32_t iteration) {
+  u_int64_t rss_begin, rss_end, records_begin, records_end, new_flows_begin, new_flows_end;
+  u_int32_t num_flows = 0, num_hosts_active = 0;
+  struct timeval begin, end;
+  float usec;
+
+  rss_begin = residentMemory();
+
+  for(u_int32_t i = 0; i < num_threads; i++) {
+    memset(&threads[i], 0, sizeof(FlowGenThread));
+    threads[i].bench = this;
+    threads[i].seed = 0x9E3779B9 * (i + 1) + iteration;
+
+    try {
+      threads[i].iface = new DummyInterface();
+    } catch(...) {
+      threads[i].iface = NULL;
+    }
+
+    if(threads[i].iface == NULL) {
+      ntop->getTrace()->traceEvent(TRACE_ERROR, "[%s] Unable to create the interface", name);
+
+      while(i > 0) delete threads[--i].iface;
+      return(false);
+    }
+  }
+
+  running = true;
+
+  for(u_int32_t i = 0; i < num_threads; i++)
+    pthread_create(&threads[i].thread, NULL, flowGeneratorLoop, (void*)&threads[i]);
+
+  /* Do not measure the warmup: tables are filling up and nothing is purged yet */
+  for(u_int32_t i = 0; (i < warmup) && !ntop->getGlobals()->isShutdownRequested(); i++)
+    sleep(1);
+
+  gettimeofday(&begin, NULL);
+  countRecords(&records_begin, &new_flows_begin);
+
+  for(u_int32_t i = warmup; (i < duration) && !ntop->getGlobals()->isShutdownRequested(); i++)
+    sleep(1);
+
+  gettimeofday(&end, NULL);
+  countRecords(&records_end, &new_flows_end);
+
+  running = false;
+
+  for(u_int32_t i = 0; i < num_threads; i++)
+    pthread_join(threads[i].thread, NULL);
+
+  rss_end = residentMemory();
+  max_rss = max_val(max_rss, rss_end);
+
+  for(u_int32_t i = 0; i < num_threads; i++)
+    num_flows += threads[i].iface->getFlowsHashSize(), num_hosts_active += threads[i].iface->getHostsHashSize();
+
+  usec = elapsedUsec(&begin, &end);
+  rps.add(rate(records_end - records_begin, usec));
+  fps.add(rate(new_flows_end - new_flows_begin, usec));
+
+  printf("[%s] Iteration %u/%u: [%.2f Krecords/s][%.2f Kflows/s new][%u flows][%u hosts][RSS %.1f MB][%llu bytes/flow]\n",
+	 name, iteration + 1, num_iterations,
+	 rate(records_end - records_begin, usec) / 1000., rate(new_flows_end - new_flows_begin, usec) / 1000.,
+	 num_flows, num_hosts_active, rss_end / 1048576.,
+	 (unsigned long long)(num_flows ? (rss_end - min_val(rss_begin, rss_end)) / num_flows : 0));
+
+  for(u_int32_t i = 0; i < num_threads; i++)
+    delete threads[i].iface;
+
+  return(true);
+}
+
+/* ******************************************* */
+
+void FlowGeneratorBench::report() {
+  printRate("Flow records", "records/s", &rps);
+  printRate("New flows", "flows/s", &fps);
+
+  if(num_threads > 1) {
+    char buf[32];
+
+    printf("  %-24s %12srecords/s\n", "Flow records per thread",
+	   formatRate(rps.getAvg() / num_threads, buf, sizeof(buf)));
+  }
+
+  printf("  %-24s %12.1f MB\n", "Peak RSS", max_rss / 1048576.);
+}
+
+#endif
@@ -0,0 +1,86 @@
+/*
+ *
+ * (C) 2019 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+
+
+#ifndef _FLOW_GENERATOR_BENCH_H_
+#define _FLOW_GENERATOR_BENCH_H_
+
+#include "Benchmark.h"
+
+#ifndef HAVE_NEDGE
+
+class FlowGeneratorBench;
+
+/* A synthetic flow record template, i.e. an active flow of the generator */
+typedef struct {
+  u_int32_t src_idx, dst_idx, first_switched;
+  u_int16_t src_port;
+  u_int8_t proto_idx, ipv6;
+} FlowGenSlot;
+
+typedef struct {
+  FlowGeneratorBench *bench;
+  DummyInterface *iface;
+  pthread_t thread;
+  u_int32_t seed;
+  volatile u_int64_t num_records, num_new_flows;
+} FlowGenThread;
+
+/*
+  Injects synthetic ZMQ_Flow records directly into
+  NetworkInterface::processFlow (no JSON/ZMQ parsing) in order to
+  measure the flow engine of collector interfaces. Each thread feeds
+  its own DummyInterface, as a collector deployment would do with
+  one interface per exporter/ZMQ endpoint.
+
+  Time is virtual: it advances by one second every 'rate' records so
+  that idle flows and hosts are purged as in a real deployment while
+  the generator runs as fast as possible.
+*/
+class FlowGeneratorBench : public Benchmark {
+ private:
+  u_int32_t num_threads, num_hosts, num_active_flows, churn_pctg, ipv6_pctg;
+  u_int32_t records_per_sec, duration, warmup;
+  u_int8_t proto_dist[100]; /* Protocol index for each percentile of the mix */
+  char *proto_mix;
+  FlowGenThread *threads;
+  volatile bool running;
+  BenchmarkRate rps, fps;
+  u_int64_t max_rss;
+
+  bool parseProtoMix();
+  bool setup();
+  bool runIteration(u_int32_t iteration);
+  void report();
+  void countRecords(u_int64_t *num_records, u_int64_t *num_new_flows);
+
+ public:
+  FlowGeneratorBench(int argc, char *argv[], u_int32_t _num_iterations);
+  ~FlowGeneratorBench();
+
+  inline bool isRunning() const { return(running); };
+  void generateFlows(FlowGenThread *t);
+};
+
+#endif
+
+#endif /* _FLOW_GENERATOR_BENCH_H_ */
@@ -0,0 +1,348 @@
+/*
+ *
+ * (C) 2019 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+
+
+
+#include "ntop_includes.h"
+#include "FlowIndexBench.h"
+
+#ifndef HAVE_NEDGE
+
+typedef struct {
+  std::set<Flow*> visited;
+  u_int64_t num_duplicates;
+} FlowIndexBenchWalk;
+
+/* ******************************************* */
+
+static inline u_int32_t nextRand(u_int32_t *seed) {
+  u_int32_t x = *seed;
+
+  x ^= x << 13, x ^= x >> 17, x ^= x << 5;
+  return(*seed = x);
+}
+
+/* ******************************************* */
+
+FlowIndexBench::FlowIndexBench(int argc, char *argv[], u_int32_t _num_iterations)
+  : Benchmark("flowindex", _num_iterations) {
+  int c;
+
+  num_hosts = 64, num_ports = 8, num_flows = 100000, seed = 0x9E3779B9;
+  iface = NULL, num_lookups = 0, num_mismatches = 0;
+
+  /* argv[0] is the benchmark name */
+  optind = 0;
+  while((c = getopt(argc, argv, "H:P:F:")) != -1) {
+    switch(c) {
+    case 'H': num_hosts = atoi(optarg); break;
+    case 'P': num_ports = atoi(optarg); break;
+    case 'F': num_flows = atoi(optarg); break;
+    default:
+      num_flows = 0; /* setup() will fail */
+      break;
+    }
+  }
+}
+
+/* ******************************************* */
+
+FlowIndexBench::~FlowIndexBench() {
+  /* The flows are no longer linked to the benchmark FlowIndex */
+  if(iface) delete iface;
+}
+
+/* ******************************************* */
+
+/*
+  The flows are linked to the FlowIndex of the benchmark, so the
+  interface must not index them: the preference is disabled while the
+  interface is created.
+*/
+DummyInterface* FlowIndexBench::createInterface() {
+  DummyInterface *d;
+  char pref[4];
+  bool enabled = (!ntop->getRedis()->get((char*)CONST_RUNTIME_PREFS_FLOW_INDEXES, pref, sizeof(pref)))
+    && (pref[0] == '1');
+
+  if(enabled) ntop->getRedis()->set(CONST_RUNTIME_PREFS_FLOW_INDEXES, "0");
+
+  try {
+    d = new DummyInterface();
+  } catch(...) {
+    d = NULL;
+  }
+
+  if(enabled) ntop->getRedis()->set(CONST_RUNTIME_PREFS_FLOW_INDEXES, "1");
+
+  if(d && d->getFlowIndex()) {
+    ntop->getTrace()->traceEvent(TRACE_ERROR, "[%s] Disable the flow indexes preference first", name);
+    delete d;
+    d = NULL;
+  }
+
+  return(d);
+}
+
+/* ******************************************* */
+
+/*
+  Hosts and ports are drawn from the same small sets for both peers
+  (hosts also talk to themselves), and the protocols appear both as
+  application and as master protocol, so that every index key has
+  flows in both of its chains.
+*/
+void FlowIndexBench::fillFlows() {
+  static const struct { u_int16_t app, master; } l7[] = {
+    { NDPI_PROTOCOL_HTTP, NDPI_PROTOCOL_UNKNOWN }, { NDPI_PROTOCOL_DROPBOX, NDPI_PROTOCOL_SSL },
+    { NDPI_PROTOCOL_SSL, NDPI_PROTOCOL_UNKNOWN },  { NDPI_PROTOCOL_DROPBOX, NDPI_PROTOCOL_HTTP },
+    { NDPI_PROTOCOL_DNS, NDPI_PROTOCOL_DNS },      { NDPI_PROTOCOL_UNKNOWN, NDPI_PROTOCOL_UNKNOWN }
+  };
+  json_object *additional_fields = json_object_new_object();
+  u_int32_t now = (u_int32_t)time(NULL);
+  ZMQ_Flow zflow;
+
+  for(u_int32_t i = 0; i < num_flows; i++) {
+    u_int32_t src = nextRand(&seed) % num_hosts, dst = nextRand(&seed) % num_hosts;
+    u_int32_t p = nextRand(&seed) % (sizeof(l7) / sizeof(l7[0]));
+
+    memset(&zflow, 0, sizeof(zflow));
+    zflow.core.src_ip.set(htonl(0x0A000001 + src));
+    zflow.core.dst_ip.set(htonl(0x0A000001 + dst));
+    zflow.core.src_port = htons(1000 + (nextRand(&seed) % num_ports));
+    zflow.core.dst_port = htons(1000 + (nextRand(&seed) % num_ports));
+    zflow.core.l4_proto = (i & 1) ? IPPROTO_TCP : IPPROTO_UDP;
+    zflow.core.l7_proto.app_protocol = l7[p].app, zflow.core.l7_proto.master_protocol = l7[p].master;
+    zflow.core.vlan_id = i % 4000; /* Distinct flows despite the few hosts and ports */
+    zflow.core.pkt_sampling_rate = 1;
+    zflow.core.in_pkts = 1, zflow.core.in_bytes = 100;
+    zflow.core.out_pkts = 1, zflow.core.out_bytes = 100;
+    zflow.core.first_switched = now, zflow.core.last_switched = now;
+    zflow.core.source_id = 1;
+    zflow.additional_fields = additional_fields;
+
+    iface->processFlow(&zflow);
+  }
+
+  json_object_put(additional_fields);
+
+  for(u_int16_t i = 0; i < sizeof(l7) / sizeof(l7[0]); i++) {
+    if(std::find(protos.begin(), protos.end(), l7[i].app) == protos.end())    protos.push_back(l7[i].app);
+    if(std::find(protos.begin(), protos.end(), l7[i].master) == protos.end()) protos.push_back(l7[i].master);
+  }
+
+  for(u_int16_t i = 0; i < num_ports; i++)
+    ports.push_back(1000 + i);
+}
+
+/* ******************************************* */
+
+static bool collect_walker(GenericHashEntry *h, void *user_data, bool *matched) {
+  std::vector<Flow*> *flows = (std::vector<Flow*>*)user_data;
+
+  flows->push_back((Flow*)h);
+  *matched = true;
+
+  return(false); /* false = keep on walking */
+}
+
+/* ******************************************* */
+
+static bool index_walker(GenericHashEntry *h, void *user_data, bool *matched) {
+  FlowIndexBenchWalk *w = (FlowIndexBenchWalk*)user_data;
+
+  if(!w->visited.insert((Flow*)h).second)
+    w->num_duplicates++;
+
+  *matched = true;
+  return(false); /* false = keep on walking */
+}
+
+/* ******************************************* */
+
+/* Whether a flow linked to the index has the key of the query */
+static bool flow_match(Flow *f, const FlowIndexQuery *q) {
+  ndpi_protocol proto = f->get_detected_protocol();
+
+  switch(q->type) {
+  case flow_index_host:
+    return((f->get_cli_host() == q->host) || (f->get_srv_host() == q->host));
+  case flow_index_port:
+    return((f->get_cli_port() == q->value) || (f->get_srv_port() == q->value));
+  case flow_index_l7proto:
+    return((proto.app_protocol == q->value)
+	   || ((proto.master_protocol == q->value) && (proto.master_protocol != NDPI_PROTOCOL_UNKNOWN)));
+  default:
+    return(false);
+  }
+}
+
+/* ******************************************* */
+
+/* Looks up the query and compares the flows found with those expected: returns true when they match */
+bool FlowIndexBench::check(FlowIndex *index, const FlowIndexQuery *q) {
+  FlowIndexBenchWalk w;
+  u_int32_t num_expected = 0;
+  bool ok = true;
+
+  w.num_duplicates = 0;
+  index->walk(q, index_walker, &w);
+
+  for(std::vector<Flow*>::iterator it = flows.begin(); it != flows.end(); ++it) {
+    Flow *f = *it;
+    bool expected = f->getIndexLinks() && flow_match(f, q) && !f->idle() && !f->is_ready_to_be_purged();
+
+    if(expected) num_expected++;
+    if(expected != (w.visited.find(f) != w.visited.end())) ok = false;
+  }
+
+  return(ok && (w.num_duplicates == 0) && (w.visited.size() == num_expected));
+}
+
+/* ******************************************* */
+
+bool FlowIndexBench::setup() {
+  u_int32_t begin_slot = 0;
+
+  if((num_flows == 0) || (num_hosts < 2) || (num_ports < 2)) {
+    ntop->getTrace()->traceEvent(TRACE_ERROR, "[%s] Invalid options", name);
+    return(false);
+  }
+
+  if((iface = createInterface()) == NULL) {
+    ntop->getTrace()->traceEvent(TRACE_ERROR, "[%s] Unable to create the interface", name);
+    return(false);
+  }
+
+  fillFlows();
+  iface->walker(&begin_slot, true /* walk_all */, walker_flows, collect_walker, &flows);
+
+  for(std::vector<Flow*>::iterator it = flows.begin(); it != flows.end(); ++it) {
+    Host *peers[2] = { (*it)->get_cli_host(), (*it)->get_srv_host() };
+
+    for(int i = 0; i < 2; i++)
+      if(peers[i] && (std::find(hosts.begin(), hosts.end(), peers[i]) == hosts.end()))
+	hosts.push_back(peers[i]);
+  }
+
+  printf("[%s] [%u flows][%u hosts][%u ports][%u L7 protocols]\n",
+	 name, (u_int32_t)flows.size(), (u_int32_t)hosts.size(), (u_int32_t)ports.size(), (u_int32_t)protos.size());
+
+  if(flows.size() < num_flows)
+    ntop->getTrace()->traceEvent(TRACE_WARNING, "[%s] Flows table too small: use -X to hold all the flows", name);
+
+  return(!flows.empty());
+}
+
+/* ******************************************* */
+
+/*
+  Links all the flows, unlinks half of them in random order and
+  relinks a fourth of those, then looks up every key.
+*/
+bool FlowIndexBench::runIteration(u_int32_t iteration) {
+  FlowIndex *index;
+  std::vector<Flow*> unlinked;
+  struct timeval begin, end;
+  u_int32_t num_iteration_lookups = 0, num_iteration_mismatches = 0;
+  float link_usec, unlink_usec, lookup_usec;
+
+  printf("[%s] Iteration %u/%u\n", name, iteration + 1, num_iterations);
+
+  try {
+    index = new FlowIndex(num_hosts);
+  } catch(...) {
+    ntop->getTrace()->traceEvent(TRACE_ERROR, "[%s] Not enough memory", name);
+    return(false);
+  }
+
+  gettimeofday(&begin, NULL);
+  for(std::vector<Flow*>::iterator it = flows.begin(); it != flows.end(); ++it)
+    index->add(*it);
+  gettimeofday(&end, NULL);
+  link_usec = elapsedUsec(&begin, &end);
+
+  for(u_int32_t i = 0; i < flows.size(); i++) {
+    Flow *f = flows[nextRand(&seed) % flows.size()];
+
+    if(f->getIndexLinks() && (unlinked.size() < flows.size() / 2))
+      unlinked.push_back(f);
+  }
+
+  gettimeofday(&begin, NULL);
+  for(std::vector<Flow*>::iterator it = unlinked.begin(); it != unlinked.end(); ++it)
+    if((*it)->getIndexLinks()) index->remove(*it); /* The same flow may have been drawn twice */
+  gettimeofday(&end, NULL);
+  unlink_usec = elapsedUsec(&begin, &end);
+
+  for(u_int32_t i = 0; i < unlinked.size() / 4; i++)
+    if(!unlinked[i]->getIndexLinks()) index->add(unlinked[i]);
+
+  gettimeofday(&begin, NULL);
+  for(u_int32_t i = 0; i < hosts.size() + ports.size() + protos.size(); i++) {
+    FlowIndexQuery q;
+
+    memset(&q, 0, sizeof(q));
+
+    if(i < hosts.size())
+      q.type = flow_index_host, q.host = hosts[i];
+    else if(i < hosts.size() + ports.size())
+      q.type = flow_index_port, q.value = ports[i - hosts.size()];
+    else
+      q.type = flow_index_l7proto, q.value = protos[i - hosts.size() - ports.size()];
+
+    if(!check(index, &q))
+      num_iteration_mismatches++;
+
+    num_iteration_lookups++;
+  }
+  gettimeofday(&end, NULL);
+  lookup_usec = elapsedUsec(&begin, &end);
+
+  for(std::vector<Flow*>::iterator it = flows.begin(); it != flows.end(); ++it)
+    if((*it)->getIndexLinks()) index->remove(*it);
+
+  delete index;
+
+  links_per_sec.add(rate(flows.size(), link_usec));
+  unlinks_per_sec.add(rate(unlinked.size(), unlink_usec));
+  lookups_per_sec.add(rate(num_iteration_lookups, lookup_usec));
+  num_lookups += num_iteration_lookups, num_mismatches += num_iteration_mismatches;
+
+  printf("  [%.2f Mlinks/s][%.2f Munlinks/s][%u lookups (checked against a scan of the flows)][%u mismatches]\n",
+	 rate(flows.size(), link_usec) / 1000000., rate(unlinked.size(), unlink_usec) / 1000000.,
+	 num_iteration_lookups, num_iteration_mismatches);
+
+  return(true);
+}
+
+/* ******************************************* */
+
+void FlowIndexBench::report() {
+  printRate("Links", "flows/s", &links_per_sec);
+  printRate("Unlinks", "flows/s", &unlinks_per_sec);
+  printRate("Checked lookups", "lookups/s", &lookups_per_sec);
+  printf("  %-24s %12llu\n", "Lookups", (unsigned long long)num_lookups);
+  printf("  %-24s %12llu\n", "Mismatches", (unsigned long long)num_mismatches);
+}
+
+#endif
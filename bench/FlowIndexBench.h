@@ -0,0 +1,64 @@
+/*
+ *
+ * (C) 2019 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+
+
+
+#ifndef _FLOW_INDEX_BENCH_H_
+#define _FLOW_INDEX_BENCH_H_
+
+#include "Benchmark.h"
+
+#ifndef HAVE_NEDGE
+
+/*
+  FlowIndex links, unlinks and lookups: the synthetic flows of a
+  DummyInterface share a few hosts, ports and L7 protocols, each of
+  them in both roles (client and server, application and master), and
+  are linked to a FlowIndex, partly unlinked and relinked. Every host,
+  port and protocol is then looked up and the flows found are checked
+  against a scan of the linked flows.
+*/
+class FlowIndexBench : public Benchmark {
+ private:
+  u_int32_t num_hosts, num_ports, num_flows, seed;
+  DummyInterface *iface;
+  std::vector<Flow*> flows;
+  std::vector<Host*> hosts;
+  std::vector<u_int16_t> ports, protos;
+  BenchmarkRate links_per_sec, unlinks_per_sec, lookups_per_sec;
+  u_int64_t num_lookups, num_mismatches;
+
+  DummyInterface* createInterface();
+  void fillFlows();
+  bool check(FlowIndex *index, const FlowIndexQuery *q);
+  bool setup();
+  bool runIteration(u_int32_t iteration);
+  void report();
+
+ public:
+  FlowIndexBench(int argc, char *argv[], u_int32_t _num_iterations);
+  ~FlowIndexBench();
+};
+
+#endif
+
+#endif /* _FLOW_INDEX_BENCH_H_ */
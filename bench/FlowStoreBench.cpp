@@ -0,0 +1,314 @@
+/*
+ *
+ * (C) 2019 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+
+
+
+#include "ntop_includes.h"
+#include "FlowStoreBench.h"
+
+#ifndef HAVE_NEDGE
+
+typedef struct {
+  u_int16_t ndpi_proto;
+  u_int8_t l4_proto;
+  u_int16_t srv_port;
+  u_int32_t avg_bytes;
+  u_int8_t weight;
+} FlowStoreBenchProto;
+
+static const FlowStoreBenchProto bench_protos[] = {
+  { NDPI_PROTOCOL_HTTP,    IPPROTO_TCP, 80,  20000, 25 },
+  { NDPI_PROTOCOL_SSL,     IPPROTO_TCP, 443, 50000, 40 },
+  { NDPI_PROTOCOL_DNS,     IPPROTO_UDP, 53,  200,   25 },
+  { NDPI_PROTOCOL_SSH,     IPPROTO_TCP, 22,  8000,  5  },
+  { NDPI_PROTOCOL_UNKNOWN, IPPROTO_UDP, 0,   1000,  5  }
+};
+
+/* ******************************************* */
+
+static inline u_int32_t nextRand(u_int32_t *seed) {
+  /* xorshift32 */
+  u_int32_t x = *seed;
+
+  x ^= x << 13, x ^= x >> 17, x ^= x << 5;
+  return(*seed = x);
+}
+
+/* ******************************************* */
+
+FlowStoreBench::FlowStoreBench(int argc, char *argv[], u_int32_t _num_iterations)
+  : Benchmark("flowstore", _num_iterations) {
+  int c;
+
+  num_rows = 10000000, num_hosts = 100000, span_secs = 86400, ipv6_pctg = 10, seed = 0x5eed1234;
+  snprintf(dir, sizeof(dir), "%s", FLOW_STORE_BENCH_DIR);
+  iface = NULL, db = NULL, ingest_usec = 0, num_queries = 0, num_lost_rows = 0;
+  begin_time = 0;
+
+  /* argv[0] is the benchmark name */
+  optind = 0;
+  while((c = getopt(argc, argv, "R:H:s:6:D:")) != -1) {
+    switch(c) {
+    case 'R': num_rows = atoi(optarg);   break;
+    case 'H': num_hosts = atoi(optarg);  break;
+    case 's': span_secs = atoi(optarg);  break;
+    case '6': ipv6_pctg = atoi(optarg);  break;
+    case 'D': snprintf(dir, sizeof(dir), "%s", optarg); break;
+    default:
+      num_rows = 0; /* setup() will fail */
+      break;
+    }
+  }
+}
+
+/* ******************************************* */
+
+FlowStoreBench::~FlowStoreBench() {
+  if(db) delete db;
+  if(iface) delete iface;
+}
+
+/* ******************************************* */
+
+/* Skewed host popularity: a few hosts make most of the flows */
+void FlowStoreBench::randomHost(u_int8_t *addr, bool server) {
+  u_int32_t r = nextRand(&seed) % num_hosts, id = (u_int32_t)(((u_int64_t)r * r) / num_hosts);
+  bool ipv6 = (id % 100) < ipv6_pctg;
+
+  if(server) id = (id % (num_hosts / 10 + 1)) + num_hosts;
+
+  if(ipv6) {
+    memset(addr, 0, 16);
+    addr[0] = 0x20, addr[1] = 0x01, addr[2] = 0x0d, addr[3] = 0xb8;
+    addr[12] = (id >> 24) & 0xFF, addr[13] = (id >> 16) & 0xFF, addr[14] = (id >> 8) & 0xFF, addr[15] = id & 0xFF;
+  } else {
+    IpAddress ip;
+
+    ip.set(htonl((server ? 0xC0A80000 /* 192.168.0.0 */ : 0x0A000000 /* 10.0.0.0 */) + (id & 0xFFFFFF)));
+    ColumnarFlowDB::setIP(addr, &ip);
+  }
+}
+
+/* ******************************************* */
+
+void FlowStoreBench::cleanDir() {
+  struct dirent *entry;
+  DIR *d;
+
+  if((d = opendir(dir)) == NULL)
+    return;
+
+  while((entry = readdir(d)) != NULL) {
+    const char *ext = strrchr(entry->d_name, '.');
+    char path[MAX_PATH];
+
+    if(ext && !strcmp(ext, ".cfs")) {
+      snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+      unlink(path);
+    }
+  }
+
+  closedir(d);
+}
+
+/* ******************************************* */
+
+FlowStoreBenchQuery* FlowStoreBench::addQuery(const char *label, FlowStoreGroupBy group_by) {
+  FlowStoreBenchQuery *bq;
+
+  if(num_queries >= MAX_FLOW_STORE_BENCH_QUERIES)
+    return(NULL);
+
+  bq = &queries[num_queries++];
+  bq->label = label, bq->usec = 0, bq->num_results = 0;
+  memset(&bq->stats, 0, sizeof(bq->stats));
+  memset(&bq->q, 0, sizeof(bq->q));
+  bq->q.begin = begin_time, bq->q.end = begin_time + span_secs;
+  bq->q.port = bq->q.l4_proto = bq->q.l7_proto = bq->q.vlan_id = -1;
+  bq->q.group_by = group_by, bq->q.sort = flow_store_sort_bytes, bq->q.limit = 10;
+
+  return(bq);
+}
+
+/* ******************************************* */
+
+/* Rows are written in time order, as flows are dumped */
+bool FlowStoreBench::ingest() {
+  struct timeval begin, end;
+  u_int32_t tot_weight = 0;
+
+  for(u_int i = 0; i < sizeof(bench_protos) / sizeof(bench_protos[0]); i++)
+    tot_weight += bench_protos[i].weight;
+
+  gettimeofday(&begin, NULL);
+
+  for(u_int32_t i = 0; i < num_rows; i++) {
+    const FlowStoreBenchProto *p = &bench_protos[0];
+    u_int32_t w = nextRand(&seed) % tot_weight, duration = nextRand(&seed) % 60;
+    FlowStoreRow r;
+
+    for(u_int j = 0; j < sizeof(bench_protos) / sizeof(bench_protos[0]); j++) {
+      if(w < bench_protos[j].weight) { p = &bench_protos[j]; break; }
+      w -= bench_protos[j].weight;
+    }
+
+    randomHost(r.cli_ip, false), randomHost(r.srv_ip, true);
+    r.last_seen = begin_time + (u_int32_t)(((u_int64_t)i * span_secs) / num_rows);
+    r.first_seen = r.last_seen - duration;
+    r.cli_port = 1024 + nextRand(&seed) % 64000;
+    r.srv_port = p->srv_port ? p->srv_port : (1024 + nextRand(&seed) % 64000);
+    r.vlan_id = 0, r.l4_proto = p->l4_proto, r.l7_proto = p->ndpi_proto;
+    r.cli2srv_bytes = 64 + nextRand(&seed) % (p->avg_bytes / 4 + 1);
+    r.srv2cli_bytes = 64 + nextRand(&seed) % (2 * p->avg_bytes);
+    r.cli2srv_packets = 1 + r.cli2srv_bytes / 1000, r.srv2cli_packets = 1 + r.srv2cli_bytes / 1000;
+
+    /* Never drop rows because of the benchmark itself outpacing the writer */
+    while(db->getNumPendingChunks() >= FLOW_STORE_MAX_QUEUED_CHUNKS - 1)
+      _usleep(1000);
+
+    if(!db->addRow(&r))
+      return(false);
+  }
+
+  db->sync();
+
+  gettimeofday(&end, NULL);
+  ingest_usec = elapsedUsec(&begin, &end);
+
+  return(true);
+}
+
+/* ******************************************* */
+
+bool FlowStoreBench::setup() {
+  FlowStoreBenchQuery *bq;
+  char buf[32];
+
+  if((num_rows == 0) || (num_hosts < 10) || (span_secs == 0) || (ipv6_pctg > 100)) {
+    ntop->getTrace()->traceEvent(TRACE_ERROR, "[%s] Invalid options", name);
+    return(false);
+  }
+
+  try {
+    iface = new DummyInterface();
+    Utils::mkdir_tree(dir);
+    cleanDir();
+    db = new ColumnarFlowDB(iface, dir);
+  } catch(...) {
+    db = NULL;
+  }
+
+  if(db == NULL) {
+    ntop->getTrace()->traceEvent(TRACE_ERROR, "[%s] Unable to create the flow store", name);
+    return(false);
+  }
+
+  /* Recent enough not to be removed by the retention */
+  begin_time = time(NULL) - span_secs;
+  begin_time -= begin_time % FLOW_STORE_PARTITION_SECS;
+
+  printf("[%s] Writing %u flows [%u hosts][%u sec][%u %% IPv6] to %s\n",
+	 name, num_rows, num_hosts, span_secs, ipv6_pctg, dir);
+
+  if(!ingest())
+    return(false);
+
+  printf("[%s] Written %sflows/s [%.1f bytes/flow on disk][%u flows lost]\n", name,
+	 formatRate(rate(db->getNumExportedFlows(), ingest_usec), buf, sizeof(buf)),
+	 db->getNumExportedFlows() ? (float)db->getNumWrittenBytes() / db->getNumExportedFlows() : 0,
+	 db->getNumDroppedFlows());
+
+  addQuery("Total", flow_store_group_none);
+  addQuery("Top hosts", flow_store_group_host);
+  addQuery("Top server ports", flow_store_group_dst_port);
+  addQuery("Top L7 protocols", flow_store_group_l7_proto);
+  addQuery("Top conversations", flow_store_group_conversations);
+
+  if((bq = addQuery("Host top ports", flow_store_group_port)) != NULL) {
+    IpAddress ip;
+
+    ip.set(htonl(0x0A000063)); /* 10.0.0.99, among the busiest clients */
+    ColumnarFlowDB::setIP(bq->q.host, &ip);
+    bq->q.has_host = true;
+  }
+
+  if((bq = addQuery("DNS top clients", flow_store_group_src_host)) != NULL)
+    bq->q.l7_proto = NDPI_PROTOCOL_DNS;
+
+  if((bq = addQuery("SSH flows", flow_store_group_none)) != NULL)
+    bq->q.port = 22, bq->q.l4_proto = IPPROTO_TCP;
+
+  if((bq = addQuery("Last hour top hosts", flow_store_group_host)) != NULL)
+    bq->q.begin = bq->q.end - 3600;
+
+  return(true);
+}
+
+/* ******************************************* */
+
+bool FlowStoreBench::runIteration(u_int32_t iteration) {
+  printf("[%s] Iteration %u\n", name, iteration + 1);
+
+  for(u_int32_t i = 0; i < num_queries; i++) {
+    FlowStoreBenchQuery *bq = &queries[i];
+    std::vector<FlowStoreResult> results;
+    struct timeval begin, end;
+    char buf[32];
+
+    gettimeofday(&begin, NULL);
+    if(!db->query(&bq->q, &results, &bq->stats))
+      return(false);
+    gettimeofday(&end, NULL);
+
+    bq->usec = elapsedUsec(&begin, &end), bq->num_results = results.size();
+    bq->rows_per_sec.add(rate(bq->stats.rows_scanned, bq->usec));
+
+    /* Every row of the span must be found */
+    if((iteration == 0) && (i == 0))
+      num_lost_rows = num_rows - (results.empty() ? 0 : results[0].flows);
+
+    printf("  %-22s %10.1f ms %14sflows/s [%u/%u chunks skipped][%llu matches][%u results]\n",
+	   bq->label, bq->usec / 1000.,
+	   formatRate(rate(bq->stats.rows_scanned, bq->usec), buf, sizeof(buf)),
+	   bq->stats.chunks_skipped, bq->stats.chunks,
+	   (unsigned long long)bq->stats.rows_matched, bq->num_results);
+  }
+
+  return(true);
+}
+
+/* ******************************************* */
+
+void FlowStoreBench::report() {
+  char buf[32];
+
+  printf("  %-24s %12sflows/s\n", "Ingestion", formatRate(rate(db->getNumExportedFlows(), ingest_usec), buf, sizeof(buf)));
+  printf("  %-24s %12.1f bytes\n", "Disk per flow",
+	 db->getNumExportedFlows() ? (float)db->getNumWrittenBytes() / db->getNumExportedFlows() : 0);
+
+  for(u_int32_t i = 0; i < num_queries; i++)
+    printRate(queries[i].label, "flows/s", &queries[i].rows_per_sec);
+
+  printf("  %-24s %12llu\n", "Lost flows", (unsigned long long)num_lost_rows);
+}
+
+#endif
@@ -0,0 +1,78 @@
+/*
+ *
+ * (C) 2019 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+
+
+
+#ifndef _FLOW_STORE_BENCH_H_
+#define _FLOW_STORE_BENCH_H_
+
+#include "Benchmark.h"
+
+#define FLOW_STORE_BENCH_DIR "/tmp/ntopng-flowstore-bench"
+
+#ifndef HAVE_NEDGE
+
+#define MAX_FLOW_STORE_BENCH_QUERIES 16
+
+typedef struct {
+  const char *label;
+  FlowStoreQuery q;
+  BenchmarkRate rows_per_sec;
+  float usec;
+  FlowStoreQueryStats stats;
+  u_int32_t num_results;
+} FlowStoreBenchQuery;
+
+/*
+  Columnar flow store benchmark: synthetic flows spread over a time
+  span are written to a ColumnarFlowDB, then a set of top-N and
+  filtered queries, as issued by the historical flows pages, is run
+  against the resulting partitions.
+*/
+class FlowStoreBench : public Benchmark {
+ private:
+  u_int32_t num_rows, num_hosts, span_secs, ipv6_pctg, seed;
+  char dir[MAX_PATH];
+  time_t begin_time;
+  DummyInterface *iface;
+  ColumnarFlowDB *db;
+  float ingest_usec;
+  FlowStoreBenchQuery queries[MAX_FLOW_STORE_BENCH_QUERIES];
+  u_int32_t num_queries;
+  u_int64_t num_lost_rows;
+
+  FlowStoreBenchQuery* addQuery(const char *label, FlowStoreGroupBy group_by);
+  void randomHost(u_int8_t *addr, bool server);
+  void cleanDir();
+  bool ingest();
+  bool setup();
+  bool runIteration(u_int32_t iteration);
+  void report();
+
+ public:
+  FlowStoreBench(int argc, char *argv[], u_int32_t _num_iterations);
+  ~FlowStoreBench();
+};
+
+#endif
+
+#endif /* _FLOW_STORE_BENCH_H_ */
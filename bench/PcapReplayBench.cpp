@@ -0,0 +1,204 @@
+/*
+ *
+ * (C) 2019 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+
+#include "PcapReplayBench.h"
+
+#ifndef PROFILING
+#error "ntopng-bench must be compiled with -DPROFILING (use 'make bench')"
+#endif
+
+/* Profiling sections of NetworkInterface (see NetworkInterface.cpp) */
+#define SECTION_PROCESS_PACKET    0
+#define SECTION_GET_FLOW          1
+#define SECTION_FLOW_INC_STATS    2
+#define SECTION_NDPI_DETECTION    3
+#define SECTION_IFACE_INC_STATS   4
+
+/* ******************************************* */
+
+PcapReplayBench::PcapReplayBench(const char *_pcap_path, u_int32_t _num_iterations)
+  : Benchmark("pcap", _num_iterations) {
+  pcap_path = strdup(_pcap_path);
+  pkts = NULL, pkts_len = num_pkts = num_bytes = 0;
+  tot_dissect_ticks = 0;
+  memset(tot_stage_ticks, 0, sizeof(tot_stage_ticks));
+  memset(stage_labels, 0, sizeof(stage_labels));
+}
+
+/* ******************************************* */
+
+PcapReplayBench::~PcapReplayBench() {
+  if(pkts) free(pkts);
+  if(pcap_path) free(pcap_path);
+}
+
+/* ******************************************* */
+
+bool PcapReplayBench::setup() {
+  char pcap_error_buffer[PCAP_ERRBUF_SIZE];
+  struct pcap_pkthdr *hdr;
+  const u_char *pkt;
+  u_int64_t pkts_size = 0;
+  pcap_t *pd;
+  int rc;
+
+  if((pd = pcap_open_offline(pcap_path, pcap_error_buffer)) == NULL) {
+    ntop->getTrace()->traceEvent(TRACE_ERROR, "Unable to open %s: %s", pcap_path, pcap_error_buffer);
+    return(false);
+  }
+
+  while((rc = pcap_next_ex(pd, &hdr, &pkt)) > 0) {
+    u_int32_t slot_len = (sizeof(struct pcap_pkthdr) + hdr->caplen + 7) & ~7;
+
+    if(pkts_len + slot_len > pkts_size) {
+      u_char *p;
+
+      pkts_size = max_val(pkts_size * 2, 1048576);
+      if((p = (u_char*)realloc(pkts, pkts_size)) == NULL) {
+	ntop->getTrace()->traceEvent(TRACE_ERROR, "Not enough memory to preload %s", pcap_path);
+	pcap_close(pd);
+	return(false);
+      }
+
+      pkts = p;
+    }
+
+    memcpy(&pkts[pkts_len], hdr, sizeof(struct pcap_pkthdr));
+    memcpy(&pkts[pkts_len + sizeof(struct pcap_pkthdr)], pkt, hdr->caplen);
+    pkts_len += slot_len, num_pkts++, num_bytes += hdr->len;
+  }
+
+  pcap_close(pd);
+
+  if(num_pkts == 0) {
+    ntop->getTrace()->traceEvent(TRACE_ERROR, "No packets found in %s", pcap_path);
+    return(false);
+  }
+
+  printf("[%s] Preloaded %llu packets (%llu bytes) from %s\n", name,
+	 (unsigned long long)num_pkts, (unsigned long long)num_bytes, pcap_path);
+
+  return(true);
+}
+
+/* ******************************************* */
+
+bool PcapReplayBench::runIteration(u_int32_t iteration) {
+  PcapInterface *iface;
+  struct timeval begin, end;
+  ticks dissect_ticks = 0;
+  u_int32_t num_flows, num_hosts;
+  float usec;
+
+  try {
+    iface = new PcapInterface(pcap_path);
+  } catch(...) {
+    ntop->getTrace()->traceEvent(TRACE_ERROR, "Unable to create the interface for %s", pcap_path);
+    return(false);
+  }
+
+  gettimeofday(&begin, NULL);
+
+  for(u_int64_t offset = 0; offset < pkts_len; ) {
+    struct pcap_pkthdr h;
+    const u_char *pkt = &pkts[offset + sizeof(struct pcap_pkthdr)];
+    Host *srcHost = NULL, *dstHost = NULL;
+    Flow *flow = NULL;
+    u_int16_t p;
+    ticks t;
+
+    memcpy(&h, &pkts[offset], sizeof(h));
+    offset += (sizeof(struct pcap_pkthdr) + h.caplen + 7) & ~7;
+
+    h.caplen = min_val(h.caplen, iface->getMTU());
+
+    t = Utils::getticks();
+    iface->dissectPacket(DUMMY_BRIDGE_INTERFACE_ID, true /* ingress */,
+			 NULL, &h, pkt, &p, &srcHost, &dstHost, &flow);
+    dissect_ticks += Utils::getticks() - t;
+  }
+
+  gettimeofday(&end, NULL);
+  usec = elapsedUsec(&begin, &end);
+
+  /* Idle purge is disabled when reading from pcap dumps, hence hash sizes are the totals */
+  num_flows = iface->getFlowsHashSize(), num_hosts = iface->getHostsHashSize();
+
+  pps.add(rate(num_pkts, usec)), bps.add(rate(num_bytes * 8, usec));
+  fps.add(rate(num_flows, usec)), hps.add(rate(num_hosts, usec));
+
+  tot_dissect_ticks += dissect_ticks;
+  for(u_int i = 0; i < min_val(iface->profiling_num_sections(), PROFILING_MAX_NUM_SECTIONS); i++) {
+    tot_stage_ticks[i] += iface->profiling_section_ticks(i);
+    if(iface->profiling_section_label(i)) stage_labels[i] = iface->profiling_section_label(i);
+  }
+
+  printf("[%s] Iteration %u/%u: %.3f sec [%.2f Kpps][%.2f Mbps][%u flows][%u hosts][%llu cycles/pkt]\n",
+	 name, iteration + 1, num_iterations, usec / 1000000.,
+	 rate(num_pkts, usec) / 1000., rate(num_bytes * 8, usec) / 1000000.,
+	 num_flows, num_hosts, (unsigned long long)(dissect_ticks / num_pkts));
+
+  delete iface;
+
+  return(true);
+}
+
+/* ******************************************* */
+
+void PcapReplayBench::report() {
+  u_int64_t tot_pkts = num_pkts * num_iterations;
+  ticks decode, stats, other;
+  struct {
+    const char *label;
+    ticks t;
+  } stages[5];
+
+  printRate("Packets", "pps", &pps);
+  printRate("Throughput", "bps", &bps);
+  printRate("Flows", "flows/s", &fps);
+  printRate("Hosts", "hosts/s", &hps);
+
+  /* Decode is whatever dissectPacket does outside of processPacket */
+  decode = tot_dissect_ticks - min_val(tot_dissect_ticks, tot_stage_ticks[SECTION_PROCESS_PACKET]);
+  stats  = tot_stage_ticks[SECTION_FLOW_INC_STATS] + tot_stage_ticks[SECTION_IFACE_INC_STATS];
+  other  = tot_stage_ticks[SECTION_PROCESS_PACKET];
+  other -= min_val(other, tot_stage_ticks[SECTION_GET_FLOW] + tot_stage_ticks[SECTION_NDPI_DETECTION] + stats);
+
+  stages[0].label = "Decode",       stages[0].t = decode;
+  stages[1].label = "Flow lookup",  stages[1].t = tot_stage_ticks[SECTION_GET_FLOW];
+  stages[2].label = "nDPI",         stages[2].t = tot_stage_ticks[SECTION_NDPI_DETECTION];
+  stages[3].label = "Stats update", stages[3].t = stats;
+  stages[4].label = "Other",        stages[4].t = other;
+
+  printf("\n  Per-stage cycles/pkt (total %llu)\n", (unsigned long long)(tot_dissect_ticks / tot_pkts));
+  for(u_int i = 0; i < sizeof(stages) / sizeof(stages[0]); i++)
+    printf("  %-24s %12llu [%5.1f %%]\n", stages[i].label,
+	   (unsigned long long)(stages[i].t / tot_pkts),
+	   tot_dissect_ticks ? (stages[i].t * 100.) / tot_dissect_ticks : 0);
+
+  printf("\n  Profiling sections cycles/pkt\n");
+  for(u_int i = 0; i < PROFILING_MAX_NUM_SECTIONS; i++) {
+    if(stage_labels[i])
+      printf("  #%-2u %-60s %12llu\n", i, stage_labels[i],
+	     (unsigned long long)(tot_stage_ticks[i] / tot_pkts));
+  }
+}
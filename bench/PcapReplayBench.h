@@ -0,0 +1,53 @@
+/*
+ *
+ * (C) 2019 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+
+#ifndef _PCAP_REPLAY_BENCH_H_
+#define _PCAP_REPLAY_BENCH_H_
+
+#include "Benchmark.h"
+
+/*
+  Replays a pcap file through PcapInterface::dissectPacket as fast
+  as possible: packets are preloaded in memory so that disk I/O and
+  pcap parsing do not skew the numbers, and a brand new interface
+  is used for every iteration so that each run starts with empty
+  flow/host tables.
+*/
+class PcapReplayBench : public Benchmark {
+ private:
+  char *pcap_path;
+  u_char *pkts;        /* Preloaded packets: [struct pcap_pkthdr][caplen bytes] (8-byte aligned) */
+  u_int64_t pkts_len, num_pkts, num_bytes;
+  BenchmarkRate pps, bps, fps, hps;
+  ticks tot_dissect_ticks, tot_stage_ticks[PROFILING_MAX_NUM_SECTIONS];
+  const char *stage_labels[PROFILING_MAX_NUM_SECTIONS];
+
+  bool setup();
+  bool runIteration(u_int32_t iteration);
+  void report();
+
+ public:
+  PcapReplayBench(const char *_pcap_path, u_int32_t _num_iterations);
+  ~PcapReplayBench();
+};
+
+#endif /* _PCAP_REPLAY_BENCH_H_ */
@@ -0,0 +1,335 @@
+/*
+ *
+ * (C) 2019 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+
+
+
+#include "ntop_includes.h"
+#include "WalkerFilterBench.h"
+
+#ifndef HAVE_NEDGE
+
+typedef struct {
+  WalkerFilter *filter;
+  Paginator *pag;
+  u_int64_t num_matches;
+} WalkerFilterBenchScan;
+
+/* ******************************************* */
+
+static inline u_int32_t nextRand(u_int32_t *seed) {
+  u_int32_t x = *seed;
+
+  x ^= x << 13, x ^= x >> 17, x ^= x << 5;
+  return(*seed = x);
+}
+
+/* ******************************************* */
+
+WalkerFilterBench::WalkerFilterBench(int argc, char *argv[], u_int32_t _num_iterations)
+  : Benchmark("filter", _num_iterations) {
+  char buf[128];
+  int c;
+
+  num_hosts = 10000, num_flows = 100000, num_scans = 10;
+  iface = NULL, num_queries = 0, num_mismatches = 0;
+  memset(queries, 0, sizeof(queries));
+
+  /* Typical combinations of the flows page filters */
+  addQuery("none", "");
+  snprintf(buf, sizeof(buf), "l7protoFilter=%u", NDPI_PROTOCOL_HTTP);
+  addQuery("application", buf);
+  addQuery("port", "portFilter=443");
+  addQuery("vlan + port", "vlanIdFilter=20&portFilter=53");
+  addQuery("local to remote", "clientMode=local&serverMode=remote");
+  addQuery("one-way", "unidirectional=true");
+  addQuery("alerted", "alertedFlows=true");
+  snprintf(buf, sizeof(buf), "l7protoFilter=%u&clientMode=local&unidirectional=false", NDPI_PROTOCOL_SSL);
+  addQuery("app + local + two-way", buf);
+
+  /* argv[0] is the benchmark name */
+  optind = 0;
+  while((c = getopt(argc, argv, "H:F:S:q:")) != -1) {
+    switch(c) {
+    case 'H': num_hosts = atoi(optarg); break;
+    case 'F': num_flows = atoi(optarg); break;
+    case 'S': num_scans = atoi(optarg); break;
+    case 'q': addQuery(optarg, optarg); break;
+    default:
+      num_flows = 0; /* setup() will fail */
+      break;
+    }
+  }
+}
+
+/* ******************************************* */
+
+WalkerFilterBench::~WalkerFilterBench() {
+  for(u_int32_t i = 0; i < num_queries; i++) {
+    if(queries[i].pag)   delete queries[i].pag;
+    if(queries[i].query) free(queries[i].query);
+  }
+
+  if(iface) delete iface;
+}
+
+/* ******************************************* */
+
+bool WalkerFilterBench::addQuery(const char *label, const char *query) {
+  WalkerFilterBenchQuery *q;
+
+  if(num_queries >= MAX_WALKER_FILTER_BENCH_QUERIES)
+    return(false);
+
+  q = &queries[num_queries];
+
+  if(((q->query = strdup(query)) == NULL)
+     || ((q->pag = new(std::nothrow) Paginator()) == NULL)) {
+    if(q->query) free(q->query), q->query = NULL;
+    return(false);
+  }
+
+  q->label = label;
+  q->pag->readOptions(q->query);
+  num_queries++;
+
+  return(true);
+}
+
+/* ******************************************* */
+
+/*
+  Half of the hosts are in 192.168.0.0/16 (local when ntopng is
+  started with -m 192.168.0.0/16), the other half in 10.0.0.0/8. A
+  tenth of the flows is one-way, flows are spread on 4 VLANs.
+*/
+void WalkerFilterBench::fillFlows() {
+  static const struct { u_int16_t ndpi_proto; u_int8_t l4_proto; u_int16_t port; } protos[] = {
+    { NDPI_PROTOCOL_HTTP, IPPROTO_TCP, 80 }, { NDPI_PROTOCOL_SSL, IPPROTO_TCP, 443 },
+    { NDPI_PROTOCOL_DNS, IPPROTO_UDP, 53 },  { NDPI_PROTOCOL_UNKNOWN, IPPROTO_UDP, 5000 }
+  };
+  json_object *additional_fields = json_object_new_object();
+  u_int32_t seed = 0x9E3779B9, now = (u_int32_t)time(NULL);
+  ZMQ_Flow zflow;
+
+  for(u_int32_t i = 0; i < num_flows; i++) {
+    u_int32_t src = nextRand(&seed) % num_hosts, dst = nextRand(&seed) % num_hosts;
+    u_int32_t p = nextRand(&seed) % 4, pkts = 1 + (nextRand(&seed) % 16);
+
+    memset(&zflow, 0, sizeof(zflow));
+    zflow.core.src_ip.set(htonl(((src & 1) ? 0xC0A80000 : 0x0A000000) + src));
+    zflow.core.dst_ip.set(htonl(((dst & 1) ? 0xC0A80000 : 0x0A000000) + dst));
+    zflow.core.src_port = htons(1024 + (i % 60000));
+    zflow.core.dst_port = htons(protos[p].port);
+    zflow.core.l4_proto = protos[p].l4_proto;
+    zflow.core.l7_proto.app_protocol = protos[p].ndpi_proto;
+    zflow.core.vlan_id = (i % 4) * 10;
+    zflow.core.pkt_sampling_rate = 1;
+    zflow.core.in_pkts = pkts, zflow.core.in_bytes = pkts * 100;
+    zflow.core.out_pkts = ((i % 10) == 0) ? 0 : pkts, zflow.core.out_bytes = zflow.core.out_pkts * 800;
+    zflow.core.first_switched = now, zflow.core.last_switched = now;
+    zflow.core.source_id = 1;
+    zflow.additional_fields = additional_fields;
+
+    iface->processFlow(&zflow);
+  }
+
+  json_object_put(additional_fields);
+}
+
+/* ******************************************* */
+
+/* The flows filter as evaluated before the WalkerFilter: the Paginator is queried for every flow */
+static bool paginator_match(Flow *f, Paginator *pag) {
+  int ndpi_proto;
+  u_int16_t port, vlan_id;
+  LocationPolicy client_policy, server_policy;
+  bool unidirectional, alerted_flows;
+
+  if(pag->l7protoFilter(&ndpi_proto)
+     && ((ndpi_proto == NDPI_PROTOCOL_UNKNOWN
+	  && (f->get_detected_protocol().app_protocol != ndpi_proto
+	      || f->get_detected_protocol().master_protocol != ndpi_proto))
+	 || (ndpi_proto != NDPI_PROTOCOL_UNKNOWN
+	     && (f->get_detected_protocol().app_protocol != ndpi_proto
+		 && f->get_detected_protocol().master_protocol != ndpi_proto))))
+    return(false);
+
+  if(pag->portFilter(&port) && f->get_cli_port() != port && f->get_srv_port() != port)
+    return(false);
+
+  if(pag->vlanIdFilter(&vlan_id) && f->get_vlan_id() != vlan_id)
+    return(false);
+
+  if(pag->clientMode(&client_policy) && f->get_cli_host()
+     && (((client_policy == location_local_only) && (!f->get_cli_host()->isLocalHost()))
+	 || ((client_policy == location_remote_only) && (f->get_cli_host()->isLocalHost()))))
+    return(false);
+
+  if(pag->serverMode(&server_policy) && f->get_srv_host()
+     && (((server_policy == location_local_only) && (!f->get_srv_host()->isLocalHost()))
+	 || ((server_policy == location_remote_only) && (f->get_srv_host()->isLocalHost()))))
+    return(false);
+
+  if(pag->alertedFlows(&alerted_flows)
+     && ((alerted_flows && f->getFlowStatus() == status_normal)
+	 || (!alerted_flows && f->getFlowStatus() != status_normal)))
+    return(false);
+
+  if(pag->unidirectionalTraffic(&unidirectional)
+     && ((unidirectional && (f->get_packets() > 0) && (f->get_packets_cli2srv() > 0) && (f->get_packets_srv2cli() > 0))
+	 || (!unidirectional && (f->get_packets() > 0) && ((f->get_packets_cli2srv() == 0) || (f->get_packets_srv2cli() == 0)))))
+    return(false);
+
+  return(true);
+}
+
+/* ******************************************* */
+
+static bool compiled_scan_walker(GenericHashEntry *h, void *user_data, bool *matched) {
+  WalkerFilterBenchScan *s = (WalkerFilterBenchScan*)user_data;
+  Flow *f = (Flow*)h;
+
+  if(!f->idle() && s->filter->matchFlow(f))
+    s->num_matches++, *matched = true;
+
+  return(false); /* false = keep on walking */
+}
+
+/* ******************************************* */
+
+static bool paginator_scan_walker(GenericHashEntry *h, void *user_data, bool *matched) {
+  WalkerFilterBenchScan *s = (WalkerFilterBenchScan*)user_data;
+  Flow *f = (Flow*)h;
+
+  if(!f->idle() && paginator_match(f, s->pag))
+    s->num_matches++, *matched = true;
+
+  return(false); /* false = keep on walking */
+}
+
+/* ******************************************* */
+
+/* Scans the flows table num_scans times: returns the number of flows matched by the last scan */
+u_int64_t WalkerFilterBench::scan(WalkerFilterBenchQuery *q, bool compiled, float *usec) {
+  WalkerFilter filter;
+  WalkerFilterBenchScan s;
+  struct timeval begin, end;
+
+  gettimeofday(&begin, NULL);
+
+  for(u_int32_t i = 0; i < num_scans; i++) {
+    u_int32_t begin_slot = 0;
+
+    if(compiled)
+      filter.compileFlowFilter(q->pag, NULL); /* Once per query as the flows page does */
+
+    s.filter = &filter, s.pag = q->pag, s.num_matches = 0;
+    iface->walker(&begin_slot, true /* walk_all */, walker_flows,
+		  compiled ? compiled_scan_walker : paginator_scan_walker, &s);
+  }
+
+  gettimeofday(&end, NULL);
+  *usec = elapsedUsec(&begin, &end);
+
+  return(s.num_matches);
+}
+
+/* ******************************************* */
+
+bool WalkerFilterBench::setup() {
+  u_int32_t num_custom = 0;
+
+  if((num_flows == 0) || (num_hosts < 2) || (num_scans == 0)) {
+    ntop->getTrace()->traceEvent(TRACE_ERROR, "[%s] Invalid options", name);
+    return(false);
+  }
+
+  try {
+    iface = new DummyInterface();
+  } catch(...) {
+    iface = NULL;
+  }
+
+  if(iface == NULL) {
+    ntop->getTrace()->traceEvent(TRACE_ERROR, "[%s] Unable to create the interface", name);
+    return(false);
+  }
+
+  fillFlows();
+
+  for(u_int32_t i = 0; i < num_queries; i++)
+    if(queries[i].label == queries[i].query) num_custom++;
+
+  printf("[%s] [%u hosts][%u flows in the table][%u queries (%u custom)][%u scans per query]\n",
+	 name, num_hosts, iface->getNumFlows(), num_queries, num_custom, num_scans);
+
+  if(iface->getNumFlows() < num_flows)
+    ntop->getTrace()->traceEvent(TRACE_WARNING, "[%s] Flows table too small: use -X to hold all the flows", name);
+
+  return(true);
+}
+
+/* ******************************************* */
+
+bool WalkerFilterBench::runIteration(u_int32_t iteration) {
+  u_int32_t num_table_flows = iface->getNumFlows();
+
+  printf("[%s] Iteration %u/%u\n", name, iteration + 1, num_iterations);
+
+  for(u_int32_t i = 0; i < num_queries; i++) {
+    WalkerFilterBenchQuery *q = &queries[i];
+    float compiled_usec, paginator_usec;
+    u_int64_t compiled_matches, paginator_matches;
+
+    compiled_matches = scan(q, true, &compiled_usec);
+    paginator_matches = scan(q, false, &paginator_usec);
+
+    /* Custom queries may use filters not evaluated by paginator_match */
+    if((compiled_matches != paginator_matches) && (q->label != q->query))
+      num_mismatches++;
+
+    q->num_matches = compiled_matches;
+    q->compiled_fps.add(rate((u_int64_t)num_table_flows * num_scans, compiled_usec));
+    q->paginator_fps.add(rate((u_int64_t)num_table_flows * num_scans, paginator_usec));
+
+    printf("  %-24s [%llu matches][compiled %.2f Mflows/s][paginator %.2f Mflows/s]\n",
+	   q->label, (unsigned long long)compiled_matches,
+	   rate((u_int64_t)num_table_flows * num_scans, compiled_usec) / 1000000.,
+	   rate((u_int64_t)num_table_flows * num_scans, paginator_usec) / 1000000.);
+  }
+
+  return(true);
+}
+
+/* ******************************************* */
+
+void WalkerFilterBench::report() {
+  for(u_int32_t i = 0; i < num_queries; i++) {
+    printf("  %s [%llu matches]\n", queries[i].label, (unsigned long long)queries[i].num_matches);
+    printRate("  compiled", "flows/s", &queries[i].compiled_fps);
+    printRate("  paginator", "flows/s", &queries[i].paginator_fps);
+  }
+
+  printf("  %-24s %12llu\n", "Mismatches", (unsigned long long)num_mismatches);
+}
+
+#endif
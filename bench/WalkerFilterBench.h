@@ -0,0 +1,71 @@
+/*
+ *
+ * (C) 2019 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+
+
+
+#ifndef _WALKER_FILTER_BENCH_H_
+#define _WALKER_FILTER_BENCH_H_
+
+#include "Benchmark.h"
+
+#ifndef HAVE_NEDGE
+
+#define MAX_WALKER_FILTER_BENCH_QUERIES 16
+
+/* A GUI-like flows filter, as passed to the Paginator */
+typedef struct {
+  const char *label;
+  char *query;
+  Paginator *pag;
+  BenchmarkRate compiled_fps, paginator_fps;
+  u_int64_t num_matches;
+} WalkerFilterBenchQuery;
+
+/*
+  Flows table scans with the filters of the flows page: a
+  DummyInterface is filled with synthetic flows and walked with each
+  filter, evaluated both with the compiled WalkerFilter and by
+  querying the Paginator for every flow as the walkers used to do.
+*/
+class WalkerFilterBench : public Benchmark {
+ private:
+  u_int32_t num_hosts, num_flows, num_scans;
+  DummyInterface *iface;
+  WalkerFilterBenchQuery queries[MAX_WALKER_FILTER_BENCH_QUERIES];
+  u_int32_t num_queries;
+  u_int64_t num_mismatches;
+
+  bool addQuery(const char *label, const char *query);
+  void fillFlows();
+  u_int64_t scan(WalkerFilterBenchQuery *q, bool compiled, float *usec);
+  bool setup();
+  bool runIteration(u_int32_t iteration);
+  void report();
+
+ public:
+  WalkerFilterBench(int argc, char *argv[], u_int32_t _num_iterations);
+  ~WalkerFilterBench();
+};
+
+#endif
+
+#endif /* _WALKER_FILTER_BENCH_H_ */
@@ -0,0 +1,177 @@
+/*
+ *
+ * (C) 2019 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+
+#include "ntop_includes.h"
+#include "PcapReplayBench.h"
+#include "FlowGeneratorBench.h"
+#include "AddressTreeBench.h"
+#include "WalkerFilterBench.h"
+#include "FlowStoreBench.h"
+#include "FlowIndexBench.h"
+
+/*
+  ntopng-bench: headless ntopng used to measure the performance of the
+  packet/flow processing engine without the web server, Lua and the
+  periodic activities. Build it with 'make bench'.
+*/
+
+AfterShutdownAction afterShutdownAction = after_shutdown_nop;
+
+/* ******************************** */
+
+static void bench_usage() {
+  printf("Usage:\n"
+	 "  ntopng-bench [-n <iterations>] <benchmark> <args> [-- <ntopng options>]\n\n"
+	 "Benchmarks:\n"
+	 "  pcap <file.pcap>           Replay a pcap file as fast as possible\n"
+	 "  flows [options]            Inject synthetic flows into collector interfaces\n"
+	 "    -t <threads>             Generator threads (one interface each) [default: 1]\n"
+	 "    -H <hosts>               Host cardinality per interface [default: 10000]\n"
+	 "    -F <flows>               Active flows (all threads) [default: 20000]\n"
+	 "    -c <percentage>          Flow churn (new flows per record) [default: 10]\n"
+	 "    -6 <percentage>          IPv6 flows [default: 10]\n"
+	 "    -p <proto:weight,...>    Protocol mix (http, ssl, dns, ssh, quic, unknown)\n"
+	 "                             [default: http:30,ssl:40,dns:20,unknown:10]\n"
+	 "    -r <records>             Records per (virtual) second per thread [default: 5000]\n"
+	 "    -d <sec>                 Duration of each iteration [default: 10]\n"
+	 "    -w <sec>                 Warmup excluded from the rates [default: 3]\n"
+	 "  lpm [options]              Local networks/host pools prefix lookups\n"
+	 "    -P <prefixes>            Number of random prefixes [default: 10000]\n"
+	 "    -L <lookups>             Lookups per iteration [default: 10000000]\n"
+	 "    -6 <percentage>          IPv6 prefixes and lookups [default: 20]\n"
+	 "  filter [options]           Flows table scans with the flows page filters\n"
+	 "    -H <hosts>               Host cardinality [default: 10000]\n"
+	 "    -F <flows>               Flows in the table [default: 100000]\n"
+	 "    -S <scans>               Table scans per filter and iteration [default: 10]\n"
+	 "    -q <query>               Additional filter (e.g. \"portFilter=80&vlanIdFilter=10\")\n"
+	 "  flowstore [options]        Columnar flow store ingestion and queries\n"
+	 "    -R <flows>               Flows to write [default: 10000000]\n"
+	 "    -H <hosts>               Client host cardinality [default: 100000]\n"
+	 "    -s <sec>                 Time span of the flows [default: 86400]\n"
+	 "    -6 <percentage>          IPv6 hosts [default: 10]\n"
+	 "    -D <dir>                 Store directory [default: " FLOW_STORE_BENCH_DIR "]\n"
+	 "  flowindex [options]        Flow indexes links, unlinks and lookups\n"
+	 "    -H <hosts>               Host cardinality [default: 64]\n"
+	 "    -P <ports>               Port cardinality [default: 8]\n"
+	 "    -F <flows>               Flows in the table [default: 100000]\n\n"
+	 "Options:\n"
+	 "  -n <iterations>            Number of iterations [default: 1]\n"
+	 "  -h                         Print this help\n\n"
+	 "Options after '--' are passed to ntopng (e.g. -- -m 192.168.1.0/24 -d /tmp/ntopng)\n");
+  exit(0);
+}
+
+/* ******************************** */
+
+static void sigproc(int sig) {
+  static int called = 0;
+
+  if(called)
+    _exit(0);
+
+  called = 1;
+  ntop->getGlobals()->requestShutdown();
+}
+
+/* ******************************** */
+
+static Benchmark* createBenchmark(const char *name, int argc, char *argv[], u_int32_t num_iterations) {
+  if(!strcmp(name, "pcap")) {
+    if(argc < 1) bench_usage();
+    return(new PcapReplayBench(argv[0], num_iterations));
+  }
+#ifndef HAVE_NEDGE
+  else if(!strcmp(name, "flows"))
+    return(new FlowGeneratorBench(argc + 1, argv - 1 /* benchmark name */, num_iterations));
+  else if(!strcmp(name, "filter"))
+    return(new WalkerFilterBench(argc + 1, argv - 1 /* benchmark name */, num_iterations));
+  else if(!strcmp(name, "flowstore"))
+    return(new FlowStoreBench(argc + 1, argv - 1 /* benchmark name */, num_iterations));
+  else if(!strcmp(name, "flowindex"))
+    return(new FlowIndexBench(argc + 1, argv - 1 /* benchmark name */, num_iterations));
+#endif
+  else if(!strcmp(name, "lpm"))
+    return(new AddressTreeBench(argc + 1, argv - 1 /* benchmark name */, num_iterations));
+
+  printf("Unknown benchmark '%s'\n\n", name);
+  bench_usage();
+  return(NULL);
+}
+
+/* ******************************** */
+
+int main(int argc, char *argv[]) {
+  Prefs *prefs = NULL;
+  Benchmark *bench;
+  u_int32_t num_iterations = 1;
+  int c, bench_argc, ntopng_argc, rc;
+  char *ntopng_argv[64], **bench_argv, *name;
+
+  while((c = getopt(argc, argv, "+n:h")) != -1) {
+    switch(c) {
+    case 'n':
+      num_iterations = (u_int32_t)atoi(optarg);
+      break;
+
+    default:
+      bench_usage();
+    }
+  }
+
+  if(optind >= argc) bench_usage();
+
+  name = argv[optind++], bench_argv = &argv[optind];
+
+  /* Split benchmark arguments and ntopng options */
+  for(bench_argc = 0; (optind + bench_argc < argc) && strcmp(argv[optind + bench_argc], "--"); bench_argc++)
+    ;
+
+  ntopng_argv[0] = argv[0], ntopng_argc = 1;
+  for(int i = optind + bench_argc + 1; (i < argc) && (ntopng_argc < (int)(sizeof(ntopng_argv) / sizeof(char*)) - 1); i++)
+    ntopng_argv[ntopng_argc++] = argv[i];
+  ntopng_argv[ntopng_argc] = NULL;
+
+  if((ntop = new(std::nothrow)  Ntop(argv[0])) == NULL) _exit(0);
+  if((prefs = new(std::nothrow) Prefs(ntop)) == NULL)   _exit(0);
+
+  optind = 0; /* Reset getopt for Prefs::loadFromCLI */
+  if(prefs->loadFromCLI(ntopng_argc, ntopng_argv) < 0) return(-1);
+
+  ntop->registerPrefs(prefs, false);
+  prefs->validate();
+
+  ntop->loadGeolocation(prefs->get_docs_dir());
+  ntop->loadMacManufacturers(prefs->get_docs_dir());
+
+  signal(SIGINT,  sigproc);
+  signal(SIGTERM, sigproc);
+
+  if((bench = createBenchmark(name, bench_argc, bench_argv, num_iterations)) == NULL)
+    return(-1);
+
+  rc = bench->run();
+
+  delete bench;
+  delete ntop;
+
+  return(rc);
+}
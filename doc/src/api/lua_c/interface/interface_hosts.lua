@@ -46,6 +46,12 @@ function interface.getGroupedHosts(bool show_details=true, string groupBy="colum
 --! @return table with host information on success, nil otherwise.
 function interface.getHostInfo(string host_ip, int vlan_id=nil)
 
+--! @brief Get the information of many hosts at once.
+--! @param host_keys array of host/host@vlan keys.
+--! @param fields optional array of host fields to return (e.g. {"bytes.sent", "num_alerts", "anomalies"}). All the host information is returned when nil.
+--! @return table host_key -> host information, containing only the hosts found.
+function interface.getHostsInfoBatch(table host_keys, table fields=nil)
+
 --! @brief Get host country.
 --! @param host_ip host/host@vlan.
 --! @return the host country code on success, nil otherwise.
@@ -36,6 +36,7 @@ class AddressList {
 
   inline u_int8_t getNumAddresses() { return(tree.getNumAddresses()); }
   bool addAddresses(char *net);
+  inline bool compile()                       { return(tree.compile()); }
   
   int16_t findAddress(int family, void *addr, u_int8_t *network_mask_bits = NULL) {
     return(tree.findAddress(family, addr, network_mask_bits));
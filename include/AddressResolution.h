@@ -24,25 +24,94 @@
 
 #include "ntop_includes.h"
 
+/*
+  Address resolution pipeline
+
+  Addresses to resolve are queued into a bounded in-memory queue and
+  deduplicated through the pending entries of the DnsCache. Each resolver
+  thread keeps up to DNS_MAX_INFLIGHT_QUERIES PTR queries outstanding on
+  non-blocking UDP sockets towards the nameservers of /etc/resolv.conf,
+  falling back to blocking getnameinfo() when none is configured.
+  Redis is only used, when enabled, to persist resolved names across
+  restarts.
+*/
+
+struct dns_resolution_request {
+  char key[DNS_CACHE_MAX_KEY_LEN];
+  struct timeval queued_at;
+};
+
+struct dns_nameserver {
+  struct sockaddr_storage addr;
+  socklen_t addr_len;
+};
+
 class AddressResolution {
   AddressList localNetworks;
+  Mutex local_networks_lock;
+  volatile bool local_networks_dirty; /* Networks added since the last compilation */
   int num_resolvers;
   u_int32_t num_resolved_addresses, num_resolved_fails;
   pthread_t *resolveThreadLoop;
   Mutex m;
 
+  DnsCache *cache;
+  bool persistence;
+  struct dns_nameserver nameservers[DNS_MAX_NAMESERVERS];
+  u_int8_t num_nameservers;
+
+  /* Work queue (protected by m) */
+  struct dns_resolution_request *queue;
+  u_int32_t queue_head, queue_len, queue_peak_len;
+  pthread_cond_t queue_cond;
+  u_int64_t num_queued, num_queue_drops, num_persisted_hits;
+
+  /* Resolution latency, from queueing to completion (protected by m) */
+  u_int64_t latency_usec_total, num_latency_samples;
+  u_int32_t latency_usec_max;
+
+  void loadNameservers();
+  bool enqueue(const char *key, bool urgent);
+  bool dequeue(struct dns_resolution_request *req, bool wait);
+  void resolved(const struct dns_resolution_request *req, const char *name, u_int32_t ttl, bool negative);
+  bool resolveNow(const char *key, char *rsp, u_int rsp_len, u_int32_t *ttl);
+  bool loadPersisted(const char *key, char *rsp, u_int rsp_len);
+
  public:
   AddressResolution();
   ~AddressResolution();
 
   void startResolveAddressLoop();
+  void resolveLoop();
+  /* Synchronous resolution, used when the caller needs the name right now */
   void resolveHostName(char *numeric_ip, char *rsp = NULL, u_int rsp_len = 0);
+  /*
+    Returns 0 and fills rsp when the address is known (the address itself
+    or an empty string for failed resolutions), -1 otherwise. Unknown
+    addresses are queued when queue_if_not_found is set.
+  */
+  int getAddress(const char *numeric_ip, char *rsp, u_int rsp_len, bool queue_if_not_found);
+  /* Urgent addresses are queued ahead of the others */
+  void queueHostToResolve(const char *numeric_ip, bool urgent);
+  /* numeric_ip can contain several ';' separated addresses */
+  void setResolvedAddress(const char *numeric_ip, const char *symbolic_ip);
+  /* Forgets the name of numeric_ip, both in memory and in Redis */
+  void delResolvedAddress(const char *numeric_ip);
+  void lua(lua_State *vm);
+
+  inline DnsCache* getCache()                 { return(cache);                    };
+  inline u_int32_t getQueueLength()           { return(queue_len);                };
+  inline u_int64_t getNumQueueDrops()         { return(num_queue_drops);          };
+  inline u_int64_t getLatencyUsecTotal()      { return(latency_usec_total);       };
+  inline u_int64_t getNumLatencySamples()     { return(num_latency_samples);      };
 
   inline u_int8_t getNumLocalNetworks()       { return localNetworks.getNumAddresses();    };
   inline char *get_local_network(u_int8_t id) { return localNetworks.getAddressString(id); };
   bool setLocalNetworks(char *rule);
   int16_t findAddress(int family, void *addr, u_int8_t *network_mask_bits = NULL);
-  void setLocalNetwork(char *net)             { localNetworks.addAddresses(net);           };
+  void setLocalNetwork(char *net);
+  /* Recompiles the local networks tree if networks have been added meanwhile */
+  void compileLocalNetworks();
   void getLocalNetworks(lua_State* vm);
   inline void dump()                          { localNetworks.dump(); }
 };
@@ -35,8 +35,11 @@ class AddressTree {
   u_int16_t numAddresses;
   patricia_tree_t *ptree_v4, *ptree_v6;
   MacKey_t *macs;
+  /* Read-only LPM tables, valid until the next address is added */
+  CompiledAddressTree *compiled, *compiled_shadow;
   
   patricia_tree_t* getPatricia(char* what);
+  void invalidateCompiled();
   
  public:
   AddressTree();
@@ -51,8 +54,12 @@ class AddressTree {
   inline patricia_tree_t* getTree(bool isV4) { return(isV4 ? ptree_v4 : ptree_v6); }
   bool addAddress(char *_net, const int16_t user_data = -1);
   bool addAddresses(char *net, const int16_t user_data = -1);
+  bool removeAddress(char *_net);
   void getAddresses(lua_State* vm);
+  bool compile();
+  inline bool isCompiled() { return(compiled != NULL); }
   int16_t findAddress(int family, void *addr, u_int8_t *network_mask_bits = NULL);
+  int16_t findAddressPatricia(int family, void *addr, u_int8_t *network_mask_bits = NULL);
   int16_t findMac(u_int8_t addr[]);
   bool match(char *addr);
   void dump();
@@ -32,6 +32,21 @@ class AlertsManager : protected StoreManager {
   bool store_opened, store_initialized;
   u_int32_t num_alerts_engaged;
   bool alerts_stored;
+
+  /*
+    Flow alerts are queued by the flows walk and written by a dedicated
+    thread, in batches of one SQLite transaction and one Redis pipeline.
+  */
+  FlowAlert **flow_alerts_queue;
+  u_int32_t flow_alerts_queue_head, flow_alerts_queue_tail, flow_alerts_queue_len;
+  Mutex flow_alerts_queue_m;
+  pthread_t flow_alerts_writer;
+  volatile bool flow_alerts_writer_running;
+  bool flow_alerts_writer_started;
+  u_int64_t num_flow_alerts_queued, num_flow_alerts_dropped;
+  u_int64_t num_flow_alerts_written, num_flow_alerts_failed;
+  u_int64_t num_flow_alerts_batches, flow_alerts_batch_usec;
+
   int openStore();
   
   /* methods used for alerts that have a timespan */
@@ -53,7 +68,21 @@ class AlertsManager : protected StoreManager {
 		   const char *engaged_alert_id,
 		   AlertType alert_type, AlertLevel alert_severity, const char *alert_json,
 		   const char *alert_origin, const char *alert_target,
-		   bool engage, time_t now, Flow *flow);
+		   bool engage, time_t now, const FlowAlert *flow_alert);
+  json_object* alert2notification(AlertEntity alert_entity, const char *alert_entity_value,
+				  const char *engaged_alert_id,
+				  AlertType alert_type, AlertLevel alert_severity, const char *alert_json,
+				  const char *alert_origin, const char *alert_target,
+				  bool engage, time_t now, const FlowAlert *flow_alert);
+
+  /* Flow alerts writer */
+  void startFlowAlertsWriter();
+  void stopFlowAlertsWriter();
+  u_int32_t dequeueFlowAlerts(FlowAlert **alerts, u_int32_t max_num);
+  void writeFlowAlerts(FlowAlert **alerts, u_int32_t num);
+  void notifyFlowAlerts(FlowAlert **alerts, json_object **alerts_json, u_int32_t num);
+  static json_object* flowAlert2json(const FlowAlert *alert);
+  static void freeFlowAlert(FlowAlert *alert);
   
   int engageReleaseHostAlert(const char *host_ip, u_int16_t host_vlan,
 			     AlertEngine alert_engine,
@@ -80,7 +109,7 @@ class AlertsManager : protected StoreManager {
 
  public:
   AlertsManager(int interface_id, const char *db_filename);
-  ~AlertsManager() {};
+  ~AlertsManager();
 
   /*
     ========== HOST alerts API =========
@@ -114,7 +143,14 @@ class AlertsManager : protected StoreManager {
   /*
     ========== FLOW alerts API =========
    */
-  int storeFlowAlert(Flow *f);
+  /**
+   * @brief Queue an alert for the current status of the flow.
+   * @details The flow fields are copied, the alert is written
+   *          asynchronously by the flow alerts writer thread.
+   * @return false when the alert has been dropped.
+   */
+  bool enqueueFlowAlert(Flow *f);
+  void flowAlertsWriterLoop();
   inline int getNumFlowAlerts() {
     return getNumFlowAlerts(NULL);
   };
@@ -150,6 +186,14 @@ class AlertsManager : protected StoreManager {
     ========== counters API ======
   */
   int getCachedNumAlerts(lua_State *vm);
+  void luaFlowAlertsQueue(lua_State *vm);
+  inline u_int32_t getFlowAlertsQueueLen()      { return(flow_alerts_queue_len);   };
+  inline u_int64_t getNumFlowAlertsQueued()     { return(num_flow_alerts_queued);  };
+  inline u_int64_t getNumFlowAlertsDropped()    { return(num_flow_alerts_dropped); };
+  inline u_int64_t getNumFlowAlertsWritten()    { return(num_flow_alerts_written); };
+  inline u_int64_t getNumFlowAlertsFailed()     { return(num_flow_alerts_failed);  };
+  inline u_int64_t getNumFlowAlertsBatches()    { return(num_flow_alerts_batches); };
+  inline u_int64_t getFlowAlertsBatchUsec()     { return(flow_alerts_batch_usec);  };
   inline int getNumAlerts(bool engaged) {
     /* must force the cast or the compiler will go crazy with ambiguous calls */
     return getNumAlerts(engaged, "alert_severity=2" /* errors only */);
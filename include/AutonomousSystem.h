@@ -42,7 +42,8 @@ class AutonomousSystem : public GenericHashEntry, public GenericTrafficElement {
   }
 
  public:
-  AutonomousSystem(NetworkInterface *_iface, IpAddress *ipa);
+  /* _asname, if any, is owned by the AutonomousSystem from now on */
+  AutonomousSystem(NetworkInterface *_iface, u_int32_t _asn, char *_asname);
   ~AutonomousSystem();
 
   inline u_int16_t getNumHosts()               { return getUses();            }
@@ -31,7 +31,7 @@ class AutonomousSystemHash : public GenericHash {
  public:
   AutonomousSystemHash(NetworkInterface *iface, u_int _num_hashes, u_int _max_hash_size);
 
-  AutonomousSystem* get(IpAddress *ipa);
+  AutonomousSystem* get(u_int32_t asn);
 
 #ifdef AS_DEBUG
   void printHash();
@@ -0,0 +1,169 @@
+/*
+ *
+ * (C) 2019 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+
+
+
+#ifndef _COLUMNAR_FLOW_DB_H_
+#define _COLUMNAR_FLOW_DB_H_
+
+#include "ntop_includes.h"
+
+/*
+  Embedded columnar flow archive (-F columnar).
+
+  Dumped flows are stored under <data dir>/<ifid>/flowstore in one
+  <epoch>.cfs file per FLOW_STORE_PARTITION_SECS partition. A file is
+  a sequence of chunks of up to FLOW_STORE_CHUNK_ROWS flows, each one
+  made of:
+  - a header with the zone maps (min/max) of time, ports and bytes
+  - the sorted dictionary of the chunk IP addresses
+  - one array per column, IPs as dictionary indexes
+  - a bitmap per L4 and L7 protocol of the chunk
+
+  Rows are buffered in memory and chunks are encoded and written by a
+  dedicated thread: rows are visible to queries once written, that is
+  after at most FLOW_STORE_FLUSH_SECS. A chunk is published by writing
+  its magic last, and files never shrink, as queries mmap them.
+*/
+
+typedef struct {
+  u_int8_t cli_ip[16], srv_ip[16]; /* IPv4 as ::ffff:a.b.c.d */
+  u_int32_t first_seen, last_seen;
+  u_int16_t cli_port, srv_port, vlan_id, l7_proto;
+  u_int8_t l4_proto;
+  u_int64_t cli2srv_bytes, srv2cli_bytes;
+  u_int32_t cli2srv_packets, srv2cli_packets;
+} FlowStoreRow;
+
+typedef struct {
+  u_int32_t magic, version;
+  u_int32_t chunk_len; /* Header included */
+  u_int32_t num_rows, num_ips, num_l4, num_l7;
+  u_int32_t min_first_seen, max_last_seen;
+  u_int16_t min_cli_port, max_cli_port, min_srv_port, max_srv_port;
+  u_int64_t min_bytes, max_bytes;
+} flow_store_chunk_header_t;
+
+typedef enum {
+  flow_store_group_none = 0,
+  flow_store_group_host,     /* Client and server */
+  flow_store_group_src_host,
+  flow_store_group_dst_host,
+  flow_store_group_port,     /* Client and server */
+  flow_store_group_src_port,
+  flow_store_group_dst_port,
+  flow_store_group_l7_proto,
+  flow_store_group_conversations
+} FlowStoreGroupBy;
+
+typedef enum {
+  flow_store_sort_bytes = 0,
+  flow_store_sort_packets,
+  flow_store_sort_flows
+} FlowStoreSort;
+
+typedef struct {
+  time_t begin, end;
+  bool has_host;
+  u_int8_t host[16];
+  int32_t port, l7_proto, l4_proto, vlan_id; /* -1: any */
+  FlowStoreGroupBy group_by;
+  FlowStoreSort sort;
+  u_int32_t limit, offset;
+} FlowStoreQuery;
+
+typedef struct {
+  u_int8_t ip[2][16];
+  u_int16_t value; /* Port or L7 protocol */
+  u_int64_t bytes, packets, flows;
+} FlowStoreResult;
+
+typedef struct {
+  u_int32_t partitions, chunks, chunks_skipped;
+  u_int64_t rows_scanned, rows_matched;
+} FlowStoreQueryStats;
+
+/* Query state: hosts and conversations by key, ports and L7 protocols by value */
+typedef struct {
+  std::map<std::string, FlowStoreResult> keys;
+  FlowStoreResult *values; /* 65536 entries */
+  FlowStoreResult total;
+} FlowStoreAggregation;
+
+class ColumnarFlowDB : public DB {
+ private:
+  NetworkInterface *iface;
+  char dir[MAX_PATH];
+  u_int32_t retention_secs;
+
+  Mutex m;
+  FlowStoreRow *cur_rows;
+  u_int32_t cur_num_rows, cur_partition;
+  time_t cur_since;
+  std::deque<std::pair<u_int32_t /* partition */, std::pair<FlowStoreRow*, u_int32_t> > > full_chunks;
+  u_int32_t last_retention_partition;
+  u_int32_t append_partition;
+  u_int64_t append_offset; /* End of the last complete chunk of append_partition */
+
+  pthread_t writer;
+  volatile bool writer_running, writer_started;
+  volatile u_int32_t num_pending_chunks; /* Queued or being written */
+  u_int64_t num_written_bytes;
+
+  bool queueChunk(); /* Locked */
+  void writeChunk(u_int32_t partition, FlowStoreRow *rows, u_int32_t num_rows);
+  void enforceRetention(u_int32_t partition);
+  static u_char* encodeChunk(const FlowStoreRow *rows, u_int32_t num_rows, u_int32_t *len);
+  void queryChunk(const u_char *chunk, const FlowStoreQuery *q, FlowStoreQueryStats *stats,
+		  FlowStoreAggregation *aggr);
+  void queryPartition(const char *path, const FlowStoreQuery *q, FlowStoreQueryStats *stats,
+		      FlowStoreAggregation *aggr);
+
+ public:
+  ColumnarFlowDB(NetworkInterface *_iface, const char *_dir = NULL);
+  virtual ~ColumnarFlowDB();
+
+  bool addRow(const FlowStoreRow *r);
+  virtual bool dumpFlow(time_t when, Flow *f, char *json);
+  virtual void shutdown();
+  /* Writes all the buffered rows and waits for them to be on disk */
+  void sync();
+  void writerLoop();
+
+  inline const char* getDir()           { return(dir);               };
+  inline u_int64_t getNumWrittenBytes() { return(num_written_bytes); };
+  inline u_int32_t getNumPendingChunks() { return(num_pending_chunks); };
+
+  static void setIP(u_int8_t *dst, IpAddress *ip);
+  static void getIP(const u_int8_t *src, IpAddress *ip);
+  static FlowStoreGroupBy str2GroupBy(const char *s);
+
+  /* Returns the results sorted by q->sort, after q->offset, at most q->limit */
+  bool query(const FlowStoreQuery *q, std::vector<FlowStoreResult> *results, FlowStoreQueryStats *stats);
+  void luaQuery(lua_State *vm, const FlowStoreQuery *q);
+
+#ifdef NTOPNG_PRO
+  bool dumpAggregatedFlow(time_t when, AggregatedFlow *f, bool is_top_aggregated_flow) { return(false); };
+#endif
+};
+
+#endif /* _COLUMNAR_FLOW_DB_H_ */
@@ -0,0 +1,107 @@
+/*
+ *
+ * (C) 2019 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+
+#ifndef _COMPILED_ADDRESS_TREE_H_
+#define _COMPILED_ADDRESS_TREE_H_
+
+#include "ntop_includes.h"
+
+/*
+  Read-only longest prefix match table compiled from the patricia
+  trees of an AddressTree. Both address families use a multibit trie
+  with a 16 bit root stride followed by 8 bit strides (DIR-16-8-8 for
+  IPv4, 16+8*14 for IPv6) and controlled prefix expansion, so that a
+  lookup is at most 3 (IPv4) or 15 (IPv6) dependent array reads.
+
+  Each slot is a 32 bit word that either points to the next level
+  chunk of 256 slots or holds the matched value and prefix length.
+*/
+
+#define LPM_ROOT_BITS       16
+#define LPM_CHUNK_BITS      8
+#define LPM_CHUNK_SIZE      (1 << LPM_CHUNK_BITS)
+
+#define LPM_SLOT_CHILD      0x80000000 /* Bits 0..30: chunk index */
+#define LPM_SLOT_LEAF       0x40000000 /* Bits 0..15: value, 16..23: prefix length */
+
+typedef struct {
+  u_int8_t addr[16];
+  u_int8_t bits;
+  int16_t value;
+} LpmPrefix;
+
+typedef struct {
+  u_int32_t *root;    /* 2^LPM_ROOT_BITS slots, NULL when there are no prefixes */
+  u_int32_t *chunks;  /* num_chunks * LPM_CHUNK_SIZE slots */
+  u_int32_t num_chunks, max_chunks;
+  u_int8_t max_levels; /* Chunk levels below the root */
+} LpmTable;
+
+class CompiledAddressTree {
+ private:
+  LpmTable v4, v6;
+
+  static void collectPrefixes(patricia_node_t *node, std::vector<LpmPrefix> *prefixes);
+  static bool buildTable(LpmTable *t, u_int8_t max_bits, patricia_tree_t *ptree);
+  static bool insertPrefix(LpmTable *t, const LpmPrefix *p);
+  static int32_t newChunk(LpmTable *t, u_int32_t fill);
+  static void freeTable(LpmTable *t);
+
+  static inline int16_t lookup(const LpmTable *t, const u_int8_t *addr, u_int8_t *network_mask_bits) {
+    u_int32_t slot;
+
+    if(!t->root) return(-1);
+
+    slot = t->root[(addr[0] << 8) | addr[1]];
+
+    for(u_int8_t level = 0; (slot & LPM_SLOT_CHILD) && (level < t->max_levels); level++)
+      slot = t->chunks[((slot & ~LPM_SLOT_CHILD) << LPM_CHUNK_BITS) + addr[2 + level]];
+
+    if(!(slot & LPM_SLOT_LEAF))
+      return(-1);
+
+    if(network_mask_bits)
+      *network_mask_bits = (slot >> 16) & 0xFF;
+
+    return((int16_t)(slot & 0xFFFF));
+  };
+
+ public:
+  CompiledAddressTree();
+  ~CompiledAddressTree();
+
+  bool compile(patricia_tree_t *ptree_v4, patricia_tree_t *ptree_v6);
+
+  inline int16_t findAddress(int family, void *addr, u_int8_t *network_mask_bits = NULL) const {
+    if(family == AF_INET)
+      return(lookup(&v4, (const u_int8_t*)addr, network_mask_bits));
+    else if(family == AF_INET6)
+      return(lookup(&v6, (const u_int8_t*)addr, network_mask_bits));
+    else
+      return(-1);
+  };
+
+  /* Memory used by the lookup tables, in bytes */
+  u_int64_t getMemoryUsage() const;
+};
+
+#endif /* _COMPILED_ADDRESS_TREE_H_ */
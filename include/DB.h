@@ -48,6 +48,7 @@ class DB {
   DB();
   virtual ~DB() {};
   inline u_int32_t getNumDroppedFlows()  const              { return(queueDroppedFlows + droppedFlows); };
+  inline u_int64_t getNumExportedFlows() const              { return(exportedFlows); };
   void updateStats(const struct timeval *tv);
   void checkPointCounters(bool drops_only);
 
@@ -0,0 +1,96 @@
+/*
+ *
+ * (C) 2019 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+
+#ifndef _DNS_CACHE_H_
+#define _DNS_CACHE_H_
+
+#include "ntop_includes.h"
+
+/*
+  In-memory cache of the resolved addresses
+
+  Entries are kept in a chained hash table and in a LRU list: when the
+  cache is full the least recently used entry is recycled. Each entry
+  expires according to the TTL it has been stored with (0 means never).
+
+  Failed resolutions are cached as negative entries, holding the value
+  that callers expect for an unresolvable address. Addresses queued for
+  resolution are marked as pending so that concurrent lookups do not
+  queue them again.
+*/
+
+typedef enum {
+  dns_cache_hit = 0,
+  dns_cache_negative_hit,
+  dns_cache_miss,
+  dns_cache_pending
+} DnsCacheLookup;
+
+struct dns_cache_entry {
+  char key[DNS_CACHE_MAX_KEY_LEN];
+  char *value;  /* NULL while pending */
+  time_t expire; /* 0 = never */
+  bool negative;
+  u_int32_t hash;
+  struct dns_cache_entry *hash_next, *lru_prev, *lru_next;
+};
+
+class DnsCache {
+ private:
+  Mutex m;
+  struct dns_cache_entry **buckets, *lru_head, *lru_tail;
+  u_int32_t num_buckets, num_entries, max_num_entries;
+  u_int64_t num_hits, num_negative_hits, num_misses, num_pending_hits, num_evictions;
+
+  struct dns_cache_entry* find(const char *key, u_int32_t hash);
+  struct dns_cache_entry* insert(const char *key, u_int32_t hash);
+  void unlink(struct dns_cache_entry *e);
+  void touch(struct dns_cache_entry *e);
+  void remove(struct dns_cache_entry *e);
+
+ public:
+  DnsCache(u_int32_t _max_num_entries);
+  ~DnsCache();
+
+  /*
+    Looks up key copying its value into rsp on (negative) hits. When
+    reserve is set, a missing key is marked as pending for
+    DNS_PENDING_DURATION seconds: dns_cache_miss is returned only to the
+    caller which has to queue it, dns_cache_pending to the others.
+  */
+  DnsCacheLookup lookup(const char *key, char *rsp, u_int rsp_len, time_t now, bool reserve);
+  void set(const char *key, const char *value, u_int32_t ttl, bool negative, time_t now);
+  /* Drops a pending mark, e.g. when the key could not be queued */
+  void release(const char *key);
+  /* Drops the entry of key, whatever its state */
+  void del(const char *key);
+
+  inline u_int32_t getNumEntries()      const { return(num_entries);       };
+  inline u_int64_t getNumHits()         const { return(num_hits);          };
+  inline u_int64_t getNumNegativeHits() const { return(num_negative_hits); };
+  inline u_int64_t getNumMisses()       const { return(num_misses);        };
+  inline u_int64_t getNumPendingHits()  const { return(num_pending_hits);  };
+  inline u_int64_t getNumEvictions()    const { return(num_evictions);     };
+  void lua(lua_State *vm);
+};
+
+#endif /* _DNS_CACHE_H_ */
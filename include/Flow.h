@@ -92,6 +92,10 @@ class Flow : public GenericHashEntry {
   void *cli_id, *srv_id;
   char *json_info, *host_server_name, *bt_hash;
   char *community_id_flow_hash;
+  FlowIndexLinks *index_links; /* NULL when the flow is not in the interface FlowIndex */
+  FlowStatus flow_status;      /* Cached by updateFlowStatus(), only called by the periodic/housekeeping path */
+  u_int32_t flow_status_map;   /* Bitmap of all the FlowStatus conditions matched */
+  volatile bool flow_status_dirty; /* Set by the packet path, which never calls updateFlowStatus() */
 #ifdef HAVE_NEDGE
   u_int32_t last_conntrack_update; 
   u_int32_t marker;
@@ -244,7 +248,11 @@ class Flow : public GenericHashEntry {
     GenericHashEntry::set_to_purge();
   };
 
-  FlowStatus getFlowStatus();
+  FlowStatus computeFlowStatus(u_int32_t *status_map);
+  void updateFlowStatus();
+  inline FlowStatus getFlowStatus() const          { return(flow_status);     };
+  inline u_int32_t getFlowStatusMap() const        { return(flow_status_map); };
+  inline bool hasFlowStatus(FlowStatus s) const    { return((flow_status_map & ((u_int32_t)1 << s)) ? true : false); };
   struct site_categories* getFlowCategory(bool force_categorization);
   void freeDPIMemory();
   bool isTiny();
@@ -262,6 +270,8 @@ class Flow : public GenericHashEntry {
   json_object* flow2json();
   json_object* flow2es(json_object *flow_object);
   json_object* flow2statusinfojson();
+  void getStatusInfo(FlowStatusInfo *info);
+  static json_object* statusInfo2json(const FlowStatusInfo *info);
   inline u_int8_t getTcpFlags()        { return(src2dst_tcp_flags | dst2src_tcp_flags);  };
   inline u_int8_t getTcpFlagsCli2Srv() { return(src2dst_tcp_flags);                      };
   inline u_int8_t getTcpFlagsSrv2Cli() { return(dst2src_tcp_flags);                      };
@@ -394,9 +404,10 @@ class Flow : public GenericHashEntry {
   u_int32_t key();
   static u_int32_t key(Host *cli, u_int16_t cli_port,
 		       Host *srv, u_int16_t srv_port,
-		       u_int16_t vlan_id,
 		       u_int16_t protocol);
   void lua(lua_State* vm, AddressTree * ptree, DetailsLevel details_level, bool asListElement);
+  inline bool isJSONWritable() { return(cli_host && srv_host); };
+  void writeJSON(JSONStream *s, DetailsLevel details_level);
   bool equal(IpAddress *_cli_ip, IpAddress *_srv_ip,
 	     u_int16_t _cli_port, u_int16_t _srv_port,
 	     u_int16_t _vlanId, u_int8_t _protocol,
@@ -494,6 +505,13 @@ class Flow : public GenericHashEntry {
   inline bool isIngress2EgressDirection() { return(ingress2egress_direction); }
 #endif
   void housekeep();
+  inline FlowIndexLinks* getIndexLinks()            { return(index_links); };
+  inline void setIndexLinks(FlowIndexLinks *l)      { index_links = l;     };
+  inline bool isIndexedProtocolChanged() const {
+    return(index_links
+	   && ((index_links->l7_app != ndpiDetectedProtocol.app_protocol)
+	       || (index_links->l7_master != ndpiDetectedProtocol.master_protocol)));
+  };
 #ifdef HAVE_EBPF
   void setProcessInfo(eBPFevent *event, bool client_process);
 #endif
@@ -0,0 +1,137 @@
+/*
+ *
+ * (C) 2019 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+
+
+
+#ifndef _FLOW_INDEX_H_
+#define _FLOW_INDEX_H_
+
+#include "ntop_includes.h"
+
+class Flow;
+class Host;
+
+typedef enum {
+  flow_index_none = 0, /* Walk the whole flows hash */
+  flow_index_host,
+  flow_index_l7proto,
+  flow_index_port
+} FlowIndexType;
+
+typedef struct {
+  FlowIndexType type;
+  Host *host;       /* flow_index_host */
+  u_int16_t value;  /* flow_index_l7proto (app or master protocol) or flow_index_port (client or server port) */
+} FlowIndexQuery;
+
+/* The links of a table come in pairs (the table chain is the lowest bit) */
+typedef enum {
+  flow_link_cli_host = 0,
+  flow_link_srv_host,
+  flow_link_l7_app,
+  flow_link_l7_master,
+  flow_link_cli_port,
+  flow_link_srv_port,
+  flow_num_links
+} FlowIndexLink;
+
+typedef struct {
+  Flow *prev, *next;
+} flow_index_link_t;
+
+/* Allocated for every indexed flow */
+typedef struct {
+  flow_index_link_t links[flow_num_links];
+  u_int16_t l7_app, l7_master; /* Protocols the flow is linked under */
+  u_int8_t linked;             /* Bitmap of the FlowIndexLink in use */
+} FlowIndexLinks;
+
+#define FLOW_INDEX_NUM_LOCKS     64 /* pow of 2 */
+#define FLOW_INDEX_L7_BUCKETS  1024 /* pow of 2 */
+#define FLOW_INDEX_PORT_BUCKETS 16384 /* pow of 2 */
+
+/*
+  Secondary indexes of the flows hash: per host, per L7 protocol
+  (application and master) and per port (client and server) doubly
+  linked lists of flows, maintained when flows are created, detected
+  and deleted. Each table has a chain per link type (e.g. a client
+  and a server host chain), as a flow is linked through a different
+  FlowIndexLink in each of them. Lookups walk a single bucket instead
+  of the whole flows hash: the flows found are those of the bucket
+  with the exact key, still to be checked against the full search
+  criteria.
+
+  Buckets are protected by striped locks, never nested: only the L7
+  relink lock is held while taking them. Flows are deleted (and
+  unlinked) with their flows hash bucket locked, so walker callbacks
+  must not lock the flows hash.
+*/
+class FlowIndex {
+ private:
+  typedef struct {
+    Flow **buckets[2]; /* Heads of the chains, indexed by chainOf() */
+    u_int32_t mask;
+    Mutex locks[FLOW_INDEX_NUM_LOCKS];
+  } flow_index_table_t;
+
+  flow_index_table_t hosts, l7protos, ports;
+  Mutex relink_lock; /* Serializes the L7 relinks and the removals */
+  u_int32_t num_flows;
+  u_int64_t num_lookups;
+
+  static inline u_int32_t hostKey(Host *h) {
+    u_int64_t k = (u_int64_t)(uintptr_t)h;
+
+    k ^= k >> 33, k *= 0xff51afd7ed558ccdULL, k ^= k >> 33;
+    return((u_int32_t)k);
+  }
+
+  static inline u_int8_t chainOf(FlowIndexLink which) { return(which & 1); }
+
+  bool initTable(flow_index_table_t *t, u_int32_t num_buckets);
+  void freeTable(flow_index_table_t *t);
+  void link(flow_index_table_t *t, u_int32_t key, Flow *f, FlowIndexLinks *l, FlowIndexLink which);
+  void unlink(flow_index_table_t *t, u_int32_t key, Flow *f, FlowIndexLinks *l, FlowIndexLink which);
+  bool walkBucket(flow_index_table_t *t, u_int32_t key, FlowIndexLink which,
+		  const FlowIndexQuery *q,
+		  bool (*walker)(GenericHashEntry *h, void *user_data, bool *matched),
+		  void *user_data, bool *found);
+
+ public:
+  FlowIndex(u_int32_t max_num_hosts);
+  ~FlowIndex();
+
+  void add(Flow *f);
+  void remove(Flow *f);
+  void updateL7(Flow *f);
+
+  /* Same semantic of GenericHash::walk with walk_all set */
+  bool walk(const FlowIndexQuery *q,
+	    bool (*walker)(GenericHashEntry *h, void *user_data, bool *matched),
+	    void *user_data);
+
+  u_int64_t getMemoryUsage() const;
+  inline u_int32_t getNumFlows() const { return(num_flows); };
+  void lua(lua_State *vm);
+};
+
+#endif /* _FLOW_INDEX_H_ */
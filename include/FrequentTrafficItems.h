@@ -23,7 +23,31 @@
 
 #include "ntop_includes.h"
 
-/* https://resources.sei.cmu.edu/asset_files/Presentation/2010_017_001_49763.pdf */
+/*
+  Space-Saving heavy hitters sketch
+  (Metwally et al., "Efficient Computation of Frequent and Top-k Elements in Data Streams")
+
+  A fixed number of counters is kept in a min-heap, plus an open
+  addressing index from key to counter. An unknown key takes over the
+  smallest counter, inheriting its value as the estimation error: any
+  key accounting for more than 1/capacity of the traffic is guaranteed
+  to be tracked. Memory is allocated once at construction time.
+
+  NOTE: The assumption to provide concurrent access is that:
+   - only one thread, at a given moment, can call the add* / reset functions
+   - one or more threads, concurrently, can call lua() (data query)
+
+  reset() commits the counters into a snapshot guarded by a sequence
+  counter: readers copy it and retry if a commit happened meanwhile, so
+  neither side ever takes a lock.
+*/
+
+typedef enum {
+  frequent_pool_proto = 0,
+  frequent_mac_proto,
+  frequent_host_port,
+  frequent_as_proto
+} FrequentTrafficKeyType;
 
 typedef union {
   struct {
@@ -34,48 +58,69 @@ typedef union {
     u_int8_t mac[6];
     u_int16_t proto_id;
   } mac_proto;
+  struct {
+    union {
+      u_int32_t ipv4;
+      struct ndpi_in6_addr ipv6;
+    } ip;
+    u_int8_t ip_version;
+    u_int16_t port;
+  } host_port;
+  struct {
+    u_int32_t asn;
+    u_int16_t proto_id;
+  } as_proto;
 } FrequentTrafficKey_t;
 
 typedef struct {
   FrequentTrafficKey_t key;
-  u_int32_t value;
-  UT_hash_handle hh;         /* makes this structure hashable */
+  u_int64_t value;      /* Over-estimated by at most error */
+  u_int64_t error;
+  u_int32_t hash, slot; /* Key hash and position inside the index */
 } FrequentTrafficNode_t;
 
-/*
- * NOTE: The assumption to provide concurrent access is that:
- *  - only one thread, at a given moment, can call the add* / reset functions
- *  - one or more threads, concurrently, can call the lua* methods (data query)
- */
-
 /* *************************************** */
 
 class FrequentTrafficItems {
  private:
-  u_int32_t max_items, max_items_threshold;
-  u_int32_t values_sum, last_values_sum;
-  float last_diff;
-  FrequentTrafficNode_t *q, *q_committed;
-  Mutex m;
+  FrequentTrafficKeyType key_type;
+  u_int32_t max_items, capacity;
+  u_int32_t num_counters, index_mask;
+  FrequentTrafficNode_t *counters; /* Min-heap on value */
+  u_int32_t *index;                /* Counter position + 1, 0 when empty */
+  u_int64_t values_sum;
+
+  /* Last committed counters */
+  volatile u_int32_t snapshot_seq; /* Odd while a commit is in progress */
+  FrequentTrafficNode_t *snapshot;
+  u_int32_t snapshot_len;
+  u_int64_t snapshot_values_sum;
+  float snapshot_diff;
 
-  void cleanup(FrequentTrafficNode_t *root);
-  void prune();
-  FrequentTrafficNode_t* addGeneric(FrequentTrafficKey_t *key, size_t keysize, u_int32_t value);
+  u_int32_t lookup(const FrequentTrafficKey_t *key, u_int32_t hash);
+  void indexRemove(u_int32_t slot);
+  void swapCounters(u_int32_t a, u_int32_t b);
+  void siftUp(u_int32_t pos);
+  void siftDown(u_int32_t pos);
+  void add(FrequentTrafficKey_t *key, u_int32_t value);
+  void luaKey(lua_State *vm, FrequentTrafficKey_t *key);
 
  public:
-  FrequentTrafficItems(u_int32_t _max_items);
+  FrequentTrafficItems(FrequentTrafficKeyType _key_type, u_int32_t _max_items,
+		       u_int32_t _capacity = FREQUENT_TRAFFIC_ITEMS_CAPACITY);
   ~FrequentTrafficItems();
 
-  void print();
-  void testme();
-
   void reset(float tdiff_msec);
 
   void addPoolProtocol(u_int16_t pool_id, u_int16_t proto_id, u_int32_t value);
-  void luaTopPoolsProtocols(lua_State *vm);
-
   void addMacProtocol(u_int8_t mac[6], u_int16_t proto_id, u_int32_t value);
-  void luaTopMacsProtocols(lua_State *vm);
+  void addHostPort(IpAddress *ip, u_int16_t port, u_int32_t value);
+  void addASProtocol(u_int32_t asn, u_int16_t proto_id, u_int32_t value);
+
+  /**
+   * @brief Push the top max_items of the last committed period, sorted by value.
+   */
+  void lua(lua_State *vm);
 };
 
 #endif /* _FREQUENT_TRAFFIC_ITEMS_H_ */
@@ -46,6 +46,11 @@ class GenericHash {
   NetworkInterface *iface; /**< Pointer of network interface for this generic hash.*/
   u_int last_purged_hash; /**< Index of last purged hash.*/
   u_int purge_step;
+  HashChainStats chain_stats;      /**< Chain lengths of the last complete purge cycle. */
+  HashChainStats next_chain_stats; /**< Chain lengths of the purge cycle in progress. */
+  Mutex chain_stats_lock;
+
+  static void addChainLength(HashChainStats *stats, u_int32_t len);
   
  public:
   /**
@@ -126,12 +131,29 @@ class GenericHash {
   inline NetworkInterface* getInterface() { return(iface); };
   /**
    * @brief Find an entry by key value.
+   * @details Only meaningful for entries whose key() is also their hash_value() (e.g. flows).
    *
    * @param key Key value to be found in the hash.
    * @return Pointer of entry that matches with the key parameter, NULL if there isn't entry with the key parameter or if the hash is empty.
    */
   GenericHashEntry* findByKey(u_int32_t key);
 
+  /**
+   * @brief Get the histogram of the bucket chain lengths.
+   * @details The histogram is computed by purgeIdle() while visiting the buckets and refreshed
+   * at the end of every purge cycle, so this is cheap. It is empty until the first cycle completes.
+   *
+   * @param stats Filled with the number of buckets per chain length slot.
+   */
+  void getChainStats(HashChainStats *stats);
+  /**
+   * @brief Upper bound of a chain length histogram slot.
+   *
+   * @param slot Slot index, lower than HASH_CHAIN_HISTOGRAM_SLOTS.
+   * @return The longest chain counted in the slot, or -1 for the last (unbounded) slot.
+   */
+  static int32_t getChainSlotBound(u_int slot);
+
   /**
    * @brief Check whether the hash has empty space
    *
@@ -139,6 +161,8 @@ class GenericHash {
    */
   inline bool hasEmptyRoom() { return((current_size < max_hash_size) ? true : false); };
   inline u_int32_t getCurrentSize() { return current_size;}
+  inline u_int32_t getMaxHashSize() { return(max_hash_size); };
+  inline u_int32_t getNumHashes()   { return(num_hashes);    };
 
   inline void disablePurge() { /* purgeLock.lock(__FILE__, __LINE__);   */ }
   inline void enablePurge()  { /* purgeLock.unlock(__FILE__, __LINE__); */ }
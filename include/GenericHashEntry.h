@@ -97,6 +97,7 @@ class GenericHashEntry {
   inline bool is_ready_to_be_purged()  { return(will_be_purged); };
   inline u_int get_duration()          { return((u_int)(1+last_seen-first_seen)); };
   virtual u_int32_t key()              { return(0);         };  
+  virtual u_int32_t hash_value()       { return(key());     }; /**< Selects the hash bucket */
   virtual char* get_string_key(char *buf, u_int buf_len) { buf[0] = '\0'; return(buf); };
   void incUses()                       { num_uses++;      }
   void decUses()                       { num_uses--;      }
@@ -63,6 +63,8 @@ class GenericTrafficElement {
   inline u_int64_t getNumBytes()      { return(sent.getNumBytes()+rcvd.getNumBytes()); };
   inline u_int64_t getNumBytesSent()  { return(sent.getNumBytes());                    };
   inline u_int64_t getNumBytesRcvd()  { return(rcvd.getNumBytes());                    };
+  inline u_int64_t getNumPktsSent()   { return(sent.getNumPkts());                     };
+  inline u_int64_t getNumPktsRcvd()   { return(rcvd.getNumPkts());                     };
 
   inline ValueTrend getThptTrend()    { return(bytes_thpt_trend);          };
   inline float getThptTrendDiff()     { return(bytes_thpt_diff);           };
@@ -32,6 +32,16 @@ extern "C" {
 
 class Geolocation {
  private:
+  u_int64_t num_cache_hits, num_cache_misses; /* Updated atomically */
+
+  /* Static as hosts keep pointing to them across database reloads */
+  static u_int32_t db_epoch;
+  static Mutex interned_lock;
+  static std::set<std::string> interned_strings;
+
+  static const char* intern(const char *s, size_t len);
+  void lookupInfo(IpAddress *addr, GeoInfo *info);
+
 #ifdef HAVE_MAXMINDDB
   MMDB_s geo_ip_asn_mmdb, geo_ip_city_mmdb;
   bool loadMaxMindDB(const char * const base_path, const char * const db_name, MMDB_s * const mmdb) const;
@@ -53,8 +63,13 @@ class Geolocation {
   ~Geolocation();
 
   void getAS(IpAddress *addr, u_int32_t *asn, char **asname);
-  void getInfo(IpAddress *addr, char **continent_code, char **country_code, char **city, float *latitude, float *longitude);
-  static void freeInfo(char **continent_code, char **country_code, char **city);
+  /*
+    Resolves addr into info unless info has already been resolved with the
+    current databases. Strings are interned so they can be used without copies.
+  */
+  void getInfo(IpAddress *addr, GeoInfo *info);
+  inline u_int64_t getNumCacheHits()   const { return(num_cache_hits);   };
+  inline u_int64_t getNumCacheMisses() const { return(num_cache_misses); };
 };
 
 #endif /* _GEOLOCATION_H_ */
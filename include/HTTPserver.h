@@ -34,6 +34,7 @@ class HTTPserver {
   bool ssl_enabled;
   char *captive_redirect_addr;
   char *wispr_captive_data;
+  PrometheusExporter *prometheus;
   bool check_ssl_cert(char *ssl_cert_path, size_t ssl_cert_path_len);
 
   static void parseACL(char * const acl, u_int acl_len);
@@ -52,6 +53,7 @@ class HTTPserver {
   inline char*     get_docs_dir()    { return(docs_dir);         };
   inline char*     get_scripts_dir() { return(scripts_dir);      };
   inline bool      is_ssl_enabled()  { return(ssl_enabled);      };
+  inline PrometheusExporter* get_prometheus() { return(prometheus); };
 
   inline const char* getWisprCaptiveData() { return(wispr_captive_data ? wispr_captive_data : ""); }
   inline const char* getCaptiveRedirectAddress() { return(captive_redirect_addr ? captive_redirect_addr : ""); }
@@ -65,6 +65,8 @@ class Host : public Checkpointable, public GenericHashEntry, public GenericTraff
   u_int32_t num_alerts_detected;
   AlertCounter *syn_flood_attacker_alert, *syn_flood_victim_alert;
   AlertCounter *flow_flood_attacker_alert, *flow_flood_victim_alert;
+  u_int32_t syn_attacker_threshold, syn_victim_threshold; /* Used when the counters are allocated */
+  u_int32_t flow_attacker_threshold, flow_victim_threshold;
   bool trigger_host_alerts;
 
   u_int32_t total_num_flows_as_client, total_num_flows_as_server;
@@ -73,6 +75,7 @@ class Host : public Checkpointable, public GenericHashEntry, public GenericTraff
   u_int32_t last_epoch_update; /* useful to avoid multiple updates */
 
   u_int32_t asn;
+  GeoInfo geo_info; /* Resolved on first use, see getGeoInfo() */
   AutonomousSystem *as;
   Country *country;
   Vlan *vlan;
@@ -91,6 +94,7 @@ class Host : public Checkpointable, public GenericHashEntry, public GenericTraff
   bool hidden_from_top;
 
   void initialize(Mac *_mac, u_int16_t _vlan_id, bool init_all);
+  AlertCounter* getAlertCounter(AlertCounter **counter, u_int32_t max_num_hits_sec);
   virtual bool readDHCPCache() { return false; };
 #ifdef NTOPNG_PRO
   TrafficShaper *get_shaper(ndpi_protocol ndpiProtocol, bool isIngress);
@@ -109,6 +113,7 @@ class Host : public Checkpointable, public GenericHashEntry, public GenericTraff
   inline void setSystemHost()               { /* TODO: remove */ };
 
   inline nDPIStats* get_ndpi_stats()       { return(ndpiStats);               };
+  inline u_int64_t get_ndpi_proto_bytes(u_int16_t proto_id) { return(ndpiStats ? ndpiStats->getProtoBytes(proto_id) : 0); };
 
   virtual void set_to_purge() { /* Saves 1 extra-step of purge idle */
     iface->decNumHosts(isLocalHost());
@@ -142,10 +147,11 @@ class Host : public Checkpointable, public GenericHashEntry, public GenericTraff
   virtual int16_t get_local_network_id() = 0;
   inline PacketStats* get_sent_stats()              { return(&sent_stats);           };
   inline PacketStats* get_recv_stats()              { return(&recv_stats);           };
-  virtual HTTPstats* getHTTPstats()                  { return(NULL);                 };
+  virtual HTTPstats* getHTTPstats(bool createIfNotPresent = false) { return(NULL);  };
   inline void set_ipv4(u_int32_t _ipv4)             { ip.set(_ipv4);                 };
   inline void set_ipv6(struct ndpi_in6_addr *_ipv6) { ip.set(_ipv6);                 };
   inline u_int32_t key()                            { return(ip.key());              };
+  u_int32_t hash_value()                            { return(KeyedHash::combine(ip.hash(), vlan_id)); };
   char* getJSON();
   virtual void setOS(char *_os) {};
   inline IpAddress* get_ip()                   { return(&ip);              }
@@ -193,6 +199,10 @@ class Host : public Checkpointable, public GenericHashEntry, public GenericTraff
   virtual void incICMP(u_int8_t icmp_type, u_int8_t icmp_code, bool sent, Host *peer) {};
   virtual void lua(lua_State* vm, AddressTree * ptree, bool host_details,
 	   bool verbose, bool returnHost, bool asListElement);
+  inline bool isJSONWritable() { return(!Utils::maskHost(isLocalHost())); };
+  void writeJSON(JSONStream *s, bool host_details);
+  bool luaProjection(lua_State* vm, const HostLuaField *fields, u_int num_fields);
+  static HostLuaField getLuaField(const char *name);
   void resolveHostName();
   void setName(char *name);
   void set_host_label(char *label_name, bool ignoreIfPresent);
@@ -246,6 +256,7 @@ class Host : public Checkpointable, public GenericHashEntry, public GenericTraff
   inline u_int32_t getNumActiveFlows()    { return(getNumOutgoingFlows()+getNumIncomingFlows()); }
   void splitHostVlan(const char *at_sign_str, char *buf, int bufsize, u_int16_t *vlan_id);
   void setMDSNInfo(char *str);
+  const GeoInfo* getGeoInfo();
   char* get_country(char *buf, u_int buf_len);
   char* get_city(char *buf, u_int buf_len);
   void get_geocoordinates(float *latitude, float *longitude);
@@ -29,11 +29,15 @@ class HostHash : public GenericHash {
   u_int32_t num_http_hosts;
   Mutex m;
 
+  Host* findInBucket(u_int32_t hash, u_int16_t vlanId, IpAddress *key);
+
  public:
   HostHash(NetworkInterface *iface, u_int _num_hashes, u_int _max_hash_size);
 
   /* Search for an host by IP and VLAN */
   Host* get(u_int16_t vlanId, IpAddress *key);
+  /* Search for many hosts at once, taking each bucket lock only once */
+  u_int getBatch(u_int num_keys, const u_int16_t *vlan_ids, IpAddress **keys, Host **hosts);
 
   void incNumHTTPEntries();  
   void decNumHTTPEntries();
@@ -28,11 +28,34 @@ class NetworkInterface;
 class Host;
 class Mac;
 
+/* Objects replaced by a swap: concurrent readers may still be using them */
+typedef struct {
+  time_t retired_at;
+  VlanAddressTree *tree;
+  AddressTree *vlan_tree;
+#ifdef NTOPNG_PRO
+  HostPoolStats **stats;
+#endif
+} host_pools_retired_t;
+
+/*
+  Pool members are kept in a reverse index (member -> pool). Reloads
+  diff the redis configuration against the index, and captive portal
+  members are applied as they come. Only the per-VLAN trees containing
+  changed members are cloned, modified and published (copy-on-write),
+  and only the hosts and MACs matching the changed members have their
+  pool re-evaluated.
+*/
 class HostPools {
  private:
-  Mutex *swap_lock;
-  volatile time_t latest_swap;
-  VlanAddressTree *tree, *tree_shadow;
+  Mutex *swap_lock, *reload_lock;
+  VlanAddressTree *tree;
+  std::deque<host_pools_retired_t> retired; /* Oldest first, protected by swap_lock */
+  pool_member_t *members_index;
+  u_int32_t reload_epoch;
+  bool *pool_exists;
+  u_int32_t num_full_reloads, num_incremental_reloads, last_reload_changes;
+  u_int32_t last_reload_usec, max_reload_usec;
   NetworkInterface *iface;
   u_int16_t max_num_pools;
   int32_t *num_active_hosts_inline, *num_active_hosts_offline;
@@ -45,13 +68,13 @@ class HostPools {
   u_int32_t *schedule_bitmap;
   bool *enforce_quotas_per_pool_member;   /* quotas can be pool-wide or per pool member */
   bool *enforce_shapers_per_pool_member;
-  HostPoolStats **stats, **stats_shadow;
+  HostPoolStats **stats;
   volatile_members_t **volatile_members;
   Mutex **volatile_members_lock;
 
-  void reloadVolatileMembers(VlanAddressTree *_trees);
+  void purgeRemovedPoolsVolatileMembers(pool_member_change_t **changes, u_int32_t *num_changes);
   void addVolatileMember(char *host_or_mac, u_int16_t user_pool_id, time_t lifetime);
-  void swap(VlanAddressTree *new_trees, HostPoolStats **new_stats);
+  void swap(VlanAddressTree *new_trees, AddressTree **new_vlan_trees, HostPoolStats **new_stats);
 
   inline HostPoolStats* getPoolStats(u_int16_t host_pool_id) {
     if((host_pool_id >= max_num_pools) || (!stats))
@@ -61,7 +84,21 @@ class HostPools {
   void reloadPoolStats();
   static void deleteStats(HostPoolStats ***hps);
 #else
-  void swap(VlanAddressTree *new_trees);
+  void swap(VlanAddressTree *new_trees, AddressTree **new_vlan_trees);
+#endif
+
+  void retire(host_pools_retired_t *r, time_t now); /* swap_lock held */
+  void purgeRetired(time_t now, bool all);         /* swap_lock held */
+  pool_member_t* getMember(const char *member, bool create);
+  int32_t getEffectivePool(const pool_member_t *m) const;
+  void setMemberPool(pool_member_t *m, int32_t pool_id, bool is_volatile,
+		     pool_member_change_t **changes, u_int32_t *num_changes);
+#ifdef NTOPNG_PRO
+  void applyChanges(pool_member_change_t *changes, u_int32_t num_changes,
+		    bool full_refresh, struct timeval *begin, HostPoolStats **new_stats);
+#else
+  void applyChanges(pool_member_change_t *changes, u_int32_t num_changes,
+		    bool full_refresh, struct timeval *begin);
 #endif
 
   void loadFromRedis();
@@ -81,6 +118,9 @@ class HostPools {
 
   void dumpToRedis();
   void reloadPools();
+  void purgeRetired();
+  /* Splits a <member>[@<vlan>] string */
+  static bool parseMember(const char *member, char *addr, u_int addr_len, u_int16_t *vlan_id);
   u_int16_t getPool(Host *h);
   u_int16_t getPool(Mac *m);
 
@@ -95,6 +135,11 @@ class HostPools {
     return num_active_hosts_inline[pool_id] + num_active_hosts_offline[pool_id];
   }
 
+  inline u_int16_t getMaxNumPools() const { return(max_num_pools); };
+  inline u_int32_t getNumFullReloads()        const { return(num_full_reloads);        };
+  inline u_int32_t getNumIncrementalReloads() const { return(num_incremental_reloads); };
+  inline u_int32_t getLastReloadUsec()        const { return(last_reload_usec);        };
+
   inline int32_t getNumPoolL2Devices(u_int16_t pool_id) {
     if(pool_id >= max_num_pools)
       return 0;
@@ -40,7 +40,8 @@ struct ipAddress {
 class IpAddress {
  private:
   struct ipAddress addr;
-  u_int32_t ip_key;
+  u_int32_t ip_key;  /**< Ordering key (numeric IPv4 address) */
+  u_int32_t ip_hash; /**< Seeded hash used to select hash table buckets */
 
   char* intoa(char* buf, u_short bufLen, u_int8_t bitmask);
   void checkIP();
@@ -61,10 +62,11 @@ class IpAddress {
   inline bool equal(IpAddress *_ip)                   { return(this->compare(_ip) == 0); };
   int compare(const IpAddress * const ip) const;
   inline u_int32_t key()                              { return(ip_key);         };
+  inline u_int32_t hash()                             { return(ip_hash);        };
   inline void set(u_int32_t _ipv4)                    { addr.ipVersion = 4, addr.ipType.ipv4 = _ipv4; compute_key(); }
   inline void set(struct ndpi_in6_addr *_ipv6)        { addr.ipVersion = 6, memcpy(&addr.ipType.ipv6, _ipv6, sizeof(struct ndpi_in6_addr)); 
                                                         addr.privateIP = false; compute_key(); }
-  inline void set(IpAddress *ip)                      { memcpy(&addr, &ip->addr, sizeof(struct ipAddress)); ip_key = ip->ip_key; };
+  inline void set(IpAddress *ip)                      { memcpy(&addr, &ip->addr, sizeof(struct ipAddress)); ip_key = ip->ip_key, ip_hash = ip->ip_hash; };
   inline void set(struct ipAddress *ip)               { memcpy(&addr, ip, sizeof(struct ipAddress)); compute_key(); };
   void set(union usa *ip);
   void set(char *ip);  
@@ -73,7 +75,7 @@ class IpAddress {
   inline bool isBroadcastAddress()                    { return(addr.broadcastIP); };
   inline bool isNonEmptyUnicastAddress()              { return(!isMulticastAddress() && !isBroadcastAddress() && !isEmpty()); };
   inline u_int8_t getVersion()                        { return(addr.ipVersion); };
-  inline void setVersion(u_int8_t version)            { addr.ipVersion = version; };
+  inline void setVersion(u_int8_t version)            { addr.ipVersion = version; compute_key(); };
   char* print(char *str, u_int str_len, u_int8_t bitmask = 0xFF);
   char* printMask(char *str, u_int str_len, bool isLocalIP);    
   bool isLocalHost(int16_t *network_id);
@@ -0,0 +1,75 @@
+/*
+ *
+ * (C) 2019 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+
+#ifndef _JSON_STREAM_H_
+#define _JSON_STREAM_H_
+
+#include "ntop_includes.h"
+
+#define JSON_STREAM_BUF_SIZE     16384
+#define JSON_STREAM_MAX_DEPTH    16
+
+/*
+  Minimal JSON writer that serializes values straight into a fixed buffer
+  flushed to the mongoose connection, so that large listings can be sent
+  without building an intermediate Lua table or json-c object tree.
+*/
+class JSONStream {
+ private:
+  struct mg_connection *conn;
+  char buf[JSON_STREAM_BUF_SIZE];
+  u_int32_t buf_len;
+  u_int64_t num_bytes_written;
+  std::string held; /* Output kept in memory until release() */
+  bool holding;
+  u_int8_t depth;
+  bool need_comma[JSON_STREAM_MAX_DEPTH];
+
+  void write(const char *data, u_int32_t len);
+  void writeEscaped(const char *str);
+  void separator();
+
+ public:
+  JSONStream(struct mg_connection *_conn);
+  ~JSONStream();
+
+  void flush();
+  /* Keeps the output in memory (e.g. while hash entries are referenced) until release() */
+  inline void hold() { holding = true; };
+  void release();
+  inline u_int64_t getNumBytesWritten() const { return(num_bytes_written + buf_len); };
+
+  void beginObject(const char *key = NULL);
+  void endObject();
+  void beginArray(const char *key = NULL);
+  void endArray();
+
+  void key(const char *k);
+  void addString(const char *k, const char *value);
+  void addUint64(const char *k, u_int64_t value);
+  void addInt64(const char *k, int64_t value);
+  void addFloat(const char *k, float value);
+  void addBool(const char *k, bool value);
+  void addNull(const char *k);
+};
+
+#endif /* _JSON_STREAM_H_ */
@@ -0,0 +1,92 @@
+/*
+ *
+ * (C) 2019 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+
+#ifndef _KEYED_HASH_H_
+#define _KEYED_HASH_H_
+
+/*
+  Seeded hashing used to spread entries across the ntopng hash tables.
+
+  Variable length keys (IP addresses, MACs, uthash keys) go through
+  SipHash-1-3 keyed with a random per-boot seed, so that structured
+  address plans (SLAAC, one /64 per customer) or crafted traffic cannot
+  pile up entries on a few buckets. Values that are already well mixed
+  (e.g. the hash of an IP address) are combined with a cheap 64 bit
+  finalizer.
+*/
+
+class KeyedHash {
+ private:
+  static u_int64_t k0, k1; /**< Per-boot SipHash key */
+
+  static inline u_int64_t fmix64(u_int64_t k) {
+    k ^= k >> 33, k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33, k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+
+    return(k);
+  }
+
+  static inline u_int32_t fold(u_int64_t k) { return((u_int32_t)(k ^ (k >> 32))); }
+
+ public:
+  /**
+   * @brief Pick a random seed for this boot.
+   * @details Must be called before any hash table is populated:
+   *          values hashed with a different seed are not comparable.
+   */
+  static void initSeed();
+
+  /**
+   * @brief SipHash-1-3 of len bytes, folded to 32 bits.
+   */
+  static u_int32_t hashBytes(const void *data, u_int32_t len);
+
+  /**
+   * @brief Mix a 32 bit hash with an extra value (e.g. a VLAN id).
+   */
+  static inline u_int32_t combine(u_int32_t hash, u_int32_t value) {
+    return(fold(fmix64(((((u_int64_t)hash) << 32) | value) ^ k0)));
+  }
+
+  /**
+   * @brief Symmetric 5-tuple hash.
+   * @details The result does not change when the two (address, port)
+   *          endpoints are swapped so both directions of a flow land on
+   *          the same bucket. Address hashes are expected to come from
+   *          IpAddress::hash().
+   */
+  static inline u_int32_t hashFlow(u_int32_t a_hash, u_int16_t a_port,
+				   u_int32_t b_hash, u_int16_t b_port,
+				   u_int8_t protocol) {
+    u_int64_t a = (((u_int64_t)a_hash) << 16) | a_port;
+    u_int64_t b = (((u_int64_t)b_hash) << 16) | b_port;
+    u_int64_t lo = (a < b) ? a : b, hi = (a < b) ? b : a;
+
+    return(fold(fmix64(fmix64(lo ^ k0) ^ hi ^ (((u_int64_t)protocol) << 56) ^ k1)));
+  }
+};
+
+/* Route the uthash tables (sub-interface dispatch, caches, ...) through the seeded hash */
+#define HASH_FUNCTION(keyptr, keylen, hashv) (hashv) = KeyedHash::hashBytes(keyptr, (u_int32_t)(keylen))
+
+#endif /* _KEYED_HASH_H_ */
@@ -0,0 +1,66 @@
+/*
+ *
+ * (C) 2019 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+
+
+
+#ifndef _LIVE_CAPTURE_RING_H_
+#define _LIVE_CAPTURE_RING_H_
+
+#include "ntop_includes.h"
+
+/*
+  Byte ring holding the packets of a live capture, already in the pcap
+  on-disk format (struct pcap_disk_pkthdr followed by caplen bytes).
+
+  The packet thread is the only producer and never blocks: when the
+  packet does not fit, it is dropped. The HTTP thread serving the
+  capture is the only consumer and writes the ring contents to the
+  client as-is, so a slow download only fills the ring.
+*/
+
+class LiveCaptureRing {
+ private:
+  u_char *buffer;
+  u_int32_t size, mask;
+  volatile u_int64_t head; /* Bytes written by the producer */
+  volatile u_int64_t tail; /* Bytes consumed by the consumer */
+
+  void copyIn(u_int64_t pos, const void *data, u_int32_t len);
+
+ public:
+  /* size is rounded up to a power of two */
+  LiveCaptureRing(u_int32_t size);
+  ~LiveCaptureRing();
+
+  /* Producer */
+  bool enqueue(const struct pcap_pkthdr * const h, const u_char * const packet);
+
+  /* Consumer: contiguous bytes readable at *data, to be released with consume() */
+  u_int32_t peek(const u_char **data);
+  void consume(u_int32_t len);
+
+  inline u_int32_t getSize()     { return(size);                     };
+  inline u_int32_t getUsed()     { return((u_int32_t)(head - tail)); };
+  inline bool      isEmpty()     { return(head == tail);             };
+};
+
+#endif /* _LIVE_CAPTURE_RING_H_ */
@@ -51,6 +51,8 @@ class LocalHost : public Host {
 
   void initialize();
   virtual bool readDHCPCache();
+  /* DNS/HTTP stats are allocated on first use as most hosts never speak DNS or HTTP */
+  inline DnsStats* getDnsStats() { if(!dns) dns = new(std::nothrow) DnsStats(); return(dns); };
  public:
   LocalHost(NetworkInterface *_iface, Mac *_mac, u_int16_t _vlanId, IpAddress *_ip);
   LocalHost(NetworkInterface *_iface, char *ipAddress, u_int16_t _vlanId);
@@ -66,7 +68,7 @@ class LocalHost : public Host {
   virtual json_object* getJSONObject(DetailsLevel details_level);
   virtual NetworkStats* getNetworkStats(int16_t networkId){ return(iface->getNetworkStats(networkId));   };
   virtual u_int32_t getActiveHTTPHosts()             { return(http ? http->get_num_virtual_hosts() : 0); };
-  virtual HTTPstats* getHTTPstats()                  { return(http);                  };
+  virtual HTTPstats* getHTTPstats(bool createIfNotPresent = false);
   virtual char* get_os()                             { return(os ? os : (char*)"");                    };
 
   virtual bool dropAllTraffic()  { return(drop_all_host_traffic); };
@@ -80,10 +82,10 @@ class LocalHost : public Host {
   virtual void updateHTTPHostRequest(char *virtual_host_name, u_int32_t num_req, u_int32_t bytes_sent, u_int32_t bytes_rcvd);
 
   virtual void incICMP(u_int8_t icmp_type, u_int8_t icmp_code, bool sent, Host *peer);
-  virtual void incNumDNSQueriesSent(u_int16_t query_type) { if(dns) dns->incNumDNSQueriesSent(query_type); };
-  virtual void incNumDNSQueriesRcvd(u_int16_t query_type) { if(dns) dns->incNumDNSQueriesRcvd(query_type); };
-  virtual void incNumDNSResponsesSent(u_int32_t ret_code) { if(dns) dns->incNumDNSResponsesSent(ret_code); };
-  virtual void incNumDNSResponsesRcvd(u_int32_t ret_code) { if(dns) dns->incNumDNSResponsesRcvd(ret_code); };
+  virtual void incNumDNSQueriesSent(u_int16_t query_type) { if(getDnsStats()) dns->incNumDNSQueriesSent(query_type); };
+  virtual void incNumDNSQueriesRcvd(u_int16_t query_type) { if(getDnsStats()) dns->incNumDNSQueriesRcvd(query_type); };
+  virtual void incNumDNSResponsesSent(u_int32_t ret_code) { if(getDnsStats()) dns->incNumDNSResponsesSent(ret_code); };
+  virtual void incNumDNSResponsesRcvd(u_int32_t ret_code) { if(getDnsStats()) dns->incNumDNSResponsesRcvd(ret_code); };
 
   virtual void lua(lua_State* vm, AddressTree * ptree, bool host_details,
 		   bool verbose, bool returnHost, bool asListElement);
@@ -24,37 +24,78 @@
 
 #include "ntop_includes.h"
 
+/*
+  The manufacturers database is a single read-only blob:
+
+  [header][entries sorted by OUI][string offsets sorted by string][string pool]
+
+  It is built from EtherOUI.txt and cached on disk so that the following
+  startups just map it in memory. Strings are stored once and identified
+  by their rank in alphabetical order.
+*/
+#define MAC_MANUFACTURERS_DB_MAGIC   "NTOPOUI"
+#define MAC_MANUFACTURERS_DB_VERSION 1
+
+typedef struct {
+  char magic[8];
+  u_int32_t version;
+  u_int32_t num_entries, num_strings, pool_len;
+  u_int64_t src_size, src_mtime; /* EtherOUI.txt the blob has been built from */
+} mac_manufacturers_db_header_t;
+
 typedef struct {
-  u_int8_t mac_manufacturer[3];
-  char *manufacturer_name;
-  char *short_name;
-  UT_hash_handle hh;
-} mac_manufacturers_t;
+  u_int32_t oui; /* 24 bit */
+  u_int32_t name_id, short_name_id;
+} mac_manufacturers_db_entry_t;
 
 class MacManufacturers {
  private:
-  char manufacturers_file[MAX_PATH];
-  mac_manufacturers_t *mac_manufacturers;
+  char manufacturers_file[MAX_PATH], cache_file[MAX_PATH];
+  u_int8_t *db;
+  size_t db_len;
+  bool db_mapped;
+  const mac_manufacturers_db_header_t *header;
+  const mac_manufacturers_db_entry_t *entries;
+  const u_int32_t *string_offsets;
+  const char *pool;
 
   void init();
+  bool loadCache(u_int64_t src_size, u_int64_t src_mtime);
+  bool parse(u_int64_t src_size, u_int64_t src_mtime);
+  void saveCache();
+  bool setDB(u_int8_t *_db, size_t _db_len, bool mapped);
+  void freeDB();
+  const mac_manufacturers_db_entry_t* find(u_int32_t oui) const;
+
  public:
   MacManufacturers(const char * const mac_file_home);
   ~MacManufacturers();
 
-  inline const char * const getManufacturer(u_int8_t mac[]) {
-    mac_manufacturers_t *m = NULL;
-    HASH_FIND(hh, mac_manufacturers, mac, 3, m);
-    return m ? m->manufacturer_name : NULL;
+  static inline u_int32_t getOUI(const u_int8_t mac[]) { return((mac[0] << 16) | (mac[1] << 8) | mac[2]); };
+
+  inline u_int32_t getNumStrings() const           { return(header ? header->num_strings : 0); };
+  inline const char* getString(u_int32_t id) const { return(&pool[string_offsets[id]]);         };
+
+  inline const char * const getManufacturer(const u_int8_t mac[]) const {
+    const mac_manufacturers_db_entry_t *e = find(getOUI(mac));
+
+    return(e ? getString(e->name_id) : NULL);
   };
 
-  inline void getMacManufacturer(u_int8_t mac[], lua_State *vm) {
-    mac_manufacturers_t *m = NULL;
-    HASH_FIND(hh, mac_manufacturers, mac, 3, m);
+  /**
+   * @brief Resolve many OUIs at once.
+   * @details ouis must be sorted in ascending order: the lookup is a single merge
+   *          with the (sorted) database. ids are set to -1 for unknown OUIs.
+   */
+  void getManufacturerIds(const u_int32_t *ouis, u_int32_t num_ouis, int32_t *ids) const;
+
+  inline void getMacManufacturer(const u_int8_t mac[], lua_State *vm) const {
+    const mac_manufacturers_db_entry_t *e = find(getOUI(mac));
 
-    if (m) {
+    if(e) {
       lua_newtable(vm);
-      lua_push_str_table_entry(vm, "short", m->short_name);
-      lua_push_str_table_entry(vm, "extended", m->manufacturer_name);
+      lua_push_str_table_entry(vm, "short", getString(e->short_name_id));
+      lua_push_str_table_entry(vm, "extended", getString(e->name_id));
     } else {
       lua_pushnil(vm);
     }
@@ -49,6 +49,7 @@ class Mutex {
 
   /* NOTE: this must be called while locked */
   inline int cond_wait(pthread_cond_t *condvar) { return pthread_cond_wait(condvar, &the_mutex); };
+  inline int cond_timedwait(pthread_cond_t *condvar, const struct timespec *abstime) { return pthread_cond_timedwait(condvar, &the_mutex, abstime); };
 };
 
 
@@ -43,6 +43,8 @@ class CountriesHash;
 class DB;
 class Paginator;
 class NetworkInterfaceTsPoint;
+class SubInterfaceTable;
+class SubInterfaceWorker;
 
 #ifdef NTOPNG_PRO
 class AggregatedFlow;
@@ -53,12 +55,6 @@ class TrafficShaper;
 class NIndexFlowDB;
 #endif
 
-typedef struct {
-  u_int32_t criteria;        /* IP address, interface... */
-  NetworkInterface *iface;
-  UT_hash_handle hh;         /* makes this structure hashable */
-} FlowHashing;
-
 /** @class NetworkInterface
  *  @brief Main class of network interface of ntopng.
  *  @details .......
@@ -76,10 +72,11 @@ class NetworkInterface : public Checkpointable {
   u_int32_t num_hashes;
 
   /* Disaggregations */
-  u_int16_t numVirtualInterfaces;
   set<u_int32_t>  flowHashingIgnoredInterfaces;
   FlowHashingEnum flowHashingMode;
-  FlowHashing *flowHashing;
+  SubInterfaceTable *flowHashing;
+  bool flowHashingWorkers;
+  u_int32_t num_dispatch_drops; /* Packets/flows the worker of this dynamic interface couldn't keep up with */
 
   /* Network Discovery */
   NetworkDiscovery *discovery;
@@ -130,6 +127,8 @@ class NetworkInterface : public Checkpointable {
   nDPIStats ndpiStats;
   PacketStats pktStats;
   FlowHash *flows_hash; /**< Hash used to store flows information. */
+  FlowIndex *flow_index; /**< Optional secondary indexes of flows_hash (NULL when disabled). */
+  PacketRecorder *recorder; /**< Native continuous recording (NULL when disabled). */
   u_int32_t last_remote_pps, last_remote_bps;
   u_int8_t packet_drops_alert_perc;
   TimeseriesExporter *tsExporter;
@@ -164,6 +163,7 @@ class NetworkInterface : public Checkpointable {
   HostHash *hosts_hash; /**< Hash used to store hosts information. */
   bool purge_idle_flows_hosts, sprobe_interface, inline_interface;
   DB *db;
+  ColumnarFlowDB *columnar_db; /**< Same as db when dumping with -F columnar */
   StatsManager  *statsManager;
   AlertsManager *alertsManager;
   HostPools *host_pools;
@@ -177,11 +177,11 @@ class NetworkInterface : public Checkpointable {
   InterfaceStatsHash *interfaceStats;
   char checkpoint_compression_buffer[CONST_MAX_NUM_CHECKPOINTS][MAX_CHECKPOINT_COMPRESSION_BUFFER_SIZE];
 
-  PROFILING_DECLARE(24);
+  PROFILING_DECLARE(PROFILING_MAX_NUM_SECTIONS);
 
   void init();
   void deleteDataStructures();
-  NetworkInterface* getSubInterface(u_int32_t criteria, bool parser_interface);
+  NetworkInterface* getSubInterface(u_int32_t criteria, bool parser_interface, SubInterfaceWorker **worker);
   Flow* getFlow(Mac *srcMac, Mac *dstMac, u_int16_t vlan_id,
 		u_int32_t deviceIP, u_int16_t inIndex, u_int16_t outIndex,
   		IpAddress *src_ip, IpAddress *dst_ip,
@@ -227,6 +227,14 @@ class NetworkInterface : public Checkpointable {
 		Host *host,
 		Paginator *p,
 		const char *sortColumn);
+  void walkAndSort(u_int32_t *begin_slot, bool walk_all, WalkerType wtype,
+		   bool (*walker_fn)(GenericHashEntry *h, void *user_data, bool *matched),
+		   struct flowHostRetriever *retriever,
+		   int (*sorter)(const void *_a, const void *_b));
+  void parallelWalkAndSort(WalkerType wtype,
+			   bool (*walker_fn)(GenericHashEntry *h, void *user_data, bool *matched),
+			   struct flowHostRetriever *retriever,
+			   int (*sorter)(const void *_a, const void *_b));
 
   bool isNumber(const char *str);
   bool checkIdle();
@@ -265,9 +273,16 @@ class NetworkInterface : public Checkpointable {
 		      WalkerType wtype,
 		      bool (*walker)(GenericHashEntry *h, void *user_data, bool *entryMatched),
 		      void *user_data);
+  /* Walks the flows of the query through the FlowIndex, when available and walk_all is set, or the whole flows hash */
+  virtual bool flowsWalker(u_int32_t *begin_slot,
+			   bool walk_all,
+			   const FlowIndexQuery *q,
+			   bool (*walker)(GenericHashEntry *h, void *user_data, bool *entryMatched),
+			   void *user_data);
 
   void checkAggregationMode();
   inline void setCPUAffinity(int core_id)      { cpu_affinity = core_id; };
+  inline void incNumDispatchDrops()            { num_dispatch_drops++;   };
   inline void getIPv4Address(bpf_u_int32 *a, bpf_u_int32 *m) { *a = ipv4_network, *m = ipv4_network_mask; };
   virtual void startPacketPolling();
   virtual void shutdown();
@@ -290,6 +305,9 @@ class NetworkInterface : public Checkpointable {
   inline virtual const char* get_type()        { return(customIftype ? customIftype : CONST_INTERFACE_TYPE_UNKNOWN); }
   virtual InterfaceType getIfType()            { return(interface_type_UNKNOWN); }
   inline FlowHash *get_flows_hash()            { return flows_hash;     }
+  inline FlowIndex *getFlowIndex()             { return(flow_index);    }
+  inline PacketRecorder *getPacketRecorder()   { return(recorder);      }
+  inline ColumnarFlowDB *getColumnarFlowDB()   { return(columnar_db);   }
   inline TcpFlowStats* getTcpFlowStats()       { return(&tcpFlowStats); }
   inline virtual bool is_ndpi_enabled()        { return(true);          }
   inline u_int  getNumnDPIProtocols()          { return(ndpi_get_num_supported_protocols(ndpi_struct)); };
@@ -331,6 +349,7 @@ class NetworkInterface : public Checkpointable {
 #if defined(HAVE_NINDEX) && defined(NTOPNG_PRO)
   inline bool dumpnIndexFlow(time_t when, Flow *f)  { return(db ? db->dumpFlow(when, f, NULL) : false); };
 #endif
+  inline bool dumpColumnarFlow(time_t when, Flow *f) { return(columnar_db ? columnar_db->dumpFlow(when, f, NULL) : false); };
   int dumpLocalHosts2redis(bool disable_purge);
   inline void incRetransmittedPkts(u_int32_t num)   { tcpPacketStats.incRetr(num); };
   inline void incOOOPkts(u_int32_t num)             { tcpPacketStats.incOOO(num);  };
@@ -427,6 +446,8 @@ class NetworkInterface : public Checkpointable {
        TrafficType traffic_type_filter, bool tsLua, bool anomalousOnly,
 			 char *sortColumn, u_int32_t maxHits,
 			 u_int32_t toSkip, bool a2zSortOrder);
+  int getActiveHostsList(JSONStream *s, AddressTree *allowed_hosts,
+			 Paginator *p, LocationPolicy location);
   int getActiveHostsGroup(lua_State* vm,
 			  u_int32_t *begin_slot,
 			  bool walk_all,
@@ -475,6 +496,8 @@ class NetworkInterface : public Checkpointable {
   int getFlows(lua_State* vm, AddressTree *allowed_hosts,
 		Host *host,
 		Paginator *p);
+  int getFlows(JSONStream *s, AddressTree *allowed_hosts,
+	       Host *host, Paginator *p);
   int getFlowsGroup(lua_State* vm,
 		AddressTree *allowed_hosts,
 		Paginator *p,
@@ -495,12 +518,15 @@ class NetworkInterface : public Checkpointable {
   virtual u_int     getNumLocalHosts();
   virtual u_int     getNumMacs();
   virtual u_int     getNumHTTPHosts();
+  inline u_int32_t  getNumARPRequests()           { return(arp_requests);      };
+  inline u_int32_t  getNumARPReplies()            { return(arp_replies);       };
+  inline u_int8_t   getNumLiveCaptures()          { return(num_live_captures); };
 
   inline u_int64_t  getNumPacketsSinceReset()     { return getNumPackets() - getCheckPointNumPackets(); }
   inline u_int64_t  getNumBytesSinceReset()       { return getNumBytes() - getCheckPointNumBytes(); }
   inline u_int64_t  getNumPacketDropsSinceReset() { return getNumPacketDrops() - getCheckPointNumPacketDrops(); }
 
-  void runHousekeepingTasks();
+  virtual void runHousekeepingTasks();
   void runShutdownTasks();
   Vlan* getVlan(u_int16_t vlanId, bool createIfNotPresent);
   AutonomousSystem *getAS(IpAddress *ipa, bool createIfNotPresent);
@@ -508,6 +534,9 @@ class NetworkInterface : public Checkpointable {
   virtual Mac*  getMac(u_int8_t _mac[6], bool createIfNotPresent);
   virtual Host* getHost(char *host_ip, u_int16_t vlan_id);
   bool getHostInfo(lua_State* vm, AddressTree *allowed_hosts, char *host_ip, u_int16_t vlan_id);
+  void getHostsInfoBatch(lua_State* vm, AddressTree *allowed_hosts,
+			 const char **host_keys, u_int num_keys,
+			 const HostLuaField *fields, u_int num_fields);
   void findUserFlows(lua_State *vm, char *username);
   void findPidFlows(lua_State *vm, u_int32_t pid);
   void findFatherPidFlows(lua_State *vm, u_int32_t pid);
@@ -526,9 +555,12 @@ class NetworkInterface : public Checkpointable {
   inline FlowInterfacesStats* getFlowInterfacesStats() { return(flow_interfaces_stats);  }
 #endif
   inline HostPools* getHostPools()                     { return(host_pools);    }
+  inline DB* getDB()                                   { return(db);            }
+  virtual const ZMQ_RemoteStats* getRemoteStats()      { return(NULL);          }
 
   bool registerLiveCapture(struct ntopngLuaContext * const luactx, int *id);
   bool deregisterLiveCapture(struct ntopngLuaContext * const luactx);
+  void sendLiveCapture(struct ntopngLuaContext * const luactx);
   void dumpLiveCaptures(lua_State* vm);
   bool stopLiveCapture(int capture_id);
 #ifdef NTOPNG_PRO
@@ -541,6 +573,7 @@ class NetworkInterface : public Checkpointable {
   inline void luaHostPoolsVolatileMembers(lua_State *vm) { if (host_pools) host_pools->luaVolatileMembers(vm); };
 #endif
   void refreshHostPools();
+  void refreshHostPools(pool_member_change_t *changes, u_int32_t num_changes);
   inline u_int16_t getHostPool(Host *h) { if(h && host_pools) return host_pools->getPool(h); return NO_HOST_POOL_ID; };
   inline u_int16_t getHostPool(Mac *m)  { if(m && host_pools) return host_pools->getPool(m); return NO_HOST_POOL_ID; };
 
@@ -653,11 +686,11 @@ class NetworkInterface : public Checkpointable {
   }
 
   void topProtocolsAdd(u_int16_t pool_id, u_int16_t protocol, u_int32_t bytes);
-  inline void luaTopPoolsProtos(lua_State *vm) { frequentProtocols->luaTopPoolsProtocols(vm); }
+  inline void luaTopPoolsProtos(lua_State *vm) { frequentProtocols->lua(vm); }
   void topMacsAdd(Mac *mac, u_int16_t protocol, u_int32_t bytes);
   inline bool isDynamicInterface()                { return(is_dynamic_interface);            };
   inline void setDynamicInterface()               { is_dynamic_interface = true;             };
-  inline void luaTopMacsProtos(lua_State *vm) { frequentMacs->luaTopMacsProtocols(vm); }
+  inline void luaTopMacsProtos(lua_State *vm) { frequentMacs->lua(vm); }
   inline MDNS* getMDNS() { return(mdns); }
   inline NetworkDiscovery* getNetworkDiscovery() { return(discovery); }
   inline void incPoolNumHosts(u_int16_t id, bool isInlineCall) {
@@ -677,6 +710,7 @@ class NetworkInterface : public Checkpointable {
   NIndexFlowDB* getNindex();
 #endif
   inline TimeseriesExporter* getTSExporter() { if(!tsExporter) tsExporter = new TimeseriesExporter(this); return(tsExporter); }
+  inline TimeseriesExporter* getActiveTSExporter() { return(tsExporter); }
   inline uint32_t getMaxSpeed()              { return(ifSpeed);     }
   inline bool isLoopback()                   { return(is_loopback); }
 
@@ -695,6 +729,9 @@ class NetworkInterface : public Checkpointable {
 #ifdef PROFILING
   inline void profiling_section_enter(const char *label, int id) { PROFILING_SECTION_ENTER(label, id); };
   inline void profiling_section_exit(int id) { PROFILING_SECTION_EXIT(id); };
+  inline u_int profiling_num_sections() { return(PROFILING_NUM_SECTIONS); };
+  inline ticks profiling_section_ticks(u_int id) { return(PROFILING_SECTION_TICKS(id)); };
+  inline const char* profiling_section_label(u_int id) { return(PROFILING_SECTION_LABEL(id)); };
 #endif
 };
 
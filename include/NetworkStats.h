@@ -49,6 +49,9 @@ class NetworkStats: public Checkpointable {
     if(broadcast) inner_broadcast.incStats(num_pkts, num_bytes);
   };
 
+  inline u_int64_t getEgressBytes() { return(egress.getNumBytes()); };
+  inline u_int64_t getInnerBytes()  { return(inner.getNumBytes());  };
+
   void lua(lua_State* vm);
   bool serializeCheckpoint(json_object *my_object, DetailsLevel details_level);
 };
@@ -199,7 +199,7 @@ class Ntop {
   void start();
   /**
    * @brief Resolve the host name.
-   * @details Use the redis database to resolve the IP address and get the host name.
+   * @details Look the IP address up in the address cache, resolving it right now when unknown.
    *
    * @param numeric_ip Address IP.
    * @param symbolic Symbolic name.
@@ -208,6 +208,7 @@ class Ntop {
   inline void resolveHostName(char *numeric_ip, char *symbolic, u_int symbolic_len) {
     address->resolveHostName(numeric_ip, symbolic, symbolic_len);
   }
+  inline AddressResolution* getAddressResolution() { return(address); };
   /**
    * @brief Get the geolocation instance.
    *
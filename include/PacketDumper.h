@@ -24,16 +24,42 @@
 
 #include "ntop_includes.h"
 
+/*
+  Writes packets to pcap files of at most max_extracted_pcap_bytes.
+  Packets are copied into PACKET_DUMPER_NUM_BUFFERS aligned buffers that
+  are written with a single writev once all of them are full. When the
+  compress_extracted_pcap preference is set (and zlib is available) the
+  files are written gzip compressed (<n>.pcap.gz).
+*/
 class PacketDumper {
  private:
   NetworkInterface *iface;
-  pcap_dumper_t *dumper;
+  int fd;
   u_int32_t file_id;
   u_int16_t iface_type;
   u_int64_t num_dumped_packets;
   u_int64_t max_bytes_per_file;
   u_int64_t num_bytes_cur_file;
   char *out_path;
+  bool compress, preallocated;
+
+  u_char *buffers[PACKET_DUMPER_NUM_BUFFERS];
+  u_int cur_buffer;
+  u_int32_t cur_buffer_len;
+#ifdef HAVE_ZLIB
+  z_stream zs;
+  u_char *zbuffer;
+#endif
+
+  u_int64_t num_written_bytes, num_writes, write_usec;
+
+  bool allocBuffers();
+  void append(const void *data, u_int32_t len);
+  bool flush(bool finish);
+  bool writeVector(struct iovec *v, int num);
+#ifdef HAVE_ZLIB
+  bool compressVector(const struct iovec *v, int num, bool finish);
+#endif
 
  public:
   PacketDumper(NetworkInterface *i, const char *path);
@@ -47,6 +73,9 @@ class PacketDumper {
   void dumpPacket(const struct pcap_pkthdr *h, const u_char *packet);
   inline u_int64_t get_num_dumped_packets() { return num_dumped_packets; }
   inline u_int64_t get_num_dumped_files()   { return file_id; }
+  inline u_int64_t get_num_written_bytes()  { return num_written_bytes; }
+  inline u_int64_t get_num_writes()         { return num_writes; }
+  inline u_int64_t get_write_usec()         { return write_usec; }
 };
 
 #endif /* _PACKET_DUMPER_H_ */
@@ -0,0 +1,153 @@
+/*
+ *
+ * (C) 2019 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+
+
+
+#ifndef _PACKET_RECORDER_H_
+#define _PACKET_RECORDER_H_
+
+#include "ntop_includes.h"
+
+/*
+  Native continuous packet recorder.
+
+  Packets are written to <pcap dir>/<ifid>/recording/<seq>.pcap segment
+  files of at most RECORDER_SEGMENT_SIZE bytes. Each segment is a plain
+  pcap file; when it is closed an index is written to <seq>.idx with:
+  - for each RECORDER_INDEX_BLOCK_SIZE block of the segment, the
+    oldest and newest second of its packets (timestamps may go backwards
+    with multi-queue or NIC-timestamped captures, hence min/max rather
+    than first/last) and a bloom filter of their hosts and ports
+
+  The packet thread only copies the packets into RECORDER_BUFFER_SIZE
+  buffers and builds the index; full buffers are written by a writer
+  thread with O_DIRECT whenever offset and length are aligned. When no
+  buffer is free the packet is dropped and accounted.
+*/
+
+#define RECORDER_NO_RECORD       0xFFFFFFFF
+#define RECORDER_BLOCK_UNINDEXED 0x01 /* Some packets of the block have no keys */
+
+typedef struct {
+  u_int32_t magic, version;
+  u_int32_t first_sec, last_sec;
+  u_int32_t num_blocks;
+  u_int32_t block_size, bloom_bytes;
+  u_int64_t num_packets, segment_bytes;
+} recorder_index_header_t;
+
+typedef struct {
+  u_int32_t first_record; /* Offset of the first packet starting in the block */
+  u_int32_t min_sec, max_sec;
+  u_int32_t flags;
+  u_int8_t bloom[RECORDER_INDEX_BLOOM_BYTES];
+} recorder_block_t;
+
+/* Index of a segment, built by the packet thread while recording it */
+typedef struct {
+  u_int32_t seq;
+  recorder_index_header_t hdr;
+  recorder_block_t *blocks;
+} recorder_segment_t;
+
+typedef struct {
+  u_char *data; /* RECORDER_BUFFER_SIZE bytes, RECORDER_IO_ALIGNMENT aligned */
+  u_int32_t len, seq;
+  recorder_segment_t *closed_segment; /* Set on the last buffer of a segment */
+} recorder_buffer_t;
+
+class PacketRecorder {
+ private:
+  NetworkInterface *iface;
+  char dir[MAX_PATH];
+  int datalink;
+  u_int64_t max_disk_bytes;
+
+  /* Packet thread */
+  recorder_buffer_t *cur_buffer, *spare_buffer;
+  recorder_segment_t *cur_segment;
+  u_int64_t cur_segment_bytes;
+  time_t cur_buffer_since, cur_pkt_sec;
+  u_int32_t next_seq;
+  bool started, start_failed;
+
+  /* Writer thread */
+  recorder_buffer_t buffers[RECORDER_NUM_BUFFERS];
+  SPSCQueue *full_buffers, *free_buffers;
+  pthread_t writer;
+  volatile bool writer_running;
+  int fd;
+  u_int32_t fd_seq;
+  u_int64_t fd_offset;
+  bool fd_direct, direct_supported;
+  std::deque<std::pair<u_int32_t, u_int64_t> > segments; /* seq, bytes on disk */
+  u_int64_t disk_bytes;
+  u_int32_t num_segments;
+
+  /* Stats */
+  u_int64_t num_packets, num_bytes, num_drops;
+  u_int64_t num_written_bytes, num_write_errors, num_direct_writes;
+
+  bool start();
+  void scanSegments();
+  bool getBuffer(recorder_buffer_t **b);
+  void passBuffer(recorder_segment_t *closed_segment);
+  bool openSegment();
+  void closeSegment();
+  void append(const void *data, u_int32_t len);
+  void indexPacket(const struct pcap_pkthdr * const h, const u_char * const packet);
+
+  bool openSegmentFile(u_int32_t seq);
+  void closeSegmentFile();
+  bool setDirect(bool direct);
+  void writeBuffer(recorder_buffer_t *b);
+  void writeIndex(recorder_segment_t *s);
+  void enforceDiskLimit();
+  static void freeSegment(recorder_segment_t *s);
+
+ public:
+  PacketRecorder(NetworkInterface *_iface, u_int64_t _max_disk_bytes);
+  ~PacketRecorder();
+
+  /* Packet thread */
+  void recordPacket(const struct pcap_pkthdr * const h, const u_char * const packet);
+  void flushIdle(time_t now);
+
+  void writerLoop();
+  void lua(lua_State *vm);
+
+  inline const char* getDir()               { return(dir);               };
+  inline u_int64_t getNumPackets()          { return(num_packets);       };
+  inline u_int64_t getNumDrops()            { return(num_drops);         };
+  inline u_int64_t getNumWrittenBytes()     { return(num_written_bytes); };
+  inline u_int64_t getDiskBytes()           { return(disk_bytes);        };
+
+  static void getSegmentPath(const char *dir, u_int32_t seq, const char *ext, char *buf, u_int buf_len);
+
+  /* Flow-key index */
+  static u_int64_t hashHostKey(const u_int8_t *addr, u_int addr_len);
+  static u_int64_t hashPortKey(u_int16_t port);
+  static void bloomAdd(u_int8_t *bloom, u_int64_t key);
+  static bool bloomTest(const u_int8_t *bloom, u_int64_t key);
+};
+
+#endif /* _PACKET_RECORDER_H_ */
@@ -40,6 +40,7 @@ class Paginator {
   u_int32_t uid_filter, pid_filter;
   u_int32_t deviceIP;
   u_int16_t inIndex, outIndex;
+  bool inIndex_set, outIndex_set; /* 0 is a valid interface index */
   u_int16_t pool_filter;
   u_int8_t *mac_filter;
   DetailsLevel details_level;
@@ -47,10 +48,15 @@ class Paginator {
   LocationPolicy client_mode;
   LocationPolicy server_mode;
 
+  bool setStringOption(const char *key, const char *value);
+  bool setNumericOption(const char *key, int64_t value);
+  bool setBooleanOption(const char *key, bool value);
+
  public:
   Paginator();
   virtual ~Paginator();
   virtual void readOptions(lua_State *L, int index);
+  void readOptions(const char *query_string);
 
   inline u_int16_t maxHits() const    { return(min_val(max_hits, CONST_MAX_NUM_HITS));  }
   inline u_int16_t toSkip() const     { return(to_skip);  }
@@ -99,11 +105,11 @@ class Paginator {
   }
 
   inline bool inIndexFilter(u_int16_t *f) const {
-    if(inIndex) { (*f) = inIndex; return true; } return false;
+    if(inIndex_set) { (*f) = inIndex; return true; } return false;
   }
 
   inline bool outIndexFilter(u_int16_t *f) const {
-    if(outIndex) { (*f) = outIndex; return true; } return false;
+    if(outIndex_set) { (*f) = outIndex; return true; } return false;
   }
 
   inline bool poolFilter(u_int16_t *f) const {
@@ -64,6 +64,7 @@ class ParserInterface : public NetworkInterface {
   virtual bool getCustomAppDetails(u_int32_t remapped_app_id, u_int32_t *const pen, u_int32_t *const app_field, u_int32_t *const app_id);
 #endif
   u_int32_t getNumDroppedPackets() { return zmq_remote_stats ? zmq_remote_stats->sflow_pkt_sample_drops : 0; };
+  virtual const ZMQ_RemoteStats* getRemoteStats() { return(zmq_remote_stats); };
   virtual void lua(lua_State* vm);
 };
 
@@ -86,6 +86,7 @@ class Prefs {
   u_int32_t max_num_packets_per_tiny_flow, max_num_bytes_per_tiny_flow;
   u_int32_t max_num_aggregated_flows_per_export;
   u_int32_t max_extracted_pcap_bytes;
+  bool compress_extracted_pcap;
   u_int32_t max_ui_strlen;
   u_int64_t elephant_flow_remote_to_local_bytes, elephant_flow_local_to_remote_bytes;
   u_int8_t default_l7policy;
@@ -100,7 +101,7 @@ class Prefs {
   u_int http_port, https_port;
   u_int8_t num_interfaces;
   u_int16_t auto_assigned_pool_id;
-  bool dump_flows_on_es, dump_flows_on_mysql, dump_flows_on_ls, dump_flows_on_nindex;
+  bool dump_flows_on_es, dump_flows_on_mysql, dump_flows_on_ls, dump_flows_on_nindex, dump_flows_on_columnar;
   bool read_flows_from_mysql;
   InterfaceInfo *ifNames;
   char *local_networks;
@@ -197,6 +198,7 @@ class Prefs {
   inline bool  do_dump_flows_on_mysql()                 { return(dump_flows_on_mysql);    };
   inline bool  do_dump_flows_on_ls()                    { return(dump_flows_on_ls);       };
   inline bool  do_dump_flows_on_nindex()                { return(dump_flows_on_nindex);   };
+  inline bool  do_dump_flows_on_columnar()              { return(dump_flows_on_columnar); };
     
   int32_t getDefaultPrefsValue(const char *pref_key, int32_t default_value);
   void getDefaultStringPrefsValue(const char *pref_key, char **buffer, const char *default_value);
@@ -347,6 +349,7 @@ class Prefs {
   inline u_int32_t get_longlived_flow_duration()             { return(longlived_flow_duration); };
 
   inline u_int64_t get_max_extracted_pcap_bytes() { return max_extracted_pcap_bytes; };
+  inline bool is_extracted_pcap_compressed()      { return compress_extracted_pcap; };
 
   inline u_int32_t get_safe_search_dns_ip()      { return(safe_search_dns_ip);                          };
   inline u_int32_t get_global_primary_dns_ip()   { return(global_primary_dns_ip);                       };
@@ -0,0 +1,68 @@
+/*
+ *
+ * (C) 2019 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+
+#ifndef _PROMETHEUS_EXPORTER_H_
+#define _PROMETHEUS_EXPORTER_H_
+
+#include "ntop_includes.h"
+
+/*
+  Renders the ntopng metrics in the Prometheus text exposition format
+  (version 0.0.4) directly from the in-memory counters, without going
+  through the Lua engine. The output buffer is reused across scrapes, and
+  it is sent to the scraper after releasing the lock.
+  The "ifaces" and "hosts" families of the former metrics.lua script
+  are still exported for the existing dashboards.
+*/
+class PrometheusExporter {
+ private:
+  Mutex m;
+  char *buf;
+  u_int32_t buf_len, buf_size;
+
+  void append(const char *fmt, ...);
+  void appendHeader(const char *name, const char *type, const char *help);
+  void appendLabel(const char *value);
+  void appendLegacy(const char *family, const char *ifname, const char *ip, const char *metric, u_int64_t value);
+
+  void dumpInterfaces();
+  void dumpHashTables();
+  void dumpHashChains();
+  void dumpFlowIndexes();
+  void dumpRecording();
+  void dumpTimeseriesExport();
+  void dumpFlowAlerts();
+  void dumpGeolocation();
+  void dumpAddressResolution();
+  void dumpHostPools();
+  void dumpExporters();
+  void dumpLocalHosts(u_int32_t max_num_hosts);
+  void dumpLegacyInterfaces();
+
+ public:
+  PrometheusExporter();
+  ~PrometheusExporter();
+
+  int handleRequest(struct mg_connection *conn, const struct mg_request_info *request_info);
+};
+
+#endif /* _PROMETHEUS_EXPORTER_H_ */
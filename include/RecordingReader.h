@@ -0,0 +1,87 @@
+/*
+ *
+ * (C) 2019 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+
+
+
+#ifndef _RECORDING_READER_H_
+#define _RECORDING_READER_H_
+
+#include "ntop_includes.h"
+
+/*
+  Reads back the segments written by PacketRecorder, in recording order.
+
+  The index of each segment is used to skip the segments, and the blocks
+  of a segment, whose min/max seconds lie outside of the requested
+  interval. When the BPF filter is a conjunction of host and port
+  primitives, the blocks whose bloom filter lacks any of the filter
+  hosts/ports are skipped as well.
+  Segments without an index (i.e. the one being recorded) are scanned.
+*/
+class RecordingReader {
+ private:
+  char dir[MAX_PATH];
+  int datalink;
+  time_t from, to;
+  struct bpf_program fcode;
+  bool has_filter;
+  u_int64_t keys[RECORDER_MAX_FILTER_KEYS];
+  u_int num_keys;
+
+  std::vector<u_int32_t> seqs;
+  u_int next_segment;
+
+  /* Current segment */
+  u_char *map;
+  size_t map_len;
+  u_int64_t pos, end;
+  recorder_index_header_t hdr;
+  recorder_block_t *blocks;
+  u_int32_t num_blocks, cur_block;
+
+  struct {
+    u_int32_t segments_read, segments_skipped;
+    u_int64_t blocks_skipped, packets_read, packets_matched;
+  } stats;
+
+  bool parseFilterKeys(const char * const bpf_filter);
+  bool loadIndex(u_int32_t seq);
+  bool openSegment(u_int32_t seq);
+  void closeSegment();
+  bool skipBlocks();
+
+ public:
+  RecordingReader(const char * const _dir, int _datalink);
+  ~RecordingReader();
+
+  /* false when the filter is not valid */
+  bool open(time_t _from, time_t _to, const char * const bpf_filter);
+  /* 1 when a packet is returned, 0 at the end of the recording */
+  int next(struct pcap_pkthdr *h, const u_char **packet);
+
+  inline u_int32_t getNumSegmentsRead()    { return(stats.segments_read);    };
+  inline u_int32_t getNumSegmentsSkipped() { return(stats.segments_skipped); };
+  inline u_int64_t getNumBlocksSkipped()   { return(stats.blocks_skipped);   };
+  inline u_int64_t getNumPacketsRead()     { return(stats.packets_read);     };
+};
+
+#endif /* _RECORDING_READER_H_ */
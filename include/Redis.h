@@ -48,9 +48,6 @@ class Redis {
   void reconnectRedis();
   int msg_push(const char * const cmd, const char * const queue_name, const char * const msg, u_int queue_trim_size,
 	       bool trace_errors = true, bool head_trim = true);
-  int pushHost(const char* ns_cache, const char* ns_list, char *hostname,
-	       bool dont_check_for_existence, bool localHost);
-  int popHost(const char* ns_list, char *hostname, u_int hostname_len);
   void addToCache(const char * const key, const char * const value, u_int expire_secs);
   bool isCacheable(const char * const key);
   bool expireCache(char *key, u_int expire_sec);
@@ -80,11 +77,11 @@ class Redis {
   int hashKeys(const char *pattern, char ***keys_p);
   int hashGetAll(const char *key, char ***keys_p, char ***values_p);
   int del(char *key);
-  int pushHostToResolve(char *hostname, bool dont_check_for_existence, bool localHost);
-  int popHostToResolve(char *hostname, u_int hostname_len);
 
-  int getAddress(char *numeric_ip, char *rsp, u_int rsp_len, bool queue_if_not_found);
+  /* Persistence of the names resolved by AddressResolution */
+  int getAddress(char *numeric_ip, char *rsp, u_int rsp_len);
   int setResolvedAddress(char *numeric_ip, char *symbolic_ip);
+  int delResolvedAddress(const char *numeric_ip);
 
   int sadd(const char *set_name, char *item);
   int srem(const char *set_name, char *item);
@@ -93,6 +90,7 @@ class Redis {
 
   int lpush(const char * const queue_name, const char * const msg, u_int queue_trim_size, bool trace_errors = true);
   int rpush(const char * const queue_name, const char * const msg, u_int queue_trim_size);
+  int rpush(const char * const queue_name, const char * const * const msgs, u_int num_msgs, u_int queue_trim_size);
   int lindex(const char *queue_name, int idx, char *buf, u_int buf_len);
   int ltrim(const char *queue_name, int start_idx, int end_idx);
   u_int hstrlen(const char * const key, const char * const value);
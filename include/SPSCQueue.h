@@ -75,7 +75,7 @@ class SPSCQueue {
       q->shadow_tail = next_tail;
 
       if((q->shadow_tail & QUEUE_WATERMARK_MASK) == 0) {
-        // gcc_mb();
+        gcc_mb();
         q->tail = q->shadow_tail;
       }
 
@@ -100,7 +100,7 @@ class SPSCQueue {
 
       q->shadow_head = next_head;
       if(flush || (q->shadow_head & QUEUE_WATERMARK_MASK) == 0) {
-        // gcc_mb();
+        gcc_mb();
         q->head = q->shadow_head;
       }
 
@@ -0,0 +1,95 @@
+/*
+ *
+ * (C) 2019 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+
+
+#ifndef _SUB_INTERFACE_TABLE_H_
+#define _SUB_INTERFACE_TABLE_H_
+
+#include "ntop_includes.h"
+
+/*
+  Dispatch table from a disaggregation criterion (VLAN Id, probe IP,
+  interface index, VRF Id) to the dynamic interface handling it.
+
+  VLAN Ids index a MAX_NUM_VLAN slots array directly; the other criteria
+  use a small open addressing table sized to stay at most 1/4 full, so
+  lookups end after a couple of probes. Entries are never removed and
+  are published with a barrier once fully initialized: lookups (one per
+  packet/flow) do not take any lock. Insertions are serialized.
+*/
+
+typedef struct {
+  u_int32_t criteria;
+  NetworkInterface *iface;
+  SubInterfaceWorker *worker; /* NULL when processed by the parent thread */
+} SubInterfaceEntry;
+
+class SubInterfaceTable {
+ private:
+  bool direct_indexed;
+  u_int32_t num_slots, slots_mask;
+  SubInterfaceEntry * volatile *slots;
+  SubInterfaceEntry entries[MAX_NUM_VIRTUAL_INTERFACES];
+  volatile u_int16_t num_entries;
+  Mutex m;
+
+  inline u_int32_t slot(u_int32_t criteria) { return(KeyedHash::combine(0, criteria) & slots_mask); };
+
+ public:
+  SubInterfaceTable(bool _direct_indexed);
+  ~SubInterfaceTable();
+
+  /**
+   * @brief Lock-free lookup.
+   * @return The entry of criteria or NULL when not yet added.
+   */
+  inline SubInterfaceEntry* get(u_int32_t criteria) {
+    if(direct_indexed)
+      return((criteria < num_slots) ? slots[criteria] : NULL);
+
+    for(u_int32_t i = slot(criteria); ; i = (i + 1) & slots_mask) {
+      SubInterfaceEntry *e = slots[i];
+
+      if((e == NULL) || (e->criteria == criteria))
+	return(e);
+    }
+  }
+
+  /**
+   * @brief Add an interface for criteria, optionally processed by its own worker thread.
+   * @return The new entry, the existing one if criteria was already
+   *         added, or NULL when the table is full or criteria can't be indexed.
+   */
+  SubInterfaceEntry* add(u_int32_t criteria, NetworkInterface *iface, bool with_worker);
+
+  /**
+   * @brief Stop all the worker threads. The interfaces are left untouched.
+   */
+  void stopWorkers();
+
+  inline bool isFull()                   { return(num_entries >= MAX_NUM_VIRTUAL_INTERFACES); };
+  inline bool canIndex(u_int32_t criteria) { return(!direct_indexed || (criteria < num_slots));  };
+  inline u_int16_t getNumEntries()       { return(num_entries); };
+  inline SubInterfaceEntry* getEntry(u_int16_t i) { return(&entries[i]); };
+};
+
+#endif /* _SUB_INTERFACE_TABLE_H_ */
@@ -0,0 +1,104 @@
+/*
+ *
+ * (C) 2019 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+
+
+#ifndef _SUB_INTERFACE_WORKER_H_
+#define _SUB_INTERFACE_WORKER_H_
+
+#include "ntop_includes.h"
+
+/*
+  Thread owning the processing of one dynamic (disaggregated) interface.
+
+  The parent interface thread is the only producer: it copies the packet
+  (or the ZMQ flow, strings included) into a job and hands it over with
+  an SPSCQueue. From then on the sub-interface hashes are only touched
+  by this thread, which also takes care of purging them. When the queue
+  is full the job is dropped and accounted as a sub-interface drop.
+*/
+
+typedef enum {
+  subiface_job_flow = 0,
+  subiface_job_packet
+} SubInterfaceJobType;
+
+typedef struct {
+  SubInterfaceJobType type;
+
+  /* subiface_job_flow */
+  ZMQ_Flow *flow;
+
+  /* subiface_job_packet */
+  u_int32_t bridge_iface_idx, rawsize;
+  bool ingressPacket, ipv4;
+  u_int64_t packet_time;
+  u_int16_t vlan_id, ipsize;
+  u_int32_t ip_offset; /* Offset of the IP header inside data */
+  struct ndpi_ethhdr eth;
+  struct pcap_pkthdr h;
+  u_char *data;        /* Packet (h.caplen bytes), possibly followed by the IP header */
+} SubInterfaceJob;
+
+class SubInterfaceWorker {
+ private:
+  NetworkInterface *iface;
+  SPSCQueue *queue;
+  pthread_t thread;
+  volatile bool running;
+  bool thread_started;
+
+  bool enqueue(SubInterfaceJob *job);
+  void processJob(SubInterfaceJob *job);
+  static void freeJob(SubInterfaceJob *job);
+
+ public:
+  SubInterfaceWorker(NetworkInterface *_iface);
+  ~SubInterfaceWorker();
+
+  bool start();
+  void stop();
+  void run();
+
+  /**
+   * @brief Queue a copy of a ZMQ flow for the sub-interface.
+   * @details The additional fields are passed already serialized in
+   * additional_fields_json, as the json-c object can't be shared.
+   * @return false when the flow has been dropped.
+   */
+  bool enqueueFlow(ZMQ_Flow *zflow, const char *additional_fields_json);
+
+  /**
+   * @brief Queue a copy of a decoded packet for the sub-interface.
+   * @details Same arguments as NetworkInterface::processPacket.
+   * @return false when the packet has been dropped.
+   */
+  bool enqueuePacket(u_int32_t bridge_iface_idx, bool ingressPacket,
+		     const u_int64_t packet_time, struct ndpi_ethhdr *eth,
+		     u_int16_t vlan_id, struct ndpi_iphdr *iph,
+		     struct ndpi_ipv6hdr *ip6, u_int16_t ipsize,
+		     u_int32_t rawsize, const struct pcap_pkthdr *h,
+		     const u_char *packet);
+
+  inline NetworkInterface* getInterface() { return(iface); };
+};
+
+#endif /* _SUB_INTERFACE_WORKER_H_ */
@@ -24,6 +24,8 @@
 
 #include "ntop_includes.h"
 
+class RecordingReader;
+
 class TimelineExtract {
  private:
   pthread_t extraction_thread;
@@ -34,6 +36,8 @@ class TimelineExtract {
   struct {
     u_int64_t packets;
     u_int64_t bytes;
+    u_int64_t written_bytes; /* On disk, after compression */
+    u_int64_t write_usec;
   } stats;
 
   struct {
@@ -43,13 +47,26 @@ class TimelineExtract {
     time_t to;
     char *bpf_filter;
     u_int64_t max_bytes;
-    const char * timeline_path;
+    char *timeline_path;
   } extraction;
 
+  /* Either an n2disk timeline or the native recording of the interface */
+  struct {
+#ifdef HAVE_PF_RING
+    pfring *handle;
+#endif
+    RecordingReader *reader;
+  } source;
+
 #ifdef HAVE_PF_RING
   pfring *openTimeline(const char * const timeline_path, time_t from, time_t to, const char * const bpf_filter);
   pfring *openTimelineFromInterface(NetworkInterface *iface, time_t from, time_t to, const char * const bpf_filter);
 #endif
+  bool getRecordingDir(NetworkInterface *iface, char *dir, u_int dir_len);
+  RecordingReader *openRecording(const char * const dir, int datalink, time_t from, time_t to, const char * const bpf_filter);
+  bool openSource(NetworkInterface *iface, time_t from, time_t to, const char * const bpf_filter, const char * const timeline_path);
+  int nextPacket(struct pcap_pkthdr *h, const u_char **packet);
+  void closeSource();
 
  public:
   TimelineExtract();
@@ -24,26 +24,76 @@
 
 #include "ntop_includes.h"
 
+/* Line protocol points exported together */
+typedef struct {
+  char *data;
+  u_int32_t len, num_points;
+  time_t since, until;
+} TimeseriesBatch;
+
+/*
+  InfluxDB exporter: points are appended to an in-memory batch which is
+  queued when full or older than CONST_INFLUXDB_FLUSH_TIME. A sender
+  thread compresses the queued batches and POSTs them to InfluxDB over
+  a persistent connection. When InfluxDB can't be reached, posts are
+  retried with an exponential backoff and the batches exceeding
+  CONST_INFLUXDB_MAX_QUEUED_BATCHES are spilled to <ifid>/ts_export, to
+  be sent before the newer ones once InfluxDB is back.
+*/
 class TimeseriesExporter {
  private:
-  time_t flushTime;
-  u_int32_t cursize;
-  u_int32_t num_exports;
-  int fd;
-  char fbase[PATH_MAX], fname[PATH_MAX+32];
   NetworkInterface *iface;
-  u_int num_cached_entries; 
+  char spool_dir[PATH_MAX];
   Mutex m;
-  bool dbCreated;
-  
-  void createDump();
-  
+  TimeseriesBatch cur;
+  std::deque<TimeseriesBatch> queue;
+  std::deque<std::string> spilled; /* Oldest first, sender thread only */
+  volatile u_int32_t num_spilled;
+  u_int32_t next_spill_id;
+
+  pthread_t sender;
+  volatile bool sender_running, sender_started;
+  CURL *curl;
+  char url[512], username[64], password[64], dbname[64];
+  u_int32_t backoff_secs;
+  time_t next_attempt;
+
+  /* Stats */
+  u_int64_t num_points, num_sent_points, num_raw_bytes, num_sent_bytes, num_dropped_points;
+  u_int32_t num_batches, num_failures, num_rejected_batches;
+  u_int64_t last_num_points;
+  struct timeval last_rate_update;
+  float points_rate;
+  long last_response_code;
+  char last_error[256]; /* Protected by m */
+
+  void queueBatch(); /* Locked */
+  bool readConfig();
+  u_char* compress(const TimeseriesBatch *b, u_int32_t *out_len, bool *gzipped);
+  int post(const u_char *data, u_int32_t len, bool gzipped);
+  int send(const TimeseriesBatch *b);
+  void spill(TimeseriesBatch *b);
+  int sendSpilled();
+  void onSent(u_int32_t num_points, time_t until);
+  void onFailure(int rc);
+  void setLastError(const char *err);
+  void loadSpilled();
+  void updateRate();
+
  public:
   TimeseriesExporter(NetworkInterface *_if);
   ~TimeseriesExporter();
 
   void exportData(char *data, bool do_lock = true);
   void flush();
+  void senderLoop();
+
+  inline u_int64_t getNumPoints()        { return(num_points);          };
+  inline u_int64_t getNumSentBytes()     { return(num_sent_bytes);      };
+  inline u_int64_t getNumDroppedPoints() { return(num_dropped_points);  };
+  inline u_int32_t getNumFailures()      { return(num_failures);        };
+  u_int32_t getNumQueuedBatches();
+  void lua(lua_State *vm);
 };
 
 #endif /* _TS_EXPORTER_H_ */
@@ -25,6 +25,20 @@
 #include "ntop_includes.h"
 
 class ViewInterface : public NetworkInterface {
+ private:
+  /* Sums of the sub-interfaces counters, refreshed at most every VIEW_COUNTERS_REFRESH_SECS */
+  struct view_counters {
+    u_int64_t num_packets, num_bytes;
+    u_int64_t checkpoint_num_packets, checkpoint_num_bytes;
+    u_int32_t num_packet_drops, checkpoint_num_packet_drops;
+    u_int num_flows, num_l2_devices, num_hosts, num_local_hosts, num_macs, num_http_hosts;
+  } counters;
+  time_t counters_last_refresh;
+  Mutex counters_lock; /* Refreshes can be requested by several threads at once */
+
+  void refreshCounters(time_t now); /* Locked */
+  void getCounters(struct view_counters *c);
+
  public:
   ViewInterface(const char *_endpoint);
 
@@ -66,7 +80,13 @@ class ViewInterface : public NetworkInterface {
 		      bool (*walker)(GenericHashEntry *h,
 				     void *user_data, bool *entryMatched),
 		      void *user_data);
+  virtual bool flowsWalker(u_int32_t *begin_slot, bool walk_all,
+			   const FlowIndexQuery *q,
+			   bool (*walker)(GenericHashEntry *h,
+					  void *user_data, bool *entryMatched),
+			   void *user_data);
   
+  virtual void runHousekeepingTasks();
   virtual void lua(lua_State* vm);
 };
 
@@ -34,11 +34,20 @@ class VlanAddressTree {
 
   bool addAddress(u_int16_t vlan_id, char *_net, const int16_t user_data = -1);
   bool addAddresses(u_int16_t vlan_id, char *net, const int16_t user_data = -1);
+  void compile();
 
   int16_t findAddress(u_int16_t vlan_id, int family, void *addr, u_int8_t *network_mask_bits = NULL);
   int16_t findMac(u_int16_t vlan_id, u_int8_t addr[]);
 
   inline AddressTree *getAddressTree(u_int16_t vlan_id) { return tree[vlan_id]; };
+  /* Publishes t for vlan_id: the previous tree is returned to the caller that must free it */
+  inline AddressTree *setAddressTree(u_int16_t vlan_id, AddressTree *t) {
+    AddressTree *old = tree[vlan_id];
+
+    gcc_mb(); /* t must be fully built before readers can see it */
+    tree[vlan_id] = t;
+    return(old);
+  };
 };
 
 #endif
@@ -0,0 +1,126 @@
+/*
+ *
+ * (C) 2019 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+
+#ifndef _WALKER_FILTER_H_
+#define _WALKER_FILTER_H_
+
+#include "ntop_includes.h"
+
+class Paginator;
+
+/* Instructions are evaluated in the order of this enum (see compileFlowFilter) */
+typedef enum {
+  flow_filter_host = 0,
+  flow_filter_vlan,
+  flow_filter_port,
+  flow_filter_l7proto,
+  flow_filter_l7category,
+  flow_filter_ip_version,
+  flow_filter_device,
+  flow_filter_asn,
+  flow_filter_local_network,
+  flow_filter_pool,
+  flow_filter_mac,
+  flow_filter_client_mode,
+  flow_filter_server_mode,
+  flow_filter_unidirectional,
+  flow_filter_unicast,
+  flow_filter_uid,
+  flow_filter_pid,
+#ifdef HAVE_NEDGE
+  flow_filter_filtered,
+#endif
+  flow_filter_alerted,
+
+  host_filter_vlan,
+  host_filter_location,
+  host_filter_asn,
+  host_filter_local_network,
+  host_filter_pool,
+  host_filter_ip_version,
+  host_filter_mac,
+  host_filter_country,
+  host_filter_blacklisted,
+  host_filter_hidden_from_top,
+  host_filter_traffic_type,
+#ifdef NTOPNG_PRO
+  host_filter_filtered,
+#endif
+  host_filter_anomalous,
+  host_filter_l7proto,
+  host_filter_os,
+  walker_filter_never /* Nothing can match */
+} WalkerFilterOp;
+
+/* walker_filter_insn_t flags: the aux values to compare (0 is a valid value) */
+#define WALKER_FILTER_AUX0_SET  0x01
+#define WALKER_FILTER_AUX1_SET  0x02
+
+typedef struct {
+  u_int8_t op, flags;
+  u_int16_t aux[2];
+  union {
+    Host *host;
+    u_int32_t u32;
+    int32_t i32;
+    bool b;
+    u_int8_t mac[6];
+    const char *str;
+  } v;
+} walker_filter_insn_t;
+
+#define MAX_WALKER_FILTER_INSNS 32
+
+/*
+  Search filters of the flows and hosts walkers compiled into a
+  short program: only the filters that are set are evaluated, cheap
+  and selective comparisons first, and the string filters are
+  resolved to numeric values once per query rather than per entry.
+  The program is plain data so that it can be copied with the
+  retriever (e.g. by the view walkers).
+*/
+class WalkerFilter {
+ private:
+  walker_filter_insn_t insns[MAX_WALKER_FILTER_INSNS];
+  u_int8_t num_insns;
+
+  walker_filter_insn_t* addInsn(WalkerFilterOp op);
+
+ public:
+  inline void reset()                  { num_insns = 0; };
+  inline u_int8_t getNumInsns() const  { return(num_insns); };
+
+  void compileFlowFilter(Paginator *p, Host *host);
+  void compileHostFilter(LocationPolicy location, u_int16_t vlan_id,
+			 int ndpi_proto, u_int32_t asn, int16_t network,
+			 const u_int8_t *mac, u_int16_t pool,
+			 const char *country, const char *os,
+			 bool blacklisted, bool anomalous, bool hide_top_hidden,
+			 TrafficType traffic_type, bool filtered, u_int8_t ip_version);
+
+  void getFlowIndexQuery(FlowIndexQuery *q) const;
+
+  bool matchFlow(Flow *f) const;
+  bool matchHost(Host *h) const;
+};
+
+#endif /* _WALKER_FILTER_H_ */
@@ -81,6 +81,10 @@ class nDPIStats {
       return(0); 
   }
 
+  inline const ProtoCounter* getProtoCounter(u_int16_t proto_id) const {
+    return((proto_id < MAX_NDPI_PROTOS) ? counters[proto_id] : NULL);
+  }
+
   inline u_int32_t getProtoDuration(u_int16_t proto_id) {
     if((proto_id < MAX_NDPI_PROTOS) && counters[proto_id])
       return counters[proto_id]->duration;
@@ -123,6 +123,8 @@
 #define LIVE_TRAFFIC_URL          "/lua/live_traffic.lua"
 #define POOL_MEMBERS_ASSOC_URL    "/lua/admin/manage_pool_members.lua"
 #define INTERFACE_DATA_URL        "/lua/get_interface_data.lua"
+#define REST_GET_FLOWS_URL        "/rest/get/flows.json"
+#define REST_GET_HOSTS_URL        "/rest/get/hosts.json"
 #define MAX_PASSWORD_LEN          32 + 1 /* \0 */
 #define HTTP_SESSION_DURATION              43200  // 12h
 #define HTTP_SESSION_MIDNIGHT_EXPIRATION   false
@@ -141,6 +143,9 @@
 #define CAPWAP_DATA_PORT          5247
 #define MAX_NUM_INTERFACE_HOSTS   131072
 #define MAX_NUM_VIEW_INTERFACES   8
+#define FREQUENT_TRAFFIC_ITEMS_CAPACITY   64 /* Space-Saving counters per top-N dimension */
+#define VIEW_PARALLEL_WALK_MIN_ENTRIES  4096 /* Smaller views are walked sequentially */
+#define VIEW_COUNTERS_REFRESH_SECS         1
 
 #define LIMITED_NUM_INTERFACES    32
 #define LIMITED_NUM_HOST_POOLS    4 /* 3 pools plus the NO_HOST_POOL_ID */
@@ -184,7 +189,6 @@
 #define DOMAIN_WHITELIST_CAT    "ntopng.domain.whitelist"
 #define DNS_CACHE               "ntopng.dns.cache"
 #define DHCP_CACHE              "ntopng.dhcp.%d.cache"
-#define DNS_TO_RESOLVE          "ntopng.dns.toresolve"
 #define NTOPNG_TRACE            "ntopng.trace"
 #define TRACES_PER_LOG_FILE_HIGH_WATERMARK 10000
 #define MAX_NUM_NTOPNG_LOG_FILES           5
@@ -200,12 +204,26 @@
 
 #define TRAFFIC_FILTERING_CACHE_DURATION  43200 /* 12 h */
 #define DNS_CACHE_DURATION                 3600  /*  1 h */
+#define DNS_MIN_CACHE_DURATION               60  /* Lower bound for the TTL of the PTR answers */
+#define DNS_NEGATIVE_CACHE_DURATION         300  /*  5 min */
+#define DNS_PENDING_DURATION                 60  /* Max time an address waits to be resolved before being queued again */
+#ifdef NTOPNG_EMBEDDED_EDITION
+#define DNS_CACHE_MAX_ENTRIES              4096
+#else
+#define DNS_CACHE_MAX_ENTRIES             65536
+#endif
+#define DNS_CACHE_MAX_KEY_LEN                64
+#define DNS_MAX_NAMESERVERS                   3
+#define DNS_MAX_INFLIGHT_QUERIES             64  /* Per resolver thread */
+#define DNS_QUERY_TIMEOUT_MSEC             1500
+#define DNS_QUERY_MAX_TRIES                   3
 #define LOCAL_HOSTS_CACHE_DURATION         3600  /*  1 h */
 #define CONST_ALERT_PROBING_TIME            120  /* 2 mins */
 #define CONST_TCP_CHECK_ISSUES_RATIO         10  /* 10% */
 #define HOST_LABEL_NAMES        "ntopng.host_labels"
 #define HOST_SERIALIZED_KEY     "ntopng.serialized_hosts.ifid_%u__%s@%d"
 #define MAC_SERIALIZED_KEY      "ntopng.serialized_macs.ifid_%u__%s"
+#define HOST_POOLS_RETIRE_GRACE_SECS      2 /* Lifetime of the trees and stats replaced by a reload */
 #define HOST_POOL_SERIALIZED_KEY "ntopng.serialized_host_pools.ifid_%u"
 #define NTOPNG_PREFS_PREFIX     "ntopng.prefs"
 #define NTOPNG_CACHE_PREFIX     "ntopng.cache"
@@ -257,12 +275,46 @@
 #define CONST_DEMO_MODE_DURATION       600 /* 10 min */
 #define CONST_MAX_DUMP_DURATION        300 /* 5 min */
 #define CONST_MAX_NUM_PACKETS_PER_LIVE 100000 /* live captures via HTTP */
+#define CONST_LIVE_CAPTURE_RING_SIZE   (4*1024*1024) /* bytes, per live capture */
+#define CONST_LIVE_CAPTURE_IDLE_USEC   10000
+
+/* Native packet recorder (PacketRecorder/RecordingReader) */
+#define RECORDER_SEGMENT_SIZE          (128*1024*1024) /* bytes, max size of a segment file */
+#define RECORDER_BUFFER_SIZE           (4*1024*1024)   /* bytes, unit of the writes */
+#define RECORDER_NUM_BUFFERS           16
+#define RECORDER_IO_ALIGNMENT          4096            /* O_DIRECT alignment */
+#define RECORDER_INDEX_BLOCK_SIZE      (1024*1024)     /* bytes of segment covered by a flow-key block */
+#define RECORDER_INDEX_BLOOM_BYTES     1024
+#define RECORDER_INDEX_BLOOM_HASHES    3
+#define RECORDER_INDEX_MAGIC           0x4e524958 /* NRIX */
+#define RECORDER_INDEX_VERSION         2
+#define RECORDER_FLUSH_SECS            2   /* Max time a packet waits in a partially filled buffer */
+#define RECORDER_WRITER_IDLE_USEC      10000
+#define RECORDER_DEFAULT_MAX_DISK_MB   10240
+#define RECORDER_MAX_FILTER_KEYS       8
+
+/* Columnar flow store (-F columnar) */
+#define FLOW_STORE_CHUNK_ROWS          65536 /* rows encoded together */
+#define FLOW_STORE_PARTITION_SECS      3600  /* one file per partition */
+#define FLOW_STORE_FLUSH_SECS          60    /* max time a row waits before being written */
+#define FLOW_STORE_MAX_QUEUED_CHUNKS   8
+#define FLOW_STORE_CHUNK_MAGIC         0x5346434e /* NCFS */
+#define FLOW_STORE_VERSION             1
+#define FLOW_STORE_DEFAULT_RETENTION_DAYS 30
+#define FLOW_STORE_MAX_RESULTS         1000
+#define PROMETHEUS_DEFAULT_MAX_NUM_HOSTS 1024 /* /metrics per-host series cap */
+#define HASH_CHAIN_HISTOGRAM_SLOTS       7    /* Chain length <= 0, 1, 2, 4, 8, 16, +Inf */
 #define CONST_MAX_DUMP                 500000000
 
 #define CONST_MAX_NUM_LIVE_EXTRACTIONS 2
+#define CONST_LIVE_EXTRACTION_CHUNK_SIZE (256*1024) /* bytes sent to the client with a single write */
 
 #define CONST_MAX_EXTR_PCAP_BYTES NTOPNG_PREFS_PREFIX".max_extracted_pcap_bytes"
 #define CONST_DEFAULT_MAX_EXTR_PCAP_BYTES (100*1024*1024)
+#define CONST_COMPRESS_EXTR_PCAP NTOPNG_PREFS_PREFIX".compress_extracted_pcap"
+#define PACKET_DUMPER_BUFFER_SIZE     (1024*1024) /* bytes */
+#define PACKET_DUMPER_NUM_BUFFERS     8           /* written with a single writev */
+#define PACKET_DUMPER_IO_ALIGNMENT    4096
 
 #define MIN_CONNTRACK_UPDATE           3  /* sec */
 #define MIN_NETFILTER_UPDATE           30 /* sec */
@@ -375,6 +427,7 @@
 #define MAX_NUM_FLOW_DEVICES          48
 #define MAX_NUM_VLAN                4096
 #define MAX_NUM_VIRTUAL_INTERFACES    32
+#define SUBINTERFACE_WORKER_IDLE_USEC 1000
 #define PASS_ALL_SHAPER_ID             0
 #define DROP_ALL_SHAPER_ID             1
 #define DEFAULT_SHAPER_ID              PASS_ALL_SHAPER_ID
@@ -474,9 +527,13 @@
 #define CONST_AGGREGATIONS            "aggregations"
 #define CONST_HOST_CONTACTS           "host_contacts"
 
-#define CONST_INFLUXDB_FILE_QUEUE          "ntopng.influx_file_queue"
 #define CONST_INFLUXDB_FLUSH_TIME          10 /* sec */
-#define CONST_INFLUXDB_MAX_DUMP_SIZE       4194304 /* 4 MB */
+#define CONST_INFLUXDB_MAX_DUMP_SIZE       4194304 /* 4 MB: max uncompressed batch */
+#define CONST_INFLUXDB_MAX_QUEUED_BATCHES  8   /* In memory, beyond them batches are spilled to disk */
+#define CONST_INFLUXDB_MAX_SPILLED_BATCHES 256
+#define CONST_INFLUXDB_MAX_BACKOFF         60  /* sec */
+#define CONST_INFLUXDB_POST_TIMEOUT        5   /* sec */
+#define CONST_INFLUXDB_EXPORT_TIME         "ntopng.cache.influxdb_export_time_%s_%d"
 #define CONST_ALERT_MSG_QUEUE              "ntopng.alert_queue"
 #define CONST_ALERT_MAC_IP_QUEUE           "ntopng.alert_mac_ip_queue"
 #define CONST_ALERT_NFQ_FLUSHED            "ntopng.alert_nfq_flushed_queue"
@@ -583,6 +640,12 @@
 #define CONST_RUNTIME_PREFS_SNMP_PROTO_VERSION         NTOPNG_PREFS_PREFIX".default_snmp_version"
 #define CONST_RUNTIME_PREFS_IFACE_FLOW_COLLECTION      NTOPNG_PREFS_PREFIX".dynamic_flow_collection_mode" /* {"none", "vlan", "probe_ip","ingress_iface_idx"} */
 #define CONST_RUNTIME_PREFS_IGNORED_INTERFACES         NTOPNG_PREFS_PREFIX".ignored_interfaces"
+#define CONST_RUNTIME_PREFS_DYNAMIC_IFACE_WORKERS      NTOPNG_PREFS_PREFIX".dynamic_iface_workers" /* 0 / 1 */
+#define CONST_RUNTIME_PREFS_FLOW_INDEXES               NTOPNG_PREFS_PREFIX".flow_indexes" /* 0 / 1 */
+#define CONST_RUNTIME_PREFS_NATIVE_RECORDING           NTOPNG_PREFS_PREFIX".native_recording" /* 0 / 1 */
+#define CONST_RUNTIME_PREFS_NATIVE_RECORDING_MAX_DISK  NTOPNG_PREFS_PREFIX".native_recording_max_disk" /* MB */
+#define CONST_RUNTIME_PREFS_FLOW_STORE_RETENTION       NTOPNG_PREFS_PREFIX".flow_store_retention_days"
+#define CONST_RUNTIME_PREFS_DNS_CACHE_PERSISTENCE      NTOPNG_PREFS_PREFIX".dns_cache_persistence" /* 0 / 1 (default) */
 #define CONST_RUNTIME_PREFS_ENABLE_MAC_NDPI_STATS      NTOPNG_PREFS_PREFIX".l2_device_ndpi_timeseries_creation"
 #define CONST_RUNTIME_TS_NUM_SLOTS                     NTOPNG_PREFS_PREFIX".ts_write_slots"
 #define CONST_RUNTIME_TS_NUM_STEPS                     NTOPNG_PREFS_PREFIX".ts_write_steps"
@@ -810,6 +873,9 @@
 #define ALERTS_MANAGER_MAKE_ROOM_FLOW_ALERTS "ntopng.cache.alerts.ifid_%i.make_room_flow_alerts"
 #define ALERTS_MANAGER_TYPE_FIELD            "alert_type"
 #define ALERTS_MANAGER_SEVERITY_FIELD        "alert_severity"
+#define ALERTS_MANAGER_FLOW_ALERTS_QUEUE_LEN 8192   /* Flow alerts waiting for the writer thread */
+#define ALERTS_MANAGER_FLOW_ALERTS_BATCH     256    /* Flow alerts written in a single transaction */
+#define ALERTS_MANAGER_FLOW_ALERTS_IDLE_USEC 100000
 #define STATS_MANAGER_STORE_NAME             "top_talkers.db"
 
 #define ALERTS_MANAGER_NOTIFICATION_QUEUE_NAME "ntopng.alerts.notifications_queue"
@@ -908,6 +974,9 @@
 #define QUEUE_ITEMS_MASK        (QUEUE_ITEMS - 1)
 #define QUEUE_WATERMARK         8 /* pow of 2 */
 #define QUEUE_WATERMARK_MASK    (QUEUE_WATERMARK - 1)
+#ifndef gcc_mb
+#define gcc_mb()                __sync_synchronize()
+#endif
 
 #define SSL_HANDSHAKE_PACKET          0x16
 #define SSL_PAYLOAD_PACKET            0x17
@@ -995,12 +1064,14 @@ extern struct ntopngLuaContext* getUserdata(struct lua_State *vm);
 #define ALERT_ACTION_STORE            "store"
 
 //#define PROFILING
+#define PROFILING_MAX_NUM_SECTIONS   24
 #ifdef PROFILING
 #define PROFILING_DECLARE(n) \
         ticks __profiling_sect_start[n]; \
         const char *__profiling_sect_label[n]; \
         ticks __profiling_sect_tot[n]
-#define PROFILING_INIT() memset(__profiling_sect_tot, 0, sizeof(__profiling_sect_tot))
+#define PROFILING_INIT() memset(__profiling_sect_tot, 0, sizeof(__profiling_sect_tot)), \
+			 memset(__profiling_sect_label, 0, sizeof(__profiling_sect_label))
 #define PROFILING_SECTION_ENTER(l,i) __profiling_sect_start[i] = Utils::getticks(), __profiling_sect_label[i] = l
 #define PROFILING_SECTION_EXIT(i)    __profiling_sect_tot[i] += Utils::getticks() - __profiling_sect_start[i]
 #define PROFILING_SUB_SECTION_ENTER(f, l, i) f->profiling_section_enter(l, i)
@@ -1008,6 +1079,7 @@ extern struct ntopngLuaContext* getUserdata(struct lua_State *vm);
 #define PROFILING_NUM_SECTIONS (sizeof(__profiling_sect_tot)/sizeof(ticks))
 #define PROFILING_SECTION_AVG(i,n) (__profiling_sect_tot[i] / n)
 #define PROFILING_SECTION_LABEL(i) __profiling_sect_label[i]
+#define PROFILING_SECTION_TICKS(i) __profiling_sect_tot[i]
 #else
 #define PROFILING_DECLARE(n)
 #define PROFILING_INIT()
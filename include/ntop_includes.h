@@ -41,6 +41,7 @@
 #include <sys/un.h>
 #include <pthread.h>
 #include <sys/wait.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <poll.h>
@@ -72,6 +73,7 @@
 #include <dirent.h>
 #include <pwd.h>
 #include <sys/select.h>
+#include <sys/mman.h>
 #endif
 
 #ifdef __linux__
@@ -135,6 +137,7 @@ extern "C" {
 #endif
 #include <curl/curl.h>
 
+#include "KeyedHash.h" /* Before uthash.h: it overrides HASH_FUNCTION */
 #include "third-party/uthash.h"
 
 #ifdef HAVE_MYSQL
@@ -172,6 +175,7 @@ using namespace std;
 #include "Mutex.h"
 #include "RwLock.h"
 #include "MDNS.h"
+#include "CompiledAddressTree.h"
 #include "AddressTree.h"
 #include "VlanAddressTree.h"
 #include "AddressList.h"
@@ -211,6 +215,7 @@ using namespace std;
 #include "Prefs.h"
 #include "ProtoStats.h"
 #include "Utils.h"
+#include "JSONStream.h"
 #include "CommunityIdFlowHash.h"
 #include "DnsStats.h"
 #include "NetworkStats.h"
@@ -238,6 +243,7 @@ using namespace std;
 #ifdef HAVE_MYSQL
 #include "MySQLDB.h"
 #endif
+#include "ColumnarFlowDB.h"
 #include "InterfaceStatsHash.h"
 #include "GenericHashEntry.h"
 #if defined(NTOPNG_PRO) && defined(HAVE_NINDEX)
@@ -255,8 +261,14 @@ using namespace std;
 #include "TimeseriesRing.h"
 #include "HostTimeseriesPoint.h"
 #include "SPSCQueue.h"
+#include "LiveCaptureRing.h"
+#include "PacketRecorder.h"
+#include "RecordingReader.h"
 #include "NetworkInterfaceTsPoint.h"
+#include "FlowIndex.h"
 #include "NetworkInterface.h"
+#include "SubInterfaceWorker.h"
+#include "SubInterfaceTable.h"
 #ifndef HAVE_NEDGE
 #include "PcapInterface.h"
 #endif
@@ -331,9 +343,12 @@ using namespace std;
 #include "PeriodicActivities.h"
 #include "LuaEngine.h"
 #include "MacManufacturers.h"
+#include "DnsCache.h"
 #include "AddressResolution.h"
+#include "PrometheusExporter.h"
 #include "HTTPserver.h"
 #include "Paginator.h"
+#include "WalkerFilter.h"
 #include "Ntop.h"
 
 #ifdef WIN32
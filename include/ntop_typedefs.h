@@ -213,6 +213,7 @@ typedef struct {
 typedef struct zmq_flow {
   ZMQ_FlowCore core;
   json_object *additional_fields;
+  char *additional_fields_json; /* Serialized additional_fields of the flows queued to sub-interface workers */
   char *http_url, *http_site, *dns_query, *ssl_server_name, *bittorrent_hash;
   custom_app_t custom_app;
   /* Process Extensions */
@@ -477,6 +478,53 @@ typedef struct {
 
 #endif
 
+/* Host pools member, keyed by <address>@<vlan> */
+typedef struct {
+  char *key;
+  int32_t pool_id;          /* Pool configured in redis, -1 if none */
+  int32_t volatile_pool_id; /* Captive portal pool, -1 if none */
+  int32_t reload_pool_id;   /* Pool found by the reload in progress */
+  u_int32_t reload_epoch;
+  UT_hash_handle hh; /* makes this structure hashable */
+} pool_member_t;
+
+/* A member whose pool has changed: pool_id is -1 when it is no longer a member */
+typedef struct {
+  char *key;
+  int32_t pool_id;
+} pool_member_change_t;
+
+/* Host fields that can be projected by the batch host lookups (see Host::luaProjection) */
+typedef enum {
+  host_field_ip = 0,
+  host_field_vlan,
+  host_field_ipkey,
+  host_field_name,
+  host_field_mac,
+  host_field_localhost,
+  host_field_systemhost,
+  host_field_is_blacklisted,
+  host_field_asn,
+  host_field_asname,
+  host_field_country,
+  host_field_os,
+  host_field_host_pool_id,
+  host_field_seen_first,
+  host_field_seen_last,
+  host_field_duration,
+  host_field_bytes_sent,
+  host_field_bytes_rcvd,
+  host_field_packets_sent,
+  host_field_packets_rcvd,
+  host_field_throughput_bps,
+  host_field_throughput_pps,
+  host_field_active_flows_as_client,
+  host_field_active_flows_as_server,
+  host_field_num_alerts,
+  host_field_anomalies,
+  host_field_unknown /* Must be the last one */
+} HostLuaField;
+
 /*
   NOTE:
   Keep in sync with discover.lua (asset_icons)
@@ -503,9 +551,38 @@ typedef struct {
   NDPI_PROTOCOL_BITMASK clientAllowed, serverAllowed;
 } DeviceProtocolBitmask;
 
+/* Flow details reported in the "status_info" of flow alerts */
+typedef struct {
+  DeviceType cli_devtype, srv_devtype;
+  char devproto_forbidden_peer[4]; /* "cli", "srv" or empty when no protocol is forbidden */
+  u_int16_t devproto_forbidden_id;
+} FlowStatusInfo;
+
+/*
+  Self-contained copy of the flow fields needed to store and notify
+  a flow alert: the flow can go away before the alert is written.
+*/
+typedef struct {
+  time_t when;
+  FlowStatus status;
+  u_int32_t status_map;
+  AlertType alert_type;
+  AlertLevel alert_severity;
+  u_int16_t vlan_id, cli_port, srv_port, l7_proto, cli_host_pool_id, srv_host_pool_id;
+  u_int8_t proto, cli2srv_tcpflags, srv2cli_tcpflags;
+  bool cli_blacklisted, srv_blacklisted, cli_localhost, srv_localhost;
+  u_int32_t first_seen, last_seen, cli_asn, srv_asn;
+  u_int64_t cli2srv_bytes, srv2cli_bytes, cli2srv_packets, srv2cli_packets;
+  FlowStatusInfo status_info;
+  char cli_ip[48], srv_ip[48];           /* Empty when unknown */
+  char cli_country[8], srv_country[8];
+  char *cli_os, *srv_os, *info;          /* malloc'ed, possibly NULL */
+} FlowAlert;
+
 #ifndef HAVE_NEDGE
 class SNMP; /* Forward */
 #endif
+class LiveCaptureRing; /* Forward */
 
 struct ntopngLuaContext {
   char *allowed_ifname, *user, *group;
@@ -530,9 +607,11 @@ struct ntopngLuaContext {
   /* Live capture written to mongoose socket */
   struct {
     u_int32_t capture_until, capture_max_pkts, num_captured_packets;
+    u_int32_t num_dropped_packets; /* Ring full */
     void *matching_host;
     bool bpfFilterSet;
     struct bpf_program fcode;
+    LiveCaptureRing *ring; /* Filled by the packet thread, drained by the HTTP thread */
     
     /* Status */
     bool pcaphdr_sent;
@@ -590,6 +669,20 @@ typedef struct {
   double namelookup, connect, appconnect, pretransfer, redirect, start, total;
 } HTTPTranferStats;
 
+/* Geolocation of a host, cached until the databases are reloaded (see Geolocation::getInfo) */
+typedef struct {
+  const char *continent_code, *country_code, *city; /* Interned: never freed */
+  float latitude, longitude;
+  u_int32_t db_epoch; /* 0 = not yet resolved */
+} GeoInfo;
+
+/* Bucket chain lengths of a GenericHash (see GenericHash::getChainStats) */
+typedef struct {
+  u_int32_t num_buckets[HASH_CHAIN_HISTOGRAM_SLOTS]; /* Not cumulative */
+  u_int32_t max_chain_len;
+  u_int64_t num_entries;
+} HashChainStats;
+
 struct pcap_disk_timeval {
   u_int32_t tv_sec;
   u_int32_t tv_usec;
@@ -109,9 +109,12 @@ for _, ifname in pairs(interface.getIfNames()) do
    -- Note: we do not delete this as quotas are persistent across ntopng restart
    --deletePoolsQuotaExceededItemsKey(ifid)
 
-   -- Clean old InfluxDB export cache
-   local export_dir = os_utils.fixPath(dirs.workingdir .. "/".. ifid .."/ts_export")
-   ntop.rmdir(export_dir)
+   -- Clean the InfluxDB export cache, unless InfluxDB is still the timeseries
+   -- driver: in that case the exporter sends the batches left by the previous run
+   if ntop.getPref("ntopng.prefs.timeseries_driver") ~= "influxdb" then
+      local export_dir = os_utils.fixPath(dirs.workingdir .. "/".. ifid .."/ts_export")
+      ntop.rmdir(export_dir)
+   end
 end
 
 -- ##################################################################
@@ -137,6 +140,12 @@ recording_utils.checkAvailable()
 
 -- ##################################################################
 
+-- Files queue of the previous InfluxDB exporter: their files are now
+-- sent by the exporter of each interface
+ntop.delCache("ntopng.influx_file_queue")
+
+-- ##################################################################
+
 initCustomnDPIProtoCategories()
 lists_utils.reloadLists() -- housekeeping will do the actual reload...
 
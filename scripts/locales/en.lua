@@ -2328,6 +2328,8 @@ local lang = {
     ["n2disk_license_version"] = "n2disk version: %{version}",
     ["n2n_supernode_description"] = "The address of the <a href=\"%{url}\">n2n</a> <i class=\"fa fa-external-link\"></i> supernode. Set up your own supernode in order to have a fully private remote access.<br>NOTE: this change will have affect only after Remote Assistance restart.",
     ["n2n_supernode_title"] = "Supernode",
+    ["native_recording_max_disk_description"] = "Disk space (in MB) used by the native traffic recording of each interface. The oldest segments are deleted when exceeded. Changes require a restart.",
+    ["native_recording_max_disk_title"] = "Traffic Recording Disk Space",
     ["nagios_host_name_description"] = "The host_name exactly as specified in Nagios host definition for the %{product} host. Default: ntopng-host",
     ["nagios_host_name_title"] = "Nagios host_name",
     ["nagios_integration"] = "Nagios Integration",
@@ -2450,6 +2452,8 @@ local lang = {
     ["toggle_dropped_flows_alerts_title"] = "Enable Blocked Flows Alerts",
     ["toggle_dst_with_post_nat_dst_description"] = "Replace IPv4 destination addresses (%%IPV4_DST_ADDR) and ports (%%L4_DST_PORT) with their post-nat values (%%POST_NAT_DST_IPV4_ADDR and %%POST_NAPT_DST_TRANSPORT_PORT).",
     ["toggle_dst_with_post_nat_dst_title"] = "Use Post-Nat Destination IPv4 Addresses and Ports",
+    ["toggle_dynamic_iface_workers_description"] = "Process each dynamic interface on its own thread instead of the thread of the interface it has been disaggregated from. Packets and flows a dynamic interface cannot keep up with are accounted as drops of that interface. Changes require a restart.",
+    ["toggle_dynamic_iface_workers_title"] = "Dynamic Interfaces Threads",
     ["toggle_elephant_flows_alerts_description"] = "Toggle alerts generated when an elephant flow has been detected. This is useful to detect unwanted behaviours (e.g. data exfiltration).",
     ["toggle_elephant_flows_alerts_title"] = "Elephant Flows Alerts",
     ["toggle_email_notification_description"] = "Toggle alerts notifications via email.",
@@ -2458,6 +2462,8 @@ local lang = {
     ["toggle_flow_alerts_iface_title"] = "Enable Flow Alerts",
     ["toggle_flow_db_dump_export_description"] = "Toggle the export of tiny flows, that are flows with few packets or bytes. Reduces flow cardinality in databases, speeds-up inserts and searches. Tuning tiny flows can help to limit flow cardinality while not reducing visibility on dumped information.",
     ["toggle_flow_db_dump_export_title"] = "Tiny Flows Export",
+    ["toggle_flow_indexes_description"] = "Index the flows of each interface by host, application protocol and port, so that the flows of a host, protocol or port are listed without scanning all the active flows. Each indexed flow takes about 100 additional bytes of memory. Changes require a restart.",
+    ["toggle_flow_indexes_title"] = "Flow Indexes",
     ["toggle_flow_rrds_description"] = "Toggle the creation of bytes timeseries for each port of the remote device as received through ZMQ (e.g. sFlow/NetFlow/SNMP).<br>For non sFlow devices, %%INPUT_SNMP and %%OUTPUT_SNMP must appear into the nprobe template.",
     ["toggle_flow_rrds_title"] = "Flow Devices",
     ["toggle_host_mask_description"] = "For privacy reasons it might be necessary to mask hosts IP addresses. For instance if you are an ISP you are not supposed to know which local addresses are accessing remote hosts.",
@@ -2494,6 +2500,8 @@ local lang = {
     ["toggle_mysql_check_open_files_limit_title"] = "Enable MySQL alerts",
     ["toggle_ndpi_timeseries_creation_description"] = "Toggle the creation of Layer-7 application timeseries. Creating a timeseries per protocol requires more disk space and extra I/O and, in general, it is not needed.",
     ["toggle_ndpi_timeseries_creation_title"] = "Layer-7 Applications",
+    ["toggle_native_recording_description"] = "Continuously record the traffic of the packet interfaces to time-indexed pcap segments under the pcap data directory, with no need for n2disk. Traffic extractions use the recorded segments when no timeline is specified. Changes require a restart.",
+    ["toggle_native_recording_title"] = "Native Traffic Recording",
     ["toggle_network_discovery_description"] = "Toggle the periodic discovery of network devices using multiple techniques that include ARP scan, MDNS and SSDP.<p><b>NOTE:</b> discovery can be <u>only</u> enabled on physical interfaces  (i.e. no ZMQ) where we can send/receive traffic to the network (i.e. read-only interfaces such as those connected to port mirrors won't work). ",
     ["toggle_network_discovery_title"] = "Active Network Discovery",
     ["toggle_pool_activation_alert_description"] = "Toggle alerts generated when the first host connects or the last host disconnect from some pool.",
@@ -2918,6 +2926,8 @@ local lang = {
     ["active_since"] = "Active Since",
     ["archive"] = "Archive",
     ["completed"] = "Completed",
+    ["compress_extracted_pcap_description"] = "Write the extracted pcap files gzip compressed (.pcap.gz). Compressed files take less disk space and can be opened by Wireshark, but the extraction is limited by the compression speed.",
+    ["compress_extracted_pcap_title"] = "Compress Extracted Files",
     ["continuous_recording"] = "Continuous Traffic Recording",
     ["continuous_recording_and_flows"] = "Continuous Traffic Recording and Flow Visibility",
     ["delete_all_jobs"] = "Delete All Jobs",
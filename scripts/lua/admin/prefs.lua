@@ -246,6 +246,12 @@ function printInterfaces()
   			  ternary(not isEmptyString(cur_mode), cur_mode, "none"), true,
 			  {keys=values, save_pref=true, pref_key=cur_mode_key})
 
+  prefsToggleButton(subpage_active, {
+	field = "toggle_dynamic_iface_workers",
+	default = "0",
+	pref = "dynamic_iface_workers",
+  })
+
   print('<tr><th colspan=2 class="info">'..i18n("prefs.zmq_interfaces")..'</th></tr>')
 
   prefsInputFieldPrefs(subpage_active.entries["ignored_interfaces"].title,
@@ -889,6 +895,12 @@ function printRecording()
     "ntopng.prefs.", "max_extracted_pcap_bytes", prefs.max_extracted_pcap_bytes, 
     "number", true, nil, nil, {min=10*1024*1024, format_spec = FMT_TO_DATA_BYTES, tformat="mg"})
 
+  prefsToggleButton(subpage_active, {
+    field = "toggle_compress_extracted_pcap",
+    default = "0",
+    pref = "compress_extracted_pcap",
+  })
+
   -- ######################
 
   print('<tr><th colspan=2 style="text-align:right;"><button type="submit" class="btn btn-primary" style="width:115px" disabled="disabled">'..i18n("save")..'</button></th></tr>')
@@ -1260,6 +1272,23 @@ function printInMemory()
 		       "ntopng.prefs.", "flow_max_idle", prefs.flow_max_idle, "number", nil, nil, nil,
 		       {min=1, max=3600, tformat="smh"})
 
+  prefsToggleButton(subpage_active, {
+    field = "toggle_flow_indexes",
+    default = "0",
+    pref = "flow_indexes",
+  })
+
+  prefsToggleButton(subpage_active, {
+    field = "toggle_native_recording",
+    default = "0",
+    pref = "native_recording",
+  })
+
+  prefsInputFieldPrefs(subpage_active.entries["native_recording_max_disk"].title, subpage_active.entries["native_recording_max_disk"].description,
+		       "ntopng.prefs.", "native_recording_max_disk",
+		       tonumber(ntop.getPref("ntopng.prefs.native_recording_max_disk")) or 10240, "number", nil, nil, nil,
+		       {min=128, max=1024*1024*1024})
+
   local has_high_resolution = ((tonumber(ntop.getPref("ntopng.prefs.ts_write_steps")) or 0) > 0)
 
   prefsInputFieldPrefs(subpage_active.entries["housekeeping_frequency"].title,
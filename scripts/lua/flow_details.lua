@@ -557,7 +557,17 @@ else
    end
 
    if interface.isPacketInterface() then
-      print("<tr><th width=30%>"..i18n("flow_details.flow_status").."</th><td colspan=2>"..getFlowStatus(flow["flow.status"], flow2statusinfo(flow)).."</td></tr>\n")
+      local status_info = flow2statusinfo(flow)
+      local statuses = {getFlowStatus(flow["flow.status"], status_info)}
+
+      -- Other conditions matched by the flow
+      for _, status in ipairs(getFlowStatusList(flow["flow.status_map"])) do
+	 if status ~= flow["flow.status"] then
+	    statuses[#statuses + 1] = getFlowStatus(status, status_info)
+	 end
+      end
+
+      print("<tr><th width=30%>"..i18n("flow_details.flow_status").."</th><td colspan=2>"..table.concat(statuses, "<br>").."</td></tr>\n")
    end
 
    if((flow.client_process == nil) and (flow.server_process == nil)) then
@@ -39,7 +39,8 @@ else
     send_error("not_found")
   else
     local file = job_files[file_id]
-    sendHTTPContentTypeHeader('application/vnd.tcpdump.pcap', 'attachment; filename="extraction_'..job_id..'_'..file_id..'.pcap"')
+    local ext = ternary(string.ends(file, ".gz"), ".pcap.gz", ".pcap")
+    sendHTTPContentTypeHeader('application/vnd.tcpdump.pcap', 'attachment; filename="extraction_'..job_id..'_'..file_id..ext..'"')
     ntop.dumpBinaryFile(file)
   end
 end
@@ -28,13 +28,14 @@ local res = {}
 for k,v in pairs(lc) do
    local host = ""
    local num_captured_packets = format_utils.formatValue(v.num_captured_packets)
+   local num_dropped_packets = format_utils.formatValue(v.num_dropped_packets or 0)
    local capture_max_pkts = v.capture_max_pkts
    local diff = v.capture_until - os.time()
    local capture_until = format_utils.formatEpoch(v.capture_until).." [ - "..diff.." sec ]"
    local stop_href = "<A HREF=".. ntop.getHttpPrefix() .."/lua/stop_live_capture.lua?capture_id="..v.id.."><span class=\"label label-danger\">Stop <i class=\"fa fa-download\"></i></span></A>"
 
    if(v.host ~= nil) then host = v.host end
-   res[#res + 1] = { host = host, num_captured_packets = num_captured_packets, capture_until = capture_until, stop_href = stop_href }
+   res[#res + 1] = { host = host, num_captured_packets = num_captured_packets, num_dropped_packets = num_dropped_packets, capture_until = capture_until, stop_href = stop_href }
 end
 
 result["data"] = res
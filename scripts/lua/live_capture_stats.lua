@@ -37,6 +37,9 @@ print [[
             }, {
             title: "Captured Packets",
             field: "num_captured_packets",
+           }, {
+            title: "Dropped Packets",
+            field: "num_dropped_packets",
            }, {
             title: "Capture Until",
             field: "capture_until",
@@ -2366,7 +2366,7 @@ function check_networks_alerts(ifid, working_status)
    end
 end
 
-function check_host_alerts(ifid, working_status, host)
+function check_host_alerts(ifid, working_status, host, host_anomalies)
    local entity_value = hostinfo2hostkey(hostkey2hostinfo(host), nil, true --[[force vlan]])
    local old_entity_info, new_entity_info
 
@@ -2384,8 +2384,12 @@ function check_host_alerts(ifid, working_status, host)
 
    -- attach anomalies to the new entity info (no need to attach them to the old)
    if new_entity_info ~= nil then
-      local host_stats = interface.getHostInfo(host) or {}
-      new_entity_info["anomalies"] = host_stats["anomalies"] or {}
+      if host_anomalies == nil then
+         local host_stats = interface.getHostInfo(host) or {}
+         host_anomalies = host_stats["anomalies"]
+      end
+
+      new_entity_info["anomalies"] = host_anomalies or {}
    end
 
    if (new_entity_info == nil) then
@@ -2410,12 +2414,32 @@ function check_hosts_alerts(ifid, working_status)
    local local_hosts_iterator = callback_utils.getLocalHostsIterator(false --[[no details]])
    local remote_hosts_iterator = callback_utils.getRemoteHostsIterator(false --[[no details]], nil, true --[[ only hosts with anomalies ]])
 
+   local hosts = {}
+
    for host, _ in local_hosts_iterator do
-      check_host_alerts(ifid, working_status, host)
+      hosts[#hosts + 1] = host
    end
 
    for host, _ in remote_hosts_iterator do
-      check_host_alerts(ifid, working_status, host)
+      hosts[#hosts + 1] = host
+   end
+
+   -- Fetch the anomalies of a chunk of hosts at once
+   local chunk_size = 512
+
+   for first = 1, #hosts, chunk_size do
+      local chunk = {}
+
+      for i = first, math.min(first + chunk_size - 1, #hosts) do
+         chunk[#chunk + 1] = hosts[i]
+      end
+
+      local hosts_stats = interface.getHostsInfoBatch(chunk, {"anomalies"}) or {}
+
+      for _, host in ipairs(chunk) do
+         local host_stats = hosts_stats[host] or {}
+         check_host_alerts(ifid, working_status, host, host_stats["anomalies"] or {})
+      end
    end
 end
 
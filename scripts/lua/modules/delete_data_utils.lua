@@ -61,12 +61,12 @@ end
 
 local function delete_host_redis_keys(interface_id, host_info)
    local status = "OK"
-   local serialized_k, dns_k, devnames_k, devtypes_k
+   local serialized_k, dns_ip, devnames_k, devtypes_k
 
    if not isMacAddress(host_info["host"]) then
       -- this is an IP address, see HOST_SERIALIZED_KEY (ntop_defines.h)
       serialized_k = string.format("ntopng.serialized_hosts.ifid_%u__%s@%d", interface_id, host_info["host"], host_info["vlan"] or "0")
-      dns_k = string.format("ntopng.dns.cache.%s", host_info["host"]) -- neither vlan nor ifid implemented for the dns cache
+      dns_ip = host_info["host"] -- neither vlan nor ifid implemented for the dns cache
    elseif isIPv4(host_info["host"]) or isIPv6(host_info["host"]) then
       -- is a mac address, see MAC_SERIALIED_KEY (see ntop_defines.h)
       serialized_k = string.format("ntopng.serialized_macs.ifid_%u__%s", interface_id, host_info["host"])
@@ -78,7 +78,7 @@ local function delete_host_redis_keys(interface_id, host_info)
       if serialized_k then ntop.delCache(serialized_k) end
       if devnames_k   then ntop.delCache(devnames_k) end
       if devtypes_k   then ntop.delCache(devtypes_k) end
-      if dns_k        then ntop.delCache(dns_k) end
+      if dns_ip       then ntop.delResolvedName(dns_ip) end -- also drops the in-memory name
    end
 
    return {status = status}
@@ -0,0 +1,40 @@
+--
+-- (C) 2019 - ntop.org
+--
+
+-- Driver of the embedded columnar flow store (-F columnar)
+
+local driver = {}
+
+function driver:new(options)
+  local obj = {}
+
+  setmetatable(obj, self)
+  self.__index = self
+
+  return obj
+end
+
+-- filter: epoch_begin, epoch_end, limit, offset and optionally
+-- host, port, l4_proto, l7_proto, vlan and sort (bytes, packets, flows)
+function driver:topk(ifid, what_k, filter)
+   local options = {}
+
+   for k, v in pairs(filter or {}) do
+      if k ~= "epoch_begin" and k ~= "epoch_end" then
+	 options[k] = v
+      end
+   end
+
+   interface.select(tostring(ifid))
+
+   local res = interface.queryFlowStore(filter.epoch_begin or 0, filter.epoch_end or os.time(), what_k, options)
+
+   if res == nil then
+      return {}
+   end
+
+   return res.results
+end
+
+return driver
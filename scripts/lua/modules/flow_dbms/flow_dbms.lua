@@ -9,7 +9,7 @@ local driver
 
 local available_tops = {"host", "src_host", "dst_host",
 			"port", "src_port", "dst_port",
-			"conversations"}
+			"l7_proto", "conversations"}
 
 local function checkTop(what_k)
    for _, k in pairs(available_tops) do
@@ -22,6 +22,8 @@ end
 function flow_dbms:new()
    if ntop.getPrefs().is_dump_flows_to_mysql_enabled == true then
       driver = require("mysql"):new()
+   elseif ntop.getPrefs().is_dump_flows_to_columnar_enabled == true then
+      driver = require("columnar"):new()
    else --[[ if nindex is enabled... --]]
    end
 
@@ -1088,6 +1088,10 @@ local known_parameters = {
    ["toggle_tcp_flags_rrds"]                       = validateBool,
    ["toggle_tcp_retr_ooo_lost_rrds"]               = validateBool,
    ["toggle_dst_with_post_nat_dst"]                = validateBool,
+   ["toggle_dynamic_iface_workers"]                = validateBool,
+   ["toggle_flow_indexes"]                         = validateBool,
+   ["toggle_native_recording"]                     = validateBool,
+   ["toggle_compress_extracted_pcap"]              = validateBool,
    ["toggle_src_with_post_nat_src"]                = validateBool,
    ["toggle_device_activation_alert"]              = validateBool,
    ["toggle_device_first_seen_alert"]              = validateBool,
@@ -1134,6 +1138,7 @@ local known_parameters = {
    ["longlived_flow_duration"]                     = validateNumber,
    ["non_local_host_max_idle"]                     = validateNumber,
    ["flow_max_idle"]                               = validateNumber,
+   ["native_recording_max_disk"]                   = validateNumber,
    ["active_local_host_cache_interval"]            = validateNumber,
    ["auth_session_duration"]                       = validateNumber,
    ["local_host_cache_duration"]                   = validateNumber,
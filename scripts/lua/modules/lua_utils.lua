@@ -2516,6 +2516,25 @@ function getFlowStatus(status, flowstatus_info)
   end
 end
 
+-- Returns the list of the statuses set in a flow "flow.status_map"
+function getFlowStatusList(status_map)
+   local res = {}
+   local status = 0
+
+   status_map = status_map or 0
+
+   while status_map > 0 do
+      if status_map % 2 == 1 then
+	 res[#res + 1] = status
+      end
+
+      status_map = math.floor(status_map / 2)
+      status = status + 1
+   end
+
+   return res
+end
+
 -- prints purged information for hosts / flows
 function purgedErrorString()
     local info = ntop.getInfo(false)
@@ -103,6 +103,9 @@ local menu_subpages = {
     dynamic_interfaces_creation = {
       title       = i18n("prefs.dynamic_interfaces_creation_title"),
       description = i18n("prefs.dynamic_interfaces_creation_description"),
+    }, toggle_dynamic_iface_workers = {
+      title       = i18n("prefs.toggle_dynamic_iface_workers_title"),
+      description = i18n("prefs.toggle_dynamic_iface_workers_description"),
     }, ignored_interfaces = {
       title       = i18n("prefs.ignored_interfaces_title"),
       description = i18n("prefs.ignored_interfaces_description", {product=info.product}),
@@ -123,6 +126,15 @@ local menu_subpages = {
     }, flow_max_idle = {
       title       = i18n("prefs.flow_max_idle_title"),
       description = i18n("prefs.flow_max_idle_description"),
+    }, toggle_flow_indexes = {
+      title       = i18n("prefs.toggle_flow_indexes_title"),
+      description = i18n("prefs.toggle_flow_indexes_description"),
+    }, toggle_native_recording = {
+      title       = i18n("prefs.toggle_native_recording_title"),
+      description = i18n("prefs.toggle_native_recording_description"),
+    }, native_recording_max_disk = {
+      title       = i18n("prefs.native_recording_max_disk_title"),
+      description = i18n("prefs.native_recording_max_disk_description"),
     }, housekeeping_frequency = {
       title       = i18n("prefs.housekeeping_frequency_title"),
       description = i18n("prefs.housekeeping_frequency_description", {product=info["product"]}),
@@ -415,6 +427,9 @@ local menu_subpages = {
     max_extracted_pcap_bytes = {
       title       = i18n("traffic_recording.max_extracted_pcap_bytes_title"),
       description = i18n("traffic_recording.max_extracted_pcap_bytes_description"),
+    }, toggle_compress_extracted_pcap = {
+      title       = i18n("traffic_recording.compress_extracted_pcap_title"),
+      description = i18n("traffic_recording.compress_extracted_pcap_description"),
     },
   }}, {id="remote_assistance", label=i18n("remote_assistance.remote_assistance"), advanced=true,  pro_only=false, hidden=(not remote_assistance.isAvailable()), entries={
     n2n_supernode = {
@@ -289,7 +289,14 @@ end
 
 local function getPcapFilePath(job_id, ifid, file_id)
   local dir_path = getPcapFileDir(job_id, ifid)
-  return dir_path.."/"..file_id..".pcap"
+  local path = dir_path.."/"..file_id..".pcap"
+
+  -- Compressed extraction (see compress_extracted_pcap)
+  if not ntop.exists(path) and ntop.exists(path..".gz") then
+    return path..".gz"
+  end
+
+  return path
 end
 
 -- Read information about used disk space for an interface dump
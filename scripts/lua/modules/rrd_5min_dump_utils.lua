@@ -163,23 +163,32 @@ end
 
 -- ########################################################
 
-function rrd_dump.host_update_stats_rrds(when, hostname, host, ifstats, verbose)
-  ts_utils.append("host:traffic", {ifid=ifstats.id, host=hostname,
+-- When a batch is given, the point is queued and written later with ts_utils.appendBatch
+local function host_append(batch, schema_name, tags_and_metrics, when, verbose)
+  if batch then
+    batch[#batch + 1] = {schema_name, tags_and_metrics, when}
+  else
+    ts_utils.append(schema_name, tags_and_metrics, when, verbose)
+  end
+end
+
+function rrd_dump.host_update_stats_rrds(when, hostname, host, ifstats, verbose, batch)
+  host_append(batch, "host:traffic", {ifid=ifstats.id, host=hostname,
             bytes_sent=host["bytes.sent"], bytes_rcvd=host["bytes.rcvd"]}, when, verbose)
 
   -- Number of flows
-  ts_utils.append("host:flows", {ifid=ifstats.id, host=hostname,
+  host_append(batch, "host:flows", {ifid=ifstats.id, host=hostname,
             num_flows=host["active_flows.as_client"] + host["active_flows.as_server"]}, when, verbose)
 
   -- Contacts
-  ts_utils.append("host:contacts", {ifid=ifstats.id, host=hostname,
+  host_append(batch, "host:contacts", {ifid=ifstats.id, host=hostname,
             as_client=host["contacts.as_client"], as_server=host["contacts.as_server"]}, when, verbose)
 
   -- L4 Protocols
   for id, _ in pairs(l4_keys) do
     k = l4_keys[id][2]
     if((host[k..".bytes.sent"] ~= nil) and (host[k..".bytes.rcvd"] ~= nil)) then
-      ts_utils.append("host:l4protos", {ifid=ifstats.id, host=hostname,
+      host_append(batch, "host:l4protos", {ifid=ifstats.id, host=hostname,
                 l4proto=tostring(k), bytes_sent=host[k..".bytes.sent"], bytes_rcvd=host[k..".bytes.rcvd"]}, when, verbose)
     else
       -- L2 host
@@ -188,42 +197,42 @@ function rrd_dump.host_update_stats_rrds(when, hostname, host, ifstats, verbose)
   end
 end
 
-function rrd_dump.host_update_ndpi_rrds(when, hostname, host, ifstats, verbose)
+function rrd_dump.host_update_ndpi_rrds(when, hostname, host, ifstats, verbose, batch)
   -- nDPI Protocols
   for k, value in pairs(host["ndpi"] or {}) do
     local sep = string.find(value, "|")
     local bytes_sent = string.sub(value, 1, sep-1)
     local bytes_rcvd = string.sub(value, sep+1)
 
-    ts_utils.append("host:ndpi", {ifid=ifstats.id, host=hostname, protocol=k,
+    host_append(batch, "host:ndpi", {ifid=ifstats.id, host=hostname, protocol=k,
               bytes_sent=bytes_sent, bytes_rcvd=bytes_rcvd}, when, verbose)
   end
 end
 
-function rrd_dump.host_update_categories_rrds(when, hostname, host, ifstats, verbose)
+function rrd_dump.host_update_categories_rrds(when, hostname, host, ifstats, verbose, batch)
   -- nDPI Protocol CATEGORIES
   for k, bytes in pairs(host["ndpi_categories"] or {}) do
-    ts_utils.append("host:ndpi_categories", {ifid=ifstats.id, host=hostname, category=k,
+    host_append(batch, "host:ndpi_categories", {ifid=ifstats.id, host=hostname, category=k,
               bytes=bytes}, when, verbose)
   end
 end
 
 -- ########################################################
 
-function rrd_dump.host_update_rrd(when, hostname, host, ifstats, verbose, config)
+function rrd_dump.host_update_rrd(when, hostname, host, ifstats, verbose, config, batch)
   -- Crunch additional stats for local hosts only
   if config.host_rrd_creation ~= "0" then
     -- Traffic stats
     if(config.host_rrd_creation == "1") then
-      rrd_dump.host_update_stats_rrds(when, hostname, host, ifstats, verbose)
+      rrd_dump.host_update_stats_rrds(when, hostname, host, ifstats, verbose, batch)
     end
 
     if(config.host_ndpi_timeseries_creation == "per_protocol" or config.host_ndpi_timeseries_creation == "both") then
-      rrd_dump.host_update_ndpi_rrds(when, hostname, host, ifstats, verbose)
+      rrd_dump.host_update_ndpi_rrds(when, hostname, host, ifstats, verbose, batch)
     end
 
     if(config.host_ndpi_timeseries_creation == "per_category" or config.host_ndpi_timeseries_creation == "both") then
-      rrd_dump.host_update_categories_rrds(when, hostname, host, ifstats, verbose)
+      rrd_dump.host_update_categories_rrds(when, hostname, host, ifstats, verbose, batch)
     end
   end
 end
@@ -258,13 +267,20 @@ function rrd_dump.run_5min_dump(_ifname, ifstats, config, when, time_threshold,
       end
 
       if is_rrd_creation_enabled then
+        -- All the host timeseries are written at once
+        local batch = {}
+
         for _, host_point in ipairs(host_ts or {}) do
           local instant = host_point.instant
 
           if instant >= min_instant then
-            rrd_dump.host_update_rrd(instant, hostname, host_point, ifstats, verbose, config)
+            rrd_dump.host_update_rrd(instant, hostname, host_point, ifstats, verbose, config, batch)
           end
         end
+
+        if #batch > 0 then
+          ts_utils.appendBatch(batch)
+        end
       end
 
       num_processed_hosts = num_processed_hosts + 1
@@ -283,6 +299,13 @@ function rrd_dump.run_5min_dump(_ifname, ifstats, config, when, time_threshold,
 
   --tprint("Dump of ".. num_processed_hosts .. " hosts: completed in " .. (os.time() - dump_tstart) .. " seconds")
 
+  if verbose then
+    local batch_stats = ntop.rrd_batch_stats()
+
+    traceError(TRACE_NORMAL, TRACE_CONSOLE, string.format("[%s] RRD batches: %u, updates: %u, files: %u, errors: %u, last: %u usec, max: %u usec",
+      _ifname, batch_stats.batches, batch_stats.updates, batch_stats.files, batch_stats.errors, batch_stats.last_usec, batch_stats.max_usec))
+  end
+
   if is_rrd_creation_enabled then
     if config.l2_device_rrd_creation ~= "0" then
       local in_time = callback_utils.foreachDevice(_ifname, time_threshold, function (devicename, device)
@@ -7,7 +7,6 @@ local driver = {}
 local ts_common = require("ts_common")
 
 local json = require("dkjson")
-local os_utils = require("os_utils")
 require("ntop_utils")
 
 --
@@ -434,60 +433,36 @@ function driver:_exportErrorMsg(ret)
   return i18n("alert_messages.influxdb_write_error", {influxdb=self.url, err=err_msg}) .. suffix
 end
 
-function driver:_exportTsFile(fname)
-  if not ntop.exists(fname) then
-    return nil
-  end
-
-  -- Delete the file after POST
-  local delete_file_after_post = true
-  local ret = ntop.postHTTPTextFile(self.username, self.password, self.url .. "/write?db=" .. self.db, fname, delete_file_after_post, 5 --[[ timeout ]])
-
-  if((ret == nil) or ((ret.RESPONSE_CODE ~= 200) and (ret.RESPONSE_CODE ~= 204))) then
-    local msg = self:_exportErrorMsg(ret)
-    interface.storeAlert(alertEntity("influx_db"), self.url, alertType("influxdb_export_failure"), alertSeverity("error"), msg)
-
-     --delete the file manually
-    os.remove(fname)
-    return nil
-  end
-
-  return ret
-end
-
+-- Points are posted to InfluxDB by the exporter thread of each interface
+-- (see TimeseriesExporter): here only its failures are reported
 function driver:export()
-  while(true) do
-    local name_id = ntop.lpopCache("ntopng.influx_file_queue")
-    local ret
+  for ifid, ifname in pairs(interface.getIfNames()) do
+    interface.select(ifname)
 
-    if((name_id == nil) or (name_id == "")) then
-      break
-    end
+    local stats = interface.getTSExporterStats()
 
-    local parts = split(name_id, "|")
-    local ifid = tonumber(parts[1])
-    local time_ref = tonumber(parts[2])
-    local export_id = tonumber(parts[3])
+    if stats ~= nil then
+      local failures_key = "ntopng.cache.influxdb_export_failures_" .. self.db .. "_" .. ifid
+      local prev_failures = tonumber(ntop.getCache(failures_key)) or 0
+      local failures = stats.failures + stats.rejected_batches
 
-    if((ifid == nil) or (time_ref == nil) or (export_id == nil)) then
-      traceError(TRACE_ERROR, TRACE_CONSOLE, "Invalid name "..name_id.."\n")
-      break
-    end
+      if failures > prev_failures then
+        local ret
 
-    local time_key = "ntopng.cache.influxdb_export_time_" .. self.db .. "_" .. ifid
-    local prev_t = tonumber(ntop.getCache(time_key)) or 0
-    local fname = os_utils.fixPath(dirs.workingdir .. "/" .. ifid .. "/ts_export/" .. export_id .. "_" .. time_ref)
+        if stats.last_response_code == 0 then
+          ret = {error_msg = stats.last_error}
+        else
+          ret = {RESPONSE_CODE = stats.last_response_code, CONTENT = stats.last_error}
+        end
 
-    --local t = os.time()
-    ret = self:_exportTsFile(fname)
+        interface.storeAlert(alertEntity("influx_db"), self.url, alertType("influxdb_export_failure"), alertSeverity("error"), self:_exportErrorMsg(ret))
+      end
 
-    if ret == nil then
-      break
+      if failures ~= prev_failures then
+        -- NOTE: counters restart from zero with ntopng
+        ntop.setCache(failures_key, tostring(failures))
+      end
     end
-
-    -- Successfully exported
-    --tprint("Exported ".. fname .." in " .. (os.time() - t) .. " sec")
-    ntop.setCache(time_key, tostring(math.max(prev_t, time_ref)))
   end
 end
 
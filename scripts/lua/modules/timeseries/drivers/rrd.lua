@@ -183,14 +183,15 @@ local function map_rrd_column_to_metrics(schema, column_name)
   return nil
 end
 
-local function create_rrd(schema, path)
+-- DS and RRA definitions of the schema RRDs
+local function get_rrd_create_args(schema)
   local heartbeat = schema.options.rrd_heartbeat or (schema.options.step * 2)
   local rrd_type = type_to_rrdtype[schema.options.metrics_type]
-  local params = {path, schema.options.step}
+  local params = {}
 
   local metrics_map = map_metrics_to_rrd_columns(schema)
   if not metrics_map then
-    return false
+    return nil
   end
 
   for idx, metric in ipairs(schema._metrics) do
@@ -207,6 +208,22 @@ local function create_rrd(schema, path)
     params[#params + 1] = "RRA:HWPREDICT:" .. hwpredict.row_count .. ":0.1:0.0035:" .. hwpredict.period
   end
 
+  return params
+end
+
+local function create_rrd(schema, path)
+  local args = get_rrd_create_args(schema)
+
+  if not args then
+    return false
+  end
+
+  local params = {path, schema.options.step}
+
+  for _, arg in ipairs(args) do
+    params[#params + 1] = arg
+  end
+
   -- NOTE: this is either a bug with unpack or with Lua.cpp make_argv
   params[#params + 1] = ""
 
@@ -245,6 +262,56 @@ end
 
 -- ##############################################
 
+-- Schema name -> DS/RRA definitions, computed once for the batches
+local batch_create_args = {}
+
+-- Points are grouped by RRD directory (i.e. by entity) and each group is
+-- written with a single ntop.rrd_update_batch, which creates the missing
+-- RRDs and writes all the points of a file at once
+function driver:appendBatch(points)
+  local batches = {}
+  local bases = {}
+  local rv = true
+
+  for _, point in ipairs(points) do
+    local schema = point.schema
+    local base, rrd = schema_get_path(schema, point.tags)
+    local batch = batches[base]
+    local values = {}
+
+    if batch == nil then
+      batch = {}
+      batches[base] = batch
+      bases[#bases + 1] = base
+    end
+
+    if batch_create_args[schema.name] == nil then
+      batch_create_args[schema.name] = get_rrd_create_args(schema) or {}
+    end
+
+    for _, metric in ipairs(schema._metrics) do
+      values[#values + 1] = tolongint(point.metrics[metric])
+    end
+
+    batch[#batch + 1] = {
+      rrd = rrd, timestamp = tolongint(point.timestamp), values = values,
+      step = schema.options.step, create = batch_create_args[schema.name],
+    }
+  end
+
+  for _, base in ipairs(bases) do
+    local res = ntop.rrd_update_batch(base, batches[base])
+
+    if (res == nil) or (res.errors > 0) then
+      rv = false
+    end
+  end
+
+  return rv
+end
+
+-- ##############################################
+
 local function makeTotalSerie(series, count)
   local total = {}
 
@@ -207,6 +207,48 @@ end
 
 -- ##############################################
 
+--! @brief Append multiple data points, e.g. all the points of an entity, in a single call.
+--! @param points a list of {schema_name, tags_and_metrics, timestamp} (see ts_utils.append).
+--! @return true on success, false on error.
+--! @note drivers implementing appendBatch write all the points at once.
+function ts_utils.appendBatch(points)
+  local verified = {}
+  local rv = true
+
+  for _, point in ipairs(points) do
+    local schema = ts_utils.getSchema(point[1])
+
+    if not schema then
+      traceError(TRACE_ERROR, TRACE_CONSOLE, "Schema not found: " .. point[1])
+      rv = false
+    else
+      local tags, data = schema:verifyTagsAndMetrics(point[2])
+
+      if tags then
+        verified[#verified + 1] = {schema = schema, timestamp = point[3] or os.time(), tags = tags, metrics = data}
+      else
+        rv = false
+      end
+    end
+  end
+
+  ts_common.clearLastError()
+
+  for _, driver in pairs(ts_utils.listActiveDrivers()) do
+    if driver.appendBatch then
+      rv = driver:appendBatch(verified) and rv
+    else
+      for _, point in ipairs(verified) do
+        rv = driver:append(point.schema, point.timestamp, point.tags, point.metrics) and rv
+      end
+    end
+  end
+
+  return rv
+end
+
+-- ##############################################
+
 -- Get some default options to use in queries.
 function ts_utils.getQueryOptions(overrides)
   return table.merge({
@@ -21,10 +21,28 @@
 
 #include "ntop_includes.h"
 
+/* DNS wire format (RFC 1035) */
+#define DNS_HEADER_LEN          12
+#define DNS_TYPE_PTR            12
+#define DNS_CLASS_IN             1
+#define DNS_MAX_PACKET_LEN     512
+#define DNS_MAX_QUERY_LEN      (DNS_HEADER_LEN + 80 /* ip6.arpa name */ + 4)
+#define DNS_POLL_TIMEOUT_MSEC  100
+
+struct dns_inflight_query {
+  struct dns_resolution_request req;
+  u_char query[DNS_MAX_QUERY_LEN];
+  u_int16_t query_len, id;
+  u_int8_t num_tries;
+  struct timeval sent_at;
+  bool active;
+};
+
 /* **************************************** */
 
 AddressResolution::AddressResolution() {
   num_resolved_addresses = num_resolved_fails = 0;
+  local_networks_dirty = false;
   num_resolvers =
 #ifdef NTOPNG_EMBEDDED_EDITION
       1
@@ -35,12 +53,69 @@ AddressResolution::AddressResolution() {
 
   if(!(resolveThreadLoop = (pthread_t*)calloc(num_resolvers, sizeof(pthread_t))))
     throw 2;
+
+  if(!(queue = (struct dns_resolution_request*)calloc(MAX_NUM_QUEUED_ADDRS, sizeof(struct dns_resolution_request))))
+    throw 2;
+
+  cache = new DnsCache(DNS_CACHE_MAX_ENTRIES);
+  persistence = true, num_nameservers = 0;
+  queue_head = queue_len = queue_peak_len = 0;
+  num_queued = num_queue_drops = num_persisted_hits = 0;
+  latency_usec_total = num_latency_samples = 0, latency_usec_max = 0;
+  pthread_cond_init(&queue_cond, NULL);
+
+  /* Never expire */
+  cache->set("127.0.0.1", "localhost", 0, false, 0);
+  cache->set("::1", "localhostV6", 0, false, 0);
+  cache->set("255.255.255.255", "Broadcast", 0, false, 0);
+  cache->set("0.0.0.0", "NoIP", 0, false, 0);
 }
 
 /* ******************************************* */
 
 /* Format: 131.114.21.0/24,10.0.0.0/255.0.0.0 */
-bool AddressResolution::setLocalNetworks(char *rule) { return(localNetworks.addAddresses(rule)); }
+bool AddressResolution::setLocalNetworks(char *rule) {
+  bool rc;
+
+  local_networks_lock.lock(__FILE__, __LINE__);
+  rc = localNetworks.addAddresses(rule);
+
+  /* Local network lookups happen for every packet: use the compiled tree */
+  local_networks_dirty = !localNetworks.compile();
+  local_networks_lock.unlock(__FILE__, __LINE__);
+
+  return(rc);
+}
+
+/* ******************************************* */
+
+void AddressResolution::setLocalNetwork(char *net) {
+  local_networks_lock.lock(__FILE__, __LINE__);
+  /* Lookups fall back to the patricia tree until the next compileLocalNetworks() */
+  localNetworks.addAddresses(net);
+  local_networks_dirty = true;
+  local_networks_lock.unlock(__FILE__, __LINE__);
+}
+
+/* ******************************************* */
+
+/* Called by the housekeeping: a compilation per added network would be too costly */
+void AddressResolution::compileLocalNetworks() {
+  if(!local_networks_dirty)
+    return;
+
+  local_networks_lock.lock(__FILE__, __LINE__);
+
+  if(local_networks_dirty) {
+    if(!localNetworks.compile())
+      ntop->getTrace()->traceEvent(TRACE_WARNING, "Unable to compile the local networks: using the slower lookups");
+
+    /* On failures, retry when another network is added */
+    local_networks_dirty = false;
+  }
+
+  local_networks_lock.unlock(__FILE__, __LINE__);
+}
 
 /* ******************************************* */
 
@@ -57,129 +132,678 @@ AddressResolution::~AddressResolution() {
   }
 
   free(resolveThreadLoop);
+  free(queue);
+  pthread_cond_destroy(&queue_cond);
+  delete cache;
+
+  ntop->getTrace()->traceEvent(TRACE_NORMAL, "Address resolution stats [%u resolved][%u failures][%llu queue drops]",
+			       num_resolved_addresses, num_resolved_fails, (unsigned long long)num_queue_drops);
+}
+
+/* ***************************************** */
+
+void AddressResolution::loadNameservers() {
+#ifndef WIN32
+  FILE *fd = fopen("/etc/resolv.conf", "r");
+  char line[256];
+
+  if(fd == NULL) return;
+
+  while((num_nameservers < DNS_MAX_NAMESERVERS) && fgets(line, sizeof(line), fd)) {
+    char addr[INET6_ADDRSTRLEN + 1], *scope;
+    struct dns_nameserver *ns = &nameservers[num_nameservers];
+
+    if(sscanf(line, "nameserver %46s", addr) != 1)
+      continue;
+
+    if((scope = strchr(addr, '%')) != NULL)
+      continue; /* Link-local nameservers are not supported */
+
+    memset(ns, 0, sizeof(*ns));
+
+    if(strchr(addr, ':') == NULL) {
+      struct sockaddr_in *in4 = (struct sockaddr_in*)&ns->addr;
+
+      if(inet_pton(AF_INET, addr, &in4->sin_addr) != 1) continue;
+      in4->sin_family = AF_INET, in4->sin_port = htons(53);
+      ns->addr_len = sizeof(struct sockaddr_in);
+    } else {
+      struct sockaddr_in6 *in6 = (struct sockaddr_in6*)&ns->addr;
+
+      if(inet_pton(AF_INET6, addr, &in6->sin6_addr) != 1) continue;
+      in6->sin6_family = AF_INET6, in6->sin6_port = htons(53);
+      ns->addr_len = sizeof(struct sockaddr_in6);
+    }
+
+    ntop->getTrace()->traceEvent(TRACE_INFO, "Using nameserver %s for address resolution", addr);
+    num_nameservers++;
+  }
+
+  fclose(fd);
+#endif
+}
+
+/* ***************************************** */
+
+static void normalizeKey(const char *numeric_ip, char *key, u_int key_len) {
+  char *at;
+
+  snprintf(key, key_len, "%s", numeric_ip);
+  if((at = strchr(key, '@')) != NULL) at[0] = '\0'; /* Strip the VLAN */
+}
+
+/* ***************************************** */
+
+/* Blocking resolution: returns false and the value to cache on failure */
+bool AddressResolution::resolveNow(const char *key, char *rsp, u_int rsp_len, u_int32_t *ttl) {
+  char hostname[NI_MAXHOST];
+  struct sockaddr *sa;
+  struct sockaddr_in in4;
+  struct sockaddr_in6 in6;
+  int rc, len;
+
+  *ttl = DNS_CACHE_DURATION;
+  memset(&in4, 0, sizeof(in4)), memset(&in6, 0, sizeof(in6));
+
+  if(inet_pton(AF_INET, key, &in4.sin_addr) == 1) {
+    in4.sin_family = AF_INET;
+    len = sizeof(struct sockaddr_in), sa = (struct sockaddr*)&in4;
+  } else if(inet_pton(AF_INET6, key, &in6.sin6_addr) == 1) {
+    in6.sin6_family = AF_INET6;
+    len = sizeof(struct sockaddr_in6), sa = (struct sockaddr*)&in6;
+  } else {
+    /* This is a symbolic IP -> numeric IP */
+    struct addrinfo hints, *res = NULL;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC, hints.ai_flags = AI_CANONNAME;
+
+    if((rc = getaddrinfo(key, NULL, &hints, &res)) == 0) {
+      snprintf(rsp, rsp_len, "%s", (res && res->ai_canonname) ? res->ai_canonname : key);
+      freeaddrinfo(res);
+      return(true);
+    }
+
+    rsp[0] = '\0'; /* Cached failures of symbolic names are empty */
+    return(false);
+  }
+
+  if((rc = getnameinfo(sa, len, hostname, sizeof(hostname), NULL, 0, NI_NAMEREQD)) == 0) {
+    snprintf(rsp, rsp_len, "%s", hostname);
+    ntop->getTrace()->traceEvent(TRACE_INFO, "Resolved %s to %s", key, hostname);
+    return(true);
+  }
+
+  ntop->getTrace()->traceEvent(TRACE_INFO, "Error resolution failure for %s [%d/%s/%s]",
+			       key, rc, gai_strerror(rc), strerror(errno));
+  snprintf(rsp, rsp_len, "%s", key); /* So we avoid to continuously resolver the same address */
+  return(false);
+}
+
+/* ***************************************** */
+
+bool AddressResolution::loadPersisted(const char *key, char *rsp, u_int rsp_len) {
+  bool negative;
+
+  if(!persistence || (ntop->getRedis()->getAddress((char*)key, rsp, rsp_len) != 0))
+    return(false);
+
+  negative = (rsp[0] == '\0') || (!strcmp(rsp, key));
+  cache->set(key, rsp, negative ? DNS_NEGATIVE_CACHE_DURATION : DNS_CACHE_DURATION, negative, time(NULL));
+
+  m.lock(__FILE__, __LINE__);
+  num_persisted_hits++;
+  m.unlock(__FILE__, __LINE__);
+
+  return(true);
+}
+
+/* ***************************************** */
+
+void AddressResolution::resolved(const struct dns_resolution_request *req, const char *name,
+				 u_int32_t ttl, bool negative) {
+  struct timeval now;
+  u_int64_t latency;
+
+  gettimeofday(&now, NULL);
+  cache->set(req->key, name, ttl, negative, now.tv_sec);
+
+  if(persistence)
+    ntop->getRedis()->setResolvedAddress((char*)req->key, (char*)name);
+
+  latency = (now.tv_sec - req->queued_at.tv_sec) * 1000000 + now.tv_usec - req->queued_at.tv_usec;
+
+  m.lock(__FILE__, __LINE__);
+  if(negative) num_resolved_fails++; else num_resolved_addresses++;
+  latency_usec_total += latency, num_latency_samples++;
+  if(latency > latency_usec_max) latency_usec_max = (u_int32_t)latency;
+  m.unlock(__FILE__, __LINE__);
+}
+
+/* ***************************************** */
+
+bool AddressResolution::enqueue(const char *key, bool urgent) {
+  struct dns_resolution_request *r;
+  char dropped[DNS_CACHE_MAX_KEY_LEN];
+  bool rc = true;
+
+  dropped[0] = '\0';
+
+  m.lock(__FILE__, __LINE__);
+
+  if(queue_len == MAX_NUM_QUEUED_ADDRS) {
+    if(urgent) {
+      /* Make room by dropping the last queued address */
+      snprintf(dropped, sizeof(dropped), "%s", queue[(queue_head + queue_len - 1) % MAX_NUM_QUEUED_ADDRS].key);
+      queue_len--;
+    } else
+      rc = false;
+
+    num_queue_drops++;
+  }
+
+  if(rc) {
+    if(urgent) {
+      queue_head = (queue_head + MAX_NUM_QUEUED_ADDRS - 1) % MAX_NUM_QUEUED_ADDRS;
+      r = &queue[queue_head];
+    } else
+      r = &queue[(queue_head + queue_len) % MAX_NUM_QUEUED_ADDRS];
+
+    snprintf(r->key, sizeof(r->key), "%s", key);
+    gettimeofday(&r->queued_at, NULL);
+
+    queue_len++, num_queued++;
+    if(queue_len > queue_peak_len) queue_peak_len = queue_len;
+    pthread_cond_signal(&queue_cond);
+  }
+
+  m.unlock(__FILE__, __LINE__);
+
+  if(dropped[0] != '\0')
+    cache->release(dropped);
+
+  return(rc);
+}
+
+/* ***************************************** */
+
+bool AddressResolution::dequeue(struct dns_resolution_request *req, bool wait) {
+  bool rc = false;
+
+  m.lock(__FILE__, __LINE__);
+
+  if((queue_len == 0) && wait) {
+    struct timespec until;
+
+    /* Bounded wait so that the shutdown is noticed */
+    until.tv_sec = time(NULL) + 1, until.tv_nsec = 0;
+    m.cond_timedwait(&queue_cond, &until);
+  }
+
+  if(queue_len > 0) {
+    *req = queue[queue_head];
+    queue_head = (queue_head + 1) % MAX_NUM_QUEUED_ADDRS;
+    queue_len--, rc = true;
+  }
+
+  m.unlock(__FILE__, __LINE__);
+
+  return(rc);
+}
+
+/* ***************************************** */
+
+int AddressResolution::getAddress(const char *numeric_ip, char *rsp, u_int rsp_len, bool queue_if_not_found) {
+  char key[DNS_CACHE_MAX_KEY_LEN], name[256];
+  bool reserve;
+
+  rsp[0] = '\0';
+  if((numeric_ip == NULL) || (numeric_ip[0] == '\0') || (strlen(numeric_ip) >= sizeof(key)))
+    return(-1);
+
+  normalizeKey(numeric_ip, key, sizeof(key));
+  reserve = queue_if_not_found && Utils::shouldResolveHost(key);
+
+  switch(cache->lookup(key, rsp, rsp_len, time(NULL), reserve)) {
+  case dns_cache_hit:
+  case dns_cache_negative_hit:
+    return(0);
+
+  case dns_cache_miss:
+    /*
+      Names persisted in a previous run, also for the addresses that are
+      never queued (e.g. remote hosts when only local ones are resolved)
+    */
+    if(loadPersisted(key, name, sizeof(name))) {
+      snprintf(rsp, rsp_len, "%s", name);
+      return(0);
+    }
+
+    if(reserve && (!enqueue(key, false)))
+      cache->release(key);
+    return(-1);
+
+  default:
+    return(-1);
+  }
+}
 
-  ntop->getTrace()->traceEvent(TRACE_NORMAL, "Address resolution stats [%u resolved][%u failures]",
-			       num_resolved_addresses, num_resolved_fails);
+/* ***************************************** */
+
+void AddressResolution::queueHostToResolve(const char *numeric_ip, bool urgent) {
+  char key[DNS_CACHE_MAX_KEY_LEN];
+
+  if((numeric_ip == NULL) || (numeric_ip[0] == '\0') || (strlen(numeric_ip) >= sizeof(key)))
+    return;
+
+  normalizeKey(numeric_ip, key, sizeof(key));
+
+  if(!Utils::shouldResolveHost(key))
+    return;
+
+  if((cache->lookup(key, NULL, 0, time(NULL), true) == dns_cache_miss)
+     && (!enqueue(key, urgent)))
+    cache->release(key);
 }
 
 /* ***************************************** */
 
-void AddressResolution::resolveHostName(char *_numeric_ip, char *symbolic, u_int symbolic_len) {
-  char rsp[128], query[64], *at, *numeric_ip;
-  u_int numeric_ip_len;
+void AddressResolution::setResolvedAddress(const char *numeric_ip, const char *symbolic_ip) {
+  char numeric[256], *w, *h;
+  time_t now = time(NULL);
+
+  snprintf(numeric, sizeof(numeric), "%s", numeric_ip);
 
-  snprintf(query, sizeof(query), "%s", _numeric_ip);
-  if((at = strchr(query, '@')) != NULL) at[0] = '\0';
-  numeric_ip = query;
-  numeric_ip_len = strlen(numeric_ip)-1;
+  for(h = strtok_r(numeric, ";", &w); h != NULL; h = strtok_r(NULL, ";", &w))
+    cache->set(h, symbolic_ip, DNS_CACHE_DURATION, false, now);
+
+  if(persistence)
+    ntop->getRedis()->setResolvedAddress((char*)numeric_ip, (char*)symbolic_ip);
+}
+
+/* ***************************************** */
+
+void AddressResolution::resolveHostName(char *numeric_ip, char *symbolic, u_int symbolic_len) {
+  struct dns_resolution_request req;
+  char rsp[128];
+  u_int32_t ttl;
+  bool ok;
 
   if((symbolic != NULL) && (symbolic_len > 0)) symbolic[0] = '\0';
-  if(numeric_ip[0] == '\0') return;
-
-  if(ntop->getRedis()->getAddress(numeric_ip, rsp, sizeof(rsp), false) < 0) {
-    char hostname[NI_MAXHOST];
-    struct sockaddr *sa;
-    struct sockaddr_in in4;
-    struct sockaddr_in6 in6;
-    int rc, len;
-
-    /* Check if this is a symbolic IP */
-    if(!isdigit(numeric_ip[numeric_ip_len])) {
-      /* This is a symbolic IP -> numeric IP */
-      struct hostent *h;
-
-      m.lock(__FILE__, __LINE__);
-      h = gethostbyname((const char*)numeric_ip); /* Non reentrant call */
-
-      if(symbolic && h) snprintf(symbolic, symbolic_len, "%s",  h->h_name);
-      ntop->getRedis()->setResolvedAddress(numeric_ip, h ? h->h_name : (char*)"");
-      num_resolved_addresses++;
-      m.unlock(__FILE__, __LINE__);
-      return;
+  if((numeric_ip == NULL) || (strlen(numeric_ip) >= sizeof(req.key))) return;
+
+  normalizeKey(numeric_ip, req.key, sizeof(req.key));
+  if(req.key[0] == '\0') return;
+
+  switch(cache->lookup(req.key, rsp, sizeof(rsp), time(NULL), false)) {
+  case dns_cache_hit:
+    ok = true;
+    break;
+
+  case dns_cache_negative_hit:
+    ok = false;
+    break;
+
+  default:
+    if(loadPersisted(req.key, rsp, sizeof(rsp)))
+      ok = (rsp[0] != '\0') && strcmp(rsp, req.key);
+    else {
+      gettimeofday(&req.queued_at, NULL);
+      ok = resolveNow(req.key, rsp, sizeof(rsp), &ttl);
+      resolved(&req, rsp, ok ? ttl : DNS_NEGATIVE_CACHE_DURATION, !ok);
     }
+  }
+
+  if(ok && (symbolic != NULL) && (symbolic_len > 0))
+    snprintf(symbolic, symbolic_len, "%s", rsp);
+}
 
-    if(strchr(numeric_ip, ':') != NULL) {
-      struct in6_addr addr6;
+/* **************************************************** */
 
-      if(inet_pton(AF_INET6, numeric_ip, &addr6) == 1) {
-	memset(&in6, 0, sizeof(struct sockaddr_in6));
+/* Fills q with a PTR query for the numeric address key */
+static bool buildPtrQuery(struct dns_inflight_query *q) {
+  char name[80], *label, *dot;
+  struct in_addr a4;
+  struct in6_addr a6;
+  u_char *p;
 
-	in6.sin6_family = AF_INET6, inet_pton(AF_INET6, numeric_ip, &in6.sin6_addr);
-	len = sizeof(struct sockaddr_in6), sa = (struct sockaddr*)&in6;
-      } else {
-	ntop->getTrace()->traceEvent(TRACE_INFO, "Invalid IPv6 address to resolve '%s': already symbolic?", numeric_ip);
-	return; /* Invalid format */
-      }
-    } else {
-      u_int ip4_0 = 0, ip4_1 = 0, ip4_2 = 0, ip4_3 = 0;
-
-      if(sscanf(numeric_ip, "%u.%u.%u.%u", &ip4_0, &ip4_1, &ip4_2, &ip4_3) == 4) {
-	in4.sin_family = AF_INET, in4.sin_addr.s_addr = inet_addr(numeric_ip);
-	len = sizeof(struct sockaddr_in), sa = (struct sockaddr*)&in4;
-      } else  {
-	ntop->getTrace()->traceEvent(TRACE_INFO, "Invalid IPv4 address to resolve '%s': already symbolic?", numeric_ip);
-	return; /* Invalid format */
+  if(inet_pton(AF_INET, q->req.key, &a4) == 1) {
+    u_int8_t *b = (u_int8_t*)&a4.s_addr;
+
+    snprintf(name, sizeof(name), "%u.%u.%u.%u.in-addr.arpa", b[3], b[2], b[1], b[0]);
+  } else if(inet_pton(AF_INET6, q->req.key, &a6) == 1) {
+    int off = 0;
+
+    for(int i = 15; i >= 0; i--)
+      off += snprintf(&name[off], sizeof(name) - off, "%x.%x.", a6.s6_addr[i] & 0x0F, a6.s6_addr[i] >> 4);
+
+    snprintf(&name[off], sizeof(name) - off, "ip6.arpa");
+  } else
+    return(false); /* Symbolic name */
+
+  memset(q->query, 0, DNS_HEADER_LEN);
+  q->query[0] = q->id >> 8, q->query[1] = q->id & 0xFF;
+  q->query[2] = 0x01 /* Recursion desired */, q->query[5] = 1 /* QDCOUNT */;
+  p = &q->query[DNS_HEADER_LEN];
+
+  label = name;
+  do {
+    u_int len;
+
+    dot = strchr(label, '.');
+    len = dot ? (u_int)(dot - label) : (u_int)strlen(label);
+    *p++ = (u_char)len, memcpy(p, label, len), p += len;
+    if(dot) label = &dot[1];
+  } while(dot);
+
+  *p++ = 0;
+  *p++ = 0, *p++ = DNS_TYPE_PTR, *p++ = 0, *p++ = DNS_CLASS_IN;
+  q->query_len = (u_int16_t)(p - q->query);
+
+  return(true);
+}
+
+/* **************************************************** */
+
+static int skipDnsName(const u_char *pkt, u_int len, u_int off) {
+  while(off < len) {
+    u_int8_t l = pkt[off];
+
+    if(l == 0) return(off + 1);
+    if((l & 0xC0) == 0xC0) return((off + 2 <= len) ? (int)(off + 2) : -1);
+    if(l & 0xC0) return(-1);
+    off += l + 1;
+  }
+
+  return(-1);
+}
+
+/* **************************************************** */
+
+static bool decodeDnsName(const u_char *pkt, u_int len, u_int off, char *out, u_int out_len) {
+  u_int o = 0, num_jumps = 0;
+
+  while(off < len) {
+    u_int8_t l = pkt[off];
+
+    if(l == 0) {
+      if(o == 0) return(false);
+      out[o - 1] = '\0'; /* Trailing dot */
+      return(true);
+    } else if((l & 0xC0) == 0xC0) {
+      if((off + 1 >= len) || (++num_jumps > 16)) return(false);
+      off = ((l & 0x3F) << 8) | pkt[off + 1];
+    } else if(l & 0xC0)
+      return(false);
+    else {
+      if((off + 1 + l > len) || (o + l + 1 >= out_len)) return(false);
+
+      for(u_int i = 1; i <= l; i++) {
+	u_char c = pkt[off + i];
+
+	/* Names end up in the GUI: reject anything that is not a hostname */
+	if(!(isalnum(c) || (c == '-') || (c == '_'))) return(false);
+	out[o++] = (char)c;
       }
+
+      out[o++] = '.', off += l + 1;
     }
+  }
 
-    if((rc = getnameinfo(sa, len, hostname, sizeof(hostname), NULL, 0, NI_NAMEREQD)) == 0) {
-      ntop->getRedis()->setResolvedAddress(numeric_ip, hostname);
-      if((symbolic != NULL) && (symbolic_len > 0)) snprintf(symbolic, symbolic_len, "%s", hostname);
-      ntop->getTrace()->traceEvent(TRACE_INFO, "Resolved %s to %s", numeric_ip, hostname);
-      m.lock(__FILE__, __LINE__);
-      num_resolved_addresses++;
-      m.unlock(__FILE__, __LINE__);
-    } else {
-      m.lock(__FILE__, __LINE__);
-      num_resolved_fails++;
-      m.unlock(__FILE__, __LINE__);
-      ntop->getTrace()->traceEvent(TRACE_INFO, "Error resolution failure for %s [%d/%s/%s]",
-				   numeric_ip, rc, gai_strerror(rc), strerror(errno));
-      ntop->getRedis()->setResolvedAddress(numeric_ip, numeric_ip); /* So we avoid to continuously resolver the same address */
+  return(false);
+}
+
+/* **************************************************** */
+
+/* Returns 1 when resolved, 0 on failure, -1 when pkt is not an answer to q */
+static int parsePtrResponse(const u_char *pkt, u_int len, const struct dns_inflight_query *q,
+			    char *name, u_int name_len, u_int32_t *ttl) {
+  u_int num_answers, off;
+
+  if((len < q->query_len)
+     || (((pkt[0] << 8) | pkt[1]) != q->id)
+     || (!(pkt[2] & 0x80)) /* Not a response */
+     || (((pkt[4] << 8) | pkt[5]) != 1)
+     || memcmp(&pkt[DNS_HEADER_LEN], &q->query[DNS_HEADER_LEN], q->query_len - DNS_HEADER_LEN))
+    return(-1);
+
+  if((pkt[3] & 0x0F) != 0) /* NXDOMAIN, SERVFAIL... */
+    return(0);
+
+  num_answers = (pkt[6] << 8) | pkt[7], off = q->query_len;
+
+  for(u_int i = 0; i < num_answers; i++) {
+    int o = skipDnsName(pkt, len, off);
+    u_int16_t type, rdlen;
+
+    if((o < 0) || ((u_int)o + 10 > len)) return(0);
+
+    type  = (pkt[o] << 8) | pkt[o + 1];
+    rdlen = (pkt[o + 8] << 8) | pkt[o + 9];
+    if((u_int)o + 10 + rdlen > len) return(0);
+
+    if((type == DNS_TYPE_PTR) && decodeDnsName(pkt, len, o + 10, name, name_len)) {
+      *ttl = ((u_int32_t)pkt[o + 4] << 24) | (pkt[o + 5] << 16) | (pkt[o + 6] << 8) | pkt[o + 7];
+      return(1);
     }
-  } else {
-    if((symbolic != NULL) && (symbolic_len > 0)) snprintf(symbolic, symbolic_len, "%s", rsp);
+
+    off = o + 10 + rdlen;
   }
+
+  return(0);
 }
 
 /* **************************************************** */
 
-static void* resolveLoop(void* ptr) {
-  AddressResolution *a = (AddressResolution*)ptr;
-  Redis *r = ntop->getRedis();
-  u_int no_resolution_loops = 0;
-  const u_int max_num_idle_loops = 3;
+static void sendPtrQuery(struct dns_inflight_query *q, int *sockets, u_int num_sockets) {
+  /* Rotate the nameservers across retransmissions */
+  for(u_int i = 0; i < num_sockets; i++) {
+    int s = sockets[(q->num_tries + i) % num_sockets];
+
+    if(s != -1) {
+      if(send(s, q->query, q->query_len, 0) < 0)
+	ntop->getTrace()->traceEvent(TRACE_INFO, "Unable to send DNS query [%s]", strerror(errno));
+      break;
+    }
+  }
+
+  q->num_tries++;
+  gettimeofday(&q->sent_at, NULL);
+}
+
+/* **************************************************** */
+
+void AddressResolution::resolveLoop() {
+  struct dns_inflight_query *inflight;
+  struct pollfd pfd[DNS_MAX_NAMESERVERS];
+  int sockets[DNS_MAX_NAMESERVERS];
+  u_int num_inflight = 0, num_sockets = 0;
+  unsigned int seed = (unsigned int)(time(NULL) ^ (unsigned long)pthread_self());
+
+  inflight = (struct dns_inflight_query*)calloc(DNS_MAX_INFLIGHT_QUERIES, sizeof(struct dns_inflight_query));
+
+  for(u_int i = 0; i < num_nameservers; i++) {
+    int s = socket(nameservers[i].addr.ss_family, SOCK_DGRAM, 0);
+
+    /* Connected sockets only receive answers from the nameserver */
+    if((s != -1)
+       && ((connect(s, (struct sockaddr*)&nameservers[i].addr, nameservers[i].addr_len) != 0)
+	   || (fcntl(s, F_SETFL, fcntl(s, F_GETFL, 0) | O_NONBLOCK) != 0)))
+      close(s), s = -1;
+
+    if(s != -1) num_sockets++;
+    sockets[i] = s;
+  }
+
+  if((num_sockets == 0) || (inflight == NULL))
+    ntop->getTrace()->traceEvent(TRACE_INFO, "No nameserver available: using blocking address resolution");
 
   while(!ntop->getGlobals()->isShutdown()) {
-    char numeric_ip[64];
-    int rc = r->popHostToResolve(numeric_ip, sizeof(numeric_ip));
+    struct dns_resolution_request req;
+    struct timeval now;
+    char name[NI_MAXHOST];
+    u_int32_t ttl;
 
-    if(rc == 0) {
-      if(numeric_ip[0] != '\0')
-	a->resolveHostName(numeric_ip);
+    /* Fill the pipeline. Block only when there is nothing to wait for */
+    while((num_inflight < DNS_MAX_INFLIGHT_QUERIES) && dequeue(&req, num_inflight == 0)) {
+      struct dns_inflight_query *q = NULL;
 
-      no_resolution_loops = 0;
-    } else {
-      if(no_resolution_loops < max_num_idle_loops) no_resolution_loops++;
-      sleep(no_resolution_loops);
+      if(loadPersisted(req.key, name, sizeof(name)))
+	continue;
+
+      if((num_sockets > 0) && inflight) {
+	for(u_int i = 0; (q == NULL) && (i < DNS_MAX_INFLIGHT_QUERIES); i++)
+	  if(!inflight[i].active) q = &inflight[i];
+
+	if(q) {
+	  q->req = req, q->num_tries = 0;
+	  q->id = (u_int16_t)rand_r(&seed);
+
+	  if(!buildPtrQuery(q))
+	    q = NULL;
+	}
+      }
+
+      if(q == NULL) {
+	/* Symbolic names and no nameserver: resolve synchronously */
+	bool ok = resolveNow(req.key, name, sizeof(name), &ttl);
+
+	resolved(&req, name, ok ? ttl : DNS_NEGATIVE_CACHE_DURATION, !ok);
+	continue;
+      }
+
+      sendPtrQuery(q, sockets, num_nameservers);
+      q->active = true, num_inflight++;
+    }
+
+    if(num_inflight == 0)
+      continue;
+
+    for(u_int i = 0; i < num_nameservers; i++)
+      pfd[i].fd = sockets[i], pfd[i].events = POLLIN, pfd[i].revents = 0;
+
+    if(poll(pfd, num_nameservers, DNS_POLL_TIMEOUT_MSEC) > 0) {
+      for(u_int i = 0; i < num_nameservers; i++) {
+	u_char pkt[DNS_MAX_PACKET_LEN];
+	ssize_t len;
+
+	if(!(pfd[i].revents & POLLIN)) continue;
+
+	while((len = recv(sockets[i], pkt, sizeof(pkt), 0)) >= DNS_HEADER_LEN) {
+	  for(u_int j = 0; j < DNS_MAX_INFLIGHT_QUERIES; j++) {
+	    struct dns_inflight_query *q = &inflight[j];
+	    int rc;
+
+	    if((!q->active)
+	       || ((rc = parsePtrResponse(pkt, (u_int)len, q, name, sizeof(name), &ttl)) < 0))
+	      continue;
+
+	    if(rc == 1) {
+	      ttl = max_val(min_val(ttl, DNS_CACHE_DURATION), DNS_MIN_CACHE_DURATION);
+	      ntop->getTrace()->traceEvent(TRACE_INFO, "Resolved %s to %s", q->req.key, name);
+	      resolved(&q->req, name, ttl, false);
+	    } else
+	      resolved(&q->req, q->req.key, DNS_NEGATIVE_CACHE_DURATION, true);
+
+	    q->active = false, num_inflight--;
+	    break;
+	  }
+	}
+      }
+    }
+
+    /* Retransmit or give up the unanswered queries */
+    gettimeofday(&now, NULL);
+
+    for(u_int j = 0; j < DNS_MAX_INFLIGHT_QUERIES; j++) {
+      struct dns_inflight_query *q = &inflight[j];
+
+      if((!q->active) || (Utils::msTimevalDiff(&now, &q->sent_at) < DNS_QUERY_TIMEOUT_MSEC))
+	continue;
+
+      if(q->num_tries < DNS_QUERY_MAX_TRIES)
+	sendPtrQuery(q, sockets, num_nameservers);
+      else {
+	resolved(&q->req, q->req.key, DNS_NEGATIVE_CACHE_DURATION, true);
+	q->active = false, num_inflight--;
+      }
     }
   }
 
+  for(u_int i = 0; i < num_nameservers; i++)
+    if(sockets[i] != -1) close(sockets[i]);
+
+  if(inflight) free(inflight);
+}
+
+/* **************************************************** */
+
+static void* resolveThread(void* ptr) {
+  ((AddressResolution*)ptr)->resolveLoop();
   return(NULL);
 }
 
 /* **************************************************** */
 
 void AddressResolution::startResolveAddressLoop() {
+  char rsp[8];
+
+  if((ntop->getRedis()->get((char*)CONST_RUNTIME_PREFS_DNS_CACHE_PERSISTENCE, rsp, sizeof(rsp)) == 0)
+     && (rsp[0] == '0'))
+    persistence = false;
+
   if(ntop->getPrefs()->is_dns_resolution_enabled()) {
+    loadNameservers();
 
     for(int i = 0; i < num_resolvers; i++)
-      pthread_create(&resolveThreadLoop[i], NULL, resolveLoop, (void*)this);
+      pthread_create(&resolveThreadLoop[i], NULL, resolveThread, (void*)this);
   }
 }
 
 /* **************************************************** */
 
+void AddressResolution::delResolvedAddress(const char *numeric_ip) {
+  char key[DNS_CACHE_MAX_KEY_LEN];
+
+  if((numeric_ip == NULL) || (strlen(numeric_ip) >= sizeof(key)))
+    return;
+
+  normalizeKey(numeric_ip, key, sizeof(key));
+  cache->del(key);
+
+  /* Also when persistence is disabled, names may have been persisted before */
+  ntop->getRedis()->delResolvedAddress(key);
+}
+
+/* **************************************************** */
+
+void AddressResolution::lua(lua_State *vm) {
+  lua_newtable(vm);
+
+  m.lock(__FILE__, __LINE__);
+  lua_push_uint64_table_entry(vm, "num_resolved", num_resolved_addresses);
+  lua_push_uint64_table_entry(vm, "num_failures", num_resolved_fails);
+  lua_push_uint64_table_entry(vm, "num_persisted_hits", num_persisted_hits);
+  lua_push_uint64_table_entry(vm, "queue.length", queue_len);
+  lua_push_uint64_table_entry(vm, "queue.peak_length", queue_peak_len);
+  lua_push_uint64_table_entry(vm, "queue.max_length", MAX_NUM_QUEUED_ADDRS);
+  lua_push_uint64_table_entry(vm, "queue.num_queued", num_queued);
+  lua_push_uint64_table_entry(vm, "queue.num_drops", num_queue_drops);
+  lua_push_uint64_table_entry(vm, "latency.avg_usec", num_latency_samples ? (latency_usec_total / num_latency_samples) : 0);
+  lua_push_uint64_table_entry(vm, "latency.max_usec", latency_usec_max);
+  m.unlock(__FILE__, __LINE__);
+
+  lua_push_uint64_table_entry(vm, "num_nameservers", num_nameservers);
+  lua_push_bool_table_entry(vm, "persistence", persistence);
+  cache->lua(vm);
+
+  lua_pushstring(vm, "dns_resolution");
+  lua_insert(vm, -2);
+  lua_settable(vm, -3);
+}
+
+/* **************************************************** */
+
 void AddressResolution::getLocalNetworks(lua_State* vm) {
   localNetworks.getAddresses(vm);
 }
@@ -39,12 +39,14 @@ AddressTree::AddressTree(const AddressTree &at) {
   HASH_ITER(hh, at.macs, current, tmp) {
     MacKey_t *s;
     
-    if((s = (MacKey_t*)calloc(1, sizeof(MacKey_t))) != NULL)
+    if((s = (MacKey_t*)calloc(1, sizeof(MacKey_t))) != NULL) {
       memcpy(s, current, sizeof(MacKey_t));
       HASH_ADD(hh, macs, mac, 6, s);
+    }
   }
 
   numAddresses = at.numAddresses;
+  compiled = compiled_shadow = NULL;
 }
 
 /* **************************************** */
@@ -56,6 +58,7 @@ static void free_ptree_data(void *data) { ; }
 void AddressTree::init() {
   numAddresses = 0;
   ptree_v4 = New_Patricia(32), ptree_v6 = New_Patricia(128), macs = NULL;
+  compiled = compiled_shadow = NULL;
 }
 
 /* **************************************** */
@@ -69,6 +72,8 @@ AddressTree::~AddressTree() {
 bool AddressTree::addAddress(char *_what, const int16_t user_data) {
   u_int32_t _mac[6];
   int16_t id = (user_data == -1) ? numAddresses : user_data;
+
+  invalidateCompiled();
   
   if(sscanf(_what, "%02X:%02X:%02X:%02X:%02X:%02X",
 	    &_mac[0], &_mac[1], &_mac[2],
@@ -102,6 +107,37 @@ bool AddressTree::addAddress(char *_what, const int16_t user_data) {
 
 /* ******************************************* */
 
+bool AddressTree::removeAddress(char *_what) {
+  u_int32_t _mac[6];
+  bool rc = false;
+
+  invalidateCompiled();
+
+  if(sscanf(_what, "%02X:%02X:%02X:%02X:%02X:%02X",
+	    &_mac[0], &_mac[1], &_mac[2],
+	    &_mac[3], &_mac[4], &_mac[5]) == 6) {
+    MacKey_t *s = NULL;
+    u_int8_t mac[6];
+
+    for(int i=0; i<6; i++) mac[i] = (u_int8_t)_mac[i];
+
+    HASH_FIND(hh, macs, mac, 6, s);
+
+    if(s) {
+      HASH_DEL(macs, s);
+      free(s);
+      rc = true;
+    }
+  } else
+    rc = (Utils::ptree_remove_rule(strchr(_what, '.') ? ptree_v4 : ptree_v6, _what) == 0);
+
+  if(rc && (numAddresses > 0)) numAddresses--;
+
+  return(rc);
+}
+
+/* ******************************************* */
+
 /* Format: 131.114.21.0/24,10.0.0.0/255.0.0.0 */
 bool AddressTree::addAddresses(char *rule, const int16_t user_data) {
   char *tmp, *net = strtok_r(rule, ",", &tmp);
@@ -140,7 +176,54 @@ bool AddressTree::match(char *addr) {
 
 /* ******************************************* */
 
+/*
+  Compiles the current rules into a read-only LPM table that is used by
+  findAddress() from now on. The previous table is kept as shadow until
+  the next compilation so that concurrent lookups can complete safely.
+*/
+bool AddressTree::compile() {
+  CompiledAddressTree *c;
+
+  if((c = new(std::nothrow) CompiledAddressTree()) == NULL)
+    return(false);
+
+  if(!c->compile(ptree_v4, ptree_v6)) {
+    delete c;
+    return(false);
+  }
+
+  if(compiled_shadow) delete compiled_shadow;
+  compiled_shadow = compiled;
+  compiled = c;
+
+  return(true);
+}
+
+/* ******************************************* */
+
+void AddressTree::invalidateCompiled() {
+  if(compiled) {
+    /* Lookups fall back to the patricia trees until compile() is called again */
+    if(compiled_shadow) delete compiled_shadow;
+    compiled_shadow = compiled;
+    compiled = NULL;
+  }
+}
+
+/* ******************************************* */
+
 int16_t AddressTree::findAddress(int family, void *addr, u_int8_t *network_mask_bits) {
+  CompiledAddressTree *c = compiled; /* must use this as it can be swapped */
+
+  if(c)
+    return(c->findAddress(family, addr, network_mask_bits));
+
+  return(findAddressPatricia(family, addr, network_mask_bits));
+}
+
+/* ******************************************* */
+
+int16_t AddressTree::findAddressPatricia(int family, void *addr, u_int8_t *network_mask_bits) {
   patricia_tree_t *p;
   int bits;
   patricia_node_t *node;
@@ -245,6 +328,10 @@ void AddressTree::dump() {
 /* **************************************************** */
 
 void AddressTree::cleanup() {
+  if(compiled)        delete compiled;
+  if(compiled_shadow) delete compiled_shadow;
+  compiled = compiled_shadow = NULL;
+
   if(ptree_v4)  Destroy_Patricia(ptree_v4, free_ptree_data);
   if(ptree_v6)  Destroy_Patricia(ptree_v6, free_ptree_data);
 
@@ -21,9 +21,25 @@
 
 #include "ntop_includes.h"
 
+/* **************************************************** */
+
+static void* flowAlertsWriterLoop(void *ptr) {
+  ((AlertsManager*)ptr)->flowAlertsWriterLoop();
+  return(NULL);
+}
+
+/* **************************************************** */
+
 AlertsManager::AlertsManager(int interface_id, const char *filename) : StoreManager(interface_id) {
   char filePath[MAX_PATH], fileFullPath[MAX_PATH], fileName[MAX_PATH];
 
+  store_opened = store_initialized = false;
+  flow_alerts_queue = NULL, flow_alerts_queue_head = flow_alerts_queue_tail = flow_alerts_queue_len = 0;
+  flow_alerts_writer_running = flow_alerts_writer_started = false;
+  num_flow_alerts_queued = num_flow_alerts_dropped = 0;
+  num_flow_alerts_written = num_flow_alerts_failed = 0;
+  num_flow_alerts_batches = flow_alerts_batch_usec = 0;
+
   snprintf(filePath, sizeof(filePath), "%s/%d/alerts/",
            ntop->get_working_dir(), ifid);
 
@@ -74,6 +90,51 @@ AlertsManager::AlertsManager(int interface_id, const char *filename) : StoreMana
   snprintf(queue_name, sizeof(queue_name), ALERTS_MANAGER_QUEUE_NAME, ifid);
 
   refreshCachedNumAlerts();
+
+  if(store_initialized && store_opened)
+    startFlowAlertsWriter();
+}
+
+/* **************************************************** */
+
+AlertsManager::~AlertsManager() {
+  /* Write the queued alerts before the store is closed */
+  stopFlowAlertsWriter();
+
+  if(flow_alerts_queue) free(flow_alerts_queue);
+}
+
+/* **************************************************** */
+
+void AlertsManager::startFlowAlertsWriter() {
+  if((flow_alerts_queue = (FlowAlert**)calloc(ALERTS_MANAGER_FLOW_ALERTS_QUEUE_LEN, sizeof(FlowAlert*))) == NULL) {
+    ntop->getTrace()->traceEvent(TRACE_WARNING, "Not enough memory: flow alerts will not be stored");
+    return;
+  }
+
+  flow_alerts_writer_running = true;
+
+  if(pthread_create(&flow_alerts_writer, NULL, ::flowAlertsWriterLoop, (void*)this) != 0) {
+    ntop->getTrace()->traceEvent(TRACE_WARNING, "Unable to start the flow alerts writer [ifid: %d]", ifid);
+    flow_alerts_writer_running = false;
+    return;
+  }
+
+  flow_alerts_writer_started = true;
+}
+
+/* **************************************************** */
+
+void AlertsManager::stopFlowAlertsWriter() {
+  flow_alerts_queue_m.lock(__FILE__, __LINE__);
+  flow_alerts_writer_running = false;
+  flow_alerts_queue_m.unlock(__FILE__, __LINE__);
+
+  if(flow_alerts_writer_started) {
+    /* The writer drains the queue before leaving */
+    pthread_join(flow_alerts_writer, NULL);
+    flow_alerts_writer_started = false;
+  }
 }
 
 /* **************************************************** */
@@ -490,12 +551,77 @@ int AlertsManager::releaseAlert(AlertEngine alert_engine,
 
 /* **************************************************** */
 
+json_object* AlertsManager::alert2notification(AlertEntity alert_entity, const char *alert_entity_value,
+					      const char *engaged_alert_id,
+					      AlertType alert_type, AlertLevel alert_severity,
+					      const char *alert_json,
+					      const char *alert_origin, const char *alert_target,
+					      bool engage, time_t when, const FlowAlert *flow_alert) {
+  json_object *notification;
+
+  if((notification = json_object_new_object()) == NULL) {
+    ntop->getTrace()->traceEvent(TRACE_ERROR, "json_object_new_object: Not enough memory");
+    return(NULL);
+  }
+
+  /* Mandatory information */
+  json_object_object_add(notification, "ifid", json_object_new_int(iface->get_id()));
+  json_object_object_add(notification, "entity_type", json_object_new_int(alert_entity));
+  json_object_object_add(notification, "entity_value", json_object_new_string(alert_entity_value));
+  json_object_object_add(notification, "type", json_object_new_int(alert_type));
+  json_object_object_add(notification, "severity", json_object_new_int(alert_severity));
+  json_object_object_add(notification, "message", json_object_new_string(alert_json));
+  json_object_object_add(notification, "tstamp",  json_object_new_int64(when));
+  json_object_object_add(notification, "action",
+			 json_object_new_string(
+						engaged_alert_id ? (engage ? ALERT_ACTION_ENGAGE : ALERT_ACTION_RELEASE)
+						: ALERT_ACTION_STORE)
+			 );
+
+  /* optional */
+  if(alert_origin) json_object_object_add(notification, "origin", json_object_new_string(alert_origin));
+  if(alert_target) json_object_object_add(notification, "target", json_object_new_string(alert_target));
+  if(engaged_alert_id) json_object_object_add(notification, "alert_key", json_object_new_string(engaged_alert_id));
+
+  /* flow only - only put relevant information for message generation */
+  if(flow_alert) {
+    json_object *flow_obj;
+
+    if((flow_obj = json_object_new_object()) == NULL) {
+      ntop->getTrace()->traceEvent(TRACE_ERROR, "json_object_new_object: Not enough memory");
+      json_object_put(notification);
+      return(NULL);
+    }
+
+    /* mandatory */
+    json_object_object_add(flow_obj, "cli_port", json_object_new_int(flow_alert->cli_port));
+    json_object_object_add(flow_obj, "srv_port", json_object_new_int(flow_alert->srv_port));
+    json_object_object_add(flow_obj, "cli_blacklisted", json_object_new_int(flow_alert->cli_blacklisted ? 1 : 0));
+    json_object_object_add(flow_obj, "srv_blacklisted", json_object_new_int(flow_alert->srv_blacklisted ? 1 : 0));
+    json_object_object_add(flow_obj, "vlan_id", json_object_new_int(flow_alert->vlan_id));
+    json_object_object_add(flow_obj, "proto", json_object_new_int(flow_alert->proto));
+    json_object_object_add(flow_obj, "flow_status", json_object_new_int((int)flow_alert->status));
+    json_object_object_add(flow_obj, "flow_status_map", json_object_new_int64(flow_alert->status_map));
+    json_object_object_add(flow_obj, "l7_proto", json_object_new_int(flow_alert->l7_proto));
+
+    /* optional */
+    if(flow_alert->cli_ip[0]) json_object_object_add(flow_obj, "cli_addr", json_object_new_string(flow_alert->cli_ip));
+    if(flow_alert->srv_ip[0]) json_object_object_add(flow_obj, "srv_addr", json_object_new_string(flow_alert->srv_ip));
+
+    json_object_object_add(notification, "flow", flow_obj);
+  }
+
+  return(notification);
+}
+
+/* **************************************************** */
+
 bool AlertsManager::notifyAlert(AlertEntity alert_entity, const char *alert_entity_value,
 				const char *engaged_alert_id,
 				AlertType alert_type, AlertLevel alert_severity,
 				const char *alert_json,
 				const char *alert_origin, const char *alert_target,
-				bool engage, time_t when, Flow *flow) {
+				bool engage, time_t when, const FlowAlert *flow_alert) {
   bool rv = false;
 
   if(!ntop->getPrefs()->are_alerts_disabled()
@@ -503,62 +629,9 @@ bool AlertsManager::notifyAlert(AlertEntity alert_entity, const char *alert_enti
     json_object *notification;
     const char *json_alert;
 
-    if((notification = json_object_new_object()) != NULL) {
-      /* Mandatory information */
-      json_object_object_add(notification, "ifid", json_object_new_int(iface->get_id()));
-      json_object_object_add(notification, "entity_type", json_object_new_int(alert_entity));
-      json_object_object_add(notification, "entity_value", json_object_new_string(alert_entity_value));
-      json_object_object_add(notification, "type", json_object_new_int(alert_type));
-      json_object_object_add(notification, "severity", json_object_new_int(alert_severity));
-      json_object_object_add(notification, "message", json_object_new_string(alert_json));
-      json_object_object_add(notification, "tstamp",  json_object_new_int64(when));
-      json_object_object_add(notification, "action",
-			     json_object_new_string(
-						    engaged_alert_id ? (engage ? ALERT_ACTION_ENGAGE : ALERT_ACTION_RELEASE)
-						    : ALERT_ACTION_STORE)
-			     );
-      
-      /* optional */
-      if(alert_origin) json_object_object_add(notification, "origin", json_object_new_string(alert_origin));
-      if(alert_target) json_object_object_add(notification, "target", json_object_new_string(alert_target));
-      if(engaged_alert_id) json_object_object_add(notification, "alert_key", json_object_new_string(engaged_alert_id));
-
-      /* flow only - only put relevant information for message generation */
-      if(flow) {
-	json_object *flow_obj;
-
-	if((flow_obj = json_object_new_object()) == NULL) {
-	  ntop->getTrace()->traceEvent(TRACE_ERROR, "json_object_new_object: Not enough memory");
-	  goto notify_return;
-	}
-
-	char cli_ip_buf[64], srv_ip_buf[64];
-	char *cli_ip = NULL, *srv_ip = NULL;
-	Host *cli = flow->get_cli_host();
-	Host *srv = flow->get_srv_host();
-
-	if(cli && cli->get_ip())
-	  cli_ip = cli->get_ip()->print(cli_ip_buf, sizeof(cli_ip_buf));
-	if(srv && srv->get_ip())
-	  srv_ip = srv->get_ip()->print(srv_ip_buf, sizeof(srv_ip_buf));
-
-	/* mandatory */
-	json_object_object_add(flow_obj, "cli_port", json_object_new_int(flow->get_cli_port()));
-	json_object_object_add(flow_obj, "srv_port", json_object_new_int(flow->get_srv_port()));
-	json_object_object_add(flow_obj, "cli_blacklisted", json_object_new_int((cli && cli->isBlacklisted()) ? 1 : 0));
-	json_object_object_add(flow_obj, "srv_blacklisted", json_object_new_int((srv && srv->isBlacklisted()) ? 1 : 0));
-	json_object_object_add(flow_obj, "vlan_id", json_object_new_int(flow->get_vlan_id()));
-	json_object_object_add(flow_obj, "proto", json_object_new_int(flow->get_protocol()));
-	json_object_object_add(flow_obj, "flow_status", json_object_new_int((int)flow->getFlowStatus()));
-	json_object_object_add(flow_obj, "l7_proto", json_object_new_int(flow->get_detected_protocol().app_protocol));
-
-	/* optional */
-	if(cli_ip) json_object_object_add(flow_obj, "cli_addr", json_object_new_string(cli_ip));
-	if(srv_ip) json_object_object_add(flow_obj, "srv_addr", json_object_new_string(srv_ip));
-
-	json_object_object_add(notification, "flow", flow_obj);
-      }
-
+    if((notification = alert2notification(alert_entity, alert_entity_value, engaged_alert_id,
+					  alert_type, alert_severity, alert_json,
+					  alert_origin, alert_target, engage, when, flow_alert)) != NULL) {
       json_alert = json_object_to_json_string(notification);
 
       if(ntop->getRedis()->rpush(ALERTS_MANAGER_NOTIFICATION_QUEUE_NAME,
@@ -569,12 +642,9 @@ bool AlertsManager::notifyAlert(AlertEntity alert_entity, const char *alert_enti
       else
 	rv = true;
 
-notify_return:
-
       /* Free memory */
       json_object_put(notification);
-    } else
-      ntop->getTrace()->traceEvent(TRACE_ERROR, "json_object_new_object: Not enough memory");
+    }
   }
 
   return rv;
@@ -646,140 +716,317 @@ int AlertsManager::storeAlert(AlertEntity alert_entity, const char *alert_entity
 
 /* **************************************************** */
 
-int AlertsManager::storeFlowAlert(Flow *f) {
-  if(!ntop->getPrefs()->are_alerts_disabled()) {
-    const char *alert_json;
-    char cli_ip_buf[64], srv_ip_buf[64];
-    char query[STORE_MANAGER_MAX_QUERY];
-    sqlite3_stmt *stmt = NULL;
-    int rc = 0;
-    Host *cli, *srv;
-    char *cli_ip = NULL, *srv_ip = NULL;
-    char cb[64], cb1[64];
-    const char *msg;
-    AlertType alert_type;
-    AlertLevel alert_severity;
-    time_t now = time(NULL);
-    char *info;
-    json_object *alert_json_obj;
- 
-    if(!store_initialized || !store_opened || !f)
-      return(-1);
+bool AlertsManager::enqueueFlowAlert(Flow *f) {
+  FlowAlert *alert;
+  Host *cli, *srv;
+  char buf[64], *os, *info;
+  bool queued = false;
 
-    markForMakeRoom(true);
+  if(ntop->getPrefs()->are_alerts_disabled() || !flow_alerts_writer_started || !f)
+    return(false);
 
-    info = f->getFlowInfo();
+  if((alert = (FlowAlert*)calloc(1, sizeof(FlowAlert))) == NULL) {
+    flow_alerts_queue_m.lock(__FILE__, __LINE__);
+    num_flow_alerts_dropped++;
+    flow_alerts_queue_m.unlock(__FILE__, __LINE__);
+    return(false);
+  }
 
-    msg = Utils::flowStatus2str(f->getFlowStatus(), &alert_type, &alert_severity);
-    cli = f->get_cli_host(), srv = f->get_srv_host();
-    if(cli && cli->get_ip())
-      cli_ip = cli->get_ip()->print(cli_ip_buf, sizeof(cli_ip_buf));
-    if(srv && srv->get_ip())
-      srv_ip = srv->get_ip()->print(srv_ip_buf, sizeof(srv_ip_buf));
+  /* Only copy here: JSON building and SQLite are up to the writer */
+  alert->when = time(NULL);
+  alert->status = f->getFlowStatus(), alert->status_map = f->getFlowStatusMap();
+  Utils::flowStatus2str(alert->status, &alert->alert_type, &alert->alert_severity);
+  alert->vlan_id = f->get_vlan_id(), alert->proto = f->get_protocol();
+  alert->l7_proto = f->get_detected_protocol().app_protocol;
+  alert->first_seen = f->get_first_seen(), alert->last_seen = f->get_last_seen();
+  alert->cli_port = f->get_cli_port(), alert->srv_port = f->get_srv_port();
+  alert->cli2srv_bytes = f->get_bytes_cli2srv(), alert->srv2cli_bytes = f->get_bytes_srv2cli();
+  alert->cli2srv_packets = f->get_packets_cli2srv(), alert->srv2cli_packets = f->get_packets_srv2cli();
+  alert->cli2srv_tcpflags = f->getTcpFlagsCli2Srv(), alert->srv2cli_tcpflags = f->getTcpFlagsSrv2Cli();
+  f->getStatusInfo(&alert->status_info);
+
+  if((info = f->getFlowInfo()) != NULL) alert->info = strdup(info);
+
+  if((cli = f->get_cli_host()) != NULL) {
+    if(cli->get_ip()) cli->get_ip()->print(alert->cli_ip, sizeof(alert->cli_ip));
+    snprintf(alert->cli_country, sizeof(alert->cli_country), "%s", cli->get_country(buf, sizeof(buf)));
+    if((os = cli->get_os()) != NULL) alert->cli_os = strdup(os);
+    alert->cli_asn = cli->get_asn(), alert->cli_host_pool_id = cli->get_host_pool();
+    alert->cli_blacklisted = cli->isBlacklisted(), alert->cli_localhost = cli->isLocalHost();
+  }
 
-    json_object *status_info = f->flow2statusinfojson();
+  if((srv = f->get_srv_host()) != NULL) {
+    if(srv->get_ip()) srv->get_ip()->print(alert->srv_ip, sizeof(alert->srv_ip));
+    snprintf(alert->srv_country, sizeof(alert->srv_country), "%s", srv->get_country(buf, sizeof(buf)));
+    if((os = srv->get_os()) != NULL) alert->srv_os = strdup(os);
+    alert->srv_asn = srv->get_asn(), alert->srv_host_pool_id = srv->get_host_pool();
+    alert->srv_blacklisted = srv->isBlacklisted(), alert->srv_localhost = srv->isLocalHost();
+  }
 
-    if((alert_json_obj = json_object_new_object()) == NULL)
-      return(-1);
+  flow_alerts_queue_m.lock(__FILE__, __LINE__);
 
-    json_object_object_add(alert_json_obj, "info", json_object_new_string(info ? info : (char*)""));
-    json_object_object_add(alert_json_obj, "status_info", status_info ? status_info : json_object_new_object());
-    alert_json = json_object_to_json_string(alert_json_obj);
+  if(flow_alerts_writer_running && (flow_alerts_queue_len < ALERTS_MANAGER_FLOW_ALERTS_QUEUE_LEN)) {
+    flow_alerts_queue[flow_alerts_queue_head] = alert;
+    flow_alerts_queue_head = (flow_alerts_queue_head + 1) % ALERTS_MANAGER_FLOW_ALERTS_QUEUE_LEN;
+    flow_alerts_queue_len++, num_flow_alerts_queued++;
+    queued = true;
+  } else
+    num_flow_alerts_dropped++; /* The writer can't keep up */
 
-    notifyAlert(alert_entity_flow, "flow", NULL,
-		alert_type, alert_severity, alert_json,
-		cli_ip, srv_ip, false, now, f);
+  flow_alerts_queue_m.unlock(__FILE__, __LINE__);
 
-    // ntop->getTrace()->traceEvent(TRACE_NORMAL, "%s %s", cli_ip, srv_ip);
-    /* TODO: implement check maximum for flow alerts
-       else if(check_maximum && isMaximumReached(alert_entity, alert_entity_value, false))
-       deleteOldestAlert(alert_entity, alert_entity_value, false);
-    */
+  if(queued)
+    f->setFlowAlerted();
+  else
+    freeFlowAlert(alert);
 
-    /* This alert is being engaged */
-    snprintf(query, sizeof(query),
-	     "INSERT INTO %s "
-	     "(alert_tstamp, alert_type, alert_severity, alert_json, "
-	     "vlan_id, proto, l7_proto, first_switched, last_switched, "
-	     "cli_country, srv_country, cli_os, srv_os, cli_asn, srv_asn, "
-	     "cli_addr, srv_addr, cli_port, srv_port, "
-	     "cli2srv_bytes, srv2cli_bytes, "
-	     "cli2srv_packets, srv2cli_packets, "
-	     "cli2srv_tcpflags, srv2cli_tcpflags, cli_blacklisted, srv_blacklisted, "
-	     "cli_localhost, srv_localhost, cli_host_pool_id, srv_host_pool_id, flow_status) "
-	     "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?); ",
-	     ALERTS_MANAGER_FLOWS_TABLE_NAME);
+  return(queued);
+}
 
-    m.lock(__FILE__, __LINE__);
+/* **************************************************** */
 
-    if(sqlite3_prepare(db, query, -1, &stmt, 0)) {
-      ntop->getTrace()->traceEvent(TRACE_ERROR, "Unable to prepare the statement for %s", query);
-      rc = 3;
-      goto out;
-    }
+u_int32_t AlertsManager::dequeueFlowAlerts(FlowAlert **alerts, u_int32_t max_num) {
+  u_int32_t num = 0;
+
+  flow_alerts_queue_m.lock(__FILE__, __LINE__);
+
+  while((num < max_num) && (flow_alerts_queue_len > 0)) {
+    alerts[num++] = flow_alerts_queue[flow_alerts_queue_tail];
+    flow_alerts_queue_tail = (flow_alerts_queue_tail + 1) % ALERTS_MANAGER_FLOW_ALERTS_QUEUE_LEN;
+    flow_alerts_queue_len--;
+  }
+
+  flow_alerts_queue_m.unlock(__FILE__, __LINE__);
+
+  return(num);
+}
+
+/* **************************************************** */
 
-    if(sqlite3_bind_int64(stmt, 1, static_cast<long int>(now))
-       || sqlite3_bind_int(stmt,   2, (int)(alert_type))
-       || sqlite3_bind_int(stmt,   3, (int)(alert_severity))
+void AlertsManager::flowAlertsWriterLoop() {
+  FlowAlert *alerts[ALERTS_MANAGER_FLOW_ALERTS_BATCH];
+  u_int32_t num;
+
+  while(true) {
+    if((num = dequeueFlowAlerts(alerts, ALERTS_MANAGER_FLOW_ALERTS_BATCH)) > 0)
+      writeFlowAlerts(alerts, num);
+    else if(!flow_alerts_writer_running)
+      break; /* Stopped and drained */
+    else
+      _usleep(ALERTS_MANAGER_FLOW_ALERTS_IDLE_USEC);
+  }
+}
+
+/* **************************************************** */
+
+json_object* AlertsManager::flowAlert2json(const FlowAlert *alert) {
+  json_object *alert_json_obj, *status_info;
+
+  if((alert_json_obj = json_object_new_object()) == NULL)
+    return(NULL);
+
+  status_info = Flow::statusInfo2json(&alert->status_info);
+
+  json_object_object_add(alert_json_obj, "info", json_object_new_string(alert->info ? alert->info : (char*)""));
+  json_object_object_add(alert_json_obj, "status_info", status_info ? status_info : json_object_new_object());
+
+  return(alert_json_obj);
+}
+
+/* **************************************************** */
+
+void AlertsManager::writeFlowAlerts(FlowAlert **alerts, u_int32_t num) {
+  json_object *alerts_json[ALERTS_MANAGER_FLOW_ALERTS_BATCH];
+  char query[STORE_MANAGER_MAX_QUERY];
+  sqlite3_stmt *stmt = NULL;
+  struct timeval begin, end;
+  u_int32_t num_written = 0;
+  int rc;
+
+  gettimeofday(&begin, NULL);
+
+  for(u_int32_t i = 0; i < num; i++)
+    alerts_json[i] = flowAlert2json(alerts[i]);
+
+  markForMakeRoom(true);
+
+  /* TODO: implement check maximum for flow alerts
+     else if(check_maximum && isMaximumReached(alert_entity, alert_entity_value, false))
+     deleteOldestAlert(alert_entity, alert_entity_value, false);
+  */
+
+  snprintf(query, sizeof(query),
+	   "INSERT INTO %s "
+	   "(alert_tstamp, alert_type, alert_severity, alert_json, "
+	   "vlan_id, proto, l7_proto, first_switched, last_switched, "
+	   "cli_country, srv_country, cli_os, srv_os, cli_asn, srv_asn, "
+	   "cli_addr, srv_addr, cli_port, srv_port, "
+	   "cli2srv_bytes, srv2cli_bytes, "
+	   "cli2srv_packets, srv2cli_packets, "
+	   "cli2srv_tcpflags, srv2cli_tcpflags, cli_blacklisted, srv_blacklisted, "
+	   "cli_localhost, srv_localhost, cli_host_pool_id, srv_host_pool_id, flow_status) "
+	   "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?); ",
+	   ALERTS_MANAGER_FLOWS_TABLE_NAME);
+
+  m.lock(__FILE__, __LINE__);
+
+  /* One transaction per batch: a single journal sync for all the alerts */
+  if(sqlite3_exec(db, "BEGIN TRANSACTION;", NULL, NULL, NULL) != SQLITE_OK)
+    ntop->getTrace()->traceEvent(TRACE_WARNING, "Unable to begin the flow alerts transaction: %s", sqlite3_errmsg(db));
+
+  if(sqlite3_prepare_v2(db, query, -1, &stmt, 0)) {
+    ntop->getTrace()->traceEvent(TRACE_ERROR, "Unable to prepare the statement for %s", query);
+    stmt = NULL;
+  }
+
+  for(u_int32_t i = 0; stmt && (i < num); i++) {
+    FlowAlert *a = alerts[i];
+    const char *alert_json = alerts_json[i] ? json_object_to_json_string(alerts_json[i]) : NULL;
+    AlertType alert_type;
+    AlertLevel alert_severity;
+
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+
+    if(sqlite3_bind_int64(stmt, 1, static_cast<long int>(a->when))
+       || sqlite3_bind_int(stmt,   2, (int)(a->alert_type))
+       || sqlite3_bind_int(stmt,   3, (int)(a->alert_severity))
        || sqlite3_bind_text(stmt,  4, alert_json, -1, SQLITE_STATIC)
-       || sqlite3_bind_int(stmt,   5, f->get_vlan_id())
-       || sqlite3_bind_int(stmt,   6, f->get_protocol())
-       || sqlite3_bind_int(stmt,   7, f->get_detected_protocol().app_protocol)
-       || sqlite3_bind_int(stmt,   8, f->get_first_seen())
-       || sqlite3_bind_int(stmt,   9, f->get_last_seen())
-       || sqlite3_bind_text(stmt, 10, cli ? cli->get_country(cb, sizeof(cb)) : NULL, -1, SQLITE_STATIC)
-       || sqlite3_bind_text(stmt, 11, srv ? srv->get_country(cb1, sizeof(cb1)) : NULL, -1, SQLITE_STATIC)
-       || sqlite3_bind_text(stmt, 12, cli ? cli->get_os() : NULL, -1, SQLITE_STATIC)
-       || sqlite3_bind_text(stmt, 13, srv ? srv->get_os() : NULL, -1, SQLITE_STATIC)
-       || sqlite3_bind_int(stmt,  14, cli ? cli->get_asn() : 0)
-       || sqlite3_bind_int(stmt,  15, srv ? srv->get_asn() : 0)
-       || sqlite3_bind_text(stmt, 16, cli_ip, -1, SQLITE_STATIC)
-       || sqlite3_bind_text(stmt, 17, srv_ip, -1, SQLITE_STATIC)
-       || sqlite3_bind_int(stmt,  18, f->get_cli_port())
-       || sqlite3_bind_int(stmt,  19, f->get_srv_port())
-       || sqlite3_bind_int64(stmt,20, f->get_bytes_cli2srv())
-       || sqlite3_bind_int64(stmt,21, f->get_bytes_srv2cli())
-       || sqlite3_bind_int64(stmt,22, f->get_packets_cli2srv())
-       || sqlite3_bind_int64(stmt,23, f->get_packets_srv2cli())
-       || sqlite3_bind_int(stmt,  24, f->getTcpFlagsCli2Srv())
-       || sqlite3_bind_int(stmt,  25, f->getTcpFlagsSrv2Cli())
-       || sqlite3_bind_int(stmt,  26, (cli && cli->isBlacklisted()) ? 1 : 0)
-       || sqlite3_bind_int(stmt,  27, (srv && srv->isBlacklisted()) ? 1 : 0)
-       || sqlite3_bind_int(stmt,  28, (cli && cli->isLocalHost()) ? 1 : 0)
-       || sqlite3_bind_int(stmt,  29, (srv && srv->isLocalHost()) ? 1 : 0)
-       || sqlite3_bind_int(stmt,  30, cli ? cli->get_host_pool() : 0)
-       || sqlite3_bind_int(stmt,  31, srv ? srv->get_host_pool() : 0)
-       || sqlite3_bind_int(stmt,  32, (int)f->getFlowStatus())
+       || sqlite3_bind_int(stmt,   5, a->vlan_id)
+       || sqlite3_bind_int(stmt,   6, a->proto)
+       || sqlite3_bind_int(stmt,   7, a->l7_proto)
+       || sqlite3_bind_int(stmt,   8, a->first_seen)
+       || sqlite3_bind_int(stmt,   9, a->last_seen)
+       || sqlite3_bind_text(stmt, 10, a->cli_ip[0] ? a->cli_country : NULL, -1, SQLITE_STATIC)
+       || sqlite3_bind_text(stmt, 11, a->srv_ip[0] ? a->srv_country : NULL, -1, SQLITE_STATIC)
+       || sqlite3_bind_text(stmt, 12, a->cli_os, -1, SQLITE_STATIC)
+       || sqlite3_bind_text(stmt, 13, a->srv_os, -1, SQLITE_STATIC)
+       || sqlite3_bind_int(stmt,  14, a->cli_asn)
+       || sqlite3_bind_int(stmt,  15, a->srv_asn)
+       || sqlite3_bind_text(stmt, 16, a->cli_ip[0] ? a->cli_ip : NULL, -1, SQLITE_STATIC)
+       || sqlite3_bind_text(stmt, 17, a->srv_ip[0] ? a->srv_ip : NULL, -1, SQLITE_STATIC)
+       || sqlite3_bind_int(stmt,  18, a->cli_port)
+       || sqlite3_bind_int(stmt,  19, a->srv_port)
+       || sqlite3_bind_int64(stmt,20, a->cli2srv_bytes)
+       || sqlite3_bind_int64(stmt,21, a->srv2cli_bytes)
+       || sqlite3_bind_int64(stmt,22, a->cli2srv_packets)
+       || sqlite3_bind_int64(stmt,23, a->srv2cli_packets)
+       || sqlite3_bind_int(stmt,  24, a->cli2srv_tcpflags)
+       || sqlite3_bind_int(stmt,  25, a->srv2cli_tcpflags)
+       || sqlite3_bind_int(stmt,  26, a->cli_blacklisted ? 1 : 0)
+       || sqlite3_bind_int(stmt,  27, a->srv_blacklisted ? 1 : 0)
+       || sqlite3_bind_int(stmt,  28, a->cli_localhost ? 1 : 0)
+       || sqlite3_bind_int(stmt,  29, a->srv_localhost ? 1 : 0)
+       || sqlite3_bind_int(stmt,  30, a->cli_host_pool_id)
+       || sqlite3_bind_int(stmt,  31, a->srv_host_pool_id)
+       || sqlite3_bind_int(stmt,  32, (int)a->status)
        ) {
       ntop->getTrace()->traceEvent(TRACE_ERROR, "Unable to bind to arguments to %s", query);
-      rc = 2;
-      goto out;
+      continue;
     }
 
     while((rc = sqlite3_step(stmt)) != SQLITE_DONE) {
-      if(rc == SQLITE_ERROR) {
+      if((rc == SQLITE_ERROR) || (rc == SQLITE_CONSTRAINT) || (rc == SQLITE_MISUSE)) {
 	ntop->getTrace()->traceEvent(TRACE_ERROR, "SQL Error: step [%s][%s]",
 				     query, sqlite3_errmsg(db));
-	rc = 1;
-	goto out;
+	break;
       }
     }
 
+    if(rc == SQLITE_DONE)
+      num_written++;
+
+    ntop->getTrace()->traceEvent(TRACE_INFO, "[%s] %s",
+				 Utils::flowStatus2str(a->status, &alert_type, &alert_severity),
+				 alert_json ? alert_json : "");
+  }
+
+  if(stmt) sqlite3_finalize(stmt);
+
+  if(sqlite3_exec(db, "COMMIT;", NULL, NULL, NULL) != SQLITE_OK) {
+    ntop->getTrace()->traceEvent(TRACE_ERROR, "Unable to commit the flow alerts: %s", sqlite3_errmsg(db));
+    sqlite3_exec(db, "ROLLBACK;", NULL, NULL, NULL);
+    num_written = 0;
+  }
+
+  m.unlock(__FILE__, __LINE__);
+
+  if(num_written > 0)
     alerts_stored = true;
-    rc = 0;
-  out:
 
-    if(stmt) sqlite3_finalize(stmt);
-    m.unlock(__FILE__, __LINE__);
+  notifyFlowAlerts(alerts, alerts_json, num);
 
-    f->setFlowAlerted();
+  gettimeofday(&end, NULL);
 
-    ntop->getTrace()->traceEvent(TRACE_INFO, "[%s] %s", msg, alert_json);
-    json_object_put(alert_json_obj);
+  num_flow_alerts_written += num_written, num_flow_alerts_failed += num - num_written;
+  num_flow_alerts_batches++;
+  flow_alerts_batch_usec += (u_int64_t)(Utils::msTimevalDiff(&end, &begin) * 1000);
 
-    return rc;
-  } else
-    return(-1);
+  for(u_int32_t i = 0; i < num; i++) {
+    if(alerts_json[i]) json_object_put(alerts_json[i]);
+    freeFlowAlert(alerts[i]);
+  }
+}
+
+/* **************************************************** */
+
+void AlertsManager::notifyFlowAlerts(FlowAlert **alerts, json_object **alerts_json, u_int32_t num) {
+  json_object *notifications[ALERTS_MANAGER_FLOW_ALERTS_BATCH];
+  const char *msgs[ALERTS_MANAGER_FLOW_ALERTS_BATCH];
+
+  if(ntop->getPrefs()->are_alerts_disabled()
+     || !ntop->getPrefs()->are_ext_alerts_notifications_enabled())
+    return;
+
+  for(u_int32_t i = 0; i < num; i++) {
+    FlowAlert *a = alerts[i];
+
+    notifications[i] = alert2notification(alert_entity_flow, "flow", NULL,
+					  a->alert_type, a->alert_severity,
+					  alerts_json[i] ? json_object_to_json_string(alerts_json[i]) : "",
+					  a->cli_ip[0] ? a->cli_ip : NULL, a->srv_ip[0] ? a->srv_ip : NULL,
+					  false, a->when, a);
+    msgs[i] = notifications[i] ? json_object_to_json_string(notifications[i]) : NULL;
+  }
+
+  if(ntop->getRedis()->rpush(ALERTS_MANAGER_NOTIFICATION_QUEUE_NAME, msgs, num,
+			     ALERTS_MANAGER_MAX_ENTITY_ALERTS) < 0)
+    ntop->getTrace()->traceEvent(TRACE_WARNING,
+				 "An error occurred when pushing %u flow alerts to redis list %s.",
+				 num, ALERTS_MANAGER_NOTIFICATION_QUEUE_NAME);
+
+  for(u_int32_t i = 0; i < num; i++)
+    if(notifications[i]) json_object_put(notifications[i]);
+}
+
+/* **************************************************** */
+
+void AlertsManager::freeFlowAlert(FlowAlert *alert) {
+  if(alert->cli_os) free(alert->cli_os);
+  if(alert->srv_os) free(alert->srv_os);
+  if(alert->info)   free(alert->info);
+
+  free(alert);
+}
+
+/* **************************************************** */
+
+void AlertsManager::luaFlowAlertsQueue(lua_State *vm) {
+  lua_newtable(vm);
+
+  lua_push_uint64_table_entry(vm, "queue_len", flow_alerts_queue_len);
+  lua_push_uint64_table_entry(vm, "queue_size", ALERTS_MANAGER_FLOW_ALERTS_QUEUE_LEN);
+  lua_push_uint64_table_entry(vm, "queued", num_flow_alerts_queued);
+  lua_push_uint64_table_entry(vm, "dropped", num_flow_alerts_dropped);
+  lua_push_uint64_table_entry(vm, "written", num_flow_alerts_written);
+  lua_push_uint64_table_entry(vm, "failed", num_flow_alerts_failed);
+  lua_push_uint64_table_entry(vm, "batches", num_flow_alerts_batches);
+  lua_push_float_table_entry(vm, "avg_batch_ms",
+			     num_flow_alerts_batches ? (flow_alerts_batch_usec / 1000.) / num_flow_alerts_batches : 0);
+
+  lua_pushstring(vm, "flow_alerts_queue");
+  lua_insert(vm, -2);
+  lua_settable(vm, -3);
 }
 
 /* ******************************************* */
@@ -25,10 +25,9 @@
 
 /* *************************************** */
 
-AutonomousSystem::AutonomousSystem(NetworkInterface *_iface, IpAddress *ipa) : GenericHashEntry(_iface), GenericTrafficElement() {
-  asname = NULL;
+AutonomousSystem::AutonomousSystem(NetworkInterface *_iface, u_int32_t _asn, char *_asname) : GenericHashEntry(_iface), GenericTrafficElement() {
+  asn = _asn, asname = _asname;
   round_trip_time = 0;
-  ntop->getGeolocation()->getAS(ipa, &asn, &asname);
 
 #ifdef AS_DEBUG
   ntop->getTrace()->traceEvent(TRACE_NORMAL, "Created Autonomous System %u", asn);
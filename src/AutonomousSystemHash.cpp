@@ -31,9 +31,7 @@ AutonomousSystemHash::AutonomousSystemHash(NetworkInterface *_iface, u_int _num_
 
 /* ************************************ */
 
-AutonomousSystem* AutonomousSystemHash::get(IpAddress *ipa) {
-  u_int32_t asn;
-  ntop->getGeolocation()->getAS(ipa, &asn, NULL /* Don't care about AS name here */);
+AutonomousSystem* AutonomousSystemHash::get(u_int32_t asn) {
   u_int32_t hash = asn;
 
   hash %= num_hashes;
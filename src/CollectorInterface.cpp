@@ -337,9 +337,12 @@ void CollectorInterface::purgeIdle(time_t when) {
   NetworkInterface::purgeIdle(when);
 
   if(flowHashing) {
-    FlowHashing *current, *tmp;
-    HASH_ITER(hh, flowHashing, current, tmp)
-      static_cast<NetworkInterface*>(current->iface)->purgeIdle(when);
+    for(u_int16_t i = 0; i < flowHashing->getNumEntries(); i++) {
+      SubInterfaceEntry *e = flowHashing->getEntry(i);
+
+      if(e->worker == NULL)
+	e->iface->purgeIdle(when);
+    }
   }
 }
 
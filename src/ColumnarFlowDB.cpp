@@ -0,0 +1,853 @@
+/*
+ *
+ * (C) 2019 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+
+
+
+#include "ntop_includes.h"
+
+#define FLOW_STORE_ALIGN(x) (((x) + 7) & ~((u_int64_t)7))
+
+/* Pointers to the sections of an encoded chunk */
+typedef struct {
+  u_int8_t *dict;
+  u_int32_t *first_seen, *last_seen, *cli_ip, *srv_ip;
+  u_int16_t *cli_port, *srv_port, *vlan_id, *l7_proto;
+  u_int8_t *l4_proto;
+  u_int64_t *cli2srv_bytes, *srv2cli_bytes;
+  u_int32_t *cli2srv_packets, *srv2cli_packets;
+  u_int32_t *l4_values, *l7_values;
+  u_int64_t *l4_bitmaps, *l7_bitmaps;
+} flow_store_chunk_layout_t;
+
+struct FlowStoreIP {
+  u_int8_t addr[16];
+
+  inline bool operator<(const FlowStoreIP &o) const  { return(memcmp(addr, o.addr, 16) < 0);  };
+  inline bool operator==(const FlowStoreIP &o) const { return(memcmp(addr, o.addr, 16) == 0); };
+};
+
+/* **************************************************** */
+
+/* Returns the chunk size; pointers are only set when base is not NULL */
+static u_int64_t chunkLayout(u_char *base, const flow_store_chunk_header_t *h, flow_store_chunk_layout_t *l) {
+  u_int64_t n = h->num_rows, words = (n + 63) / 64, off = FLOW_STORE_ALIGN(sizeof(flow_store_chunk_header_t));
+
+#define FLOW_STORE_SECTION(field, type, num)				\
+  if(base) l->field = (type*)&base[off];				\
+  off = FLOW_STORE_ALIGN(off + (u_int64_t)(num) * sizeof(type))
+
+  FLOW_STORE_SECTION(dict, u_int8_t, (u_int64_t)h->num_ips * 16);
+  FLOW_STORE_SECTION(first_seen, u_int32_t, n);
+  FLOW_STORE_SECTION(last_seen, u_int32_t, n);
+  FLOW_STORE_SECTION(cli_ip, u_int32_t, n);
+  FLOW_STORE_SECTION(srv_ip, u_int32_t, n);
+  FLOW_STORE_SECTION(cli_port, u_int16_t, n);
+  FLOW_STORE_SECTION(srv_port, u_int16_t, n);
+  FLOW_STORE_SECTION(vlan_id, u_int16_t, n);
+  FLOW_STORE_SECTION(l7_proto, u_int16_t, n);
+  FLOW_STORE_SECTION(l4_proto, u_int8_t, n);
+  FLOW_STORE_SECTION(cli2srv_bytes, u_int64_t, n);
+  FLOW_STORE_SECTION(srv2cli_bytes, u_int64_t, n);
+  FLOW_STORE_SECTION(cli2srv_packets, u_int32_t, n);
+  FLOW_STORE_SECTION(srv2cli_packets, u_int32_t, n);
+  FLOW_STORE_SECTION(l4_values, u_int32_t, h->num_l4);
+  FLOW_STORE_SECTION(l4_bitmaps, u_int64_t, (u_int64_t)h->num_l4 * words);
+  FLOW_STORE_SECTION(l7_values, u_int32_t, h->num_l7);
+  FLOW_STORE_SECTION(l7_bitmaps, u_int64_t, (u_int64_t)h->num_l7 * words);
+
+#undef FLOW_STORE_SECTION
+
+  return(off);
+}
+
+/* **************************************************** */
+
+static void* flowStoreWriterLoop(void *ptr) {
+  ((ColumnarFlowDB*)ptr)->writerLoop();
+  return(NULL);
+}
+
+/* **************************************************** */
+
+ColumnarFlowDB::ColumnarFlowDB(NetworkInterface *_iface, const char *_dir) : DB() {
+  char buf[32];
+
+  iface = _iface;
+
+  if(_dir)
+    snprintf(dir, sizeof(dir), "%s", _dir);
+  else
+    snprintf(dir, sizeof(dir), "%s/%d/flowstore", ntop->get_working_dir(), iface->get_id());
+
+  ntop->fixPath(dir);
+  Utils::mkdir_tree(dir);
+
+  retention_secs = FLOW_STORE_DEFAULT_RETENTION_DAYS * 86400;
+
+  buf[0] = '\0';
+  if((!ntop->getRedis()->get((char*)CONST_RUNTIME_PREFS_FLOW_STORE_RETENTION, buf, sizeof(buf)))
+     && (atoi(buf) > 0))
+    retention_secs = atoi(buf) * 86400;
+
+  cur_rows = NULL, cur_num_rows = 0, cur_partition = 0, cur_since = 0;
+  last_retention_partition = 0, num_pending_chunks = 0, num_written_bytes = 0;
+  append_partition = 0, append_offset = 0;
+
+  writer_running = true, writer_started = false;
+
+  if(pthread_create(&writer, NULL, flowStoreWriterLoop, (void*)this) == 0)
+    writer_started = true;
+  else
+    ntop->getTrace()->traceEvent(TRACE_WARNING, "Unable to start the flow store writer of %s", iface->get_name());
+
+  running = writer_started;
+
+  ntop->getTrace()->traceEvent(TRACE_NORMAL, "Dumping flows of %s to the columnar store %s [retention: %u days]",
+			       iface->get_name(), dir, retention_secs / 86400);
+}
+
+/* **************************************************** */
+
+ColumnarFlowDB::~ColumnarFlowDB() {
+  shutdown();
+
+  while(!full_chunks.empty()) {
+    free(full_chunks.front().second.first);
+    full_chunks.pop_front();
+  }
+
+  if(cur_rows) free(cur_rows);
+}
+
+/* **************************************************** */
+
+void ColumnarFlowDB::shutdown() {
+  if(writer_started) {
+    /* The writer drains the buffered rows before leaving */
+    writer_running = false;
+    pthread_join(writer, NULL);
+    writer_started = false;
+  }
+
+  running = false;
+}
+
+/* **************************************************** */
+
+void ColumnarFlowDB::setIP(u_int8_t *dst, IpAddress *ip) {
+  if(ip->isIPv4()) {
+    u_int32_t v4 = ip->get_ipv4();
+
+    memset(dst, 0, 10), dst[10] = dst[11] = 0xFF;
+    memcpy(&dst[12], &v4, 4);
+  } else
+    memcpy(dst, ip->get_ipv6(), 16);
+}
+
+/* **************************************************** */
+
+void ColumnarFlowDB::getIP(const u_int8_t *src, IpAddress *ip) {
+  static const u_int8_t v4_mapped[12] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF };
+
+  if(memcmp(src, v4_mapped, sizeof(v4_mapped)) == 0) {
+    u_int32_t v4;
+
+    memcpy(&v4, &src[12], 4);
+    ip->set(v4);
+  } else
+    ip->set((struct ndpi_in6_addr*)src);
+}
+
+/* **************************************************** */
+
+bool ColumnarFlowDB::dumpFlow(time_t when, Flow *f, char *json) {
+  Host *cli = f->get_cli_host(), *srv = f->get_srv_host();
+  FlowStoreRow r;
+
+  if(!cli || !srv) {
+    incNumDroppedFlows();
+    return(false);
+  }
+
+  setIP(r.cli_ip, cli->get_ip()), setIP(r.srv_ip, srv->get_ip());
+  r.first_seen = f->get_partial_first_seen(), r.last_seen = f->get_partial_last_seen();
+  r.cli_port = f->get_cli_port(), r.srv_port = f->get_srv_port();
+  r.vlan_id = f->get_vlan_id(), r.l4_proto = f->get_protocol();
+  r.l7_proto = f->get_detected_protocol().app_protocol;
+  r.cli2srv_bytes = f->get_partial_bytes_cli2srv(), r.srv2cli_bytes = f->get_partial_bytes_srv2cli();
+  r.cli2srv_packets = f->get_partial_packets_cli2srv(), r.srv2cli_packets = f->get_partial_packets_srv2cli();
+
+  return(addRow(&r));
+}
+
+/* **************************************************** */
+
+bool ColumnarFlowDB::queueChunk() {
+  if(full_chunks.size() >= FLOW_STORE_MAX_QUEUED_CHUNKS) {
+    /* The writer can't keep up: the buffer is reused */
+    incNumQueueDroppedFlows(cur_num_rows);
+    cur_num_rows = 0;
+    return(false);
+  }
+
+  full_chunks.push_back(std::make_pair(cur_partition, std::make_pair(cur_rows, cur_num_rows)));
+  cur_rows = NULL, cur_num_rows = 0;
+  num_pending_chunks++;
+
+  return(true);
+}
+
+/* **************************************************** */
+
+bool ColumnarFlowDB::addRow(const FlowStoreRow *r) {
+  u_int32_t partition = r->last_seen - (r->last_seen % FLOW_STORE_PARTITION_SECS);
+  bool rc = true;
+
+  m.lock(__FILE__, __LINE__);
+
+  /* A chunk belongs to a single partition */
+  if((cur_num_rows > 0) && (partition != cur_partition))
+    queueChunk();
+
+  if((cur_rows == NULL)
+     && ((cur_rows = (FlowStoreRow*)malloc(FLOW_STORE_CHUNK_ROWS * sizeof(FlowStoreRow))) == NULL)) {
+    incNumDroppedFlows();
+    rc = false;
+  } else {
+    if(cur_num_rows == 0)
+      cur_partition = partition, cur_since = time(NULL);
+
+    memcpy(&cur_rows[cur_num_rows++], r, sizeof(FlowStoreRow));
+
+    if(cur_num_rows == FLOW_STORE_CHUNK_ROWS)
+      queueChunk();
+  }
+
+  m.unlock(__FILE__, __LINE__);
+
+  return(rc);
+}
+
+/* **************************************************** */
+
+void ColumnarFlowDB::sync() {
+  m.lock(__FILE__, __LINE__);
+  if(cur_num_rows > 0) queueChunk();
+  m.unlock(__FILE__, __LINE__);
+
+  while(writer_started && (num_pending_chunks > 0))
+    _usleep(10000);
+}
+
+/* **************************************************** */
+
+void ColumnarFlowDB::writerLoop() {
+  while(true) {
+    std::pair<u_int32_t, std::pair<FlowStoreRow*, u_int32_t> > chunk;
+    bool found = false;
+
+    m.lock(__FILE__, __LINE__);
+
+    /* Rows are written after at most FLOW_STORE_FLUSH_SECS, and all of them on shutdown */
+    if(full_chunks.empty() && (cur_num_rows > 0)
+       && (!writer_running || ((time(NULL) - cur_since) >= FLOW_STORE_FLUSH_SECS)))
+      queueChunk();
+
+    if(!full_chunks.empty()) {
+      chunk = full_chunks.front();
+      full_chunks.pop_front();
+      found = true;
+    }
+
+    m.unlock(__FILE__, __LINE__);
+
+    if(found) {
+      writeChunk(chunk.first, chunk.second.first, chunk.second.second);
+      free(chunk.second.first);
+
+      m.lock(__FILE__, __LINE__);
+      num_pending_chunks--;
+      m.unlock(__FILE__, __LINE__);
+    } else if(!writer_running)
+      break;
+    else
+      _usleep(100000);
+  }
+}
+
+/* **************************************************** */
+
+u_char* ColumnarFlowDB::encodeChunk(const FlowStoreRow *rows, u_int32_t num_rows, u_int32_t *len) {
+  flow_store_chunk_header_t h;
+  flow_store_chunk_layout_t l;
+  std::vector<FlowStoreIP> ips;
+  std::map<u_int16_t, u_int32_t> l4_values, l7_values; /* value -> bitmap index */
+  u_int64_t words = (num_rows + 63) / 64, size;
+  u_int32_t idx;
+  u_char *buf;
+
+  memset(&h, 0, sizeof(h));
+  h.magic = FLOW_STORE_CHUNK_MAGIC, h.version = FLOW_STORE_VERSION, h.num_rows = num_rows;
+
+  /* Dictionary, protocols and zone maps */
+  ips.resize(2 * num_rows);
+
+  for(u_int32_t i = 0; i < num_rows; i++) {
+    const FlowStoreRow *r = &rows[i];
+    u_int64_t bytes = r->cli2srv_bytes + r->srv2cli_bytes;
+
+    memcpy(ips[2 * i].addr, r->cli_ip, 16), memcpy(ips[2 * i + 1].addr, r->srv_ip, 16);
+
+    if(l4_values.find(r->l4_proto) == l4_values.end()) { idx = l4_values.size(); l4_values[r->l4_proto] = idx; }
+    if(l7_values.find(r->l7_proto) == l7_values.end()) { idx = l7_values.size(); l7_values[r->l7_proto] = idx; }
+
+    if((i == 0) || (r->first_seen < h.min_first_seen)) h.min_first_seen = r->first_seen;
+    if((i == 0) || (r->last_seen > h.max_last_seen))   h.max_last_seen = r->last_seen;
+    if((i == 0) || (r->cli_port < h.min_cli_port))     h.min_cli_port = r->cli_port;
+    if((i == 0) || (r->cli_port > h.max_cli_port))     h.max_cli_port = r->cli_port;
+    if((i == 0) || (r->srv_port < h.min_srv_port))     h.min_srv_port = r->srv_port;
+    if((i == 0) || (r->srv_port > h.max_srv_port))     h.max_srv_port = r->srv_port;
+    if((i == 0) || (bytes < h.min_bytes))              h.min_bytes = bytes;
+    if((i == 0) || (bytes > h.max_bytes))              h.max_bytes = bytes;
+  }
+
+  std::sort(ips.begin(), ips.end());
+  ips.erase(std::unique(ips.begin(), ips.end()), ips.end());
+
+  h.num_ips = ips.size(), h.num_l4 = l4_values.size(), h.num_l7 = l7_values.size();
+
+  if((size = chunkLayout(NULL, &h, &l)) > 0xFFFFFFFF)
+    return(NULL);
+
+  h.chunk_len = (u_int32_t)size;
+
+  if((buf = (u_char*)calloc(1, size)) == NULL)
+    return(NULL);
+
+  memcpy(buf, &h, sizeof(h));
+  chunkLayout(buf, &h, &l);
+
+  for(u_int32_t i = 0; i < h.num_ips; i++)
+    memcpy(&l.dict[i * 16], ips[i].addr, 16);
+
+  for(std::map<u_int16_t, u_int32_t>::iterator it = l4_values.begin(); it != l4_values.end(); ++it)
+    l.l4_values[it->second] = it->first;
+
+  for(std::map<u_int16_t, u_int32_t>::iterator it = l7_values.begin(); it != l7_values.end(); ++it)
+    l.l7_values[it->second] = it->first;
+
+  /* Columns and bitmap indexes */
+  for(u_int32_t i = 0; i < num_rows; i++) {
+    const FlowStoreRow *r = &rows[i];
+    FlowStoreIP key;
+
+    memcpy(key.addr, r->cli_ip, 16);
+    l.cli_ip[i] = std::lower_bound(ips.begin(), ips.end(), key) - ips.begin();
+    memcpy(key.addr, r->srv_ip, 16);
+    l.srv_ip[i] = std::lower_bound(ips.begin(), ips.end(), key) - ips.begin();
+
+    l.first_seen[i] = r->first_seen, l.last_seen[i] = r->last_seen;
+    l.cli_port[i] = r->cli_port, l.srv_port[i] = r->srv_port;
+    l.vlan_id[i] = r->vlan_id, l.l7_proto[i] = r->l7_proto, l.l4_proto[i] = r->l4_proto;
+    l.cli2srv_bytes[i] = r->cli2srv_bytes, l.srv2cli_bytes[i] = r->srv2cli_bytes;
+    l.cli2srv_packets[i] = r->cli2srv_packets, l.srv2cli_packets[i] = r->srv2cli_packets;
+
+    l.l4_bitmaps[l4_values[r->l4_proto] * words + i / 64] |= (1ULL << (i % 64));
+    l.l7_bitmaps[l7_values[r->l7_proto] * words + i / 64] |= (1ULL << (i % 64));
+  }
+
+  *len = h.chunk_len;
+  return(buf);
+}
+
+/* **************************************************** */
+
+static bool flowStorePwrite(int fd, const u_char *data, u_int64_t len, u_int64_t off) {
+  while(len > 0) {
+    ssize_t n = pwrite(fd, data, len, off);
+
+    if(n < 0) {
+      if(errno == EINTR) continue;
+      return(false);
+    }
+
+    data += n, len -= n, off += n;
+  }
+
+  return(true);
+}
+
+/* **************************************************** */
+
+/* End of the last complete chunk of a partition file, as seen by the queries */
+static u_int64_t flowStoreChunksEnd(int fd, u_int64_t size) {
+  flow_store_chunk_header_t h;
+  flow_store_chunk_layout_t l;
+  u_int64_t off = 0;
+
+  while(((off + sizeof(h)) <= size)
+	&& (pread(fd, &h, sizeof(h), off) == (ssize_t)sizeof(h))
+	&& (h.magic == FLOW_STORE_CHUNK_MAGIC) && (h.version == FLOW_STORE_VERSION)
+	&& ((off + h.chunk_len) <= size)
+	&& (chunkLayout(NULL, &h, &l) == h.chunk_len))
+    off += h.chunk_len;
+
+  return(off);
+}
+
+/* **************************************************** */
+
+/*
+  Files are mmapped by the queries, so they are never truncated: chunks
+  are written after the last complete one, overwriting what is left by
+  a failed write, and published by writing their magic last.
+*/
+void ColumnarFlowDB::writeChunk(u_int32_t partition, FlowStoreRow *rows, u_int32_t num_rows) {
+  char path[MAX_PATH];
+  u_int32_t len, magic;
+  u_char *buf;
+  bool written = false;
+  struct stat st;
+  int fd;
+
+  if(partition != last_retention_partition) {
+    enforceRetention(partition);
+    last_retention_partition = partition;
+  }
+
+  if((buf = encodeChunk(rows, num_rows, &len)) == NULL) {
+    ntop->getTrace()->traceEvent(TRACE_WARNING, "Not enough memory: %u flows not stored", num_rows);
+    incNumDroppedFlows(num_rows);
+    return;
+  }
+
+  snprintf(path, sizeof(path), "%s/%u.cfs", dir, partition);
+
+  if((fd = open(path, O_RDWR | O_CREAT, 0644)) >= 0) {
+    if(fstat(fd, &st) == 0) {
+      /* Also when the file has been replaced in the meantime */
+      if((partition != append_partition) || ((u_int64_t)st.st_size < append_offset))
+	append_offset = flowStoreChunksEnd(fd, st.st_size), append_partition = partition;
+
+      magic = ((flow_store_chunk_header_t*)buf)->magic;
+      ((flow_store_chunk_header_t*)buf)->magic = 0; /* Queries stop here until published */
+
+      if(flowStorePwrite(fd, buf, len, append_offset)
+	 && flowStorePwrite(fd, (u_char*)&magic, sizeof(magic),
+			    append_offset + offsetof(flow_store_chunk_header_t, magic)))
+	written = true, append_offset += len;
+    }
+
+    close(fd);
+  }
+
+  if(written)
+    incNumExportedFlows(num_rows), num_written_bytes += len;
+  else {
+    ntop->getTrace()->traceEvent(TRACE_WARNING, "Unable to write %s: %s", path, strerror(errno));
+    incNumDroppedFlows(num_rows);
+  }
+
+  free(buf);
+}
+
+/* **************************************************** */
+
+void ColumnarFlowDB::enforceRetention(u_int32_t partition) {
+  struct dirent *entry;
+  DIR *d;
+
+  if((d = opendir(dir)) == NULL)
+    return;
+
+  while((entry = readdir(d)) != NULL) {
+    char path[MAX_PATH], ext[8];
+    u_int32_t p;
+
+    if((sscanf(entry->d_name, "%u.%7s", &p, ext) == 2) && !strcmp(ext, "cfs")
+       && ((p + retention_secs) < partition)) {
+      snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+      unlink(path);
+    }
+  }
+
+  closedir(d);
+}
+
+/* **************************************************** */
+
+FlowStoreGroupBy ColumnarFlowDB::str2GroupBy(const char *s) {
+  if(!s)                            return(flow_store_group_none);
+  else if(!strcmp(s, "host"))          return(flow_store_group_host);
+  else if(!strcmp(s, "src_host"))      return(flow_store_group_src_host);
+  else if(!strcmp(s, "dst_host"))      return(flow_store_group_dst_host);
+  else if(!strcmp(s, "port"))          return(flow_store_group_port);
+  else if(!strcmp(s, "src_port"))      return(flow_store_group_src_port);
+  else if(!strcmp(s, "dst_port"))      return(flow_store_group_dst_port);
+  else if(!strcmp(s, "l7_proto"))      return(flow_store_group_l7_proto);
+  else if(!strcmp(s, "conversations")) return(flow_store_group_conversations);
+  else                                 return(flow_store_group_none);
+}
+
+/* **************************************************** */
+
+static inline void flowStoreAdd(FlowStoreResult *r, u_int64_t bytes, u_int64_t packets) {
+  r->bytes += bytes, r->packets += packets, r->flows++;
+}
+
+/* **************************************************** */
+
+static inline void flowStoreMerge(FlowStoreResult *r, const FlowStoreResult *o) {
+  r->bytes += o->bytes, r->packets += o->packets, r->flows += o->flows;
+}
+
+/* **************************************************** */
+
+void ColumnarFlowDB::queryChunk(const u_char *chunk, const FlowStoreQuery *q, FlowStoreQueryStats *stats,
+				FlowStoreAggregation *aggr) {
+  const flow_store_chunk_header_t *h = (const flow_store_chunk_header_t*)chunk;
+  flow_store_chunk_layout_t l;
+  const u_int64_t *l4_bitmap = NULL, *l7_bitmap = NULL;
+  u_int32_t n = h->num_rows, words = (n + 63) / 64, host_idx = 0;
+  FlowStoreResult *hosts = NULL;
+  std::map<u_int64_t, FlowStoreResult> conversations;
+  bool by_host = (q->group_by == flow_store_group_host)
+    || (q->group_by == flow_store_group_src_host) || (q->group_by == flow_store_group_dst_host);
+
+  stats->chunks++;
+  chunkLayout((u_char*)chunk, h, &l);
+
+  /* Zone maps */
+  if(((time_t)h->max_last_seen < q->begin) || ((time_t)h->min_first_seen > q->end)
+     || ((q->port >= 0)
+	 && ((q->port < h->min_cli_port) || (q->port > h->max_cli_port))
+	 && ((q->port < h->min_srv_port) || (q->port > h->max_srv_port))))
+    goto skip;
+
+  /* Dictionary: the host must be in the chunk */
+  if(q->has_host) {
+    u_int32_t lo = 0, hi = h->num_ips;
+
+    while(lo < hi) {
+      u_int32_t mid = (lo + hi) / 2;
+
+      if(memcmp(&l.dict[mid * 16], q->host, 16) < 0) lo = mid + 1; else hi = mid;
+    }
+
+    if((lo == h->num_ips) || memcmp(&l.dict[lo * 16], q->host, 16))
+      goto skip;
+
+    host_idx = lo;
+  }
+
+  /* Bitmap indexes */
+  if(q->l4_proto >= 0) {
+    for(u_int32_t i = 0; i < h->num_l4; i++)
+      if(l.l4_values[i] == (u_int32_t)q->l4_proto) { l4_bitmap = &l.l4_bitmaps[i * words]; break; }
+
+    if(!l4_bitmap) goto skip;
+  }
+
+  if(q->l7_proto >= 0) {
+    for(u_int32_t i = 0; i < h->num_l7; i++)
+      if(l.l7_values[i] == (u_int32_t)q->l7_proto) { l7_bitmap = &l.l7_bitmaps[i * words]; break; }
+
+    if(!l7_bitmap) goto skip;
+  }
+
+  if(by_host && ((hosts = (FlowStoreResult*)calloc(h->num_ips, sizeof(FlowStoreResult))) == NULL))
+    return;
+
+  for(u_int32_t w = 0; w < words; w++) {
+    u_int64_t bits = ((w == words - 1) && (n % 64)) ? ((1ULL << (n % 64)) - 1) : ~0ULL;
+
+    if(l4_bitmap) bits &= l4_bitmap[w];
+    if(l7_bitmap) bits &= l7_bitmap[w];
+
+    stats->rows_scanned += __builtin_popcountll(bits);
+
+    while(bits) {
+      u_int32_t i = w * 64 + __builtin_ctzll(bits);
+      u_int64_t bytes, packets;
+
+      bits &= bits - 1;
+
+      if(((time_t)l.last_seen[i] < q->begin) || ((time_t)l.first_seen[i] > q->end)
+	 || (q->has_host && (l.cli_ip[i] != host_idx) && (l.srv_ip[i] != host_idx))
+	 || ((q->port >= 0) && (l.cli_port[i] != q->port) && (l.srv_port[i] != q->port))
+	 || ((q->vlan_id >= 0) && (l.vlan_id[i] != q->vlan_id)))
+	continue;
+
+      stats->rows_matched++;
+      bytes = l.cli2srv_bytes[i] + l.srv2cli_bytes[i];
+      packets = (u_int64_t)l.cli2srv_packets[i] + l.srv2cli_packets[i];
+
+      switch(q->group_by) {
+      case flow_store_group_host:
+	flowStoreAdd(&hosts[l.cli_ip[i]], bytes, packets);
+	if(l.srv_ip[i] != l.cli_ip[i]) flowStoreAdd(&hosts[l.srv_ip[i]], bytes, packets);
+	break;
+      case flow_store_group_src_host: flowStoreAdd(&hosts[l.cli_ip[i]], bytes, packets); break;
+      case flow_store_group_dst_host: flowStoreAdd(&hosts[l.srv_ip[i]], bytes, packets); break;
+      case flow_store_group_port:
+	flowStoreAdd(&aggr->values[l.cli_port[i]], bytes, packets);
+	if(l.srv_port[i] != l.cli_port[i]) flowStoreAdd(&aggr->values[l.srv_port[i]], bytes, packets);
+	break;
+      case flow_store_group_src_port: flowStoreAdd(&aggr->values[l.cli_port[i]], bytes, packets); break;
+      case flow_store_group_dst_port: flowStoreAdd(&aggr->values[l.srv_port[i]], bytes, packets); break;
+      case flow_store_group_l7_proto: flowStoreAdd(&aggr->values[l.l7_proto[i]], bytes, packets); break;
+      case flow_store_group_conversations:
+	flowStoreAdd(&conversations[((u_int64_t)l.cli_ip[i] << 32) | l.srv_ip[i]], bytes, packets);
+	break;
+      default:
+	flowStoreAdd(&aggr->total, bytes, packets);
+	break;
+      }
+    }
+  }
+
+  /* Chunk-local dictionary indexes to addresses */
+  if(hosts) {
+    for(u_int32_t i = 0; i < h->num_ips; i++) {
+      if(hosts[i].flows > 0) {
+	FlowStoreResult *r = &aggr->keys[std::string((const char*)&l.dict[i * 16], 16)];
+
+	if(r->flows == 0) memcpy(r->ip[0], &l.dict[i * 16], 16);
+	flowStoreMerge(r, &hosts[i]);
+      }
+    }
+
+    free(hosts);
+  }
+
+  for(std::map<u_int64_t, FlowStoreResult>::iterator it = conversations.begin(); it != conversations.end(); ++it) {
+    const u_int8_t *cli = &l.dict[(it->first >> 32) * 16], *srv = &l.dict[(it->first & 0xFFFFFFFF) * 16];
+    std::string key = std::string((const char*)cli, 16) + std::string((const char*)srv, 16);
+    FlowStoreResult *r = &aggr->keys[key];
+
+    if(r->flows == 0) memcpy(r->ip[0], cli, 16), memcpy(r->ip[1], srv, 16);
+    flowStoreMerge(r, &it->second);
+  }
+
+  return;
+
+ skip:
+  stats->chunks_skipped++;
+}
+
+/* **************************************************** */
+
+void ColumnarFlowDB::queryPartition(const char *path, const FlowStoreQuery *q, FlowStoreQueryStats *stats,
+				    FlowStoreAggregation *aggr) {
+  struct stat st;
+  u_char *map;
+  u_int64_t off = 0;
+  int fd;
+
+  if((fd = open(path, O_RDONLY)) < 0)
+    return; /* Deleted in the meantime */
+
+  if((fstat(fd, &st) != 0) || (st.st_size == 0)
+     || ((map = (u_char*)mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0)) == MAP_FAILED)) {
+    close(fd);
+    return;
+  }
+
+  close(fd);
+  stats->partitions++;
+
+  while((off + sizeof(flow_store_chunk_header_t)) <= (u_int64_t)st.st_size) {
+    const flow_store_chunk_header_t *h = (const flow_store_chunk_header_t*)&map[off];
+    flow_store_chunk_layout_t l;
+
+    /* The last chunk may still be being written */
+    if((h->magic != FLOW_STORE_CHUNK_MAGIC) || (h->version != FLOW_STORE_VERSION)
+       || ((off + h->chunk_len) > (u_int64_t)st.st_size)
+       || (chunkLayout(NULL, h, &l) != h->chunk_len))
+      break;
+
+    queryChunk(&map[off], q, stats, aggr);
+    off += h->chunk_len;
+  }
+
+  munmap(map, st.st_size);
+}
+
+/* **************************************************** */
+
+/* Descending order on the sort key of a query */
+class FlowStoreResultCmp {
+ private:
+  FlowStoreSort sort;
+
+ public:
+  FlowStoreResultCmp(FlowStoreSort _sort) { sort = _sort; };
+
+  inline bool operator()(const FlowStoreResult &a, const FlowStoreResult &b) const {
+    switch(sort) {
+    case flow_store_sort_packets: return(a.packets > b.packets);
+    case flow_store_sort_flows:   return(a.flows > b.flows);
+    default:                      return(a.bytes > b.bytes);
+    }
+  }
+};
+
+/* **************************************************** */
+
+bool ColumnarFlowDB::query(const FlowStoreQuery *q, std::vector<FlowStoreResult> *results, FlowStoreQueryStats *stats) {
+  std::vector<u_int32_t> partitions;
+  FlowStoreAggregation aggr;
+  struct dirent *entry;
+  u_int32_t limit = q->limit ? min_val(q->limit, FLOW_STORE_MAX_RESULTS) : FLOW_STORE_MAX_RESULTS;
+  bool by_value = (q->group_by == flow_store_group_port) || (q->group_by == flow_store_group_src_port)
+    || (q->group_by == flow_store_group_dst_port) || (q->group_by == flow_store_group_l7_proto);
+  DIR *d;
+
+  memset(stats, 0, sizeof(*stats));
+  memset(&aggr.total, 0, sizeof(aggr.total));
+  aggr.values = NULL;
+
+  if(by_value && ((aggr.values = (FlowStoreResult*)calloc(65536, sizeof(FlowStoreResult))) == NULL))
+    return(false);
+
+  /* Partitions holding flows that may overlap [begin, end] */
+  if((d = opendir(dir)) != NULL) {
+    while((entry = readdir(d)) != NULL) {
+      char ext[8];
+      u_int32_t p;
+
+      if((sscanf(entry->d_name, "%u.%7s", &p, ext) == 2) && !strcmp(ext, "cfs")
+	 && ((time_t)(p + FLOW_STORE_PARTITION_SECS) > q->begin)
+	 && ((time_t)p <= (q->end + FLOW_STORE_PARTITION_SECS)))
+	partitions.push_back(p);
+    }
+
+    closedir(d);
+  }
+
+  std::sort(partitions.begin(), partitions.end());
+
+  for(std::vector<u_int32_t>::iterator it = partitions.begin(); it != partitions.end(); ++it) {
+    char path[MAX_PATH];
+
+    snprintf(path, sizeof(path), "%s/%u.cfs", dir, *it);
+    queryPartition(path, q, stats, &aggr);
+  }
+
+  /* Top-N */
+  results->clear();
+
+  if(by_value) {
+    for(u_int32_t v = 0; v < 65536; v++)
+      if(aggr.values[v].flows > 0)
+	aggr.values[v].value = v, results->push_back(aggr.values[v]);
+
+    free(aggr.values);
+  } else if(q->group_by == flow_store_group_none) {
+    if(aggr.total.flows > 0)
+      results->push_back(aggr.total);
+  } else {
+    for(std::map<std::string, FlowStoreResult>::iterator it = aggr.keys.begin(); it != aggr.keys.end(); ++it)
+      results->push_back(it->second);
+  }
+
+  if(q->offset >= results->size())
+    results->clear();
+  else {
+    u_int32_t num = min_val((u_int32_t)results->size(), q->offset + limit);
+
+    std::partial_sort(results->begin(), results->begin() + num, results->end(), FlowStoreResultCmp(q->sort));
+    results->resize(num);
+    results->erase(results->begin(), results->begin() + q->offset);
+  }
+
+  return(true);
+}
+
+/* **************************************************** */
+
+void ColumnarFlowDB::luaQuery(lua_State *vm, const FlowStoreQuery *q) {
+  std::vector<FlowStoreResult> results;
+  FlowStoreQueryStats stats;
+  char buf[64];
+  int i = 1;
+
+  if(!query(q, &results, &stats)) {
+    lua_pushnil(vm);
+    return;
+  }
+
+  lua_newtable(vm);
+  lua_newtable(vm);
+
+  for(std::vector<FlowStoreResult>::iterator it = results.begin(); it != results.end(); ++it, i++) {
+    IpAddress ip;
+
+    lua_newtable(vm);
+
+    switch(q->group_by) {
+    case flow_store_group_host:
+    case flow_store_group_src_host:
+    case flow_store_group_dst_host:
+      getIP(it->ip[0], &ip);
+      lua_push_str_table_entry(vm, "host", ip.print(buf, sizeof(buf)));
+      break;
+    case flow_store_group_port:
+    case flow_store_group_src_port:
+    case flow_store_group_dst_port:
+      lua_push_uint64_table_entry(vm, "port", it->value);
+      break;
+    case flow_store_group_l7_proto:
+      lua_push_uint64_table_entry(vm, "l7_proto", it->value);
+      lua_push_str_table_entry(vm, "l7_proto_name", iface->get_ndpi_proto_name(it->value));
+      break;
+    case flow_store_group_conversations:
+      getIP(it->ip[0], &ip);
+      lua_push_str_table_entry(vm, "cli_host", ip.print(buf, sizeof(buf)));
+      getIP(it->ip[1], &ip);
+      lua_push_str_table_entry(vm, "srv_host", ip.print(buf, sizeof(buf)));
+      break;
+    default:
+      break;
+    }
+
+    lua_push_uint64_table_entry(vm, "bytes", it->bytes);
+    lua_push_uint64_table_entry(vm, "packets", it->packets);
+    lua_push_uint64_table_entry(vm, "flows", it->flows);
+
+    lua_rawseti(vm, -2, i);
+  }
+
+  lua_pushstring(vm, "results");
+  lua_insert(vm, -2);
+  lua_settable(vm, -3);
+
+  lua_newtable(vm);
+  lua_push_uint64_table_entry(vm, "partitions", stats.partitions);
+  lua_push_uint64_table_entry(vm, "chunks", stats.chunks);
+  lua_push_uint64_table_entry(vm, "chunks_skipped", stats.chunks_skipped);
+  lua_push_uint64_table_entry(vm, "rows_scanned", stats.rows_scanned);
+  lua_push_uint64_table_entry(vm, "rows_matched", stats.rows_matched);
+  lua_pushstring(vm, "stats");
+  lua_insert(vm, -2);
+  lua_settable(vm, -3);
+}
@@ -0,0 +1,217 @@
+/*
+ *
+ * (C) 2019 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+
+#include "ntop_includes.h"
+
+/* **************************************** */
+
+CompiledAddressTree::CompiledAddressTree() {
+  memset(&v4, 0, sizeof(v4)), memset(&v6, 0, sizeof(v6));
+  v4.max_levels = (32 - LPM_ROOT_BITS) / LPM_CHUNK_BITS;
+  v6.max_levels = (128 - LPM_ROOT_BITS) / LPM_CHUNK_BITS;
+}
+
+/* **************************************** */
+
+CompiledAddressTree::~CompiledAddressTree() {
+  freeTable(&v4), freeTable(&v6);
+}
+
+/* **************************************** */
+
+void CompiledAddressTree::freeTable(LpmTable *t) {
+  if(t->root)   free(t->root);
+  if(t->chunks) free(t->chunks);
+  t->root = t->chunks = NULL, t->num_chunks = t->max_chunks = 0;
+}
+
+/* **************************************** */
+
+void CompiledAddressTree::collectPrefixes(patricia_node_t *node, std::vector<LpmPrefix> *prefixes) {
+  if(node == NULL) return;
+
+  if(node->prefix) {
+    LpmPrefix p;
+
+    memset(&p, 0, sizeof(p));
+
+    if(node->prefix->family == AF_INET)
+      memcpy(p.addr, &node->prefix->add.sin, 4);
+    else
+      memcpy(p.addr, &node->prefix->add.sin6, 16);
+
+    p.bits = node->prefix->bitlen, p.value = (int16_t)node->user_data;
+    prefixes->push_back(p);
+  }
+
+  collectPrefixes(node->l, prefixes);
+  collectPrefixes(node->r, prefixes);
+}
+
+/* **************************************** */
+
+static bool lpm_prefix_shorter(const LpmPrefix &a, const LpmPrefix &b) {
+  return(a.bits < b.bits);
+}
+
+/* **************************************** */
+
+int32_t CompiledAddressTree::newChunk(LpmTable *t, u_int32_t fill) {
+  u_int32_t *slots;
+
+  if(t->num_chunks == t->max_chunks) {
+    u_int32_t new_max = t->max_chunks ? t->max_chunks * 2 : 64;
+    u_int32_t *new_chunks;
+
+    if((new_max > (LPM_SLOT_LEAF >> LPM_CHUNK_BITS))
+       || ((new_chunks = (u_int32_t*)realloc(t->chunks, (size_t)new_max * LPM_CHUNK_SIZE * sizeof(u_int32_t))) == NULL))
+      return(-1);
+
+    t->chunks = new_chunks, t->max_chunks = new_max;
+  }
+
+  slots = &t->chunks[t->num_chunks << LPM_CHUNK_BITS];
+  for(int i = 0; i < LPM_CHUNK_SIZE; i++) slots[i] = fill;
+
+  return(t->num_chunks++);
+}
+
+/* **************************************** */
+
+/*
+  Prefixes must be inserted from the shortest to the longest: a longer
+  prefix only overwrites the slots expanded from shorter ones, and a
+  chunk inherits the slot value (i.e. the covering prefix) it replaces.
+*/
+bool CompiledAddressTree::insertPrefix(LpmTable *t, const LpmPrefix *p) {
+  u_int32_t leaf = LPM_SLOT_LEAF | ((u_int32_t)p->bits << 16) | (u_int16_t)p->value;
+  u_int32_t idx = (p->addr[0] << 8) | p->addr[1];
+  int remaining = p->bits - LPM_ROOT_BITS;
+
+  if(remaining <= 0) {
+    u_int32_t count = 1 << (-remaining);
+
+    idx &= ~(count - 1);
+    for(u_int32_t i = 0; i < count; i++) t->root[idx + i] = leaf;
+
+    return(true);
+  }
+
+  /* Slots are tracked by offset as chunks can be moved by realloc */
+  bool in_root = true;
+  u_int32_t offset = idx;
+
+  for(u_int8_t level = 0; level < t->max_levels; level++) {
+    u_int32_t *slot = in_root ? &t->root[offset] : &t->chunks[offset];
+    u_int32_t chunk, byte = p->addr[2 + level];
+
+    if(!(*slot & LPM_SLOT_CHILD)) {
+      int32_t new_chunk = newChunk(t, *slot);
+
+      if(new_chunk < 0) return(false);
+
+      slot = in_root ? &t->root[offset] : &t->chunks[offset];
+      *slot = LPM_SLOT_CHILD | new_chunk;
+    }
+
+    chunk = *slot & ~LPM_SLOT_CHILD;
+
+    if(remaining <= LPM_CHUNK_BITS) {
+      u_int32_t count = 1 << (LPM_CHUNK_BITS - remaining);
+      u_int32_t *slots = &t->chunks[chunk << LPM_CHUNK_BITS];
+
+      byte &= ~(count - 1);
+      for(u_int32_t i = 0; i < count; i++) slots[byte + i] = leaf;
+
+      return(true);
+    }
+
+    in_root = false, offset = (chunk << LPM_CHUNK_BITS) + byte;
+    remaining -= LPM_CHUNK_BITS;
+  }
+
+  return(false);
+}
+
+/* **************************************** */
+
+bool CompiledAddressTree::buildTable(LpmTable *t, u_int8_t max_bits, patricia_tree_t *ptree) {
+  std::vector<LpmPrefix> prefixes;
+
+  freeTable(t);
+
+  if(!ptree || !ptree->head)
+    return(true); /* Nothing to match: lookups fail without touching memory */
+
+  collectPrefixes(ptree->head, &prefixes);
+
+  if(prefixes.empty())
+    return(true);
+
+  if((t->root = (u_int32_t*)calloc(1 << LPM_ROOT_BITS, sizeof(u_int32_t))) == NULL)
+    return(false);
+
+  std::stable_sort(prefixes.begin(), prefixes.end(), lpm_prefix_shorter);
+
+  for(std::vector<LpmPrefix>::const_iterator it = prefixes.begin(); it != prefixes.end(); ++it) {
+    if(it->bits > max_bits) continue;
+
+    if(!insertPrefix(t, &(*it))) {
+      freeTable(t);
+      return(false);
+    }
+  }
+
+  if(t->num_chunks < t->max_chunks) {
+    /* The table is read-only from now on: release the unused chunks */
+    u_int32_t *shrunk = (u_int32_t*)realloc(t->chunks, (size_t)t->num_chunks * LPM_CHUNK_SIZE * sizeof(u_int32_t));
+
+    if(shrunk || (t->num_chunks == 0))
+      t->chunks = shrunk, t->max_chunks = t->num_chunks;
+  }
+
+  return(true);
+}
+
+/* **************************************** */
+
+bool CompiledAddressTree::compile(patricia_tree_t *ptree_v4, patricia_tree_t *ptree_v6) {
+  if(!buildTable(&v4, 32, ptree_v4) || !buildTable(&v6, 128, ptree_v6)) {
+    ntop->getTrace()->traceEvent(TRACE_WARNING, "Not enough memory to compile the address tree");
+    freeTable(&v4), freeTable(&v6);
+    return(false);
+  }
+
+  return(true);
+}
+
+/* **************************************** */
+
+u_int64_t CompiledAddressTree::getMemoryUsage() const {
+  u_int64_t mem = 0;
+
+  if(v4.root) mem += (1 << LPM_ROOT_BITS) * sizeof(u_int32_t);
+  if(v6.root) mem += (1 << LPM_ROOT_BITS) * sizeof(u_int32_t);
+  mem += ((u_int64_t)v4.max_chunks + v6.max_chunks) * LPM_CHUNK_SIZE * sizeof(u_int32_t);
+
+  return(mem);
+}
@@ -0,0 +1,251 @@
+/*
+ *
+ * (C) 2019 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+
+#include "ntop_includes.h"
+
+/* **************************************** */
+
+DnsCache::DnsCache(u_int32_t _max_num_entries) {
+  max_num_entries = _max_num_entries ? _max_num_entries : 1;
+
+  for(num_buckets = 1; num_buckets < max_num_entries; num_buckets <<= 1)
+    ;
+
+  if((buckets = (struct dns_cache_entry**)calloc(num_buckets, sizeof(struct dns_cache_entry*))) == NULL)
+    throw 2;
+
+  lru_head = lru_tail = NULL;
+  num_entries = 0;
+  num_hits = num_negative_hits = num_misses = num_pending_hits = num_evictions = 0;
+}
+
+/* **************************************** */
+
+DnsCache::~DnsCache() {
+  struct dns_cache_entry *e = lru_head;
+
+  while(e) {
+    struct dns_cache_entry *next = e->lru_next;
+
+    if(e->value) free(e->value);
+    free(e);
+    e = next;
+  }
+
+  free(buckets);
+}
+
+/* **************************************** */
+
+/* NOTE: all the private methods must be called with the lock held */
+struct dns_cache_entry* DnsCache::find(const char *key, u_int32_t hash) {
+  struct dns_cache_entry *e = buckets[hash & (num_buckets - 1)];
+
+  while(e) {
+    if((e->hash == hash) && (!strcmp(e->key, key)))
+      return(e);
+
+    e = e->hash_next;
+  }
+
+  return(NULL);
+}
+
+/* **************************************** */
+
+void DnsCache::unlink(struct dns_cache_entry *e) {
+  if(e->lru_prev) e->lru_prev->lru_next = e->lru_next; else lru_head = e->lru_next;
+  if(e->lru_next) e->lru_next->lru_prev = e->lru_prev; else lru_tail = e->lru_prev;
+  e->lru_prev = e->lru_next = NULL;
+}
+
+/* **************************************** */
+
+void DnsCache::touch(struct dns_cache_entry *e) {
+  if(e == lru_head) return;
+
+  unlink(e);
+  e->lru_next = lru_head;
+  if(lru_head) lru_head->lru_prev = e;
+  lru_head = e;
+  if(!lru_tail) lru_tail = e;
+}
+
+/* **************************************** */
+
+void DnsCache::remove(struct dns_cache_entry *e) {
+  struct dns_cache_entry **prev = &buckets[e->hash & (num_buckets - 1)];
+
+  while(*prev && (*prev != e))
+    prev = &(*prev)->hash_next;
+
+  if(*prev) *prev = e->hash_next;
+
+  unlink(e);
+  if(e->value) free(e->value);
+  free(e);
+  num_entries--;
+}
+
+/* **************************************** */
+
+struct dns_cache_entry* DnsCache::insert(const char *key, u_int32_t hash) {
+  struct dns_cache_entry *e;
+  u_int32_t idx = hash & (num_buckets - 1);
+
+  if((num_entries >= max_num_entries) && lru_tail) {
+    remove(lru_tail);
+    num_evictions++;
+  }
+
+  if((e = (struct dns_cache_entry*)calloc(1, sizeof(struct dns_cache_entry))) == NULL)
+    return(NULL);
+
+  snprintf(e->key, sizeof(e->key), "%s", key);
+  e->hash = hash;
+  e->hash_next = buckets[idx], buckets[idx] = e;
+  touch(e);
+  num_entries++;
+
+  return(e);
+}
+
+/* **************************************** */
+
+DnsCacheLookup DnsCache::lookup(const char *key, char *rsp, u_int rsp_len, time_t now, bool reserve) {
+  u_int32_t hash = KeyedHash::hashBytes(key, strlen(key));
+  struct dns_cache_entry *e;
+  DnsCacheLookup rc;
+
+  if(rsp && (rsp_len > 0)) rsp[0] = '\0';
+
+  m.lock(__FILE__, __LINE__);
+
+  if((e = find(key, hash)) != NULL) {
+    if(e->expire && (e->expire <= now)) {
+      /* Expired: the entry is reused for the new reservation, if any */
+      if(e->value) free(e->value), e->value = NULL;
+      e->negative = false;
+
+      if(!reserve) {
+	remove(e);
+	e = NULL;
+      }
+    } else if(e->value == NULL) {
+      num_pending_hits++;
+      m.unlock(__FILE__, __LINE__);
+      return(dns_cache_pending);
+    } else {
+      if(rsp && (rsp_len > 0)) snprintf(rsp, rsp_len, "%s", e->value);
+      touch(e);
+
+      if(e->negative)
+	num_negative_hits++, rc = dns_cache_negative_hit;
+      else
+	num_hits++, rc = dns_cache_hit;
+
+      m.unlock(__FILE__, __LINE__);
+      return(rc);
+    }
+  }
+
+  num_misses++;
+
+  if(reserve) {
+    if((e == NULL) && (strlen(key) < DNS_CACHE_MAX_KEY_LEN))
+      e = insert(key, hash);
+
+    if(e) {
+      e->expire = now + DNS_PENDING_DURATION;
+      touch(e);
+    }
+  }
+
+  m.unlock(__FILE__, __LINE__);
+
+  return(dns_cache_miss);
+}
+
+/* **************************************** */
+
+void DnsCache::set(const char *key, const char *value, u_int32_t ttl, bool negative, time_t now) {
+  u_int32_t hash;
+  struct dns_cache_entry *e;
+  char *v;
+
+  if((strlen(key) >= DNS_CACHE_MAX_KEY_LEN) || ((v = strdup(value)) == NULL))
+    return;
+
+  hash = KeyedHash::hashBytes(key, strlen(key));
+
+  m.lock(__FILE__, __LINE__);
+
+  if(((e = find(key, hash)) != NULL) || ((e = insert(key, hash)) != NULL)) {
+    if(e->value) free(e->value);
+    e->value = v, e->negative = negative;
+    e->expire = ttl ? (now + ttl) : 0;
+    touch(e);
+  } else
+    free(v);
+
+  m.unlock(__FILE__, __LINE__);
+}
+
+/* **************************************** */
+
+void DnsCache::release(const char *key) {
+  u_int32_t hash = KeyedHash::hashBytes(key, strlen(key));
+  struct dns_cache_entry *e;
+
+  m.lock(__FILE__, __LINE__);
+
+  if(((e = find(key, hash)) != NULL) && (e->value == NULL))
+    remove(e);
+
+  m.unlock(__FILE__, __LINE__);
+}
+
+/* **************************************** */
+
+void DnsCache::del(const char *key) {
+  u_int32_t hash = KeyedHash::hashBytes(key, strlen(key));
+  struct dns_cache_entry *e;
+
+  m.lock(__FILE__, __LINE__);
+
+  if((e = find(key, hash)) != NULL)
+    remove(e);
+
+  m.unlock(__FILE__, __LINE__);
+}
+
+/* **************************************** */
+
+void DnsCache::lua(lua_State *vm) {
+  lua_push_uint64_table_entry(vm, "cache.num_entries", num_entries);
+  lua_push_uint64_table_entry(vm, "cache.max_num_entries", max_num_entries);
+  lua_push_uint64_table_entry(vm, "cache.hits", num_hits);
+  lua_push_uint64_table_entry(vm, "cache.negative_hits", num_negative_hits);
+  lua_push_uint64_table_entry(vm, "cache.misses", num_misses);
+  lua_push_uint64_table_entry(vm, "cache.pending_hits", num_pending_hits);
+  lua_push_uint64_table_entry(vm, "cache.evictions", num_evictions);
+}
@@ -53,7 +53,8 @@ Flow::Flow(NetworkInterface *_iface,
   json_info = strdup("{}"), cli2srv_direction = true, twh_over = twh_ok = false,
     dissect_next_http_packet = false,
     check_tor = false, host_server_name = NULL, diff_num_http_requests = 0,
-    bt_hash = NULL, community_id_flow_hash = NULL;
+    bt_hash = NULL, community_id_flow_hash = NULL, index_links = NULL;
+  flow_status = status_normal, flow_status_map = 0, flow_status_dirty = false;
 
   src2dst_tcp_flags = 0, dst2src_tcp_flags = 0, last_update_time.tv_sec = 0, last_update_time.tv_usec = 0,
     bytes_thpt = 0, goodput_bytes_thpt = 0, top_bytes_thpt = 0, top_pkts_thpt = 0;
@@ -172,6 +173,8 @@ void Flow::freeDPIMemory() {
 /* *************************************** */
 
 Flow::~Flow() {
+  if(index_links) iface->getFlowIndex()->remove(this); /* Before the peers are released */
+
   if(cli_host) cli_host->decNumFlows(true, srv_host),  cli_host->decUses();
   if(srv_host) srv_host->decNumFlows(false, cli_host), srv_host->decUses();
 
@@ -324,7 +327,8 @@ void Flow::dumpFlowAlert() {
       do_dump = false;
 
     if(do_dump) {
-      iface->getAlertsManager()->storeFlowAlert(this);
+      /* The alert is written asynchronously, by the flow alerts writer */
+      iface->getAlertsManager()->enqueueFlowAlert(this);
     }
   }
 }
@@ -417,7 +421,7 @@ void Flow::processDetectedProtocol() {
 
 	      if(at != NULL) {
 		// ntop->getTrace()->traceEvent(TRACE_NORMAL, "[DNS] %s <-> %s", name, (char*)ndpiFlow->host_server_name);
-		ntop->getRedis()->setResolvedAddress(name, (char*)ndpiFlow->host_server_name);
+		ntop->getAddressResolution()->setResolvedAddress(name, (char*)ndpiFlow->host_server_name);
 	      }
 	    }
 	  }
@@ -465,13 +469,13 @@ void Flow::processDetectedProtocol() {
     if(check_tor) {
       char rsp[256];
 
-      if(ntop->getRedis()->getAddress(protos.ssl.certificate, rsp, sizeof(rsp), false) == 0) {
+      if(ntop->getAddressResolution()->getAddress(protos.ssl.certificate, rsp, sizeof(rsp), false) == 0) {
 	if(rsp[0] == '\0') /* Cached failed resolution */
 	  ndpiDetectedProtocol.app_protocol = NDPI_PROTOCOL_TOR;
 
 	check_tor = false; /* This is a valid host */
       } else {
-	ntop->getRedis()->pushHostToResolve(protos.ssl.certificate, false, true /* Fake to resolve it ASAP */);
+	ntop->getAddressResolution()->queueHostToResolve(protos.ssl.certificate, true /* Resolve it ASAP */);
       }
     }
 
@@ -573,6 +577,17 @@ void Flow::setDetectedProtocol(ndpi_protocol proto_id, bool forceDetection) {
 #endif
   }
 
+  if(isIndexedProtocolChanged())
+    iface->getFlowIndex()->updateL7(this);
+
+  /*
+    e.g. the mining category is only known now. The status is not
+    computed here, on the packet path, as the periodic update also
+    writes it: housekeep() or update_hosts_stats() will do it
+  */
+  if(detection_completed)
+    flow_status_dirty = true;
+
 #ifdef NTOPNG_PRO
   // Update the profile even if the detection is not yet completed.
   // Indeed, even if the L7 detection is not yet completed
@@ -812,10 +827,8 @@ bool Flow::dumpFlow(bool dump_alert) {
   bool rc = false;
   time_t now;
 
-  if(dump_alert) {
-    /* NOTE: this can be very time consuming */
+  if(dump_alert)
     dumpFlowAlert();
-  }
 
   if(((cli2srv_packets - last_db_dump.cli2srv_packets) == 0)
      && ((srv2cli_packets - last_db_dump.srv2cli_packets) == 0))
@@ -824,6 +837,7 @@ bool Flow::dumpFlow(bool dump_alert) {
   if(ntop->getPrefs()->do_dump_flows_on_mysql()
      || ntop->getPrefs()->do_dump_flows_on_es()
      || ntop->getPrefs()->do_dump_flows_on_ls()
+     || ntop->getPrefs()->do_dump_flows_on_columnar()
 #if defined(HAVE_NINDEX) && defined(NTOPNG_PRO)
      || ntop->getPrefs()->do_dump_flows_on_nindex()
 #endif
@@ -883,6 +897,8 @@ bool Flow::dumpFlow(bool dump_alert) {
     else if(ntop->getPrefs()->do_dump_flows_on_nindex())
       getInterface()->dumpnIndexFlow(last_seen, this);
 #endif
+    else if(ntop->getPrefs()->do_dump_flows_on_columnar())
+      getInterface()->dumpColumnarFlow(last_seen, this);
 
 #ifndef HAVE_NEDGE
     if(ntop->get_export_interface()) {
@@ -968,7 +984,7 @@ void Flow::update_hosts_stats(struct timeval *tv, bool dump_alert) {
   if(check_tor && (ndpiDetectedProtocol.app_protocol == NDPI_PROTOCOL_SSL)) {
     char rsp[256];
 
-    if(ntop->getRedis()->getAddress(protos.ssl.certificate, rsp, sizeof(rsp), false) == 0) {
+    if(ntop->getAddressResolution()->getAddress(protos.ssl.certificate, rsp, sizeof(rsp), false) == 0) {
       if(rsp[0] == '\0') /* Cached failed resolution */
 	ndpiDetectedProtocol.app_protocol = NDPI_PROTOCOL_TOR;
 
@@ -1322,6 +1338,9 @@ void Flow::update_hosts_stats(struct timeval *tv, bool dump_alert) {
   if(updated)
     memcpy(&last_update_time, tv, sizeof(struct timeval));
 
+  /* Once per housekeeping update: readers (e.g. the alerted flows filter) only read it */
+  updateFlowStatus();
+
   if(dumpFlow(dump_alert)) {
     last_db_dump.cli2srv_packets = cli2srv_packets,
       last_db_dump.srv2cli_packets = srv2cli_packets,
@@ -1840,6 +1859,7 @@ void Flow::lua(lua_State* vm, AddressTree * ptree,
 
   lua_push_bool_table_entry(vm, "flow.idle", idle());
   lua_push_uint64_table_entry(vm, "flow.status", getFlowStatus());
+  lua_push_uint64_table_entry(vm, "flow.status_map", getFlowStatusMap());
 
   // this is used to dynamicall update entries in the GUI
   lua_push_uint64_table_entry(vm, "ntopng.key", key()); // Key
@@ -1847,27 +1867,88 @@ void Flow::lua(lua_State* vm, AddressTree * ptree,
 
 /* *************************************** */
 
-u_int32_t Flow::key() {
-  u_int32_t k = cli_port+srv_port /* +vlanId */ +protocol;
+/*
+  Serializes the flow as a JSON object row, using the same key names
+  of Flow::lua() so that REST clients can share the field mappings.
+*/
+void Flow::writeJSON(JSONStream *s, DetailsLevel details_level) {
+  char buf[64];
+  Host *src = get_cli_host(), *dst = get_srv_host();
+
+  if(!isJSONWritable()) return; /* The listings skip these flows */
+
+  s->beginObject();
+
+  s->addString("cli.ip", src->get_ip()->printMask(buf, sizeof(buf), src->isLocalHost()));
+  s->addUint64("cli.port", get_cli_port());
+  s->addString("srv.ip", dst->get_ip()->printMask(buf, sizeof(buf), dst->isLocalHost()));
+  s->addUint64("srv.port", get_srv_port());
+  s->addUint64("vlan", get_vlan_id());
+  s->addString("proto.l4", get_protocol_name());
+
+  if(((cli2srv_packets+srv2cli_packets) > NDPI_MIN_NUM_PACKETS)
+     || (ndpiDetectedProtocol.app_protocol != NDPI_PROTOCOL_UNKNOWN)
+     || iface->is_ndpi_enabled()
+     || iface->isSampledTraffic()
+     || iface->is_sprobe_interface()
+     || (iface->getIfType() == interface_type_ZMQ)
+     || (iface->getIfType() == interface_type_ZC_FLOW))
+    s->addString("proto.ndpi", get_detected_protocol_name(buf, sizeof(buf)));
+  else
+    s->addString("proto.ndpi", CONST_TOO_EARLY);
+
+  s->addUint64("proto.ndpi_id", ndpiDetectedProtocol.app_protocol);
+  s->addString("proto.ndpi_cat", get_protocol_category_name());
+  s->addUint64("seen.first", get_first_seen());
+  s->addUint64("seen.last", get_last_seen());
+  s->addUint64("duration", get_duration());
+  s->addUint64("bytes", get_bytes());
+  s->addUint64("cli2srv.bytes", get_bytes_cli2srv());
+  s->addUint64("srv2cli.bytes", get_bytes_srv2cli());
+  s->addUint64("cli2srv.packets", get_packets_cli2srv());
+  s->addUint64("srv2cli.packets", get_packets_srv2cli());
+  s->addFloat("throughput_bps", bytes_thpt);
+  s->addUint64("ntopng.key", key());
+  s->addBool("flow.alerted", isFlowAlerted());
+
+  if(details_level >= details_high) {
+    if(!Utils::maskHost(src->isLocalHost()))
+      s->addString("cli.host", src->get_visual_name(buf, sizeof(buf)));
+    if(!Utils::maskHost(dst->isLocalHost()))
+      s->addString("srv.host", dst->get_visual_name(buf, sizeof(buf)));
+
+    s->addBool("cli.localhost", src->isLocalHost());
+    s->addBool("srv.localhost", dst->isLocalHost());
+    s->addUint64("tcp_flags", getTcpFlags());
+    s->addUint64("flow.status", getFlowStatus());
+    s->addUint64("flow.status_map", getFlowStatusMap());
+
+    if(!isMaskedFlow())
+      s->addString("info", getFlowInfo());
+  }
 
-  if(cli_host) k += cli_host->key();
-  if(srv_host) k += srv_host->key();
+  s->endObject();
+}
+
+/* *************************************** */
 
-  return(k);
+/*
+  The flow key is also its hash bucket selector (see FlowHash::find and
+  GenericHash::findByKey) so it must not depend on the flow direction.
+  The VLAN is not part of the key (see FlowHash::find).
+*/
+u_int32_t Flow::key() {
+  return(key(cli_host, cli_port, srv_host, srv_port, protocol));
 }
 
 /* *************************************** */
 
 u_int32_t Flow::key(Host *_cli, u_int16_t _cli_port,
 		    Host *_srv, u_int16_t _srv_port,
-		    u_int16_t _vlan_id,
 		    u_int16_t _protocol) {
-  u_int32_t k = _cli_port + _srv_port + _vlan_id + _protocol;
-
-  if(_cli) k += _cli -> key();
-  if(_srv) k += _srv -> key();
-
-  return(k);
+  return(KeyedHash::hashFlow(_cli ? _cli->get_ip()->hash() : 0, _cli_port,
+			     _srv ? _srv->get_ip()->hash() : 0, _srv_port,
+			     (u_int8_t)_protocol));
 }
 
 /* *************************************** */
@@ -1972,22 +2053,35 @@ char* Flow::serialize(bool es_json) {
 /* *************************************** */
 
 /* Returns a stripped-down JSON specifically used for providing more alert information */
-json_object* Flow::flow2statusinfojson() {
+void Flow::getStatusInfo(FlowStatusInfo *info) {
+  DeviceProtoStatus proto_status = device_proto_allowed;
+
+  info->cli_devtype = (cli_host && cli_host->getMac()) ? cli_host->getMac()->getDeviceType() : device_unknown;
+  info->srv_devtype = (srv_host && srv_host->getMac()) ? srv_host->getMac()->getDeviceType() : device_unknown;
+  info->devproto_forbidden_peer[0] = '\0', info->devproto_forbidden_id = 0;
+
+  if(cli_host && ((proto_status = cli_host->getDeviceAllowedProtocolStatus(ndpiDetectedProtocol, true /* client */)) != device_proto_allowed))
+    strcpy(info->devproto_forbidden_peer, "cli");
+  else if(srv_host && ((proto_status = srv_host->getDeviceAllowedProtocolStatus(ndpiDetectedProtocol, false /* server */)) != device_proto_allowed))
+    strcpy(info->devproto_forbidden_peer, "srv");
+
+  if(info->devproto_forbidden_peer[0])
+    info->devproto_forbidden_id = (proto_status == device_proto_forbidden_app) ?
+      ndpiDetectedProtocol.app_protocol : ndpiDetectedProtocol.master_protocol;
+}
+
+/* *************************************** */
+
+json_object* Flow::statusInfo2json(const FlowStatusInfo *info) {
   json_object *obj = json_object_new_object();
   if(!obj) return NULL;
-  DeviceProtoStatus proto_status = device_proto_allowed;
 
-  json_object_object_add(obj, "cli.devtype", json_object_new_int((cli_host && cli_host->getMac()) ? cli_host->getMac()->getDeviceType() : device_unknown));
-  json_object_object_add(obj, "srv.devtype", json_object_new_int((srv_host && srv_host->getMac()) ? srv_host->getMac()->getDeviceType() : device_unknown));
-
-  if(cli_host && ((proto_status = cli_host->getDeviceAllowedProtocolStatus(ndpiDetectedProtocol, true /* client */)) != device_proto_allowed)) {
-    json_object_object_add(obj, "devproto_forbidden_peer", json_object_new_string("cli"));
-    json_object_object_add(obj, "devproto_forbidden_id", json_object_new_int(
-      (proto_status == device_proto_forbidden_app) ? ndpiDetectedProtocol.app_protocol : ndpiDetectedProtocol.master_protocol));
-  } else if(srv_host && ((proto_status = srv_host->getDeviceAllowedProtocolStatus(ndpiDetectedProtocol, false /* server */)) != device_proto_allowed)) {
-    json_object_object_add(obj, "devproto_forbidden_peer", json_object_new_string("srv"));
-    json_object_object_add(obj, "devproto_forbidden_id", json_object_new_int(
-      (proto_status == device_proto_forbidden_app) ? ndpiDetectedProtocol.app_protocol : ndpiDetectedProtocol.master_protocol));
+  json_object_object_add(obj, "cli.devtype", json_object_new_int(info->cli_devtype));
+  json_object_object_add(obj, "srv.devtype", json_object_new_int(info->srv_devtype));
+
+  if(info->devproto_forbidden_peer[0]) {
+    json_object_object_add(obj, "devproto_forbidden_peer", json_object_new_string(info->devproto_forbidden_peer));
+    json_object_object_add(obj, "devproto_forbidden_id", json_object_new_int(info->devproto_forbidden_id));
   }
 
   return obj;
@@ -1995,6 +2089,16 @@ json_object* Flow::flow2statusinfojson() {
 
 /* *************************************** */
 
+json_object* Flow::flow2statusinfojson() {
+  FlowStatusInfo info;
+
+  getStatusInfo(&info);
+
+  return(statusInfo2json(&info));
+}
+
+/* *************************************** */
+
 json_object* Flow::flow2json() {
   json_object *my_object;
   char buf[64], jsonbuf[64], *c;
@@ -2234,6 +2338,17 @@ bool Flow::isNetfilterIdleFlow() {
 /* *************************************** */
 
 void Flow::housekeep() {
+  /* The protocol may have been changed elsewhere (e.g. TOR, guessed protocols) */
+  if(isIndexedProtocolChanged())
+    iface->getFlowIndex()->updateL7(this);
+
+  /*
+    Idleness changes the status. Called with the bucket locked, so this
+    never races with update_hosts_stats()
+  */
+  if(flow_status_dirty || idle())
+    updateFlowStatus();
+
 #ifdef HAVE_NEDGE
   if(iface->getIfType() == interface_type_NETFILTER) {
     if(isNetfilterIdleFlow()) {
@@ -2764,8 +2879,8 @@ void Flow::dissectHTTP(bool src2dst_direction, char *payload, u_int16_t payload_
     char *space;
 
     // payload[10]=0; ntop->getTrace()->traceEvent(TRACE_WARNING, "[len: %u][%s]", payload_len, payload);
-    h = cli_host->getHTTPstats(); if(h) h->incRequestAsSender(payload); /* Sent */
-    h = srv_host->getHTTPstats(); if(h) h->incRequestAsReceiver(payload); /* Rcvd */
+    h = cli_host->getHTTPstats(true); if(h) h->incRequestAsSender(payload); /* Sent */
+    h = srv_host->getHTTPstats(true); if(h) h->incRequestAsReceiver(payload); /* Rcvd */
     dissect_next_http_packet = true;
 
     /* use memchr to prevent possibly non-NULL terminated HTTP requests */
@@ -2883,8 +2998,8 @@ void Flow::dissectHTTP(bool src2dst_direction, char *payload, u_int16_t payload_
       char *space;
 
       // payload[10]=0; ntop->getTrace()->traceEvent(TRACE_WARNING, "[len: %u][%s]", payload_len, payload);
-      h = cli_host->getHTTPstats(); if(h) h->incResponseAsReceiver(payload); /* Rcvd */
-      h = srv_host->getHTTPstats(); if(h) h->incResponseAsSender(payload); /* Sent */
+      h = cli_host->getHTTPstats(true); if(h) h->incResponseAsReceiver(payload); /* Rcvd */
+      h = srv_host->getHTTPstats(true); if(h) h->incResponseAsSender(payload); /* Sent */
       dissect_next_http_packet = false;
 
       if((space = (char*)memchr(payload, ' ', payload_len)) != NULL) {
@@ -3412,33 +3527,53 @@ FlowSSLEncryptionStatus Flow::getSSLEncryptionStatus() {
 
 /* ***************************************************** */
 
-FlowStatus Flow::getFlowStatus() {
+/* Adds a matching condition: the first one in evaluation order is the flow status */
+static inline void addFlowStatus(FlowStatus s, u_int32_t *status_map, FlowStatus *status, bool status_final) {
+  *status_map |= ((u_int32_t)1 << s);
+
+  if((*status == status_normal) && (!status_final))
+    *status = s;
+}
+
+/* ***************************************************** */
+
+/*
+  Evaluates all the conditions of the flow. The returned status is the
+  one getFlowStatus() always returned (the first matching condition
+  in the order below), whereas status_map has a bit for every
+  condition that matches, including those that the status hides.
+*/
+FlowStatus Flow::computeFlowStatus(u_int32_t *status_map) {
 #ifndef HAVE_NEDGE
   u_int32_t threshold;
 #endif
   u_int16_t l7proto = ndpi_get_lower_proto(ndpiDetectedProtocol);
+  FlowStatus status = status_normal;
+  bool status_final = false; /* The status can no longer change, conditions are still collected */
+
+  *status_map = 0;
 
   /* NOTE: evaluation order is important here! */
 
   if(isBlacklistedFlow())
-    return status_blacklisted;
+    addFlowStatus(status_blacklisted, status_map, &status, status_final);
 
   if(!isDeviceAllowedProtocol())
-    return status_device_protocol_not_allowed;
+    addFlowStatus(status_device_protocol_not_allowed, status_map, &status, status_final);
 
   //if(get_protocol_category() == CUSTOM_CATEGORY_MINING)
   if(ndpiDetectedProtocol.category == CUSTOM_CATEGORY_MINING)
-    return status_web_mining_detected;
+    addFlowStatus(status_web_mining_detected, status_map, &status, status_final);
 
 #ifndef HAVE_NEDGE
   /* All flows */
   threshold = cli2srv_packets / CONST_TCP_CHECK_ISSUES_RATIO;
   if((tcp_stats_s2d.pktRetr + tcp_stats_s2d.pktOOO + tcp_stats_s2d.pktLost) > threshold)
-    return status_tcp_connection_issues;
+    addFlowStatus(status_tcp_connection_issues, status_map, &status, status_final);
 
   threshold = srv2cli_packets / CONST_TCP_CHECK_ISSUES_RATIO;
   if((tcp_stats_d2s.pktRetr + tcp_stats_d2s.pktOOO + tcp_stats_d2s.pktLost) > threshold)
-    return status_tcp_connection_issues;
+    addFlowStatus(status_tcp_connection_issues, status_map, &status, status_final);
 #endif
 
   if(iface->getIfType() == interface_type_ZMQ) {
@@ -3453,13 +3588,13 @@ FlowStatus Flow::getFlowStatus() {
 
     if(protocol == IPPROTO_TCP) {
       if((srv2cli_packets == 0) && ((time(NULL)-last_seen) > CONST_ALERT_PROBING_TIME))
-	return status_suspicious_tcp_probing;
+	addFlowStatus(status_suspicious_tcp_probing, status_map, &status, status_final);
 
       if(!twh_over) {
 	if(isIdle)
-	  return status_suspicious_tcp_syn_probing;
-	else
-	  return status_normal;
+	  addFlowStatus(status_suspicious_tcp_syn_probing, status_map, &status, status_final);
+
+	status_final = true; /* Nothing else before the 3WH is over */
       } else {
 	/* 3WH is over */
 
@@ -3467,33 +3602,33 @@ FlowStatus Flow::getFlowStatus() {
 	case NDPI_PROTOCOL_SSL:
 #ifndef HAVE_NEDGE
 	  if(!protos.ssl.firstdata_seen && isIdle)
-	    return status_slow_application_header;
+	    addFlowStatus(status_slow_application_header, status_map, &status, status_final);
 #endif
 
 	  if(protos.ssl.certificate && protos.ssl.server_certificate) {
 	    if(protos.ssl.server_certificate[0] == '*') {
 	      if(!strstr(protos.ssl.certificate, &protos.ssl.server_certificate[1]))
-		return status_ssl_certificate_mismatch;
+		addFlowStatus(status_ssl_certificate_mismatch, status_map, &status, status_final);
 	    } else if(strcmp(protos.ssl.certificate, protos.ssl.server_certificate))
-	      return status_ssl_certificate_mismatch;
+	      addFlowStatus(status_ssl_certificate_mismatch, status_map, &status, status_final);
 	  }
 	  break;
 
 #ifndef HAVE_NEDGE
 	case NDPI_PROTOCOL_HTTP:
 	  if(/* !header_HTTP_completed &&*/isIdle)
-	    return status_slow_application_header;
+	    addFlowStatus(status_slow_application_header, status_map, &status, status_final);
 	  break;
 	}
 
-	if(isIdle  && lowGoodput)  return status_slow_data_exchange;
-	if(isIdle  && !lowGoodput) return status_slow_tcp_connection;
+	if(isIdle  && lowGoodput)  addFlowStatus(status_slow_data_exchange, status_map, &status, status_final);
+	if(isIdle  && !lowGoodput) addFlowStatus(status_slow_tcp_connection, status_map, &status, status_final);
 
 	if(!isIdle && lowGoodput) {
 	  if((src2dst_tcp_flags & TH_SYN) && (dst2src_tcp_flags & TH_RST))
-	    return status_tcp_connection_refused;
+	    addFlowStatus(status_tcp_connection_refused, status_map, &status, status_final);
 	  else
-	    return status_low_goodput;
+	    addFlowStatus(status_low_goodput, status_map, &status, status_final);
 	}
 #else
 	}
@@ -3505,7 +3640,7 @@ FlowStatus Flow::getFlowStatus() {
     switch(l7proto) {
     case NDPI_PROTOCOL_DNS:
       if(protos.dns.invalid_query)
-	return status_dns_invalid_query;
+	addFlowStatus(status_dns_invalid_query, status_map, &status, status_final);
     }
   }
 
@@ -3515,10 +3650,10 @@ FlowStatus Flow::getFlowStatus() {
 
     if(! cli_host->isLocalHost() && 
        ! srv_host->isLocalHost())
-      return status_remote_to_remote;
+      addFlowStatus(status_remote_to_remote, status_map, &status, status_final);
 
     if(get_duration() > ntop->getPrefs()->get_longlived_flow_duration())
-      return status_longlived;
+      addFlowStatus(status_longlived, status_map, &status, status_final);
   }
 
   if(cli_host && srv_host) {
@@ -3533,23 +3668,33 @@ FlowStatus Flow::getFlowStatus() {
     }
 
     if(local_to_remote_bytes > ntop->getPrefs()->get_elephant_flow_local_to_remote_bytes())
-      return status_elephant_local_to_remote;
+      addFlowStatus(status_elephant_local_to_remote, status_map, &status, status_final);
     if(remote_to_local_bytes > ntop->getPrefs()->get_elephant_flow_remote_to_local_bytes())
-      return status_elephant_remote_to_local;
+      addFlowStatus(status_elephant_remote_to_local, status_map, &status, status_final);
   }
 
 #ifdef HAVE_NEDGE
   /* Leave this at the end. A more specific status should be returned above if avaialble. */
   if(!isPassVerdict())
-    return status_blocked;
+    addFlowStatus(status_blocked, status_map, &status, status_final);
 #endif
 
 #if 0
   if(iface->getAlertLevel() > 0)
-   return(status_flow_when_interface_alerted);
+   addFlowStatus(status_flow_when_interface_alerted, status_map, &status, status_final);
 #endif
 
-  return status_normal;
+  return(status);
+}
+
+/* ***************************************************** */
+
+void Flow::updateFlowStatus() {
+  u_int32_t map;
+
+  flow_status_dirty = false;
+  flow_status = computeFlowStatus(&map);
+  flow_status_map = map;
 }
 
 /* ***************************************************** */
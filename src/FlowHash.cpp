@@ -30,34 +30,25 @@ FlowHash::FlowHash(NetworkInterface *_iface, u_int _num_hashes, u_int _max_hash_
 
 /* ************************************ */
 
-static u_int16_t max_num_loops = 0;
-
 Flow* FlowHash::find(IpAddress *src_ip, IpAddress *dst_ip,
 		     u_int16_t src_port, u_int16_t dst_port, 
 		     u_int16_t vlanId, u_int8_t protocol,
 		     bool *src2dst_direction) {
   // ntop->getTrace()->traceEvent(TRACE_NORMAL, "%u:%u / %u:%u", src_ip->key(), src_port, dst_ip->key(), dst_port);
 
-  /* Removed vlanId due to eBPF */
-  u_int32_t hash = ((src_ip->key()+dst_ip->key()+src_port+dst_port/* +vlanId */+protocol) % num_hashes);
+  /*
+    Removed vlanId due to eBPF. Must match Flow::key().
+    Chain lengths are reported by GenericHash::getChainStats()
+  */
+  u_int32_t hash = (KeyedHash::hashFlow(src_ip->hash(), src_port, dst_ip->hash(), dst_port, protocol) % num_hashes);
   Flow *head = (Flow*)table[hash];
-  u_int16_t num_loops = 0;
 
   while(head) {
     if((!head->idle() && !head->is_ready_to_be_purged())
-       && head->equal(src_ip, dst_ip, src_port, dst_port, vlanId, protocol, src2dst_direction)) {
-      if(num_loops > max_num_loops) {
-	ntop->getTrace()->traceEvent(TRACE_INFO, "DEBUG: [Num loops: %u][hashId: %u]", num_loops, hash);
-	max_num_loops = num_loops;
-      }
+       && head->equal(src_ip, dst_ip, src_port, dst_port, vlanId, protocol, src2dst_direction))
       return(head);
-    } else
-      head = (Flow*)head->next(), num_loops++;
-  }
-
-  if(num_loops > max_num_loops) {
-    ntop->getTrace()->traceEvent(TRACE_INFO, "DEBUG: [Num loops: %u][hashId: %u]", num_loops, hash);
-    max_num_loops = num_loops;
+    else
+      head = (Flow*)head->next();
   }
 
   return(NULL);
@@ -0,0 +1,317 @@
+/*
+ *
+ * (C) 2019 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+
+
+
+#include "ntop_includes.h"
+
+/* ************************************ */
+
+FlowIndex::FlowIndex(u_int32_t max_num_hosts) {
+  u_int32_t num_host_buckets = 4096;
+
+  /* As many buckets as the hosts hash */
+  while(num_host_buckets < (max_num_hosts / 4))
+    num_host_buckets <<= 1;
+
+  num_flows = 0, num_lookups = 0;
+  hosts.buckets[0] = hosts.buckets[1] = NULL;
+  l7protos.buckets[0] = l7protos.buckets[1] = NULL;
+  ports.buckets[0] = ports.buckets[1] = NULL;
+
+  if(!initTable(&hosts, num_host_buckets)
+     || !initTable(&l7protos, FLOW_INDEX_L7_BUCKETS)
+     || !initTable(&ports, FLOW_INDEX_PORT_BUCKETS)) {
+    freeTable(&hosts), freeTable(&l7protos), freeTable(&ports);
+    throw "Not enough memory";
+  }
+}
+
+/* ************************************ */
+
+FlowIndex::~FlowIndex() {
+  /* Flows (and their links) are deleted with the flows hash */
+  freeTable(&hosts), freeTable(&l7protos), freeTable(&ports);
+}
+
+/* ************************************ */
+
+bool FlowIndex::initTable(flow_index_table_t *t, u_int32_t num_buckets) {
+  t->mask = num_buckets - 1;
+  t->buckets[0] = (Flow**)calloc(num_buckets, sizeof(Flow*));
+  t->buckets[1] = (Flow**)calloc(num_buckets, sizeof(Flow*));
+
+  return((t->buckets[0] != NULL) && (t->buckets[1] != NULL));
+}
+
+/* ************************************ */
+
+/* Also called on partially initialized tables */
+void FlowIndex::freeTable(flow_index_table_t *t) {
+  for(u_int i = 0; i < 2; i++) {
+    if(t->buckets[i]) free(t->buckets[i]);
+    t->buckets[i] = NULL;
+  }
+}
+
+/* ************************************ */
+
+void FlowIndex::link(flow_index_table_t *t, u_int32_t key, Flow *f, FlowIndexLinks *l, FlowIndexLink which) {
+  u_int32_t bucket = key & t->mask;
+  Mutex *m = &t->locks[bucket & (FLOW_INDEX_NUM_LOCKS - 1)];
+  Flow **heads = t->buckets[chainOf(which)], *head;
+
+  m->lock(__FILE__, __LINE__);
+
+  head = heads[bucket];
+  l->links[which].prev = NULL, l->links[which].next = head;
+  if(head) head->getIndexLinks()->links[which].prev = f;
+  heads[bucket] = f;
+  l->linked |= (1 << which);
+
+  m->unlock(__FILE__, __LINE__);
+}
+
+/* ************************************ */
+
+void FlowIndex::unlink(flow_index_table_t *t, u_int32_t key, Flow *f, FlowIndexLinks *l, FlowIndexLink which) {
+  u_int32_t bucket = key & t->mask;
+  Mutex *m = &t->locks[bucket & (FLOW_INDEX_NUM_LOCKS - 1)];
+  flow_index_link_t *fl = &l->links[which];
+
+  if(!(l->linked & (1 << which)))
+    return;
+
+  m->lock(__FILE__, __LINE__);
+
+  if(fl->prev)
+    fl->prev->getIndexLinks()->links[which].next = fl->next;
+  else
+    t->buckets[chainOf(which)][bucket] = fl->next;
+
+  if(fl->next)
+    fl->next->getIndexLinks()->links[which].prev = fl->prev;
+
+  fl->prev = fl->next = NULL, l->linked &= ~(1 << which);
+
+  m->unlock(__FILE__, __LINE__);
+}
+
+/* ************************************ */
+
+void FlowIndex::add(Flow *f) {
+  FlowIndexLinks *l;
+  ndpi_protocol proto = f->get_detected_protocol();
+
+  if((l = (FlowIndexLinks*)calloc(1, sizeof(FlowIndexLinks))) == NULL)
+    return; /* Not indexed: lookups fall back to the flows hash walk for this flow */
+
+  l->l7_app = proto.app_protocol, l->l7_master = proto.master_protocol;
+  f->setIndexLinks(l);
+
+  if(f->get_cli_host()) link(&hosts, hostKey(f->get_cli_host()), f, l, flow_link_cli_host);
+  if(f->get_srv_host()) link(&hosts, hostKey(f->get_srv_host()), f, l, flow_link_srv_host);
+
+  link(&l7protos, l->l7_app, f, l, flow_link_l7_app);
+  if((l->l7_master != l->l7_app) && (l->l7_master != NDPI_PROTOCOL_UNKNOWN))
+    link(&l7protos, l->l7_master, f, l, flow_link_l7_master);
+
+  link(&ports, f->get_cli_port(), f, l, flow_link_cli_port);
+  link(&ports, f->get_srv_port(), f, l, flow_link_srv_port);
+
+  __sync_add_and_fetch(&num_flows, 1);
+}
+
+/* ************************************ */
+
+void FlowIndex::remove(Flow *f) {
+  FlowIndexLinks *l = f->getIndexLinks();
+
+  if(l == NULL)
+    return;
+
+  relink_lock.lock(__FILE__, __LINE__);
+
+  if(f->get_cli_host()) unlink(&hosts, hostKey(f->get_cli_host()), f, l, flow_link_cli_host);
+  if(f->get_srv_host()) unlink(&hosts, hostKey(f->get_srv_host()), f, l, flow_link_srv_host);
+  unlink(&l7protos, l->l7_app, f, l, flow_link_l7_app);
+  unlink(&l7protos, l->l7_master, f, l, flow_link_l7_master);
+  unlink(&ports, f->get_cli_port(), f, l, flow_link_cli_port);
+  unlink(&ports, f->get_srv_port(), f, l, flow_link_srv_port);
+  f->setIndexLinks(NULL);
+
+  relink_lock.unlock(__FILE__, __LINE__);
+
+  free(l);
+
+  __sync_sub_and_fetch(&num_flows, 1);
+}
+
+/* ************************************ */
+
+/*
+  The detected protocol changes after the flow has been indexed. The
+  flow is moved to the buckets of the new protocols; in the meantime it
+  is unreachable from the old ones, so the protocols it is linked under
+  can be changed without holding the bucket locks.
+*/
+void FlowIndex::updateL7(Flow *f) {
+  FlowIndexLinks *l = f->getIndexLinks();
+  ndpi_protocol proto;
+  bool with_master;
+
+  if(l == NULL)
+    return;
+
+  relink_lock.lock(__FILE__, __LINE__);
+
+  proto = f->get_detected_protocol();
+  with_master = (proto.master_protocol != proto.app_protocol) && (proto.master_protocol != NDPI_PROTOCOL_UNKNOWN);
+
+  if(l->l7_app != proto.app_protocol) {
+    unlink(&l7protos, l->l7_app, f, l, flow_link_l7_app);
+    l->l7_app = proto.app_protocol;
+    link(&l7protos, l->l7_app, f, l, flow_link_l7_app);
+  }
+
+  if((!with_master) || (l->l7_master != proto.master_protocol))
+    unlink(&l7protos, l->l7_master, f, l, flow_link_l7_master);
+
+  l->l7_master = proto.master_protocol;
+
+  if(with_master && !(l->linked & (1 << flow_link_l7_master)))
+    link(&l7protos, l->l7_master, f, l, flow_link_l7_master);
+
+  relink_lock.unlock(__FILE__, __LINE__);
+}
+
+/* ************************************ */
+
+/*
+  Walks a bucket chain calling the walker for the flows having
+  exactly the key of the query. A flow linked twice under the same
+  key (e.g. a host talking to itself) is only visited from its second
+  link.
+*/
+bool FlowIndex::walkBucket(flow_index_table_t *t, u_int32_t key, FlowIndexLink which,
+			   const FlowIndexQuery *q,
+			   bool (*walker)(GenericHashEntry *h, void *user_data, bool *matched),
+			   void *user_data, bool *found) {
+  u_int32_t bucket = key & t->mask;
+  Mutex *m = &t->locks[bucket & (FLOW_INDEX_NUM_LOCKS - 1)];
+  Flow *f;
+
+  m->lock(__FILE__, __LINE__);
+
+  f = t->buckets[chainOf(which)][bucket];
+
+  while(f) {
+    FlowIndexLinks *l = f->getIndexLinks();
+    Flow *next = l->links[which].next;
+    bool match;
+
+    switch(which) {
+    case flow_link_cli_host:  match = (f->get_cli_host() == q->host) && (f->get_srv_host() != q->host); break;
+    case flow_link_srv_host:  match = (f->get_srv_host() == q->host); break;
+    case flow_link_l7_app:    match = (l->l7_app == q->value);        break;
+    case flow_link_l7_master: match = (l->l7_master == q->value);     break;
+    case flow_link_cli_port:  match = (f->get_cli_port() == q->value) && (f->get_srv_port() != q->value); break;
+    case flow_link_srv_port:  match = (f->get_srv_port() == q->value); break;
+    default:                  match = false; break;
+    }
+
+    if(match && !f->idle() && !f->is_ready_to_be_purged()) {
+      bool matched = false;
+
+      if(walker(f, user_data, &matched)) {
+	*found = true;
+	break;
+      }
+    }
+
+    f = next;
+  }
+
+  m->unlock(__FILE__, __LINE__);
+
+  return(*found);
+}
+
+/* ************************************ */
+
+bool FlowIndex::walk(const FlowIndexQuery *q,
+		     bool (*walker)(GenericHashEntry *h, void *user_data, bool *matched),
+		     void *user_data) {
+  bool found = false;
+
+  num_lookups++;
+
+  switch(q->type) {
+  case flow_index_host:
+    if(q->host) {
+      u_int32_t key = hostKey(q->host);
+
+      walkBucket(&hosts, key, flow_link_cli_host, q, walker, user_data, &found)
+	|| walkBucket(&hosts, key, flow_link_srv_host, q, walker, user_data, &found);
+    }
+    break;
+
+  case flow_index_l7proto:
+    /* A flow is linked under its master protocol only when it differs from the application one */
+    walkBucket(&l7protos, q->value, flow_link_l7_app, q, walker, user_data, &found)
+      || walkBucket(&l7protos, q->value, flow_link_l7_master, q, walker, user_data, &found);
+    break;
+
+  case flow_index_port:
+    walkBucket(&ports, q->value, flow_link_cli_port, q, walker, user_data, &found)
+      || walkBucket(&ports, q->value, flow_link_srv_port, q, walker, user_data, &found);
+    break;
+
+  default:
+    break;
+  }
+
+  return(found);
+}
+
+/* ************************************ */
+
+u_int64_t FlowIndex::getMemoryUsage() const {
+  return(sizeof(FlowIndex)
+	 + (u_int64_t)(hosts.mask + 1 + l7protos.mask + 1 + ports.mask + 1) * 2 * sizeof(Flow*)
+	 + (u_int64_t)num_flows * sizeof(FlowIndexLinks));
+}
+
+/* ************************************ */
+
+void FlowIndex::lua(lua_State *vm) {
+  lua_newtable(vm);
+
+  lua_push_uint64_table_entry(vm, "num_flows", num_flows);
+  lua_push_uint64_table_entry(vm, "num_lookups", num_lookups);
+  lua_push_uint64_table_entry(vm, "memory", getMemoryUsage());
+  lua_push_uint64_table_entry(vm, "memory_per_flow", sizeof(FlowIndexLinks));
+
+  lua_pushstring(vm, "flow_index");
+  lua_insert(vm, -2);
+  lua_settable(vm, -3);
+}
@@ -22,94 +22,170 @@
 
 /* ******************************************************** */
 
-FrequentTrafficItems::FrequentTrafficItems(u_int32_t _max_items) {
-  max_items =_max_items, max_items_threshold = 2 * _max_items;
-  q = q_committed = NULL;
-  values_sum = last_values_sum = 0;
+FrequentTrafficItems::FrequentTrafficItems(FrequentTrafficKeyType _key_type,
+					   u_int32_t _max_items, u_int32_t _capacity) {
+  u_int32_t index_size;
+
+  key_type = _key_type, max_items = _max_items;
+  capacity = max_val(_capacity, _max_items);
+  num_counters = 0, values_sum = 0;
+
+  /* Keep the index at most half full */
+  for(index_size = 2; index_size < 2 * capacity; index_size <<= 1)
+    ;
+
+  index_mask = index_size - 1;
+
+  counters = (FrequentTrafficNode_t*)calloc(capacity, sizeof(FrequentTrafficNode_t));
+  snapshot = (FrequentTrafficNode_t*)calloc(capacity, sizeof(FrequentTrafficNode_t));
+  index = (u_int32_t*)calloc(index_size, sizeof(u_int32_t));
+
+  if((counters == NULL) || (snapshot == NULL) || (index == NULL))
+    throw("Not enough memory");
+
+  snapshot_seq = 0, snapshot_len = 0, snapshot_values_sum = 0, snapshot_diff = 0;
 }
 
 /* ******************************************************** */
 
 FrequentTrafficItems::~FrequentTrafficItems() {
-  cleanup(q);
-  cleanup(q_committed);
+  free(counters);
+  free(snapshot);
+  free(index);
 }
 
 /* ******************************************************** */
 
-void FrequentTrafficItems::cleanup(FrequentTrafficNode_t *head) {
-  FrequentTrafficNode_t *current, *tmp;
+/* Returns the index slot holding key, or the empty slot where it should go */
+u_int32_t FrequentTrafficItems::lookup(const FrequentTrafficKey_t *key, u_int32_t hash) {
+  u_int32_t slot = hash & index_mask;
+
+  while(index[slot] != 0) {
+    FrequentTrafficNode_t *c = &counters[index[slot] - 1];
 
-  HASH_ITER(hh, head, current, tmp) {
-    HASH_DEL(head, current);  /* delete it */
-    free(current);         /* free it */
+    if((c->hash == hash) && (memcmp(&c->key, key, sizeof(FrequentTrafficKey_t)) == 0))
+      break;
+
+    slot = (slot + 1) & index_mask;
   }
+
+  return(slot);
 }
 
 /* ******************************************************** */
 
-FrequentTrafficNode_t* FrequentTrafficItems::addGeneric(FrequentTrafficKey_t *key, size_t keysize, u_int32_t value) {
-  FrequentTrafficNode_t *s = NULL;
+/* Linear probing deletion: shift back the entries of the probe chain */
+void FrequentTrafficItems::indexRemove(u_int32_t slot) {
+  u_int32_t next = slot;
 
-  /* hh_name, head, key_ptr, key_len, item_ptr */
-  HASH_FIND(hh, q, key, keysize, s);
+  index[slot] = 0;
 
-  if(! s) {
-    if(HASH_COUNT(q) > max_items_threshold)
-      prune();
+  while(true) {
+    u_int32_t ideal;
 
-    if((s = (FrequentTrafficNode_t*)calloc(1, sizeof(FrequentTrafficNode_t))) != NULL) {
-      memcpy(&s->key, key, keysize);
+    next = (next + 1) & index_mask;
 
-      HASH_ADD(hh, q, key, keysize, s);
-    }
+    if(index[next] == 0)
+      return;
+
+    ideal = counters[index[next] - 1].hash & index_mask;
+
+    /* Entries whose ideal slot is cyclically within (slot, next] stay where they are */
+    if((slot <= next) ? ((slot < ideal) && (ideal <= next)) : ((slot < ideal) || (ideal <= next)))
+      continue;
+
+    index[slot] = index[next], counters[index[slot] - 1].slot = slot;
+    index[next] = 0;
+    slot = next;
   }
+}
 
-  return s;
+/* ******************************************************** */
+
+void FrequentTrafficItems::swapCounters(u_int32_t a, u_int32_t b) {
+  FrequentTrafficNode_t tmp = counters[a];
+
+  counters[a] = counters[b], counters[b] = tmp;
+  index[counters[a].slot] = a + 1, index[counters[b].slot] = b + 1;
 }
 
 /* ******************************************************** */
 
-void FrequentTrafficItems::addPoolProtocol(u_int16_t pool_id, u_int16_t proto_id, u_int32_t value) {
-  FrequentTrafficKey_t key;
+void FrequentTrafficItems::siftUp(u_int32_t pos) {
+  while(pos > 0) {
+    u_int32_t parent = (pos - 1) / 2;
 
-  memset(&key, 0, sizeof(key));
-  key.pool_proto.pool_id = pool_id;
-  key.pool_proto.proto_id = proto_id;
+    if(counters[parent].value <= counters[pos].value)
+      break;
 
-  FrequentTrafficNode_t *s = addGeneric(&key, sizeof(key.pool_proto), value);
-  s->value += value;
-  values_sum += value;
+    swapCounters(parent, pos);
+    pos = parent;
+  }
 }
 
 /* ******************************************************** */
 
-static int value_sort(FrequentTrafficNode_t *a, FrequentTrafficNode_t *b) {
-  return(b->value - a->value); /* desc sort */
+void FrequentTrafficItems::siftDown(u_int32_t pos) {
+  while(true) {
+    u_int32_t smallest = pos, l = 2 * pos + 1, r = l + 1;
+
+    if((l < num_counters) && (counters[l].value < counters[smallest].value)) smallest = l;
+    if((r < num_counters) && (counters[r].value < counters[smallest].value)) smallest = r;
+
+    if(smallest == pos)
+      break;
+
+    swapCounters(pos, smallest);
+    pos = smallest;
+  }
 }
 
 /* ******************************************************** */
 
-void FrequentTrafficItems::luaTopPoolsProtocols(lua_State *vm) {
-  FrequentTrafficNode_t *curr;
-  u_int32_t i = 0;
+void FrequentTrafficItems::add(FrequentTrafficKey_t *key, u_int32_t value) {
+  u_int32_t hash = KeyedHash::hashBytes(key, sizeof(FrequentTrafficKey_t));
+  u_int32_t slot = lookup(key, hash), pos;
 
-  lua_newtable(vm);
+  values_sum += value;
 
-  m.lock(__FILE__, __LINE__);
+  if(index[slot] != 0) {
+    /* Tracked key */
+    pos = index[slot] - 1;
+    counters[pos].value += value;
+    siftDown(pos);
+  } else if(num_counters < capacity) {
+    /* Free counter */
+    pos = num_counters++;
+    memcpy(&counters[pos].key, key, sizeof(FrequentTrafficKey_t));
+    counters[pos].value = value, counters[pos].error = 0;
+    counters[pos].hash = hash, counters[pos].slot = slot;
+    index[slot] = pos + 1;
+    siftUp(pos);
+  } else {
+    /* Take over the smallest counter */
+    u_int64_t min_value = counters[0].value;
+
+    indexRemove(counters[0].slot);
+    slot = lookup(key, hash); /* The removal may have shifted the probe chain */
+
+    memcpy(&counters[0].key, key, sizeof(FrequentTrafficKey_t));
+    counters[0].value = min_value + value, counters[0].error = min_value;
+    counters[0].hash = hash, counters[0].slot = slot;
+    index[slot] = 1;
+    siftDown(0);
+  }
+}
 
-  HASH_SORT(q_committed, value_sort);
+/* ******************************************************** */
 
-  for(curr=q_committed; curr != NULL; curr = (FrequentTrafficNode_t*)curr->hh.next) {
-    lua_newtable(vm);
-    lua_push_uint64_table_entry(vm, "pool", curr->key.pool_proto.pool_id);
-    lua_push_uint64_table_entry(vm, "proto", curr->key.pool_proto.proto_id);
-    lua_push_float_table_entry(vm, "Bps", curr->value * 1000 / last_diff);
-    lua_push_float_table_entry(vm, "ratio", curr->value * 100.f / last_values_sum);
-    lua_rawseti(vm, -2, ++i);
-  }
+void FrequentTrafficItems::addPoolProtocol(u_int16_t pool_id, u_int16_t proto_id, u_int32_t value) {
+  FrequentTrafficKey_t key;
+
+  memset(&key, 0, sizeof(key));
+  key.pool_proto.pool_id = pool_id;
+  key.pool_proto.proto_id = proto_id;
 
-  m.unlock(__FILE__, __LINE__);
+  add(&key, value);
 }
 
 /* ******************************************************** */
@@ -121,102 +197,143 @@ void FrequentTrafficItems::addMacProtocol(u_int8_t mac[6], u_int16_t proto_id, u
   memcpy(key.mac_proto.mac, mac, 6);
   key.mac_proto.proto_id = proto_id;
 
-  FrequentTrafficNode_t *s = addGeneric(&key, sizeof(key.mac_proto), value);
-  s->value += value;
-  values_sum += value;
+  add(&key, value);
 }
 
 /* ******************************************************** */
 
-void FrequentTrafficItems::luaTopMacsProtocols(lua_State *vm) {
-  FrequentTrafficNode_t *curr;
-  u_int32_t i = 0;
-  char buf[32];
-
-  lua_newtable(vm);
+void FrequentTrafficItems::addHostPort(IpAddress *ip, u_int16_t port, u_int32_t value) {
+  FrequentTrafficKey_t key;
 
-  m.lock(__FILE__, __LINE__);
+  memset(&key, 0, sizeof(key));
 
-  HASH_SORT(q_committed, value_sort);
+  if(ip->isIPv4())
+    key.host_port.ip.ipv4 = ip->get_ipv4(), key.host_port.ip_version = 4;
+  else if(ip->get_ipv6())
+    memcpy(&key.host_port.ip.ipv6, ip->get_ipv6(), sizeof(struct ndpi_in6_addr)), key.host_port.ip_version = 6;
+  else
+    return;
 
-  for(curr=q_committed; curr != NULL; curr = (FrequentTrafficNode_t*)curr->hh.next) {
-    lua_newtable(vm);
-    lua_push_str_table_entry(vm, "mac", Utils::formatMac(curr->key.mac_proto.mac, buf, sizeof(buf)));
-    lua_push_uint64_table_entry(vm, "proto", curr->key.mac_proto.proto_id);
-    lua_push_float_table_entry(vm, "Bps", curr->value * 1000 / last_diff);
-    lua_push_float_table_entry(vm, "ratio", curr->value * 100.f / last_values_sum);
-    lua_rawseti(vm, -2, ++i);
-  }
+  key.host_port.port = port;
 
-  m.unlock(__FILE__, __LINE__);
+  add(&key, value);
 }
 
 /* ******************************************************** */
 
-void FrequentTrafficItems::prune() {
-  FrequentTrafficNode_t *curr, *tmp;
-  u_int32_t num = 0;
+void FrequentTrafficItems::addASProtocol(u_int32_t asn, u_int16_t proto_id, u_int32_t value) {
+  FrequentTrafficKey_t key;
 
-  /*
-    Sort the hash items by value and remove those who exceeded
-    the threshold of max_items_threshold
-  */
-  HASH_SORT(q, value_sort);
+  memset(&key, 0, sizeof(key));
+  key.as_proto.asn = asn;
+  key.as_proto.proto_id = proto_id;
 
-  HASH_ITER(hh, q, curr, tmp) {
-    if(++num > max_items) {
-      HASH_DEL(q, curr);
-      free(curr);
-    }
-  }
+  add(&key, value);
 }
 
 /* ******************************************************** */
 
 void FrequentTrafficItems::reset(float tdiff_msec) {
-  /* The mutex is only needed to guard q_committed */
-  m.lock(__FILE__, __LINE__);
-  cleanup(q_committed);
-  q_committed = q;
-  m.unlock(__FILE__, __LINE__);
+  /* Publish the period counters */
+  snapshot_seq++;
+  gcc_mb();
+
+  memcpy(snapshot, counters, num_counters * sizeof(FrequentTrafficNode_t));
+  snapshot_len = num_counters;
+  snapshot_values_sum = values_sum;
+  snapshot_diff = tdiff_msec;
+
+  gcc_mb();
+  snapshot_seq++;
 
-  q = NULL;
-  last_diff = tdiff_msec;
-  last_values_sum = values_sum;
-  values_sum = 0;
+  /* Start a new period */
+  memset(index, 0, (index_mask + 1) * sizeof(u_int32_t));
+  num_counters = 0, values_sum = 0;
 }
 
-// #define TEST_ME
-#ifdef TEST_ME
+/* ******************************************************** */
+
+static int value_sort(const void *_a, const void *_b) {
+  FrequentTrafficNode_t *a = (FrequentTrafficNode_t*)_a;
+  FrequentTrafficNode_t *b = (FrequentTrafficNode_t*)_b;
+
+  /* desc sort */
+  if(a->value < b->value)      return(1);
+  else if(a->value > b->value) return(-1);
+  else return(0);
+}
 
 /* ******************************************************** */
 
-void FrequentTrafficItems::print() {
-  FrequentTrafficNode_t *curr;
-  
-  HASH_SORT(q, value_sort);
+void FrequentTrafficItems::luaKey(lua_State *vm, FrequentTrafficKey_t *key) {
+  char buf[64];
+
+  switch(key_type) {
+  case frequent_pool_proto:
+    lua_push_uint64_table_entry(vm, "pool", key->pool_proto.pool_id);
+    lua_push_uint64_table_entry(vm, "proto", key->pool_proto.proto_id);
+    break;
 
-  for(curr=q; curr != NULL; curr = (FrequentTrafficNode_t*)curr->hh.next) {
-    ntop->getTrace()->traceEvent(TRACE_NORMAL, "<%u, %u> = %u\n",
-      curr->key.pool_proto.pool_id, curr->key.pool_proto.proto_id, curr->value);
+  case frequent_mac_proto:
+    lua_push_str_table_entry(vm, "mac", Utils::formatMac(key->mac_proto.mac, buf, sizeof(buf)));
+    lua_push_uint64_table_entry(vm, "proto", key->mac_proto.proto_id);
+    break;
+
+  case frequent_host_port:
+    {
+      IpAddress ip;
+
+      if(key->host_port.ip_version == 4)
+	ip.set(key->host_port.ip.ipv4);
+      else
+	ip.set(&key->host_port.ip.ipv6);
+
+      lua_push_str_table_entry(vm, "host", ip.print(buf, sizeof(buf)));
+      lua_push_uint64_table_entry(vm, "port", key->host_port.port);
+    }
+    break;
+
+  case frequent_as_proto:
+    lua_push_uint64_table_entry(vm, "asn", key->as_proto.asn);
+    lua_push_uint64_table_entry(vm, "proto", key->as_proto.proto_id);
+    break;
   }
 }
 
-/* ******************************************* */
+/* ******************************************************** */
 
-void FrequentTrafficItems::testme() {
-  reset(0);
+void FrequentTrafficItems::lua(lua_State *vm) {
+  FrequentTrafficNode_t *items;
+  u_int32_t seq, len, i;
+  u_int64_t sum;
+  float diff;
 
-  for(int i = 0; i<256; i++)
-    addPoolProtocol(rand() % 5, rand() % 20, rand());
+  lua_newtable(vm);
 
-  print();
+  if((items = (FrequentTrafficNode_t*)malloc(capacity * sizeof(FrequentTrafficNode_t))) == NULL)
+    return;
 
-  reset(5000);
+  /* Copy the snapshot, retrying if a commit happened meanwhile */
+  do {
+    while((seq = snapshot_seq) & 1)
+      ; /* Commit in progress */
 
-  print();
+    gcc_mb();
+    len = snapshot_len;
+    memcpy(items, snapshot, len * sizeof(FrequentTrafficNode_t));
+    sum = snapshot_values_sum, diff = snapshot_diff;
+    gcc_mb();
+  } while(seq != snapshot_seq);
 
-  exit(0);
-}
+  qsort(items, len, sizeof(FrequentTrafficNode_t), value_sort);
 
-#endif // #ifdef TEST_ME
+  for(i = 0; (i < len) && (i < max_items); i++) {
+    lua_newtable(vm);
+    luaKey(vm, &items[i].key);
+    lua_push_float_table_entry(vm, "Bps", diff ? (items[i].value * 1000 / diff) : 0);
+    lua_push_float_table_entry(vm, "ratio", sum ? (items[i].value * 100.f / sum) : 0);
+    lua_rawseti(vm, -2, i + 1);
+  }
+
+  free(items);
+}
@@ -38,6 +38,8 @@ GenericHash::GenericHash(NetworkInterface *_iface, u_int _num_hashes,
   for(u_int i = 0; i < num_hashes; i++) locks[i] = new Mutex();
 
   last_purged_hash = _num_hashes - 1;
+  memset(&chain_stats, 0, sizeof(chain_stats));
+  memset(&next_chain_stats, 0, sizeof(next_chain_stats));
 }
 
 /* ************************************ */
@@ -74,7 +76,7 @@ void GenericHash::cleanup() {
 
 bool GenericHash::add(GenericHashEntry *h) {
   if(hasEmptyRoom()) {
-    u_int32_t hash = (h->key() % num_hashes);
+    u_int32_t hash = (h->hash_value() % num_hashes);
 
     if(false) {
       char buf[256];
@@ -96,7 +98,7 @@ bool GenericHash::add(GenericHashEntry *h) {
 /* ************************************ */
 
 bool GenericHash::remove(GenericHashEntry *h) {
-  u_int32_t hash = (h->key() % num_hashes);
+  u_int32_t hash = (h->hash_value() % num_hashes);
 
   if(table[hash] == NULL)
     return(false);
@@ -230,6 +232,8 @@ u_int GenericHash::purgeIdle() {
   disablePurge();
 
   for(u_int j = 0; j < purge_step; j++) {
+    u_int32_t chain_len = 0;
+
     if(++last_purged_hash == num_hashes) last_purged_hash = 0;
     i = last_purged_hash;
 
@@ -264,12 +268,24 @@ u_int GenericHash::purgeIdle() {
 
 	  prev = head;
 	  head = next;
+	  chain_len++;
 	}
       } /* while */
 
       locks[i]->unlock(__FILE__, __LINE__);
       // ntop->getTrace()->traceEvent(TRACE_NORMAL, "[purge] Unlocked %d", i);
     }
+
+    addChainLength(&next_chain_stats, chain_len);
+
+    if(i == num_hashes - 1) {
+      /* All the buckets have been visited */
+      chain_stats_lock.lock(__FILE__, __LINE__);
+      chain_stats = next_chain_stats;
+      chain_stats_lock.unlock(__FILE__, __LINE__);
+
+      memset(&next_chain_stats, 0, sizeof(next_chain_stats));
+    }
   }
 
   enablePurge();
@@ -304,3 +320,33 @@ GenericHashEntry* GenericHash::findByKey(u_int32_t key) {
 
   return(head);
 }
+
+/* ************************************ */
+
+static const int32_t chain_slot_bounds[HASH_CHAIN_HISTOGRAM_SLOTS] = { 0, 1, 2, 4, 8, 16, -1 /* +Inf */ };
+
+int32_t GenericHash::getChainSlotBound(u_int slot) {
+  return((slot < HASH_CHAIN_HISTOGRAM_SLOTS) ? chain_slot_bounds[slot] : -1);
+}
+
+/* ************************************ */
+
+void GenericHash::addChainLength(HashChainStats *stats, u_int32_t len) {
+  u_int slot;
+
+  for(slot = 0; slot < HASH_CHAIN_HISTOGRAM_SLOTS - 1; slot++)
+    if(len <= (u_int32_t)chain_slot_bounds[slot]) break;
+
+  stats->num_buckets[slot]++, stats->num_entries += len;
+
+  if(len > stats->max_chain_len)
+    stats->max_chain_len = len;
+}
+
+/* ************************************ */
+
+void GenericHash::getChainStats(HashChainStats *stats) {
+  chain_stats_lock.lock(__FILE__, __LINE__);
+  *stats = chain_stats;
+  chain_stats_lock.unlock(__FILE__, __LINE__);
+}
@@ -121,12 +121,21 @@ void Geolocation::testme() {
 }
 #endif
 
+u_int32_t Geolocation::db_epoch = 0;
+Mutex Geolocation::interned_lock;
+std::set<std::string> Geolocation::interned_strings;
+
 /* *************************************** */
 
 Geolocation::Geolocation(char *db_home) {
   char path[MAX_PATH];
   snprintf(path, sizeof(path), "%s/geoip", db_home);
 
+  num_cache_hits = num_cache_misses = 0;
+
+  /* Invalidates the results cached by the hosts */
+  if(++db_epoch == 0) db_epoch = 1;
+
 #ifdef HAVE_MAXMINDDB
   mmdbs_ok = loadMaxMindDB(path, "GeoLite2-ASN.mmdb",  &geo_ip_asn_mmdb)
     && loadMaxMindDB(path, "GeoLite2-City.mmdb", &geo_ip_city_mmdb);
@@ -230,90 +239,91 @@ void Geolocation::getAS(IpAddress *addr, u_int32_t *asn, char **asname) {
 
 /* *************************************** */
 
-void Geolocation::getInfo(IpAddress *addr, char **continent_code, char **country_code,
-			  char **city, float *latitude, float *longitude) {
-  if(continent_code) *continent_code = strdup((char*)UNKNOWN_CONTINENT);
-  if(country_code)   *country_code = strdup((char*)UNKNOWN_COUNTRY);
-  if(city)           *city = strdup((char*)UNKNOWN_CITY);
-  if(latitude)       *latitude = 0;
-  if(longitude)      *longitude = 0;
+const char* Geolocation::intern(const char *s, size_t len) {
+  std::string str(s, len);
+  const char *ret;
+
+  interned_lock.lock(__FILE__, __LINE__);
+  ret = interned_strings.insert(str).first->c_str();
+  interned_lock.unlock(__FILE__, __LINE__);
+
+  return(ret);
+}
+
+/* *************************************** */
+
+void Geolocation::lookupInfo(IpAddress *addr, GeoInfo *info) {
+  const char *continent_code = intern(UNKNOWN_CONTINENT, strlen(UNKNOWN_CONTINENT));
+  const char *country_code = intern(UNKNOWN_COUNTRY, strlen(UNKNOWN_COUNTRY));
+  const char *city = intern(UNKNOWN_CITY, strlen(UNKNOWN_CITY));
+  float latitude = 0, longitude = 0;
 
 #ifdef HAVE_MAXMINDDB
   sockaddr *sa = NULL;
   ssize_t sa_len;
-  char *cdata;
-
-  if(!mmdbs_ok) return;
 
-  if(addr && addr->get_sockaddr(&sa, &sa_len)) {
+  if(mmdbs_ok && addr && addr->get_sockaddr(&sa, &sa_len)) {
     int mmdb_error, status;
     MMDB_lookup_result_s result;
     MMDB_entry_data_s entry_data;
-      
+
     result = MMDB_lookup_sockaddr(&geo_ip_city_mmdb, sa, &mmdb_error);
 
     if(mmdb_error == MMDB_SUCCESS) {
       if(result.found_entry) {
 	/* Get the continent code */
-	if(continent_code && (status = MMDB_get_value(&result.entry, &entry_data, "continent", "code", NULL)) == MMDB_SUCCESS) {
-	  if(entry_data.has_data && entry_data.type == MMDB_DATA_TYPE_UTF8_STRING) {
-	    if((cdata = (char*)malloc(entry_data.data_size + 1))) {
-	      snprintf(cdata, entry_data.data_size + 1, "%s", entry_data.utf8_string);
-	      free(*continent_code);
-	      *continent_code = cdata;
-	    }
-	  }
+	if((status = MMDB_get_value(&result.entry, &entry_data, "continent", "code", NULL)) == MMDB_SUCCESS) {
+	  if(entry_data.has_data && entry_data.type == MMDB_DATA_TYPE_UTF8_STRING)
+	    continent_code = intern(entry_data.utf8_string, entry_data.data_size);
 	}
 
 	/* Get the country code */
-	if(country_code && (status = MMDB_get_value(&result.entry, &entry_data, "country", "iso_code", NULL)) == MMDB_SUCCESS) {
-	  if(entry_data.has_data && entry_data.type == MMDB_DATA_TYPE_UTF8_STRING) {
-	    if((cdata = (char*)malloc(entry_data.data_size + 1))) {
-	      snprintf(cdata, entry_data.data_size + 1, "%s", entry_data.utf8_string);
-	      free(*country_code);
-	      *country_code = cdata;
-	    }
-	  }
+	if((status = MMDB_get_value(&result.entry, &entry_data, "country", "iso_code", NULL)) == MMDB_SUCCESS) {
+	  if(entry_data.has_data && entry_data.type == MMDB_DATA_TYPE_UTF8_STRING)
+	    country_code = intern(entry_data.utf8_string, entry_data.data_size);
 	}
 
 	/* Get the city (seems that there are only localized versions of the city name) */
-	if(city && (status = MMDB_get_value(&result.entry, &entry_data, "city", "names", "en", NULL)) == MMDB_SUCCESS) {
-	  if(entry_data.has_data && entry_data.type == MMDB_DATA_TYPE_UTF8_STRING) {
-	    if((cdata = (char*)malloc(entry_data.data_size + 1))) {
-	      snprintf(cdata, entry_data.data_size + 1, "%s", entry_data.utf8_string);
-	      free(*city);
-	      *city = cdata;
-	    }
-	  }
+	if((status = MMDB_get_value(&result.entry, &entry_data, "city", "names", "en", NULL)) == MMDB_SUCCESS) {
+	  if(entry_data.has_data && entry_data.type == MMDB_DATA_TYPE_UTF8_STRING)
+	    city = intern(entry_data.utf8_string, entry_data.data_size);
 	}
 
 	/* Get the latitude */
-	if(latitude && (status = MMDB_get_value(&result.entry, &entry_data, "location", "latitude", NULL)) == MMDB_SUCCESS) {
+	if((status = MMDB_get_value(&result.entry, &entry_data, "location", "latitude", NULL)) == MMDB_SUCCESS) {
 	  if(entry_data.has_data && entry_data.type == MMDB_DATA_TYPE_DOUBLE)
-	    *latitude = (float)entry_data.double_value;
+	    latitude = (float)entry_data.double_value;
 	}
 
 	/* Get the longitude */
-	if(longitude && (status = MMDB_get_value(&result.entry, &entry_data, "location", "longitude", NULL)) == MMDB_SUCCESS) {
+	if((status = MMDB_get_value(&result.entry, &entry_data, "location", "longitude", NULL)) == MMDB_SUCCESS) {
 	  if(entry_data.has_data && entry_data.type == MMDB_DATA_TYPE_DOUBLE)
-	    *longitude = (float)entry_data.double_value;
+	    longitude = (float)entry_data.double_value;
 	}
       }
     }
 
     free(sa);
-  } else
+  } else if(mmdbs_ok)
     ntop->getTrace()->traceEvent(TRACE_ERROR, "Invalid address lookup");
 #endif
 
-  return;
+  info->continent_code = continent_code, info->country_code = country_code, info->city = city;
+  info->latitude = latitude, info->longitude = longitude;
 }
 
-
 /* *************************************** */
 
-void Geolocation::freeInfo(char **continent_code, char **country_code, char **city) {
-  if(continent_code) { free(*continent_code); *continent_code = NULL; }
-  if(country_code)   { free(*country_code);   *country_code = NULL;   }
-  if(city)           { free(*city);           *city = NULL;           }
+void Geolocation::getInfo(IpAddress *addr, GeoInfo *info) {
+  /* Called by several threads (e.g. packet processing and Lua) */
+  if(info->db_epoch == db_epoch) {
+    __sync_add_and_fetch(&num_cache_hits, 1);
+    return;
+  }
+
+  __sync_add_and_fetch(&num_cache_misses, 1);
+  lookupInfo(addr, info);
+
+  /* Concurrent readers always see valid (interned) strings */
+  info->db_epoch = db_epoch;
 }
@@ -793,6 +793,91 @@ static void uri_encode(const char *src, char *dst, u_int dst_len) {
 
 /* ****************************************** */
 
+/*
+  Flows and hosts listings served directly from C++: rows are streamed
+  as JSON to the connection without building intermediate Lua tables.
+  Query parameters are the Paginator options plus ifid, host, vlan and
+  (for hosts) mode=local|remote.
+*/
+static int handle_rest_request(struct mg_connection *conn,
+			       const struct mg_request_info *request_info,
+			       const char *username) {
+  const char *query = request_info->query_string ? request_info->query_string : "";
+  size_t query_len = strlen(query);
+  char val[64], key[64], allowed_ifname[MAX_INTERFACE_NAME_LEN] = { 0 }, nets[255];
+  NetworkInterface *iface = NULL;
+  AddressTree ptree, *allowed_hosts = NULL;
+  Paginator p;
+  int rc;
+
+  if(mg_get_var(query, query_len, "ifid", val, sizeof(val)) > 0)
+    iface = ntop->getInterfaceById(atoi(val));
+  else
+    iface = ntop->getFirstInterface();
+
+  if(username && username[0]) {
+    ntop->getUserAllowedIfname(username, allowed_ifname, sizeof(allowed_ifname));
+
+    snprintf(key, sizeof(key), CONST_STR_USER_NETS, username);
+    if((ntop->getRedis()->get(key, nets, sizeof(nets)) != -1) && (nets[0] != '\0')) {
+      ptree.addAddresses(nets);
+      allowed_hosts = &ptree;
+    }
+  }
+
+  if((iface == NULL)
+     || (allowed_ifname[0] && strncmp(allowed_ifname, iface->get_name(), strlen(allowed_ifname))))
+    return(send_error(conn, 404, "Not Found", PAGE_NOT_FOUND, request_info->uri));
+
+  p.readOptions(query);
+
+  mg_printf(conn,
+	    "HTTP/1.1 200 OK\r\n"
+	    "Content-Type: application/json\r\n"
+	    "Cache-Control: no-cache\r\n"
+	    "Connection: close\r\n\r\n");
+
+  JSONStream s(conn);
+
+  if(strcmp(request_info->uri, REST_GET_FLOWS_URL) == 0) {
+    char host_ip[64];
+    Host *host = NULL;
+    u_int16_t vlan_id = 0;
+    bool host_filter = (mg_get_var(query, query_len, "host", host_ip, sizeof(host_ip)) > 0);
+
+    if(mg_get_var(query, query_len, "vlan", val, sizeof(val)) > 0)
+      vlan_id = atoi(val);
+
+    if(host_filter)
+      host = iface->getHost(host_ip, vlan_id);
+
+    /* Like getFlowsInfo(), an unknown host yields no results */
+    rc = ((!host_filter) || host) ? iface->getFlows(&s, allowed_hosts, host, &p) : -1;
+  } else {
+    LocationPolicy location = location_all;
+
+    if(mg_get_var(query, query_len, "mode", val, sizeof(val)) > 0) {
+      if(!strcmp(val, "local"))       location = location_local_only;
+      else if(!strcmp(val, "remote")) location = location_remote_only;
+    }
+
+    rc = iface->getActiveHostsList(&s, allowed_hosts, &p, location);
+  }
+
+  if(rc < 0) {
+    /* Keep the response a valid JSON document */
+    s.beginObject();
+    s.addString("error", "Unable to retrieve the requested data");
+    s.endObject();
+  }
+
+  s.flush();
+
+  return(1); /* Handled */
+}
+
+/* ****************************************** */
+
 static int handle_lua_request(struct mg_connection *conn) {
   struct mg_request_info *request_info = (struct mg_request_info *)mg_get_request_info(conn);
   char *crlf;
@@ -962,6 +1047,8 @@ static int handle_lua_request(struct mg_connection *conn) {
 
   if((strncmp(request_info->uri, "/lua/", 5) == 0)
      || (strcmp(request_info->uri, "/metrics") == 0)
+     || (strcmp(request_info->uri, REST_GET_FLOWS_URL) == 0)
+     || (strcmp(request_info->uri, REST_GET_HOSTS_URL) == 0)
      || (strcmp(request_info->uri, "/") == 0)) {
     /* Lua Script */
     char path[255] = { 0 }, uri[2048];
@@ -991,10 +1078,12 @@ static int handle_lua_request(struct mg_connection *conn) {
       return(0);
     } else {
       if(strcmp(request_info->uri, "/metrics") == 0)
-	snprintf(path, sizeof(path), "%s/lua/metrics.lua",
-	  httpserver->get_scripts_dir());
-      else
-	snprintf(path, sizeof(path), "%s%s%s",
+	return(httpserver->get_prometheus()->handleRequest(conn, request_info));
+      else if((strcmp(request_info->uri, REST_GET_FLOWS_URL) == 0)
+	      || (strcmp(request_info->uri, REST_GET_HOSTS_URL) == 0))
+	return(handle_rest_request(conn, request_info, username));
+
+      snprintf(path, sizeof(path), "%s%s%s",
 	       httpserver->get_scripts_dir(),
 	       Utils::getURL(len == 1 ? (char*)"/lua/index.lua" : request_info->uri, uri, sizeof(uri)),
 	       len > 1 && request_info->uri[len-1] == '/' ? (char*)"index.lua" : (char*)"");
@@ -1215,6 +1304,7 @@ HTTPserver::HTTPserver(const char *_docs_dir, const char *_scripts_dir) {
   bool good_ssl_cert = false;
   wispr_captive_data = NULL;
   captive_redirect_addr = NULL;
+  prometheus = new PrometheusExporter();
 
   struct timeval tv;
   static char *http_options[] = {
@@ -1349,6 +1439,7 @@ HTTPserver::~HTTPserver() {
 
   if(wispr_captive_data) free(wispr_captive_data);
   if(captive_redirect_addr) free(captive_redirect_addr);
+  if(prometheus) delete prometheus;
   free(docs_dir), free(scripts_dir);
   ntop->getTrace()->traceEvent(TRACE_NORMAL, "HTTP server terminated");
 };
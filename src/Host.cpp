@@ -90,14 +90,32 @@ Host::~Host() {
 /* *************************************** */
 
 void Host::updateSynFlags(time_t when, u_int8_t flags, Flow *f, bool syn_sent) {
-  AlertCounter *counter = syn_sent ? syn_flood_attacker_alert : syn_flood_victim_alert;
+  AlertCounter *counter;
+
+  if(!triggerAlerts())
+    return;
 
-  if(triggerAlerts())
+  if(syn_sent)
+    counter = getAlertCounter(&syn_flood_attacker_alert, syn_attacker_threshold);
+  else
+    counter = getAlertCounter(&syn_flood_victim_alert, syn_victim_threshold);
+
+  if(counter)
     counter->incHits(when);
 }
 
 /* *************************************** */
 
+AlertCounter* Host::getAlertCounter(AlertCounter **counter, u_int32_t max_num_hits_sec) {
+  /* Counters are allocated on the first hit as most hosts never hit them */
+  if(*counter == NULL)
+    *counter = new(std::nothrow) AlertCounter(max_num_hits_sec, CONST_MAX_THRESHOLD_CROSS_DURATION);
+
+  return(*counter);
+}
+
+/* *************************************** */
+
 u_int32_t Host::getNumAlerts(bool from_alertsmanager) {
   if(!from_alertsmanager)
     return(num_alerts_detected);
@@ -131,8 +149,7 @@ void Host::set_host_label(char *label_name, bool ignoreIfPresent) {
 /* *************************************** */
 
 void Host::initialize(Mac *_mac, u_int16_t _vlanId, bool init_all) {
-  ndpiStats = new nDPIStats();
-//printf("SIZE: %lu, %lu, %lu\n", sizeof(nDPIStats), MAX_NDPI_PROTOS, NDPI_PROTOCOL_NUM_CATEGORIES);
+  /* ndpiStats is allocated by incStats when the host has traffic */
   last_bytes = 0, last_bytes_thpt = bytes_thpt = 0, bytes_thpt_trend = trend_unknown;
   bytes_thpt_diff = 0, last_epoch_update = 0;
   total_activity_time = 0;
@@ -170,18 +187,20 @@ void Host::initialize(Mac *_mac, u_int16_t _vlanId, bool init_all) {
 
   memset(&tcpPacketStats, 0, sizeof(tcpPacketStats));
   asn = 0, asname = NULL;
+  memset(&geo_info, 0, sizeof(geo_info));
   as = NULL, country = NULL;
   blacklisted_host = false, reloadHostBlacklist();
 
   num_alerts_detected = 0;
   trigger_host_alerts = false;
 
-  PROFILING_SUB_SECTION_ENTER(iface, "Host::initialize: new AlertCounter", 17);
-  syn_flood_attacker_alert = new AlertCounter(ntop->getPrefs()->get_attacker_max_num_syn_per_sec(), CONST_MAX_THRESHOLD_CROSS_DURATION);
-  syn_flood_victim_alert = new AlertCounter(ntop->getPrefs()->get_victim_max_num_syn_per_sec(), CONST_MAX_THRESHOLD_CROSS_DURATION);
-  flow_flood_attacker_alert = new AlertCounter(ntop->getPrefs()->get_attacker_max_num_flows_per_sec(), CONST_MAX_THRESHOLD_CROSS_DURATION);
-  flow_flood_victim_alert = new AlertCounter(ntop->getPrefs()->get_victim_max_num_flows_per_sec(), CONST_MAX_THRESHOLD_CROSS_DURATION);
-  PROFILING_SUB_SECTION_EXIT(iface, 17);
+  /* Flood counters are allocated on the first hit (see getAlertCounter) */
+  syn_flood_attacker_alert = syn_flood_victim_alert = NULL;
+  flow_flood_attacker_alert = flow_flood_victim_alert = NULL;
+  syn_attacker_threshold = ntop->getPrefs()->get_attacker_max_num_syn_per_sec();
+  syn_victim_threshold = ntop->getPrefs()->get_victim_max_num_syn_per_sec();
+  flow_attacker_threshold = ntop->getPrefs()->get_attacker_max_num_flows_per_sec();
+  flow_victim_threshold = ntop->getPrefs()->get_victim_max_num_flows_per_sec();
 
   PROFILING_SUB_SECTION_ENTER(iface, "Host::initialize: refreshHostAlertPrefs", 19);
   refreshHostAlertPrefs();
@@ -263,22 +282,28 @@ void Host::refreshHostAlertPrefs() {
 #endif
 	}
 
+	syn_attacker_threshold = syn_attacker_pref, syn_victim_threshold = syn_victim_pref;
+	flow_attacker_threshold = flow_attacker_pref, flow_victim_threshold = flow_victim_pref;
+
 	/* Counter reload logic */
-	if((u_int32_t)flow_attacker_pref != flow_flood_attacker_alert->getCurrentHits()) {
+	if(flow_flood_attacker_alert
+	   && ((u_int32_t)flow_attacker_pref != flow_flood_attacker_alert->getCurrentHits())) {
 	  flow_flood_attacker_alert->resetThresholds(flow_attacker_pref, CONST_MAX_THRESHOLD_CROSS_DURATION);
 #if 0
 	  printf("%s: attacker_max_num_flows_per_sec = %d\n", key, flow_attacker_pref);
 #endif
 	}
 
-	if((u_int32_t)flow_victim_pref != flow_flood_victim_alert->getCurrentHits()) {
+	if(flow_flood_victim_alert
+	   && ((u_int32_t)flow_victim_pref != flow_flood_victim_alert->getCurrentHits())) {
 	  flow_flood_victim_alert->resetThresholds(flow_victim_pref, CONST_MAX_THRESHOLD_CROSS_DURATION);
 #if 0
 	  printf("%s: victim_max_num_flows_per_sec = %d\n", key, flow_victim_pref);
 #endif
 	}
 
-	if((u_int32_t)syn_attacker_pref != syn_flood_attacker_alert->getCurrentHits()) {
+	if(syn_flood_attacker_alert
+	   && ((u_int32_t)syn_attacker_pref != syn_flood_attacker_alert->getCurrentHits())) {
 	  syn_flood_attacker_alert->resetThresholds(syn_attacker_pref, CONST_MAX_THRESHOLD_CROSS_DURATION);
 
 #if 0
@@ -286,7 +311,8 @@ void Host::refreshHostAlertPrefs() {
 #endif
 	}
 
-	if((u_int32_t)syn_victim_pref != syn_flood_victim_alert->getCurrentHits()) {
+	if(syn_flood_victim_alert
+	   && ((u_int32_t)syn_victim_pref != syn_flood_victim_alert->getCurrentHits())) {
 	  syn_flood_victim_alert->resetThresholds(syn_victim_pref, CONST_MAX_THRESHOLD_CROSS_DURATION);
 
 #if 0
@@ -459,10 +485,10 @@ void Host::loadAlertsCounter() {
 bool Host::hasAnomalies() {
   time_t now = time(0);
 
-  return syn_flood_victim_alert->isAboveThreshold(now)
-    || syn_flood_attacker_alert->isAboveThreshold(now)
-    || flow_flood_victim_alert->isAboveThreshold(now)
-    || flow_flood_attacker_alert->isAboveThreshold(now);
+  return (syn_flood_victim_alert && syn_flood_victim_alert->isAboveThreshold(now))
+    || (syn_flood_attacker_alert && syn_flood_attacker_alert->isAboveThreshold(now))
+    || (flow_flood_victim_alert && flow_flood_victim_alert->isAboveThreshold(now))
+    || (flow_flood_attacker_alert && flow_flood_attacker_alert->isAboveThreshold(now));
 }
 
 /* *************************************** */
@@ -475,13 +501,13 @@ void Host::luaAnomalies(lua_State* vm) {
     time_t now = time(0);
     lua_newtable(vm);
 
-    if(syn_flood_victim_alert->isAboveThreshold(now))
+    if(syn_flood_victim_alert && syn_flood_victim_alert->isAboveThreshold(now))
       syn_flood_victim_alert->lua(vm, "syn_flood_victim");
-    if(syn_flood_attacker_alert->isAboveThreshold(now))
+    if(syn_flood_attacker_alert && syn_flood_attacker_alert->isAboveThreshold(now))
       syn_flood_attacker_alert->lua(vm, "syn_flood_attacker");
-    if(flow_flood_victim_alert->isAboveThreshold(now))
+    if(flow_flood_victim_alert && flow_flood_victim_alert->isAboveThreshold(now))
       flow_flood_victim_alert->lua(vm, "flows_flood_victim");
-    if(flow_flood_attacker_alert->isAboveThreshold(now))
+    if(flow_flood_attacker_alert && flow_flood_attacker_alert->isAboveThreshold(now))
       flow_flood_attacker_alert->lua(vm, "flows_flood_attacker");
 
     lua_pushstring(vm, "anomalies");
@@ -564,7 +590,7 @@ void Host::lua(lua_State* vm, AddressTree *ptree,
     if((symbolic_name == NULL) || (strcmp(symbolic_name, ipaddr) == 0)) {
       /* We resolve immediately the IP address by queueing on the top of address queue */
 
-      ntop->getRedis()->pushHostToResolve(ipaddr, false, true /* Fake to resolve it ASAP */);
+      ntop->getAddressResolution()->queueHostToResolve(ipaddr, true /* Resolve it ASAP */);
     }
 
     if(ssdpLocation)
@@ -602,21 +628,18 @@ void Host::lua(lua_State* vm, AddressTree *ptree,
   }
 
   if(host_details) {
-    char *continent = NULL, *country_name = NULL, *city = NULL;
-    float latitude = 0, longitude = 0;
+    const GeoInfo *geo = getGeoInfo();
 
     /* ifid is useful for example for view interfaces to detemine
        the actual, original interface the host is associated to. */
     lua_push_uint64_table_entry(vm, "ifid", iface->get_id());
     if(info) lua_push_str_table_entry(vm, "info", getInfo(buf, sizeof(buf)));
 
-    ntop->getGeolocation()->getInfo(&ip, &continent, &country_name, &city, &latitude, &longitude);
-    lua_push_str_table_entry(vm, "continent", continent ? continent : (char*)"");
-    lua_push_str_table_entry(vm, "country", country_name ? country_name  : (char*)"");
-    lua_push_float_table_entry(vm, "latitude", latitude);
-    lua_push_float_table_entry(vm, "longitude", longitude);
-    lua_push_str_table_entry(vm, "city", city ? city : (char*)"");
-    ntop->getGeolocation()->freeInfo(&continent, &country_name, &city);
+    lua_push_str_table_entry(vm, "continent", geo->continent_code ? geo->continent_code : "");
+    lua_push_str_table_entry(vm, "country", geo->country_code ? geo->country_code : "");
+    lua_push_float_table_entry(vm, "latitude", geo->latitude);
+    lua_push_float_table_entry(vm, "longitude", geo->longitude);
+    lua_push_str_table_entry(vm, "city", geo->city ? geo->city : "");
 
     lua_push_uint64_table_entry(vm, "total_activity_time", total_activity_time);
     lua_push_uint64_table_entry(vm, "flows.as_client", total_num_flows_as_client);
@@ -677,6 +700,121 @@ void Host::lua(lua_State* vm, AddressTree *ptree,
 
 /* ***************************************** */
 
+/* Indexed by HostLuaField: same key names of Host::lua() */
+static const char *host_lua_fields[] = {
+  "ip", "vlan", "ipkey", "name", "mac", "localhost", "systemhost", "is_blacklisted",
+  "asn", "asname", "country", "os", "host_pool_id", "seen.first", "seen.last", "duration",
+  "bytes.sent", "bytes.rcvd", "packets.sent", "packets.rcvd", "throughput_bps", "throughput_pps",
+  "active_flows.as_client", "active_flows.as_server", "num_alerts", "anomalies"
+};
+
+HostLuaField Host::getLuaField(const char *name) {
+  for(int i = 0; i < (int)host_field_unknown; i++) {
+    if(!strcmp(host_lua_fields[i], name))
+      return((HostLuaField)i);
+  }
+
+  return(host_field_unknown);
+}
+
+/* ***************************************** */
+
+/* Pushes a table with the requested fields only. Returns false when nothing has been pushed */
+bool Host::luaProjection(lua_State* vm, const HostLuaField *fields, u_int num_fields) {
+  char buf[64];
+  Mac *m = mac; /* Cache macs as they can be swapped/updated */
+
+  if(Utils::maskHost(isLocalHost()))
+    return(false);
+
+  lua_newtable(vm);
+
+  for(u_int i = 0; i < num_fields; i++) {
+    const char *key = (fields[i] < host_field_unknown) ? host_lua_fields[fields[i]] : NULL;
+
+    switch(fields[i]) {
+    case host_field_ip:             lua_push_str_table_entry(vm, key, printMask(buf, sizeof(buf))); break;
+    case host_field_vlan:           lua_push_uint64_table_entry(vm, key, get_vlan_id()); break;
+    case host_field_ipkey:          lua_push_uint64_table_entry(vm, key, ip.key()); break;
+    case host_field_name:           lua_push_str_table_entry(vm, key, get_visual_name(buf, sizeof(buf))); break;
+    case host_field_mac:            lua_push_str_table_entry(vm, key, Utils::formatMac(m ? m->get_mac() : NULL, buf, sizeof(buf))); break;
+    case host_field_localhost:      lua_push_bool_table_entry(vm, key, isLocalHost()); break;
+    case host_field_systemhost:     lua_push_bool_table_entry(vm, key, isSystemHost()); break;
+    case host_field_is_blacklisted: lua_push_bool_table_entry(vm, key, isBlacklisted()); break;
+    case host_field_asn:            lua_push_uint64_table_entry(vm, key, asn); break;
+    case host_field_asname:         lua_push_str_table_entry(vm, key, asname ? asname : (char*)""); break;
+    case host_field_country:        lua_push_str_table_entry(vm, key, get_country(buf, sizeof(buf))); break;
+    case host_field_os:             lua_push_str_table_entry(vm, key, get_os()); break;
+    case host_field_host_pool_id:   lua_push_uint64_table_entry(vm, key, host_pool_id); break;
+    case host_field_seen_first:     lua_push_uint64_table_entry(vm, key, first_seen); break;
+    case host_field_seen_last:      lua_push_uint64_table_entry(vm, key, last_seen); break;
+    case host_field_duration:       lua_push_uint64_table_entry(vm, key, get_duration()); break;
+    case host_field_bytes_sent:     lua_push_uint64_table_entry(vm, key, sent.getNumBytes()); break;
+    case host_field_bytes_rcvd:     lua_push_uint64_table_entry(vm, key, rcvd.getNumBytes()); break;
+    case host_field_packets_sent:   lua_push_uint64_table_entry(vm, key, sent.getNumPkts()); break;
+    case host_field_packets_rcvd:   lua_push_uint64_table_entry(vm, key, rcvd.getNumPkts()); break;
+    case host_field_throughput_bps: lua_push_float_table_entry(vm, key, bytes_thpt); break;
+    case host_field_throughput_pps: lua_push_float_table_entry(vm, key, pkts_thpt); break;
+    case host_field_active_flows_as_client: lua_push_uint64_table_entry(vm, key, num_active_flows_as_client); break;
+    case host_field_active_flows_as_server: lua_push_uint64_table_entry(vm, key, num_active_flows_as_server); break;
+    case host_field_num_alerts:     lua_push_uint64_table_entry(vm, key, triggerAlerts() ? getNumAlerts() : 0); break;
+    case host_field_anomalies:      if(hasAnomalies()) luaAnomalies(vm); break;
+    default: break;
+    }
+  }
+
+  return(true);
+}
+
+/* ***************************************** */
+
+/* Same key names of Host::lua() for the fields streamed to REST clients */
+void Host::writeJSON(JSONStream *s, bool host_details) {
+  char buf[64];
+  Mac *m = mac; /* Cache macs as they can be swapped/updated */
+
+  if(!isJSONWritable())
+    return; /* The listings skip these hosts */
+
+  s->beginObject();
+
+  s->addString("ip", printMask(buf, sizeof(buf)));
+  s->addUint64("vlan", get_vlan_id());
+  s->addUint64("ipkey", ip.key());
+  s->addString("name", get_visual_name(buf, sizeof(buf)));
+  s->addString("mac", Utils::formatMac(m ? m->get_mac() : NULL, buf, sizeof(buf)));
+  s->addBool("localhost", isLocalHost());
+  s->addBool("systemhost", isSystemHost());
+  s->addBool("is_blacklisted", isBlacklisted());
+  s->addUint64("asn", asn);
+  s->addString("asname", asname ? asname : (char*)"");
+  s->addString("country", get_country(buf, sizeof(buf)));
+  s->addString("os", get_os());
+  s->addUint64("host_pool_id", host_pool_id);
+  s->addUint64("seen.first", first_seen);
+  s->addUint64("seen.last", last_seen);
+  s->addUint64("bytes.sent", sent.getNumBytes());
+  s->addUint64("bytes.rcvd", rcvd.getNumBytes());
+  s->addUint64("packets.sent", sent.getNumPkts());
+  s->addUint64("packets.rcvd", rcvd.getNumPkts());
+  s->addFloat("throughput_bps", bytes_thpt);
+  s->addFloat("throughput_pps", pkts_thpt);
+  s->addUint64("active_flows.as_client", num_active_flows_as_client);
+  s->addUint64("active_flows.as_server", num_active_flows_as_server);
+  s->addUint64("num_alerts", triggerAlerts() ? getNumAlerts() : 0);
+
+  if(host_details) {
+    s->addUint64("ifid", iface->get_id());
+    s->addUint64("tcp.packets.retransmissions", tcpPacketStats.pktRetr);
+    s->addUint64("tcp.packets.out_of_order", tcpPacketStats.pktOOO);
+    s->addUint64("tcp.packets.lost", tcpPacketStats.pktLost);
+  }
+
+  s->endObject();
+}
+
+/* ***************************************** */
+
 /*
   As this method can be called from Lua, in order to avoid concurrency issues
   we need to lock/unlock
@@ -694,7 +832,7 @@ void Host::setName(char *name) {
 /* ***************************************** */
 
 char* Host::get_name(char *buf, u_int buf_len, bool force_resolution_if_not_found) {
-  char *addr, redis_buf[64];
+  char *addr, name_buf[64];
   int rc;
   time_t now = time(NULL);
 
@@ -712,11 +850,11 @@ char* Host::get_name(char *buf, u_int buf_len, bool force_resolution_if_not_foun
 
   if(readDHCPCache() && symbolic_name) return(symbolic_name);
 
-  rc = ntop->getRedis()->getAddress(addr, redis_buf, sizeof(redis_buf),
-				    force_resolution_if_not_found);
+  rc = ntop->getAddressResolution()->getAddress(addr, name_buf, sizeof(name_buf),
+						 force_resolution_if_not_found);
 
   if(rc == 0)
-    setName(redis_buf);
+    setName(name_buf);
   else
     setName(addr);
 
@@ -759,7 +897,7 @@ void Host::incStats(u_int32_t when, u_int8_t l4_proto, u_int ndpi_proto,
   if(sent_packets || rcvd_packets) {
     sent.incStats(sent_packets, sent_bytes), rcvd.incStats(rcvd_packets, rcvd_bytes);
 
-    if(ndpiStats) {
+    if(ndpiStats || (ndpiStats = new(std::nothrow) nDPIStats())) {
       ndpiStats->incStats(when, ndpi_proto, sent_packets, sent_bytes, rcvd_packets, rcvd_bytes),
 	ndpiStats->incCategoryStats(when,
 				    getInterface()->get_ndpi_proto_category(ndpi_proto),
@@ -883,7 +1021,7 @@ json_object* Host::getJSONObject(DetailsLevel details_level) {
     json_object_object_add(my_object, "num_alerts", json_object_new_int(triggerAlerts() ? getNumAlerts() : 0));
     json_object_object_add(my_object, "sent", sent.getJSONObject());
     json_object_object_add(my_object, "rcvd", rcvd.getJSONObject());
-    json_object_object_add(my_object, "ndpiStats", ndpiStats->getJSONObject(iface));
+    if(ndpiStats) json_object_object_add(my_object, "ndpiStats", ndpiStats->getJSONObject(iface));
     json_object_object_add(my_object, "total_activity_time", json_object_new_int(total_activity_time));
   }
 
@@ -957,17 +1095,17 @@ bool Host::addIfMatching(lua_State* vm, u_int8_t *_mac) {
 /* *************************************** */
 
 void Host::incNumFlows(bool as_client, Host *peer) {
-  AlertCounter *counter;
+  AlertCounter *counter = NULL;
 
   if(as_client) {
-    counter = flow_flood_attacker_alert;
+    if(triggerAlerts()) counter = getAlertCounter(&flow_flood_attacker_alert, flow_attacker_threshold);
     total_num_flows_as_client++, num_active_flows_as_client++;
   } else {
-    counter = flow_flood_victim_alert;
+    if(triggerAlerts()) counter = getAlertCounter(&flow_flood_victim_alert, flow_victim_threshold);
     total_num_flows_as_server++, num_active_flows_as_server++;
   }
 
-  if(triggerAlerts())
+  if(counter)
     counter->incHits(time(0));
 }
 
@@ -1125,7 +1263,8 @@ bool Host::serializeCheckpoint(json_object *my_object, DetailsLevel details_leve
   if (details_level >= details_high) {
     json_object_object_add(my_object, "total_activity_time", json_object_new_int(total_activity_time));
     json_object_object_add(my_object, "seen.last", json_object_new_int64(last_seen));
-    json_object_object_add(my_object, "ndpiStats", ndpiStats->getJSONObjectForCheckpoint(iface));
+    json_object_object_add(my_object, "ndpiStats",
+			   ndpiStats ? ndpiStats->getJSONObjectForCheckpoint(iface) : json_object_new_object());
     json_object_object_add(my_object, "flows.as_client", json_object_new_int(total_num_flows_as_client));
     json_object_object_add(my_object, "flows.as_server", json_object_new_int(total_num_flows_as_server));
   }
@@ -1273,48 +1412,48 @@ void Host::setMDSNInfo(char *str) {
 
 /* *************************************** */
 
-char* Host::get_country(char *buf, u_int buf_len) {
-  char *continent = NULL, *country_name = NULL, *city = NULL;
-  float latitude = 0, longitude = 0;
+const GeoInfo* Host::getGeoInfo() {
+  Geolocation *geo = ntop->getGeolocation();
 
-  ntop->getGeolocation()->getInfo(&ip, &continent, &country_name, &city, &latitude, &longitude);
+  /* MaxMind is only queried the first time and after a database reload */
+  if(geo)
+    geo->getInfo(&ip, &geo_info);
+
+  return(&geo_info);
+}
 
-  if(country_name)
-    snprintf(buf, buf_len, "%s", country_name);
+/* *************************************** */
+
+char* Host::get_country(char *buf, u_int buf_len) {
+  const GeoInfo *geo = getGeoInfo();
+
+  if(geo->country_code)
+    snprintf(buf, buf_len, "%s", geo->country_code);
   else
     buf[0] = '\0';
 
-  ntop->getGeolocation()->freeInfo(&continent, &country_name, &city);
-
   return(buf);
 }
 
 /* *************************************** */
 
 char* Host::get_city(char *buf, u_int buf_len) {
-  char *continent = NULL, *country_name = NULL, *city = NULL;
-  float latitude = 0, longitude = 0;
-
-  ntop->getGeolocation()->getInfo(&ip, &continent, &country_name, &city, &latitude, &longitude);
+  const GeoInfo *geo = getGeoInfo();
 
-  if(city) {
-    snprintf(buf, buf_len, "%s", city);
-  } else
+  if(geo->city)
+    snprintf(buf, buf_len, "%s", geo->city);
+  else
     buf[0] = '\0';
 
-  ntop->getGeolocation()->freeInfo(&continent, &country_name, &city);
-
   return(buf);
 }
 
 /* *************************************** */
 
 void Host::get_geocoordinates(float *latitude, float *longitude) {
-  char *continent = NULL, *country_name = NULL, *city = NULL;
+  const GeoInfo *geo = getGeoInfo();
 
-  *latitude = 0, *longitude = 0;
-  ntop->getGeolocation()->getInfo(&ip, &continent, &country_name, &city, latitude, longitude);
-  ntop->getGeolocation()->freeInfo(&continent, &country_name, &city);
+  *latitude = geo->latitude, *longitude = geo->longitude;
 }
 
 /* *************************************** */
@@ -30,8 +30,28 @@ HostHash::HostHash(NetworkInterface *_iface, u_int _num_hashes, u_int _max_hash_
 
 /* ************************************ */
 
+/* To be called with the bucket lock held */
+Host* HostHash::findInBucket(u_int32_t hash, u_int16_t vlanId, IpAddress *key) {
+  Host *head = (Host*)table[hash];
+
+  while(head != NULL) {
+    if((!head->idle())
+       && (!head->is_ready_to_be_purged())
+       && (head->get_vlan_id() == vlanId)
+       && (head->get_ip() != NULL)
+       && (head->get_ip()->compare(key) == 0))
+      break;
+    else
+      head = (Host*)head->next();
+  }
+
+  return(head);
+}
+
+/* ************************************ */
+
 Host* HostHash::get(u_int16_t vlanId, IpAddress *key) {
-  u_int32_t hash = (key->key() % num_hashes);
+  u_int32_t hash = (KeyedHash::combine(key->hash(), vlanId) % num_hashes);
 
   if(table[hash] == NULL) {
     return(NULL);
@@ -39,18 +59,7 @@ Host* HostHash::get(u_int16_t vlanId, IpAddress *key) {
     Host *head;
 
     locks[hash]->lock(__FILE__, __LINE__);
-    head = (Host*)table[hash];
-    
-    while(head != NULL) {      
-      if((!head->idle())
-	 && (!head->is_ready_to_be_purged())
-	 && (head->get_vlan_id() == vlanId)
-	 && (head->get_ip() != NULL)
-	 && (head->get_ip()->compare(key) == 0))
-	break;
-      else
-	head = (Host*)head->next();
-    }
+    head = findInBucket(hash, vlanId, key);
     locks[hash]->unlock(__FILE__, __LINE__);
 
     return(head);
@@ -59,6 +68,79 @@ Host* HostHash::get(u_int16_t vlanId, IpAddress *key) {
 
 /* ************************************ */
 
+typedef struct {
+  u_int32_t bucket, idx;
+} host_batch_key_t;
+
+static int cmp_batch_keys(const void *_a, const void *_b) {
+  const host_batch_key_t *a = (const host_batch_key_t*)_a, *b = (const host_batch_key_t*)_b;
+
+  if(a->bucket != b->bucket)
+    return((a->bucket < b->bucket) ? -1 : 1);
+
+  return((a->idx < b->idx) ? -1 : ((a->idx > b->idx) ? 1 : 0));
+}
+
+/*
+  Keys are sorted by bucket so that every bucket is locked once regardless
+  of the number of keys falling into it. NULL keys are skipped. Returns the
+  number of hosts found: hosts[i] is NULL when keys[i] is not found.
+*/
+u_int HostHash::getBatch(u_int num_keys, const u_int16_t *vlan_ids, IpAddress **keys, Host **hosts) {
+  host_batch_key_t *order;
+  u_int num_sorted = 0, num_found = 0;
+
+  for(u_int i = 0; i < num_keys; i++)
+    hosts[i] = NULL;
+
+  if((order = (host_batch_key_t*)malloc(num_keys * sizeof(host_batch_key_t))) == NULL) {
+    /* Fallback to single lookups */
+    for(u_int i = 0; i < num_keys; i++)
+      if(keys[i] && ((hosts[i] = get(vlan_ids[i], keys[i])) != NULL)) num_found++;
+
+    return(num_found);
+  }
+
+  for(u_int i = 0; i < num_keys; i++) {
+    if(keys[i]) {
+      order[num_sorted].bucket = KeyedHash::combine(keys[i]->hash(), vlan_ids[i]) % num_hashes;
+      order[num_sorted].idx = i;
+      num_sorted++;
+    }
+  }
+
+  qsort(order, num_sorted, sizeof(host_batch_key_t), cmp_batch_keys);
+
+  for(u_int i = 0; i < num_sorted; ) {
+    u_int32_t bucket = order[i].bucket;
+    u_int j = i;
+
+    while((j < num_sorted) && (order[j].bucket == bucket))
+      j++;
+
+    if(table[bucket] != NULL) {
+      locks[bucket]->lock(__FILE__, __LINE__);
+
+      for(u_int k = i; k < j; k++) {
+	u_int32_t idx = order[k].idx;
+
+	if((hosts[idx] = findInBucket(bucket, vlan_ids[idx], keys[idx])) != NULL)
+	  num_found++;
+      }
+
+      locks[bucket]->unlock(__FILE__, __LINE__);
+    }
+
+    i = j;
+  }
+
+  free(order);
+
+  return(num_found);
+}
+
+/* ************************************ */
+
 void HostHash::incNumHTTPEntries() {
   m.lock(__FILE__, __LINE__);
   num_http_hosts++; 
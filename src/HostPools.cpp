@@ -26,7 +26,10 @@
 /* *************************************** */
 
 HostPools::HostPools(NetworkInterface *_iface) {
-  tree = tree_shadow = NULL;
+  tree = NULL;
+  members_index = NULL, reload_epoch = 0;
+  num_full_reloads = num_incremental_reloads = last_reload_changes = 0;
+  last_reload_usec = max_reload_usec = 0;
 #ifdef NTOPNG_PRO
   children_safe = forge_global_dns = NULL;
   routing_policy_id = NULL;
@@ -44,7 +47,7 @@ HostPools::HostPools(NetworkInterface *_iface) {
 
   for(int i = 0; i < MAX_NUM_HOST_POOLS; i++) routing_policy_id[i] = DEFAULT_ROUTING_TABLE_ID;
 
-  stats = stats_shadow = NULL;
+  stats = NULL;
 
   if((volatile_members = (volatile_members_t**)calloc(MAX_NUM_HOST_POOLS, sizeof(volatile_members_t*))) == NULL
      || (volatile_members_lock            = new Mutex*[MAX_NUM_HOST_POOLS]) == NULL
@@ -63,11 +66,11 @@ HostPools::HostPools(NetworkInterface *_iface) {
   if((num_active_hosts_inline          = (int32_t*)calloc(sizeof(int32_t), MAX_NUM_HOST_POOLS)) == NULL
      || (num_active_hosts_offline      = (int32_t*)calloc(sizeof(int32_t), MAX_NUM_HOST_POOLS)) == NULL
      || (num_active_l2_devices_inline  = (int32_t*)calloc(sizeof(int32_t), MAX_NUM_HOST_POOLS)) == NULL
-     || (num_active_l2_devices_offline = (int32_t*)calloc(sizeof(int32_t), MAX_NUM_HOST_POOLS)) == NULL)
+     || (num_active_l2_devices_offline = (int32_t*)calloc(sizeof(int32_t), MAX_NUM_HOST_POOLS)) == NULL
+     || (pool_exists                   = (bool*)calloc(sizeof(bool), MAX_NUM_HOST_POOLS)) == NULL)
     throw 1;
 
-  latest_swap = 0;
-  if((swap_lock = new Mutex()) == NULL)
+  if((swap_lock = new Mutex()) == NULL || (reload_lock = new Mutex()) == NULL)
     throw 3;
 
   if(_iface)
@@ -114,9 +117,22 @@ HostPools::~HostPools() {
   if(num_active_l2_devices_offline)
     free(num_active_l2_devices_offline);
 
-  if(tree_shadow)   delete tree_shadow;
+  if(swap_lock) purgeRetired(0, true);
   if(tree)          delete tree;
   if(swap_lock)     delete swap_lock;
+  if(reload_lock)   delete reload_lock;
+
+  if(pool_exists) free(pool_exists);
+
+  if(members_index) {
+    pool_member_t *current, *tmp;
+
+    HASH_ITER(hh, members_index, current, tmp) {
+      HASH_DEL(members_index, current);
+      free(current->key);
+      free(current);
+    }
+  }
 
 #ifdef NTOPNG_PRO
   if(children_safe)     free(children_safe);
@@ -135,7 +151,6 @@ HostPools::~HostPools() {
     free(enforce_shapers_per_pool_member);
 
   if(stats)        deleteStats(&stats);
-  if(stats_shadow) deleteStats(&stats_shadow);
 
   if(volatile_members_lock) {
     for(int i = 0; i < MAX_NUM_HOST_POOLS; i++) {
@@ -168,25 +183,64 @@ HostPools::~HostPools() {
 
 /* *************************************** */
 
+void HostPools::retire(host_pools_retired_t *r, time_t now) {
+  r->retired_at = now;
+  retired.push_back(*r);
+  memset(r, 0, sizeof(*r));
+}
+
+/* *************************************** */
+
+void HostPools::purgeRetired(time_t now, bool all) {
+  while(!retired.empty()
+	&& (all || (now >= retired.front().retired_at + HOST_POOLS_RETIRE_GRACE_SECS))) {
+    host_pools_retired_t *r = &retired.front();
+
+    if(r->tree)      delete r->tree;
+    if(r->vlan_tree) delete r->vlan_tree;
+#ifdef NTOPNG_PRO
+    if(r->stats)     deleteStats(&r->stats);
+#endif
+
+    retired.pop_front();
+  }
+}
+
+/* *************************************** */
+
+/* Called by the housekeeping, so that retired objects don't wait for the next reload */
+void HostPools::purgeRetired() {
+  swap_lock->lock(__FILE__, __LINE__);
+  purgeRetired(time(NULL), false);
+  swap_lock->unlock(__FILE__, __LINE__);
+}
+
+/* *************************************** */
+
+/*
+  Publishes the new trees and stats. The replaced ones are not freed
+  right away, as lookups may still be using them, but retired and
+  freed HOST_POOLS_RETIRE_GRACE_SECS later by purgeRetired().
+*/
 #ifdef NTOPNG_PRO
-void HostPools::swap(VlanAddressTree *new_trees, HostPoolStats **new_stats) {
+void HostPools::swap(VlanAddressTree *new_trees, AddressTree **new_vlan_trees, HostPoolStats **new_stats) {
 #else
-void HostPools::swap(VlanAddressTree *new_trees) {
+void HostPools::swap(VlanAddressTree *new_trees, AddressTree **new_vlan_trees) {
 #endif
+  host_pools_retired_t r;
+  time_t now = time(NULL);
+
+  memset(&r, 0, sizeof(r));
   swap_lock->lock(__FILE__, __LINE__);
 
-  while(time(NULL) - latest_swap < 1) {
-    swap_lock->unlock(__FILE__, __LINE__);
-    sleep(1); /* Force at least 1 sec. time between consecutive swaps */
-    swap_lock->lock(__FILE__, __LINE__);
-  }
+  purgeRetired(now, false);
 
 #ifdef NTOPNG_PRO
   /* Swap statistics */
   if(new_stats) {
     if(stats) {
-      if(stats_shadow) deleteStats(&stats_shadow);
-      stats_shadow = stats;
+      r.stats = stats;
+      retire(&r, now);
     }
 
     stats = new_stats;
@@ -196,14 +250,27 @@ void HostPools::swap(VlanAddressTree *new_trees) {
   /* Swap address trees */
   if(new_trees) {
     if(tree) {
-      if(tree_shadow) delete tree_shadow;
-      tree_shadow = tree;
+      r.tree = tree;
+      retire(&r, now);
     }
 
     tree = new_trees;
   }
 
-  latest_swap = time(NULL);
+  /* Swap the modified per-VLAN trees */
+  if(new_vlan_trees && tree) {
+    for(int i = 0; i < MAX_NUM_VLAN; i++) {
+      if(new_vlan_trees[i]) {
+	AddressTree *old = tree->setAddressTree(i, new_vlan_trees[i]);
+
+	if(old) {
+	  r.vlan_tree = old;
+	  retire(&r, now);
+	}
+      }
+    }
+  }
+
   swap_lock->unlock(__FILE__, __LINE__);
 }
 
@@ -211,52 +278,25 @@ void HostPools::swap(VlanAddressTree *new_trees) {
 
 #ifdef NTOPNG_PRO
 
-void HostPools::reloadVolatileMembers(VlanAddressTree *_trees) {
+/* Drops the captive portal members of the pools that no longer exist */
+void HostPools::purgeRemovedPoolsVolatileMembers(pool_member_change_t **changes, u_int32_t *num_changes) {
   volatile_members_t *current, *tmp;
-  char *at, *member;
-  bool rc;
-  u_int16_t vlan_id;
-
-  if(!_trees)
-    return;
 
   for(int pool_id = 0; pool_id < MAX_NUM_HOST_POOLS; pool_id++) {
-
-    if(!volatile_members[pool_id])
+    if((!volatile_members[pool_id]) || pool_exists[pool_id])
       continue;
 
     volatile_members_lock[pool_id]->lock(__FILE__, __LINE__);
 
-    if(stats && stats[pool_id]) { /* The pool exists */
-      HASH_ITER(hh, volatile_members[pool_id], current, tmp) {
-	member = strdup(current->host_or_mac);
-
-	if((at = strchr(member, '@'))) {
-	  vlan_id = atoi(at + 1);
-	  *at = '\0';
-	} else
-	  vlan_id = 0;
-
-	if(!(rc = _trees->addAddress(vlan_id, member, pool_id))
-#ifdef HOST_POOLS_DEBUG
-	    || true
-#endif
-	     )
-	  ntop->getTrace()->traceEvent(TRACE_NORMAL,
-				       "%s VOLATILE tree node for %s [vlan %i] [host pool: %i]",
-				       rc ? "Successfully added" : "Unable to add",
-				       member, vlan_id,
-				       pool_id);
+    HASH_ITER(hh, volatile_members[pool_id], current, tmp) {
+      pool_member_t *m = getMember(current->host_or_mac, false);
 
+      if(m && (m->volatile_pool_id == pool_id))
+	setMemberPool(m, -1, true, changes, num_changes);
 
-	free(member);
-      }
-    } else { /* The pool no longer exists */
-      HASH_ITER(hh, volatile_members[pool_id], current, tmp) {
-	HASH_DEL(volatile_members[pool_id], current);
-	free(current->host_or_mac);
-	free(current);
-      }
+      HASH_DEL(volatile_members[pool_id], current);
+      free(current->host_or_mac);
+      free(current);
     }
 
     volatile_members_lock[pool_id]->unlock(__FILE__, __LINE__);
@@ -510,6 +550,10 @@ void HostPools::addToPool(char *host_or_mac,
 			  u_int16_t user_pool_id,
 			  int32_t lifetime_secs) {
   char key[128], pool_buf[16];
+  pool_member_change_t *changes = NULL;
+  u_int32_t num_changes = 0;
+  pool_member_t *m;
+  struct timeval begin;
 
 #ifdef HOST_POOLS_DEBUG
   ntop->getTrace()->traceEvent(TRACE_NORMAL,
@@ -519,6 +563,11 @@ void HostPools::addToPool(char *host_or_mac,
 			       user_pool_id);
 #endif
 
+  if(user_pool_id >= MAX_NUM_HOST_POOLS)
+    return;
+
+  gettimeofday(&begin, NULL);
+
   if(lifetime_secs > 0)
     addVolatileMember(host_or_mac, user_pool_id, (u_int32_t)lifetime_secs);
 
@@ -528,15 +577,28 @@ void HostPools::addToPool(char *host_or_mac,
     ntop->getRedis()->sadd(key, host_or_mac); /* New member added */
   }
 
-  reloadPools();
+  reload_lock->lock(__FILE__, __LINE__);
+
+  if((m = getMember(host_or_mac, true)) != NULL)
+    setMemberPool(m, user_pool_id, (lifetime_secs > 0), &changes, &num_changes);
+
+  applyChanges(changes, num_changes, false, &begin, NULL /* Pool stats unchanged */);
+
+  reload_lock->unlock(__FILE__, __LINE__);
 }
 
 /* *************************************** */
 
 void HostPools::purgeExpiredVolatileMembers() {
   volatile_members_t *current, *tmp;
+  pool_member_change_t *changes = NULL;
+  u_int32_t num_changes = 0;
   bool purged = false;
   time_t now = time(NULL);
+  struct timeval begin;
+
+  gettimeofday(&begin, NULL);
+  reload_lock->lock(__FILE__, __LINE__);
 
   for(int pool_id = 0; pool_id < MAX_NUM_HOST_POOLS; pool_id++) {
     volatile_members_lock[pool_id]->lock(__FILE__, __LINE__);
@@ -550,6 +612,11 @@ void HostPools::purgeExpiredVolatileMembers() {
 #endif
 
       if(current->lifetime < now) {
+	pool_member_t *m = getMember(current->host_or_mac, false);
+
+	if(m && (m->volatile_pool_id == pool_id))
+	  setMemberPool(m, -1, true, &changes, &num_changes);
+
 	purged = true;
 
 #ifdef HOST_POOLS_DEBUG
@@ -569,18 +636,25 @@ void HostPools::purgeExpiredVolatileMembers() {
   }
 
   if(purged)
-    reloadPools();
+    applyChanges(changes, num_changes, false, &begin, NULL /* Pool stats unchanged */);
+
+  reload_lock->unlock(__FILE__, __LINE__);
 }
 
 /* *************************************** */
 
 void HostPools::removeVolatileMemberFromPool(char *host_or_mac, u_int16_t user_pool_id) {
   volatile_members_t *m;
+  pool_member_change_t *changes = NULL;
+  u_int32_t num_changes = 0;
   bool purged = false;
+  struct timeval begin;
 
   if(user_pool_id == NO_HOST_POOL_ID || user_pool_id >= MAX_NUM_HOST_POOLS || !host_or_mac)
     return;
 
+  gettimeofday(&begin, NULL);
+  reload_lock->lock(__FILE__, __LINE__);
   volatile_members_lock[user_pool_id]->lock(__FILE__, __LINE__);
 
   HASH_FIND_STR(volatile_members[user_pool_id], host_or_mac, m);
@@ -593,8 +667,16 @@ void HostPools::removeVolatileMemberFromPool(char *host_or_mac, u_int16_t user_p
 
   volatile_members_lock[user_pool_id]->unlock(__FILE__, __LINE__);
 
-  if(purged)
-    reloadPools();
+  if(purged) {
+    pool_member_t *pm = getMember(host_or_mac, false);
+
+    if(pm && (pm->volatile_pool_id == user_pool_id))
+      setMemberPool(pm, -1, true, &changes, &num_changes);
+
+    applyChanges(changes, num_changes, false, &begin, NULL /* Pool stats unchanged */);
+  }
+
+  reload_lock->unlock(__FILE__, __LINE__);
 }
 
 #endif
@@ -639,47 +721,274 @@ void HostPools::lua(lua_State *vm) {
   lua_pushstring(vm, "num_members");
   lua_insert(vm, -2);
   lua_settable(vm, -3);
+
+  lua_newtable(vm);
+  lua_push_uint64_table_entry(vm, "num_full_reloads", num_full_reloads);
+  lua_push_uint64_table_entry(vm, "num_incremental_reloads", num_incremental_reloads);
+  lua_push_uint64_table_entry(vm, "last_reload_changes", last_reload_changes);
+  lua_push_uint64_table_entry(vm, "last_reload_usec", last_reload_usec);
+  lua_push_uint64_table_entry(vm, "max_reload_usec", max_reload_usec);
+
+  lua_pushstring(vm, "reload");
+  lua_insert(vm, -2);
+  lua_settable(vm, -3);
+}
+
+/* *************************************** */
+
+bool HostPools::parseMember(const char *member, char *addr, u_int addr_len, u_int16_t *vlan_id) {
+  const char *at = strchr(member, '@');
+  size_t len = at ? (size_t)(at - member) : strlen(member);
+
+  if((len == 0) || (len >= addr_len))
+    return(false);
+
+  memcpy(addr, member, len);
+  addr[len] = '\0';
+  *vlan_id = at ? atoi(at + 1) : 0;
+
+  return(*vlan_id < MAX_NUM_VLAN);
+}
+
+/* *************************************** */
+
+/* Members are indexed as <member>@<vlan> so that the same member is always found */
+pool_member_t* HostPools::getMember(const char *member, bool create) {
+  char addr[128], key[160];
+  u_int16_t vlan_id;
+  pool_member_t *m = NULL;
+
+  if(!member || !parseMember(member, addr, sizeof(addr), &vlan_id))
+    return(NULL);
+
+  snprintf(key, sizeof(key), "%s@%u", addr, vlan_id);
+  HASH_FIND_STR(members_index, key, m);
+
+  if((m == NULL) && create) {
+    if((m = (pool_member_t*)calloc(1, sizeof(pool_member_t))) == NULL)
+      return(NULL);
+
+    if((m->key = strdup(key)) == NULL) {
+      free(m);
+      return(NULL);
+    }
+
+    m->pool_id = m->volatile_pool_id = m->reload_pool_id = -1;
+    HASH_ADD_KEYPTR(hh, members_index, m->key, strlen(m->key), m);
+  }
+
+  return(m);
+}
+
+/* *************************************** */
+
+int32_t HostPools::getEffectivePool(const pool_member_t *m) const {
+#ifdef NTOPNG_PRO
+  /* Captive portal members override the permanent ones */
+  if((m->volatile_pool_id != -1) && ntop->getPrefs()->isCaptivePortalEnabled())
+    return(m->volatile_pool_id);
+#endif
+
+  return(m->pool_id);
+}
+
+/* *************************************** */
+
+/* Note: m is freed when it is no longer a member of any pool */
+void HostPools::setMemberPool(pool_member_t *m, int32_t pool_id, bool is_volatile,
+			      pool_member_change_t **changes, u_int32_t *num_changes) {
+  int32_t old_pool_id = getEffectivePool(m), new_pool_id;
+
+  if(is_volatile)
+    m->volatile_pool_id = pool_id;
+  else
+    m->pool_id = pool_id;
+
+  if((new_pool_id = getEffectivePool(m)) != old_pool_id) {
+    bool full = false;
+
+    /* The changes array is grown in powers of two, starting from 8 entries */
+    if((*num_changes == 0) || ((*num_changes >= 8) && ((*num_changes & (*num_changes - 1)) == 0))) {
+      u_int32_t new_size = (*num_changes == 0) ? 8 : (*num_changes * 2);
+      pool_member_change_t *c = (pool_member_change_t*)realloc(*changes, new_size * sizeof(pool_member_change_t));
+
+      if(c == NULL) {
+	ntop->getTrace()->traceEvent(TRACE_ERROR, "Not enough memory");
+	full = true;
+      } else
+	*changes = c;
+    }
+
+    if(!full) {
+      pool_member_change_t *c = &(*changes)[*num_changes];
+
+      if((c->key = strdup(m->key)) != NULL) {
+	c->pool_id = new_pool_id;
+	(*num_changes)++;
+      }
+    }
+
+#ifdef HOST_POOLS_DEBUG
+    ntop->getTrace()->traceEvent(TRACE_NORMAL, "Pool member %s changed [host pool: %i -> %i]",
+				 m->key, old_pool_id, new_pool_id);
+#endif
+  }
+
+  if((m->pool_id == -1) && (m->volatile_pool_id == -1)) {
+    HASH_DEL(members_index, m);
+    free(m->key);
+    free(m);
+  }
+}
+
+/* *************************************** */
+
+/* To be called with reload_lock held: changes are consumed and freed */
+#ifdef NTOPNG_PRO
+void HostPools::applyChanges(pool_member_change_t *changes, u_int32_t num_changes,
+			     bool full_refresh, struct timeval *begin, HostPoolStats **new_stats) {
+#else
+void HostPools::applyChanges(pool_member_change_t *changes, u_int32_t num_changes,
+			     bool full_refresh, struct timeval *begin) {
+#endif
+  VlanAddressTree *new_tree = NULL;
+  AddressTree **new_vlan_trees = NULL;
+  char addr[128];
+  u_int16_t vlan_id;
+  struct timeval end;
+  u_int32_t usec;
+
+  if(tree == NULL) {
+    /* First load: build all the trees from the index */
+    pool_member_t *m, *tmp;
+
+    if((new_tree = new(std::nothrow) VlanAddressTree()) == NULL) {
+      ntop->getTrace()->traceEvent(TRACE_ERROR, "Not enough memory");
+      goto out;
+    }
+
+    HASH_ITER(hh, members_index, m, tmp) {
+      int32_t pool_id = getEffectivePool(m);
+
+      if((pool_id != -1) && parseMember(m->key, addr, sizeof(addr), &vlan_id)
+	 && !new_tree->addAddress(vlan_id, addr, pool_id))
+	ntop->getTrace()->traceEvent(TRACE_NORMAL, "Unable to add tree node for %s [host pool: %i]",
+				     m->key, pool_id);
+    }
+
+    new_tree->compile();
+    full_refresh = true;
+  } else if(num_changes > 0) {
+    /* Copy-on-write: only the trees of the changed VLANs are cloned */
+    if((new_vlan_trees = (AddressTree**)calloc(MAX_NUM_VLAN, sizeof(AddressTree*))) == NULL) {
+      ntop->getTrace()->traceEvent(TRACE_ERROR, "Not enough memory");
+      goto out;
+    }
+
+    for(u_int32_t i = 0; i < num_changes; i++) {
+      AddressTree *cur;
+      char buf[sizeof(addr)];
+
+      if(!parseMember(changes[i].key, addr, sizeof(addr), &vlan_id))
+	continue;
+
+      if(new_vlan_trees[vlan_id] == NULL) {
+	cur = tree->getAddressTree(vlan_id);
+
+	if((new_vlan_trees[vlan_id] = (cur ? new(std::nothrow) AddressTree(*cur)
+				       : new(std::nothrow) AddressTree())) == NULL)
+	  continue;
+      }
+
+      /* Note: the address is parsed in place */
+      snprintf(buf, sizeof(buf), "%s", addr);
+      new_vlan_trees[vlan_id]->removeAddress(buf);
+
+      if(changes[i].pool_id != -1)
+	new_vlan_trees[vlan_id]->addAddress(addr, changes[i].pool_id);
+    }
+
+    for(int i = 0; i < MAX_NUM_VLAN; i++)
+      if(new_vlan_trees[i]) new_vlan_trees[i]->compile();
+  }
+
+#ifdef NTOPNG_PRO
+  if(new_tree || new_vlan_trees || new_stats)
+    swap(new_tree, new_vlan_trees, new_stats);
+#else
+  if(new_tree || new_vlan_trees)
+    swap(new_tree, new_vlan_trees);
+#endif
+
+  if(iface) {
+    if(full_refresh)
+      iface->refreshHostPools();
+    else if(num_changes > 0) {
+      iface->refreshHostPools(changes, num_changes);
+
+#ifdef HAVE_NEDGE
+      /* Note: we must re-evaluate the active flows as a captive portal host may be blocked now */
+      if(iface->getIfType() == interface_type_NETFILTER)
+	((NetfilterInterface *) iface)->setPolicyChanged();
+#endif
+    }
+  }
+
+  gettimeofday(&end, NULL);
+  usec = (end.tv_sec - begin->tv_sec) * 1000000 + (end.tv_usec - begin->tv_usec);
+
+  if(full_refresh) num_full_reloads++; else num_incremental_reloads++;
+  last_reload_changes = num_changes, last_reload_usec = usec;
+  if(usec > max_reload_usec) max_reload_usec = usec;
+
+#ifdef HOST_POOLS_DEBUG
+  ntop->getTrace()->traceEvent(TRACE_NORMAL, "Host pools %s reload [changes: %u][latency: %u usec]",
+			       full_refresh ? "full" : "incremental", num_changes, usec);
+#endif
+
+ out:
+  if(new_vlan_trees) free(new_vlan_trees);
+
+  if(changes) {
+    for(u_int32_t i = 0; i < num_changes; i++)
+      free(changes[i].key);
+
+    free(changes);
+  }
 }
 
 /* *************************************** */
 
 void HostPools::reloadPools() {
   char kname[CONST_MAX_LEN_REDIS_KEY];
-  char **pools, **pool_members, *at, *member;
+  char **pools, **pool_members, *member;
   int num_pools, num_members, actual_num_members;
-  u_int16_t _pool_id, vlan_id;
-  VlanAddressTree *new_tree;
+  u_int16_t _pool_id;
+  bool *new_pool_exists, pools_changed = false, settings_changed = false;
+  pool_member_change_t *changes = NULL;
+  u_int32_t num_changes = 0;
+  pool_member_t *m, *tmp;
+  struct timeval begin;
 #ifdef NTOPNG_PRO
-  HostPoolStats **new_stats;
+  HostPoolStats **new_stats = NULL;
 #endif
   Redis *redis = ntop->getRedis();
 
   if(!iface || (iface->get_id() == -1))
     return;
 
-  if((new_tree = new VlanAddressTree) == NULL
-#ifdef NTOPNG_PRO
-     || (new_stats = new HostPoolStats*[MAX_NUM_HOST_POOLS]) == NULL
-#endif
-     ) {
+  if((new_pool_exists = (bool*)calloc(MAX_NUM_HOST_POOLS, sizeof(bool))) == NULL) {
     ntop->getTrace()->traceEvent(TRACE_ERROR, "Not enough memory");
     return;
   }
 
-#ifdef NTOPNG_PRO
-  for(u_int32_t i = 0; i < MAX_NUM_HOST_POOLS; i++)
-    new_stats[i] = NULL;
-#endif
+  gettimeofday(&begin, NULL);
+  reload_lock->lock(__FILE__, __LINE__);
 
-  snprintf(kname, sizeof(kname), HOST_POOL_IDS_KEY, iface->get_id());
+  reload_epoch++;
+  new_pool_exists[0] = true; /* The default pool always exists */
 
-#ifdef NTOPNG_PRO
-  /* Always allocate default pool stats */
-  if(stats && stats[0]) /* Duplicate existing statistics */
-    new_stats[0] = new HostPoolStats(*stats[0]);
-  else /* Brand new statistics */
-    new_stats[0] = new HostPoolStats(iface);
-#endif
+  snprintf(kname, sizeof(kname), HOST_POOL_IDS_KEY, iface->get_id());
 
   /* Keys are pool ids */
   num_pools = redis->smembers(kname, &pools);
@@ -693,37 +1002,49 @@ void HostPools::reloadPools() {
       ntop->getTrace()->traceEvent(TRACE_WARNING, "Ignoring pool [pool id: %2d]. "
 				   "Maximum number of host pools for this license is %u, inclusive of the Not Assigned pool.",
 				   _pool_id, MAX_NUM_HOST_POOLS);
+      free(pools[i]);
       continue;
     }
 
-#ifdef NTOPNG_PRO
-    if(_pool_id != 0) { /* Pool id 0 stats already updated */
-      if(stats && stats[_pool_id]) /* Duplicate existing statistics */
-	new_stats[_pool_id] = new HostPoolStats(*stats[_pool_id]);
-      else /* Brand new statistics */
-	new_stats[_pool_id] = new HostPoolStats(iface);
-    }
-#endif
-
+    new_pool_exists[_pool_id] = true;
     snprintf(kname, sizeof(kname), HOST_POOL_DETAILS_KEY, iface->get_id(), _pool_id);
 
 #ifdef NTOPNG_PRO
     char rsp[16] = { 0 };
-
-    children_safe[_pool_id] = ((redis->hashGet(kname, (char*)CONST_CHILDREN_SAFE, rsp, sizeof(rsp)) != -1)
+    bool _children_safe, _forge_global_dns, _enforce_quotas, _enforce_shapers;
+    u_int8_t _routing_policy_id;
+    u_int16_t _pool_shaper;
+    u_int32_t _schedule_bitmap;
+
+    _children_safe = ((redis->hashGet(kname, (char*)CONST_CHILDREN_SAFE, rsp, sizeof(rsp)) != -1)
+		      && (!strcmp(rsp, "true")));
+    _forge_global_dns = ((redis->hashGet(kname, (char*)CONST_FORGE_GLOBAL_DNS, rsp, sizeof(rsp)) != -1)
+			 && (!strcmp(rsp, "true")));
+    _routing_policy_id = (redis->hashGet(kname, (char*)CONST_ROUTING_POLICY_ID, rsp, sizeof(rsp)) != -1) ? atoi(rsp) : DEFAULT_ROUTING_TABLE_ID;
+    _pool_shaper = (redis->hashGet(kname, (char*)CONST_POOL_SHAPER_ID, rsp, sizeof(rsp)) != -1) ? atoi(rsp) : DEFAULT_SHAPER_ID;
+    _schedule_bitmap = (redis->hashGet(kname, (char*)CONST_SCHEDULE_BITMAP, rsp, sizeof(rsp)) != -1) ? strtol(rsp, NULL, 16) : DEFAULT_TIME_SCHEDULE;
+    _enforce_quotas = ((redis->hashGet(kname, (char*)CONST_ENFORCE_QUOTAS_PER_POOL_MEMBER, rsp, sizeof(rsp)) != -1)
+		       && (!strcmp(rsp, "true")));
+    _enforce_shapers = ((redis->hashGet(kname, (char*)CONST_ENFORCE_SHAPERS_PER_POOL_MEMBER, rsp, sizeof(rsp)) != -1)
 			&& (!strcmp(rsp, "true")));
 
-    forge_global_dns[_pool_id] = ((redis->hashGet(kname, (char*)CONST_FORGE_GLOBAL_DNS, rsp, sizeof(rsp)) != -1)
-    			&& (!strcmp(rsp, "true")));
-
-    routing_policy_id[_pool_id] = (redis->hashGet(kname, (char*)CONST_ROUTING_POLICY_ID, rsp, sizeof(rsp)) != -1) ? atoi(rsp) : DEFAULT_ROUTING_TABLE_ID;
-    pool_shaper[_pool_id] = (redis->hashGet(kname, (char*)CONST_POOL_SHAPER_ID, rsp, sizeof(rsp)) != -1) ? atoi(rsp) : DEFAULT_SHAPER_ID;
-    schedule_bitmap[_pool_id] = (redis->hashGet(kname, (char*)CONST_SCHEDULE_BITMAP, rsp, sizeof(rsp)) != -1) ? strtol(rsp, NULL, 16) : DEFAULT_TIME_SCHEDULE;
-
-    enforce_quotas_per_pool_member[_pool_id]   = ((redis->hashGet(kname, (char*)CONST_ENFORCE_QUOTAS_PER_POOL_MEMBER, rsp, sizeof(rsp)) != -1)
-					 && (!strcmp(rsp, "true")));;
-    enforce_shapers_per_pool_member[_pool_id]   = ((redis->hashGet(kname, (char*)CONST_ENFORCE_SHAPERS_PER_POOL_MEMBER, rsp, sizeof(rsp)) != -1)
-					 && (!strcmp(rsp, "true")));;
+    /* Pool settings changes require all the hosts to be refreshed */
+    if((children_safe[_pool_id] != _children_safe)
+       || (forge_global_dns[_pool_id] != _forge_global_dns)
+       || (routing_policy_id[_pool_id] != _routing_policy_id)
+       || (pool_shaper[_pool_id] != _pool_shaper)
+       || (schedule_bitmap[_pool_id] != _schedule_bitmap)
+       || (enforce_quotas_per_pool_member[_pool_id] != _enforce_quotas)
+       || (enforce_shapers_per_pool_member[_pool_id] != _enforce_shapers))
+      settings_changed = true;
+
+    children_safe[_pool_id] = _children_safe;
+    forge_global_dns[_pool_id] = _forge_global_dns;
+    routing_policy_id[_pool_id] = _routing_policy_id;
+    pool_shaper[_pool_id] = _pool_shaper;
+    schedule_bitmap[_pool_id] = _schedule_bitmap;
+    enforce_quotas_per_pool_member[_pool_id] = _enforce_quotas;
+    enforce_shapers_per_pool_member[_pool_id] = _enforce_shapers;
 
 #ifdef HOST_POOLS_DEBUG
     redis->hashGet(kname, (char*)"name", rsp, sizeof(rsp));
@@ -756,30 +1077,13 @@ void HostPools::reloadPools() {
 				     _pool_id, num_members, actual_num_members, num_members - actual_num_members, actual_num_members);
       }
 
-      for(int k = 0; k < actual_num_members; k++) {
-	member = pool_members[k];
+      for(int k = 0; k < num_members; k++) {
+	if(!(member = pool_members[k]))
+	  continue;
 
-	if(!member) continue;
-
-	if((at = strchr(member, '@'))) {
-	  vlan_id = atoi(at + 1);
-	  *at = '\0';
-	} else
-	  vlan_id = 0;
-
-	bool rc;
-
-	if(!(rc = new_tree->addAddress(vlan_id, member, _pool_id))
-#ifdef HOST_POOLS_DEBUG
-	    || true
-#endif
-	     )
-
-	  ntop->getTrace()->traceEvent(TRACE_NORMAL,
-				       "%s tree node for %s [vlan %i] [host pool: %s]",
-				       rc ? "Successfully added" : "Unable to add",
-				       member, vlan_id,
-				       pools[i]);
+	/* Mark the members found in this reload: the others are removed below */
+	if((k < actual_num_members) && ((m = getMember(member, true)) != NULL))
+	  m->reload_pool_id = _pool_id, m->reload_epoch = reload_epoch;
 
 	free(member);
       }
@@ -792,15 +1096,48 @@ void HostPools::reloadPools() {
 
   if(pools) free(pools);
 
+  /* Diff the configuration against the index */
+  HASH_ITER(hh, members_index, m, tmp) {
+    int32_t pool_id = (m->reload_epoch == reload_epoch) ? m->reload_pool_id : -1;
+
+    if(pool_id != m->pool_id)
+      setMemberPool(m, pool_id, false /* permanent */, &changes, &num_changes);
+  }
+
+  for(int i = 0; i < MAX_NUM_HOST_POOLS; i++) {
+    if(new_pool_exists[i] != pool_exists[i])
+      pools_changed = true;
+
+    pool_exists[i] = new_pool_exists[i];
+  }
+
+  free(new_pool_exists);
+
 #ifdef NTOPNG_PRO
-  if(ntop->getPrefs()->isCaptivePortalEnabled())
-    reloadVolatileMembers(new_tree /* Reload only on the new */);
-  swap(new_tree, new_stats);
+  if(pools_changed)
+    purgeRemovedPoolsVolatileMembers(&changes, &num_changes);
+
+  /* Pool statistics are rebuilt only when pools are added or removed */
+  if(pools_changed || !stats) {
+    if((new_stats = new(std::nothrow) HostPoolStats*[MAX_NUM_HOST_POOLS]) != NULL) {
+      for(u_int32_t i = 0; i < MAX_NUM_HOST_POOLS; i++) {
+	if(!pool_exists[i])
+	  new_stats[i] = NULL;
+	else if(stats && stats[i]) /* Duplicate existing statistics */
+	  new_stats[i] = new HostPoolStats(*stats[i]);
+	else /* Brand new statistics */
+	  new_stats[i] = new HostPoolStats(iface);
+      }
+    } else
+      ntop->getTrace()->traceEvent(TRACE_ERROR, "Not enough memory");
+  }
+
+  applyChanges(changes, num_changes, pools_changed || settings_changed, &begin, new_stats);
 #else
-  swap(new_tree);
+  applyChanges(changes, num_changes, pools_changed || settings_changed, &begin);
 #endif
 
-  iface->refreshHostPools();
+  reload_lock->unlock(__FILE__, __LINE__);
 }
 
 /* *************************************** */
@@ -842,6 +1179,28 @@ bool HostPools::findIpPool(IpAddress *ip, u_int16_t vlan_id, u_int16_t *found_po
   if(!tree || !(cur_tree = tree))
     return(false);
 
+  if(found_node == NULL) {
+    /* Fast path: the matched prefix is not needed, use the compiled tree */
+    AddressTree *t = cur_tree->getAddressTree(vlan_id);
+    int16_t pool_id;
+
+    if(t == NULL)
+      return(false);
+
+    if(ip->isIPv4()) {
+      u_int32_t v4 = ip->get_ipv4();
+
+      pool_id = t->findAddress(AF_INET, &v4);
+    } else
+      pool_id = t->findAddress(AF_INET6, ip->get_ipv6());
+
+    if(pool_id == -1)
+      return(false);
+
+    *found_pool = (u_int16_t)pool_id;
+    return(true);
+  }
+
   *found_node = (patricia_node_t*)ip->findAddress(cur_tree->getAddressTree(vlan_id));
 
   if(*found_node) {
@@ -861,7 +1220,6 @@ bool HostPools::findIpPool(IpAddress *ip, u_int16_t vlan_id, u_int16_t *found_po
 
 u_int16_t HostPools::getPool(Host *h) {
   u_int16_t pool_id;
-  patricia_node_t *node;
   bool found = false;
 
   if(h) {
@@ -869,7 +1227,7 @@ u_int16_t HostPools::getPool(Host *h) {
       found = findMacPool(h->getMac(), &pool_id);
 
     if(!found && h->get_ip()) {
-      found = findIpPool(h->get_ip(), h->get_vlan_id(), &pool_id, &node);
+      found = findIpPool(h->get_ip(), h->get_vlan_id(), &pool_id, NULL /* matched node not needed */);
     }
   }
 
@@ -24,7 +24,7 @@
 /* ******************************************* */
 
 IpAddress::IpAddress() {
-  ip_key = 0;
+  ip_key = 0, ip_hash = 0;
   memset(&addr, 0, sizeof(addr));
   compute_key();
 }
@@ -58,6 +58,8 @@ void IpAddress::set(union usa *ip) {
     addr.ipVersion = 6, addr.localHost = 0;
   }
 #endif
+
+  compute_key();
 }
 
 /* ******************************************* */
@@ -174,18 +176,24 @@ bool IpAddress::isLocalInterfaceAddress() {
 /* ******************************************* */
 
 void IpAddress::compute_key() {
-  if(ip_key != 0) return; /* Already computed */
-
   checkIP();
 
+  /*
+    ip_key keeps the numeric ordering used by the GUI (e.g. sort by IP)
+    whereas ip_hash is the seeded, well-mixed value used to pick hash buckets
+  */
   if(addr.ipVersion == 4) {
     ip_key = ntohl(addr.ipType.ipv4);
+    ip_hash = KeyedHash::hashBytes(&addr.ipType.ipv4, sizeof(addr.ipType.ipv4));
   } else if(addr.ipVersion == 6) {
     ip_key = 0;
 
     for(u_int32_t i=0; i<4; i++)
       ip_key += addr.ipType.ipv6.u6_addr.u6_addr32[i];
-  }
+
+    ip_hash = KeyedHash::hashBytes(&addr.ipType.ipv6, sizeof(addr.ipType.ipv6));
+  } else
+    ip_hash = 0;
 }
 
 /* ******************************************* */
@@ -301,7 +309,12 @@ json_object* IpAddress::getJSONObject() {
 bool IpAddress::match(AddressTree *tree) {
   if(tree == NULL)
     return(true);
-  else {
+  else if(tree->isCompiled()) {
+    if(addr.ipVersion == 4)
+      return((tree->findAddress(AF_INET, (void*)&addr.ipType.ipv4) == -1) ? false : true);
+    else
+      return((tree->findAddress(AF_INET6, (void*)&addr.ipType.ipv6) == -1) ? false : true);
+  } else {
     patricia_tree_t *ptree = tree->getTree((addr.ipVersion == 4) ? true : false);
     patricia_node_t *node;
 
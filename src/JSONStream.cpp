@@ -0,0 +1,230 @@
+/*
+ *
+ * (C) 2019 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+
+#include "ntop_includes.h"
+
+/* ******************************************* */
+
+JSONStream::JSONStream(struct mg_connection *_conn) {
+  conn = _conn;
+  buf_len = 0, num_bytes_written = 0, depth = 0, holding = false;
+  need_comma[0] = false;
+}
+
+/* ******************************************* */
+
+JSONStream::~JSONStream() {
+  release();
+  flush();
+}
+
+/* ******************************************* */
+
+void JSONStream::flush() {
+  if(buf_len > 0) {
+    if(holding)
+      held.append(buf, buf_len);
+    else if(conn)
+      mg_write(conn, buf, buf_len);
+
+    num_bytes_written += buf_len;
+    buf_len = 0;
+  }
+}
+
+/* ******************************************* */
+
+void JSONStream::release() {
+  holding = false;
+
+  if(!held.empty()) {
+    if(conn) mg_write(conn, held.data(), held.size());
+    held.clear();
+  }
+
+  /* The buffer content, if any, follows the held output */
+}
+
+/* ******************************************* */
+
+void JSONStream::write(const char *data, u_int32_t len) {
+  while(len > 0) {
+    u_int32_t avail = sizeof(buf) - buf_len;
+    u_int32_t to_copy = ndpi_min(avail, len);
+
+    memcpy(&buf[buf_len], data, to_copy);
+    buf_len += to_copy, data += to_copy, len -= to_copy;
+
+    if(buf_len == sizeof(buf))
+      flush();
+  }
+}
+
+/* ******************************************* */
+
+void JSONStream::writeEscaped(const char *str) {
+  const char *begin = str;
+  char esc[8];
+
+  write("\"", 1);
+
+  for(; *str; str++) {
+    u_char c = (u_char)*str;
+
+    if((c >= 0x20) && (c != '"') && (c != '\\'))
+      continue;
+
+    if(str > begin) write(begin, str - begin);
+
+    switch(c) {
+    case '"':  write("\\\"", 2); break;
+    case '\\': write("\\\\", 2); break;
+    case '\n': write("\\n", 2);  break;
+    case '\r': write("\\r", 2);  break;
+    case '\t': write("\\t", 2);  break;
+    default:
+      snprintf(esc, sizeof(esc), "\\u%04x", c);
+      write(esc, 6);
+      break;
+    }
+
+    begin = str + 1;
+  }
+
+  if(str > begin) write(begin, str - begin);
+
+  write("\"", 1);
+}
+
+/* ******************************************* */
+
+void JSONStream::separator() {
+  if(need_comma[depth])
+    write(",", 1);
+  else
+    need_comma[depth] = true;
+}
+
+/* ******************************************* */
+
+void JSONStream::key(const char *k) {
+  separator();
+
+  if(k) {
+    writeEscaped(k);
+    write(":", 1);
+  }
+}
+
+/* ******************************************* */
+
+void JSONStream::beginObject(const char *k) {
+  key(k);
+  write("{", 1);
+
+  if(depth < JSON_STREAM_MAX_DEPTH - 1)
+    need_comma[++depth] = false;
+}
+
+/* ******************************************* */
+
+void JSONStream::endObject() {
+  if(depth > 0) depth--;
+  write("}", 1);
+}
+
+/* ******************************************* */
+
+void JSONStream::beginArray(const char *k) {
+  key(k);
+  write("[", 1);
+
+  if(depth < JSON_STREAM_MAX_DEPTH - 1)
+    need_comma[++depth] = false;
+}
+
+/* ******************************************* */
+
+void JSONStream::endArray() {
+  if(depth > 0) depth--;
+  write("]", 1);
+}
+
+/* ******************************************* */
+
+void JSONStream::addString(const char *k, const char *value) {
+  key(k);
+
+  if(value)
+    writeEscaped(value);
+  else
+    write("null", 4);
+}
+
+/* ******************************************* */
+
+void JSONStream::addUint64(const char *k, u_int64_t value) {
+  char num[32];
+  int len = snprintf(num, sizeof(num), "%llu", (unsigned long long)value);
+
+  key(k);
+  write(num, len);
+}
+
+/* ******************************************* */
+
+void JSONStream::addInt64(const char *k, int64_t value) {
+  char num[32];
+  int len = snprintf(num, sizeof(num), "%lld", (long long)value);
+
+  key(k);
+  write(num, len);
+}
+
+/* ******************************************* */
+
+void JSONStream::addFloat(const char *k, float value) {
+  char num[32];
+  int len;
+
+  /* NaN and infinity are not valid JSON numbers */
+  if(isnan(value) || isinf(value))
+    value = 0;
+
+  len = snprintf(num, sizeof(num), "%.2f", value);
+  key(k);
+  write(num, len);
+}
+
+/* ******************************************* */
+
+void JSONStream::addBool(const char *k, bool value) {
+  key(k);
+  write(value ? "true" : "false", value ? 4 : 5);
+}
+
+/* ******************************************* */
+
+void JSONStream::addNull(const char *k) {
+  key(k);
+  write("null", 4);
+}
@@ -0,0 +1,103 @@
+/*
+ *
+ * (C) 2019 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+
+#include "ntop_includes.h"
+
+u_int64_t KeyedHash::k0 = 0, KeyedHash::k1 = 0;
+
+#define SIP_ROTL(x, b) (u_int64_t)(((x) << (b)) | ((x) >> (64 - (b))))
+
+#define SIP_ROUND					\
+  do {							\
+    v0 += v1, v1 = SIP_ROTL(v1, 13), v1 ^= v0;		\
+    v0 = SIP_ROTL(v0, 32);				\
+    v2 += v3, v3 = SIP_ROTL(v3, 16), v3 ^= v2;		\
+    v0 += v3, v3 = SIP_ROTL(v3, 21), v3 ^= v0;		\
+    v2 += v1, v1 = SIP_ROTL(v1, 17), v1 ^= v2;		\
+    v2 = SIP_ROTL(v2, 32);				\
+  } while(0)
+
+/* ******************************************* */
+
+void KeyedHash::initSeed() {
+  u_int64_t seed[2];
+  bool seeded = false;
+#ifndef WIN32
+  FILE *fd = fopen("/dev/urandom", "r");
+
+  if(fd) {
+    seeded = (fread(seed, sizeof(seed), 1, fd) == 1);
+    fclose(fd);
+  }
+#endif
+
+  if(!seeded) {
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    seed[0] = ((u_int64_t)tv.tv_sec << 32) ^ (u_int64_t)tv.tv_usec ^ (u_int64_t)getpid();
+    seed[1] = ((u_int64_t)(uintptr_t)&tv) ^ ((u_int64_t)tv.tv_usec << 40) ^ (u_int64_t)clock();
+  }
+
+  k0 = seed[0], k1 = seed[1];
+}
+
+/* ******************************************* */
+
+u_int32_t KeyedHash::hashBytes(const void *data, u_int32_t len) {
+  const u_int8_t *in = (const u_int8_t*)data;
+  const u_int8_t *end = in + (len & ~7);
+  u_int64_t v0 = k0 ^ 0x736f6d6570736575ULL, v1 = k1 ^ 0x646f72616e646f6dULL;
+  u_int64_t v2 = k0 ^ 0x6c7967656e657261ULL, v3 = k1 ^ 0x7465646279746573ULL;
+  u_int64_t m, b = ((u_int64_t)len) << 56;
+
+  for(; in != end; in += 8) {
+    memcpy(&m, in, sizeof(m));
+    v3 ^= m;
+    SIP_ROUND;
+    v0 ^= m;
+  }
+
+  switch(len & 7) {
+  case 7: b |= ((u_int64_t)in[6]) << 48; /* fall through */
+  case 6: b |= ((u_int64_t)in[5]) << 40; /* fall through */
+  case 5: b |= ((u_int64_t)in[4]) << 32; /* fall through */
+  case 4: b |= ((u_int64_t)in[3]) << 24; /* fall through */
+  case 3: b |= ((u_int64_t)in[2]) << 16; /* fall through */
+  case 2: b |= ((u_int64_t)in[1]) << 8;  /* fall through */
+  case 1: b |= ((u_int64_t)in[0]);
+    break;
+  }
+
+  v3 ^= b;
+  SIP_ROUND;
+  v0 ^= b;
+
+  v2 ^= 0xff;
+  SIP_ROUND;
+  SIP_ROUND;
+  SIP_ROUND;
+
+  b = v0 ^ v1 ^ v2 ^ v3;
+
+  return(fold(b));
+}
@@ -0,0 +1,95 @@
+/*
+ *
+ * (C) 2019 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+
+
+
+#include "ntop_includes.h"
+
+/* **************************************************** */
+
+LiveCaptureRing::LiveCaptureRing(u_int32_t _size) {
+  size = 1;
+  while(size < _size) size <<= 1;
+  mask = size - 1, head = tail = 0;
+
+  if((buffer = (u_char*)malloc(size)) == NULL)
+    throw "Not enough memory";
+}
+
+/* **************************************************** */
+
+LiveCaptureRing::~LiveCaptureRing() {
+  free(buffer);
+}
+
+/* **************************************************** */
+
+void LiveCaptureRing::copyIn(u_int64_t pos, const void *data, u_int32_t len) {
+  u_int32_t off = (u_int32_t)(pos & mask);
+  u_int32_t first = min_val(len, size - off);
+
+  memcpy(&buffer[off], data, first);
+
+  if(first < len) /* Wrap around */
+    memcpy(buffer, &((const u_char*)data)[first], len - first);
+}
+
+/* **************************************************** */
+
+bool LiveCaptureRing::enqueue(const struct pcap_pkthdr * const h, const u_char * const packet) {
+  struct pcap_disk_pkthdr pkthdr; /* Cannot use h as the format on disk differs */
+  u_int64_t pos = head;
+  u_int32_t len = sizeof(pkthdr) + h->caplen;
+
+  if((size - (u_int32_t)(pos - tail)) < len)
+    return(false); /* The consumer can't keep up */
+
+  pkthdr.ts.tv_sec = h->ts.tv_sec, pkthdr.ts.tv_usec = h->ts.tv_usec,
+    pkthdr.caplen = h->caplen, pkthdr.len = h->len;
+
+  copyIn(pos, &pkthdr, sizeof(pkthdr));
+  copyIn(pos + sizeof(pkthdr), packet, h->caplen);
+
+  gcc_mb(); /* The packet must be in place before the consumer sees it */
+  head = pos + len;
+
+  return(true);
+}
+
+/* **************************************************** */
+
+u_int32_t LiveCaptureRing::peek(const u_char **data) {
+  u_int64_t avail = head - tail;
+  u_int32_t off = (u_int32_t)(tail & mask);
+
+  gcc_mb();
+  *data = &buffer[off];
+
+  return((u_int32_t)min_val(avail, (u_int64_t)(size - off)));
+}
+
+/* **************************************************** */
+
+void LiveCaptureRing::consume(u_int32_t len) {
+  gcc_mb(); /* Done reading before the producer can overwrite */
+  tail += len;
+}
@@ -59,8 +59,9 @@ void LocalHost::initialize() {
 
   local_network_id = -1;
   nextSitesUpdate = 0;
-  top_sites = new FrequentStringItems(HOST_SITES_TOP_NUMBER);
-  old_sites = strdup("{}");
+  top_sites = NULL, old_sites = NULL; /* Allocated by incrVisitedWebSite */
+  dns = NULL, http = NULL; /* Allocated on first use */
+  ts_ring = NULL; /* Allocated by updateStats once the host has traffic */
   dhcpUpdated = false;
   icmp = NULL;
   drop_all_host_traffic = false;
@@ -75,11 +76,6 @@ void LocalHost::initialize() {
   readDHCPCache();
   PROFILING_SUB_SECTION_EXIT(iface, 14);
 
-  PROFILING_SUB_SECTION_ENTER(iface, "LocalHost::initialize: new Stats", 15);
-  dns  = new DnsStats();
-  http = new HTTPstats(iface->get_hosts_hash());
-  PROFILING_SUB_SECTION_EXIT(iface, 15);
-
   PROFILING_SUB_SECTION_ENTER(iface, "LocalHost::initialize: local_host_cache", 16);
   if(ntop->getPrefs()->is_idle_local_host_cache_enabled()) {
     char *json = NULL;
@@ -111,7 +107,7 @@ void LocalHost::initialize() {
   snprintf(host, sizeof(host), "%s@%u", strIP, vlan_id);
   char rsp[256];
 
-  if(ntop->getRedis()->getAddress(strIP, rsp, sizeof(rsp), true) == 0)
+  if(ntop->getAddressResolution()->getAddress(strIP, rsp, sizeof(rsp), true) == 0)
     setName(rsp);
 
   PROFILING_SUB_SECTION_ENTER(iface, "LocalHost::initialize: updateHostTrafficPolicy", 18);
@@ -125,11 +121,6 @@ void LocalHost::initialize() {
 			       ip.print(buf, sizeof(buf)),
 			       isSystemHost() ? "systemHost" : "", this);
 #endif
-
-  if(TimeseriesRing::isRingEnabled(ntop->getPrefs()))
-    ts_ring = new TimeseriesRing(iface);
-  else
-    ts_ring = NULL;
 }
 
 /* *************************************** */
@@ -194,8 +185,7 @@ void LocalHost::incrVisitedWebSite(char *hostname) {
   u_int ip4_0 = 0, ip4_1 = 0, ip4_2 = 0, ip4_3 = 0;
   char *firstdot = NULL, *nextdot = NULL;
 
-  if(top_sites
-     && ntop->getPrefs()->are_top_talkers_enabled()
+  if(ntop->getPrefs()->are_top_talkers_enabled()
      && (strstr(hostname, "in-addr.arpa") == NULL)
      && (sscanf(hostname, "%u.%u.%u.%u", &ip4_0, &ip4_1, &ip4_2, &ip4_3) != 4)
      ) {
@@ -209,12 +199,22 @@ void LocalHost::incrVisitedWebSite(char *hostname) {
     if(firstdot)
       nextdot = strchr(&firstdot[1], '.');
 
-    top_sites->add(nextdot ? &firstdot[1] : hostname, 1);
+    if(top_sites || (top_sites = new(std::nothrow) FrequentStringItems(HOST_SITES_TOP_NUMBER)))
+      top_sites->add(nextdot ? &firstdot[1] : hostname, 1);
   }
 }
 
 /* *************************************** */
 
+HTTPstats* LocalHost::getHTTPstats(bool createIfNotPresent) {
+  if((http == NULL) && createIfNotPresent)
+    http = new(std::nothrow) HTTPstats(iface->get_hosts_hash());
+
+  return(http);
+}
+
+/* *************************************** */
+
 bool LocalHost::readDHCPCache() {
   Mac *m = mac; /* Cache it as it can be replaced with secondary_mac */
 
@@ -330,11 +330,11 @@ bool LocalHost::deserialize(char *json_str, char *key) {
   if(json_object_object_get_ex(o, "total_activity_time", &obj))  total_activity_time = json_object_get_int(obj);
 
   if(json_object_object_get_ex(o, "dns", &obj)) {
-    if(dns) dns->deserialize(obj);
+    if(getDnsStats()) dns->deserialize(obj);
   }
 
   if(json_object_object_get_ex(o, "http", &obj)) {
-    if(http) http->deserialize(obj);
+    if(getHTTPstats(true)) http->deserialize(obj);
   }
 
   if(ndpiStats) {
@@ -398,8 +398,8 @@ void LocalHost::lua(lua_State* vm, AddressTree *ptree,
 	    host_details, verbose, returnHost,
 	    false /* asListElement possibly handled later */);
 
-  if((!mask_host) && top_sites && ntop->getPrefs()->are_top_talkers_enabled()) {
-    char *cur_sites = top_sites->json();
+  if((!mask_host) && ntop->getPrefs()->are_top_talkers_enabled()) {
+    char *cur_sites = top_sites ? top_sites->json() : NULL;
     lua_push_str_table_entry(vm, "sites", cur_sites ? cur_sites : (char*)"{}");
     lua_push_str_table_entry(vm, "sites.old", old_sites ? old_sites : (char*)"{}");
     if(cur_sites) free(cur_sites);
@@ -418,7 +418,7 @@ void LocalHost::lua(lua_State* vm, AddressTree *ptree,
 
   lua_push_uint64_table_entry(vm, "upload", getNumBytesSent());
   lua_push_uint64_table_entry(vm, "download", getNumBytesRcvd());
-  lua_push_uint64_table_entry(vm, "unknown", get_ndpi_stats()->getProtoBytes(NDPI_PROTOCOL_UNKNOWN));
+  lua_push_uint64_table_entry(vm, "unknown", get_ndpi_proto_bytes(NDPI_PROTOCOL_UNKNOWN));
   lua_push_uint64_table_entry(vm, "incomingflows", getNumIncomingFlows());
   lua_push_uint64_table_entry(vm, "outgoingflows", getNumOutgoingFlows());
 
@@ -449,7 +449,7 @@ void LocalHost::lua(lua_State* vm, AddressTree *ptree,
 
 void LocalHost::updateHTTPHostRequest(char *virtual_host_name, u_int32_t num_req,
 				 u_int32_t bytes_sent, u_int32_t bytes_rcvd) {
-  if(http)
+  if(getHTTPstats(true))
     http->updateHTTPHostRequest(virtual_host_name, num_req, bytes_sent, bytes_rcvd);
 }
 
@@ -492,8 +492,12 @@ void LocalHost::updateStats(struct timeval *tv) {
     nextSitesUpdate = tv->tv_sec + HOST_SITES_REFRESH;
   }
 
-  /* The ring can be enabled at runtime so we need to check for allocation */
-  if(!ts_ring && TimeseriesRing::isRingEnabled(ntop->getPrefs()))
+  /*
+    The ring can be enabled at runtime so it is allocated here, on the
+    first non-empty sample: idle hosts only have real time (empty) points
+  */
+  if(!ts_ring && TimeseriesRing::isRingEnabled(ntop->getPrefs())
+     && (sent.getNumBytes() || rcvd.getNumBytes()))
     ts_ring = new TimeseriesRing(iface);
   
   if(ts_ring && ts_ring->isTimeToInsert()) {
@@ -36,6 +36,11 @@ extern "C" {
 
 struct keyval string_to_replace[MAX_NUM_HTTP_REPLACEMENTS] = { { NULL, NULL } };
 static Mutex rrd_lock;
+static Mutex rrd_batch_stats_lock;
+static struct {
+  u_int64_t num_batches, num_updates, num_files, num_errors, tot_usec;
+  u_int32_t last_usec, max_usec;
+} rrd_batch_stats;
 static int live_extraction_num = 0;
 static Mutex live_extraction_num_lock;
 static std::list<char*> new_custom_categories, custom_categories_to_purge;
@@ -145,6 +150,9 @@ LuaEngine::~LuaEngine() {
       if((ctx->iface != NULL) && ctx->live_capture.pcaphdr_sent)
 	ctx->iface->deregisterLiveCapture(ctx);
 
+      if(ctx->live_capture.ring)
+	delete ctx->live_capture.ring;
+
       free(ctx);
     }
 
@@ -2459,6 +2467,22 @@ static int ntop_append_influx_db(lua_State* vm) {
 
 /* ****************************************** */
 
+static int ntop_get_ts_exporter_stats(lua_State* vm) {
+  NetworkInterface *ntop_interface = getCurrentInterface(vm);
+  TimeseriesExporter *exporter;
+
+  ntop->getTrace()->traceEvent(TRACE_DEBUG, "%s() called", __FUNCTION__);
+
+  if(ntop_interface && ((exporter = ntop_interface->getActiveTSExporter()) != NULL))
+    exporter->lua(vm);
+  else
+    lua_pushnil(vm);
+
+  return(CONST_LUA_OK);
+}
+
+/* ****************************************** */
+
 // ***API***
 static int ntop_get_interface_flows_info(lua_State* vm) {
   NetworkInterface *ntop_interface = getCurrentInterface(vm);
@@ -2580,6 +2604,164 @@ static int ntop_get_interface_host_info(lua_State* vm) {
 
 /* ****************************************** */
 
+/* Reads the strings of the array at index idx: returns the number of strings read */
+static u_int get_lua_string_array(lua_State* vm, int idx, const char ***strings) {
+  u_int num = 0, max_num = 0;
+
+  *strings = NULL;
+
+  lua_pushnil(vm);
+  while(lua_next(vm, idx) != 0) {
+    if(lua_type(vm, -1) == LUA_TSTRING) max_num++;
+    lua_pop(vm, 1);
+  }
+
+  if((max_num == 0) || ((*strings = (const char**)calloc(max_num, sizeof(char*))) == NULL))
+    return(0);
+
+  /* Note: the strings are kept alive by the table */
+  lua_pushnil(vm);
+  while(lua_next(vm, idx) != 0) {
+    if((lua_type(vm, -1) == LUA_TSTRING) && (num < max_num))
+      (*strings)[num++] = lua_tostring(vm, -1);
+    lua_pop(vm, 1);
+  }
+
+  return(num);
+}
+
+/* ****************************************** */
+
+// ***API***
+static int ntop_get_interface_hosts_info_batch(lua_State* vm) {
+  NetworkInterface *ntop_interface = getCurrentInterface(vm);
+  const char **host_keys = NULL, **field_names = NULL;
+  HostLuaField *fields = NULL;
+  u_int num_keys, num_fields = 0;
+
+  ntop->getTrace()->traceEvent(TRACE_DEBUG, "%s() called", __FUNCTION__);
+
+  if(ntop_lua_check(vm, __FUNCTION__, 1, LUA_TTABLE) != CONST_LUA_OK) return(CONST_LUA_ERROR);
+  if(!ntop_interface) return(CONST_LUA_ERROR);
+
+  num_keys = get_lua_string_array(vm, 1, &host_keys);
+
+  /* Optional fields projection */
+  if(lua_type(vm, 2) == LUA_TTABLE) {
+    u_int num_names = get_lua_string_array(vm, 2, &field_names);
+
+    if(num_names > 0) {
+      if((fields = (HostLuaField*)calloc(num_names, sizeof(HostLuaField))) == NULL) {
+	free(field_names);
+	if(host_keys) free(host_keys);
+	return(CONST_LUA_ERROR);
+      }
+
+      for(u_int i = 0; i < num_names; i++) {
+	HostLuaField f = Host::getLuaField(field_names[i]);
+
+	if(f == host_field_unknown)
+	  ntop->getTrace()->traceEvent(TRACE_WARNING, "Unknown host field %s: ignored", field_names[i]);
+	else
+	  fields[num_fields++] = f;
+      }
+
+      free(field_names);
+    }
+  }
+
+  ntop_interface->getHostsInfoBatch(vm, get_allowed_nets(vm), host_keys, num_keys,
+				    fields, num_fields);
+
+  if(fields)    free(fields);
+  if(host_keys) free(host_keys);
+
+  return(CONST_LUA_OK);
+}
+
+/* ****************************************** */
+
+/* queryFlowStore(begin, end, group_by, { host, port, l4_proto, l7_proto, vlan, sort, limit, offset }) */
+static int ntop_interface_query_flow_store(lua_State* vm) {
+  NetworkInterface *ntop_interface = getCurrentInterface(vm);
+  ColumnarFlowDB *db;
+  FlowStoreQuery q;
+
+  ntop->getTrace()->traceEvent(TRACE_DEBUG, "%s() called", __FUNCTION__);
+
+  if(ntop_lua_check(vm, __FUNCTION__, 1, LUA_TNUMBER) != CONST_LUA_OK) return(CONST_LUA_ERROR);
+  if(ntop_lua_check(vm, __FUNCTION__, 2, LUA_TNUMBER) != CONST_LUA_OK) return(CONST_LUA_ERROR);
+
+  if(!ntop_interface || !(db = ntop_interface->getColumnarFlowDB())) {
+    lua_pushnil(vm);
+    return(CONST_LUA_OK);
+  }
+
+  memset(&q, 0, sizeof(q));
+  q.begin = (time_t)lua_tonumber(vm, 1), q.end = (time_t)lua_tonumber(vm, 2);
+  q.port = q.l4_proto = q.l7_proto = q.vlan_id = -1;
+  q.group_by = ColumnarFlowDB::str2GroupBy(lua_type(vm, 3) == LUA_TSTRING ? lua_tostring(vm, 3) : NULL);
+  q.sort = flow_store_sort_bytes;
+
+  if(lua_type(vm, 4) == LUA_TTABLE) {
+    lua_getfield(vm, 4, "host");
+    if(lua_type(vm, -1) == LUA_TSTRING) {
+      IpAddress ip;
+
+      ip.set((char*)lua_tostring(vm, -1));
+      ColumnarFlowDB::setIP(q.host, &ip);
+      q.has_host = true;
+    }
+    lua_pop(vm, 1);
+
+    lua_getfield(vm, 4, "port");
+    if(lua_type(vm, -1) == LUA_TNUMBER) q.port = (u_int16_t)lua_tonumber(vm, -1);
+    lua_pop(vm, 1);
+
+    lua_getfield(vm, 4, "l4_proto");
+    if(lua_type(vm, -1) == LUA_TNUMBER) q.l4_proto = (u_int8_t)lua_tonumber(vm, -1);
+    lua_pop(vm, 1);
+
+    /* L7 protocol id or name */
+    lua_getfield(vm, 4, "l7_proto");
+    if(lua_type(vm, -1) == LUA_TNUMBER)
+      q.l7_proto = (u_int16_t)lua_tonumber(vm, -1);
+    else if(lua_type(vm, -1) == LUA_TSTRING) {
+      int id = ntop_interface->get_ndpi_proto_id((char*)lua_tostring(vm, -1));
+
+      q.l7_proto = (id >= 0) ? id : 0xFFFF /* Matches nothing */;
+    }
+    lua_pop(vm, 1);
+
+    lua_getfield(vm, 4, "vlan");
+    if(lua_type(vm, -1) == LUA_TNUMBER) q.vlan_id = (u_int16_t)lua_tonumber(vm, -1);
+    lua_pop(vm, 1);
+
+    lua_getfield(vm, 4, "sort");
+    if(lua_type(vm, -1) == LUA_TSTRING) {
+      const char *sort = lua_tostring(vm, -1);
+
+      if(!strcmp(sort, "packets"))    q.sort = flow_store_sort_packets;
+      else if(!strcmp(sort, "flows")) q.sort = flow_store_sort_flows;
+    }
+    lua_pop(vm, 1);
+
+    lua_getfield(vm, 4, "limit");
+    if(lua_type(vm, -1) == LUA_TNUMBER) q.limit = (u_int32_t)lua_tonumber(vm, -1);
+    lua_pop(vm, 1);
+
+    lua_getfield(vm, 4, "offset");
+    if(lua_type(vm, -1) == LUA_TNUMBER) q.offset = (u_int32_t)lua_tonumber(vm, -1);
+    lua_pop(vm, 1);
+  }
+
+  db->luaQuery(vm, &q);
+
+  return(CONST_LUA_OK);
+}
+
+/* ****************************************** */
+
 static int ntop_get_interface_host_timeseries(lua_State* vm) {
   NetworkInterface *ntop_interface = getCurrentInterface(vm);
   char *host_ip;
@@ -3147,7 +3329,7 @@ static int ntop_get_interface_flow_key(lua_State* vm) {
      ||(srv = ntop_interface->getHost(srv_name, srv_vlan)) == NULL) {
     lua_pushnil(vm);
   } else
-    lua_pushinteger(vm, Flow::key(cli, cli_port, srv, srv_port, cli_vlan, protocol));
+    lua_pushinteger(vm, Flow::key(cli, cli_port, srv, srv_port, protocol));
 
   return(CONST_LUA_OK);
 }
@@ -3636,9 +3818,22 @@ static int ntop_interface_live_capture(lua_State* vm) {
   if(ntop_lua_check(vm, __FUNCTION__, 3, LUA_TSTRING) != CONST_LUA_OK) return(CONST_LUA_ERROR);
   bpf = (char*)lua_tostring(vm, 3);
   
+  /* A fresh ring for each capture served by this VM */
+  if(c->live_capture.ring) {
+    delete c->live_capture.ring;
+    c->live_capture.ring = NULL;
+  }
+
+  try {
+    c->live_capture.ring = new LiveCaptureRing(CONST_LIVE_CAPTURE_RING_SIZE);
+  } catch(...) {
+    ntop->getTrace()->traceEvent(TRACE_WARNING, "Not enough memory for the live capture");
+    return(CONST_LUA_ERROR);
+  }
+
   c->live_capture.capture_until = time(NULL)+duration;
   c->live_capture.capture_max_pkts = CONST_MAX_NUM_PACKETS_PER_LIVE;
-  c->live_capture.num_captured_packets = 0;
+  c->live_capture.num_captured_packets = c->live_capture.num_dropped_packets = 0;
   c->live_capture.stopped = c->live_capture.pcaphdr_sent = false;
   c->live_capture.bpfFilterSet = false;
   
@@ -3660,12 +3855,11 @@ static int ntop_interface_live_capture(lua_State* vm) {
 				 "Starting live capture id %d",
 				 capture_id);
 
-    while(!c->live_capture.stopped) {
-      ntop->getTrace()->traceEvent(TRACE_INFO, "Capturing....");
-      sleep(1);
-    }
+    /* Returns when the capture is over */
+    ntop_interface->sendLiveCapture(c);
 
-    ntop->getTrace()->traceEvent(TRACE_INFO, "Capture completed");
+    ntop->getTrace()->traceEvent(TRACE_INFO, "Capture completed [dropped packets: %u]",
+				 c->live_capture.num_dropped_packets);
   }
 
   lua_pushnil(vm);
@@ -4370,6 +4564,252 @@ static int ntop_rrd_update(lua_State* vm) {
 
 /* ****************************************** */
 
+/* The updates of a file within a batch, in order */
+typedef struct {
+  std::string path;
+  bool exists;
+  unsigned long step;
+  std::vector<std::string> create_args;
+  std::vector<char*> updates;
+} RRDBatchFile;
+
+static void rrd_batch_update(RRDBatchFile *f, u_int32_t *num_errors, char *error, u_int error_len) {
+  int status;
+
+  if(f->updates.empty()) return;
+
+  reset_rrd_state();
+  status = rrd_update_r(f->path.c_str(), NULL, f->updates.size(), (const char**)&f->updates[0]);
+
+  if((status != 0) && (f->updates.size() > 1)) {
+    /* A failed update discards the whole call: retry one by one so that only the bad points are lost */
+    for(u_int i = 0; i < f->updates.size(); i++) {
+      reset_rrd_state();
+
+      if(rrd_update_r(f->path.c_str(), NULL, 1, (const char**)&f->updates[i]) != 0) {
+	char *err = rrd_get_error();
+
+	if(err && (error[0] == '\0'))
+	  snprintf(error, error_len, "rrd_update_r() [%s][%s] failed [%s]", f->path.c_str(), f->updates[i], err);
+
+	(*num_errors)++;
+      }
+    }
+  } else if(status != 0) {
+    char *err = rrd_get_error();
+
+    if(err && (error[0] == '\0'))
+      snprintf(error, error_len, "rrd_update_r() [%s][%s] failed [%s]", f->path.c_str(), f->updates[0], err);
+
+    (*num_errors)++;
+  }
+}
+
+/* ****************************************** */
+
+/*
+  rrd_update_batch(base_path, updates): updates all the timeseries of an
+  entity in one call. Every update is a table
+    { rrd = <file name>, timestamp = <epoch>, values = { v1, ... },
+      step = <sec>, create = { "DS:...", "RRA:...", ... } }
+  where step and create are only used when the file does not exist.
+  The updates of the same file are written with a single rrd_update_r.
+*/
+static int ntop_rrd_update_batch(lua_State* vm) {
+  std::vector<RRDBatchFile> files;
+  std::map<std::string, u_int> files_idx;
+  struct timeval begin, end;
+  char base[MAX_PATH], error[512];
+  u_int32_t num_updates = 0, num_created = 0, num_errors = 0, usec;
+  struct stat s;
+
+  if(ntop_lua_check(vm, __FUNCTION__, 1, LUA_TSTRING) != CONST_LUA_OK) return(CONST_LUA_PARAM_ERROR);
+  if(ntop_lua_check(vm, __FUNCTION__, 2, LUA_TTABLE) != CONST_LUA_OK)  return(CONST_LUA_PARAM_ERROR);
+
+  gettimeofday(&begin, NULL);
+  error[0] = '\0';
+
+  snprintf(base, sizeof(base), "%s", lua_tostring(vm, 1));
+  ntop->fixPath(base);
+
+  if((stat(base, &s) != 0) && !Utils::mkdir_tree(base)) {
+    snprintf(error, sizeof(error), "Unable to create directory %s", base);
+    lua_pushstring(vm, error);
+    return(CONST_LUA_ERROR);
+  }
+
+  for(int i = 1; ; i++) {
+    const char *rrd;
+    RRDBatchFile *f;
+    char buf[256];
+    u_int len;
+
+    lua_rawgeti(vm, 2, i);
+
+    if(lua_type(vm, -1) != LUA_TTABLE) {
+      lua_pop(vm, 1);
+      break;
+    }
+
+    lua_getfield(vm, -1, "rrd");
+    rrd = lua_tostring(vm, -1);
+    lua_pop(vm, 1);
+
+    if(rrd == NULL) {
+      num_errors++;
+      lua_pop(vm, 1);
+      continue;
+    }
+
+    std::map<std::string, u_int>::iterator it = files_idx.find(rrd);
+
+    if(it == files_idx.end()) {
+      RRDBatchFile nf;
+      char path[MAX_PATH];
+
+      snprintf(path, sizeof(path), "%s/%s.rrd", base, rrd);
+      ntop->fixPath(path);
+      nf.path = path, nf.exists = (stat(path, &s) == 0), nf.step = 0;
+
+      if(!nf.exists) {
+	lua_getfield(vm, -1, "step");
+	nf.step = (unsigned long)lua_tonumber(vm, -1);
+	lua_pop(vm, 1);
+
+	lua_getfield(vm, -1, "create");
+	if(lua_type(vm, -1) == LUA_TTABLE) {
+	  for(int j = 1; ; j++) {
+	    lua_rawgeti(vm, -1, j);
+
+	    if(!lua_isstring(vm, -1)) {
+	      lua_pop(vm, 1);
+	      break;
+	    }
+
+	    nf.create_args.push_back(lua_tostring(vm, -1));
+	    lua_pop(vm, 1);
+	  }
+	}
+	lua_pop(vm, 1);
+      }
+
+      files_idx[rrd] = files.size();
+      files.push_back(nf);
+      f = &files.back();
+    } else
+      f = &files[it->second];
+
+    /* <timestamp>:<v1>:<v2>... */
+    lua_getfield(vm, -1, "timestamp");
+    len = snprintf(buf, sizeof(buf), "%s", lua_isstring(vm, -1) ? lua_tostring(vm, -1) : "N");
+    lua_pop(vm, 1);
+
+    lua_getfield(vm, -1, "values");
+    if(lua_type(vm, -1) == LUA_TTABLE) {
+      for(int j = 1; len < sizeof(buf); j++) {
+	lua_rawgeti(vm, -1, j);
+
+	if(!lua_isstring(vm, -1)) {
+	  lua_pop(vm, 1);
+	  break;
+	}
+
+	len += snprintf(&buf[len], sizeof(buf) - len, ":%s", lua_tostring(vm, -1));
+	lua_pop(vm, 1);
+      }
+    }
+    lua_pop(vm, 2 /* values and update */);
+
+    /* Apparently RRD does not like static buffers, so we need to malloc */
+    char *upd = strdup(buf);
+
+    if(upd)
+      f->updates.push_back(upd), num_updates++;
+    else
+      num_errors++;
+  }
+
+  for(std::vector<RRDBatchFile>::iterator f = files.begin(); f != files.end(); ++f) {
+    if(!f->exists) {
+      const char **argv = (const char**)calloc(f->create_args.size() + 1, sizeof(char*));
+
+      if(argv) {
+	for(u_int j = 0; j < f->create_args.size(); j++)
+	  argv[j] = f->create_args[j].c_str();
+
+	reset_rrd_state();
+
+	if(f->create_args.empty() || (rrd_create_r(f->path.c_str(), f->step, time(NULL) - 86400 /* 1 day */,
+						    f->create_args.size(), argv) != 0)) {
+	  char *err = rrd_get_error();
+
+	  if(error[0] == '\0')
+	    snprintf(error, sizeof(error), "Unable to create %s [%s]", f->path.c_str(), err ? err : "no definition");
+
+	  num_errors += f->updates.size();
+
+	  for(u_int j = 0; j < f->updates.size(); j++)
+	    free(f->updates[j]);
+
+	  f->updates.clear();
+	} else
+	  num_created++;
+
+	free(argv);
+      }
+    }
+
+    rrd_batch_update(&(*f), &num_errors, error, sizeof(error));
+
+    for(u_int j = 0; j < f->updates.size(); j++)
+      free(f->updates[j]);
+  }
+
+  gettimeofday(&end, NULL);
+  usec = (end.tv_sec - begin.tv_sec) * 1000000 + (end.tv_usec - begin.tv_usec);
+
+  rrd_batch_stats_lock.lock(__FILE__, __LINE__);
+  rrd_batch_stats.num_batches++, rrd_batch_stats.num_updates += num_updates;
+  rrd_batch_stats.num_files += files.size(), rrd_batch_stats.num_errors += num_errors;
+  rrd_batch_stats.tot_usec += usec, rrd_batch_stats.last_usec = usec;
+  if(usec > rrd_batch_stats.max_usec) rrd_batch_stats.max_usec = usec;
+  rrd_batch_stats_lock.unlock(__FILE__, __LINE__);
+
+  if(error[0])
+    ntop->getTrace()->traceEvent(TRACE_INFO, "%s", error);
+
+  lua_newtable(vm);
+  lua_push_uint64_table_entry(vm, "updates", num_updates);
+  lua_push_uint64_table_entry(vm, "files", files.size());
+  lua_push_uint64_table_entry(vm, "created", num_created);
+  lua_push_uint64_table_entry(vm, "errors", num_errors);
+  lua_push_uint64_table_entry(vm, "usec", usec);
+  if(error[0]) lua_push_str_table_entry(vm, "error", error);
+
+  return(CONST_LUA_OK);
+}
+
+/* ****************************************** */
+
+static int ntop_rrd_get_batch_stats(lua_State* vm) {
+  rrd_batch_stats_lock.lock(__FILE__, __LINE__);
+
+  lua_newtable(vm);
+  lua_push_uint64_table_entry(vm, "batches", rrd_batch_stats.num_batches);
+  lua_push_uint64_table_entry(vm, "updates", rrd_batch_stats.num_updates);
+  lua_push_uint64_table_entry(vm, "files", rrd_batch_stats.num_files);
+  lua_push_uint64_table_entry(vm, "errors", rrd_batch_stats.num_errors);
+  lua_push_uint64_table_entry(vm, "tot_usec", rrd_batch_stats.tot_usec);
+  lua_push_uint64_table_entry(vm, "last_usec", rrd_batch_stats.last_usec);
+  lua_push_uint64_table_entry(vm, "max_usec", rrd_batch_stats.max_usec);
+
+  rrd_batch_stats_lock.unlock(__FILE__, __LINE__);
+
+  return(CONST_LUA_OK);
+}
+
+/* ****************************************** */
+
 static int ntop_rrd_get_lastupdate(const char *filename, time_t *last_update, unsigned long *ds_count) {
   char    **ds_names;
   char    **last_ds;
@@ -5221,6 +5661,21 @@ static int ntop_resolve_address(lua_State* vm) {
 
 /* ****************************************** */
 
+static int ntop_del_resolved_address(lua_State* vm) {
+  char *numIP;
+
+  ntop->getTrace()->traceEvent(TRACE_DEBUG, "%s() called", __FUNCTION__);
+
+  if(ntop_lua_check(vm, __FUNCTION__, 1, LUA_TSTRING) != CONST_LUA_OK) return(CONST_LUA_PARAM_ERROR);
+  if((numIP = (char*)lua_tostring(vm, 1)) == NULL)  return(CONST_LUA_PARAM_ERROR);
+
+  ntop->getAddressResolution()->delResolvedAddress(numIP);
+  lua_pushnil(vm);
+  return(CONST_LUA_OK);
+}
+
+/* ****************************************** */
+
 void lua_push_str_table_entry(lua_State *L, const char * const key, const char * const value) {
   if(L) {
     lua_pushstring(L, key);
@@ -5981,6 +6436,11 @@ static int ntop_get_info(lua_State* vm) {
 #ifdef HAVE_MAXMINDDB
     lua_push_str_table_entry(vm, "version.geoip", (char*)MMDB_lib_version());
 #endif
+    if(ntop->getGeolocation()) {
+      lua_push_uint64_table_entry(vm, "geoip.cache_hits", ntop->getGeolocation()->getNumCacheHits());
+      lua_push_uint64_table_entry(vm, "geoip.cache_misses", ntop->getGeolocation()->getNumCacheMisses());
+    }
+    ntop->getAddressResolution()->lua(vm);
     lua_push_str_table_entry(vm, "version.ndpi", ndpi_revision());
     lua_push_bool_table_entry(vm, "version.enterprise_edition", ntop->getPrefs()->is_enterprise_edition());
     lua_push_bool_table_entry(vm, "version.embedded_edition", ntop->getPrefs()->is_embedded_edition());
@@ -6083,7 +6543,6 @@ static int ntop_is_allowed_network(lua_State* vm) {
 
 static int ntop_get_resolved_address(lua_State* vm) {
   char *key, *tmp,rsp[256],value[64];
-  Redis *redis = ntop->getRedis();
   u_int16_t vlan_id = 0;
   char buf[64];
 
@@ -6095,7 +6554,7 @@ static int ntop_get_resolved_address(lua_State* vm) {
   if(key == NULL)
     return(CONST_LUA_ERROR);
 
-  if((redis->getAddress(key, rsp, sizeof(rsp), true) == 0) && (rsp[0] != '\0'))
+  if((ntop->getAddressResolution()->getAddress(key, rsp, sizeof(rsp), true) == 0) && (rsp[0] != '\0'))
     tmp = rsp;
   else
     tmp = key;
@@ -8034,6 +8493,8 @@ static const luaL_Reg ntop_interface_reg[] = {
   { "getBatchedRemoteHostsInfo",  ntop_get_batched_interface_remote_hosts_info },
   { "getBatchedLocalHostsTs",   ntop_get_batched_interface_local_hosts_ts },
   { "getHostInfo",              ntop_get_interface_host_info },
+  { "getHostsInfoBatch",        ntop_get_interface_hosts_info_batch },
+  { "queryFlowStore",           ntop_interface_query_flow_store },
   { "getHostTimeseries",        ntop_get_interface_host_timeseries },
   { "getHostCountry",           ntop_get_interface_host_country },
   { "getGroupedHosts",          ntop_get_grouped_interface_hosts },
@@ -8106,6 +8567,7 @@ static const luaL_Reg ntop_interface_reg[] = {
 
   /* InfluxDB */
   { "appendInfluxDB",                   ntop_append_influx_db                 },
+  { "getTSExporterStats",               ntop_get_ts_exporter_stats            },
 
 #ifdef NTOPNG_PRO
   { "resetPoolsQuotas",                 ntop_reset_pools_quotas               },
@@ -8293,6 +8755,8 @@ static const luaL_Reg ntop_reg[] = {
   /* RRD */
   { "rrd_create",        ntop_rrd_create },
   { "rrd_update",        ntop_rrd_update },
+  { "rrd_update_batch",  ntop_rrd_update_batch },
+  { "rrd_batch_stats",   ntop_rrd_get_batch_stats },
   { "rrd_fetch",         ntop_rrd_fetch  },
   { "rrd_fetch_columns", ntop_rrd_fetch_columns },
   { "rrd_lastupdate",    ntop_rrd_lastupdate  },
@@ -8342,6 +8806,7 @@ static const luaL_Reg ntop_reg[] = {
   /* Address Resolution */
   { "resolveName",       ntop_resolve_address },       /* Note: you should use resolveAddress() to call from Lua */
   { "getResolvedName",   ntop_get_resolved_address },  /* Note: you should use getResolvedAddress() to call from Lua */
+  { "delResolvedName",   ntop_del_resolved_address },
 
   /* Logging */
 #ifndef WIN32
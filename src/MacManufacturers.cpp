@@ -31,10 +31,15 @@
 /* *************************************** */
 
 MacManufacturers::MacManufacturers(const char * const home) {
-  mac_manufacturers = NULL;
+  db = NULL, db_len = 0, db_mapped = false;
+  header = NULL, entries = NULL, string_offsets = NULL, pool = NULL;
+
   snprintf(manufacturers_file, sizeof(manufacturers_file), "%s/other/%s", home ? home : "", "EtherOUI.txt");
   ntop->fixPath(manufacturers_file);
 
+  snprintf(cache_file, sizeof(cache_file), "%s/%s", ntop->get_working_dir(), "EtherOUI.bin");
+  ntop->fixPath(cache_file);
+
   init();
 }
 
@@ -46,100 +51,313 @@ void MacManufacturers::init() {
 #else
   struct stat buf;
 #endif
-  FILE *fd;
-  char line[256], *cr;
-  int _mac[3];
-  mac_manufacturers_t *s;
+  u_int64_t src_size = 0, src_mtime = 0;
 
-  if(!(stat(manufacturers_file, &buf) == 0) && (S_ISREG(buf.st_mode)))
+  if((stat(manufacturers_file, &buf) == 0) && S_ISREG(buf.st_mode))
+    src_size = (u_int64_t)buf.st_size, src_mtime = (u_int64_t)buf.st_mtime;
+  else
     ntop->getTrace()->traceEvent(TRACE_ERROR, "File %s doesn't exists or is not readable",
 				 manufacturers_file);
 
-  if((fd = fopen(manufacturers_file, "r")) == NULL)
+  /* The cache is only valid for the very same EtherOUI.txt */
+  if(loadCache(src_size, src_mtime)) {
+    ntop->getTrace()->traceEvent(TRACE_INFO, "Loaded %u MAC manufacturers from %s",
+				 header->num_entries, cache_file);
+    return;
+  }
+
+  if(parse(src_size, src_mtime))
+    saveCache();
+}
+
+/* *************************************** */
+
+bool MacManufacturers::parse(u_int64_t src_size, u_int64_t src_mtime) {
+  std::map<u_int32_t, std::pair<std::string, std::string> > ouis;
+  std::map<std::string, u_int32_t> strings;
+  std::map<u_int32_t, std::pair<std::string, std::string> >::const_iterator it;
+  std::map<std::string, u_int32_t>::iterator sit;
+  mac_manufacturers_db_header_t *h;
+  mac_manufacturers_db_entry_t *e;
+  u_int32_t *offsets, pool_len = 0, id = 0;
+  u_int8_t *blob;
+  char *p;
+  size_t blob_len;
+  FILE *fd;
+  char line[256], *cr;
+  int _mac[3];
+
+  if((fd = fopen(manufacturers_file, "r")) == NULL) {
     ntop->getTrace()->traceEvent(TRACE_ERROR, "Unable to read %s",
 				 manufacturers_file);
+    return(false);
+  }
 
-  if(fd) {
-    while(fgets(line, sizeof(line), fd)) {
-      char *tmp;
-      char *mac = strtok_r(line, "\t", &tmp);
-      char *shortmanuf, *manuf;
+  while(fgets(line, sizeof(line), fd)) {
+    char *tmp;
+    char *mac = strtok_r(line, "\t", &tmp);
+    char *shortmanuf, *manuf;
 
-      if(!mac)
-	continue;
-      else
-	shortmanuf = strtok_r(NULL, "\t", &tmp);
+    if(!mac)
+      continue;
+    else
+      shortmanuf = strtok_r(NULL, "\t", &tmp);
 
-      if(!shortmanuf)
-	continue;
-      else {
-	manuf = strtok_r(NULL, "\t", &tmp);
-	if(!manuf) manuf = shortmanuf;
-      }
+    if(!shortmanuf)
+      continue;
+    else {
+      manuf = strtok_r(NULL, "\t", &tmp);
+      if(!manuf) manuf = shortmanuf;
+    }
 
 #ifdef MANUF_DEBUG
-      ntop->getTrace()->traceEvent(TRACE_NORMAL, "%s [short: %s][full: %s]", mac, shortmanuf, manuf);
+    ntop->getTrace()->traceEvent(TRACE_NORMAL, "%s [short: %s][full: %s]", mac, shortmanuf, manuf);
 #endif
-				   
-      if(sscanf(mac, "%02x:%02x:%02x", &_mac[0], &_mac[1], &_mac[2]) == 3) {	
-	// printf("Retrieved line of length %zu :\n", read);
-	// printf("%s", line);
 
-	/* Lines are like:
-	   00:05:02        Apple                  # Apple, Inc.
-	   So it is possible to use '# ' as the full manufacturer name separator
-	*/
-	tmp = strstr(manuf, "# ");
-	if(tmp)
-	  manuf = &tmp[2];
+    if(sscanf(mac, "%02x:%02x:%02x", &_mac[0], &_mac[1], &_mac[2]) == 3) {
+      u_int32_t oui = ((_mac[0] & 0xFF) << 16) | ((_mac[1] & 0xFF) << 8) | (_mac[2] & 0xFF);
+
+      /* Lines are like:
+	 00:05:02        Apple                  # Apple, Inc.
+	 So it is possible to use '# ' as the full manufacturer name separator
+      */
+      tmp = strstr(manuf, "# ");
+      if(tmp)
+	manuf = &tmp[2];
+
+      if((cr = strchr(manuf, '\n')))
+	*cr = '\0';
 
-	if((cr = strchr(manuf, '\n')))
-	  *cr = '\0';
+      if(ouis.find(oui) != ouis.end())
+	continue; /* The first definition wins */
 
-	mac[0] = (u_int8_t)_mac[0], mac[1] = (u_int8_t)_mac[1], mac[2] = (u_int8_t)_mac[2];
-	HASH_FIND(hh, mac_manufacturers, mac, 3, s);
-	if(!s) {
-	  if((s = (mac_manufacturers_t*)calloc(1, sizeof(mac_manufacturers_t))) != NULL) {
-	    memcpy(s->mac_manufacturer, mac, 3);
+      Utils::purifyHTTPparam(manuf, false, false, false);
+      Utils::purifyHTTPparam(shortmanuf, false, false, false);
 
-	    s->manufacturer_name = (char*)calloc(strlen(manuf) + 1, sizeof(char));
-	    strcpy(s->manufacturer_name, manuf);
-	    Utils::purifyHTTPparam(s->manufacturer_name, false, false, false);
+      ouis[oui] = std::make_pair(std::string(manuf), std::string(shortmanuf));
+      strings[manuf] = 0, strings[shortmanuf] = 0;
+    }
+  }
 
-	    s->short_name = (char*)calloc(strlen(shortmanuf) + 1, sizeof(char));
-	    strcpy(s->short_name, shortmanuf);
-	    Utils::purifyHTTPparam(s->short_name, false, false, false);
+  fclose(fd);
 
-	    /* TODO: reduce memory usage for recurrent manufacturers */
+  /* Strings are identified by their alphabetical rank */
+  for(sit = strings.begin(); sit != strings.end(); ++sit)
+    sit->second = id++, pool_len += sit->first.length() + 1;
 
-	    HASH_ADD(hh, mac_manufacturers, mac_manufacturer, 3, s);
+  blob_len = sizeof(mac_manufacturers_db_header_t)
+    + ouis.size() * sizeof(mac_manufacturers_db_entry_t)
+    + strings.size() * sizeof(u_int32_t)
+    + pool_len;
 
-#ifdef MANUF_DEBUG
-	    ntop->getTrace()->traceEvent(TRACE_NORMAL,
-					 "Adding mac %02x:%02x:%02x [manufacturer name: %s]",
-					 s->mac_manufacturer[0],
-					 s->mac_manufacturer[1],
-					 s->mac_manufacturer[2],
-					 s->manufacturer_name);
+  if((blob = (u_int8_t*)calloc(1, blob_len)) == NULL) {
+    ntop->getTrace()->traceEvent(TRACE_WARNING, "Not enough memory");
+    return(false);
+  }
+
+  h = (mac_manufacturers_db_header_t*)blob;
+  memcpy(h->magic, MAC_MANUFACTURERS_DB_MAGIC, sizeof(h->magic));
+  h->version = MAC_MANUFACTURERS_DB_VERSION;
+  h->num_entries = ouis.size(), h->num_strings = strings.size(), h->pool_len = pool_len;
+  h->src_size = src_size, h->src_mtime = src_mtime;
+
+  e = (mac_manufacturers_db_entry_t*)&h[1];
+  for(it = ouis.begin(); it != ouis.end(); ++it, e++) {
+    e->oui = it->first;
+    e->name_id = strings[it->second.first];
+    e->short_name_id = strings[it->second.second];
+  }
+
+  offsets = (u_int32_t*)e;
+  p = (char*)&offsets[strings.size()];
+  for(sit = strings.begin(), pool_len = 0; sit != strings.end(); ++sit) {
+    *offsets++ = pool_len;
+    memcpy(&p[pool_len], sit->first.c_str(), sit->first.length() + 1);
+    pool_len += sit->first.length() + 1;
+  }
+
+  if(!setDB(blob, blob_len, false)) {
+    free(blob);
+    return(false);
+  }
+
+  ntop->getTrace()->traceEvent(TRACE_INFO, "Loaded %u MAC manufacturers [%u strings] from %s",
+			       header->num_entries, header->num_strings, manufacturers_file);
+
+  return(true);
+}
+
+/* *************************************** */
+
+bool MacManufacturers::loadCache(u_int64_t src_size, u_int64_t src_mtime) {
+  struct stat buf;
+  u_int8_t *blob;
+  int fd;
+
+  if((fd = open(cache_file, O_RDONLY)) < 0)
+    return(false);
+
+  if((fstat(fd, &buf) != 0) || (buf.st_size < (off_t)sizeof(mac_manufacturers_db_header_t))) {
+    close(fd);
+    return(false);
+  }
+
+#ifndef WIN32
+  blob = (u_int8_t*)mmap(NULL, buf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+
+  if(blob == MAP_FAILED)
+    return(false);
+#else
+  if((blob = (u_int8_t*)malloc(buf.st_size)) == NULL) {
+    close(fd);
+    return(false);
+  }
+
+  if(read(fd, blob, buf.st_size) != buf.st_size) {
+    close(fd), free(blob);
+    return(false);
+  }
+
+  close(fd);
 #endif
-	  }
-	}
-      }
-    }
 
-    fclose(fd);
+  if((((mac_manufacturers_db_header_t*)blob)->src_size == src_size)
+     && (((mac_manufacturers_db_header_t*)blob)->src_mtime == src_mtime)
+     && setDB(blob, buf.st_size, true))
+    return(true);
+
+  /* Stale or corrupted */
+#ifndef WIN32
+  munmap(blob, buf.st_size);
+#else
+  free(blob);
+#endif
+
+  return(false);
+}
+
+/* *************************************** */
+
+void MacManufacturers::saveCache() {
+  char tmp_file[MAX_PATH + 8];
+  FILE *fd;
+  bool ok;
+
+  snprintf(tmp_file, sizeof(tmp_file), "%s.tmp", cache_file);
+
+  if((fd = fopen(tmp_file, "wb")) == NULL) {
+    ntop->getTrace()->traceEvent(TRACE_INFO, "Unable to write %s: %s", tmp_file, strerror(errno));
+    return;
+  }
+
+  ok = (fwrite(db, db_len, 1, fd) == 1);
+  ok = (fclose(fd) == 0) && ok;
+
+  /* Atomically replace the cache so a concurrent startup never maps a partial file */
+  if(!ok || (rename(tmp_file, cache_file) != 0)) {
+    ntop->getTrace()->traceEvent(TRACE_WARNING, "Unable to save %s", cache_file);
+    unlink(tmp_file);
   }
 }
 
 /* *************************************** */
 
-MacManufacturers::~MacManufacturers() {
-  mac_manufacturers_t *current, *tmp;
+bool MacManufacturers::setDB(u_int8_t *_db, size_t _db_len, bool mapped) {
+  const mac_manufacturers_db_header_t *h = (const mac_manufacturers_db_header_t*)_db;
+  const mac_manufacturers_db_entry_t *e;
+  const u_int32_t *offsets;
+  const char *p;
 
-  HASH_ITER(hh, mac_manufacturers, current, tmp) {
-    HASH_DEL(mac_manufacturers, current);
-    free(current->manufacturer_name);
-    free(current->short_name);
-    free(current);
+  if((_db_len < sizeof(*h))
+     || memcmp(h->magic, MAC_MANUFACTURERS_DB_MAGIC, sizeof(h->magic))
+     || (h->version != MAC_MANUFACTURERS_DB_VERSION)
+     || (h->pool_len == 0)
+     || (_db_len != (sizeof(*h)
+		     + (u_int64_t)h->num_entries * sizeof(mac_manufacturers_db_entry_t)
+		     + (u_int64_t)h->num_strings * sizeof(u_int32_t)
+		     + h->pool_len)))
+    return(false);
+
+  e = (const mac_manufacturers_db_entry_t*)&h[1];
+  offsets = (const u_int32_t*)&e[h->num_entries];
+  p = (const char*)&offsets[h->num_strings];
+
+  /* Never trust the file: lookups assume sorted entries and terminated strings */
+  if(p[h->pool_len - 1] != '\0')
+    return(false);
+
+  for(u_int32_t i = 0; i < h->num_strings; i++)
+    if(offsets[i] >= h->pool_len) return(false);
+
+  for(u_int32_t i = 0; i < h->num_entries; i++) {
+    if((e[i].oui > 0xFFFFFF)
+       || ((i > 0) && (e[i].oui <= e[i - 1].oui))
+       || (e[i].name_id >= h->num_strings)
+       || (e[i].short_name_id >= h->num_strings))
+      return(false);
   }
+
+  freeDB();
+
+  db = _db, db_len = _db_len, db_mapped = mapped;
+  header = h, entries = e, string_offsets = offsets, pool = p;
+
+  return(true);
+}
+
+/* *************************************** */
+
+void MacManufacturers::freeDB() {
+  if(db) {
+#ifndef WIN32
+    if(db_mapped)
+      munmap(db, db_len);
+    else
+#endif
+      free(db);
+  }
+
+  db = NULL, db_len = 0, db_mapped = false;
+  header = NULL, entries = NULL, string_offsets = NULL, pool = NULL;
+}
+
+/* *************************************** */
+
+const mac_manufacturers_db_entry_t* MacManufacturers::find(u_int32_t oui) const {
+  u_int32_t lo = 0, hi;
+
+  if(!header) return(NULL);
+
+  hi = header->num_entries;
+
+  while(lo < hi) {
+    u_int32_t mid = lo + (hi - lo) / 2;
+
+    if(entries[mid].oui < oui)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  return(((lo < header->num_entries) && (entries[lo].oui == oui)) ? &entries[lo] : NULL);
+}
+
+/* *************************************** */
+
+void MacManufacturers::getManufacturerIds(const u_int32_t *ouis, u_int32_t num_ouis, int32_t *ids) const {
+  u_int32_t j = 0, num_entries = header ? header->num_entries : 0;
+
+  for(u_int32_t i = 0; i < num_ouis; i++) {
+    while((j < num_entries) && (entries[j].oui < ouis[i]))
+      j++;
+
+    ids[i] = ((j < num_entries) && (entries[j].oui == ouis[i])) ? (int32_t)entries[j].name_id : -1;
+  }
+}
+
+/* *************************************** */
+
+MacManufacturers::~MacManufacturers() {
+  freeDB();
 }
@@ -97,7 +97,7 @@ NetworkInterface::NetworkInterface(const char *name,
     }
   }
 
-  db = NULL;
+  db = NULL, columnar_db = NULL;
   ifname = strdup(name);
   if(custom_interface_type) {
     ifDescription = strdup(name);
@@ -149,6 +149,31 @@ NetworkInterface::NetworkInterface(const char *name,
     num_hashes = max_val(4096, ntop->getPrefs()->get_max_num_flows()/4);
     flows_hash = new FlowHash(this, num_hashes, ntop->getPrefs()->get_max_num_flows());
 
+    buf[0] = '\0';
+    if((!ntop->getRedis()->get((char*)CONST_RUNTIME_PREFS_FLOW_INDEXES, buf, sizeof(buf)))
+       && (buf[0] == '1')) {
+      try {
+	flow_index = new FlowIndex(ntop->getPrefs()->get_max_num_hosts());
+      } catch(...) {
+	ntop->getTrace()->traceEvent(TRACE_WARNING, "Not enough memory: flow indexes disabled on %s", ifname);
+	flow_index = NULL;
+      }
+    }
+
+    buf[0] = '\0';
+    if((!ntop->getRedis()->get((char*)CONST_RUNTIME_PREFS_NATIVE_RECORDING, buf, sizeof(buf)))
+       && (buf[0] == '1')) {
+      u_int64_t max_disk_mb = RECORDER_DEFAULT_MAX_DISK_MB;
+
+      buf[0] = '\0';
+      if((!ntop->getRedis()->get((char*)CONST_RUNTIME_PREFS_NATIVE_RECORDING_MAX_DISK, buf, sizeof(buf)))
+	 && (atoll(buf) > 0))
+	max_disk_mb = atoll(buf);
+
+      /* Buffers are only allocated when the first packet is recorded */
+      recorder = new(std::nothrow) PacketRecorder(this, max_disk_mb * 1024 * 1024);
+    }
+
     num_hashes = max_val(4096, ntop->getPrefs()->get_max_num_hosts() / 4);
     hosts_hash = new HostHash(this, num_hashes, ntop->getPrefs()->get_max_num_hosts());
     /* The number of ASes cannot be greater than the number of hosts */
@@ -194,7 +219,7 @@ NetworkInterface::NetworkInterface(const char *name,
     arp_requests = arp_replies = 0;
 
     running = false, sprobe_interface = false,
-      inline_interface = false, db = NULL;
+      inline_interface = false, db = NULL, columnar_db = NULL;
 
     checkIdle();
     ifSpeed = Utils::getMaxIfSpeed(name);
@@ -267,7 +292,7 @@ NetworkInterface::NetworkInterface(const char *name,
 /* **************************************************** */
 
 void NetworkInterface::init() {
-  ifname = NULL, flows_hash = NULL, hosts_hash = NULL,
+  ifname = NULL, flows_hash = NULL, flow_index = NULL, recorder = NULL, hosts_hash = NULL,
     bridge_lan_interface_id = bridge_wan_interface_id = 0, ndpi_struct = NULL,
     sprobe_interface = inline_interface = false,
     has_vlan_packets = false, has_ebpf_events = false,
@@ -275,7 +300,7 @@ void NetworkInterface::init() {
     next_idle_flow_purge = next_idle_host_purge = 0,
     running = false, customIftype = NULL, is_dynamic_interface = false,
     is_loopback = is_traffic_mirrored = false;
-    numVirtualInterfaces = 0, flowHashing = NULL,
+    flowHashing = NULL, flowHashingWorkers = false, num_dispatch_drops = 0,
     pcap_datalink_type = 0, mtuWarningShown = false,
     purge_idle_flows_hosts = true, id = (u_int8_t)-1,
     last_remote_pps = 0, last_remote_bps = 0,
@@ -300,12 +325,12 @@ void NetworkInterface::init() {
   hide_from_top = hide_from_top_shadow = NULL;
 
   gettimeofday(&last_frequent_reset, NULL);
-  frequentMacs = new FrequentTrafficItems(5);
-  frequentProtocols = new FrequentTrafficItems(5);
+  frequentMacs = new FrequentTrafficItems(frequent_mac_proto, 5);
+  frequentProtocols = new FrequentTrafficItems(frequent_pool_proto, 5);
   num_live_captures = 0;
   memset(live_captures, 0, sizeof(live_captures));
 
-  db = NULL;
+  db = NULL, columnar_db = NULL;
 #ifdef NTOPNG_PRO
   custom_app_stats = NULL;
   aggregated_flows_hash = NULL, flow_interfaces_stats = NULL;
@@ -467,6 +492,15 @@ void NetworkInterface::checkAggregationMode() {
       while((token = strtok_r(rest, ",", &rest)))
 	flowHashingIgnoredInterfaces.insert(atoi(token));
     }
+
+    if(flowHashingMode != flowhashing_none) {
+      rsp[0] = '\0';
+      flowHashingWorkers = (!ntop->getRedis()->get((char*)CONST_RUNTIME_PREFS_DYNAMIC_IFACE_WORKERS, rsp, sizeof(rsp)))
+	&& (rsp[0] == '1');
+
+      if(!flowHashing)
+	flowHashing = new SubInterfaceTable(flowHashingMode == flowhashing_vlan);
+    }
   }
 }
 
@@ -547,6 +581,7 @@ bool NetworkInterface::checkIdle() {
 
 void NetworkInterface::deleteDataStructures() {
   if(flows_hash)            { delete(flows_hash); flows_hash = NULL; }
+  if(flow_index)            { delete(flow_index); flow_index = NULL; } /* After the flows */
   if(hosts_hash)            { delete(hosts_hash); hosts_hash = NULL; }
   if(ases_hash)             { delete(ases_hash);  ases_hash = NULL;  }
   if(countries_hash)        { delete(countries_hash);  countries_hash = NULL;  }
@@ -605,18 +640,13 @@ NetworkInterface::~NetworkInterface() {
   if(discovery)      delete discovery;
   if(statsManager)   delete statsManager;
   if(alertsManager)  delete alertsManager;
+  if(recorder)       delete recorder;
   if(networkStats)   delete []networkStats;
   if(interfaceStats) delete interfaceStats;
 
   if(flowHashing) {
-    FlowHashing *current, *tmp;
-
-    HASH_ITER(hh, flowHashing, current, tmp) {
-      /* Interfaces are deleted by the main termination function */
-      HASH_DEL(flowHashing, current);
-      free(current);
-    }
-
+    /* Interfaces are deleted by the main termination function */
+    delete flowHashing;
     flowHashing = NULL;
   }
 
@@ -659,6 +689,8 @@ int NetworkInterface::dumpFlow(time_t when, Flow *f) {
   } else if(ntop->getPrefs()->do_dump_flows_on_nindex()) {
     return(dumpnIndexFlow(when, f) ? 0 : -1);
 #endif
+  } else if(ntop->getPrefs()->do_dump_flows_on_columnar()) {
+    return(dumpColumnarFlow(when, f) ? 0 : -1);
   } else {
     ntop->getTrace()->traceEvent(TRACE_WARNING, "Internal error");
     return(-1);
@@ -865,6 +897,21 @@ bool NetworkInterface::walker(u_int32_t *begin_slot,
 
 /* **************************************************** */
 
+bool NetworkInterface::flowsWalker(u_int32_t *begin_slot,
+				   bool walk_all,
+				   const FlowIndexQuery *q,
+				   bool (*walker_fn)(GenericHashEntry *h, void *user_data, bool *matched),
+				   void *user_data) {
+  if(flow_index && walk_all && q && (q->type != flow_index_none)) {
+    *begin_slot = 0;
+    return(flow_index->walk(q, walker_fn, user_data));
+  }
+
+  return(walker(begin_slot, walk_all, walker_flows, walker_fn, user_data));
+}
+
+/* **************************************************** */
+
 Flow* NetworkInterface::getFlow(Mac *srcMac, Mac *dstMac,
 				u_int16_t vlan_id,  u_int32_t deviceIP,
 				u_int16_t inIndex,  u_int16_t outIndex,
@@ -882,8 +929,8 @@ Flow* NetworkInterface::getFlow(Mac *srcMac, Mac *dstMac,
   if(vlan_id != 0)
     setSeenVlanTaggedPackets();
 
-  if((srcMac && Utils::macHash(srcMac->get_mac()) != 0)
-     || (dstMac && Utils::macHash(dstMac->get_mac()) != 0))
+  if((srcMac && !srcMac->isNull())
+     || (dstMac && !dstMac->isNull()))
     setSeenMacAddresses();
 
   PROFILING_SECTION_ENTER("NetworkInterface::getFlow: flows_hash->find", 5);
@@ -918,6 +965,9 @@ Flow* NetworkInterface::getFlow(Mac *srcMac, Mac *dstMac,
 
     if(flows_hash->add(ret)) {
       *src2dst_direction = true;
+
+      if(flow_index)
+	flow_index->add(ret);
     } else {
       delete ret;
       // ntop->getTrace()->traceEvent(TRACE_WARNING, "Too many flows");
@@ -985,74 +1035,75 @@ Flow* NetworkInterface::getFlow(Mac *srcMac, Mac *dstMac,
 
 /* **************************************************** */
 
-NetworkInterface* NetworkInterface::getSubInterface(u_int32_t criteria, bool parser_interface) {
+NetworkInterface* NetworkInterface::getSubInterface(u_int32_t criteria, bool parser_interface,
+						   SubInterfaceWorker **worker) {
 #ifndef HAVE_NEDGE
-  FlowHashing *h = NULL;
+  SubInterfaceEntry *h;
 
-  HASH_FIND_INT(flowHashing, &criteria, h);
+  if(flowHashing == NULL)
+    return(NULL);
+
+  h = flowHashing->get(criteria);
 
   if(h == NULL) {
     /* Interface not found */
 
-    if(numVirtualInterfaces < MAX_NUM_VIRTUAL_INTERFACES) {
-      if((h = (FlowHashing*)malloc(sizeof(FlowHashing))) != NULL) {
-	char buf[64], buf1[48];
-	const char *vIface_type;
-
-	h->criteria = criteria;
+    if((!flowHashing->isFull()) && flowHashing->canIndex(criteria)) {
+      char buf[64], buf1[48];
+      const char *vIface_type;
+      NetworkInterface *vIface;
 
-	switch(flowHashingMode) {
-	case flowhashing_vlan:
-	  vIface_type = CONST_INTERFACE_TYPE_VLAN;
-	  snprintf(buf, sizeof(buf), "%s [VLAN Id: %u]", ifname, criteria);
-	  // snprintf(buf, sizeof(buf), "VLAN Id %u", criteria);
-	  break;
+      switch(flowHashingMode) {
+      case flowhashing_vlan:
+	vIface_type = CONST_INTERFACE_TYPE_VLAN;
+	snprintf(buf, sizeof(buf), "%s [VLAN Id: %u]", ifname, criteria);
+	// snprintf(buf, sizeof(buf), "VLAN Id %u", criteria);
+	break;
 
-	case flowhashing_probe_ip:
-	  vIface_type = CONST_INTERFACE_TYPE_FLOW;
-	  snprintf(buf, sizeof(buf), "%s [Probe IP: %s]", ifname, Utils::intoaV4(criteria, buf1, sizeof(buf1)));
-	  // snprintf(buf, sizeof(buf), "Probe IP %s", Utils::intoaV4(criteria, buf1, sizeof(buf1)));
-	  break;
+      case flowhashing_probe_ip:
+	vIface_type = CONST_INTERFACE_TYPE_FLOW;
+	snprintf(buf, sizeof(buf), "%s [Probe IP: %s]", ifname, Utils::intoaV4(criteria, buf1, sizeof(buf1)));
+	// snprintf(buf, sizeof(buf), "Probe IP %s", Utils::intoaV4(criteria, buf1, sizeof(buf1)));
+	break;
 
-	case flowhashing_iface_idx:
-	case flowhashing_ingress_iface_idx:
-	  vIface_type = CONST_INTERFACE_TYPE_FLOW;
-	  snprintf(buf, sizeof(buf), "%s [If Idx: %u]", ifname, criteria);
-	  // snprintf(buf, sizeof(buf), "If Idx %u", criteria);
-	  break;
+      case flowhashing_iface_idx:
+      case flowhashing_ingress_iface_idx:
+	vIface_type = CONST_INTERFACE_TYPE_FLOW;
+	snprintf(buf, sizeof(buf), "%s [If Idx: %u]", ifname, criteria);
+	// snprintf(buf, sizeof(buf), "If Idx %u", criteria);
+	break;
 
-	case flowhashing_vrfid:
-	  vIface_type = CONST_INTERFACE_TYPE_FLOW;
-	  snprintf(buf, sizeof(buf), "%s [VRF Id: %u]", ifname, criteria);
-	  // snprintf(buf, sizeof(buf), "VRF Id %u", criteria);
-	  break;
+      case flowhashing_vrfid:
+	vIface_type = CONST_INTERFACE_TYPE_FLOW;
+	snprintf(buf, sizeof(buf), "%s [VRF Id: %u]", ifname, criteria);
+	// snprintf(buf, sizeof(buf), "VRF Id %u", criteria);
+	break;
 
-	default:
-	  free(h);
-	  return(NULL);
-	  break;
-	}
+      default:
+	return(NULL);
+	break;
+      }
 
-	if(parser_interface)
-	  h->iface = new ParserInterface(buf, vIface_type);
-	else
-	  h->iface = new NetworkInterface(buf, vIface_type);
-
-	if(h->iface) {
-	  if (ntop->registerInterface(h->iface))
-            ntop->initInterface(h->iface);
-	  h->iface->allocateNetworkStats();
-	  h->iface->setDynamicInterface();
-	  HASH_ADD_INT(flowHashing, criteria, h);
-	  numVirtualInterfaces++;
-	  ntop->getRedis()->set(CONST_STR_RELOAD_LISTS, (const char * const)"1");
-	}
-      } else
-	ntop->getTrace()->traceEvent(TRACE_WARNING, "Not enough memory");
+      if(parser_interface)
+	vIface = new ParserInterface(buf, vIface_type);
+      else
+	vIface = new NetworkInterface(buf, vIface_type);
+
+      if(vIface) {
+	if (ntop->registerInterface(vIface))
+	  ntop->initInterface(vIface);
+	vIface->allocateNetworkStats();
+	vIface->setDynamicInterface();
+	h = flowHashing->add(criteria, vIface, flowHashingWorkers);
+	ntop->getRedis()->set(CONST_STR_RELOAD_LISTS, (const char * const)"1");
+      }
     }
   }
 
-  if(h) return(h->iface);
+  if(h) {
+    *worker = h->worker;
+    return(h->iface);
+  }
 #endif
 
   return(NULL);
@@ -1104,37 +1155,48 @@ void NetworkInterface::processFlow(ZMQ_Flow *zflow) {
 
   if((!isDynamicInterface()) && (flowHashingMode != flowhashing_none)) {
     NetworkInterface *vIface = NULL, *vIfaceEgress = NULL;
+    SubInterfaceWorker *worker = NULL, *workerEgress = NULL;
+    const char *additional_fields_json = NULL; /* Serialized once for all the workers */
 
     switch(flowHashingMode) {
     case flowhashing_probe_ip:
-      vIface = getSubInterface((u_int32_t)zflow->core.deviceIP, true);
+      vIface = getSubInterface((u_int32_t)zflow->core.deviceIP, true, &worker);
       break;
 
     case flowhashing_iface_idx:
       if(flowHashingIgnoredInterfaces.find((u_int32_t)zflow->core.outIndex) == flowHashingIgnoredInterfaces.end())
-	 vIfaceEgress = getSubInterface((u_int32_t)zflow->core.outIndex, true);
+	 vIfaceEgress = getSubInterface((u_int32_t)zflow->core.outIndex, true, &workerEgress);
       /* No break HERE, want to get two interfaces, one for the ingress
          and one for the egress. */
 
     case flowhashing_ingress_iface_idx:
       if(flowHashingIgnoredInterfaces.find((u_int32_t)zflow->core.inIndex) == flowHashingIgnoredInterfaces.end())
-	vIface = getSubInterface((u_int32_t)zflow->core.inIndex, true);
+	vIface = getSubInterface((u_int32_t)zflow->core.inIndex, true, &worker);
       break;
 
     case flowhashing_vrfid:
-      vIface = getSubInterface((u_int32_t)zflow->core.vrfId, true);
+      vIface = getSubInterface((u_int32_t)zflow->core.vrfId, true, &worker);
       break;
 
     case flowhashing_vlan:
-      vIface = getSubInterface((u_int32_t)zflow->core.vlan_id, true);
+      vIface = getSubInterface((u_int32_t)zflow->core.vlan_id, true, &worker);
       break;
 
     default:
       break;
     }
 
-    if(vIface)       vIface->processFlow(zflow);
-    if(vIfaceEgress) vIfaceEgress->processFlow(zflow);
+    /* Sub-interfaces having a worker get their own copy of the flow */
+    if((worker && vIface) || (workerEgress && vIfaceEgress))
+      additional_fields_json = zflow->additional_fields ? json_object_to_json_string(zflow->additional_fields) : NULL;
+
+    if(vIface) {
+      if(worker) worker->enqueueFlow(zflow, additional_fields_json); else vIface->processFlow(zflow);
+    }
+
+    if(vIfaceEgress) {
+      if(workerEgress) workerEgress->enqueueFlow(zflow, additional_fields_json); else vIfaceEgress->processFlow(zflow);
+    }
 
     return;
   }
@@ -1294,7 +1356,8 @@ void NetworkInterface::processFlow(ZMQ_Flow *zflow) {
 		     zflow->core.last_switched);
   p.app_protocol = zflow->core.l7_proto.app_protocol, p.master_protocol = zflow->core.l7_proto.master_protocol;
   flow->setDetectedProtocol(p, true);
-  flow->setJSONInfo(json_object_to_json_string(zflow->additional_fields));
+  flow->setJSONInfo(zflow->additional_fields_json ? zflow->additional_fields_json
+		    : json_object_to_json_string(zflow->additional_fields));
 
   flow->updateInterfaceLocalStats(src2dst_direction,
 				  zflow->core.pkt_sampling_rate*(zflow->core.in_pkts+zflow->core.out_pkts),
@@ -1373,17 +1436,25 @@ bool NetworkInterface::processPacket(u_int32_t bridge_iface_idx,
   /* VLAN disaggregation */
   if((!isDynamicInterface()) && (flowHashingMode == flowhashing_vlan) && (vlan_id > 0)) {
     NetworkInterface *vIface;
+    SubInterfaceWorker *worker = NULL;
 
-    if((vIface = getSubInterface((u_int32_t)vlan_id, false)) != NULL) {
-      bool ret;
+    if((vIface = getSubInterface((u_int32_t)vlan_id, false, &worker)) != NULL) {
+      bool ret = true;
 
       vIface->setTimeLastPktRcvd(h->ts.tv_sec);
-      ret = vIface->processPacket(bridge_iface_idx,
-				  ingressPacket, when, packet_time,
-				  eth, vlan_id,
-				  iph, ip6, ipsize, rawsize,
-				  h, packet, ndpiProtocol,
-				  srcHost, dstHost, hostFlow);
+
+      if(worker)
+	/* Processed asynchronously: the packet is always passed */
+	worker->enqueuePacket(bridge_iface_idx, ingressPacket, packet_time,
+			      eth, vlan_id, iph, ip6, ipsize, rawsize,
+			      h, packet);
+      else
+	ret = vIface->processPacket(bridge_iface_idx,
+				    ingressPacket, when, packet_time,
+				    eth, vlan_id,
+				    iph, ip6, ipsize, rawsize,
+				    h, packet, ndpiProtocol,
+				    srcHost, dstHost, hostFlow);
 
       incStats(ingressPacket, when->tv_sec, ETHERTYPE_IP, NDPI_PROTOCOL_UNKNOWN,
 	       rawsize, 1, 24 /* 8 Preamble + 4 CRC + 12 IFG */);
@@ -1638,12 +1709,14 @@ bool NetworkInterface::processPacket(u_int32_t bridge_iface_idx,
 	struct ndpi_id_struct *cli = (struct ndpi_id_struct*)flow->get_cli_id();
 	struct ndpi_id_struct *srv = (struct ndpi_id_struct*)flow->get_srv_id();
 
+	PROFILING_SECTION_ENTER("NetworkInterface::processPacket: nDPI detection", 3);
 	if(flow->get_packets() >= NDPI_MIN_NUM_PACKETS) {
 	  flow->setDetectedProtocol(ndpi_detection_giveup(ndpi_struct, ndpi_flow, 1), false);
 	} else
 	  flow->setDetectedProtocol(ndpi_detection_process_packet(ndpi_struct, ndpi_flow,
 								  ip, ipsize, (u_int32_t)packet_time,
 								  cli, srv), false);
+	PROFILING_SECTION_EXIT(3);
       } else {
 	// FIX - only handle unfragmented packets
 	// ntop->getTrace()->traceEvent(TRACE_WARNING, "IP fragments are not handled yet!");
@@ -1893,6 +1966,9 @@ bool NetworkInterface::processPacket(u_int32_t bridge_iface_idx,
 /* **************************************************** */
 
 void NetworkInterface::purgeIdle(time_t when) {
+  if(recorder)
+    recorder->flushIdle(when);
+
   if(purge_idle_flows_hosts) {
     u_int n, m;
 
@@ -1908,11 +1984,12 @@ void NetworkInterface::purgeIdle(time_t when) {
   }
 
   if(flowHashing) {
-    FlowHashing *current, *tmp;
+    for(u_int16_t i = 0; i < flowHashing->getNumEntries(); i++) {
+      SubInterfaceEntry *e = flowHashing->getEntry(i);
 
-    HASH_ITER(hh, flowHashing, current, tmp) {
-      if(current->iface)
-	current->iface->purgeIdle(when);
+      /* Interfaces having a worker are purged by their own thread */
+      if(e->worker == NULL)
+	e->iface->purgeIdle(when);
     }
   }
 }
@@ -1991,6 +2068,9 @@ bool NetworkInterface::dissectPacket(u_int32_t bridge_iface_idx,
   pollQueuedeBPFEvents();
   reloadCustomCategories();
 
+  if(recorder)
+    recorder->recordPacket(h, packet);
+
 #if 0
   static u_int n = 0;
 
@@ -2588,6 +2668,9 @@ void NetworkInterface::startPacketPolling() {
 
 void NetworkInterface::shutdown() {
   running = false;
+
+  if(flowHashing)
+    flowHashing->stopWorkers();
 }
 
 /* **************************************************** */
@@ -2718,6 +2801,7 @@ static bool flow_sum_protos(GenericHashEntry *flow, void *user_data, bool *match
 void NetworkInterface::getnDPIStats(nDPIStats *stats, AddressTree *allowed_hosts,
 				    const char *host_ip, u_int16_t vlan_id) {
   ndpiStatsRetrieverData retriever;
+  FlowIndexQuery q;
   Host *h = NULL;
   u_int32_t begin_slot = 0;
   bool walk_all = true;
@@ -2727,7 +2811,8 @@ void NetworkInterface::getnDPIStats(nDPIStats *stats, AddressTree *allowed_hosts
 
   retriever.stats = stats;
   retriever.host = h;
-  walker(&begin_slot, walk_all, walker_flows, flow_sum_protos, (void*)&retriever);
+  q.type = h ? flow_index_host : flow_index_none, q.host = h, q.value = 0;
+  flowsWalker(&begin_slot, walk_all, &q, flow_sum_protos, (void*)&retriever);
 }
 
 /* **************************************************** */
@@ -2918,6 +3003,9 @@ void NetworkInterface::periodicStatsUpdate() {
     host_pools->updateStats(&tv);
 #endif
 
+  if(host_pools)
+    host_pools->purgeRetired();
+
   if(!ts_ring && TimeseriesRing::isRingEnabled(ntop->getPrefs()))
     ts_ring = new TimeseriesRing(this);
 
@@ -2983,6 +3071,37 @@ static bool update_host_host_pool_l7policy(GenericHashEntry *node, void *user_da
   return(false); /* false = keep on walking */
 }
 
+/* Refreshes only the hosts matching the changed pool networks and MACs */
+struct update_matching_host_pool {
+  struct update_host_pool_l7policy *update_host;
+  VlanAddressTree *members;
+};
+
+static bool update_matching_host_host_pool(GenericHashEntry *node, void *user_data, bool *matched) {
+  Host *h = (Host*)node;
+  struct update_matching_host_pool *up = (struct update_matching_host_pool*)user_data;
+  IpAddress *ip = h->get_ip();
+  bool found = false;
+
+  if(h->getMac() && (up->members->findMac(0, h->getMac()->get_mac()) != -1))
+    found = true;
+  else if(ip) {
+    if(ip->isIPv4()) {
+      u_int32_t v4 = ip->get_ipv4();
+
+      found = (up->members->findAddress(h->get_vlan_id(), AF_INET, &v4) != -1);
+    } else
+      found = (up->members->findAddress(h->get_vlan_id(), AF_INET6, ip->get_ipv6()) != -1);
+  }
+
+  if(found)
+    return(update_host_host_pool_l7policy(node, up->update_host, matched));
+
+  return(false); /* false = keep on walking */
+}
+
+/* **************************************************** */
+
 static bool update_l2_device_host_pool(GenericHashEntry *node, void *user_data, bool *matched) {
   Mac *m = (Mac*)node;
 
@@ -3048,6 +3167,97 @@ void NetworkInterface::refreshHostPools() {
 
 /* **************************************************** */
 
+/*
+  Refreshes the pool of the hosts and MACs affected by the changed members:
+  single hosts and MACs are looked up directly, whereas the hosts are walked
+  only when networks (or MACs with hosts attached) have changed.
+*/
+void NetworkInterface::refreshHostPools(pool_member_change_t *changes, u_int32_t num_changes) {
+  struct update_host_pool_l7policy update_host;
+  struct update_matching_host_pool update_matching;
+  VlanAddressTree *members = NULL;
+  bool walk_hosts = false, matched;
+  char addr[128];
+  u_int16_t vlan_id;
+
+  if(isView() || (num_changes == 0)) return;
+
+  update_host.update_pool_id = true;
+  update_host.update_l7policy = false;
+
+#ifdef NTOPNG_PRO
+  if(is_bridge_interface() && getL7Policer()) {
+    getL7Policer()->refreshL7Rules();
+    update_host.update_l7policy = true;
+  }
+#endif
+
+  for(u_int32_t i = 0; i < num_changes; i++) {
+    u_int32_t _mac[6];
+    char *slash;
+    bool is_v4;
+
+    if(!changes[i].key
+       || !HostPools::parseMember(changes[i].key, addr, sizeof(addr), &vlan_id))
+      continue;
+
+    if(sscanf(addr, "%02X:%02X:%02X:%02X:%02X:%02X",
+	      &_mac[0], &_mac[1], &_mac[2],
+	      &_mac[3], &_mac[4], &_mac[5]) == 6) {
+      u_int8_t mac[6];
+      Mac *m;
+
+      for(int j = 0; j < 6; j++) mac[j] = (u_int8_t)_mac[j];
+
+      if((m = getMac(mac, false)) != NULL) {
+	m->updateHostPool(false /* Not inline with traffic processing */);
+
+	/* MAC pools take precedence over IP pools: its hosts must be refreshed too */
+	if(m->getNumHosts() > 0) {
+	  if(members || (members = new(std::nothrow) VlanAddressTree()))
+	    members->addAddress(0, addr), walk_hosts = true;
+	}
+      }
+
+      continue;
+    }
+
+    is_v4 = (strchr(addr, ':') == NULL);
+    slash = strchr(addr, '/');
+
+    if((slash == NULL) ? is_v4 : !strcmp(slash, is_v4 ? "/32" : "/128")) {
+      /* Single host: no need to walk */
+      struct in6_addr a;
+      Host *h;
+
+      if(slash) *slash = '\0';
+
+      if((inet_pton(is_v4 ? AF_INET : AF_INET6, addr, &a) == 1)
+	 && ((h = getHost(addr, vlan_id)) != NULL))
+	update_host_host_pool_l7policy(h, &update_host, &matched);
+    } else if(members || (members = new(std::nothrow) VlanAddressTree()))
+      members->addAddress(vlan_id, addr), walk_hosts = true;
+  }
+
+  if(walk_hosts) {
+    u_int32_t begin_slot = 0;
+
+    members->compile();
+    update_matching.update_host = &update_host, update_matching.members = members;
+    hosts_hash->walk(&begin_slot, true /* walk_all */, update_matching_host_host_pool, &update_matching);
+  }
+
+  if(members)
+    delete members;
+
+#ifdef HAVE_NEDGE
+  if(update_host.update_l7policy)
+    updateFlowsL7Policy();
+#endif
+}
+
+/* **************************************************** */
+
 #ifdef HAVE_NEDGE
 
 static bool update_flow_l7_policy(GenericHashEntry *node, void *user_data, bool *matched) {
@@ -3201,8 +3411,8 @@ static bool find_host_by_name(GenericHashEntry *h, void *user_data, bool *matche
     if((host->get_name() == NULL) && host->get_ip()) {
       char ip_buf[32], name_buf[96];
       char *ipaddr = host->get_ip()->print(ip_buf, sizeof(ip_buf));
-      int rc = ntop->getRedis()->getAddress(ipaddr, name_buf, sizeof(name_buf),
-					    false /* Don't resolve it if not known */);
+      int rc = ntop->getAddressResolution()->getAddress(ipaddr, name_buf, sizeof(name_buf),
+							 false /* Don't resolve it if not known */);
 
       if(rc == 0 /* found */) host->setName(name_buf);
     }
@@ -3393,6 +3603,96 @@ bool NetworkInterface::getHostInfo(lua_State* vm,
 
 /* **************************************************** */
 
+/*
+  Pushes a table <host key> -> <host info> for the host keys (<ip>[@<vlan>])
+  found. Lookups are batched on the hosts hash and, when fields are
+  requested (fields != NULL), only those fields are materialized.
+*/
+void NetworkInterface::getHostsInfoBatch(lua_State* vm, AddressTree *allowed_hosts,
+					 const char **host_keys, u_int num_keys,
+					 const HostLuaField *fields, u_int num_fields) {
+  IpAddress *ips = NULL, **keys = NULL;
+  u_int16_t *vlan_ids = NULL;
+  Host **hosts = NULL;
+
+  lua_newtable(vm);
+
+  if(num_keys == 0)
+    return;
+
+  if(((ips = new(std::nothrow) IpAddress[num_keys]) == NULL)
+     || ((keys = (IpAddress**)calloc(num_keys, sizeof(IpAddress*))) == NULL)
+     || ((vlan_ids = (u_int16_t*)calloc(num_keys, sizeof(u_int16_t))) == NULL)
+     || ((hosts = (Host**)calloc(num_keys, sizeof(Host*))) == NULL)) {
+    ntop->getTrace()->traceEvent(TRACE_ERROR, "Not enough memory");
+    goto out;
+  }
+
+  disablePurge(false);
+
+  for(u_int i = 0; i < num_keys; i++) {
+    char buf[64], *at;
+    struct in6_addr a;
+
+    if(!host_keys[i])
+      continue;
+
+    snprintf(buf, sizeof(buf), "%s", host_keys[i]);
+
+    if((at = strchr(buf, '@')) != NULL)
+      *at = '\0', vlan_ids[i] = (u_int16_t)atoi(at + 1);
+
+    if((inet_pton(AF_INET, buf, &a) == 1) || (inet_pton(AF_INET6, buf, &a) == 1)) {
+      if(isView())
+	hosts[i] = getHost(buf, vlan_ids[i]); /* Views have no hosts hash */
+      else
+	ips[i].set(buf), keys[i] = &ips[i];
+    } else
+      hosts[i] = getHost(buf, vlan_ids[i]); /* Symbolic name */
+  }
+
+  if(!isView() && hosts_hash) {
+    /* Batch the numeric keys: getBatch() resets the results of the other keys */
+    Host **found = (Host**)calloc(num_keys, sizeof(Host*));
+
+    if(found) {
+      hosts_hash->getBatch(num_keys, vlan_ids, keys, found);
+
+      for(u_int i = 0; i < num_keys; i++)
+	if(keys[i]) hosts[i] = found[i];
+
+      free(found);
+    }
+  }
+
+  for(u_int i = 0; i < num_keys; i++) {
+    Host *h = hosts[i];
+
+    if(!h || !h->match(allowed_hosts) || Utils::maskHost(h->isLocalHost()))
+      continue;
+
+    if(fields) {
+      if(!h->luaProjection(vm, fields, num_fields))
+	continue;
+    } else
+      h->lua(vm, NULL, true, true, true, false);
+
+    lua_pushstring(vm, host_keys[i]);
+    lua_insert(vm, -2);
+    lua_settable(vm, -3);
+  }
+
+  enablePurge(false);
+
+ out:
+  if(hosts)    free(hosts);
+  if(vlan_ids) free(vlan_ids);
+  if(keys)     free(keys);
+  if(ips)      delete[] ips;
+}
+
+/* **************************************************** */
+
 bool NetworkInterface::checkPointHostCounters(lua_State* vm, u_int8_t checkpoint_id,
 					      char *host_ip, u_int16_t vlan_id,
 					      DetailsLevel details_level) {
@@ -3511,163 +3811,19 @@ struct flowHostRetriever {
 
   /* Paginator */
   Paginator *pag;
+
+  /* Search criteria compiled by sortFlows/sortHosts */
+  WalkerFilter filter;
+  FlowIndexQuery index_query; /* Flows only */
 };
 
 /* **************************************************** */
 
 static bool flow_matches(Flow *f, struct flowHostRetriever *retriever) {
-  int ndpi_proto, ndpi_cat;
-  u_int16_t port;
-  int16_t local_network_id;
-  u_int16_t vlan_id = 0, pool_filter;
-  u_int8_t ip_version;
-  u_int8_t *mac_filter;
-  LocationPolicy client_policy;
-  LocationPolicy server_policy;
-  bool unicast, unidirectional, alerted_flows;
-  u_int32_t asn_filter;
-  u_int32_t uid_filter;
-  u_int32_t pid_filter;
-  u_int32_t deviceIP;
-  u_int16_t inIndex, outIndex;
-#ifdef HAVE_NEDGE
-  bool filtered_flows;
-#endif
-
-  if(f && (!f->idle())) {
-    if(retriever->host
-       && (retriever->host != f->get_cli_host())
-       && (retriever->host != f->get_srv_host()))
-      return(false);
-
-    if(retriever->pag
-       && retriever->pag->l7protoFilter(&ndpi_proto)
-       && ((ndpi_proto == NDPI_PROTOCOL_UNKNOWN
-	    && (f->get_detected_protocol().app_protocol != ndpi_proto
-		|| f->get_detected_protocol().master_protocol != ndpi_proto))
-	   ||
-	   (ndpi_proto != NDPI_PROTOCOL_UNKNOWN
-	    && (f->get_detected_protocol().app_protocol != ndpi_proto
-		&& f->get_detected_protocol().master_protocol != ndpi_proto))))
-      return(false);
-
-    if(retriever->pag
-       && retriever->pag->l7categoryFilter(&ndpi_cat)
-       && f->get_protocol_category() != ndpi_cat)
-      return(false);
-
-    if(retriever->pag
-       && retriever->pag->ipVersion(&ip_version)
-       && (((ip_version == 4) && (f->get_cli_host() && !f->get_cli_host()->get_ip()->isIPv4()))
-	   || ((ip_version == 6) && (f->get_cli_host() && !f->get_cli_host()->get_ip()->isIPv6()))))
-      return(false);
-
-    if(retriever->pag
-       && retriever->pag->deviceIpFilter(&deviceIP)) {
-	if(f->getFlowDeviceIp() != deviceIP
-	   || (retriever->pag->inIndexFilter(&inIndex) && f->getFlowDeviceInIndex() != inIndex)
-	   || (retriever->pag->outIndexFilter(&outIndex) && f->getFlowDeviceOutIndex() != outIndex))
-	  return(false);
-    }
-
-    if(retriever->pag
-       && retriever->pag->asnFilter(&asn_filter)
-       && f->get_cli_host() && f->get_srv_host()
-       && f->get_cli_host()->get_asn() != asn_filter
-       && f->get_srv_host()->get_asn() != asn_filter)
-      return(false);
-
-    if(retriever->pag
-       && retriever->pag->uidFilter(&uid_filter)
-       && f->get_uid(true  /* client uid */) != uid_filter
-       && f->get_uid(false /* server uid */) != uid_filter)
-      return(false);
-
-    if(retriever->pag
-       && retriever->pag->pidFilter(&pid_filter)
-       && f->get_pid(true  /* client pid */) != pid_filter
-       && f->get_pid(false /* server pid */) != pid_filter)
-      return(false);
-
-    if(retriever->pag
-       && retriever->pag->portFilter(&port)
-       && f->get_cli_port() != port
-       && f->get_srv_port() != port)
-      return(false);
-
-    if(retriever->pag
-       && retriever->pag->localNetworkFilter(&local_network_id)
-       && f->get_cli_host() && f->get_srv_host()
-       && f->get_cli_host()->get_local_network_id() != local_network_id
-       && f->get_srv_host()->get_local_network_id() != local_network_id)
-      return(false);
-
-    if(retriever->pag
-       && retriever->pag->vlanIdFilter(&vlan_id)
-       && f->get_vlan_id() != vlan_id)
-      return(false);
-
-    if(retriever->pag
-       && retriever->pag->clientMode(&client_policy)
-       && f->get_cli_host()
-       && (((client_policy == location_local_only) && (!f->get_cli_host()->isLocalHost()))
-	   || ((client_policy == location_remote_only) && (f->get_cli_host()->isLocalHost()))))
-      return(false);
-
-    if(retriever->pag
-       && retriever->pag->serverMode(&server_policy)
-       && (((server_policy == location_local_only) && (!f->get_srv_host()->isLocalHost()))
-	   || ((server_policy == location_remote_only) && (f->get_srv_host()->isLocalHost()))))
-      return(false);
-
-    if(retriever->pag
-       && retriever->pag->alertedFlows(&alerted_flows)
-       && ((alerted_flows && f->getFlowStatus() == status_normal)
-	   || (!alerted_flows && f->getFlowStatus() != status_normal)))
-      return(false);
-
-#ifdef HAVE_NEDGE
-    if(retriever->pag
-       && retriever->pag->filteredFlows(&filtered_flows)
-       && ((filtered_flows && f->isPassVerdict())
-       || (!filtered_flows && !f->isPassVerdict())))
-      return(false);
-#endif
-
-    if(retriever->pag
-       && retriever->pag->unidirectionalTraffic(&unidirectional)
-       && ((unidirectional && (f->get_packets() > 0) && (f->get_packets_cli2srv() > 0) && (f->get_packets_srv2cli() > 0))
-	   || (!unidirectional && (f->get_packets() > 0) && ((f->get_packets_cli2srv() == 0) || (f->get_packets_srv2cli() == 0)))))
-      return(false);
-
-    /* Unicast: at least one between client and server is unicast address */
-    if(retriever->pag
-       && retriever->pag->unicastTraffic(&unicast)
-       && ((unicast && ((f->get_cli_host() && (f->get_cli_host()->get_ip()->isMulticastAddress() || f->get_cli_host()->get_ip()->isBroadcastAddress()))
-			|| (f->get_srv_host() && (f->get_srv_host()->get_ip()->isMulticastAddress() || f->get_srv_host()->get_ip()->isBroadcastAddress()))))
-	   || (!unicast && ((f->get_cli_host() && (!f->get_cli_host()->get_ip()->isMulticastAddress() && !f->get_cli_host()->get_ip()->isBroadcastAddress()))
-			    && (f->get_srv_host() && (!f->get_srv_host()->get_ip()->isMulticastAddress() && !f->get_srv_host()->get_ip()->isBroadcastAddress()))))))
-      return(false);
-
-    /* Pool filter */
-    if(retriever->pag
-       && retriever->pag->poolFilter(&pool_filter)
-       && !((f->get_cli_host() && f->get_cli_host()->get_host_pool() == pool_filter)
-	      || (f->get_srv_host() && f->get_srv_host()->get_host_pool() == pool_filter)))
-      return(false);
-
-    /* Mac filter - NOTE: must stay below the vlan_id filter */
-    if(retriever->pag
-       && retriever->pag->macFilter(&mac_filter)
-       && !((f->get_cli_host() && f->get_cli_host()->getMac() && f->get_cli_host()->getMac()->equal(mac_filter))
-	      || (f->get_srv_host() && f->get_srv_host()->getMac() && f->get_srv_host()->getMac()->equal(mac_filter))))
-      return(false);
-
-    if(f->match(retriever->allowed_hosts))
-      return(true); /* match */
-  }
-
-  return(false);
+  return(f
+	 && (!f->idle())
+	 && retriever->filter.matchFlow(f)
+	 && f->match(retriever->allowed_hosts));
 }
 
 /* **************************************************** */
@@ -3735,29 +3891,7 @@ static bool host_search_walker(GenericHashEntry *he, void *user_data, bool *matc
   if(r->actNumEntries >= r->maxNumEntries)
     return(true); /* Limit reached */
 
-  if(!h || h->idle() || !h->match(r->allowed_hosts))
-    return(false);
-
-  if((r->location == location_local_only      && !h->isLocalHost())                       ||
-     (r->location == location_remote_only     && h->isLocalHost())                        ||
-     ((r->vlan_id != ((u_int16_t)-1)) && (r->vlan_id != h->get_vlan_id()))                ||
-     ((r->ndpi_proto != -1) && (h->get_ndpi_stats()->getProtoBytes(r->ndpi_proto) == 0))  ||
-     ((r->asnFilter != (u_int32_t)-1)     && (r->asnFilter       != h->get_asn()))        ||
-     ((r->networkFilter != -2) && (r->networkFilter != h->get_local_network_id()))        ||
-     (r->mac           && (h->getMac()) && (!h->getMac()->equal(r->mac)))    ||
-     ((r->poolFilter != (u_int16_t)-1)    && (r->poolFilter    != h->get_host_pool()))    ||
-     (r->country  && strlen(r->country)  && strcmp(h->get_country(buf, sizeof(buf)), r->country)) ||
-     (r->osFilter && strlen(r->osFilter) && (!h->get_os()      || strcmp(h->get_os(), r->osFilter)))     ||
-     (r->blacklistedHosts && !h->isBlacklisted())     ||
-     (r->anomalousOnly && !h->hasAnomalies())         ||
-     (r->hideTopHidden && h->isHiddenFromTop())       ||
-     (r->traffic_type == traffic_type_one_way && !h->isOneWayTraffic())       ||
-     (r->traffic_type == traffic_type_bidirectional && h->isOneWayTraffic())  ||
-#ifdef NTOPNG_PRO
-     (r->filteredHosts && !h->hasBlockedTraffic()) ||
-#endif
-     (r->ipVersionFilter && (((r->ipVersionFilter == 4) && (!h->get_ip()->isIPv4()))
-			     || ((r->ipVersionFilter == 6) && (!h->get_ip()->isIPv6())))))
+  if(!h || h->idle() || !r->filter.matchHost(h) || !h->match(r->allowed_hosts))
     return(false); /* false = keep on walking */
 
   r->elems[r->actNumEntries].hostValue = h;
@@ -3832,7 +3966,7 @@ static bool host_search_walker(GenericHashEntry *he, void *user_data, bool *matc
     /* Criteria */
   case column_uploaders:      r->elems[r->actNumEntries++].numericValue = h->getNumBytesSent(); break;
   case column_downloaders:    r->elems[r->actNumEntries++].numericValue = h->getNumBytesRcvd(); break;
-  case column_unknowers:      r->elems[r->actNumEntries++].numericValue = h->get_ndpi_stats()->getProtoBytes(NDPI_PROTOCOL_UNKNOWN); break;
+  case column_unknowers:      r->elems[r->actNumEntries++].numericValue = h->get_ndpi_proto_bytes(NDPI_PROTOCOL_UNKNOWN); break;
   case column_incomingflows:  r->elems[r->actNumEntries++].numericValue = h->getNumIncomingFlows(); break;
   case column_outgoingflows:  r->elems[r->actNumEntries++].numericValue = h->getNumOutgoingFlows(); break;
 
@@ -4153,6 +4287,142 @@ void NetworkInterface::enablePurge(bool on_flows) {
 
 /* **************************************************** */
 
+struct viewWalkTask {
+  NetworkInterface *iface;
+  WalkerType wtype;
+  bool (*walker_fn)(GenericHashEntry *h, void *user_data, bool *matched);
+  int (*sorter)(const void *_a, const void *_b);
+  struct flowHostRetriever retriever; /* Private copy: elems is a slice of the view results */
+  u_int32_t next; /* Merge cursor */
+};
+
+static u_int32_t getWalkerHashSize(NetworkInterface *iface, WalkerType wtype) {
+  switch(wtype) {
+  case walker_hosts:     return(iface->getHostsHashSize());
+  case walker_flows:     return(iface->getFlowsHashSize());
+  case walker_macs:      return(iface->getMacsHashSize());
+  case walker_ases:      return(iface->getASesHashSize());
+  case walker_countries: return(iface->getCountriesHashSize());
+  case walker_vlans:     return(iface->getVLANsHashSize());
+  }
+
+  return(0);
+}
+
+static bool retrieverWalk(NetworkInterface *iface, u_int32_t *begin_slot, bool walk_all, WalkerType wtype,
+			  bool (*walker_fn)(GenericHashEntry *h, void *user_data, bool *matched),
+			  struct flowHostRetriever *retriever) {
+  if(wtype == walker_flows)
+    return(iface->flowsWalker(begin_slot, walk_all, &retriever->index_query, walker_fn, (void*)retriever));
+
+  return(iface->walker(begin_slot, walk_all, wtype, walker_fn, (void*)retriever));
+}
+
+static void* viewWalkTaskFctn(void *ptr) {
+  struct viewWalkTask *t = (struct viewWalkTask*)ptr;
+  u_int32_t begin_slot = 0;
+
+  retrieverWalk(t->iface, &begin_slot, true /* walk_all */, t->wtype, t->walker_fn, &t->retriever);
+  qsort(t->retriever.elems, t->retriever.actNumEntries, sizeof(struct flowHostRetrieveList), t->sorter);
+
+  return(NULL);
+}
+
+/* **************************************************** */
+
+void NetworkInterface::walkAndSort(u_int32_t *begin_slot, bool walk_all, WalkerType wtype,
+				   bool (*walker_fn)(GenericHashEntry *h, void *user_data, bool *matched),
+				   struct flowHostRetriever *retriever,
+				   int (*sorter)(const void *_a, const void *_b)) {
+  /* Views walk their sub-interfaces in parallel when there is enough to walk */
+  if(isView() && walk_all && (numSubInterfaces > 1)
+     && (getWalkerHashSize(this, wtype) >= VIEW_PARALLEL_WALK_MIN_ENTRIES)) {
+    parallelWalkAndSort(wtype, walker_fn, retriever, sorter);
+    return;
+  }
+
+  retrieverWalk(this, begin_slot, walk_all, wtype, walker_fn, retriever);
+  qsort(retriever->elems, retriever->actNumEntries, sizeof(struct flowHostRetrieveList), sorter);
+}
+
+/* **************************************************** */
+
+void NetworkInterface::parallelWalkAndSort(WalkerType wtype,
+					   bool (*walker_fn)(GenericHashEntry *h, void *user_data, bool *matched),
+					   struct flowHostRetriever *retriever,
+					   int (*sorter)(const void *_a, const void *_b)) {
+  struct viewWalkTask tasks[MAX_NUM_VIEW_INTERFACES];
+  pthread_t threads[MAX_NUM_VIEW_INTERFACES];
+  bool started[MAX_NUM_VIEW_INTERFACES];
+  struct flowHostRetrieveList *merged;
+  u_int32_t offset = 0;
+
+  if((merged = (struct flowHostRetrieveList*)calloc(sizeof(struct flowHostRetrieveList),
+						     retriever->maxNumEntries)) == NULL) {
+    /* Fallback to the sequential walk */
+    u_int32_t begin_slot = 0;
+
+    retrieverWalk(this, &begin_slot, true, wtype, walker_fn, retriever);
+    qsort(retriever->elems, retriever->actNumEntries, sizeof(struct flowHostRetrieveList), sorter);
+    return;
+  }
+
+  /*
+    Every sub-interface fills and sorts its own slice of the results,
+    sized after its hash so that the slices never exceed maxNumEntries
+  */
+  for(u_int8_t s = 0; s < numSubInterfaces; s++) {
+    struct viewWalkTask *t = &tasks[s];
+    u_int32_t len = min_val(getWalkerHashSize(subInterfaces[s], wtype), retriever->maxNumEntries - offset);
+
+    t->iface = subInterfaces[s], t->wtype = wtype, t->walker_fn = walker_fn, t->sorter = sorter;
+    memcpy(&t->retriever, retriever, sizeof(struct flowHostRetriever));
+    t->retriever.elems = &retriever->elems[offset], t->retriever.maxNumEntries = len;
+    t->retriever.actNumEntries = 0, t->next = 0;
+    offset += len;
+
+    started[s] = (pthread_create(&threads[s], NULL, viewWalkTaskFctn, (void*)t) == 0);
+
+    if(!started[s])
+      viewWalkTaskFctn((void*)t);
+  }
+
+  for(u_int8_t s = 0; s < numSubInterfaces; s++) {
+    if(started[s])
+      pthread_join(threads[s], NULL);
+  }
+
+  /*
+    k-way merge of the sorted slices. There are at most
+    MAX_NUM_VIEW_INTERFACES slices: a linear scan of the heads is
+    cheaper than a heap here.
+  */
+  retriever->actNumEntries = 0;
+
+  while(true) {
+    struct viewWalkTask *best = NULL;
+
+    for(u_int8_t s = 0; s < numSubInterfaces; s++) {
+      struct viewWalkTask *t = &tasks[s];
+
+      if((t->next < t->retriever.actNumEntries)
+	 && ((best == NULL)
+	     || (sorter(&t->retriever.elems[t->next], &best->retriever.elems[best->next]) < 0)))
+	best = t;
+    }
+
+    if(best == NULL)
+      break;
+
+    merged[retriever->actNumEntries++] = best->retriever.elems[best->next++];
+  }
+
+  free(retriever->elems);
+  retriever->elems = merged;
+}
+
+/* **************************************************** */
+
 int NetworkInterface::sortFlows(u_int32_t *begin_slot,
 				bool walk_all,
 				struct flowHostRetriever *retriever,
@@ -4167,6 +4437,8 @@ int NetworkInterface::sortFlows(u_int32_t *begin_slot,
 
   retriever->pag = p;
   retriever->host = host, retriever->location = location_all;
+  retriever->filter.compileFlowFilter(p, host);
+  retriever->filter.getFlowIndexQuery(&retriever->index_query);
   retriever->ndpi_proto = -1;
   retriever->actNumEntries = 0, retriever->maxNumEntries = getFlowsHashSize(), retriever->allowed_hosts = allowed_hosts;
   retriever->elems = (struct flowHostRetrieveList*)calloc(sizeof(struct flowHostRetrieveList), retriever->maxNumEntries);
@@ -4191,9 +4463,7 @@ int NetworkInterface::sortFlows(u_int32_t *begin_slot,
   }
 
   // make sure the caller has disabled the purge!!
-  walker(begin_slot, walk_all,  walker_flows, flow_search_walker, (void*)retriever);
-
-  qsort(retriever->elems, retriever->actNumEntries, sizeof(struct flowHostRetrieveList), sorter);
+  walkAndSort(begin_slot, walk_all, walker_flows, flow_search_walker, retriever, sorter);
 
   return(retriever->actNumEntries);
 }
@@ -4277,6 +4547,68 @@ int NetworkInterface::getFlows(lua_State* vm,
 
 /* **************************************************** */
 
+int NetworkInterface::getFlows(JSONStream *s,
+			       AddressTree *allowed_hosts,
+			       Host *host,
+			       Paginator *p) {
+  struct flowHostRetriever retriever;
+  char sortColumn[32];
+  DetailsLevel highDetails;
+  u_int32_t begin_slot = 0, num_flows = 0, num_rows = 0;
+
+  if(p == NULL) {
+    ntop->getTrace()->traceEvent(TRACE_WARNING, "Unable to return results with a NULL paginator");
+    return(-1);
+  }
+
+  snprintf(sortColumn, sizeof(sortColumn), "%s", p->sortColumn());
+  if(! p->getDetailsLevel(&highDetails))
+    highDetails = p->detailedResults() ? details_high : details_normal;
+
+  disablePurge(true);
+
+  if(sortFlows(&begin_slot, true /* walk all */, &retriever, allowed_hosts, host, p, sortColumn) < 0) {
+    enablePurge(true);
+    return -1;
+  }
+
+  /*
+    As for the Lua listings, the sorted flows are serialized right after
+    the walk: the page is kept in memory and only sent to the client
+    once the flows are no longer referenced, as a slow client would
+    otherwise leave time for them to be purged.
+  */
+  s->hold();
+  s->beginObject();
+  s->beginArray("flows");
+
+  for(u_int32_t i = 0; i < retriever.actNumEntries; i++) {
+    Flow *f = retriever.elems[p->a2zSortOrder() ? i : (retriever.actNumEntries - 1 - i)].flow;
+
+    if(!f->isJSONWritable())
+      continue;
+
+    if((num_flows >= p->toSkip()) && (num_rows < p->maxHits()))
+      f->writeJSON(s, highDetails), num_rows++;
+
+    num_flows++;
+  }
+
+  s->endArray();
+  s->addUint64("numFlows", num_flows);
+  s->endObject();
+
+  enablePurge(true);
+
+  if(retriever.elems) free(retriever.elems);
+
+  s->release();
+
+  return(num_flows);
+}
+
+/* **************************************************** */
+
 int NetworkInterface::getFlowsGroup(lua_State* vm,
 			       AddressTree *allowed_hosts,
 			       Paginator *p,
@@ -4358,10 +4690,12 @@ int NetworkInterface::dropFlowsTraffic(AddressTree *allowed_hosts, Paginator *p)
 
   retriever.allowed_hosts = allowed_hosts;
   retriever.pag = p;
+  retriever.filter.compileFlowFilter(p, NULL);
+  retriever.filter.getFlowIndexQuery(&retriever.index_query);
 
   disablePurge(true);
 
-  walker(&begin_slot, walk_all,  walker_flows, flow_drop_walker, (void*)&retriever);
+  flowsWalker(&begin_slot, walk_all, &retriever.index_query, flow_drop_walker, (void*)&retriever);
 
   enablePurge(true);
 
@@ -4419,6 +4753,10 @@ int NetworkInterface::sortHosts(u_int32_t *begin_slot,
     retriever->ndpi_proto = proto_filter,
     retriever->traffic_type = traffic_type_filter,
     retriever->maxNumEntries = maxHits;
+  retriever->filter.compileHostFilter(location, vlan_id, proto_filter, asnFilter, networkFilter,
+				      retriever->mac, pool_filter, countryFilter, osFilter,
+				      blacklisted_hosts, anomalousOnly, hide_top_hidden,
+				      traffic_type_filter, filtered_hosts, ipver_filter);
   retriever->elems = (struct flowHostRetrieveList*)calloc(sizeof(struct flowHostRetrieveList), retriever->maxNumEntries);
 
   if(retriever->elems == NULL) {
@@ -4454,9 +4792,7 @@ int NetworkInterface::sortHosts(u_int32_t *begin_slot,
   }
 
   // make sure the caller has disabled the purge!!
-  walker(begin_slot, walk_all, walker_hosts, host_search_walker, (void*)retriever);
-
-  qsort(retriever->elems, retriever->actNumEntries, sizeof(struct flowHostRetrieveList), sorter);
+  walkAndSort(begin_slot, walk_all, walker_hosts, host_search_walker, retriever, sorter);
 
   return(retriever->actNumEntries);
 }
@@ -4510,9 +4846,7 @@ int NetworkInterface::sortMacs(u_int32_t *begin_slot,
   else ntop->getTrace()->traceEvent(TRACE_WARNING, "Unknown sort column %s", sortColumn), sorter = numericSorter;
 
   // make sure the caller has disabled the purge!!
-  walker(begin_slot, walk_all, walker_macs, mac_search_walker, (void*)retriever);
-
-  qsort(retriever->elems, retriever->actNumEntries, sizeof(struct flowHostRetrieveList), sorter);
+  walkAndSort(begin_slot, walk_all, walker_macs, mac_search_walker, retriever, sorter);
 
   return(retriever->actNumEntries);
 }
@@ -4550,9 +4884,7 @@ int NetworkInterface::sortASes(struct flowHostRetriever *retriever, char *sortCo
   else ntop->getTrace()->traceEvent(TRACE_WARNING, "Unknown sort column %s", sortColumn), sorter = numericSorter;
 
   // make sure the caller has disabled the purge!!
-  walker(&begin_slot, walk_all,  walker_ases, as_search_walker, (void*)retriever);
-
-  qsort(retriever->elems, retriever->actNumEntries, sizeof(struct flowHostRetrieveList), sorter);
+  walkAndSort(&begin_slot, walk_all, walker_ases, as_search_walker, retriever, sorter);
 
   return(retriever->actNumEntries);
 }
@@ -4588,9 +4920,7 @@ int NetworkInterface::sortCountries(struct flowHostRetriever *retriever,
   else ntop->getTrace()->traceEvent(TRACE_WARNING, "Unknown sort column %s", sortColumn), sorter = numericSorter;
 
   // make sure the caller has disabled the purge!!
-  walker(&begin_slot, walk_all,  walker_countries, country_search_walker, (void*)retriever);
-
-  qsort(retriever->elems, retriever->actNumEntries, sizeof(struct flowHostRetrieveList), sorter);
+  walkAndSort(&begin_slot, walk_all, walker_countries, country_search_walker, retriever, sorter);
 
   return(retriever->actNumEntries);
 }
@@ -4627,15 +4957,33 @@ int NetworkInterface::sortVLANs(struct flowHostRetriever *retriever, char *sortC
   else ntop->getTrace()->traceEvent(TRACE_WARNING, "Unknown sort column %s", sortColumn), sorter = numericSorter;
 
   // make sure the caller has disabled the purge!!
-  walker(&begin_slot, walk_all,  walker_vlans, vlan_search_walker, (void*)retriever);
-
-  qsort(retriever->elems, retriever->actNumEntries, sizeof(struct flowHostRetrieveList), sorter);
+  walkAndSort(&begin_slot, walk_all, walker_vlans, vlan_search_walker, retriever, sorter);
 
   return(retriever->actNumEntries);
 }
 
 /* **************************************************** */
 
+// it's up to us to clean sorted data
+static void freeHostsRetriever(struct flowHostRetriever *retriever) {
+  // make sure first to free elements in case a string sorter has been used
+  if(retriever->sorter == column_name
+     || retriever->sorter == column_country
+     || retriever->sorter == column_os) {
+    for(u_int i=0; i<retriever->maxNumEntries; i++)
+      if(retriever->elems[i].stringValue)
+	free(retriever->elems[i].stringValue);
+  } else if(retriever->sorter == column_local_network)
+    for(u_int i=0; i<retriever->maxNumEntries; i++)
+      if(retriever->elems[i].ipValue)
+	delete retriever->elems[i].ipValue;
+
+  // finally free the elements regardless of the sorted kind
+  if(retriever->elems) free(retriever->elems);
+}
+
+/* **************************************************** */
+
 int NetworkInterface::getActiveHostsList(lua_State* vm,
 					 u_int32_t *begin_slot,
 					 bool walk_all,
@@ -4712,24 +5060,82 @@ int NetworkInterface::getActiveHostsList(lua_State* vm,
 
 
   enablePurge(false);
+  freeHostsRetriever(&retriever);
 
-  // it's up to us to clean sorted data
-  // make sure first to free elements in case a string sorter has been used
-  if(retriever.sorter == column_name
-     || retriever.sorter == column_country
-     || retriever.sorter == column_os) {
-    for(u_int i=0; i<retriever.maxNumEntries; i++)
-      if(retriever.elems[i].stringValue)
-	free(retriever.elems[i].stringValue);
-  } else if(retriever.sorter == column_local_network)
-    for(u_int i=0; i<retriever.maxNumEntries; i++)
-      if(retriever.elems[i].ipValue)
-	delete retriever.elems[i].ipValue;
+  return(retriever.actNumEntries);
+}
 
-  // finally free the elements regardless of the sorted kind
-  if(retriever.elems) free(retriever.elems);
+/* **************************************************** */
 
-  return(retriever.actNumEntries);
+int NetworkInterface::getActiveHostsList(JSONStream *s,
+					 AddressTree *allowed_hosts,
+					 Paginator *p,
+					 LocationPolicy location) {
+  struct flowHostRetriever retriever;
+  u_int32_t begin_slot = 0, num_hosts = 0, num_rows = 0;
+  char *country = NULL, mac_buf[32], *mac = NULL, sortColumn[32];
+  u_int8_t *mac_filter, ipver = 0;
+  u_int16_t vlan_id = (u_int16_t)-1, pool_id = (u_int16_t)-1;
+  u_int32_t asn = (u_int32_t)-1;
+  int16_t network = -2 /* any */;
+  int ndpi_proto = -1;
+  DetailsLevel details_level = details_normal;
+
+  if(p == NULL) {
+    ntop->getTrace()->traceEvent(TRACE_WARNING, "Unable to return results with a NULL paginator");
+    return(-1);
+  }
+
+  p->countryFilter(&country), p->vlanIdFilter(&vlan_id), p->asnFilter(&asn);
+  p->poolFilter(&pool_id), p->ipVersion(&ipver), p->l7protoFilter(&ndpi_proto);
+  p->localNetworkFilter(&network), p->getDetailsLevel(&details_level);
+
+  if(p->macFilter(&mac_filter))
+    mac = Utils::formatMac(mac_filter, mac_buf, sizeof(mac_buf));
+
+  snprintf(sortColumn, sizeof(sortColumn), "%s", p->sortColumn());
+
+  disablePurge(false);
+
+  if(sortHosts(&begin_slot, true /* walk all */,
+	       &retriever, 0 /* bridge_iface_idx */,
+	       allowed_hosts, details_level >= details_high, location,
+	       country, mac, vlan_id, NULL /* os */,
+	       asn, network, pool_id, false /* filtered */, false /* blacklisted */,
+	       false /* hide top hidden */, false /* anomalous */,
+	       ipver, ndpi_proto, traffic_type_all,
+	       sortColumn) < 0) {
+    enablePurge(false);
+    return(-1);
+  }
+
+  /* Serialized in memory before being sent, see getFlows() */
+  s->hold();
+  s->beginObject();
+  s->beginArray("hosts");
+
+  for(u_int32_t i = 0; i < retriever.actNumEntries; i++) {
+    Host *h = retriever.elems[p->a2zSortOrder() ? i : (retriever.actNumEntries - 1 - i)].hostValue;
+
+    if(!h->isJSONWritable())
+      continue;
+
+    if((num_hosts >= p->toSkip()) && (num_rows < p->maxHits()))
+      h->writeJSON(s, details_level >= details_high), num_rows++;
+
+    num_hosts++;
+  }
+
+  s->endArray();
+  s->addUint64("numHosts", num_hosts);
+  s->endObject();
+
+  enablePurge(false);
+  freeHostsRetriever(&retriever);
+
+  s->release();
+
+  return(num_hosts);
 }
 
 /* **************************************************** */
@@ -4993,7 +5399,7 @@ u_int64_t NetworkInterface::getNumBytes() {
 /* **************************************************** */
 
 u_int32_t NetworkInterface::getNumPacketDrops() {
-  return(!isDynamicInterface() ? getNumDroppedPackets() : 0);
+  return(!isDynamicInterface() ? getNumDroppedPackets() : num_dispatch_drops);
 };
 
 /* **************************************************** */
@@ -5310,6 +5716,15 @@ void NetworkInterface::lua(lua_State *vm) {
   if(host_pools)
     host_pools->lua(vm);
 
+  if(flow_index)
+    flow_index->lua(vm);
+
+  if(recorder)
+    recorder->lua(vm);
+
+  if(alertsManager)
+    alertsManager->luaFlowAlertsQueue(vm);
+
 #ifdef NTOPNG_PRO
   if(custom_app_stats)
     custom_app_stats->lua(vm);
@@ -5414,22 +5829,30 @@ Vlan* NetworkInterface::getVlan(u_int16_t vlanId,
 AutonomousSystem* NetworkInterface::getAS(IpAddress *ipa,
 					  bool createIfNotPresent) {
   AutonomousSystem *ret = NULL;
+  u_int32_t asn;
+  char *asname = NULL;
 
   if(ipa == NULL) return(NULL);
 
+  /*
+    Resolve the ASN once, also when looking into the view sub-interfaces.
+    The AS name is only needed, within the same lookup, to create the AS.
+  */
+  ntop->getGeolocation()->getAS(ipa, &asn, createIfNotPresent ? &asname : NULL);
+
   if(!isView())
-    ret = ases_hash->get(ipa);
+    ret = ases_hash->get(asn);
   else {
     for(u_int8_t s = 0; s<numSubInterfaces; s++) {
-      if((ret = subInterfaces[s]->get_ases_hash()->get(ipa)) != NULL)
+      if((ret = subInterfaces[s]->get_ases_hash()->get(asn)) != NULL)
 	break;
     }
   }
 
   if((ret == NULL) && createIfNotPresent) {
     try {
-      if((ret = new AutonomousSystem(this, ipa)) != NULL)
-	ases_hash->add(ret);
+      if((ret = new AutonomousSystem(this, asn, asname)) != NULL)
+	ases_hash->add(ret), asname = NULL;
     } catch(std::bad_alloc& ba) {
       static bool oom_warning_sent = false;
 
@@ -5438,10 +5861,12 @@ AutonomousSystem* NetworkInterface::getAS(IpAddress *ipa,
 	oom_warning_sent = true;
       }
 
-      return(NULL);
+      ret = NULL;
     }
   }
 
+  if(asname) free(asname); /* Not passed to a new AS */
+
   return(ret);
 }
 
@@ -6041,6 +6466,8 @@ void NetworkInterface::reloadHideFromTop(bool refreshHosts) {
 
   if(networks) free(networks);
 
+  new_tree->compile();
+
   if(hide_from_top_shadow) delete(hide_from_top_shadow);
   hide_from_top_shadow = hide_from_top;
   hide_from_top = new_tree;
@@ -6061,7 +6488,7 @@ bool NetworkInterface::isHiddenFromTop(Host *host) {
 
   AddressTree *tree = vlan_addrtree->getAddressTree(host->getVlanId());
 
-  return host->get_ip()->findAddress(tree);
+  return(tree ? host->get_ip()->match(tree) : false);
 }
 
 /* **************************************** */
@@ -6292,12 +6719,17 @@ int NetworkInterface::getActiveMacManufacturers(lua_State* vm,
   struct flowHostRetriever retriever;
   u_int32_t begin_slot = 0;
   bool walk_all = true;
+  MacManufacturers *manufacturers = ntop->getMacManufacturers();
+  u_int32_t *ouis = NULL, *counts = NULL, num_strings;
+  int32_t *ids = NULL;
+  int k = 0;
 
   disablePurge(false);
 
+  /* Sorting by MAC also sorts by OUI, which is what the bulk lookup needs */
   if(sortMacs(&begin_slot, walk_all,
 	      &retriever, bridge_iface_idx, sourceMacsOnly,
-	      dhcpMacsOnly, NULL, (char*)"column_manufacturer",
+	      dhcpMacsOnly, NULL, (char*)"column_mac",
 	      (u_int16_t)-1, devtype_filter, location_filter) < 0) {
     enablePurge(false);
     return -1;
@@ -6305,32 +6737,33 @@ int NetworkInterface::getActiveMacManufacturers(lua_State* vm,
 
   lua_newtable(vm);
 
-  const char *cur_manuf = NULL;
-  u_int32_t cur_count = 0;
-  int k = 0;
+  num_strings = manufacturers ? manufacturers->getNumStrings() : 0;
 
-  for(int i = 0; i<(int)retriever.actNumEntries && k < (int)maxHits; i++) {
-    Mac *m = retriever.elems[i].macValue;
+  if((num_strings > 0) && (retriever.actNumEntries > 0)
+     && ((ouis = (u_int32_t*)malloc(retriever.actNumEntries * sizeof(u_int32_t))) != NULL)
+     && ((ids = (int32_t*)malloc(retriever.actNumEntries * sizeof(int32_t))) != NULL)
+     && ((counts = (u_int32_t*)calloc(num_strings, sizeof(u_int32_t))) != NULL)) {
+    for(u_int32_t i = 0; i < retriever.actNumEntries; i++)
+      ouis[i] = MacManufacturers::getOUI(retriever.elems[i].macValue->get_mac());
 
-    const char *manufacturer = m->get_manufacturer();
-    if(manufacturer != NULL) {
-      if(!cur_manuf || (strcmp(cur_manuf, manufacturer) != 0)) {
-	if(cur_manuf != NULL)
-	  lua_push_int32_table_entry(vm, cur_manuf, cur_count);
+    manufacturers->getManufacturerIds(ouis, retriever.actNumEntries, ids);
 
-	cur_manuf = manufacturer;
-	cur_count = 1;
-	k++;
-      } else {
-	cur_count++;
-      }
+    for(u_int32_t i = 0; i < retriever.actNumEntries; i++)
+      if(ids[i] >= 0) counts[ids[i]]++;
+
+    /* String ids follow the alphabetical order */
+    for(u_int32_t id = 0; (id < num_strings) && (k < (int)maxHits); id++) {
+      if(counts[id] > 0)
+	lua_push_int32_table_entry(vm, manufacturers->getString(id), counts[id]), k++;
     }
   }
-  if(cur_manuf != NULL)
-    lua_push_int32_table_entry(vm, cur_manuf, cur_count);
 
   enablePurge(false);
 
+  if(ouis)   free(ouis);
+  if(ids)    free(ids);
+  if(counts) free(counts);
+
   // finally free the elements regardless of the sorted kind
   if(retriever.elems) free(retriever.elems);
 
@@ -6709,6 +7142,9 @@ void NetworkInterface::finishInitialization(u_int8_t num_defined_interfaces) {
 
       if(!db) throw "Not enough memory";
     }
+
+    if((db == NULL) && ntop->getPrefs()->do_dump_flows_on_columnar())
+      db = columnar_db = new ColumnarFlowDB(this);
   }
 }
 
@@ -6784,59 +7220,30 @@ bool NetworkInterface::matchLiveCapture(struct ntopngLuaContext * const luactx,
 
 void NetworkInterface::deliverLiveCapture(const struct pcap_pkthdr * const h,
 					  const u_char * const packet, Flow * const f) {
-  int res;
-
   for(u_int i=0, num_found = 0; (i<MAX_NUM_PCAP_CAPTURES)
 	&& (num_found < num_live_captures); i++) {
     if(live_captures[i] != NULL) {
       struct ntopngLuaContext *c = (struct ntopngLuaContext *)live_captures[i];
-      bool http_client_disconnected = false;
+      bool capture_completed = false;
 
       num_found++;
 
       if(c->live_capture.capture_until < h->ts.tv_sec || c->live_capture.stopped)
-	http_client_disconnected = true;
-
-      /* The header is always sent even when there is never a match with matchLiveCapture,
-         as otherwise some browsers may end up in hangning. Hanging has been
-         verified with Safari Version 12.0 (13606.2.11)
-	 but not with Chrome Version 68.0.3440.106 (Official Build) (64-bit) */
-      if(!http_client_disconnected
-	 && c->conn
-	 && !c->live_capture.pcaphdr_sent) {
-	struct pcap_file_header pcaphdr;
-
-	Utils::init_pcap_header(&pcaphdr, this);
-
-	if((res = mg_write_async(c->conn, &pcaphdr, sizeof(pcaphdr))) < (int)sizeof(pcaphdr))
-	  http_client_disconnected = true;
-
-	c->live_capture.pcaphdr_sent = true;
-      }
-
-      if(!http_client_disconnected
-	 && c->conn
-	 && matchLiveCapture(c, h, packet, f)) {
-	struct pcap_disk_pkthdr pkthdr; /* Cannot use h as the format on disk differs */
-
-	pkthdr.ts.tv_sec = h->ts.tv_sec, pkthdr.ts.tv_usec = h->ts.tv_usec,
-	  pkthdr.caplen = h->caplen, pkthdr.len = h->len;
-
-	if(
-	   ((res = mg_write_async(c->conn, &pkthdr, sizeof(pkthdr))) < (int)sizeof(pkthdr))
-	   || ((res = mg_write_async(c->conn, packet, h->caplen)) < (int)h->caplen)
-	   )
-	  http_client_disconnected = true;
+	capture_completed = true;
+      else if(matchLiveCapture(c, h, packet, f)) {
+	/* Never block here: the packet is copied and sent by the HTTP thread (sendLiveCapture) */
+	if(!c->live_capture.ring->enqueue(h, packet))
+	  c->live_capture.num_dropped_packets++;
 	else {
 	  c->live_capture.num_captured_packets++;
 
 	  if((c->live_capture.capture_max_pkts != 0)
 	     && (c->live_capture.num_captured_packets == c->live_capture.capture_max_pkts))
-	    http_client_disconnected = true;
+	    capture_completed = true;
 	}
       }
 
-      if(http_client_disconnected)
+      if(capture_completed)
 	deregisterLiveCapture(c); /* (*) */
     }
   }
@@ -6844,6 +7251,55 @@ void NetworkInterface::deliverLiveCapture(const struct pcap_pkthdr * const h,
 
 /* *************************************** */
 
+/*
+  Runs on the HTTP thread of a registered live capture and writes
+  the packets queued by deliverLiveCapture until the capture is over.
+*/
+void NetworkInterface::sendLiveCapture(struct ntopngLuaContext * const luactx) {
+  LiveCaptureRing *ring = luactx->live_capture.ring;
+  struct pcap_file_header pcaphdr;
+  const u_char *data;
+  u_int32_t len;
+
+  /* The header is always sent even when there is never a match with matchLiveCapture,
+     as otherwise some browsers may end up in hangning. Hanging has been
+     verified with Safari Version 12.0 (13606.2.11)
+     but not with Chrome Version 68.0.3440.106 (Official Build) (64-bit) */
+  Utils::init_pcap_header(&pcaphdr, this);
+  luactx->live_capture.pcaphdr_sent = true;
+
+  if(!luactx->conn
+     || (mg_write(luactx->conn, &pcaphdr, sizeof(pcaphdr)) < (int)sizeof(pcaphdr))) {
+    deregisterLiveCapture(luactx);
+    return;
+  }
+
+  while(true) {
+    /* Read before draining: packets queued before the stop are still sent */
+    bool stopped = luactx->live_capture.stopped;
+
+    if((len = ring->peek(&data)) > 0) {
+      if(mg_write(luactx->conn, data, len) < (int)len) {
+	/* HTTP client disconnected */
+	deregisterLiveCapture(luactx);
+	break;
+      }
+
+      ring->consume(len);
+    } else if(stopped)
+      break;
+    else {
+      /* Also expire captures that see no traffic at all */
+      if((u_int32_t)time(NULL) > luactx->live_capture.capture_until)
+	deregisterLiveCapture(luactx);
+      else
+	_usleep(CONST_LIVE_CAPTURE_IDLE_USEC);
+    }
+  }
+}
+
+/* *************************************** */
+
 void NetworkInterface::dumpLiveCaptures(lua_State* vm) {
   /* Administrative privileges checked by the caller */
 
@@ -6863,6 +7319,12 @@ void NetworkInterface::dumpLiveCaptures(lua_State* vm) {
 			       live_captures[i]->live_capture.capture_max_pkts);
       lua_push_uint64_table_entry(vm, "num_captured_packets",
 			       live_captures[i]->live_capture.num_captured_packets);
+      lua_push_uint64_table_entry(vm, "num_dropped_packets",
+			       live_captures[i]->live_capture.num_dropped_packets);
+      lua_push_uint64_table_entry(vm, "ring_used_bytes",
+			       live_captures[i]->live_capture.ring->getUsed());
+      lua_push_uint64_table_entry(vm, "ring_size_bytes",
+			       live_captures[i]->live_capture.ring->getSize());
 
       if(live_captures[i]->live_capture.matching_host != NULL) {
 	Host *h = (Host*)live_captures[i]->live_capture.matching_host;
@@ -47,6 +47,7 @@ extern struct keyval string_to_replace[]; /* Lua.cpp */
 
 Ntop::Ntop(char *appName) {
   ntop = this;
+  KeyedHash::initSeed(); /* Before any hash table gets populated */
   globals = new NtopGlobals();
   extract = new TimelineExtract();
   pa = new PeriodicActivities();
@@ -2035,6 +2036,9 @@ void Ntop::sendNetworkInterfacesTermination() {
 
 /* NOTE: the multiple isShutdown checks below are necessary to reduce the shutdown time */
 void Ntop::runHousekeepingTasks() {
+  /* Networks added at runtime fall back to the slower lookups until compiled */
+  address->compileLocalNetworks();
+
   for(int i=0; i<num_defined_interfaces; i++) {
     if(globals->isShutdownRequested()) return;
     iface[i]->runHousekeepingTasks();
@@ -33,6 +33,13 @@ PacketDumper::PacketDumper(NetworkInterface *i, const char *path) {
 PacketDumper::~PacketDumper() {
   closeDump();
   if (out_path) free(out_path);
+
+  for(int i = 0; i < PACKET_DUMPER_NUM_BUFFERS; i++)
+    if(buffers[i]) free(buffers[i]);
+
+#ifdef HAVE_ZLIB
+  if(zbuffer) free(zbuffer);
+#endif
 }
 
 /* ********************************************* */
@@ -42,24 +49,196 @@ void PacketDumper::init(NetworkInterface *i) {
 
   iface = i;
   file_id = 0;
-  dumper = NULL;
+  fd = -1;
   num_dumped_packets = 0;
   max_bytes_per_file = 0;
   num_bytes_cur_file = 0;
   out_path = NULL;
+  preallocated = false;
+  memset(buffers, 0, sizeof(buffers));
+  cur_buffer = 0, cur_buffer_len = 0;
+  num_written_bytes = num_writes = write_usec = 0;
 
   if (strcmp(name, "lo") == 0)
     iface_type = DLT_NULL;
   else
     iface_type = i->get_datalink();
+
+#ifdef HAVE_ZLIB
+  zbuffer = NULL;
+  compress = ntop->getPrefs()->is_extracted_pcap_compressed();
+#else
+  if(ntop->getPrefs()->is_extracted_pcap_compressed())
+    ntop->getTrace()->traceEvent(TRACE_WARNING, "Unable to compress pcap files: ntopng compiled without zlib");
+
+  compress = false;
+#endif
+}
+
+/* ********************************************* */
+
+bool PacketDumper::allocBuffers() {
+  if(buffers[0])
+    return true;
+
+  for(int i = 0; i < PACKET_DUMPER_NUM_BUFFERS; i++) {
+    if(posix_memalign((void**)&buffers[i], PACKET_DUMPER_IO_ALIGNMENT, PACKET_DUMPER_BUFFER_SIZE) != 0) {
+      buffers[i] = NULL;
+      goto fail;
+    }
+  }
+
+#ifdef HAVE_ZLIB
+  if(compress && ((zbuffer = (u_char*)malloc(PACKET_DUMPER_BUFFER_SIZE)) == NULL))
+    goto fail;
+#endif
+
+  return true;
+
+ fail:
+  for(int i = 0; i < PACKET_DUMPER_NUM_BUFFERS; i++)
+    if(buffers[i]) { free(buffers[i]); buffers[i] = NULL; }
+
+  ntop->getTrace()->traceEvent(TRACE_ERROR, "Unable to allocate memory");
+  return false;
+}
+
+/* ********************************************* */
+
+bool PacketDumper::writeVector(struct iovec *v, int num) {
+  struct timeval begin, end;
+  bool rc = true;
+
+  gettimeofday(&begin, NULL);
+
+  while(num > 0) {
+    ssize_t n = writev(fd, v, num);
+
+    if(n < 0) {
+      if(errno == EINTR) continue;
+
+      ntop->getTrace()->traceEvent(TRACE_WARNING, "Unable to write pcap file: %s", strerror(errno));
+      rc = false;
+      break;
+    }
+
+    num_written_bytes += n, num_writes++;
+
+    /* Partial write: skip what has been written */
+    while((num > 0) && ((size_t)n >= v->iov_len))
+      n -= v->iov_len, v++, num--;
+
+    if(num > 0)
+      v->iov_base = (u_char*)v->iov_base + n, v->iov_len -= n;
+  }
+
+  gettimeofday(&end, NULL);
+  write_usec += (u_int64_t)(Utils::msTimevalDiff(&end, &begin) * 1000);
+
+  return rc;
+}
+
+/* ********************************************* */
+
+#ifdef HAVE_ZLIB
+bool PacketDumper::compressVector(const struct iovec *v, int num, bool finish) {
+  struct iovec out;
+  int rc;
+
+  for(int i = 0; i <= num; i++) {
+    bool last = (i == num);
+
+    if(last && !finish)
+      break;
+
+    zs.next_in = last ? NULL : (Bytef*)v[i].iov_base;
+    zs.avail_in = last ? 0 : v[i].iov_len;
+
+    do {
+      zs.next_out = zbuffer, zs.avail_out = PACKET_DUMPER_BUFFER_SIZE;
+      rc = deflate(&zs, last ? Z_FINISH : Z_NO_FLUSH);
+
+      if(rc == Z_STREAM_ERROR)
+	return false;
+
+      out.iov_base = zbuffer, out.iov_len = PACKET_DUMPER_BUFFER_SIZE - zs.avail_out;
+
+      if((out.iov_len > 0) && !writeVector(&out, 1))
+	return false;
+    } while(last ? (rc != Z_STREAM_END) : (zs.avail_out == 0));
+  }
+
+  return true;
+}
+#endif
+
+/* ********************************************* */
+
+bool PacketDumper::flush(bool finish) {
+  struct iovec iov[PACKET_DUMPER_NUM_BUFFERS];
+  int num = 0;
+  bool rc;
+
+  for(u_int i = 0; i <= cur_buffer; i++) {
+    iov[num].iov_base = buffers[i];
+    iov[num].iov_len = (i == cur_buffer) ? cur_buffer_len : PACKET_DUMPER_BUFFER_SIZE;
+    if(iov[num].iov_len > 0) num++;
+  }
+
+  cur_buffer = 0, cur_buffer_len = 0;
+
+#ifdef HAVE_ZLIB
+  if(compress)
+    return compressVector(iov, num, finish);
+#endif
+
+  rc = (num > 0) ? writeVector(iov, num) : true;
+
+  return rc;
+}
+
+/* ********************************************* */
+
+void PacketDumper::append(const void *data, u_int32_t len) {
+  const u_char *p = (const u_char*)data;
+
+  while(len > 0) {
+    u_int32_t n;
+
+    if(cur_buffer_len == PACKET_DUMPER_BUFFER_SIZE) {
+      if(cur_buffer + 1 == PACKET_DUMPER_NUM_BUFFERS)
+	flush(false);
+      else
+	cur_buffer++, cur_buffer_len = 0;
+    }
+
+    n = min_val(len, PACKET_DUMPER_BUFFER_SIZE - cur_buffer_len);
+    memcpy(&buffers[cur_buffer][cur_buffer_len], p, n);
+    cur_buffer_len += n, p += n, len -= n;
+  }
 }
 
 /* ********************************************* */
 
 void PacketDumper::closeDump() {
-  if(dumper) {
-    pcap_dump_close(dumper);
-    dumper = NULL;
+  if(fd >= 0) {
+    flush(true);
+
+#ifdef HAVE_ZLIB
+    if(compress)
+      deflateEnd(&zs);
+#endif
+
+    /* Release the preallocated space not used */
+    if(preallocated && (ftruncate(fd, lseek(fd, 0, SEEK_CUR)) != 0))
+      ntop->getTrace()->traceEvent(TRACE_WARNING, "Unable to truncate pcap file");
+
+    close(fd);
+    fd = -1;
+
+    ntop->getTrace()->traceEvent(TRACE_INFO, "Closed pcap dump [written bytes=%llu][writes=%llu][%.1f MB/s]",
+				 (unsigned long long)num_written_bytes, (unsigned long long)num_writes,
+				 write_usec ? ((double)num_written_bytes / write_usec) : 0);
   }
 }
 
@@ -84,25 +263,55 @@ bool PacketDumper::checkClose() {
 
 bool PacketDumper::openDump() {
   char pcap_path[MAX_PATH];
+  struct pcap_file_header fh;
 
-  if (dumper != NULL)
+  if (fd >= 0)
     return true;
 
+  if (!allocBuffers())
+    return false;
+
   max_bytes_per_file = ntop->getPrefs()->get_max_extracted_pcap_bytes();
 
   Utils::mkdir_tree(out_path);
-  snprintf(pcap_path, sizeof(pcap_path), "%s/%u.pcap", out_path, file_id+1);
+  snprintf(pcap_path, sizeof(pcap_path), "%s/%u.pcap%s", out_path, file_id+1, compress ? ".gz" : "");
   
-  dumper = pcap_dump_open(pcap_open_dead(iface_type, 16384 /* MTU */), pcap_path);
+  fd = open(pcap_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
 
-  if (dumper == NULL) {
+  if (fd < 0) {
     ntop->getTrace()->traceEvent(TRACE_WARNING, "Unable to create pcap file %s", pcap_path);
     return false;
   } 
 
+#ifdef HAVE_ZLIB
+  if (compress) {
+    memset(&zs, 0, sizeof(zs));
+
+    /* 15 + 16: gzip wrapper, readable by the pcap tools */
+    if (deflateInit2(&zs, Z_BEST_SPEED, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+      ntop->getTrace()->traceEvent(TRACE_WARNING, "Unable to initialize compression for %s", pcap_path);
+      close(fd);
+      fd = -1;
+      return false;
+    }
+  }
+#endif
+
+  preallocated = false;
+
+#if defined(__linux__) && defined(FALLOC_FL_KEEP_SIZE)
+  /* Reserve the whole file upfront to keep it contiguous on disk */
+  if (!compress && (max_bytes_per_file > 0))
+    preallocated = (fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, max_bytes_per_file + PACKET_DUMPER_BUFFER_SIZE) == 0);
+#endif
+
   file_id++;
   num_bytes_cur_file = 0;
 
+  Utils::init_pcap_header(&fh, iface);
+  fh.linktype = iface_type;
+  append(&fh, sizeof(fh));
+
   ntop->getTrace()->traceEvent(TRACE_INFO, "Created pcap dump %s [max bytes=%u]",
     pcap_path, max_bytes_per_file);
 
@@ -112,13 +321,19 @@ bool PacketDumper::openDump() {
 /* ********************************************* */
 
 void PacketDumper::dumpPacket(const struct pcap_pkthdr *h, const u_char *packet) {
-  if (dumper == NULL) {
+  struct pcap_disk_pkthdr pkthdr; /* Cannot use h as the format on disk differs */
+
+  if (fd < 0) {
     openDump();
-    if (dumper == NULL)
+    if (fd < 0)
       return;
   }
 
-  pcap_dump((u_char*)dumper, h, packet);
+  pkthdr.ts.tv_sec = h->ts.tv_sec, pkthdr.ts.tv_usec = h->ts.tv_usec,
+    pkthdr.caplen = h->caplen, pkthdr.len = h->len;
+
+  append(&pkthdr, sizeof(pkthdr));
+  append(packet, h->caplen);
 
   num_dumped_packets++;
   num_bytes_cur_file += sizeof(struct pcap_disk_pkthdr) + h->caplen;
@@ -127,4 +342,3 @@ void PacketDumper::dumpPacket(const struct pcap_pkthdr *h, const u_char *packet)
 }
 
 /* ********************************************* */
-
@@ -0,0 +1,703 @@
+/*
+ *
+ * (C) 2019 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+
+
+
+#include "ntop_includes.h"
+
+/* **************************************************** */
+
+static void* packetRecorderWriterLoop(void *ptr) {
+  ((PacketRecorder*)ptr)->writerLoop();
+  return(NULL);
+}
+
+/* **************************************************** */
+
+PacketRecorder::PacketRecorder(NetworkInterface *_iface, u_int64_t _max_disk_bytes) {
+  iface = _iface, max_disk_bytes = _max_disk_bytes;
+  datalink = DLT_EN10MB; /* Set on start, when the interface is open */
+
+  snprintf(dir, sizeof(dir), "%s/%d/recording", ntop->getPrefs()->get_pcap_dir(), iface->get_id());
+  ntop->fixPath(dir);
+
+  cur_buffer = spare_buffer = NULL, cur_segment = NULL;
+  cur_segment_bytes = 0, cur_buffer_since = cur_pkt_sec = 0, next_seq = 1;
+  started = start_failed = false;
+
+  memset(buffers, 0, sizeof(buffers));
+  full_buffers = free_buffers = NULL;
+  writer_running = false;
+  fd = -1, fd_seq = 0, fd_offset = 0, fd_direct = false, direct_supported = true;
+  disk_bytes = 0, num_segments = 0;
+
+  num_packets = num_bytes = num_drops = 0;
+  num_written_bytes = num_write_errors = num_direct_writes = 0;
+
+  /* Keep on numbering (and accounting) the segments of the previous runs */
+  scanSegments();
+}
+
+/* **************************************************** */
+
+PacketRecorder::~PacketRecorder() {
+  if(started) {
+    /* Packets are no longer delivered: write what is left */
+    if(cur_segment)
+      closeSegment();
+
+    writer_running = false;
+    pthread_join(writer, NULL);
+  }
+
+  closeSegmentFile();
+
+  for(int i = 0; i < RECORDER_NUM_BUFFERS; i++)
+    if(buffers[i].data) free(buffers[i].data);
+
+  if(full_buffers) delete full_buffers;
+  if(free_buffers) delete free_buffers;
+}
+
+/* **************************************************** */
+
+void PacketRecorder::getSegmentPath(const char *dir, u_int32_t seq, const char *ext, char *buf, u_int buf_len) {
+  snprintf(buf, buf_len, "%s/%u.%s", dir, seq, ext);
+}
+
+/* **************************************************** */
+
+void PacketRecorder::scanSegments() {
+  std::vector<std::pair<u_int32_t, u_int64_t> > found;
+  struct dirent *entry;
+  DIR *d;
+
+  if((d = opendir(dir)) == NULL)
+    return; /* Nothing recorded yet */
+
+  while((entry = readdir(d)) != NULL) {
+    char path[MAX_PATH], ext[8];
+    struct stat st;
+    u_int32_t seq;
+    u_int64_t bytes = 0;
+
+    if((sscanf(entry->d_name, "%u.%7s", &seq, ext) != 2) || strcmp(ext, "pcap"))
+      continue;
+
+    getSegmentPath(dir, seq, "pcap", path, sizeof(path));
+    if(stat(path, &st) == 0) bytes += st.st_size;
+
+    getSegmentPath(dir, seq, "idx", path, sizeof(path));
+    if(stat(path, &st) == 0) bytes += st.st_size;
+
+    found.push_back(std::make_pair(seq, bytes));
+  }
+
+  closedir(d);
+
+  std::sort(found.begin(), found.end());
+
+  for(std::vector<std::pair<u_int32_t, u_int64_t> >::iterator it = found.begin(); it != found.end(); ++it) {
+    segments.push_back(*it);
+    disk_bytes += it->second;
+    next_seq = it->first + 1;
+  }
+
+  num_segments = segments.size();
+}
+
+/* **************************************************** */
+
+bool PacketRecorder::start() {
+  start_failed = true; /* Until proven otherwise */
+  datalink = iface->get_datalink();
+
+  if(!Utils::mkdir_tree(dir)) {
+    ntop->getTrace()->traceEvent(TRACE_WARNING, "Unable to create %s: recording disabled", dir);
+    return(false);
+  }
+
+  for(int i = 0; i < RECORDER_NUM_BUFFERS; i++) {
+    if(posix_memalign((void**)&buffers[i].data, RECORDER_IO_ALIGNMENT, RECORDER_BUFFER_SIZE) != 0) {
+      buffers[i].data = NULL;
+      ntop->getTrace()->traceEvent(TRACE_WARNING, "Not enough memory: recording disabled on %s", iface->get_name());
+      return(false);
+    }
+  }
+
+  try {
+    full_buffers = new SPSCQueue();
+    free_buffers = new SPSCQueue();
+  } catch(...) {
+    ntop->getTrace()->traceEvent(TRACE_WARNING, "Not enough memory: recording disabled on %s", iface->get_name());
+    return(false);
+  }
+
+  for(int i = 0; i < RECORDER_NUM_BUFFERS; i++)
+    free_buffers->enqueue(&buffers[i], true);
+
+  writer_running = true;
+
+  if(pthread_create(&writer, NULL, packetRecorderWriterLoop, (void*)this) != 0) {
+    ntop->getTrace()->traceEvent(TRACE_WARNING, "Unable to start the recorder of interface %s", iface->get_name());
+    writer_running = false;
+    return(false);
+  }
+
+  ntop->getTrace()->traceEvent(TRACE_NORMAL, "Recording %s traffic to %s [max disk: %llu MB]",
+			       iface->get_name(), dir, (unsigned long long)(max_disk_bytes / (1024 * 1024)));
+
+  start_failed = false, started = true;
+  return(true);
+}
+
+/* **************************************************** */
+
+bool PacketRecorder::getBuffer(recorder_buffer_t **b) {
+  if(!free_buffers->dequeue((void**)b))
+    return(false); /* The writer can't keep up */
+
+  (*b)->len = 0, (*b)->closed_segment = NULL;
+  return(true);
+}
+
+/* **************************************************** */
+
+void PacketRecorder::passBuffer(recorder_segment_t *closed_segment) {
+  recorder_buffer_t *b = cur_buffer;
+
+  if(b == NULL) {
+    /* Only carries the index of the closed segment */
+    if((b = (recorder_buffer_t*)calloc(1, sizeof(recorder_buffer_t))) == NULL) {
+      freeSegment(closed_segment);
+      return;
+    }
+  }
+
+  b->seq = cur_segment->seq, b->closed_segment = closed_segment;
+  full_buffers->enqueue(b, true);
+  cur_buffer = NULL;
+}
+
+/* **************************************************** */
+
+bool PacketRecorder::openSegment() {
+  struct pcap_file_header fh;
+  recorder_segment_t *s;
+  u_int32_t num_blocks = RECORDER_SEGMENT_SIZE / RECORDER_INDEX_BLOCK_SIZE;
+
+  if((s = (recorder_segment_t*)calloc(1, sizeof(recorder_segment_t))) == NULL)
+    return(false);
+
+  if((s->blocks = (recorder_block_t*)calloc(num_blocks, sizeof(recorder_block_t))) == NULL) {
+    freeSegment(s);
+    return(false);
+  }
+
+  for(u_int32_t i = 0; i < num_blocks; i++)
+    s->blocks[i].first_record = RECORDER_NO_RECORD;
+
+  s->seq = next_seq++;
+  s->hdr.magic = RECORDER_INDEX_MAGIC, s->hdr.version = RECORDER_INDEX_VERSION;
+  s->hdr.block_size = RECORDER_INDEX_BLOCK_SIZE, s->hdr.bloom_bytes = RECORDER_INDEX_BLOOM_BYTES;
+
+  cur_segment = s, cur_segment_bytes = 0;
+
+  /* Each segment is a standalone pcap file */
+  Utils::init_pcap_header(&fh, iface);
+  append(&fh, sizeof(fh));
+
+  return(true);
+}
+
+/* **************************************************** */
+
+void PacketRecorder::closeSegment() {
+  recorder_segment_t *s = cur_segment;
+
+  s->hdr.segment_bytes = cur_segment_bytes;
+  s->hdr.num_blocks = (u_int32_t)((cur_segment_bytes + RECORDER_INDEX_BLOCK_SIZE - 1) / RECORDER_INDEX_BLOCK_SIZE);
+
+  passBuffer(s);
+  cur_segment = NULL;
+}
+
+/* **************************************************** */
+
+void PacketRecorder::append(const void *data, u_int32_t len) {
+  const u_char *p = (const u_char*)data;
+
+  while(len > 0) {
+    u_int32_t n;
+
+    if(cur_buffer->len == RECORDER_BUFFER_SIZE) {
+      /* The caller made sure a spare buffer is available */
+      passBuffer(NULL);
+      cur_buffer = spare_buffer, spare_buffer = NULL;
+    }
+
+    if(cur_buffer->len == 0)
+      cur_buffer_since = cur_pkt_sec;
+
+    n = min_val(len, RECORDER_BUFFER_SIZE - cur_buffer->len);
+    memcpy(&cur_buffer->data[cur_buffer->len], p, n);
+    cur_buffer->len += n, cur_segment_bytes += n;
+    p += n, len -= n;
+  }
+}
+
+/* **************************************************** */
+
+/* Hosts and ports of the packet, as matched by the host and port BPF primitives */
+static bool getPacketKeys(int datalink, const struct pcap_pkthdr * const h, const u_char * const p,
+			  u_int64_t *keys, u_int *num_keys) {
+  u_int32_t off, l4 = 0, caplen = h->caplen;
+  u_int16_t eth_type;
+  u_int8_t proto = 0;
+
+  *num_keys = 0;
+
+  switch(datalink) {
+  case DLT_EN10MB:
+    if(caplen < 14) return(false);
+    eth_type = (p[12] << 8) | p[13], off = 14;
+
+    while((eth_type == 0x8100 /* VLAN */) || (eth_type == 0x88A8 /* QinQ */)) {
+      if(caplen < off + 4) return(false);
+      eth_type = (p[off + 2] << 8) | p[off + 3], off += 4;
+    }
+    break;
+
+  case DLT_RAW:
+  case DLT_NULL:
+    off = (datalink == DLT_NULL) ? 4 : 0;
+    if(caplen < off + 1) return(false);
+    eth_type = ((p[off] >> 4) == 6) ? ETHERTYPE_IPV6 : ETHERTYPE_IP;
+    break;
+
+  default:
+    return(false);
+  }
+
+  switch(eth_type) {
+  case ETHERTYPE_IP:
+    {
+      u_int32_t ihl;
+
+      if(caplen < off + 20) return(false);
+      ihl = (p[off] & 0x0F) * 4, proto = p[off + 9];
+      keys[(*num_keys)++] = PacketRecorder::hashHostKey(&p[off + 12], 4);
+      keys[(*num_keys)++] = PacketRecorder::hashHostKey(&p[off + 16], 4);
+
+      /* Only the first fragment carries the ports */
+      if(((p[off + 6] & 0x1F) | p[off + 7]) == 0)
+	l4 = off + ihl;
+    }
+    break;
+
+  case ETHERTYPE_IPV6:
+    if(caplen < off + 40) return(false);
+    proto = p[off + 6];
+    keys[(*num_keys)++] = PacketRecorder::hashHostKey(&p[off + 8], 16);
+    keys[(*num_keys)++] = PacketRecorder::hashHostKey(&p[off + 24], 16);
+    l4 = off + 40;
+    break;
+
+  case ETHERTYPE_ARP:
+    /* "host" also matches the ARP sender/target addresses */
+    if((caplen >= off + 28) && (p[off + 4] == 6) && (p[off + 5] == 4)) {
+      keys[(*num_keys)++] = PacketRecorder::hashHostKey(&p[off + 14], 4);
+      keys[(*num_keys)++] = PacketRecorder::hashHostKey(&p[off + 24], 4);
+    }
+    return(true);
+
+  default:
+    return(true); /* Can't match host nor port filters */
+  }
+
+  if(l4 && ((proto == IPPROTO_TCP) || (proto == IPPROTO_UDP) || (proto == 132 /* SCTP */))
+     && (caplen >= l4 + 4)) {
+    keys[(*num_keys)++] = PacketRecorder::hashPortKey((p[l4] << 8) | p[l4 + 1]);
+    keys[(*num_keys)++] = PacketRecorder::hashPortKey((p[l4 + 2] << 8) | p[l4 + 3]);
+  }
+
+  return(true);
+}
+
+/* **************************************************** */
+
+void PacketRecorder::indexPacket(const struct pcap_pkthdr * const h, const u_char * const packet) {
+  recorder_segment_t *s = cur_segment;
+  u_int32_t offset = (u_int32_t)cur_segment_bytes, sec = (u_int32_t)h->ts.tv_sec;
+  recorder_block_t *block = &s->blocks[offset / RECORDER_INDEX_BLOCK_SIZE];
+  u_int64_t keys[4];
+  u_int num_keys;
+
+  /* Time bounds: packets are not necessarily in timestamp order */
+  if(s->hdr.num_packets == 0)
+    s->hdr.first_sec = s->hdr.last_sec = sec;
+  else {
+    if(sec > s->hdr.last_sec) s->hdr.last_sec = sec;
+    if(sec < s->hdr.first_sec) s->hdr.first_sec = sec;
+  }
+
+  s->hdr.num_packets++;
+
+  if(block->first_record == RECORDER_NO_RECORD)
+    block->first_record = offset, block->min_sec = block->max_sec = sec;
+  else {
+    if(sec > block->max_sec) block->max_sec = sec;
+    if(sec < block->min_sec) block->min_sec = sec;
+  }
+
+  /* Flow-key index */
+
+  if(getPacketKeys(datalink, h, packet, keys, &num_keys)) {
+    for(u_int i = 0; i < num_keys; i++)
+      bloomAdd(block->bloom, keys[i]);
+  } else
+    block->flags |= RECORDER_BLOCK_UNINDEXED;
+}
+
+/* **************************************************** */
+
+void PacketRecorder::recordPacket(const struct pcap_pkthdr * const h, const u_char * const packet) {
+  struct pcap_disk_pkthdr pkthdr; /* Cannot use h as the format on disk differs */
+  u_int32_t rec_len = sizeof(pkthdr) + h->caplen, needed;
+
+  if(!started && (start_failed || !start()))
+    return;
+
+  cur_pkt_sec = h->ts.tv_sec;
+
+  /* Segments are closed on packet boundaries */
+  if(cur_segment && ((cur_segment_bytes + rec_len) > RECORDER_SEGMENT_SIZE))
+    closeSegment();
+
+  needed = rec_len + (cur_segment ? 0 : sizeof(struct pcap_file_header));
+
+  /* Never block: the packet is dropped when the buffers it needs are not available */
+  if((needed > RECORDER_BUFFER_SIZE)
+     || ((cur_buffer == NULL) && !getBuffer(&cur_buffer))
+     || (((cur_buffer->len + needed) > RECORDER_BUFFER_SIZE)
+	 && (spare_buffer == NULL) && !getBuffer(&spare_buffer))
+     || ((cur_segment == NULL) && !openSegment())) {
+    num_drops++;
+    return;
+  }
+
+  indexPacket(h, packet);
+
+  pkthdr.ts.tv_sec = h->ts.tv_sec, pkthdr.ts.tv_usec = h->ts.tv_usec,
+    pkthdr.caplen = h->caplen, pkthdr.len = h->len;
+
+  append(&pkthdr, sizeof(pkthdr));
+  append(packet, h->caplen);
+
+  num_packets++, num_bytes += rec_len;
+}
+
+/* **************************************************** */
+
+void PacketRecorder::flushIdle(time_t now /* packet time */) {
+  /* Don't keep the last packets in memory when the traffic is low */
+  if(cur_buffer && (cur_buffer->len > 0)
+     && ((now - cur_buffer_since) >= RECORDER_FLUSH_SECS))
+    passBuffer(NULL);
+}
+
+/* **************************************************** */
+
+void PacketRecorder::writerLoop() {
+  recorder_buffer_t *b;
+
+  while(true) {
+    if(full_buffers->dequeue((void**)&b)) {
+      writeBuffer(b);
+
+      if(b->data)
+	free_buffers->enqueue(b, true);
+      else
+	free(b); /* Index carrier, see passBuffer */
+    } else if(!writer_running)
+      break; /* Stopped and drained */
+    else
+      _usleep(RECORDER_WRITER_IDLE_USEC);
+  }
+
+  closeSegmentFile();
+}
+
+/* **************************************************** */
+
+bool PacketRecorder::openSegmentFile(u_int32_t seq) {
+  char path[MAX_PATH];
+  int flags = O_WRONLY | O_CREAT | O_TRUNC;
+
+  getSegmentPath(dir, seq, "pcap", path, sizeof(path));
+
+#ifdef O_DIRECT
+  if(direct_supported) {
+    if((fd = open(path, flags | O_DIRECT, 0644)) >= 0)
+      fd_direct = true;
+    else if(errno == EINVAL)
+      direct_supported = false; /* e.g. tmpfs */
+  }
+#endif
+
+  if((fd < 0) && ((fd = open(path, flags, 0644)) >= 0))
+    fd_direct = false;
+
+  if(fd < 0) {
+    ntop->getTrace()->traceEvent(TRACE_WARNING, "Unable to create %s: %s", path, strerror(errno));
+    return(false);
+  }
+
+  fd_seq = seq, fd_offset = 0;
+  return(true);
+}
+
+/* **************************************************** */
+
+void PacketRecorder::closeSegmentFile() {
+  if(fd >= 0) {
+    close(fd);
+    fd = -1;
+  }
+}
+
+/* **************************************************** */
+
+bool PacketRecorder::setDirect(bool direct) {
+#ifdef O_DIRECT
+  int flags;
+
+  if(direct == fd_direct) return(true);
+  if(direct && !direct_supported) return(false);
+
+  if(((flags = fcntl(fd, F_GETFL)) == -1)
+     || (fcntl(fd, F_SETFL, direct ? (flags | O_DIRECT) : (flags & ~O_DIRECT)) == -1)) {
+    if(direct) direct_supported = false;
+    return(false);
+  }
+
+  fd_direct = direct;
+  return(true);
+#else
+  return(!direct);
+#endif
+}
+
+/* **************************************************** */
+
+void PacketRecorder::writeBuffer(recorder_buffer_t *b) {
+  recorder_segment_t *s = b->closed_segment;
+
+  if(b->data && (b->len > 0)) {
+    if((fd < 0) || (fd_seq != b->seq)) {
+      closeSegmentFile();
+      openSegmentFile(b->seq);
+    }
+
+    if(fd >= 0) {
+      /* O_DIRECT needs aligned offsets and lengths: only the tail of a segment, or
+	 a buffer flushed when idle, goes through the page cache */
+      bool aligned = ((fd_offset % RECORDER_IO_ALIGNMENT) == 0) && ((b->len % RECORDER_IO_ALIGNMENT) == 0);
+      u_int32_t done = 0;
+
+      if(!setDirect(aligned) && !aligned) {
+	num_write_errors++;
+	closeSegmentFile();
+      } else {
+	while(done < b->len) {
+	  ssize_t n = write(fd, &b->data[done], b->len - done);
+
+	  if(n < 0) {
+	    if(errno == EINTR) continue;
+
+	    ntop->getTrace()->traceEvent(TRACE_WARNING, "Unable to write segment %u of %s: %s",
+					 b->seq, iface->get_name(), strerror(errno));
+	    num_write_errors++;
+	    break;
+	  }
+
+	  done += n;
+	}
+
+	if(fd_direct) num_direct_writes++;
+	fd_offset += done, num_written_bytes += done;
+      }
+    } else
+      num_write_errors++;
+  }
+
+  if(s) {
+    u_int64_t bytes = (fd_seq == s->seq) ? fd_offset : 0;
+
+    closeSegmentFile();
+    writeIndex(s);
+
+    segments.push_back(std::make_pair(s->seq, bytes + sizeof(recorder_index_header_t)
+				      + s->hdr.num_blocks * sizeof(recorder_block_t)));
+    disk_bytes += segments.back().second;
+    num_segments = segments.size();
+
+    freeSegment(s);
+    enforceDiskLimit();
+  }
+}
+
+/* **************************************************** */
+
+void PacketRecorder::writeIndex(recorder_segment_t *s) {
+  char path[MAX_PATH], tmp_path[MAX_PATH];
+  FILE *f;
+  bool ok;
+
+  getSegmentPath(dir, s->seq, "idx", path, sizeof(path));
+  snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+  if((f = fopen(tmp_path, "wb")) == NULL) {
+    ntop->getTrace()->traceEvent(TRACE_WARNING, "Unable to create %s", tmp_path);
+    return;
+  }
+
+  ok = (fwrite(&s->hdr, sizeof(s->hdr), 1, f) == 1)
+    && (fwrite(s->blocks, sizeof(recorder_block_t), s->hdr.num_blocks, f) == s->hdr.num_blocks);
+
+  ok = (fclose(f) == 0) && ok;
+
+  /* Readers never see a partial index: segments without one are scanned */
+  if(!ok || (rename(tmp_path, path) != 0)) {
+    ntop->getTrace()->traceEvent(TRACE_WARNING, "Unable to write %s", path);
+    unlink(tmp_path);
+    num_write_errors++;
+  }
+}
+
+/* **************************************************** */
+
+void PacketRecorder::enforceDiskLimit() {
+  char path[MAX_PATH];
+
+  /* Oldest segments first, the last closed one is always kept */
+  while((disk_bytes > max_disk_bytes) && (segments.size() > 1)) {
+    u_int32_t seq = segments.front().first;
+
+    getSegmentPath(dir, seq, "pcap", path, sizeof(path));
+    unlink(path);
+    getSegmentPath(dir, seq, "idx", path, sizeof(path));
+    unlink(path);
+
+    disk_bytes -= min_val(disk_bytes, segments.front().second);
+    segments.pop_front();
+  }
+
+  num_segments = segments.size();
+}
+
+/* **************************************************** */
+
+void PacketRecorder::freeSegment(recorder_segment_t *s) {
+  if(s->blocks) free(s->blocks);
+  free(s);
+}
+
+/* **************************************************** */
+
+/* FNV-1a followed by a 64 bit finalizer to spread the short keys */
+static u_int64_t recorderHash(u_int8_t type, const u_int8_t *data, u_int len) {
+  u_int64_t h = 14695981039346656037ULL;
+
+  h = (h ^ type) * 1099511628211ULL;
+  for(u_int i = 0; i < len; i++)
+    h = (h ^ data[i]) * 1099511628211ULL;
+
+  h ^= h >> 33, h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33, h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+
+  return(h);
+}
+
+/* **************************************************** */
+
+u_int64_t PacketRecorder::hashHostKey(const u_int8_t *addr, u_int addr_len) {
+  return(recorderHash('H', addr, addr_len));
+}
+
+/* **************************************************** */
+
+u_int64_t PacketRecorder::hashPortKey(u_int16_t port) {
+  u_int8_t p[2] = { (u_int8_t)(port >> 8), (u_int8_t)(port & 0xFF) };
+
+  return(recorderHash('P', p, sizeof(p)));
+}
+
+/* **************************************************** */
+
+void PacketRecorder::bloomAdd(u_int8_t *bloom, u_int64_t key) {
+  u_int32_t h1 = (u_int32_t)key, h2 = (u_int32_t)(key >> 32) | 1;
+
+  for(u_int i = 0; i < RECORDER_INDEX_BLOOM_HASHES; i++) {
+    u_int32_t bit = (h1 + i * h2) % (RECORDER_INDEX_BLOOM_BYTES * 8);
+
+    bloom[bit >> 3] |= (1 << (bit & 7));
+  }
+}
+
+/* **************************************************** */
+
+bool PacketRecorder::bloomTest(const u_int8_t *bloom, u_int64_t key) {
+  u_int32_t h1 = (u_int32_t)key, h2 = (u_int32_t)(key >> 32) | 1;
+
+  for(u_int i = 0; i < RECORDER_INDEX_BLOOM_HASHES; i++) {
+    u_int32_t bit = (h1 + i * h2) % (RECORDER_INDEX_BLOOM_BYTES * 8);
+
+    if(!(bloom[bit >> 3] & (1 << (bit & 7))))
+      return(false);
+  }
+
+  return(true);
+}
+
+/* **************************************************** */
+
+void PacketRecorder::lua(lua_State *vm) {
+  lua_newtable(vm);
+
+  lua_push_str_table_entry(vm, "dir", dir);
+  lua_push_bool_table_entry(vm, "running", started && writer_running);
+  lua_push_uint64_table_entry(vm, "segments", num_segments);
+  lua_push_uint64_table_entry(vm, "disk_bytes", disk_bytes);
+  lua_push_uint64_table_entry(vm, "max_disk_bytes", max_disk_bytes);
+  lua_push_uint64_table_entry(vm, "packets", num_packets);
+  lua_push_uint64_table_entry(vm, "bytes", num_bytes);
+  lua_push_uint64_table_entry(vm, "drops", num_drops);
+  lua_push_uint64_table_entry(vm, "written_bytes", num_written_bytes);
+  lua_push_uint64_table_entry(vm, "direct_writes", num_direct_writes);
+  lua_push_uint64_table_entry(vm, "write_errors", num_write_errors);
+
+  lua_pushstring(vm, "recording");
+  lua_insert(vm, -2);
+  lua_settable(vm, -3);
+}
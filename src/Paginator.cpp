@@ -51,6 +51,7 @@ Paginator::Paginator() {
   mac_filter = NULL;
 
   deviceIP = inIndex = outIndex = 0;
+  inIndex_set = outIndex_set = false;
   asn_filter = (u_int32_t)-1;
 
   uid_filter = NO_UID;
@@ -95,94 +96,15 @@ void Paginator::readOptions(lua_State *L, int index) {
 
       switch(t) {
       case LUA_TSTRING:
-	if(!strcmp(key, "sortColumn")) {
-	  if(sort_column) free(sort_column);
-	  sort_column = strdup(lua_tostring(L, -1));
-	} else if(!strcmp(key, "deviceIpFilter")) {
-	  deviceIP = ntohl(inet_addr(lua_tostring(L, -1)));
-	} else if(!strcmp(key, "countryFilter")) {
-	  if(country_filter) free(country_filter);
-	  country_filter = strdup(lua_tostring(L, -1));
-	} else if(!strcmp(key, "hostFilter")) {
-	  if(host_filter) free(host_filter);
-	  host_filter = strdup(lua_tostring(L, -1));
-	} else if(!strcmp(key, "clientMode")) {
-	  const char* value = lua_tostring(L, -1);
-	  if (!strcmp(value, "local"))
-	    client_mode = location_local_only;
-	  else if (!strcmp(value, "remote"))
-	    client_mode = location_remote_only;
-	  else
-	    client_mode = location_all;
-	} else if(!strcmp(key, "serverMode")) {
-	  const char* value = lua_tostring(L, -1);
-	  if (!strcmp(value, "local"))
-	    server_mode = location_local_only;
-	  else if (!strcmp(value, "remote"))
-	    server_mode = location_remote_only;
-	  else
-	    server_mode = location_all;
-	} else if(!strcmp(key, "detailsLevel")) {
-	  const char* value = lua_tostring(L, -1);
-	  details_level_set = Utils::str2DetailsLevel(value, &details_level);
-	} else if(!strcmp(key, "macFilter")) {
-	  const char* value = lua_tostring(L, -1);
-	  if(mac_filter) free(mac_filter);
-	  mac_filter = (u_int8_t *) malloc(6);
-	  Utils::parseMac(mac_filter, value);
-	} //else
-	  //ntop->getTrace()->traceEvent(TRACE_ERROR, "Invalid string type (%s) for option %s", lua_tostring(L, -1), key);
+	setStringOption(key, lua_tostring(L, -1));
 	break;
 
       case LUA_TNUMBER:
-	if(!strcmp(key, "maxHits"))
-	  max_hits = lua_tointeger(L, -1);
-	else if(!strcmp(key, "toSkip"))
-	  to_skip = lua_tointeger(L, -1);
-	else if(!strcmp(key, "l7protoFilter"))
-	  l7proto_filter = lua_tointeger(L, -1);
-	else if(!strcmp(key, "l7categoryFilter"))
-	  l7category_filter = lua_tointeger(L, -1);
-	else if(!strcmp(key, "portFilter"))
-	  port_filter = lua_tointeger(L, -1);
-	else if(!strcmp(key, "LocalNetworkFilter"))
-	  local_network_filter = lua_tointeger(L, -1);
-	else if(!strcmp(key, "vlanIdFilter"))
-	  vlan_id_filter = lua_tointeger(L, -1);
-	else if(!strcmp(key, "inIndexFilter"))
-	  inIndex = lua_tointeger(L, -1);
-	else if(!strcmp(key, "outIndexFilter"))
-	  outIndex = lua_tointeger(L, -1);
-	else if(!strcmp(key, "ipVersion"))
-	  ip_version = lua_tointeger(L, -1);
-	else if(!strcmp(key, "poolFilter"))
-	  pool_filter = lua_tointeger(L, -1);
-	else if(!strcmp(key, "asnFilter"))
-	  asn_filter = lua_tointeger(L, -1);
-	else if(!strcmp(key, "uidFilter"))
-	  uid_filter = lua_tointeger(L, -1);
-	else if(!strcmp(key, "pidFilter"))
-	  pid_filter = lua_tointeger(L, -1);
-
-	//else
-	  //ntop->getTrace()->traceEvent(TRACE_ERROR, "Invalid int type (%d) for option %s", lua_tointeger(L, -1), key);
+	setNumericOption(key, lua_tointeger(L, -1));
 	break;
 
       case LUA_TBOOLEAN:
-	if(!strcmp(key, "a2zSortOrder"))
-	  a2z_sort_order = lua_toboolean(L, -1) ? true : false;
-	else if(!strcmp(key, "detailedResults"))
-	  detailed_results = lua_toboolean(L, -1) ? true : false;
-	else if (!strcmp(key, "unicast"))
-	  unicast_traffic = lua_toboolean(L, -1) ? 1 : 0;
-	else if (!strcmp(key, "unidirectional"))
-	  unidirectional_traffic = lua_toboolean(L, -1) ? 1 : 0;
-	else if (!strcmp(key, "alertedFlows"))
-	  alerted_flows = lua_toboolean(L, -1) ? 1 : 0;
-	else if (!strcmp(key, "filteredFlows"))
-	  filtered_flows = lua_toboolean(L, -1) ? 1 : 0;
-	//else
-	  //ntop->getTrace()->traceEvent(TRACE_ERROR, "Invalid bool type for option %s", key);
+	setBooleanOption(key, lua_toboolean(L, -1) ? true : false);
 	break;
 
       default:
@@ -194,3 +116,139 @@ void Paginator::readOptions(lua_State *L, int index) {
     lua_pop(L, 1);
   }
 }
+
+/* **************************************************** */
+
+bool Paginator::setStringOption(const char *key, const char *value) {
+  if(!strcmp(key, "sortColumn")) {
+    if(sort_column) free(sort_column);
+    sort_column = strdup(value);
+  } else if(!strcmp(key, "deviceIpFilter")) {
+    deviceIP = ntohl(inet_addr(value));
+  } else if(!strcmp(key, "countryFilter")) {
+    if(country_filter) free(country_filter);
+    country_filter = strdup(value);
+  } else if(!strcmp(key, "hostFilter")) {
+    if(host_filter) free(host_filter);
+    host_filter = strdup(value);
+  } else if(!strcmp(key, "clientMode")) {
+    if (!strcmp(value, "local"))
+      client_mode = location_local_only;
+    else if (!strcmp(value, "remote"))
+      client_mode = location_remote_only;
+    else
+      client_mode = location_all;
+  } else if(!strcmp(key, "serverMode")) {
+    if (!strcmp(value, "local"))
+      server_mode = location_local_only;
+    else if (!strcmp(value, "remote"))
+      server_mode = location_remote_only;
+    else
+      server_mode = location_all;
+  } else if(!strcmp(key, "detailsLevel")) {
+    details_level_set = Utils::str2DetailsLevel(value, &details_level);
+  } else if(!strcmp(key, "macFilter")) {
+    if(mac_filter) free(mac_filter);
+    mac_filter = (u_int8_t *) malloc(6);
+    Utils::parseMac(mac_filter, value);
+  } else
+    return(false);
+
+  return(true);
+}
+
+/* **************************************************** */
+
+bool Paginator::setNumericOption(const char *key, int64_t value) {
+  if(!strcmp(key, "maxHits"))
+    max_hits = value;
+  else if(!strcmp(key, "toSkip"))
+    to_skip = value;
+  else if(!strcmp(key, "l7protoFilter"))
+    l7proto_filter = value;
+  else if(!strcmp(key, "l7categoryFilter"))
+    l7category_filter = value;
+  else if(!strcmp(key, "portFilter"))
+    port_filter = value;
+  else if(!strcmp(key, "LocalNetworkFilter"))
+    local_network_filter = value;
+  else if(!strcmp(key, "vlanIdFilter"))
+    vlan_id_filter = value;
+  else if(!strcmp(key, "inIndexFilter"))
+    inIndex = value, inIndex_set = true;
+  else if(!strcmp(key, "outIndexFilter"))
+    outIndex = value, outIndex_set = true;
+  else if(!strcmp(key, "ipVersion"))
+    ip_version = value;
+  else if(!strcmp(key, "poolFilter"))
+    pool_filter = value;
+  else if(!strcmp(key, "asnFilter"))
+    asn_filter = value;
+  else if(!strcmp(key, "uidFilter"))
+    uid_filter = value;
+  else if(!strcmp(key, "pidFilter"))
+    pid_filter = value;
+  else
+    return(false);
+
+  return(true);
+}
+
+/* **************************************************** */
+
+bool Paginator::setBooleanOption(const char *key, bool value) {
+  if(!strcmp(key, "a2zSortOrder"))
+    a2z_sort_order = value;
+  else if(!strcmp(key, "detailedResults"))
+    detailed_results = value;
+  else if (!strcmp(key, "unicast"))
+    unicast_traffic = value ? 1 : 0;
+  else if (!strcmp(key, "unidirectional"))
+    unidirectional_traffic = value ? 1 : 0;
+  else if (!strcmp(key, "alertedFlows"))
+    alerted_flows = value ? 1 : 0;
+  else if (!strcmp(key, "filteredFlows"))
+    filtered_flows = value ? 1 : 0;
+  else
+    return(false);
+
+  return(true);
+}
+
+/* **************************************************** */
+
+/*
+  Reads the same options accepted by the Lua table variant from an
+  URL-encoded HTTP query string (e.g. maxHits=100&a2zSortOrder=false).
+*/
+void Paginator::readOptions(const char *query_string) {
+  char *query, *pair, *tmp;
+
+  if((query_string == NULL) || ((query = strdup(query_string)) == NULL))
+    return;
+
+  for(pair = strtok_r(query, "&", &tmp); pair; pair = strtok_r(NULL, "&", &tmp)) {
+    char *value = strchr(pair, '='), decoded[256], *end;
+    long long num;
+
+    if(value == NULL) continue;
+    *value++ = '\0';
+
+    url_decode(value, strlen(value), decoded, sizeof(decoded), 1 /* form encoded */);
+
+    if(setStringOption(pair, decoded))
+      continue;
+
+    if(!strcmp(decoded, "true") || !strcmp(decoded, "false")) {
+      setBooleanOption(pair, decoded[0] == 't');
+      continue;
+    }
+
+    num = strtoll(decoded, &end, 10);
+
+    if((decoded[0] != '\0') && (*end == '\0'))
+      setNumericOption(pair, num);
+  }
+
+  free(query);
+}
@@ -590,15 +590,13 @@ u_int8_t ParserInterface::parseEvent(const char * const payload, int payload_siz
     /* Process Flow */
     static_cast<ParserInterface*>(iface)->setRemoteStats(zrs);
     if(flowHashing) {
-      FlowHashing *current, *tmp;
-
-      HASH_ITER(hh, flowHashing, current, tmp) {
+      for(u_int16_t i = 0; i < flowHashing->getNumEntries(); i++) {
 	ZMQ_RemoteStats *zrscopy = (ZMQ_RemoteStats*)malloc(sizeof(ZMQ_RemoteStats));
 
 	if(zrscopy)
 	  memcpy(zrscopy, zrs, sizeof(ZMQ_RemoteStats));
 
-	static_cast<ParserInterface*>(current->iface)->setRemoteStats(zrscopy);
+	static_cast<ParserInterface*>(flowHashing->getEntry(i)->iface)->setRemoteStats(zrscopy);
       }
     }
 
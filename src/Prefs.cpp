@@ -59,6 +59,7 @@ Prefs::Prefs(Ntop *_ntop) {
   num_ts_slots = CONST_DEFAULT_TS_NUM_SLOTS, ts_num_steps = CONST_DEFAULT_TS_NUM_STEPS;
   device_protocol_policies_enabled = false, enable_vlan_trunk_bridge = false;
   max_extracted_pcap_bytes = CONST_DEFAULT_MAX_EXTR_PCAP_BYTES;
+  compress_extracted_pcap = false;
   auth_session_duration = HTTP_SESSION_DURATION;
   auth_session_midnight_expiration = HTTP_SESSION_MIDNIGHT_EXPIRATION;
   install_dir = NULL, captureDirection = PCAP_D_INOUT;
@@ -93,7 +94,7 @@ Prefs::Prefs(Ntop *_ntop) {
   pid_path = strdup(DEFAULT_PID_PATH);
   packet_filter = NULL;
   num_interfaces = 0, enable_auto_logout = true, enable_auto_logout_at_runtime = true;
-  dump_flows_on_es = dump_flows_on_mysql = dump_flows_on_ls = false;
+  dump_flows_on_es = dump_flows_on_mysql = dump_flows_on_ls = dump_flows_on_columnar = false;
   routing_mode_enabled = false;
   global_dns_forging_enabled = false;
 #if defined(NTOPNG_PRO) && defined(HAVE_NINDEX)
@@ -314,6 +315,9 @@ void usage() {
 #ifdef HAVE_NINDEX
 	 "                                    | nindex        Dump in nIndex (Enterprise only)\n\n"
 #endif
+	 "                                    | columnar      Dump in the embedded columnar flow store\n"
+	 "                                    |   under <data dir>/<ifid>/flowstore\n"
+	 "                                    |\n"
 	 "                                    | es            Dump in ElasticSearch database\n"
 	 "                                    |   Format:\n"
 	 "                                    |   es;<mapping type>;<idx name>;<es URL>;<http auth>\n"
@@ -600,6 +604,7 @@ void Prefs::reloadPrefsFromRedis() {
 						   CONST_DEFAULT_LONGLIVED_FLOW_DURATION),
     max_extracted_pcap_bytes = getDefaultPrefsValue(CONST_MAX_EXTR_PCAP_BYTES,
                                                      CONST_DEFAULT_MAX_EXTR_PCAP_BYTES); 
+    compress_extracted_pcap = getDefaultBoolPrefsValue(CONST_COMPRESS_EXTR_PCAP, false);
 
     ewma_alpha_percent = getDefaultPrefsValue(CONST_EWMA_ALPHA_PERCENT, CONST_DEFAULT_EWMA_ALPHA_PERCENT);
 
@@ -1139,7 +1144,9 @@ int Prefs::setOption(int optkey, char *optarg) {
       dump_flows_on_nindex = true;
     } else
 #endif
-    if((strncmp(optarg, "es", 2) == 0) && (strlen(optarg) > 3)) {
+    if(strcmp(optarg, "columnar") == 0) {
+      dump_flows_on_columnar = true;
+    } else if((strncmp(optarg, "es", 2) == 0) && (strlen(optarg) > 3)) {
       char *elastic_index_type = NULL, *elastic_index_name = NULL, *tmp = NULL,
 	*elastic_url = NULL, *elastic_user = NULL, *elastic_pwd = NULL;
       /* es;<index type>;<index name>;<es URL>;<es pwd> */
@@ -1584,6 +1591,7 @@ void Prefs::lua(lua_State* vm) {
   if(mysql_dbname) lua_push_str_table_entry(vm, "mysql_dbname", mysql_dbname);
   lua_push_bool_table_entry(vm, "is_dump_flows_to_es_enabled",    dump_flows_on_es);
   lua_push_bool_table_entry(vm, "is_dump_flows_to_ls_enabled", dump_flows_on_ls);
+  lua_push_bool_table_entry(vm, "is_dump_flows_to_columnar_enabled", dump_flows_on_columnar);
 
   lua_push_uint64_table_entry(vm, "dump_hosts", dump_hosts_to_db);
 
@@ -1657,6 +1665,7 @@ void Prefs::lua(lua_State* vm) {
   lua_push_uint64_table_entry(vm, "longlived_flow_duration", longlived_flow_duration);
 
   lua_push_uint64_table_entry(vm, "max_extracted_pcap_bytes", max_extracted_pcap_bytes);
+  lua_push_bool_table_entry(vm, "compress_extracted_pcap", compress_extracted_pcap);
 
   lua_push_uint64_table_entry(vm, "ewma_alpha_percent", ewma_alpha_percent);
 
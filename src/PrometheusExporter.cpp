@@ -0,0 +1,914 @@
+/*
+ *
+ * (C) 2019 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+
+#include "ntop_includes.h"
+
+#define PROMETHEUS_INITIAL_BUF_SIZE  65536
+
+typedef enum {
+  prom_iface_packets = 0,
+  prom_iface_bytes,
+  prom_iface_drops,
+  prom_iface_flows,
+  prom_iface_hosts,
+  prom_iface_local_hosts,
+  prom_iface_http_hosts,
+  prom_iface_devices,
+  prom_iface_macs
+} PrometheusIfaceMetric;
+
+static const struct {
+  PrometheusIfaceMetric id;
+  const char *name, *type, *help;
+} iface_metrics[] = {
+  { prom_iface_packets,     "ntopng_interface_packets_total", "counter", "Packets received by the interface" },
+  { prom_iface_bytes,       "ntopng_interface_bytes_total",   "counter", "Bytes received by the interface" },
+  { prom_iface_drops,       "ntopng_interface_drops_total",   "counter", "Packets dropped by the interface" },
+  { prom_iface_flows,       "ntopng_interface_flows",         "gauge",   "Active flows" },
+  { prom_iface_hosts,       "ntopng_interface_hosts",         "gauge",   "Active hosts" },
+  { prom_iface_local_hosts, "ntopng_interface_local_hosts",   "gauge",   "Active local hosts" },
+  { prom_iface_http_hosts,  "ntopng_interface_http_hosts",    "gauge",   "Active HTTP virtual hosts" },
+  { prom_iface_devices,     "ntopng_interface_devices",       "gauge",   "Active L2 devices" },
+  { prom_iface_macs,        "ntopng_interface_macs",          "gauge",   "Active MAC addresses" }
+};
+
+struct prometheus_host {
+  char ip[64], masked_ip[64];
+  u_int16_t vlan_id;
+  u_int64_t bytes_sent, bytes_rcvd, packets_sent, packets_rcvd;
+  u_int32_t flows_as_client, flows_as_server;
+  nDPIStats *ndpi; /* Copy, for the legacy "hosts" family */
+};
+
+struct prometheus_as {
+  u_int32_t asn;
+  u_int64_t bytes_sent, bytes_rcvd;
+  u_int16_t num_hosts;
+};
+
+struct prometheus_counter {
+  const char *name;
+  u_int64_t value;
+};
+
+struct prometheus_hosts_walker {
+  struct prometheus_host *hosts;
+  u_int32_t num_hosts, max_num_hosts, num_skipped;
+};
+
+/* ******************************************* */
+
+PrometheusExporter::PrometheusExporter() {
+  buf_len = 0, buf_size = PROMETHEUS_INITIAL_BUF_SIZE;
+
+  if((buf = (char*)malloc(buf_size)) == NULL)
+    buf_size = 0;
+}
+
+/* ******************************************* */
+
+PrometheusExporter::~PrometheusExporter() {
+  if(buf) free(buf);
+}
+
+/* ******************************************* */
+
+void PrometheusExporter::append(const char *fmt, ...) {
+  va_list va_ap;
+  int len;
+
+  while(true) {
+    u_int32_t avail = buf_size - buf_len;
+
+    va_start(va_ap, fmt);
+    len = vsnprintf(buf ? &buf[buf_len] : NULL, avail, fmt, va_ap);
+    va_end(va_ap);
+
+    if(len < 0)
+      return;
+    else if((u_int32_t)len < avail) {
+      buf_len += len;
+      return;
+    } else {
+      u_int32_t new_size = (buf_size ? buf_size : PROMETHEUS_INITIAL_BUF_SIZE) * 2;
+      char *new_buf;
+
+      while(new_size - buf_len <= (u_int32_t)len) new_size *= 2;
+
+      if((new_buf = (char*)realloc(buf, new_size)) == NULL) {
+	ntop->getTrace()->traceEvent(TRACE_ERROR, "Not enough memory for the metrics buffer");
+	return;
+      }
+
+      buf = new_buf, buf_size = new_size;
+    }
+  }
+}
+
+/* ******************************************* */
+
+void PrometheusExporter::appendHeader(const char *name, const char *type, const char *help) {
+  append("# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+/* ******************************************* */
+
+/* Label values must have backslash, double-quote and line feed escaped */
+void PrometheusExporter::appendLabel(const char *value) {
+  char escaped[256];
+  u_int i = 0;
+
+  for(; *value && (i < sizeof(escaped) - 2); value++) {
+    switch(*value) {
+    case '\\':
+    case '"':
+      escaped[i++] = '\\', escaped[i++] = *value;
+      break;
+    case '\n':
+      escaped[i++] = '\\', escaped[i++] = 'n';
+      break;
+    default:
+      escaped[i++] = *value;
+    }
+  }
+
+  escaped[i] = '\0';
+  append("%s", escaped);
+}
+
+/* ******************************************* */
+
+/*
+  A series of the "ifaces" and "hosts" families exported by the former
+  scripts/lua/metrics.lua: the statistic is named by the metric label
+  and, as then, zero values are omitted.
+*/
+void PrometheusExporter::appendLegacy(const char *family, const char *ifname, const char *ip,
+				      const char *metric, u_int64_t value) {
+  if(value == 0)
+    return;
+
+  append("%s{ifname=\"", family);
+  appendLabel(ifname);
+
+  if(ip) {
+    append("\",ip=\"");
+    appendLabel(ip);
+  }
+
+  append("\",metric=\"");
+  appendLabel(metric);
+  append("\"} %llu\n", (unsigned long long)value);
+}
+
+/* ******************************************* */
+
+static u_int64_t getIfaceMetric(NetworkInterface *iface, PrometheusIfaceMetric id) {
+  switch(id) {
+  case prom_iface_packets:     return(iface->getNumPackets());
+  case prom_iface_bytes:       return(iface->getNumBytes());
+  case prom_iface_drops:       return(iface->getNumPacketDrops());
+  case prom_iface_flows:       return(iface->getNumFlows());
+  case prom_iface_hosts:       return(iface->getNumHosts());
+  case prom_iface_local_hosts: return(iface->getNumLocalHosts());
+  case prom_iface_http_hosts:  return(iface->getNumHTTPHosts());
+  case prom_iface_devices:     return(iface->getNumL2Devices());
+  case prom_iface_macs:        return(iface->getNumMacs());
+  }
+
+  return(0);
+}
+
+/* ******************************************* */
+
+void PrometheusExporter::dumpInterfaces() {
+  for(u_int i = 0; i < sizeof(iface_metrics) / sizeof(iface_metrics[0]); i++) {
+    appendHeader(iface_metrics[i].name, iface_metrics[i].type, iface_metrics[i].help);
+
+    for(int j = 0; j < ntop->get_num_interfaces(); j++) {
+      NetworkInterface *iface = ntop->getInterface(j);
+
+      if(!iface) continue;
+
+      append("%s{ifname=\"", iface_metrics[i].name);
+      appendLabel(iface->get_name());
+      append("\",ifid=\"%d\"} %llu\n", iface->get_id(),
+	     (unsigned long long)getIfaceMetric(iface, iface_metrics[i].id));
+    }
+  }
+}
+
+/* ******************************************* */
+
+static bool prometheus_ases_walker(GenericHashEntry *he, void *user_data, bool *matched) {
+  std::vector<struct prometheus_as> *ases = (std::vector<struct prometheus_as>*)user_data;
+  AutonomousSystem *as = (AutonomousSystem*)he;
+  struct prometheus_as pa;
+
+  pa.asn = as->get_asn(), pa.num_hosts = as->getNumHosts();
+  pa.bytes_sent = as->getNumBytesSent(), pa.bytes_rcvd = as->getNumBytesRcvd();
+  ases->push_back(pa);
+  *matched = true;
+
+  return(false); /* false = keep on walking */
+}
+
+/* ******************************************* */
+
+/* The interface statistics of metrics.lua (the DB export counters excepted) */
+void PrometheusExporter::dumpLegacyInterfaces() {
+  appendHeader("ifaces", "untyped", "Interface statistics by metric (see also the ntopng_interface_* families)");
+
+  for(int j = 0; j < ntop->get_num_interfaces(); j++) {
+    NetworkInterface *iface = ntop->getInterface(j);
+    std::vector<struct prometheus_as> ases;
+    nDPIStats ndpi;
+    u_int32_t begin_slot = 0;
+    const char *ifname;
+    char metric[128];
+
+    if(!iface || iface->isView()) continue;
+
+    ifname = iface->get_name();
+
+    appendLegacy("ifaces", ifname, NULL, "stats.packets", iface->getNumPackets());
+    appendLegacy("ifaces", ifname, NULL, "stats.bytes", iface->getNumBytes());
+    appendLegacy("ifaces", ifname, NULL, "stats.flows", iface->getNumFlows());
+    appendLegacy("ifaces", ifname, NULL, "stats.hosts", iface->getNumHosts());
+    appendLegacy("ifaces", ifname, NULL, "stats.local_hosts", iface->getNumLocalHosts());
+    appendLegacy("ifaces", ifname, NULL, "stats.http_hosts", iface->getNumHTTPHosts());
+    appendLegacy("ifaces", ifname, NULL, "stats.drops", iface->getNumPacketDrops());
+    appendLegacy("ifaces", ifname, NULL, "stats.devices", iface->getNumL2Devices());
+    appendLegacy("ifaces", ifname, NULL, "stats.num_live_captures", iface->getNumLiveCaptures());
+    appendLegacy("ifaces", ifname, NULL, "stats.arp.requests", iface->getNumARPRequests());
+    appendLegacy("ifaces", ifname, NULL, "stats.arp.replies", iface->getNumARPReplies());
+
+    /* Protocols of the active flows, as interface.getnDPIStats() */
+    iface->getnDPIStats(&ndpi, NULL, NULL, 0);
+
+    for(u_int16_t p = 0; p < MAX_NDPI_PROTOS; p++) {
+      const ProtoCounter *c = ndpi.getProtoCounter(p);
+
+      if(!c) continue;
+
+      snprintf(metric, sizeof(metric), "L7.%s.bytes.sent", iface->get_ndpi_proto_name(p));
+      appendLegacy("ifaces", ifname, NULL, metric, c->bytes.sent);
+      snprintf(metric, sizeof(metric), "L7.%s.bytes.rcvd", iface->get_ndpi_proto_name(p));
+      appendLegacy("ifaces", ifname, NULL, metric, c->bytes.rcvd);
+    }
+
+    iface->walker(&begin_slot, true /* walk all */, walker_ases, prometheus_ases_walker, &ases);
+
+    for(std::vector<struct prometheus_as>::iterator it = ases.begin(); it != ases.end(); ++it) {
+      snprintf(metric, sizeof(metric), "AS.%u.bytes.sent", it->asn);
+      appendLegacy("ifaces", ifname, NULL, metric, it->bytes_sent);
+      snprintf(metric, sizeof(metric), "AS.%u.bytes.rcvd", it->asn);
+      appendLegacy("ifaces", ifname, NULL, metric, it->bytes_rcvd);
+      snprintf(metric, sizeof(metric), "AS.%u.num_hosts", it->asn);
+      appendLegacy("ifaces", ifname, NULL, metric, it->num_hosts);
+    }
+
+    for(u_int8_t network_id = 0; network_id < ntop->getNumLocalNetworks(); network_id++) {
+      NetworkStats *ns = iface->getNetworkStats(network_id);
+
+      if(!ns || !ns->trafficSeen()) continue;
+
+      snprintf(metric, sizeof(metric), "net.%s.egress", ntop->getLocalNetworkName(network_id));
+      appendLegacy("ifaces", ifname, NULL, metric, ns->getEgressBytes());
+      snprintf(metric, sizeof(metric), "net.%s.inner", ntop->getLocalNetworkName(network_id));
+      appendLegacy("ifaces", ifname, NULL, metric, ns->getInnerBytes());
+    }
+  }
+}
+
+/* ******************************************* */
+
+static const char *hash_names[] = { "flows", "hosts", "macs", "vlans", "ases", "countries" };
+#define NUM_IFACE_HASHES (sizeof(hash_names) / sizeof(hash_names[0]))
+
+static void getIfaceHashes(NetworkInterface *iface, GenericHash *hashes[NUM_IFACE_HASHES]) {
+  hashes[0] = iface->get_flows_hash(), hashes[1] = iface->get_hosts_hash(),
+    hashes[2] = iface->get_macs_hash(), hashes[3] = iface->get_vlans_hash(),
+    hashes[4] = iface->get_ases_hash(), hashes[5] = iface->get_countries_hash();
+}
+
+/* ******************************************* */
+
+void PrometheusExporter::dumpHashTables() {
+
+  for(int metric = 0; metric < 2; metric++) {
+    const char *metric_name = metric ? "ntopng_hash_capacity" : "ntopng_hash_entries";
+
+    appendHeader(metric_name, "gauge",
+		 metric ? "Maximum number of entries of the hash table" : "Entries currently stored in the hash table");
+
+    for(int j = 0; j < ntop->get_num_interfaces(); j++) {
+      NetworkInterface *iface = ntop->getInterface(j);
+      GenericHash *hashes[NUM_IFACE_HASHES];
+
+      if(!iface || iface->isView()) continue;
+
+      getIfaceHashes(iface, hashes);
+
+      for(u_int h = 0; h < NUM_IFACE_HASHES; h++) {
+	if(!hashes[h]) continue;
+
+	append("%s{ifname=\"", metric_name);
+	appendLabel(iface->get_name());
+	append("\",hash=\"%s\"} %u\n", hash_names[h],
+	       metric ? hashes[h]->getMaxHashSize() : hashes[h]->getNumEntries());
+      }
+    }
+  }
+}
+
+/* ******************************************* */
+
+void PrometheusExporter::dumpHashChains() {
+  appendHeader("ntopng_hash_chain_length", "histogram",
+	       "Length of the entry chains of the hash table buckets");
+
+  for(int j = 0; j < ntop->get_num_interfaces(); j++) {
+    NetworkInterface *iface = ntop->getInterface(j);
+    GenericHash *hashes[NUM_IFACE_HASHES];
+
+    if(!iface || iface->isView()) continue;
+
+    getIfaceHashes(iface, hashes);
+
+    for(u_int h = 0; h < NUM_IFACE_HASHES; h++) {
+      HashChainStats stats;
+      u_int64_t cumulative = 0, num_buckets = 0;
+
+      if(!hashes[h]) continue;
+
+      /* Computed by the purge: nothing to report until all the buckets have been visited */
+      hashes[h]->getChainStats(&stats);
+
+      for(u_int slot = 0; slot < HASH_CHAIN_HISTOGRAM_SLOTS; slot++)
+	num_buckets += stats.num_buckets[slot];
+
+      if(num_buckets == 0) continue;
+
+      for(u_int slot = 0; slot < HASH_CHAIN_HISTOGRAM_SLOTS; slot++) {
+	int32_t bound = GenericHash::getChainSlotBound(slot);
+
+	cumulative += stats.num_buckets[slot];
+
+	append("ntopng_hash_chain_length_bucket{ifname=\"");
+	appendLabel(iface->get_name());
+
+	if(bound >= 0)
+	  append("\",hash=\"%s\",le=\"%d\"} %llu\n", hash_names[h], bound, (unsigned long long)cumulative);
+	else
+	  append("\",hash=\"%s\",le=\"+Inf\"} %llu\n", hash_names[h], (unsigned long long)cumulative);
+      }
+
+      append("ntopng_hash_chain_length_sum{ifname=\"");
+      appendLabel(iface->get_name());
+      append("\",hash=\"%s\"} %llu\n", hash_names[h], (unsigned long long)stats.num_entries);
+
+      append("ntopng_hash_chain_length_count{ifname=\"");
+      appendLabel(iface->get_name());
+      append("\",hash=\"%s\"} %llu\n", hash_names[h], (unsigned long long)num_buckets);
+    }
+  }
+}
+
+/* ******************************************* */
+
+void PrometheusExporter::dumpFlowIndexes() {
+  for(int metric = 0; metric < 2; metric++) {
+    const char *metric_name = metric ? "ntopng_flow_index_memory_bytes" : "ntopng_flow_index_flows";
+
+    appendHeader(metric_name, "gauge",
+		 metric ? "Memory used by the flow secondary indexes" : "Flows linked in the flow secondary indexes");
+
+    for(int j = 0; j < ntop->get_num_interfaces(); j++) {
+      NetworkInterface *iface = ntop->getInterface(j);
+      FlowIndex *index;
+
+      if(!iface || iface->isView() || ((index = iface->getFlowIndex()) == NULL))
+	continue;
+
+      append("%s{ifname=\"", metric_name);
+      appendLabel(iface->get_name());
+      append("\"} %llu\n", (unsigned long long)(metric ? index->getMemoryUsage() : index->getNumFlows()));
+    }
+  }
+}
+
+/* ******************************************* */
+
+void PrometheusExporter::dumpRecording() {
+  const char *names[] = { "ntopng_recording_packets_total", "ntopng_recording_drops_total",
+			  "ntopng_recording_written_bytes_total", "ntopng_recording_disk_bytes" };
+  const char *helps[] = { "Packets recorded by the native recorder", "Packets not recorded as no buffer was available",
+			  "Bytes written to the recording segments", "Disk space used by the recording segments" };
+
+  for(int metric = 0; metric < 4; metric++) {
+    appendHeader(names[metric], (metric == 3) ? "gauge" : "counter", helps[metric]);
+
+    for(int j = 0; j < ntop->get_num_interfaces(); j++) {
+      NetworkInterface *iface = ntop->getInterface(j);
+      PacketRecorder *recorder;
+      u_int64_t v;
+
+      if(!iface || ((recorder = iface->getPacketRecorder()) == NULL))
+	continue;
+
+      switch(metric) {
+      case 0:  v = recorder->getNumPackets();      break;
+      case 1:  v = recorder->getNumDrops();        break;
+      case 2:  v = recorder->getNumWrittenBytes(); break;
+      default: v = recorder->getDiskBytes();       break;
+      }
+
+      append("%s{ifname=\"", names[metric]);
+      appendLabel(iface->get_name());
+      append("\"} %llu\n", (unsigned long long)v);
+    }
+  }
+}
+
+/* ******************************************* */
+
+void PrometheusExporter::dumpFlowAlerts() {
+  const char *results[] = { "written", "failed", "dropped" };
+
+  appendHeader("ntopng_flow_alerts_total", "counter", "Flow alerts, by result of the asynchronous write");
+
+  for(int j = 0; j < ntop->get_num_interfaces(); j++) {
+    NetworkInterface *iface = ntop->getInterface(j);
+    AlertsManager *am;
+
+    if(!iface || ((am = iface->getAlertsManager()) == NULL))
+      continue;
+
+    for(int r = 0; r < 3; r++) {
+      u_int64_t v = (r == 0) ? am->getNumFlowAlertsWritten() : ((r == 1) ? am->getNumFlowAlertsFailed() : am->getNumFlowAlertsDropped());
+
+      append("ntopng_flow_alerts_total{ifname=\"");
+      appendLabel(iface->get_name());
+      append("\",result=\"%s\"} %llu\n", results[r], (unsigned long long)v);
+    }
+  }
+
+  appendHeader("ntopng_flow_alerts_queue_length", "gauge", "Flow alerts waiting to be written");
+
+  for(int j = 0; j < ntop->get_num_interfaces(); j++) {
+    NetworkInterface *iface = ntop->getInterface(j);
+    AlertsManager *am;
+
+    if(!iface || ((am = iface->getAlertsManager()) == NULL))
+      continue;
+
+    append("ntopng_flow_alerts_queue_length{ifname=\"");
+    appendLabel(iface->get_name());
+    append("\"} %u\n", am->getFlowAlertsQueueLen());
+  }
+
+  appendHeader("ntopng_flow_alerts_batch_seconds", "summary",
+	       "Time spent writing and notifying a batch of flow alerts");
+
+  for(int j = 0; j < ntop->get_num_interfaces(); j++) {
+    NetworkInterface *iface = ntop->getInterface(j);
+    AlertsManager *am;
+
+    if(!iface || ((am = iface->getAlertsManager()) == NULL))
+      continue;
+
+    append("ntopng_flow_alerts_batch_seconds_sum{ifname=\"");
+    appendLabel(iface->get_name());
+    append("\"} %.6f\n", am->getFlowAlertsBatchUsec() / 1000000.);
+    append("ntopng_flow_alerts_batch_seconds_count{ifname=\"");
+    appendLabel(iface->get_name());
+    append("\"} %llu\n", (unsigned long long)am->getNumFlowAlertsBatches());
+  }
+}
+
+/* ******************************************* */
+
+void PrometheusExporter::dumpHostPools() {
+  for(int metric = 0; metric < 2; metric++) {
+    const char *metric_name = metric ? "ntopng_host_pool_l2_devices" : "ntopng_host_pool_hosts";
+
+    appendHeader(metric_name, "gauge",
+		 metric ? "Active L2 devices of the host pool" : "Active hosts of the host pool");
+
+    for(int j = 0; j < ntop->get_num_interfaces(); j++) {
+      NetworkInterface *iface = ntop->getInterface(j);
+      HostPools *pools;
+
+      if(!iface || iface->isView() || ((pools = iface->getHostPools()) == NULL))
+	continue;
+
+      for(u_int16_t pool_id = 0; pool_id < pools->getMaxNumPools(); pool_id++) {
+	int32_t hosts = pools->getNumPoolHosts(pool_id);
+	int32_t devices = pools->getNumPoolL2Devices(pool_id);
+
+	if((hosts <= 0) && (devices <= 0))
+	  continue;
+
+	append("%s{ifname=\"", metric_name);
+	appendLabel(iface->get_name());
+	append("\",pool=\"%u\"} %d\n", pool_id, metric ? devices : hosts);
+      }
+    }
+  }
+
+  appendHeader("ntopng_host_pool_reload_seconds", "gauge", "Latency of the latest host pools reload");
+
+  for(int j = 0; j < ntop->get_num_interfaces(); j++) {
+    NetworkInterface *iface = ntop->getInterface(j);
+    HostPools *pools;
+
+    if(!iface || iface->isView() || ((pools = iface->getHostPools()) == NULL))
+      continue;
+
+    append("ntopng_host_pool_reload_seconds{ifname=\"");
+    appendLabel(iface->get_name());
+    append("\"} %.6f\n", pools->getLastReloadUsec() / 1000000.);
+  }
+
+  appendHeader("ntopng_host_pool_reloads_total", "counter", "Host pools reloads");
+
+  for(int j = 0; j < ntop->get_num_interfaces(); j++) {
+    NetworkInterface *iface = ntop->getInterface(j);
+    HostPools *pools;
+
+    if(!iface || iface->isView() || ((pools = iface->getHostPools()) == NULL))
+      continue;
+
+    for(int kind = 0; kind < 2; kind++) {
+      append("ntopng_host_pool_reloads_total{ifname=\"");
+      appendLabel(iface->get_name());
+      append("\",kind=\"%s\"} %u\n", kind ? "incremental" : "full",
+	     kind ? pools->getNumIncrementalReloads() : pools->getNumFullReloads());
+    }
+  }
+}
+
+/* ******************************************* */
+
+void PrometheusExporter::dumpExporters() {
+  appendHeader("ntopng_db_exported_flows_total", "counter", "Flows exported to the flow database");
+
+  for(int j = 0; j < ntop->get_num_interfaces(); j++) {
+    NetworkInterface *iface = ntop->getInterface(j);
+    DB *db;
+
+    if(!iface || ((db = iface->getDB()) == NULL)) continue;
+
+    append("ntopng_db_exported_flows_total{ifname=\"");
+    appendLabel(iface->get_name());
+    append("\"} %llu\n", (unsigned long long)db->getNumExportedFlows());
+  }
+
+  appendHeader("ntopng_db_dropped_flows_total", "counter", "Flows dropped while exporting to the flow database");
+
+  for(int j = 0; j < ntop->get_num_interfaces(); j++) {
+    NetworkInterface *iface = ntop->getInterface(j);
+    DB *db;
+
+    if(!iface || ((db = iface->getDB()) == NULL)) continue;
+
+    append("ntopng_db_dropped_flows_total{ifname=\"");
+    appendLabel(iface->get_name());
+    append("\"} %u\n", db->getNumDroppedFlows());
+  }
+
+  appendHeader("ntopng_zmq_remote_counters", "gauge", "Counters reported by the remote flow probe");
+
+  for(int j = 0; j < ntop->get_num_interfaces(); j++) {
+    NetworkInterface *iface = ntop->getInterface(j);
+    const ZMQ_RemoteStats *zrs;
+
+    if(!iface || ((zrs = iface->getRemoteStats()) == NULL)) continue;
+
+    const struct prometheus_counter counters[] = {
+      { "flow_exports",           zrs->num_flow_exports       },
+      { "export_queue_full",      zrs->export_queue_full      },
+      { "too_many_flows",         zrs->too_many_flows         },
+      { "elk_flow_drops",         zrs->elk_flow_drops         },
+      { "sflow_pkt_sample_drops", zrs->sflow_pkt_sample_drops }
+    };
+    const struct prometheus_counter *c, *end;
+
+    for(c = counters, end = &counters[sizeof(counters) / sizeof(counters[0])]; c < end; c++) {
+      append("ntopng_zmq_remote_counters{ifname=\"");
+      appendLabel(iface->get_name());
+      append("\",counter=\"%s\"} %llu\n", c->name, (unsigned long long)c->value);
+    }
+  }
+
+  dumpTimeseriesExport();
+}
+
+/* ******************************************* */
+
+void PrometheusExporter::dumpTimeseriesExport() {
+  const char *names[] = { "ntopng_influxdb_points_total", "ntopng_influxdb_sent_bytes_total",
+			  "ntopng_influxdb_dropped_points_total", "ntopng_influxdb_failures_total",
+			  "ntopng_influxdb_queue_length" };
+  const char *helps[] = { "Timeseries points exported to InfluxDB", "Compressed bytes posted to InfluxDB",
+			  "Timeseries points discarded", "Failed posts to InfluxDB",
+			  "Batches waiting to be posted to InfluxDB, in memory or on disk" };
+
+  for(int metric = 0; metric < 5; metric++) {
+    appendHeader(names[metric], (metric == 4) ? "gauge" : "counter", helps[metric]);
+
+    for(int j = 0; j < ntop->get_num_interfaces(); j++) {
+      NetworkInterface *iface = ntop->getInterface(j);
+      TimeseriesExporter *exporter;
+      u_int64_t v;
+
+      if(!iface || ((exporter = iface->getActiveTSExporter()) == NULL))
+	continue;
+
+      switch(metric) {
+      case 0:  v = exporter->getNumPoints();        break;
+      case 1:  v = exporter->getNumSentBytes();     break;
+      case 2:  v = exporter->getNumDroppedPoints(); break;
+      case 3:  v = exporter->getNumFailures();      break;
+      default: v = exporter->getNumQueuedBatches(); break;
+      }
+
+      append("%s{ifname=\"", names[metric]);
+      appendLabel(iface->get_name());
+      append("\"} %llu\n", (unsigned long long)v);
+    }
+  }
+}
+
+/* ******************************************* */
+
+void PrometheusExporter::dumpGeolocation() {
+  Geolocation *geo = ntop->getGeolocation();
+
+  if(!geo) return;
+
+  appendHeader("ntopng_geoip_cache_lookups_total", "counter",
+	       "Host geolocation requests, by result of the per-host cache");
+  append("ntopng_geoip_cache_lookups_total{result=\"hit\"} %llu\n",
+	 (unsigned long long)geo->getNumCacheHits());
+  append("ntopng_geoip_cache_lookups_total{result=\"miss\"} %llu\n",
+	 (unsigned long long)geo->getNumCacheMisses());
+}
+
+/* ******************************************* */
+
+void PrometheusExporter::dumpAddressResolution() {
+  AddressResolution *a = ntop->getAddressResolution();
+  DnsCache *c = a->getCache();
+
+  appendHeader("ntopng_dns_cache_lookups_total", "counter",
+	       "Address to name lookups, by result of the in-memory cache");
+  append("ntopng_dns_cache_lookups_total{result=\"hit\"} %llu\n", (unsigned long long)c->getNumHits());
+  append("ntopng_dns_cache_lookups_total{result=\"negative_hit\"} %llu\n", (unsigned long long)c->getNumNegativeHits());
+  append("ntopng_dns_cache_lookups_total{result=\"pending\"} %llu\n", (unsigned long long)c->getNumPendingHits());
+  append("ntopng_dns_cache_lookups_total{result=\"miss\"} %llu\n", (unsigned long long)c->getNumMisses());
+
+  appendHeader("ntopng_dns_cache_entries", "gauge", "Entries of the in-memory address cache");
+  append("ntopng_dns_cache_entries %u\n", c->getNumEntries());
+
+  appendHeader("ntopng_dns_queue_length", "gauge", "Addresses waiting to be resolved");
+  append("ntopng_dns_queue_length %u\n", a->getQueueLength());
+
+  appendHeader("ntopng_dns_queue_drops_total", "counter", "Addresses not resolved as the queue was full");
+  append("ntopng_dns_queue_drops_total %llu\n", (unsigned long long)a->getNumQueueDrops());
+
+  appendHeader("ntopng_dns_resolution_latency_seconds", "summary",
+	       "Time from queueing an address to its resolution");
+  append("ntopng_dns_resolution_latency_seconds_sum %.6f\n", a->getLatencyUsecTotal() / 1000000.);
+  append("ntopng_dns_resolution_latency_seconds_count %llu\n", (unsigned long long)a->getNumLatencySamples());
+}
+
+/* ******************************************* */
+
+static bool prometheus_hosts_walker(GenericHashEntry *he, void *user_data, bool *matched) {
+  struct prometheus_hosts_walker *w = (struct prometheus_hosts_walker*)user_data;
+  struct prometheus_host *ph;
+  Host *h = (Host*)he;
+
+  if(!h || h->idle() || !h->isLocalHost())
+    return(false);
+
+  if(w->num_hosts >= w->max_num_hosts) {
+    w->num_skipped++;
+    return(false); /* Keep on walking to count the skipped hosts */
+  }
+
+  ph = &w->hosts[w->num_hosts++];
+  h->get_ip()->print(ph->ip, sizeof(ph->ip));
+  h->get_ip()->printMask(ph->masked_ip, sizeof(ph->masked_ip), h->isLocalHost());
+  ph->vlan_id = h->get_vlan_id();
+  ph->bytes_sent = h->getNumBytesSent(), ph->bytes_rcvd = h->getNumBytesRcvd();
+  ph->packets_sent = h->getNumPktsSent(), ph->packets_rcvd = h->getNumPktsRcvd();
+  ph->ndpi = h->get_ndpi_stats() ? new(std::nothrow) nDPIStats(*h->get_ndpi_stats()) : NULL;
+  ph->flows_as_client = h->getNumOutgoingFlows(), ph->flows_as_server = h->getNumIncomingFlows();
+  *matched = true;
+
+  return(false); /* false = keep on walking */
+}
+
+/* ******************************************* */
+
+void PrometheusExporter::dumpLocalHosts(u_int32_t max_num_hosts) {
+  const char *names[] = {
+    "ntopng_host_bytes_sent_total", "ntopng_host_bytes_rcvd_total",
+    "ntopng_host_active_flows_as_client", "ntopng_host_active_flows_as_server"
+  };
+  const char *helps[] = {
+    "Bytes sent by the local host", "Bytes received by the local host",
+    "Active flows with the local host as client", "Active flows with the local host as server"
+  };
+  const u_int num_metrics = sizeof(names) / sizeof(names[0]);
+  u_int32_t num_ifaces = ntop->get_num_interfaces(), max_per_iface, remaining = max_num_hosts;
+  struct prometheus_hosts_walker *walkers;
+
+  if((max_num_hosts == 0) || (num_ifaces == 0)
+     || ((walkers = (struct prometheus_hosts_walker*)calloc(num_ifaces, sizeof(*walkers))) == NULL))
+    return;
+
+  /* The cardinality cap is global: interfaces are walked in order until it is exhausted */
+  for(u_int32_t j = 0; j < num_ifaces; j++) {
+    NetworkInterface *iface = ntop->getInterface(j);
+    u_int32_t begin_slot = 0;
+
+    if(!iface || iface->isView()) continue;
+
+    max_per_iface = ndpi_min(remaining, iface->getNumLocalHosts());
+    walkers[j].max_num_hosts = max_per_iface;
+
+    if(max_per_iface
+       && ((walkers[j].hosts = (struct prometheus_host*)malloc(max_per_iface * sizeof(struct prometheus_host))) == NULL))
+      walkers[j].max_num_hosts = 0;
+
+    iface->walker(&begin_slot, true /* walk all */, walker_hosts, prometheus_hosts_walker, &walkers[j]);
+    remaining -= walkers[j].num_hosts;
+  }
+
+  for(u_int m = 0; m < num_metrics; m++) {
+    appendHeader(names[m], (m < 2) ? "counter" : "gauge", helps[m]);
+
+    for(u_int32_t j = 0; j < num_ifaces; j++) {
+      NetworkInterface *iface = ntop->getInterface(j);
+
+      for(u_int32_t k = 0; k < walkers[j].num_hosts; k++) {
+	struct prometheus_host *ph = &walkers[j].hosts[k];
+	u_int64_t value;
+
+	switch(m) {
+	case 0:  value = ph->bytes_sent;      break;
+	case 1:  value = ph->bytes_rcvd;      break;
+	case 2:  value = ph->flows_as_client; break;
+	default: value = ph->flows_as_server; break;
+	}
+
+	append("%s{ifname=\"", names[m]);
+	appendLabel(iface->get_name());
+	append("\",host=\"%s\",vlan=\"%u\"} %llu\n", ph->ip, ph->vlan_id, (unsigned long long)value);
+      }
+    }
+  }
+
+  /* The host statistics of metrics.lua */
+  appendHeader("hosts", "untyped", "Local host statistics by metric (see also the ntopng_host_* families)");
+
+  for(u_int32_t j = 0; j < num_ifaces; j++) {
+    NetworkInterface *iface = ntop->getInterface(j);
+
+    for(u_int32_t k = 0; k < walkers[j].num_hosts; k++) {
+      struct prometheus_host *ph = &walkers[j].hosts[k];
+      char metric[128];
+
+      appendLegacy("hosts", iface->get_name(), ph->masked_ip, "stats.bytes.sent", ph->bytes_sent);
+      appendLegacy("hosts", iface->get_name(), ph->masked_ip, "stats.bytes.rcvd", ph->bytes_rcvd);
+      appendLegacy("hosts", iface->get_name(), ph->masked_ip, "stats.packets.sent", ph->packets_sent);
+      appendLegacy("hosts", iface->get_name(), ph->masked_ip, "stats.packets.rcvd", ph->packets_rcvd);
+      appendLegacy("hosts", iface->get_name(), ph->masked_ip, "stats.active_flows.as_client", ph->flows_as_client);
+      appendLegacy("hosts", iface->get_name(), ph->masked_ip, "stats.active_flows.as_server", ph->flows_as_server);
+
+      if(!ph->ndpi) continue;
+
+      for(u_int16_t p = 0; p < MAX_NDPI_PROTOS; p++) {
+	const ProtoCounter *c = ph->ndpi->getProtoCounter(p);
+
+	if(!c) continue;
+
+	snprintf(metric, sizeof(metric), "L7.%s.bytes.sent", iface->get_ndpi_proto_name(p));
+	appendLegacy("hosts", iface->get_name(), ph->masked_ip, metric, c->bytes.sent);
+	snprintf(metric, sizeof(metric), "L7.%s.bytes.rcvd", iface->get_ndpi_proto_name(p));
+	appendLegacy("hosts", iface->get_name(), ph->masked_ip, metric, c->bytes.rcvd);
+      }
+
+      delete ph->ndpi;
+    }
+  }
+
+  appendHeader("ntopng_host_series_skipped", "gauge",
+	       "Local hosts omitted from the per-host series because of the cardinality cap");
+
+  for(u_int32_t j = 0; j < num_ifaces; j++) {
+    NetworkInterface *iface = ntop->getInterface(j);
+
+    if(!iface || iface->isView()) continue;
+
+    append("ntopng_host_series_skipped{ifname=\"");
+    appendLabel(iface->get_name());
+    append("\"} %u\n", walkers[j].num_skipped);
+
+    if(walkers[j].hosts) free(walkers[j].hosts);
+  }
+
+  free(walkers);
+}
+
+/* ******************************************* */
+
+int PrometheusExporter::handleRequest(struct mg_connection *conn,
+				      const struct mg_request_info *request_info) {
+  char val[32], *page;
+  u_int32_t page_len, page_size;
+  bool dump_hosts = false;
+  u_int32_t max_num_hosts = PROMETHEUS_DEFAULT_MAX_NUM_HOSTS;
+  const char *query = request_info->query_string;
+  size_t query_len = query ? strlen(query) : 0;
+
+  if(query) {
+    if((mg_get_var(query, query_len, "hosts", val, sizeof(val)) > 0)
+       && (!strcmp(val, "1") || !strcmp(val, "true")))
+      dump_hosts = true;
+
+    if(mg_get_var(query, query_len, "max_hosts", val, sizeof(val)) > 0)
+      max_num_hosts = (u_int32_t)strtoul(val, NULL, 10);
+  }
+
+  m.lock(__FILE__, __LINE__);
+
+  buf_len = 0;
+  dumpInterfaces();
+  dumpHashTables();
+  dumpHashChains();
+  dumpFlowIndexes();
+  dumpRecording();
+  dumpFlowAlerts();
+  dumpHostPools();
+  dumpExporters();
+  dumpGeolocation();
+  dumpAddressResolution();
+  dumpLegacyInterfaces();
+
+  if(dump_hosts)
+    dumpLocalHosts(max_num_hosts);
+
+  /*
+    The page is sent without the lock, so that a slow scraper does not
+    block the others: the buffer is taken over and given back afterwards
+  */
+  page = buf, page_len = buf_len, page_size = buf_size;
+  buf = NULL, buf_len = buf_size = 0;
+
+  m.unlock(__FILE__, __LINE__);
+
+  mg_printf(conn,
+	    "HTTP/1.1 200 OK\r\n"
+	    "Content-Type: text/plain; version=0.0.4\r\n"
+	    "Content-Length: %u\r\n"
+	    "Cache-Control: no-cache\r\n"
+	    "Connection: close\r\n\r\n", page_len);
+
+  if(page_len)
+    mg_write(conn, page, page_len);
+
+  m.lock(__FILE__, __LINE__);
+
+  if((buf == NULL) && page)
+    buf = page, buf_size = page_size;
+  else if(page)
+    free(page); /* A concurrent scrape allocated its own buffer */
+
+  m.unlock(__FILE__, __LINE__);
+
+  return(1); /* Request handled */
+}
@@ -0,0 +1,354 @@
+/*
+ *
+ * (C) 2019 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+
+
+
+#include "ntop_includes.h"
+
+/* **************************************************** */
+
+RecordingReader::RecordingReader(const char * const _dir, int _datalink) {
+  snprintf(dir, sizeof(dir), "%s", _dir);
+  datalink = _datalink;
+  from = to = 0;
+  has_filter = false, num_keys = 0;
+  next_segment = 0;
+  map = NULL, map_len = 0, pos = end = 0;
+  blocks = NULL, num_blocks = 0, cur_block = (u_int32_t)-1;
+  memset(&hdr, 0, sizeof(hdr));
+  memset(&stats, 0, sizeof(stats));
+}
+
+/* **************************************************** */
+
+RecordingReader::~RecordingReader() {
+  closeSegment();
+
+  if(has_filter)
+    pcap_freecode(&fcode);
+}
+
+/* **************************************************** */
+
+/*
+  Keys are only used when the filter is a conjunction of
+  [ip|ip6|tcp|udp|sctp] [src|dst] host <address> and
+  [tcp|udp|sctp] [src|dst] port <number> terms: a matching
+  packet then carries all of them.
+*/
+bool RecordingReader::parseFilterKeys(const char * const bpf_filter) {
+  char *filter, *tok, *tmp;
+  bool expect_term = true, ok = true;
+
+  num_keys = 0;
+
+  if((filter = strdup(bpf_filter)) == NULL)
+    return(false);
+
+  tok = strtok_r(filter, " \t", &tmp);
+
+  while(ok && tok) {
+    if(!expect_term) {
+      /* Only conjunctions are supported */
+      if(strcmp(tok, "and") && strcmp(tok, "&&")) ok = false;
+      expect_term = true;
+      tok = strtok_r(NULL, " \t", &tmp);
+      continue;
+    }
+
+    /* Optional protocol and direction qualifiers */
+    if(!strcmp(tok, "ip") || !strcmp(tok, "ip6") || !strcmp(tok, "tcp")
+       || !strcmp(tok, "udp") || !strcmp(tok, "sctp")) {
+      if((tok = strtok_r(NULL, " \t", &tmp)) == NULL || !strcmp(tok, "and") || !strcmp(tok, "&&")) {
+	expect_term = false; /* Protocol only term, e.g. "tcp and port 80" */
+	continue;
+      }
+    }
+
+    if(!strcmp(tok, "src") || !strcmp(tok, "dst"))
+      tok = strtok_r(NULL, " \t", &tmp);
+
+    if(tok && !strcmp(tok, "host")) {
+      u_int8_t addr[16];
+      char *value = strtok_r(NULL, " \t", &tmp);
+
+      if(value && (num_keys < RECORDER_MAX_FILTER_KEYS) && (inet_pton(AF_INET, value, addr) == 1))
+	keys[num_keys++] = PacketRecorder::hashHostKey(addr, 4);
+      else if(value && (num_keys < RECORDER_MAX_FILTER_KEYS) && (inet_pton(AF_INET6, value, addr) == 1))
+	keys[num_keys++] = PacketRecorder::hashHostKey(addr, 16);
+      else
+	ok = false; /* e.g. host names */
+    } else if(tok && !strcmp(tok, "port")) {
+      char *value = strtok_r(NULL, " \t", &tmp), *endptr;
+      long port = value ? strtol(value, &endptr, 10) : -1;
+
+      if(value && (*endptr == '\0') && (port >= 0) && (port <= 65535) && (num_keys < RECORDER_MAX_FILTER_KEYS))
+	keys[num_keys++] = PacketRecorder::hashPortKey((u_int16_t)port);
+      else
+	ok = false; /* e.g. service names */
+    } else
+      ok = false;
+
+    expect_term = false;
+    tok = strtok_r(NULL, " \t", &tmp);
+  }
+
+  free(filter);
+
+  if(!ok) num_keys = 0;
+
+  ntop->getTrace()->traceEvent(TRACE_INFO, "Filter '%s' %s the recording index",
+			       bpf_filter, num_keys ? "uses" : "does not use");
+
+  return(num_keys > 0);
+}
+
+/* **************************************************** */
+
+bool RecordingReader::open(time_t _from, time_t _to, const char * const bpf_filter) {
+  struct dirent *entry;
+  DIR *d;
+
+  from = _from, to = _to;
+
+  if(bpf_filter && (bpf_filter[0] != '\0')) {
+    if(pcap_compile_nopcap(65535, datalink, &fcode, bpf_filter,
+			   1 /* optimize */, PCAP_NETMASK_UNKNOWN) == -1) {
+      ntop->getTrace()->traceEvent(TRACE_ERROR, "Invalid filter '%s'", bpf_filter);
+      return(false);
+    }
+
+    has_filter = true;
+    parseFilterKeys(bpf_filter);
+  }
+
+  if((d = opendir(dir)) != NULL) {
+    while((entry = readdir(d)) != NULL) {
+      char ext[8];
+      u_int32_t seq;
+
+      if((sscanf(entry->d_name, "%u.%7s", &seq, ext) == 2) && !strcmp(ext, "pcap"))
+	seqs.push_back(seq);
+    }
+
+    closedir(d);
+  }
+
+  std::sort(seqs.begin(), seqs.end());
+  next_segment = 0;
+
+  return(true);
+}
+
+/* **************************************************** */
+
+bool RecordingReader::loadIndex(u_int32_t seq) {
+  char path[MAX_PATH];
+  FILE *f;
+  bool ok = false;
+
+  PacketRecorder::getSegmentPath(dir, seq, "idx", path, sizeof(path));
+
+  if((f = fopen(path, "rb")) == NULL)
+    return(false);
+
+  if((fread(&hdr, sizeof(hdr), 1, f) == 1)
+     && (hdr.magic == RECORDER_INDEX_MAGIC) && (hdr.version == RECORDER_INDEX_VERSION)
+     && (hdr.block_size == RECORDER_INDEX_BLOCK_SIZE) && (hdr.bloom_bytes == RECORDER_INDEX_BLOOM_BYTES)
+     && (hdr.segment_bytes <= map_len)) {
+    if(hdr.num_blocks
+       && (((blocks = (recorder_block_t*)malloc(hdr.num_blocks * sizeof(recorder_block_t))) == NULL)
+	   || (fread(blocks, sizeof(recorder_block_t), hdr.num_blocks, f) != hdr.num_blocks))) {
+      if(blocks) free(blocks);
+      blocks = NULL;
+      goto out;
+    }
+
+    num_blocks = hdr.num_blocks, end = hdr.segment_bytes;
+
+    /*
+      Timestamps are not monotonic across the segment: stop at the first
+      packet after the last block whose min/max seconds overlap the
+      interval. The blocks before it are skipped by skipBlocks()
+    */
+    for(u_int32_t b = num_blocks; b > 0; b--) {
+      recorder_block_t *block = &blocks[b - 1];
+
+      if(block->first_record == RECORDER_NO_RECORD)
+	continue;
+      else if(((time_t)block->max_sec >= from) && ((time_t)block->min_sec <= to))
+	break;
+
+      end = block->first_record;
+    }
+
+    ok = true;
+  }
+
+ out:
+  fclose(f);
+
+  return(ok);
+}
+
+/* **************************************************** */
+
+bool RecordingReader::openSegment(u_int32_t seq) {
+  char path[MAX_PATH];
+  struct stat st;
+  struct pcap_file_header *fh;
+  int fd;
+
+  PacketRecorder::getSegmentPath(dir, seq, "pcap", path, sizeof(path));
+
+  /* The segment may have been deleted to make room in the meantime */
+  if((fd = ::open(path, O_RDONLY)) < 0)
+    return(false);
+
+  if((fstat(fd, &st) != 0) || (st.st_size < (off_t)sizeof(struct pcap_file_header))
+     || ((map = (u_char*)mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0)) == MAP_FAILED)) {
+    map = NULL;
+    close(fd);
+    return(false);
+  }
+
+  close(fd);
+  map_len = st.st_size;
+  fh = (struct pcap_file_header*)map;
+
+  if(fh->magic != PCAP_MAGIC) {
+    closeSegment();
+    return(false);
+  }
+
+  madvise(map, map_len, MADV_SEQUENTIAL);
+  pos = sizeof(struct pcap_file_header), end = map_len;
+
+  if(loadIndex(seq)) {
+    if((hdr.num_packets == 0) || ((time_t)hdr.last_sec < from) || ((time_t)hdr.first_sec > to)) {
+      closeSegment();
+      stats.segments_skipped++;
+      return(false);
+    }
+  } else
+    memset(&hdr, 0, sizeof(hdr)); /* Not indexed: scan it all */
+
+  stats.segments_read++;
+  return(true);
+}
+
+/* **************************************************** */
+
+void RecordingReader::closeSegment() {
+  if(map) {
+    munmap(map, map_len);
+    map = NULL;
+  }
+
+  if(blocks) {
+    free(blocks);
+    blocks = NULL;
+  }
+
+  map_len = 0, pos = end = 0, num_blocks = 0, cur_block = (u_int32_t)-1;
+}
+
+/* **************************************************** */
+
+/* Moves pos to the first block that may contain matching packets */
+bool RecordingReader::skipBlocks() {
+  u_int32_t b = pos / RECORDER_INDEX_BLOCK_SIZE;
+  bool skipped = false;
+
+  while(b < num_blocks) {
+    recorder_block_t *block = &blocks[b];
+    bool candidate = (block->first_record != RECORDER_NO_RECORD)
+      && ((time_t)block->max_sec >= from) && ((time_t)block->min_sec <= to);
+
+    if(candidate && !(block->flags & RECORDER_BLOCK_UNINDEXED)) {
+      for(u_int i = 0; i < num_keys; i++) {
+	if(!PacketRecorder::bloomTest(block->bloom, keys[i])) {
+	  candidate = false;
+	  break;
+	}
+      }
+    }
+
+    if(candidate) {
+      if(skipped && (block->first_record > pos)) pos = block->first_record;
+      return(true);
+    }
+
+    stats.blocks_skipped++, skipped = true, b++;
+  }
+
+  return(!skipped); /* Beyond the index: scan */
+}
+
+/* **************************************************** */
+
+int RecordingReader::next(struct pcap_pkthdr *h, const u_char **packet) {
+  while(true) {
+    struct pcap_disk_pkthdr *pkthdr;
+
+    if(map == NULL) {
+      if(next_segment >= seqs.size())
+	return(0);
+
+      openSegment(seqs[next_segment++]);
+      continue;
+    }
+
+    /* Check the block index when entering a new block */
+    if((num_blocks > 0) && ((pos / RECORDER_INDEX_BLOCK_SIZE) != cur_block)) {
+      if(!skipBlocks())
+	pos = end;
+
+      cur_block = pos / RECORDER_INDEX_BLOCK_SIZE;
+    }
+
+    pkthdr = (struct pcap_disk_pkthdr*)&map[pos];
+
+    /* A record may be truncated at the end of the segment being recorded */
+    if(((pos + sizeof(struct pcap_disk_pkthdr)) > end)
+       || (pkthdr->caplen > pkthdr->len) || (pkthdr->caplen > 262144)
+       || ((pos + sizeof(struct pcap_disk_pkthdr) + pkthdr->caplen) > end)) {
+      closeSegment();
+      continue;
+    }
+
+    h->ts.tv_sec = pkthdr->ts.tv_sec, h->ts.tv_usec = pkthdr->ts.tv_usec;
+    h->caplen = pkthdr->caplen, h->len = pkthdr->len;
+    *packet = &map[pos + sizeof(struct pcap_disk_pkthdr)];
+    pos += sizeof(struct pcap_disk_pkthdr) + pkthdr->caplen;
+    stats.packets_read++;
+
+    if((h->ts.tv_sec < from) || (h->ts.tv_sec > to))
+      continue;
+
+    if(has_filter && !bpf_filter(fcode.bf_insns, *packet, h->len, h->caplen))
+      continue;
+
+    stats.packets_matched++;
+    return(1);
+  }
+}
@@ -594,85 +594,6 @@ int Redis::hashGetAll(const char *key, char ***keys_p, char ***values_p) {
 
 /* **************************************** */
 
-int Redis::pushHostToResolve(char *hostname, bool dont_check_for_existence, bool localHost) {
-  if(!ntop->getPrefs()->is_dns_resolution_enabled()) return(0);
-  if(hostname == NULL) return(-1);
-
-  if(!Utils::shouldResolveHost(hostname))
-    return(-1);
-
-  return(pushHost(DNS_CACHE, DNS_TO_RESOLVE, hostname, dont_check_for_existence, localHost));
-}
-
-/* **************************************** */
-
-int Redis::pushHost(const char* ns_cache, const char* ns_list, char *hostname,
-		    bool dont_check_for_existence, bool localHost) {
-  int rc = 0;
-  char key[CONST_MAX_LEN_REDIS_KEY];
-  bool found;
-  redisReply *reply;
-
-  if(hostname == NULL) return(-1);
-
-  snprintf(key, sizeof(key), "%s.%s", ns_cache, hostname);
-
-  l->lock(__FILE__, __LINE__);
-
-  if(dont_check_for_existence)
-    found = false;
-  else {
-    /*
-      Add only if the address has not been resolved yet
-    */
-
-    num_requests++;
-    reply = (redisReply*)redisCommand(redis, "GET %s", key);
-    if(!reply) reconnectRedis();
-
-    if(reply && (reply->type == REDIS_REPLY_ERROR))
-      ntop->getTrace()->traceEvent(TRACE_ERROR, "%s", reply->str ? reply->str : "???");
-
-    if(reply && reply->str)
-      found = true;
-    else
-      found = false;
-
-    if(reply)
-      freeReplyObject(reply);
-    else
-      rc = -1;
-  }
-
-  l->unlock(__FILE__, __LINE__);
-
-  if(!found) {
-    /* Add to the list of addresses to resolve */
-
-    if(localHost)
-      rc = rpush(ns_list, hostname, MAX_NUM_QUEUED_ADDRS);
-    else
-      rc = lpush(ns_list, hostname, MAX_NUM_QUEUED_ADDRS);
-  } else
-    reply = 0;
-
-  return(rc);
-}
-
-/* **************************************** */
-
-int Redis::popHostToResolve(char *hostname, u_int hostname_len) {
-  return(popHost(DNS_TO_RESOLVE, hostname, hostname_len));
-}
-
-/* **************************************** */
-
-int Redis::popHost(const char* ns_list, char *hostname, u_int hostname_len) {
-  return(lpop(ns_list, hostname, hostname_len));
-}
-
-/* **************************************** */
-
 void Redis::setDefaults() {
   char *admin_md5 = (char*)"21232f297a57a5a743894a0e4a801fc3";
   char *value;
@@ -680,10 +601,6 @@ void Redis::setDefaults() {
   if((value = (char*)malloc(CONST_MAX_LEN_REDIS_VALUE)) == NULL)
     return;
   
-  setResolvedAddress((char*)"127.0.0.1", (char*)"localhost");
-  setResolvedAddress((char*)"::1", (char*)"localhostV6");
-  setResolvedAddress((char*)"255.255.255.255", (char*)"Broadcast");
-  setResolvedAddress((char*)"0.0.0.0", (char*)"NoIP");
 
   if(get((char*)"ntopng.user.admin.password", value,
 	 CONST_MAX_LEN_REDIS_VALUE) < 0) {
@@ -731,26 +648,13 @@ int Redis::flushDb() {
 
 /* **************************************** */
 
-int Redis::getAddress(char *numeric_ip, char *rsp,
-		      u_int rsp_len, bool queue_if_not_found) {
+int Redis::getAddress(char *numeric_ip, char *rsp, u_int rsp_len) {
   char key[CONST_MAX_LEN_REDIS_KEY];
-  int rc;
 
   rsp[0] = '\0';
   snprintf(key, sizeof(key), "%s.%s", DNS_CACHE, numeric_ip);
 
-  rc = get(key, rsp, rsp_len);
-
-  if(rc != 0) {
-    if(queue_if_not_found)
-      pushHostToResolve(numeric_ip, true, false);
-  } else {
-    /* We need to extend expire */
-
-    expire(numeric_ip, DNS_CACHE_DURATION /* expire */);
-  }
-
-  return(rc);
+  return(get(key, rsp, rsp_len));
 }
 
 /* **************************************** */
@@ -779,6 +683,16 @@ int Redis::setResolvedAddress(char *numeric_ip, char *symbolic_ip) {
 
 /* **************************************** */
 
+int Redis::delResolvedAddress(const char *numeric_ip) {
+  char key[CONST_MAX_LEN_REDIS_KEY];
+
+  snprintf(key, sizeof(key), "%s.%s", DNS_CACHE, numeric_ip);
+
+  return(del(key));
+}
+
+/* **************************************** */
+
 char* Redis::getRedisVersion() {
   redisReply *reply;
   char str[32];
@@ -924,6 +838,54 @@ int Redis::rpush(const char * const queue_name, const char * const msg, u_int qu
 
 /* ******************************************* */
 
+/*
+  Pushes several messages with a single round trip: the RPUSH commands
+  and the final LTRIM are pipelined. Returns the number of messages pushed,
+  or -1 on error.
+*/
+int Redis::rpush(const char * const queue_name, const char * const * const msgs,
+		 u_int num_msgs, u_int queue_trim_size) {
+  redisReply *reply;
+  u_int num_cmds = 0;
+  int rc = 0;
+
+  if(num_msgs == 0) return(0);
+
+  l->lock(__FILE__, __LINE__);
+
+  for(u_int i = 0; i < num_msgs; i++) {
+    if(msgs[i] && (redisAppendCommand(redis, "RPUSH %s %s", queue_name, msgs[i]) == REDIS_OK))
+      num_cmds++;
+  }
+
+  if((queue_trim_size > 0)
+     && (redisAppendCommand(redis, "LTRIM %s -%u -1", queue_name, queue_trim_size) == REDIS_OK))
+    num_cmds++;
+
+  num_requests += num_cmds;
+
+  for(u_int i = 0; i < num_cmds; i++) {
+    if((redisGetReply(redis, (void**)&reply) != REDIS_OK) || !reply) {
+      reconnectRedis();
+      rc = -1;
+      break;
+    }
+
+    if(reply->type == REDIS_REPLY_ERROR) {
+      ntop->getTrace()->traceEvent(TRACE_ERROR, "%s", reply->str ? reply->str : "???");
+      rc = -1;
+    } else if((reply->type == REDIS_REPLY_INTEGER) && (rc >= 0))
+      rc++; /* RPUSH reply (LTRIM replies with a status) */
+
+    freeReplyObject(reply);
+  }
+
+  l->unlock(__FILE__, __LINE__);
+  return(rc);
+}
+
+/* ******************************************* */
+
 int Redis::msg_push(const char * const cmd, const char * const queue_name, const char * const msg,
           u_int queue_trim_size, bool trace_errors, bool head_trim) {
   redisReply *reply;
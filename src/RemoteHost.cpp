@@ -51,7 +51,7 @@ void RemoteHost::initialize() {
   char rsp[256];
 
   if(ntop->getPrefs()->is_dns_resolution_enabled_for_all_hosts()) {
-    if(ntop->getRedis()->getAddress(host, rsp, sizeof(rsp), true) == 0)
+    if(ntop->getAddressResolution()->getAddress(host, rsp, sizeof(rsp), true) == 0)
       setName(rsp);
   }
 
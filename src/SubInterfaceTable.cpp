@@ -0,0 +1,127 @@
+/*
+ *
+ * (C) 2019 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+
+
+#include "ntop_includes.h"
+
+/* **************************************************** */
+
+SubInterfaceTable::SubInterfaceTable(bool _direct_indexed) {
+  direct_indexed = _direct_indexed, num_entries = 0;
+
+  if(direct_indexed)
+    num_slots = MAX_NUM_VLAN;
+  else {
+    /* Smallest power of two keeping the load factor below 1/4 */
+    for(num_slots = 1; num_slots < 4 * MAX_NUM_VIRTUAL_INTERFACES; num_slots <<= 1)
+      ;
+  }
+
+  slots_mask = num_slots - 1;
+
+  if((slots = (SubInterfaceEntry**)calloc(num_slots, sizeof(SubInterfaceEntry*))) == NULL)
+    throw("Not enough memory");
+
+  memset(entries, 0, sizeof(entries));
+}
+
+/* **************************************************** */
+
+SubInterfaceTable::~SubInterfaceTable() {
+  stopWorkers();
+
+  for(u_int16_t i = 0; i < num_entries; i++) {
+    /* Interfaces are deleted by the main termination function */
+    if(entries[i].worker) delete entries[i].worker;
+  }
+
+  free((void*)slots);
+}
+
+/* **************************************************** */
+
+SubInterfaceEntry* SubInterfaceTable::add(u_int32_t criteria, NetworkInterface *iface, bool with_worker) {
+  SubInterfaceEntry *e;
+  u_int32_t i;
+
+  if(!canIndex(criteria))
+    return(NULL);
+
+  m.lock(__FILE__, __LINE__);
+
+  if((e = get(criteria)) != NULL) {
+    m.unlock(__FILE__, __LINE__);
+    return(e);
+  }
+
+  if(isFull()) {
+    m.unlock(__FILE__, __LINE__);
+    return(NULL);
+  }
+
+  e = &entries[num_entries];
+  e->criteria = criteria, e->iface = iface, e->worker = NULL;
+
+  if(with_worker) {
+    try {
+      e->worker = new SubInterfaceWorker(iface);
+    } catch(...) {
+      e->worker = NULL;
+    }
+
+    if(e->worker && !e->worker->start()) {
+      delete e->worker;
+      e->worker = NULL;
+    }
+
+    if(e->worker == NULL)
+      ntop->getTrace()->traceEvent(TRACE_WARNING,
+				   "Interface %s will be processed by its parent thread",
+				   iface->get_name());
+  }
+
+  if(direct_indexed)
+    i = criteria;
+  else {
+    for(i = slot(criteria); slots[i] != NULL; i = (i + 1) & slots_mask)
+      ;
+  }
+
+  /* Lookups must never see a partially initialized entry */
+  gcc_mb();
+  slots[i] = e;
+  num_entries++;
+  gcc_mb();
+
+  m.unlock(__FILE__, __LINE__);
+
+  return(e);
+}
+
+/* **************************************************** */
+
+void SubInterfaceTable::stopWorkers() {
+  for(u_int16_t i = 0; i < num_entries; i++) {
+    if(entries[i].worker)
+      entries[i].worker->stop();
+  }
+}
@@ -0,0 +1,249 @@
+/*
+ *
+ * (C) 2019 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+
+
+#include "ntop_includes.h"
+
+/* **************************************************** */
+
+static void* subInterfaceWorkerLoop(void *ptr) {
+  ((SubInterfaceWorker*)ptr)->run();
+  return(NULL);
+}
+
+/* **************************************************** */
+
+SubInterfaceWorker::SubInterfaceWorker(NetworkInterface *_iface) {
+  iface = _iface, running = false, thread_started = false;
+  queue = new SPSCQueue();
+}
+
+/* **************************************************** */
+
+SubInterfaceWorker::~SubInterfaceWorker() {
+  stop();
+  delete queue;
+}
+
+/* **************************************************** */
+
+bool SubInterfaceWorker::start() {
+  running = true;
+
+  if(pthread_create(&thread, NULL, subInterfaceWorkerLoop, (void*)this) != 0) {
+    ntop->getTrace()->traceEvent(TRACE_WARNING, "Unable to start the worker of interface %s",
+				 iface->get_name());
+    running = false;
+    return(false);
+  }
+
+  thread_started = true;
+  ntop->getTrace()->traceEvent(TRACE_NORMAL, "Started worker for dynamic interface %s",
+			       iface->get_name());
+  return(true);
+}
+
+/* **************************************************** */
+
+void SubInterfaceWorker::stop() {
+  SubInterfaceJob *job;
+
+  running = false;
+
+  if(thread_started) {
+    pthread_join(thread, NULL);
+    thread_started = false;
+  }
+
+  /* Jobs still queued are discarded */
+  while(queue->dequeue((void**)&job))
+    freeJob(job);
+}
+
+/* **************************************************** */
+
+void SubInterfaceWorker::run() {
+  SubInterfaceJob *job;
+  time_t last_idle_purge = 0;
+
+  while(running) {
+    if(queue->dequeue((void**)&job)) {
+      processJob(job);
+      freeJob(job);
+    } else {
+      time_t now = time(NULL);
+
+      /* Nothing to do: keep purging as capture interfaces do when idle */
+      if(now != last_idle_purge) {
+	iface->purgeIdle(now);
+	last_idle_purge = now;
+      }
+
+      _usleep(SUBINTERFACE_WORKER_IDLE_USEC);
+    }
+  }
+}
+
+/* **************************************************** */
+
+void SubInterfaceWorker::processJob(SubInterfaceJob *job) {
+  try {
+    if(job->type == subiface_job_flow) {
+      iface->processFlow(job->flow);
+      iface->purgeIdle(time(NULL));
+    } else {
+      u_int16_t ndpiProtocol = NDPI_PROTOCOL_UNKNOWN;
+      Host *srcHost = NULL, *dstHost = NULL;
+      Flow *flow = NULL;
+      u_char *ip = &job->data[job->ip_offset];
+
+      iface->processPacket(job->bridge_iface_idx, job->ingressPacket,
+			   &job->h.ts, job->packet_time,
+			   &job->eth, job->vlan_id,
+			   job->ipv4 ? (struct ndpi_iphdr*)ip : NULL,
+			   job->ipv4 ? NULL : (struct ndpi_ipv6hdr*)ip,
+			   job->ipsize, job->rawsize,
+			   &job->h, job->data, &ndpiProtocol,
+			   &srcHost, &dstHost, &flow);
+      iface->purgeIdle(job->h.ts.tv_sec);
+    }
+  } catch(std::bad_alloc& ba) {
+    static bool oom_warning_sent = false;
+
+    if(!oom_warning_sent) {
+      ntop->getTrace()->traceEvent(TRACE_WARNING, "Not enough memory");
+      oom_warning_sent = true;
+    }
+  }
+}
+
+/* **************************************************** */
+
+void SubInterfaceWorker::freeJob(SubInterfaceJob *job) {
+  ZMQ_Flow *f = job->flow;
+
+  if(f) {
+    if(f->dns_query)       free(f->dns_query);
+    if(f->http_url)        free(f->http_url);
+    if(f->http_site)       free(f->http_site);
+    if(f->ssl_server_name) free(f->ssl_server_name);
+    if(f->bittorrent_hash) free(f->bittorrent_hash);
+    if(f->src_process.process_name)        free(f->src_process.process_name);
+    if(f->src_process.father_process_name) free(f->src_process.father_process_name);
+    if(f->dst_process.process_name)        free(f->dst_process.process_name);
+    if(f->dst_process.father_process_name) free(f->dst_process.father_process_name);
+    if(f->additional_fields_json) free(f->additional_fields_json);
+
+    delete f;
+  }
+
+  free(job);
+}
+
+/* **************************************************** */
+
+bool SubInterfaceWorker::enqueue(SubInterfaceJob *job) {
+  if(running && queue->enqueue((void*)job, true))
+    return(true);
+
+  /* Queue full: the worker can't keep up with the parent */
+  freeJob(job);
+  iface->incNumDispatchDrops();
+
+  return(false);
+}
+
+/* **************************************************** */
+
+bool SubInterfaceWorker::enqueueFlow(ZMQ_Flow *zflow, const char *additional_fields_json) {
+  SubInterfaceJob *job;
+  ZMQ_Flow *f;
+
+  if((job = (SubInterfaceJob*)calloc(1, sizeof(SubInterfaceJob))) == NULL) {
+    iface->incNumDispatchDrops();
+    return(false);
+  }
+
+  if((f = new(std::nothrow) ZMQ_Flow) == NULL) {
+    free(job);
+    iface->incNumDispatchDrops();
+    return(false);
+  }
+
+  /* The caller frees the flow strings once processFlow returns: duplicate them */
+  *f = *zflow;
+  f->dns_query       = zflow->dns_query       ? strdup(zflow->dns_query)       : NULL;
+  f->http_url        = zflow->http_url        ? strdup(zflow->http_url)        : NULL;
+  f->http_site       = zflow->http_site       ? strdup(zflow->http_site)       : NULL;
+  f->ssl_server_name = zflow->ssl_server_name ? strdup(zflow->ssl_server_name) : NULL;
+  f->bittorrent_hash = zflow->bittorrent_hash ? strdup(zflow->bittorrent_hash) : NULL;
+  f->src_process.process_name = zflow->src_process.process_name ? strdup(zflow->src_process.process_name) : NULL;
+  f->src_process.father_process_name = zflow->src_process.father_process_name ? strdup(zflow->src_process.father_process_name) : NULL;
+  f->dst_process.process_name = zflow->dst_process.process_name ? strdup(zflow->dst_process.process_name) : NULL;
+  f->dst_process.father_process_name = zflow->dst_process.father_process_name ? strdup(zflow->dst_process.father_process_name) : NULL;
+  /* json-c objects are not thread safe (e.g. reference counts): only pass their serialization */
+  f->additional_fields = NULL;
+  f->additional_fields_json = additional_fields_json ? strdup(additional_fields_json) : NULL;
+
+  job->type = subiface_job_flow, job->flow = f;
+
+  return(enqueue(job));
+}
+
+/* **************************************************** */
+
+bool SubInterfaceWorker::enqueuePacket(u_int32_t bridge_iface_idx, bool ingressPacket,
+				       const u_int64_t packet_time, struct ndpi_ethhdr *eth,
+				       u_int16_t vlan_id, struct ndpi_iphdr *iph,
+				       struct ndpi_ipv6hdr *ip6, u_int16_t ipsize,
+				       u_int32_t rawsize, const struct pcap_pkthdr *h,
+				       const u_char *packet) {
+  SubInterfaceJob *job;
+  const u_char *ip = iph ? (const u_char*)iph : (const u_char*)ip6;
+  /* The IP header may live in a buffer other than the packet (e.g. decapsulated traffic) */
+  bool ip_in_packet = (ip >= packet) && ((ip + ipsize) <= (packet + h->caplen));
+  u_int32_t len = h->caplen + (ip_in_packet ? 0 : ipsize);
+
+  if((job = (SubInterfaceJob*)malloc(sizeof(SubInterfaceJob) + len)) == NULL) {
+    iface->incNumDispatchDrops();
+    return(false);
+  }
+
+  job->type = subiface_job_packet, job->flow = NULL;
+  job->bridge_iface_idx = bridge_iface_idx, job->ingressPacket = ingressPacket;
+  job->packet_time = packet_time, job->vlan_id = vlan_id;
+  job->ipv4 = (iph != NULL), job->ipsize = ipsize, job->rawsize = rawsize;
+  memcpy(&job->eth, eth, sizeof(job->eth));
+  memcpy(&job->h, h, sizeof(job->h));
+
+  job->data = (u_char*)&job[1];
+  memcpy(job->data, packet, h->caplen);
+
+  if(ip_in_packet)
+    job->ip_offset = (u_int32_t)(ip - packet);
+  else {
+    job->ip_offset = h->caplen;
+    memcpy(&job->data[h->caplen], ip, ipsize);
+  }
+
+  return(enqueue(job));
+}
@@ -26,8 +26,15 @@
 TimelineExtract::TimelineExtract() {
   extraction.id = 0;
   status_code = 0;
+  memset(&stats, 0, sizeof(stats));
   running = false;
   shutdown = false;
+  extraction.bpf_filter = NULL;
+  extraction.timeline_path = NULL;
+#ifdef HAVE_PF_RING
+  source.handle = NULL;
+#endif
+  source.reader = NULL;
 }
 
 /* ********************************************* */
@@ -117,25 +124,151 @@ pfring *TimelineExtract::openTimelineFromInterface(NetworkInterface *iface, time
 
 /* ********************************************* */
 
+bool TimelineExtract::getRecordingDir(NetworkInterface *iface, char *dir, u_int dir_len) {
+  PacketRecorder *recorder = iface->getPacketRecorder();
+  char buf[8];
+
+  if(recorder) {
+    snprintf(dir, dir_len, "%s", recorder->getDir());
+    return(true);
+  }
+
+  /*
+    Recorded in a previous run: only while the native recording is still
+    enabled, otherwise the segments left on disk are stale and n2disk is used
+  */
+  buf[0] = '\0';
+  if(ntop->getRedis()->get((char*)CONST_RUNTIME_PREFS_NATIVE_RECORDING, buf, sizeof(buf))
+     || (buf[0] != '1'))
+    return(false);
+
+  snprintf(dir, dir_len, "%s/%d/recording", ntop->getPrefs()->get_pcap_dir(), iface->get_id());
+  ntop->fixPath(dir);
+
+  return(Utils::dir_exists(dir));
+}
+
+/* ********************************************* */
+
+RecordingReader *TimelineExtract::openRecording(const char * const dir, int datalink,
+						time_t from, time_t to, const char * const bpf_filter) {
+  RecordingReader *reader;
+
+  if((reader = new(std::nothrow) RecordingReader(dir, datalink)) == NULL) {
+    ntop->getTrace()->traceEvent(TRACE_ERROR, "Unable to allocate memory");
+    status_code = 3; /* Memory allocation failure */
+    return(NULL);
+  }
+
+  if(!reader->open(from, to, bpf_filter)) {
+    status_code = 5; /* Unable to set filter */
+    delete reader;
+    return(NULL);
+  }
+
+  ntop->getTrace()->traceEvent(TRACE_INFO, "Running extraction from '%s' matching filter '%s'",
+			       dir, bpf_filter ? bpf_filter : "");
+
+  return(reader);
+}
+
+/* ********************************************* */
+
+bool TimelineExtract::openSource(NetworkInterface *iface, time_t from, time_t to,
+				 const char * const bpf_filter, const char * const timeline_path) {
+#ifdef HAVE_PF_RING
+  source.handle = NULL;
+#endif
+  source.reader = NULL;
+
+  if(!timeline_path || timeline_path[0] == '\0') {
+    char dir[MAX_PATH];
+
+    /* The native recording, when available, takes precedence over n2disk */
+    if(getRecordingDir(iface, dir, sizeof(dir))) {
+      source.reader = openRecording(dir, iface->get_datalink(), from, to, bpf_filter);
+      return(source.reader != NULL);
+    }
+
+#ifdef HAVE_PF_RING
+    source.handle = openTimelineFromInterface(iface, from, to, bpf_filter);
+#endif
+  } else {
+#ifdef HAVE_PF_RING
+    source.handle = openTimeline(timeline_path, from, to, bpf_filter);
+#endif
+  }
+
+#ifdef HAVE_PF_RING
+  return(source.handle != NULL);
+#else
+  status_code = 7; /* No PF_RING support */
+  return(false);
+#endif
+}
+
+/* ********************************************* */
+
+int TimelineExtract::nextPacket(struct pcap_pkthdr *h, const u_char **packet) {
+  if(source.reader)
+    return(source.reader->next(h, packet));
+
+#ifdef HAVE_PF_RING
+  if(source.handle) {
+    struct pfring_pkthdr header = { 0 };
+    u_char *p = NULL;
+    int rc = pfring_recv(source.handle, &p, 0, &header, 0);
+
+    if(rc > 0) {
+      h->ts = header.ts, h->caplen = header.caplen, h->len = header.len;
+      *packet = p;
+    }
+
+    return(rc);
+  }
+#endif
+
+  return(0);
+}
+
+/* ********************************************* */
+
+void TimelineExtract::closeSource() {
+  if(source.reader) {
+    ntop->getTrace()->traceEvent(TRACE_INFO, "Read %u segments [%u skipped][%llu blocks skipped][%llu packets read]",
+				 source.reader->getNumSegmentsRead(), source.reader->getNumSegmentsSkipped(),
+				 (unsigned long long)source.reader->getNumBlocksSkipped(),
+				 (unsigned long long)source.reader->getNumPacketsRead());
+    delete source.reader;
+    source.reader = NULL;
+  }
+
+#ifdef HAVE_PF_RING
+  if(source.handle) {
+    pfring_close(source.handle);
+    source.handle = NULL;
+  }
+#endif
+}
+
+/* ********************************************* */
+
 bool TimelineExtract::extractToDisk(u_int32_t id, NetworkInterface *iface,
 				    time_t from, time_t to, const char *bpf_filter, u_int64_t max_bytes,
 				    const char * const timeline_path) {
   bool completed = false;
-#ifdef HAVE_PF_RING
   char out_path[MAX_PATH];
   PacketDumper *dumper;
-  pfring  *handle;
-  u_char *packet = NULL;
-  struct pfring_pkthdr header = { 0 };
-  struct pcap_pkthdr *h;
+  const u_char *packet = NULL;
+  struct pcap_pkthdr h;
  
   shutdown = false;
-  stats.packets = stats.bytes = 0;
+  stats.packets = stats.bytes = stats.written_bytes = stats.write_usec = 0;
   status_code = 1; /* default: unexpected error */
 
   snprintf(out_path, sizeof(out_path), "%s/%u/extr_pcap/%u", ntop->getPrefs()->get_pcap_dir(), iface->get_id(), id);
 
-  dumper = new PacketDumper(iface, out_path);
+  dumper = new(std::nothrow) PacketDumper(iface, out_path);
 
   if (dumper == NULL) {
     ntop->getTrace()->traceEvent(TRACE_ERROR, "Unable to initialize packet dumper");
@@ -143,22 +276,17 @@ bool TimelineExtract::extractToDisk(u_int32_t id, NetworkInterface *iface,
     goto error;
   }
 
-  if(!timeline_path || timeline_path[0] == '\0')
-    handle = openTimelineFromInterface(iface, from, to, bpf_filter);
-  else
-    handle = openTimeline(timeline_path, from, to, bpf_filter);
-
-  if (handle == NULL)
+  if (!openSource(iface, from, to, bpf_filter, timeline_path))
     goto delete_dumper;
 
   ntop->getTrace()->traceEvent(TRACE_INFO, "Dumping traffic to '%s'", out_path);
 
   while (!shutdown && !ntop->getGlobals()->isShutdown() && 
-         pfring_recv(handle, &packet, 0, &header, 0) > 0) {
-    h = (struct pcap_pkthdr *) &header;
-    dumper->dumpPacket(h, packet);
+         nextPacket(&h, &packet) > 0) {
+    dumper->dumpPacket(&h, (u_char *) packet);
     stats.packets++;
-    stats.bytes += sizeof(struct pcap_disk_pkthdr) + h->caplen;
+    stats.bytes += sizeof(struct pcap_disk_pkthdr) + h.caplen;
+    stats.written_bytes = dumper->get_num_written_bytes(), stats.write_usec = dumper->get_write_usec();
     if (max_bytes != 0 && stats.bytes >= max_bytes) 
       break;
   }
@@ -166,16 +294,15 @@ bool TimelineExtract::extractToDisk(u_int32_t id, NetworkInterface *iface,
   status_code = 0; /* Successfully completed */
   completed = true;
 
-  pfring_close(handle);
+  closeSource();
+
+  dumper->closeDump();
+  stats.written_bytes = dumper->get_num_written_bytes(), stats.write_usec = dumper->get_write_usec();
 
  delete_dumper:
   delete dumper;
 
  error:
-#else
-  status_code = 7; /* No PF_RING support */
-#endif
-
   ntop->getTrace()->traceEvent(TRACE_INFO, "Extraction #%u %s",
     id, completed ? "completed" : "failed");
 
@@ -184,16 +311,37 @@ bool TimelineExtract::extractToDisk(u_int32_t id, NetworkInterface *iface,
 
 /* ********************************************* */
 
+/* Packets are sent in chunks of CONST_LIVE_EXTRACTION_CHUNK_SIZE bytes */
+static bool liveExtractionWrite(struct mg_connection *conn, u_char *chunk, u_int32_t *chunk_len,
+				const u_char *data, u_int32_t data_len) {
+  while (data_len > 0) {
+    u_int32_t n = min_val(data_len, CONST_LIVE_EXTRACTION_CHUNK_SIZE - *chunk_len);
+
+    memcpy(&chunk[*chunk_len], data, n);
+    *chunk_len += n, data += n, data_len -= n;
+
+    if (*chunk_len == CONST_LIVE_EXTRACTION_CHUNK_SIZE) {
+      *chunk_len = 0;
+
+      if (!Utils::mg_write_retry(conn, chunk, CONST_LIVE_EXTRACTION_CHUNK_SIZE))
+	return false;
+    }
+  }
+
+  return true;
+}
+
+/* ********************************************* */
+
 bool TimelineExtract::extractLive(struct mg_connection *conn, NetworkInterface *iface, time_t from, time_t to, const char *bpf_filter, const char * const timeline_path) {
   bool completed = false;
-#ifdef HAVE_PF_RING
-  pfring  *handle;
-  u_char *packet = NULL;
-  struct pfring_pkthdr h = { 0 };
+  const u_char *packet = NULL;
+  struct pcap_pkthdr h;
   struct pcap_file_header pcaphdr;
   struct pcap_disk_pkthdr pkthdr;
   bool http_client_disconnected = false;
-  int rc;
+  u_char *chunk;
+  u_int32_t chunk_len = 0;
 
   stats.packets = stats.bytes = 0;
 
@@ -204,39 +352,45 @@ bool TimelineExtract::extractLive(struct mg_connection *conn, NetworkInterface *
   if (!Utils::mg_write_retry(conn, (u_char *) &pcaphdr, sizeof(pcaphdr)))
     http_client_disconnected = true;
 
-  if(!timeline_path || timeline_path[0] == '\0')
-    handle = openTimelineFromInterface(iface, from, to, bpf_filter);
-  else
-    handle = openTimeline(timeline_path, from, to, bpf_filter);
+  if ((chunk = (u_char *) malloc(CONST_LIVE_EXTRACTION_CHUNK_SIZE)) == NULL) {
+    ntop->getTrace()->traceEvent(TRACE_ERROR, "Unable to allocate memory");
+    goto error;
+  }
 
-  if (handle == NULL)
+  if (!openSource(iface, from, to, bpf_filter, timeline_path)) {
+    free(chunk);
     goto error;
+  }
 
   while (!http_client_disconnected && 
          !ntop->getGlobals()->isShutdown() && 
-         (rc = pfring_recv(handle, &packet, 0, &h, 0)) > 0) {
+         nextPacket(&h, &packet) > 0) {
 
     pkthdr.ts.tv_sec = h.ts.tv_sec;
     pkthdr.ts.tv_usec = h.ts.tv_usec,
     pkthdr.caplen = h.caplen;
     pkthdr.len = h.len;
 
-    if (!Utils::mg_write_retry(conn, (u_char *) &pkthdr, sizeof(pkthdr)) ||
-        !Utils::mg_write_retry(conn, (u_char *) packet, h.caplen))
+    if (!liveExtractionWrite(conn, chunk, &chunk_len, (u_char *) &pkthdr, sizeof(pkthdr)) ||
+        !liveExtractionWrite(conn, chunk, &chunk_len, packet, h.caplen))
       http_client_disconnected = true;
 
     stats.packets++;
     stats.bytes += sizeof(struct pcap_disk_pkthdr) + h.caplen;
   }
 
+  if (!http_client_disconnected && (chunk_len > 0)
+      && !Utils::mg_write_retry(conn, chunk, chunk_len))
+    http_client_disconnected = true;
+
   completed = true;
-  pfring_close(handle);
+  closeSource();
+  free(chunk);
 
  error:
   ntop->getTrace()->traceEvent(TRACE_INFO, "Live extraction %s %s", 
 			       completed ? "completed" : "failed",
 			       http_client_disconnected ? "(disconnected)" : "");
-#endif
   
   return completed;
 }
@@ -272,7 +426,8 @@ void TimelineExtract::runExtractionJob(u_int32_t id, NetworkInterface *iface, ti
   extraction.to = to;
   extraction.bpf_filter = strdup(bpf_filter);
   extraction.max_bytes = max_bytes;
-  extraction.timeline_path = timeline_path;
+  /* The caller's string does not outlive the call */
+  extraction.timeline_path = timeline_path ? strdup(timeline_path) : NULL;
 
   pthread_create(&extraction_thread, NULL, extractionThread, (void *) this);
 }
@@ -299,6 +454,8 @@ void TimelineExtract::stop() {
 
 void TimelineExtract::cleanupJob() {
   if (extraction.bpf_filter) free(extraction.bpf_filter);
+  if (extraction.timeline_path) free(extraction.timeline_path);
+  extraction.bpf_filter = extraction.timeline_path = NULL;
 
   running = false;
 }
@@ -314,6 +471,9 @@ void TimelineExtract::getStatus(lua_State* vm) {
     lua_push_uint64_table_entry(vm, "id", extraction.id);
     lua_push_uint64_table_entry(vm, "extracted_pkts", stats.packets);
     lua_push_uint64_table_entry(vm, "extracted_bytes", stats.bytes);
+    lua_push_uint64_table_entry(vm, "written_bytes", stats.written_bytes);
+    lua_push_uint64_table_entry(vm, "write_throughput", /* bytes/sec */
+				stats.write_usec ? (stats.written_bytes * 1000000) / stats.write_usec : 0);
     lua_push_uint64_table_entry(vm, "status", status_code);
 
     lua_pushinteger(vm, extraction.id);
@@ -21,6 +21,35 @@
 
 #include "ntop_includes.h"
 
+/* post()/send() results */
+#define TS_EXPORT_OK        0
+#define TS_EXPORT_REJECTED  1 /* Bad data: retrying won't help */
+#define TS_EXPORT_FAILED   -1
+
+/* ******************************************************* */
+
+static void* tsSenderLoop(void *ptr) {
+  ((TimeseriesExporter*)ptr)->senderLoop();
+  return(NULL);
+}
+
+/* ******************************************************* */
+
+/* Keeps the beginning of the response to report the InfluxDB error */
+static size_t tsResponseWrite(char *buffer, size_t size, size_t nitems, void *userp) {
+  char *dst = (char*)userp;
+  size_t len = strlen(dst), n = size * nitems;
+
+  if(len < 255) {
+    size_t l = min_val(n, 255 - len);
+
+    memcpy(&dst[len], buffer, l);
+    dst[len + l] = '\0';
+  }
+
+  return(n);
+}
+
 /* ******************************************************* */
 
 /*
@@ -38,100 +67,558 @@
   $ chronograf
 */
 TimeseriesExporter::TimeseriesExporter(NetworkInterface *_if) {
-  fd = -1, iface = _if, num_cached_entries = 0, dbCreated = false;
-  cursize = num_exports = 0;
+  iface = _if;
+  memset(&cur, 0, sizeof(cur));
+  num_spilled = next_spill_id = 0, curl = NULL;
+  url[0] = username[0] = password[0] = dbname[0] = '\0';
+  backoff_secs = 0, next_attempt = 0;
+  num_points = num_sent_points = num_raw_bytes = num_sent_bytes = num_dropped_points = 0;
+  num_batches = num_failures = num_rejected_batches = 0;
+  last_num_points = 0, points_rate = 0, last_response_code = 0, last_error[0] = '\0';
+  gettimeofday(&last_rate_update, NULL);
 
-  snprintf(fbase, sizeof(fbase), "%s/%d/ts_export/", ntop->get_working_dir(), iface->get_id());
-  ntop->fixPath(fbase);
+  snprintf(spool_dir, sizeof(spool_dir), "%s/%d/ts_export/", ntop->get_working_dir(), iface->get_id());
+  ntop->fixPath(spool_dir);
 
-  if(!Utils::mkdir_tree(fbase)) {
+  if(!Utils::mkdir_tree(spool_dir)) {
     ntop->getTrace()->traceEvent(TRACE_WARNING,
-				 "Unable to create directory %s", fbase);
+				 "Unable to create directory %s", spool_dir);
     throw 1;
   }
+
+  loadSpilled();
+
+  sender_running = true, sender_started = false;
+
+  if(pthread_create(&sender, NULL, tsSenderLoop, (void*)this) == 0)
+    sender_started = true;
+  else
+    ntop->getTrace()->traceEvent(TRACE_WARNING, "[%s] Unable to start the timeseries export thread",
+				 iface->get_name());
 }
 
 /* ******************************************************* */
 
 TimeseriesExporter::~TimeseriesExporter() {
-  flush();
+  if(sender_started) {
+    /* The sender posts (or spills) the pending batches before leaving */
+    sender_running = false;
+    pthread_join(sender, NULL);
+  }
+
+  while(!queue.empty()) {
+    free(queue.front().data);
+    queue.pop_front();
+  }
+
+  if(cur.data) free(cur.data);
+  if(curl)     curl_easy_cleanup(curl);
 }
 
 /* ******************************************************* */
 
-void TimeseriesExporter::createDump() {
-  flushTime = time(NULL) + CONST_INFLUXDB_FLUSH_TIME;
-  cursize = 0;
+/*
+  Batches left on disk by a previous run: <id>_<until>.lp files, and
+  the <n>_<flush time> files written by the exporter of the previous
+  releases (same line protocol content), which are sent first ordered
+  by time
+*/
+void TimeseriesExporter::loadSpilled() {
+  std::vector<std::pair<std::pair<u_int8_t, unsigned long>, std::string> > files;
+  std::vector<std::pair<std::pair<u_int8_t, unsigned long>, std::string> >::iterator it;
+  struct dirent *entry;
+  DIR *d;
 
-  /* Use the flushTime as the fname */
-  snprintf(fname, sizeof(fname), "%s%u_%lu", fbase, num_exports, flushTime);
+  if((d = opendir(spool_dir)) == NULL)
+    return;
 
-#ifdef WIN32
-  fd = open(fname, O_RDWR | O_CREAT | O_EXCL, _S_IREAD | _S_IWRITE);
-#else
-  fd = open(fname, O_RDWR | O_CREAT | O_EXCL | S_IREAD | S_IWRITE,
-	    CONST_DEFAULT_FILE_MODE);
-#endif
+  while((entry = readdir(d)) != NULL) {
+    u_int32_t id;
+    unsigned long t;
+    int len = 0;
 
-  if(fd == -1)
-    ntop->getTrace()->traceEvent(TRACE_ERROR, "[%s] Unable to dump TS data onto %s: %s",
-				 iface->get_name(), fname, strerror(errno));
-  else
-    ntop->getTrace()->traceEvent(TRACE_INFO, "[%s] Dumping TS data onto %s",
-				 iface->get_name(), fname);
+    if((sscanf(entry->d_name, "%u_%lu%n", &id, &t, &len) != 2) || (len <= 0))
+      continue;
+
+    if(!strcmp(&entry->d_name[len], ".lp"))
+      files.push_back(std::make_pair(std::make_pair(1, (unsigned long)id), std::string(spool_dir) + entry->d_name));
+    else if(entry->d_name[len] == '\0')
+      files.push_back(std::make_pair(std::make_pair(0, t), std::string(spool_dir) + entry->d_name));
+  }
+
+  closedir(d);
+
+  std::sort(files.begin(), files.end());
+
+  for(it = files.begin(); it != files.end(); ++it) {
+    spilled.push_back(it->second);
+    if(it->first.first) next_spill_id = it->first.second + 1;
+  }
+
+  num_spilled = spilled.size();
+
+  if(!spilled.empty())
+    ntop->getTrace()->traceEvent(TRACE_NORMAL, "[%s] %u timeseries batches to be exported",
+				 iface->get_name(), (u_int32_t)spilled.size());
+}
 
-  num_cached_entries = 0;
+/* ******************************************************* */
+
+void TimeseriesExporter::queueBatch() {
+  if(cur.len == 0)
+    return;
 
-  if(!dbCreated) {
-    dbCreated = true;
+  if(queue.size() >= 2 * CONST_INFLUXDB_MAX_QUEUED_BATCHES) {
+    /* The sender is stuck: the buffer is reused */
+    num_dropped_points += cur.num_points;
+    cur.len = cur.num_points = 0;
+    return;
   }
+
+  cur.until = time(NULL);
+  queue.push_back(cur);
+  memset(&cur, 0, sizeof(cur));
 }
 
 /* ******************************************************* */
 
 void TimeseriesExporter::exportData(char *data, bool do_lock) {
+  u_int32_t len = strlen(data);
+
   if(do_lock) m.lock(__FILE__, __LINE__);
-  
-  if(fd == -1)
-    createDump();
 
-  if(fd != -1) {
-    int exp = strlen(data);
-    int l = (int)write(fd, data, exp);
+  if(cur.len + len > CONST_INFLUXDB_MAX_DUMP_SIZE)
+    queueBatch();
 
-    cursize += l;
+  if((len > CONST_INFLUXDB_MAX_DUMP_SIZE)
+     || ((cur.data == NULL) && ((cur.data = (char*)malloc(CONST_INFLUXDB_MAX_DUMP_SIZE)) == NULL)))
+    num_dropped_points++;
+  else {
+    if(cur.len == 0) cur.since = time(NULL);
 
-    num_cached_entries++;
-    if(l == exp)
-      ntop->getTrace()->traceEvent(TRACE_INFO, "[%s] %s", iface->get_name(), data);
-    else
-      ntop->getTrace()->traceEvent(TRACE_ERROR, "[%s] Unable to append '%s' [written: %u][expected: %u]",
-				   iface->get_name(), data, exp, l);
+    memcpy(&cur.data[cur.len], data, len);
+    cur.len += len, cur.num_points++;
+    num_points++, num_raw_bytes += len;
   }
 
   if(do_lock) m.unlock(__FILE__, __LINE__);
-
-  if((time(NULL) > flushTime) || (cursize >= CONST_INFLUXDB_MAX_DUMP_SIZE))
-    flush(); /* Auto-flush data */
 }
 
 /* ******************************************************* */
 
+/* Queues the current batch without waiting for it to be full */
 void TimeseriesExporter::flush() {
   m.lock(__FILE__, __LINE__);
+  queueBatch();
+  m.unlock(__FILE__, __LINE__);
+}
+
+/* ******************************************************* */
+
+/* The InfluxDB settings are read at every post as they can change at runtime */
+bool TimeseriesExporter::readConfig() {
+  char buf[32];
+
+  url[0] = username[0] = password[0] = dbname[0] = '\0';
+
+  ntop->getRedis()->get((char*)"ntopng.prefs.ts_post_data_url", url, sizeof(url));
+  ntop->getRedis()->get((char*)"ntopng.prefs.influx_dbname", dbname, sizeof(dbname));
+
+  buf[0] = '\0';
+  ntop->getRedis()->get((char*)"ntopng.prefs.influx_auth_enabled", buf, sizeof(buf));
+
+  if(!strcmp(buf, "1")) {
+    ntop->getRedis()->get((char*)"ntopng.prefs.influx_username", username, sizeof(username));
+    ntop->getRedis()->get((char*)"ntopng.prefs.influx_password", password, sizeof(password));
+  }
+
+  return((url[0] != '\0') && (dbname[0] != '\0'));
+}
+
+/* ******************************************************* */
+
+/* Returns the data to post, b->data itself when not compressed */
+u_char* TimeseriesExporter::compress(const TimeseriesBatch *b, u_int32_t *out_len, bool *gzipped) {
+#ifdef HAVE_ZLIB
+  z_stream zs;
+  uLong bound;
+  u_char *out;
+
+  memset(&zs, 0, sizeof(zs));
+
+  if(deflateInit2(&zs, Z_BEST_SPEED, Z_DEFLATED, 15 + 16 /* gzip */, 8, Z_DEFAULT_STRATEGY) == Z_OK) {
+    bound = deflateBound(&zs, b->len);
+
+    if((out = (u_char*)malloc(bound)) != NULL) {
+      zs.next_in = (Bytef*)b->data, zs.avail_in = b->len;
+      zs.next_out = out, zs.avail_out = bound;
+
+      if(deflate(&zs, Z_FINISH) == Z_STREAM_END) {
+	*out_len = zs.total_out, *gzipped = true;
+	deflateEnd(&zs);
+	return(out);
+      }
+
+      free(out);
+    }
+
+    deflateEnd(&zs);
+  }
+#endif
+
+  *out_len = b->len, *gzipped = false;
+  return((u_char*)b->data);
+}
+
+/* ******************************************************* */
+
+int TimeseriesExporter::post(const u_char *data, u_int32_t len, bool gzipped) {
+  struct curl_slist *headers = NULL;
+  char write_url[sizeof(url) + 128], auth[sizeof(username) + sizeof(password) + 2];
+  char response[sizeof(last_error)];
+  CURLcode res;
+  int rc;
+
+  if(!readConfig()) {
+    setLastError("InfluxDB URL or database not configured");
+    return(TS_EXPORT_FAILED);
+  }
+
+  /* Reused across posts to keep the connection open */
+  if((curl == NULL) && ((curl = curl_easy_init()) == NULL))
+    return(TS_EXPORT_FAILED);
+
+  curl_easy_reset(curl);
+
+  snprintf(write_url, sizeof(write_url), "%s/write?db=%s", url, dbname);
+  curl_easy_setopt(curl, CURLOPT_URL, write_url);
+
+  if(username[0] || password[0]) {
+    snprintf(auth, sizeof(auth), "%s:%s", username, password);
+    curl_easy_setopt(curl, CURLOPT_USERPWD, auth);
+    curl_easy_setopt(curl, CURLOPT_HTTPAUTH, (long)CURLAUTH_BASIC);
+  }
+
+  if(!strncmp(url, "https", 5)) {
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
+  }
+
+  headers = curl_slist_append(headers, "Content-Type: text/plain; charset=utf-8");
+  if(gzipped) headers = curl_slist_append(headers, "Content-Encoding: gzip");
+
+  curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+  curl_easy_setopt(curl, CURLOPT_POST, 1L);
+  curl_easy_setopt(curl, CURLOPT_POSTFIELDS, data);
+  curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (long)len);
+  curl_easy_setopt(curl, CURLOPT_TIMEOUT, CONST_INFLUXDB_POST_TIMEOUT);
+  curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, CONST_INFLUXDB_POST_TIMEOUT);
+  curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+
+  response[0] = '\0';
+  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, tsResponseWrite);
+  curl_easy_setopt(curl, CURLOPT_WRITEDATA, response);
+
+  if((res = curl_easy_perform(curl)) != CURLE_OK) {
+    snprintf(response, sizeof(response), "%s", curl_easy_strerror(res));
+    last_response_code = 0;
+    rc = TS_EXPORT_FAILED;
+  } else {
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &last_response_code);
+
+    if((last_response_code >= 200) && (last_response_code < 300))
+      rc = TS_EXPORT_OK;
+    else if((last_response_code >= 400) && (last_response_code < 500)
+	    && (last_response_code != 408) && (last_response_code != 429))
+      rc = TS_EXPORT_REJECTED; /* e.g. partial writes, max-values-per-tag */
+    else
+      rc = TS_EXPORT_FAILED;
+  }
+
+  curl_slist_free_all(headers);
+  setLastError(response);
+
+  return(rc);
+}
+
+/* ******************************************************* */
+
+/* last_error is read by lua() from other threads */
+void TimeseriesExporter::setLastError(const char *err) {
+  m.lock(__FILE__, __LINE__);
+  snprintf(last_error, sizeof(last_error), "%s", err);
+  m.unlock(__FILE__, __LINE__);
+}
+
+/* ******************************************************* */
+
+int TimeseriesExporter::send(const TimeseriesBatch *b) {
+  u_int32_t len;
+  bool gzipped;
+  u_char *data = compress(b, &len, &gzipped);
+  int rc = post(data, len, gzipped);
+
+  if(rc == TS_EXPORT_OK) num_sent_bytes += len;
+  if(gzipped) free(data);
+
+  return(rc);
+}
+
+/* ******************************************************* */
+
+void TimeseriesExporter::spill(TimeseriesBatch *b) {
+  char path[PATH_MAX + 32];
+  u_int32_t done = 0;
+  int fd;
+
+  if(spilled.size() >= CONST_INFLUXDB_MAX_SPILLED_BATCHES) {
+    /* Drop the oldest batch to make room */
+    ntop->getTrace()->traceEvent(TRACE_WARNING, "[%s] Too many timeseries batches to export: discarding %s",
+				 iface->get_name(), spilled.front().c_str());
+    unlink(spilled.front().c_str());
+    spilled.pop_front();
+  }
+
+  snprintf(path, sizeof(path), "%s%u_%lu.lp", spool_dir, next_spill_id++, (unsigned long)b->until);
+
+  if((fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, CONST_DEFAULT_FILE_MODE)) >= 0) {
+    while(done < b->len) {
+      ssize_t n = write(fd, &b->data[done], b->len - done);
+
+      if(n <= 0) break;
+      done += n;
+    }
 
-  if(fd != -1) {
     close(fd);
-    fd = -1;
-    char buf[32];
-    snprintf(buf, sizeof(buf), "%d|%lu|%u", iface->get_id(), flushTime, num_exports);
-    cursize = 0;
-    num_exports++;
+  }
+
+  if(done == b->len)
+    spilled.push_back(std::string(path)), num_spilled = spilled.size();
+  else {
+    ntop->getTrace()->traceEvent(TRACE_WARNING, "[%s] Unable to write %s: %u points lost",
+				 iface->get_name(), path, b->num_points);
+    num_dropped_points += b->num_points;
+    unlink(path);
+  }
+}
+
+/* ******************************************************* */
+
+int TimeseriesExporter::sendSpilled() {
+  const char *path = spilled.front().c_str();
+  TimeseriesBatch b;
+  unsigned long until = 0;
+  struct stat st;
+  const char *name;
+  int fd, rc = TS_EXPORT_REJECTED;
+  u_int32_t id;
+
+  memset(&b, 0, sizeof(b));
+
+  if(((fd = open(path, O_RDONLY)) >= 0) && (fstat(fd, &st) == 0)
+     /* Files of the previous releases can exceed the max batch size by a line */
+     && (st.st_size > 0) && (st.st_size <= 2 * CONST_INFLUXDB_MAX_DUMP_SIZE)
+     && ((b.data = (char*)malloc(st.st_size)) != NULL)
+     && (read(fd, b.data, st.st_size) == st.st_size)) {
+    b.len = st.st_size;
+
+    for(u_int32_t i = 0; i < b.len; i++)
+      if(b.data[i] == '\n') b.num_points++;
+
+    name = strrchr(path, '/') ? strrchr(path, '/') + 1 : path;
+    if(sscanf(name, "%u_%lu", &id, &until) == 2) b.until = until;
+
+    rc = send(&b);
+  }
+
+  if(fd >= 0) close(fd);
+
+  if(rc == TS_EXPORT_OK)
+    onSent(b.num_points, b.until);
+  else if(rc == TS_EXPORT_REJECTED)
+    num_rejected_batches++, num_dropped_points += b.num_points;
+
+  /* Unreadable and rejected files are discarded too */
+  if(rc != TS_EXPORT_FAILED) {
+    unlink(path);
+    spilled.pop_front(), num_spilled = spilled.size();
+  }
+
+  if(b.data) free(b.data);
+
+  return(rc);
+}
+
+/* ******************************************************* */
+
+void TimeseriesExporter::onSent(u_int32_t points, time_t until) {
+  char key[CONST_MAX_LEN_REDIS_KEY], buf[32];
+
+  num_batches++, num_sent_points += points, backoff_secs = 0, next_attempt = 0;
+
+  /* Used by the influxdb driver to know up to when data is available */
+  snprintf(key, sizeof(key), CONST_INFLUXDB_EXPORT_TIME, dbname, iface->get_id());
+
+  buf[0] = '\0';
+  if(ntop->getRedis()->get(key, buf, sizeof(buf)) != 0 || ((time_t)strtoul(buf, NULL, 10) < until)) {
+    snprintf(buf, sizeof(buf), "%lu", (unsigned long)until);
+    ntop->getRedis()->set(key, buf);
+  }
+}
 
-    ntop->getRedis()->rpush(CONST_INFLUXDB_FILE_QUEUE, buf, 0);
-    ntop->getTrace()->traceEvent(TRACE_INFO, "[%s] Queueing TS file %s [%u entries]",
-				 iface->get_name(), fname, num_cached_entries);
+/* ******************************************************* */
+
+void TimeseriesExporter::onFailure(int rc) {
+  num_failures++;
+
+  backoff_secs = backoff_secs ? min_val(2 * backoff_secs, CONST_INFLUXDB_MAX_BACKOFF) : 1;
+  next_attempt = time(NULL) + backoff_secs;
+
+  if(backoff_secs == 1)
+    ntop->getTrace()->traceEvent(TRACE_WARNING, "[%s] Unable to export timeseries to %s [%ld][%s]: retrying",
+				 iface->get_name(), url, last_response_code, last_error);
+}
+
+/* ******************************************************* */
+
+void TimeseriesExporter::updateRate() {
+  struct timeval now;
+  float usec;
+
+  gettimeofday(&now, NULL);
+  usec = (now.tv_sec - last_rate_update.tv_sec) * 1000000. + (now.tv_usec - last_rate_update.tv_usec);
+
+  if(usec >= 5000000) {
+    points_rate = ((num_points - last_num_points) * 1000000.) / usec;
+    last_num_points = num_points, last_rate_update = now;
   }
+}
+
+/* ******************************************************* */
+
+void TimeseriesExporter::senderLoop() {
+  while(true) {
+    TimeseriesBatch b;
+    bool found = false;
+    int rc;
+
+    updateRate();
+
+    m.lock(__FILE__, __LINE__);
+
+    if((cur.len > 0) && (!sender_running || ((time(NULL) - cur.since) >= CONST_INFLUXDB_FLUSH_TIME)))
+      queueBatch();
+
+    m.unlock(__FILE__, __LINE__);
+
+    if(next_attempt && (time(NULL) < next_attempt) && sender_running) {
+      /* Backing off: keep the memory bounded */
+      while(true) {
+	m.lock(__FILE__, __LINE__);
+	if((found = (queue.size() > CONST_INFLUXDB_MAX_QUEUED_BATCHES)))
+	  b = queue.front(), queue.pop_front();
+	m.unlock(__FILE__, __LINE__);
+
+	if(!found) break;
+
+	spill(&b);
+	free(b.data);
+      }
+
+      _usleep(100000);
+      continue;
+    }
+
+    /* Spilled batches are older than the queued ones */
+    if(!spilled.empty()) {
+      if((rc = sendSpilled()) == TS_EXPORT_FAILED)
+	onFailure(rc);
+    } else {
+      m.lock(__FILE__, __LINE__);
+      if((found = !queue.empty()))
+	b = queue.front(), queue.pop_front();
+      m.unlock(__FILE__, __LINE__);
 
+      if(!found) {
+	if(!sender_running) break;
+	_usleep(100000);
+	continue;
+      }
+
+      if((rc = send(&b)) == TS_EXPORT_OK)
+	onSent(b.num_points, b.until);
+      else if(rc == TS_EXPORT_REJECTED)
+	num_rejected_batches++, num_dropped_points += b.num_points;
+      else {
+	onFailure(rc);
+
+	m.lock(__FILE__, __LINE__);
+	queue.push_front(b);
+	m.unlock(__FILE__, __LINE__);
+	found = false;
+      }
+
+      if(found) free(b.data);
+    }
+
+    if(!sender_running && next_attempt) {
+      /* Shutting down with InfluxDB unreachable: keep everything on disk */
+      m.lock(__FILE__, __LINE__);
+      queueBatch();
+
+      while(!queue.empty()) {
+	b = queue.front(), queue.pop_front();
+	spill(&b);
+	free(b.data);
+      }
+
+      m.unlock(__FILE__, __LINE__);
+      break;
+    }
+  }
+}
+
+/* ******************************************************* */
+
+u_int32_t TimeseriesExporter::getNumQueuedBatches() {
+  u_int32_t n;
+
+  m.lock(__FILE__, __LINE__);
+  n = queue.size() + num_spilled;
   m.unlock(__FILE__, __LINE__);
+
+  return(n);
+}
+
+/* ******************************************************* */
+
+void TimeseriesExporter::lua(lua_State *vm) {
+  u_int32_t queued_points = 0, num_queued;
+  char error[sizeof(last_error)];
+
+  m.lock(__FILE__, __LINE__);
+  for(std::deque<TimeseriesBatch>::iterator it = queue.begin(); it != queue.end(); ++it)
+    queued_points += it->num_points;
+  queued_points += cur.num_points;
+  num_queued = queue.size();
+  snprintf(error, sizeof(error), "%s", last_error);
+  m.unlock(__FILE__, __LINE__);
+
+  lua_newtable(vm);
+  lua_push_uint64_table_entry(vm, "points", num_points);
+  lua_push_float_table_entry(vm, "points_per_sec", points_rate);
+  lua_push_uint64_table_entry(vm, "batches", num_batches);
+  lua_push_uint64_table_entry(vm, "sent_points", num_sent_points);
+  lua_push_float_table_entry(vm, "avg_batch_points", num_batches ? (float)num_sent_points / num_batches : 0);
+  lua_push_uint64_table_entry(vm, "raw_bytes", num_raw_bytes);
+  lua_push_uint64_table_entry(vm, "sent_bytes", num_sent_bytes);
+  lua_push_float_table_entry(vm, "avg_batch_bytes", num_batches ? (float)num_sent_bytes / num_batches : 0);
+  lua_push_uint64_table_entry(vm, "dropped_points", num_dropped_points);
+  lua_push_uint64_table_entry(vm, "failures", num_failures);
+  lua_push_uint64_table_entry(vm, "rejected_batches", num_rejected_batches);
+  lua_push_uint64_table_entry(vm, "queued_points", queued_points);
+  lua_push_uint64_table_entry(vm, "queued_batches", num_queued);
+  lua_push_uint64_table_entry(vm, "spilled_batches", num_spilled);
+  lua_push_uint64_table_entry(vm, "last_response_code", last_response_code);
+  if(error[0]) lua_push_str_table_entry(vm, "last_error", error);
 }
@@ -2087,7 +2087,7 @@ u_int64_t Utils::macaddr_int(const u_int8_t *mac) {
     u_int64_t mac_int = 0;
 
     for(u_int8_t i=0; i<6; i++){
-      mac_int |= (mac[i] & 0xFF) << (5-i)*8;
+      mac_int |= ((u_int64_t)(mac[i] & 0xFF)) << (5-i)*8;
     }
 
     return mac_int;
@@ -2419,14 +2419,8 @@ void Utils::xor_encdec(u_char *data, int data_len, u_char *key) {
 u_int32_t Utils::macHash(u_int8_t *mac) {
   if(mac == NULL)
     return(0);
-  else {
-    u_int32_t hash = 0;
-
-    for(int i=0; i<6; i++)
-      hash += mac[i] << (i+1);
-
-    return(hash);
-  }
+  else
+    return(KeyedHash::hashBytes(mac, 6));
 }
 
 /* ****************************************************** */
@@ -2636,10 +2630,10 @@ static int remove_from_ptree(patricia_tree_t *tree, int family, void *addr, int
   else
     fill_prefix_v6(&prefix, (struct in6_addr*)addr, bits, tree->maxbits);
 
-  node = patricia_lookup(tree, &prefix);
+  node = patricia_search_exact(tree, &prefix);
 
   if((patricia_node_t *)0 != node)
-    rc = 0, free(node);
+    rc = 0, patricia_remove(tree, node);
   else
     rc = -1;
 
@@ -26,6 +26,12 @@
 ViewInterface::ViewInterface(const char *_endpoint) : NetworkInterface(_endpoint) {
   char *ifaces = strdup(&_endpoint[5]); /* Skip view: */
 
+  memset(&counters, 0, sizeof(counters));
+  counters_last_refresh = 0;
+
+  /* Flows are indexed by the sub-interfaces */
+  if(flow_index) { delete(flow_index); flow_index = NULL; }
+
   if(ifaces) {
     char *tmp, *iface = strtok_r(ifaces, ",", &tmp);
 
@@ -86,134 +92,180 @@ bool ViewInterface::walker(u_int32_t *begin_slot,
 
 /* **************************************************** */
 
-u_int64_t ViewInterface::getNumPackets() {  
-  u_int64_t tot = 0;
+bool ViewInterface::flowsWalker(u_int32_t *begin_slot,
+				bool walk_all,
+				const FlowIndexQuery *q,
+				bool (*walker)(GenericHashEntry *h, void *user_data, bool *matched),
+				void *user_data) {
+  bool ret = false;
 
-  for(u_int8_t s = 0; s<numSubInterfaces; s++)
-    tot += subInterfaces[s]->getNumPackets();
+  for(u_int8_t s = 0; s < numSubInterfaces; s++)
+    ret |= subInterfaces[s]->flowsWalker(begin_slot, walk_all, q, walker, user_data);
 
-  return(tot);
+  return(ret);
+}
+
+/* **************************************************** */
+
+void ViewInterface::refreshCounters(time_t now) {
+  struct view_counters tot;
+
+  memset(&tot, 0, sizeof(tot));
+
+  for(u_int8_t s = 0; s < numSubInterfaces; s++) {
+    NetworkInterface *iface = subInterfaces[s];
+
+    tot.num_packets += iface->getNumPackets();
+    tot.num_bytes += iface->getNumBytes();
+    tot.num_packet_drops += iface->getNumDroppedPackets();
+    tot.checkpoint_num_packets += iface->getCheckPointNumPackets();
+    tot.checkpoint_num_bytes += iface->getCheckPointNumBytes();
+    tot.checkpoint_num_packet_drops += iface->getCheckPointNumPacketDrops();
+    tot.num_flows += iface->getNumFlows();
+    tot.num_l2_devices += iface->getNumL2Devices();
+    tot.num_hosts += iface->getNumHosts();
+    tot.num_local_hosts += iface->getNumLocalHosts();
+    tot.num_macs += iface->getNumMacs();
+    tot.num_http_hosts += iface->getNumHTTPHosts();
+  }
+
+  /* Counters and checkpoints are taken together so that their differences stay consistent */
+  memcpy(&counters, &tot, sizeof(counters));
+  counters_last_refresh = now;
+}
+
+/* **************************************************** */
+
+/* Returns a copy of the counters, all from the same refresh */
+void ViewInterface::getCounters(struct view_counters *c) {
+  time_t now = time(NULL);
+
+  counters_lock.lock(__FILE__, __LINE__);
+
+  if(now >= counters_last_refresh + VIEW_COUNTERS_REFRESH_SECS)
+    refreshCounters(now);
+
+  memcpy(c, &counters, sizeof(*c));
+
+  counters_lock.unlock(__FILE__, __LINE__);
+}
+
+/* **************************************************** */
+
+void ViewInterface::runHousekeepingTasks() {
+  NetworkInterface::runHousekeepingTasks();
+
+  counters_lock.lock(__FILE__, __LINE__);
+  refreshCounters(time(NULL));
+  counters_lock.unlock(__FILE__, __LINE__);
+}
+
+/* **************************************************** */
+
+u_int64_t ViewInterface::getNumPackets() {
+  struct view_counters c;
+
+  getCounters(&c);
+  return(c.num_packets);
 };
 
 /* **************************************************** */
 
 u_int32_t ViewInterface::getNumPacketDrops() {
-  u_int32_t tot = 0;
-
-  for(u_int8_t s = 0; s<numSubInterfaces; s++)
-    tot += subInterfaces[s]->getNumDroppedPackets();
+  struct view_counters c;
 
-  return(tot);
+  getCounters(&c);
+  return(c.num_packet_drops);
 };
 
 /* **************************************************** */
 
 u_int ViewInterface::getNumFlows() {
-  u_int tot = 0;
-
-  for(u_int8_t s = 0; s < numSubInterfaces; s++)
-    tot += subInterfaces[s]->getNumFlows();
+  struct view_counters c;
 
-  return(tot);
+  getCounters(&c);
+  return(c.num_flows);
 };
 
 /* **************************************************** */
 
 u_int ViewInterface::getNumL2Devices() {
-  u_int tot = 0;
-
-  for(u_int8_t s = 0; s < numSubInterfaces; s++)
-    tot += subInterfaces[s]->getNumL2Devices();
+  struct view_counters c;
 
-  return(tot);
+  getCounters(&c);
+  return(c.num_l2_devices);
 };
 
 /* **************************************************** */
 
 u_int ViewInterface::getNumHosts() {
-  u_int tot = 0;
+  struct view_counters c;
 
-  for(u_int8_t s = 0; s < numSubInterfaces; s++)
-    tot += subInterfaces[s]->getNumHosts();
-
-  return(tot);
+  getCounters(&c);
+  return(c.num_hosts);
 };
 
 /* **************************************************** */
 
 u_int ViewInterface::getNumLocalHosts() {
-  u_int tot = 0;
-
-  for(u_int8_t s = 0; s < numSubInterfaces; s++)
-    tot += subInterfaces[s]->getNumLocalHosts();
+  struct view_counters c;
 
-  return(tot);
+  getCounters(&c);
+  return(c.num_local_hosts);
 };
 
 /* **************************************************** */
 
 u_int ViewInterface::getNumHTTPHosts() {
-  u_int tot = 0;
-
-  for(u_int8_t s = 0; s < numSubInterfaces; s++)
-    tot += subInterfaces[s]->getNumHTTPHosts();
+  struct view_counters c;
 
-  return(tot);
+  getCounters(&c);
+  return(c.num_http_hosts);
 };
 
 /* **************************************************** */
 
 u_int ViewInterface::getNumMacs() {
-  u_int tot = 0;
-
-  for(u_int8_t s = 0; s < numSubInterfaces; s++)
-    tot += subInterfaces[s]->getNumMacs();
+  struct view_counters c;
 
-  return(tot);
+  getCounters(&c);
+  return(c.num_macs);
 };
 
 /* **************************************************** */
 
 u_int64_t ViewInterface::getNumBytes() {
-  u_int64_t tot = 0;
+  struct view_counters c;
 
-  for(u_int8_t s = 0; s<numSubInterfaces; s++)
-    tot += subInterfaces[s]->getNumBytes();
-
-  return(tot);
+  getCounters(&c);
+  return(c.num_bytes);
 }
 
 /* **************************************************** */
 
 u_int64_t ViewInterface::getCheckPointNumPackets() {
-  u_int64_t tot = 0;
-
-  for(u_int8_t s = 0; s < numSubInterfaces; s++)
-    tot += subInterfaces[s]->getCheckPointNumPackets();
+  struct view_counters c;
 
-  return(tot);
+  getCounters(&c);
+  return(c.checkpoint_num_packets);
 };
 
 /* **************************************************** */
 
 u_int64_t ViewInterface::getCheckPointNumBytes() {
-  u_int64_t tot = 0;
-
-  for(u_int8_t s = 0; s < numSubInterfaces; s++)
-    tot += subInterfaces[s]->getCheckPointNumBytes();
+  struct view_counters c;
 
-  return(tot);
+  getCounters(&c);
+  return(c.checkpoint_num_bytes);
 }
 
 /* **************************************************** */
 
 u_int32_t ViewInterface::getCheckPointNumPacketDrops() {
-  u_int32_t tot = 0;
-
-  for(u_int8_t s = 0; s < numSubInterfaces; s++)
-    tot += subInterfaces[s]->getCheckPointNumPacketDrops();
+  struct view_counters c;
 
-  return(tot);
+  getCounters(&c);
+  return(c.checkpoint_num_packet_drops);
 };
 
 /* **************************************************** */
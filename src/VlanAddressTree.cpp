@@ -58,6 +58,15 @@ bool VlanAddressTree::addAddresses(u_int16_t vlan_id, char *net, const int16_t u
 
 /* **************************************** */
 
+/* To be called once populated, before the tree is made visible to the readers */
+void VlanAddressTree::compile() {
+  for(int i = 0; i < MAX_NUM_VLAN; i++)
+    if(tree[i])
+      tree[i]->compile();
+}
+
+/* **************************************** */
+
 int16_t VlanAddressTree::findAddress(u_int16_t vlan_id, int family, void *addr, u_int8_t *network_mask_bits) {
   if(! tree[vlan_id]) return -1;
   return tree[vlan_id]->findAddress(family, addr, network_mask_bits);
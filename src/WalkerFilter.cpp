@@ -0,0 +1,466 @@
+/*
+ *
+ * (C) 2019 - ntop.org
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+
+#include "ntop_includes.h"
+
+/* ******************************************* */
+
+/* Packs a country code (at most 3 chars) so that it can be compared as a number */
+static inline u_int32_t pack_code(const char *s) {
+  u_int32_t v = 0;
+
+  if(s) {
+    for(int i = 0; (i < 4) && s[i]; i++) {
+      if(i == 3) return((u_int32_t)-1); /* Too long: not a code */
+      v |= ((u_int32_t)(u_int8_t)s[i]) << (8 * i);
+    }
+  }
+
+  return(v);
+}
+
+/* ******************************************* */
+
+walker_filter_insn_t* WalkerFilter::addInsn(WalkerFilterOp op) {
+  walker_filter_insn_t *insn;
+
+  if(num_insns >= MAX_WALKER_FILTER_INSNS)
+    return(NULL); /* Not reached: there are fewer ops than instructions */
+
+  insn = &insns[num_insns++];
+  memset(insn, 0, sizeof(*insn));
+  insn->op = op;
+
+  return(insn);
+}
+
+/* ******************************************* */
+
+/*
+  Filters are emitted in the WalkerFilterOp order: equality filters on
+  flow fields first as they discard most flows with a single compare,
+  then the ones that dereference the peers and finally those that need
+  to compute something (e.g. the flow status).
+*/
+void WalkerFilter::compileFlowFilter(Paginator *p, Host *host) {
+  walker_filter_insn_t *insn;
+  int ndpi_proto, ndpi_cat;
+  u_int16_t port, vlan_id, pool, in_index, out_index;
+  int16_t local_network_id;
+  u_int8_t ip_version, *mac;
+  LocationPolicy policy;
+  bool b;
+  u_int32_t u32;
+
+  num_insns = 0;
+
+  if(host && (insn = addInsn(flow_filter_host)))
+    insn->v.host = host;
+
+  if(!p)
+    return;
+
+  if(p->vlanIdFilter(&vlan_id) && (insn = addInsn(flow_filter_vlan)))
+    insn->v.u32 = vlan_id;
+
+  if(p->portFilter(&port) && (insn = addInsn(flow_filter_port)))
+    insn->v.u32 = port;
+
+  if(p->l7protoFilter(&ndpi_proto) && (insn = addInsn(flow_filter_l7proto)))
+    insn->v.i32 = ndpi_proto;
+
+  if(p->l7categoryFilter(&ndpi_cat) && (insn = addInsn(flow_filter_l7category)))
+    insn->v.i32 = ndpi_cat;
+
+  if(p->ipVersion(&ip_version) && (insn = addInsn(flow_filter_ip_version)))
+    insn->v.u32 = ip_version;
+
+  if(p->deviceIpFilter(&u32) && (insn = addInsn(flow_filter_device))) {
+    insn->v.u32 = u32;
+
+    if(p->inIndexFilter(&in_index))
+      insn->aux[0] = in_index, insn->flags |= WALKER_FILTER_AUX0_SET;
+
+    if(p->outIndexFilter(&out_index))
+      insn->aux[1] = out_index, insn->flags |= WALKER_FILTER_AUX1_SET;
+  }
+
+  if(p->asnFilter(&u32) && (insn = addInsn(flow_filter_asn)))
+    insn->v.u32 = u32;
+
+  if(p->localNetworkFilter(&local_network_id) && (insn = addInsn(flow_filter_local_network)))
+    insn->v.i32 = local_network_id;
+
+  if(p->poolFilter(&pool) && (insn = addInsn(flow_filter_pool)))
+    insn->v.u32 = pool;
+
+  if(p->macFilter(&mac) && (insn = addInsn(flow_filter_mac)))
+    memcpy(insn->v.mac, mac, 6);
+
+  if(p->clientMode(&policy) && (insn = addInsn(flow_filter_client_mode)))
+    insn->v.u32 = policy;
+
+  if(p->serverMode(&policy) && (insn = addInsn(flow_filter_server_mode)))
+    insn->v.u32 = policy;
+
+  if(p->unidirectionalTraffic(&b) && (insn = addInsn(flow_filter_unidirectional)))
+    insn->v.b = b;
+
+  if(p->unicastTraffic(&b) && (insn = addInsn(flow_filter_unicast)))
+    insn->v.b = b;
+
+  if(p->uidFilter(&u32) && (insn = addInsn(flow_filter_uid)))
+    insn->v.u32 = u32;
+
+  if(p->pidFilter(&u32) && (insn = addInsn(flow_filter_pid)))
+    insn->v.u32 = u32;
+
+#ifdef HAVE_NEDGE
+  if(p->filteredFlows(&b) && (insn = addInsn(flow_filter_filtered)))
+    insn->v.b = b;
+#endif
+
+  if(p->alertedFlows(&b) && (insn = addInsn(flow_filter_alerted)))
+    insn->v.b = b;
+}
+
+/* ******************************************* */
+
+/* Parameters follow the NetworkInterface::sortHosts() conventions for "no filter" */
+void WalkerFilter::compileHostFilter(LocationPolicy location, u_int16_t vlan_id,
+				     int ndpi_proto, u_int32_t asn, int16_t network,
+				     const u_int8_t *mac, u_int16_t pool,
+				     const char *country, const char *os,
+				     bool blacklisted, bool anomalous, bool hide_top_hidden,
+				     TrafficType traffic_type, bool filtered, u_int8_t ip_version) {
+  walker_filter_insn_t *insn;
+
+  num_insns = 0;
+
+  if((vlan_id != ((u_int16_t)-1)) && (insn = addInsn(host_filter_vlan)))
+    insn->v.u32 = vlan_id;
+
+  if(((location == location_local_only) || (location == location_remote_only))
+     && (insn = addInsn(host_filter_location)))
+    insn->v.u32 = location;
+
+  if((asn != (u_int32_t)-1) && (insn = addInsn(host_filter_asn)))
+    insn->v.u32 = asn;
+
+  if((network != -2) && (insn = addInsn(host_filter_local_network)))
+    insn->v.i32 = network;
+
+  if((pool != (u_int16_t)-1) && (insn = addInsn(host_filter_pool)))
+    insn->v.u32 = pool;
+
+  if(((ip_version == 4) || (ip_version == 6)) && (insn = addInsn(host_filter_ip_version)))
+    insn->v.u32 = ip_version;
+
+  if(mac && (insn = addInsn(host_filter_mac)))
+    memcpy(insn->v.mac, mac, 6);
+
+  if(country && country[0]) {
+    u_int32_t code = pack_code(country);
+
+    if((insn = addInsn((code == (u_int32_t)-1) ? walker_filter_never : host_filter_country)))
+      insn->v.u32 = code;
+  }
+
+  if(blacklisted)     addInsn(host_filter_blacklisted);
+  if(hide_top_hidden) addInsn(host_filter_hidden_from_top);
+
+  if(((traffic_type == traffic_type_one_way) || (traffic_type == traffic_type_bidirectional))
+     && (insn = addInsn(host_filter_traffic_type)))
+    insn->v.u32 = traffic_type;
+
+#ifdef NTOPNG_PRO
+  if(filtered) addInsn(host_filter_filtered);
+#endif
+
+  if(anomalous) addInsn(host_filter_anomalous);
+
+  if((ndpi_proto != -1) && (insn = addInsn(host_filter_l7proto)))
+    insn->v.i32 = ndpi_proto;
+
+  /* Note: the string must outlive the walk */
+  if(os && os[0] && (insn = addInsn(host_filter_os))) {
+    insn->v.str = os;
+    insn->aux[0] = (u_int8_t)os[0];
+  }
+}
+
+/* ******************************************* */
+
+/*
+  The most selective filter of the program that a FlowIndex can
+  serve: the flows walked through the index are still matched against
+  the whole program.
+*/
+void WalkerFilter::getFlowIndexQuery(FlowIndexQuery *q) const {
+  const walker_filter_insn_t *port = NULL, *l7proto = NULL;
+
+  q->type = flow_index_none, q->host = NULL, q->value = 0;
+
+  for(u_int8_t i = 0; i < num_insns; i++) {
+    switch(insns[i].op) {
+    case flow_filter_host:
+      q->type = flow_index_host, q->host = insns[i].v.host;
+      return;
+
+    case flow_filter_port:
+      port = &insns[i];
+      break;
+
+    case flow_filter_l7proto:
+      if((insns[i].v.i32 >= 0) && (insns[i].v.i32 <= 0xFFFF))
+	l7proto = &insns[i];
+      break;
+
+    default:
+      break;
+    }
+  }
+
+  if(port)
+    q->type = flow_index_port, q->value = (u_int16_t)port->v.u32;
+  else if(l7proto)
+    q->type = flow_index_l7proto, q->value = (u_int16_t)l7proto->v.i32;
+}
+
+/* ******************************************* */
+
+static inline bool is_unicast_host(Host *h) {
+  return(!h->get_ip()->isMulticastAddress() && !h->get_ip()->isBroadcastAddress());
+}
+
+/* ******************************************* */
+
+bool WalkerFilter::matchFlow(Flow *f) const {
+  Host *cli = f->get_cli_host(), *srv = f->get_srv_host();
+
+  for(u_int8_t i = 0; i < num_insns; i++) {
+    const walker_filter_insn_t *insn = &insns[i];
+
+    switch(insn->op) {
+    case flow_filter_host:
+      if((insn->v.host != cli) && (insn->v.host != srv)) return(false);
+      break;
+
+    case flow_filter_vlan:
+      if(f->get_vlan_id() != insn->v.u32) return(false);
+      break;
+
+    case flow_filter_port:
+      if((f->get_cli_port() != insn->v.u32) && (f->get_srv_port() != insn->v.u32)) return(false);
+      break;
+
+    case flow_filter_l7proto:
+      {
+	ndpi_protocol proto = f->get_detected_protocol();
+
+	if(insn->v.i32 == NDPI_PROTOCOL_UNKNOWN) {
+	  if((proto.app_protocol != NDPI_PROTOCOL_UNKNOWN) || (proto.master_protocol != NDPI_PROTOCOL_UNKNOWN))
+	    return(false);
+	} else if((proto.app_protocol != insn->v.i32) && (proto.master_protocol != insn->v.i32))
+	  return(false);
+      }
+      break;
+
+    case flow_filter_l7category:
+      if(f->get_protocol_category() != insn->v.i32) return(false);
+      break;
+
+    case flow_filter_ip_version:
+      if(cli && (((insn->v.u32 == 4) && !cli->get_ip()->isIPv4())
+		 || ((insn->v.u32 == 6) && !cli->get_ip()->isIPv6())))
+	return(false);
+      break;
+
+    case flow_filter_device:
+      if((f->getFlowDeviceIp() != insn->v.u32)
+	 || ((insn->flags & WALKER_FILTER_AUX0_SET) && (f->getFlowDeviceInIndex() != insn->aux[0]))
+	 || ((insn->flags & WALKER_FILTER_AUX1_SET) && (f->getFlowDeviceOutIndex() != insn->aux[1])))
+	return(false);
+      break;
+
+    case flow_filter_asn:
+      if(cli && srv && (cli->get_asn() != insn->v.u32) && (srv->get_asn() != insn->v.u32))
+	return(false);
+      break;
+
+    case flow_filter_local_network:
+      if(cli && srv
+	 && (cli->get_local_network_id() != insn->v.i32)
+	 && (srv->get_local_network_id() != insn->v.i32))
+	return(false);
+      break;
+
+    case flow_filter_pool:
+      if(!((cli && (cli->get_host_pool() == insn->v.u32))
+	   || (srv && (srv->get_host_pool() == insn->v.u32))))
+	return(false);
+      break;
+
+    case flow_filter_mac:
+      if(!((cli && cli->getMac() && cli->getMac()->equal((u_int8_t*)insn->v.mac))
+	   || (srv && srv->getMac() && srv->getMac()->equal((u_int8_t*)insn->v.mac))))
+	return(false);
+      break;
+
+    case flow_filter_client_mode:
+      if(cli && (((insn->v.u32 == location_local_only) && !cli->isLocalHost())
+		 || ((insn->v.u32 == location_remote_only) && cli->isLocalHost())))
+	return(false);
+      break;
+
+    case flow_filter_server_mode:
+      if(srv && (((insn->v.u32 == location_local_only) && !srv->isLocalHost())
+		 || ((insn->v.u32 == location_remote_only) && srv->isLocalHost())))
+	return(false);
+      break;
+
+    case flow_filter_unidirectional:
+      if(f->get_packets() > 0) {
+	bool bidirectional = (f->get_packets_cli2srv() > 0) && (f->get_packets_srv2cli() > 0);
+
+	if(insn->v.b == bidirectional) return(false);
+      }
+      break;
+
+    case flow_filter_unicast:
+      /* Unicast: at least one between client and server is unicast address */
+      if(insn->v.b) {
+	if((cli && !is_unicast_host(cli)) || (srv && !is_unicast_host(srv)))
+	  return(false);
+      } else if(cli && is_unicast_host(cli) && srv && is_unicast_host(srv))
+	return(false);
+      break;
+
+    case flow_filter_uid:
+      if((f->get_uid(true) != insn->v.u32) && (f->get_uid(false) != insn->v.u32)) return(false);
+      break;
+
+    case flow_filter_pid:
+      if((f->get_pid(true) != insn->v.u32) && (f->get_pid(false) != insn->v.u32)) return(false);
+      break;
+
+#ifdef HAVE_NEDGE
+    case flow_filter_filtered:
+      if(insn->v.b == f->isPassVerdict()) return(false);
+      break;
+#endif
+
+    case flow_filter_alerted:
+      if(insn->v.b == (f->getFlowStatus() == status_normal)) return(false);
+      break;
+
+    default:
+      return(false);
+    }
+  }
+
+  return(true);
+}
+
+/* ******************************************* */
+
+bool WalkerFilter::matchHost(Host *h) const {
+  for(u_int8_t i = 0; i < num_insns; i++) {
+    const walker_filter_insn_t *insn = &insns[i];
+
+    switch(insn->op) {
+    case host_filter_vlan:
+      if(h->get_vlan_id() != insn->v.u32) return(false);
+      break;
+
+    case host_filter_location:
+      if(h->isLocalHost() != (insn->v.u32 == location_local_only)) return(false);
+      break;
+
+    case host_filter_asn:
+      if(h->get_asn() != insn->v.u32) return(false);
+      break;
+
+    case host_filter_local_network:
+      if(h->get_local_network_id() != insn->v.i32) return(false);
+      break;
+
+    case host_filter_pool:
+      if(h->get_host_pool() != insn->v.u32) return(false);
+      break;
+
+    case host_filter_ip_version:
+      if((insn->v.u32 == 4) ? !h->get_ip()->isIPv4() : !h->get_ip()->isIPv6()) return(false);
+      break;
+
+    case host_filter_mac:
+      /* Hosts without a MAC are not filtered */
+      if(h->getMac() && !h->getMac()->equal((u_int8_t*)insn->v.mac)) return(false);
+      break;
+
+    case host_filter_country:
+      if(pack_code(h->getGeoInfo()->country_code) != insn->v.u32) return(false);
+      break;
+
+    case host_filter_blacklisted:
+      if(!h->isBlacklisted()) return(false);
+      break;
+
+    case host_filter_hidden_from_top:
+      if(h->isHiddenFromTop()) return(false);
+      break;
+
+    case host_filter_traffic_type:
+      if(h->isOneWayTraffic() != (insn->v.u32 == traffic_type_one_way)) return(false);
+      break;
+
+#ifdef NTOPNG_PRO
+    case host_filter_filtered:
+      if(!h->hasBlockedTraffic()) return(false);
+      break;
+#endif
+
+    case host_filter_anomalous:
+      if(!h->hasAnomalies()) return(false);
+      break;
+
+    case host_filter_l7proto:
+      if(h->get_ndpi_proto_bytes(insn->v.i32) == 0) return(false);
+      break;
+
+    case host_filter_os:
+      {
+	const char *os = h->get_os();
+
+	/* The first char discards most hosts without a strcmp */
+	if(!os || ((u_int8_t)os[0] != insn->aux[0]) || strcmp(os, insn->v.str))
+	  return(false);
+      }
+      break;
+
+    default:
+      return(false);
+    }
+  }
+
+  return(true);
+}